@@ -105,7 +105,10 @@ class LDMSD_Req_Attr(object):
     AUTH = 35
     RESET = 36
     DECOMPOSITION = 37
-    LAST = 38
+    QUEUE_DEPTH = 38
+    QUEUE_POLICY = 39
+    BATCH = 40
+    LAST = 41
 
     NAME_ID_MAP = {'name': NAME,
                    'interval': INTERVAL,
@@ -147,6 +150,9 @@ class LDMSD_Req_Attr(object):
                    'reset': RESET,
                    'auth': AUTH,
                    'decomposition' : DECOMPOSITION,
+                   'queue_depth' : QUEUE_DEPTH,
+                   'queue_policy' : QUEUE_POLICY,
+                   'batch' : BATCH,
                    'TERMINATING': LAST
         }
 
@@ -187,6 +193,9 @@ class LDMSD_Req_Attr(object):
                    RESET : 'reset',
                    AUTH : 'auth',
                    DECOMPOSITION : 'decomposition',
+                   QUEUE_DEPTH : 'queue_depth',
+                   QUEUE_POLICY : 'queue_policy',
+                   BATCH : 'batch',
                    LAST : 'TERMINATING'
         }
 
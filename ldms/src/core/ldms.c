@@ -47,6 +47,7 @@
  */
 #define _GNU_SOURCE
 #include <inttypes.h>
+#include <stddef.h>
 #include <sys/errno.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -72,6 +73,7 @@
 #include "ldms_heap.h"
 #include "ldms_private.h"
 #include "coll/rbt.h"
+#include "coll/fnv_hash.h"
 
 #define SET_DIR_PATH "/var/run/ldms"
 static char *__set_dir = SET_DIR_PATH;
@@ -133,6 +135,30 @@ static struct rbt __set_tree = {
 	.comparator = set_comparator
 };
 
+static int schema_comparator(void *a, const void *b)
+{
+	const struct ldms_set_schema_key *x = a;
+	const struct ldms_set_schema_key *y = b;
+	int rc;
+
+	rc = strcmp(x->schema, y->schema);
+	if (rc)
+		return rc;
+	return strcmp(x->name, y->name);
+}
+
+/*
+ * The sets ordered by schema name, then instance name, for lookups by
+ * schema. Changed together with __set_tree.
+ */
+static struct rbt __schema_tree = {
+	.root = NULL,
+	.comparator = schema_comparator
+};
+
+/* Changes whenever a set is added to or removed from __set_tree */
+static uint64_t __set_tree_gn;
+
 static int id_comparator(void *a, const void *b)
 {
 	uint64_t _a = (uint64_t)a;
@@ -145,13 +171,104 @@ static int id_comparator(void *a, const void *b)
 	return 0;
 }
 
-static struct rbt __id_tree = {
-	.root = NULL,
-	.comparator = id_comparator
-};
-
 static pthread_mutex_t __set_tree_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Hash index of the local sets by instance name and by set_id.
+ *
+ * __set_tree keeps the sets ordered by name for the directory and
+ * the regex lookup; it is changed under __set_tree_lock. Lookups by
+ * name or id go to the shards instead, so they do not contend with
+ * each other nor with iterations of __set_tree. A set is added to
+ * (or removed from) the shards while __set_tree_lock is held; a shard
+ * lock is always taken after __set_tree_lock and never together with
+ * another shard lock.
+ */
+#define SET_SHARD_COUNT 64
+#define SET_SHARD_DEPTH 1021
+
+struct set_shard {
+	pthread_rwlock_t lock;
+	htbl_t name_tbl;
+	htbl_t id_tbl;
+} __attribute__((aligned(64)));
+
+static struct set_shard __set_shard[SET_SHARD_COUNT];
+static pthread_once_t __set_shard_once = PTHREAD_ONCE_INIT;
+
+static int set_name_cmp(const void *a, const void *b, size_t key_len)
+{
+	return strncmp(a, b, key_len);
+}
+
+static int set_id_cmp(const void *a, const void *b, size_t key_len)
+{
+	return memcmp(a, b, key_len);
+}
+
+static void __set_shard_init(void)
+{
+	int i;
+	for (i = 0; i < SET_SHARD_COUNT; i++) {
+		pthread_rwlock_init(&__set_shard[i].lock, NULL);
+		__set_shard[i].name_tbl = htbl_alloc(set_name_cmp, SET_SHARD_DEPTH);
+		__set_shard[i].id_tbl = htbl_alloc(set_id_cmp, SET_SHARD_DEPTH);
+		if (!__set_shard[i].name_tbl || !__set_shard[i].id_tbl) {
+			/* Cannot run without the set index */
+			assert(0 == "Out of memory allocating the set index");
+			abort();
+		}
+	}
+}
+
+static inline struct set_shard *__set_name_shard(const char *name)
+{
+	uint64_t h = fnv_hash_a1_64(name, strlen(name), 0);
+	pthread_once(&__set_shard_once, __set_shard_init);
+	return &__set_shard[(h >> 32) % SET_SHARD_COUNT];
+}
+
+static inline struct set_shard *__set_id_shard(uint64_t id)
+{
+	pthread_once(&__set_shard_once, __set_shard_init);
+	return &__set_shard[id % SET_SHARD_COUNT];
+}
+
+/* Caller must hold the ldms set tree lock. */
+static void __set_index_ins(struct ldms_set *set)
+{
+	struct set_shard *sh;
+	const char *name = get_instance_name(set->meta)->name;
+
+	hent_init(&set->name_ent, name, strlen(name) + 1);
+	sh = __set_name_shard(name);
+	pthread_rwlock_wrlock(&sh->lock);
+	htbl_ins(sh->name_tbl, &set->name_ent);
+	pthread_rwlock_unlock(&sh->lock);
+
+	hent_init(&set->id_ent, &set->set_id, sizeof(set->set_id));
+	sh = __set_id_shard(set->set_id);
+	pthread_rwlock_wrlock(&sh->lock);
+	htbl_ins(sh->id_tbl, &set->id_ent);
+	pthread_rwlock_unlock(&sh->lock);
+}
+
+/* Caller must hold the ldms set tree lock. */
+static void __set_index_del(struct ldms_set *set)
+{
+	struct set_shard *sh;
+
+	sh = __set_name_shard(get_instance_name(set->meta)->name);
+	pthread_rwlock_wrlock(&sh->lock);
+	htbl_del(sh->name_tbl, &set->name_ent);
+	pthread_rwlock_unlock(&sh->lock);
+
+	sh = __set_id_shard(set->set_id);
+	pthread_rwlock_wrlock(&sh->lock);
+	htbl_del(sh->id_tbl, &set->id_ent);
+	pthread_rwlock_unlock(&sh->lock);
+}
+
 static struct rbt __del_tree = {
 	.root = NULL,
 	.comparator = id_comparator
@@ -169,9 +286,32 @@ int ldms_set_deleting_count()
 
 static pthread_mutex_t __del_tree_lock = PTHREAD_MUTEX_INITIALIZER;
 
+size_t __ldms_value_size_get(enum ldms_value_type t, uint32_t count);
+
+/*
+ * Record the gn the metric data will have in its blocks. This is done
+ * before the gn is incremented so that a reader that sees the new gn
+ * also sees the marks.
+ */
+static void __set_dirty_mark(struct ldms_set *set, ldms_mdesc_t desc)
+{
+	uint64_t gn = __le64_to_cpu(set->data->gn) + 1;
+	size_t off = __le32_to_cpu(desc->vd_data_offset);
+	size_t len = __ldms_value_size_get(desc->vd_type,
+					   __le32_to_cpu(desc->vd_array_count));
+	size_t blk, last;
+
+	last = (off + len - 1) >> LDMS_DELTA_BLK_SHIFT;
+	for (blk = off >> LDMS_DELTA_BLK_SHIFT; blk <= last; blk++)
+		set->dirty_gn[blk] = gn;
+	__sync_synchronize();
+}
+
 void __ldms_gn_inc(struct ldms_set *set, ldms_mdesc_t desc)
 {
 	if (desc->vd_flags & LDMS_MDESC_F_DATA) {
+		if (set->dirty_gn)
+			__set_dirty_mark(set, desc);
 		LDMS_GN_INCREMENT(set->data->gn);
 	} else {
 		LDMS_GN_INCREMENT(set->meta->meta_gn);
@@ -179,17 +319,23 @@ void __ldms_gn_inc(struct ldms_set *set, ldms_mdesc_t desc)
 	}
 }
 
-/* Caller must hold the ldms set tree lock. */
+/*
+ * The set tree lock is not required. The caller must put the returned
+ * reference.
+ */
 struct ldms_set *__ldms_find_local_set(const char *set_name)
 {
-	struct rbn *z;
+	hent_t ent;
 	struct ldms_set *s = NULL;
+	struct set_shard *sh = __set_name_shard(set_name);
 
-	z = rbt_find(&__set_tree, (void *)set_name);
-	if (z) {
-		s = container_of(z, struct ldms_set, rb_node);
+	pthread_rwlock_rdlock(&sh->lock);
+	ent = htbl_find(sh->name_tbl, set_name, strlen(set_name) + 1);
+	if (ent) {
+		s = container_of(ent, struct ldms_set, name_ent);
 		ref_get(&s->ref, __func__);
 	}
+	pthread_rwlock_unlock(&sh->lock);
 	return s;
 }
 
@@ -214,6 +360,74 @@ struct ldms_set *__ldms_local_set_next(struct ldms_set *s)
 	return NULL;
 }
 
+/*
+ * Returns the first set at or after \c z in the instance or schema
+ * order that matches \c re. The walk stops as soon as the names leave
+ * the range of the literal prefix of \c re.
+ */
+static struct ldms_set *__set_match(struct rbn *z, ldms_name_re_t re,
+				    int by_schema)
+{
+	struct ldms_set *s;
+	const char *name;
+
+	for (; z; z = rbn_succ(z)) {
+		if (by_schema) {
+			s = container_of(z, struct ldms_set, schema_node);
+			name = s->schema_key.schema;
+		} else {
+			s = container_of(z, struct ldms_set, rb_node);
+			name = s->schema_key.name;
+		}
+		if (re->prefix_len && strncmp(name, re->lit, re->prefix_len))
+			break;
+		if (0 == ldms_name_re_exec(re, name))
+			return s;
+	}
+	return NULL;
+}
+
+/* Caller must hold the ldms set tree lock */
+struct ldms_set *__ldms_local_set_match_first(ldms_name_re_t re, int by_schema)
+{
+	struct ldms_set_schema_key key;
+	struct rbn *z;
+	char *prefix = NULL;
+
+	if (re->prefix_len) {
+		prefix = strndup(re->lit, re->prefix_len);
+		if (!prefix)
+			return NULL;
+	}
+	if (!by_schema) {
+		z = prefix ? rbt_find_lub(&__set_tree, prefix)
+			   : rbt_min(&__set_tree);
+	} else if (prefix) {
+		key.schema = prefix;
+		key.name = "";
+		z = rbt_find_lub(&__schema_tree, &key);
+	} else {
+		z = rbt_min(&__schema_tree);
+	}
+	free(prefix);
+	return __set_match(z, re, by_schema);
+}
+
+/* Caller must hold the ldms set tree lock */
+struct ldms_set *__ldms_local_set_match_next(struct ldms_set *s,
+					     ldms_name_re_t re, int by_schema)
+{
+	if (by_schema)
+		return __set_match(rbn_succ(&s->schema_node), re, 1);
+	return __set_match(rbn_succ(&s->rb_node), re, 0);
+}
+
+/* Caller must hold the ldms set tree lock */
+uint64_t __ldms_set_tree_gn(void)
+{
+	return __set_tree_gn;
+}
+
 void __ldms_set_tree_lock()
 {
 	pthread_mutex_lock(&__set_tree_lock);
@@ -226,11 +440,7 @@ void __ldms_set_tree_unlock()
 
 ldms_set_t ldms_set_by_name(const char *set_name)
 {
-	struct ldms_set *set;
-	__ldms_set_tree_lock();
-	set = __ldms_find_local_set(set_name);
-	__ldms_set_tree_unlock();
-	return set;
+	return __ldms_find_local_set(set_name);
 }
 
 uint64_t ldms_set_meta_gn_get(ldms_set_t s)
@@ -312,17 +522,8 @@ struct get_set_names_arg {
 
 #define STATE_BUF_SZ 4
 #define PERM_BUF_SZ 16
-size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
-				      int need_comma,
-				      char *buf, size_t buf_size)
+static void __format_perm(uint32_t perm, char *perm_str)
 {
-	size_t cnt;
-	char dbuf[2*LDMS_DIGEST_LENGTH+1];
-	ldms_digest_t digest = ldms_set_digest_get(set);
-
-	/* format perm */
-	uint32_t perm = __le32_to_cpu(set->meta->perm);
-	char perm_str[PERM_BUF_SZ];
 	char *s = perm_str;
 	int i;
 	*s = '-';
@@ -346,9 +547,10 @@ size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
 		s++;
 	}
 	*s = '\0';
+}
 
-	/* format state flags */
-	char state[STATE_BUF_SZ];
+static void __format_state(struct ldms_set *set, char *state)
+{
 	if (set->data->trans.flags == LDMS_TRANSACTION_END)
 		state[0] = 'C';
 	else
@@ -364,6 +566,20 @@ size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
 	else
 		state[2] = ' ';
 	state[3] = '\0';
+}
+
+size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
+				      int need_comma,
+				      char *buf, size_t buf_size)
+{
+	size_t cnt;
+	char dbuf[2*LDMS_DIGEST_LENGTH+1];
+	ldms_digest_t digest = ldms_set_digest_get(set);
+	char perm_str[PERM_BUF_SZ];
+	char state[STATE_BUF_SZ];
+
+	__format_perm(__le32_to_cpu(set->meta->perm), perm_str);
+	__format_state(set, state);
 
 	cnt = snprintf(buf, buf_size,
 		       "%c{"
@@ -443,6 +659,75 @@ size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
 	return cnt;
 }
 
+static size_t __bin_str(char *buf, size_t off, size_t buf_size, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	if (off + len <= buf_size)
+		memcpy(&buf[off], str, len);
+	return off + len;
+}
+
+/*
+ * Format the set as an ldms_dir_bin_entry. Returns the 8-byte aligned
+ * length of the entry, which is only complete if this does not exceed
+ * buf_size.
+ */
+size_t __ldms_format_set_meta_as_bin(struct ldms_set *set,
+				     char *buf, size_t buf_size)
+{
+	struct ldms_dir_bin_entry *ent = (void *)buf;
+	char dbuf[2*LDMS_DIGEST_LENGTH+1];
+	ldms_digest_t digest = ldms_set_digest_get(set);
+	char perm_str[PERM_BUF_SZ];
+	char state[STATE_BUF_SZ];
+	struct ldms_set_info_pair *info;
+	uint32_t info_count = 0;
+	size_t cnt, str_end;
+
+	__format_perm(__le32_to_cpu(set->meta->perm), perm_str);
+	__format_state(set, state);
+	cnt = offsetof(struct ldms_dir_bin_entry, str);
+	cnt = __bin_str(buf, cnt, buf_size, get_instance_name(set->meta)->name);
+	cnt = __bin_str(buf, cnt, buf_size, get_schema_name(set->meta)->name);
+	cnt = __bin_str(buf, cnt, buf_size,
+			digest ? ldms_digest_str(digest, dbuf, sizeof(dbuf)) : "");
+	cnt = __bin_str(buf, cnt, buf_size, state);
+	cnt = __bin_str(buf, cnt, buf_size, perm_str);
+	LIST_FOREACH(info, &set->local_info, entry) {
+		cnt = __bin_str(buf, cnt, buf_size, info->key);
+		cnt = __bin_str(buf, cnt, buf_size, info->value);
+		info_count++;
+	}
+	LIST_FOREACH(info, &set->remote_info, entry) {
+		/* Remote info that is not overriden by local info */
+		if (__ldms_set_info_find(&set->local_info, info->key))
+			continue;
+		cnt = __bin_str(buf, cnt, buf_size, info->key);
+		cnt = __bin_str(buf, cnt, buf_size, info->value);
+		info_count++;
+	}
+	str_end = cnt;
+	cnt = roundup(cnt, 8);
+	if (cnt > buf_size)
+		return cnt;
+	memset(&buf[str_end], 0, cnt - str_end);
+	ent->len = __cpu_to_le32(cnt);
+	ent->flags = 0;
+	ent->meta_size = set->meta->meta_sz;
+	ent->data_size = set->meta->data_sz;
+	ent->heap_size = set->meta->heap_sz;
+	ent->uid = set->meta->uid;
+	ent->gid = set->meta->gid;
+	ent->card = set->meta->card;
+	ent->array_card = set->meta->array_card;
+	ent->info_count = __cpu_to_le32(info_count);
+	ent->meta_gn = set->meta->meta_gn;
+	ent->data_gn = set->data->gn;
+	ent->timestamp = set->data->trans.ts;
+	ent->duration = set->data->trans.dur;
+	return cnt;
+}
+
 static int get_set_list_cb(struct ldms_set *set, void *arg)
 {
 	struct get_set_names_arg *a = arg;
@@ -499,9 +784,7 @@ __record_set(const char *instance_name,
 	zap_err_t zerr;
 	size_t sz;
 
-	__ldms_set_tree_lock();
 	set = __ldms_find_local_set(instance_name);
-	__ldms_set_tree_unlock();
 	if (set) {
 		ref_put(&set->ref, "__ldms_find_local_set");
 		errno = EEXIST;
@@ -534,7 +817,9 @@ __record_set(const char *instance_name,
 
 	ref_init(&set->ref, __func__, __destroy_set, set);
 	rbn_init(&set->rb_node, get_instance_name(set->meta)->name);
-	rbn_init(&set->id_node, (void *)set->set_id);
+	set->schema_key.schema = get_schema_name(set->meta)->name;
+	set->schema_key.name = get_instance_name(set->meta)->name;
+	rbn_init(&set->schema_node, &set->schema_key);
 
 	__ldms_set_tree_lock();
 	/* Check if we lost a race creating this same set name */
@@ -547,7 +832,9 @@ __record_set(const char *instance_name,
 		goto unlock_set_tree;
 	}
 	rbt_ins(&__set_tree, &set->rb_node);
-	rbt_ins(&__id_tree, &set->id_node);
+	rbt_ins(&__schema_tree, &set->schema_node);
+	__set_tree_gn++;
+	__set_index_ins(set);
 
  unlock_set_tree:
 	__ldms_set_tree_unlock();
@@ -559,17 +846,39 @@ __record_set(const char *instance_name,
 	return NULL;
 }
 
+static struct ldms_set *__set_by_id(uint64_t id, int get_ref)
+{
+	struct ldms_set *set = NULL;
+	struct set_shard *sh = __set_id_shard(id);
+	hent_t ent;
+
+	pthread_rwlock_rdlock(&sh->lock);
+	ent = htbl_find(sh->id_tbl, &id, sizeof(id));
+	if (ent) {
+		set = container_of(ent, struct ldms_set, id_ent);
+		if (get_ref)
+			ref_get(&set->ref, "__ldms_find_local_set");
+	}
+	pthread_rwlock_unlock(&sh->lock);
+	return set;
+}
+
 /**
- * Callers must hold the set_tree lock
+ * The set tree lock is not required. No reference is taken on the
+ * returned set.
  */
 extern struct ldms_set *__ldms_set_by_id(uint64_t id)
 {
-	struct ldms_set *set = NULL;
-	struct rbn *rbn;
-	rbn = rbt_find(&__id_tree, (void *)id);
-	if (rbn)
-		set = container_of(rbn, struct ldms_set, id_node);
-	return set;
+	return __set_by_id(id, 0);
+}
+
+/*
+ * The set tree lock is not required. The caller must put the returned
+ * reference.
+ */
+struct ldms_set *__ldms_find_local_set_by_id(uint64_t id)
+{
+	return __set_by_id(id, 1);
 }
 
 static
@@ -607,6 +916,7 @@ int __ldms_set_unpublish(struct ldms_set *set)
 		return ENOENT;
 
 	set->flags &= ~LDMS_SET_F_PUBLISHED;
+	__ldms_dir_unpub_set(set);
 	return 0;
 }
 
@@ -769,6 +1079,7 @@ static void __destroy_set_no_lock(void *v)
 	struct ldms_set *set = v;
 	struct ldms_xprt *x = set->xprt;
 	struct ldms_context *ctxt;
+	int i;
 	if (x) {
 		/*
 		 * Check if there any transports referencing this set
@@ -794,6 +1105,12 @@ static void __destroy_set_no_lock(void *v)
 				if (ctxt->set_delete.s == set)
 					ctxt->set_delete.s = NULL;
 				break;
+			case LDMS_CONTEXT_UPDATE_BATCH:
+				for (i = 0; i < ctxt->update_batch.count; i++) {
+					if (ctxt->update_batch.s[i] == set)
+						ctxt->update_batch.s[i] = NULL;
+				}
+				break;
 			default:
 				break;
 			}
@@ -807,6 +1124,7 @@ static void __destroy_set_no_lock(void *v)
 	zap_unmap(set->lmap);
 	if (set->rmap)
 		zap_unmap(set->rmap);
+	free(set->dirty_gn);
 	free(set);
 }
 
@@ -837,7 +1155,9 @@ void ldms_set_delete(ldms_set_t s)
 		return;
 	}
 	rbt_del(&__set_tree, &s->rb_node);
-	rbt_del(&__id_tree, &s->id_node);
+	rbt_del(&__schema_tree, &s->schema_node);
+	__set_tree_gn++;
+	__set_index_del(s);
 	__ldms_set_tree_unlock();
 
 	/* NOTE: We can cut down the entire tree at once because the
@@ -895,6 +1215,97 @@ void ldms_set_put(ldms_set_t s)
 	ref_put(&s->ref, "__ldms_find_local_set");
 }
 
+static int __info_copy(struct ldms_set_info_list *dst,
+		       struct ldms_set_info_list *src)
+{
+	struct ldms_set_info_pair *pair;
+	int rc;
+	LIST_FOREACH(pair, src, entry) {
+		rc = __ldms_set_info_set(dst, pair->key, pair->value);
+		if (rc > 0)
+			return rc;
+	}
+	return 0;
+}
+
+ldms_set_t ldms_set_snapshot(ldms_set_t s)
+{
+	struct ldms_set *snap;
+	struct ldms_set_hdr *meta;
+	struct ldms_data_hdr *data;
+	uint32_t meta_sz, data_sz, heap_sz;
+	void *base;
+	int rc;
+
+	snap = calloc(1, sizeof(*snap));
+	if (!snap)
+		goto err_0;
+	pthread_mutex_lock(&s->lock);
+	meta_sz = __le32_to_cpu(s->meta->meta_sz);
+	data_sz = __le32_to_cpu(s->meta->data_sz);
+	meta = malloc(meta_sz + data_sz);
+	if (!meta)
+		goto err_1;
+	memcpy(meta, s->meta, meta_sz);
+	data = (void *)meta + meta_sz;
+	memcpy(data, s->data, data_sz);
+	/* The snapshot carries only the current data slot */
+	meta->array_card = __cpu_to_le32(1);
+	data->curr_idx = 0;
+
+	LIST_INIT(&snap->local_info);
+	LIST_INIT(&snap->remote_info);
+	rc = __info_copy(&snap->local_info, &s->local_info);
+	if (!rc)
+		rc = __info_copy(&snap->remote_info, &s->remote_info);
+	pthread_mutex_unlock(&s->lock);
+	if (rc)
+		goto err_2;
+
+	pthread_mutex_init(&snap->lock, NULL);
+	rbt_init(&snap->push_coll, rbn_ptr_cmp);
+	rbt_init(&snap->lookup_coll, rbn_ptr_cmp);
+	snap->flags = LDMS_SET_F_SNAPSHOT;
+	snap->set_id = s->set_id;
+	snap->remote_set_id = s->remote_set_id;
+	snap->meta = meta;
+	snap->data_array = data;
+	snap->data = data;
+	snap->curr_idx = 0;
+	heap_sz = __le32_to_cpu(meta->heap_sz);
+	if (heap_sz && s->heap) {
+		base = (void *)data + data_sz - heap_sz;
+		snap->heap = ldms_heap_get(&snap->heap_inst, &data->heap, base);
+	}
+	return snap;
+
+ err_2:
+	__ldms_set_info_delete(&snap->local_info);
+	__ldms_set_info_delete(&snap->remote_info);
+	free(meta);
+	free(snap);
+	errno = ENOMEM;
+	return NULL;
+ err_1:
+	pthread_mutex_unlock(&s->lock);
+	free(snap);
+ err_0:
+	errno = ENOMEM;
+	return NULL;
+}
+
+void ldms_set_snapshot_free(ldms_set_t snap)
+{
+	if (!snap)
+		return;
+	assert(snap->flags & LDMS_SET_F_SNAPSHOT);
+	__ldms_set_info_delete(&snap->local_info);
+	__ldms_set_info_delete(&snap->remote_info);
+	pthread_mutex_destroy(&snap->lock);
+	free(snap->meta);
+	free(snap);
+}
+
 static  void sync_lookup_cb(ldms_t x, enum ldms_lookup_status status, int more,
 			    ldms_set_t s, void *arg)
 {
@@ -925,7 +1336,15 @@ int ldms_xprt_lookup(ldms_t x, const char *path, enum ldms_lookup_flags flags,
 
 int ldms_xprt_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
 {
-	return __ldms_remote_dir(x, cb, cb_arg, flags);
+	return __ldms_remote_dir(x, NULL, cb, cb_arg, flags);
+}
+
+int ldms_xprt_dir_cached(ldms_t x, ldms_dir_cache_t c,
+			 ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
+{
+	if (!c || !cb)
+		return EINVAL;
+	return __ldms_remote_dir(x, c, cb, cb_arg, flags);
 }
 
 int ldms_xprt_dir_cancel(ldms_t x)
@@ -1510,6 +1929,81 @@ void __init_rec_array(ldms_set_t set, ldms_schema_t schema)
 	}
 }
 
+/*
+ * Track the changed blocks of wide sets. Set arrays, and sets with a heap
+ * or record arrays whose members are not set through their descriptor,
+ * are always sent whole.
+ */
+static void __init_dirty_gn(struct ldms_set *set, ldms_schema_t schema)
+{
+	ldms_mdef_t md;
+	size_t nblk;
+
+	if (schema->array_card != 1 || set->meta->heap_sz ||
+	    schema->data_sz < LDMS_DELTA_MIN_DATA_SZ)
+		return;
+	STAILQ_FOREACH(md, &schema->metric_list, entry) {
+		if (md->type == LDMS_V_RECORD_ARRAY || md->type == LDMS_V_LIST)
+			return;
+	}
+	nblk = (schema->data_sz >> LDMS_DELTA_BLK_SHIFT) + 1;
+	/* Without tracking the set is sent whole, not an error */
+	set->dirty_gn = calloc(nblk, sizeof(*set->dirty_gn));
+}
+
+/*
+ * Encode the data blocks of \c set changed after data gn \c gn into
+ * \c buf as ldms_update_batch_range entries, the first one being the
+ * data header. Returns the encoded length, or -1 if the set is not
+ * tracked, \c gn is unknown, or the encoding does not fit in \c len.
+ */
+ssize_t __ldms_set_delta_get(struct ldms_set *set, uint64_t gn,
+			     void *buf, size_t len)
+{
+	struct ldms_update_batch_range *r;
+	size_t hdr_sz = roundup(sizeof(struct ldms_data_hdr), 8);
+	size_t data_sz = __le32_to_cpu(set->meta->data_sz);
+	size_t nblk, blk, start, end, off = 0;
+
+	if (!set->dirty_gn || !gn)
+		return -1;
+	if (sizeof(*r) + hdr_sz > len)
+		return -1;
+	/* The header goes first, the blocks changed up to its gn follow */
+	r = buf;
+	r->off = 0;
+	r->len = htonl(hdr_sz);
+	memcpy(r->data, set->data, hdr_sz);
+	__sync_synchronize();
+	if (gn > __le64_to_cpu(((struct ldms_data_hdr *)r->data)->gn))
+		return -1;
+	off += sizeof(*r) + hdr_sz;
+
+	nblk = (data_sz + (1 << LDMS_DELTA_BLK_SHIFT) - 1) >> LDMS_DELTA_BLK_SHIFT;
+	for (blk = 0; blk < nblk; blk++) {
+		if (set->dirty_gn[blk] <= gn)
+			continue;
+		start = blk << LDMS_DELTA_BLK_SHIFT;
+		while (blk + 1 < nblk && set->dirty_gn[blk + 1] > gn)
+			blk++;
+		end = (blk + 1) << LDMS_DELTA_BLK_SHIFT;
+		if (start < hdr_sz)
+			start = hdr_sz;
+		if (end > data_sz)
+			end = data_sz;
+		if (start >= end)
+			continue;
+		if (off + sizeof(*r) + roundup(end - start, 8) > len)
+			return -1;
+		r = buf + off;
+		r->off = htonl(start);
+		r->len = htonl(end - start);
+		memcpy(r->data, (void *)set->data + start, end - start);
+		off += sizeof(*r) + roundup(end - start, 8);
+	}
+	return off;
+}
+
 static void __ldms_schema_finalize(ldms_schema_t schema)
 {
 	if (memcmp(&schema->digest, &null_digest, LDMS_DIGEST_LENGTH))
@@ -1684,6 +2178,7 @@ ldms_set_t ldms_set_new_custom(const char *instance_name,
 		set->heap = ldms_heap_get(&set->heap_inst, &set->data->heap,
 				&((uint8_t *)set->data)[schema->data_sz]);
 	__init_rec_array(set, schema);
+	__init_dirty_gn(set, schema);
 	return set;
 }
 
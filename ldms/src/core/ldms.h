@@ -51,8 +51,10 @@
 #include <limits.h>
 #include <inttypes.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/queue.h>
 #include <string.h>
+#include <regex.h>
 #include <netinet/in.h>
 #include <byteswap.h>
 #include <asm/byteorder.h>
@@ -578,6 +580,7 @@ typedef void (*ldms_lookup_cb_t)(ldms_t t, enum ldms_lookup_status status,
 #define LDMS_SET_F_REMOTE	0x0008
 #define LDMS_SET_F_PUSH_CHANGE	0x0010
 #define LDMS_SET_F_DATA_COPY	0x0020 /* set array data copy on transaction begin */
+#define LDMS_SET_F_SNAPSHOT	0x0040 /* private copy from ldms_set_snapshot() */
 #define LDMS_SET_F_PUBLISHED	0x100000 /* Set is in the set tree. */
 #define LDMS_SET_ID_DATA	0x1000000
 
@@ -869,6 +872,22 @@ extern void ldms_xprt_close(ldms_t x);
  */
 extern int ldms_xprt_send(ldms_t x, char *msg_buf, size_t msg_len);
 
+/**
+ * \brief Send a message gathered from several buffers to an LDMS peer
+ *
+ * The peer receives a single message with the concatenation of the \c
+ * iovcnt buffers described by \c iov, the same as if they had been copied
+ * into one buffer and sent with ldms_xprt_send(). The buffers are not
+ * flattened by LDMS; on transports that support it they are written to the
+ * wire directly. The buffers may be reused when the function returns.
+ *
+ * \param x      The transport handle
+ * \param iov    The array of buffers
+ * \param iovcnt The number of entries in \c iov
+ * \returns 0 on success, or an errno
+ */
+extern int ldms_xprt_send_iov(ldms_t x, const struct iovec *iov, int iovcnt);
+
 /**
  * \brief Get the maximum size of send/recv message.
  * \param x The transport handle.
@@ -1032,6 +1051,58 @@ int ldms_xprt_dir_cancel(ldms_t t);
 #define LDMS_DIR_F_NOTIFY	1
 extern int ldms_xprt_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags);
 
+/**
+ * \brief A copy of a peer's directory kept across connections
+ *
+ * A directory cache remembers the last directory received from a peer
+ * and its generation. When it is passed to ldms_xprt_dir_cached() on a
+ * new connection to the same peer, only the sets that were published,
+ * changed or removed since then are transferred.
+ */
+typedef struct ldms_dir_cache_s *ldms_dir_cache_t;
+
+/**
+ * \brief Create an empty directory cache
+ *
+ * \returns The cache or NULL with errno set
+ */
+ldms_dir_cache_t ldms_dir_cache_new(void);
+
+/**
+ * \brief Free a directory cache
+ *
+ * The cache must not be in use by a transport.
+ *
+ * \param c The cache
+ */
+void ldms_dir_cache_free(ldms_dir_cache_t c);
+
+/**
+ * \brief Query the sets published by a host using a directory cache
+ *
+ * This is ldms_xprt_dir() with a \c cb that is not NULL, except that
+ * the first callback is a single LDMS_DIR_LIST of all sets built from
+ * the cache once it has been brought up to date. If the peer supports
+ * it, only the changes since the directory generation in \c c are
+ * transferred. Otherwise \c c is emptied and this behaves exactly like
+ * ldms_xprt_dir(). The
+ * LDMS_DIR_ADD and LDMS_DIR_UPD updates requested with
+ * LDMS_DIR_F_NOTIFY and the set deletions of the peer are applied to
+ * the cache as they arrive.
+ *
+ * A cache must only be used with one peer and one transport at a time.
+ *
+ * \param x	 The transport handle
+ * \param c	 The directory cache
+ * \param cb	 The callback function
+ * \param cb_arg A user context that will be provided as a parameter
+ *		 to the \c cb function.
+ * \param flags	 LDMS_DIR_F_NOTIFY or 0
+ * \returns	0 if the query was submitted successfully
+ */
+extern int ldms_xprt_dir_cached(ldms_t x, ldms_dir_cache_t c,
+				ldms_dir_cb_t cb, void *cb_arg, uint32_t flags);
+
 #define LDMS_XPRT_LIBPATH_DEFAULT PLUGINDIR
 #define LDMS_DEFAULT_PORT	LDMSDPORT
 #define LDMS_LOOKUP_PATH_MAX	511
@@ -1084,6 +1155,69 @@ enum ldms_lookup_flags {
 extern int ldms_xprt_lookup(ldms_t t, const char *name, enum ldms_lookup_flags flags,
 		       ldms_lookup_cb_t cb, void *cb_arg);
 
+/**
+ * \brief A compiled set name matcher
+ *
+ * A regular expression compiled with ldms_name_re_comp() is examined
+ * for its literal parts. Expressions that reduce to an exact name
+ * (\c ^name$), a prefix (\c ^prefix or \c ^prefix.*), a substring
+ * (\c text or \c .*text.*) or anything (\c "" or \c .*) are matched
+ * with string compares. Other expressions go to regexec(), but
+ * \c prefix_len leading characters of \c lit are still required of every
+ * matching name, which lets callers scan a name-ordered index for
+ * the matching range only.
+ */
+typedef struct ldms_name_re {
+	enum ldms_name_re_type {
+		LDMS_NAME_RE_ALL,	/* matches every name */
+		LDMS_NAME_RE_EXACT,	/* name == lit */
+		LDMS_NAME_RE_PREFIX,	/* name starts with lit */
+		LDMS_NAME_RE_SUBSTR,	/* name contains lit */
+		LDMS_NAME_RE_REGEX,	/* regexec(), name starts with lit */
+	} type;
+	char *lit;		/* literal part of the expression */
+	size_t lit_len;
+	size_t prefix_len;	/* leading chars of lit every match starts with */
+	int has_regex;
+	regex_t regex;
+} *ldms_name_re_t;
+
+/**
+ * \brief Compile a set name regular expression
+ *
+ * \param re     The matcher to initialize.
+ * \param expr   The regular expression.
+ * \param cflags The regcomp() flags.
+ *
+ * \retval 0      If succeeded.
+ * \retval ENOMEM If out of memory.
+ * \retval rc     The regcomp() error code. The message is available
+ *                from regerror() with \c re->regex. The caller must
+ *                call ldms_name_re_free() in this case too.
+ */
+int ldms_name_re_comp(ldms_name_re_t re, const char *expr, int cflags);
+
+/**
+ * \brief Initialize a matcher for the exact name \c name
+ *
+ * \retval 0      If succeeded.
+ * \retval ENOMEM If out of memory.
+ */
+int ldms_name_re_exact(ldms_name_re_t re, const char *name);
+
+/**
+ * \brief Match a name
+ *
+ * \retval 0           If \c name matches.
+ * \retval REG_NOMATCH Otherwise.
+ */
+int ldms_name_re_exec(ldms_name_re_t re, const char *name);
+
+/**
+ * \brief Release the resources of a matcher
+ */
+void ldms_name_re_free(ldms_name_re_t re);
+
 /** \} */
 
 /**
@@ -1100,6 +1234,10 @@ extern int ldms_xprt_lookup(ldms_t t, const char *name, enum ldms_lookup_flags f
 #define LDMS_UPD_F_PUSH_LAST	0x20000000
 /** Indicate more outstanding update completion on the set */
 #define LDMS_UPD_F_MORE		0x40000000
+/** The push update is one of several received together */
+#define LDMS_UPD_F_BATCH	0x01000000
+/** This is the last push update received together with the others */
+#define LDMS_UPD_F_BATCH_END	0x02000000
 
 #define LDMS_UPD_ERROR_MASK 0x00FFFFFF
 
@@ -1132,6 +1270,38 @@ typedef void (*ldms_update_cb_t)(ldms_t t, ldms_set_t s, int flags, void *arg);
  */
 extern int ldms_xprt_update(ldms_set_t s, ldms_update_cb_t update_cb, void *arg);
 
+/**
+ * \brief Update many metric sets of a transport in one request.
+ *
+ * The current data of the sets are requested from the peer with one
+ * message per \c ldms_xprt_msg_max() worth of sets instead of one RDMA
+ * read per set. Set arrays, and sets whose metadata changed since the
+ * last update, are updated as with ldms_xprt_update(). \c update_cb is
+ * called once for each set; errors detected after the request was
+ * issued are reported there.
+ *
+ * With LDMS_XPRT_UPDATE_F_DELTA, the peer sends only the parts of the
+ * data that changed since the local copy was updated, when that is
+ * less than half of the data. Only sets of at least 4kB of metrics
+ * without lists or record arrays are tracked by the peer; the others
+ * are sent whole.
+ *
+ * If the peer does not support the batch update request, every set is
+ * updated as with ldms_xprt_update().
+ *
+ * \param x	The transport the sets were looked up on.
+ * \param sets	The array of set handles to update.
+ * \param cb_args The callback argument of each set, may be NULL.
+ * \param count	The number of sets.
+ * \param update_cb The function to call when each set has been updated.
+ * \param flags	0 or LDMS_XPRT_UPDATE_F_DELTA.
+ * \returns	0 on success or an errno if no update was issued.
+ */
+#define LDMS_XPRT_UPDATE_F_DELTA	1
+extern int ldms_xprt_update_batch(ldms_t x, ldms_set_t *sets, void **cb_args,
+				  int count, ldms_update_cb_t update_cb,
+				  int flags);
+
 #define LDMS_XPRT_PUSH_F_CHANGE	1
 /**
  * \brief Register a remote set for push notifications
@@ -1197,6 +1367,28 @@ extern int ldms_xprt_cancel_push(ldms_set_t s);
  */
 extern int ldms_xprt_push(ldms_set_t s);
 
+/**
+ * \brief Set the push coalescing window
+ *
+ * If \c usec is not 0, the sets pushed to a peer are not sent right
+ * away. All sets pushed to the same peer within \c usec microseconds
+ * of the first are sent together, in as few messages as they fit in,
+ * with their contents at the time they are sent. A set pushed several
+ * times within the window is sent once. Peers that do not support
+ * coalesced pushes, and sets that do not fit in one message, are
+ * pushed right away.
+ *
+ * At the peer, the push callbacks of the sets received in one message
+ * have LDMS_UPD_F_BATCH set, and the last of them also has
+ * LDMS_UPD_F_BATCH_END.
+ *
+ * The initial window is taken from the LDMS_PUSH_COALESCE_US
+ * environment variable, the default is 0.
+ *
+ * \param usec The window in microseconds, 0 to push right away.
+ */
+extern void ldms_xprt_push_coalesce_set(uint32_t usec);
+
 typedef struct ldms_stats_entry {
 	uint64_t count;
 	uint64_t total_us;
@@ -1243,6 +1435,10 @@ typedef struct ldms_xprt_stats {
 	struct timespec disconnected;
 	struct timespec last_op;
 	struct ldms_stats_entry ops[LDMS_XPRT_OP_COUNT];
+	uint64_t ctxt_alloc;	/* request contexts allocated */
+	uint64_t ctxt_reuse;	/* of those, taken from the free lists */
+	uint64_t push_set;	/* set contents pushed to the peer */
+	uint64_t push_msg;	/* messages they were sent in */
 } *ldms_xprt_stats_t;
 
 /**
@@ -1634,6 +1830,33 @@ extern void ldms_set_delete(ldms_set_t s);
  */
 void ldms_set_put(ldms_set_t s);
 
+/**
+ * \brief Take a private snapshot of the set's current data.
+ *
+ * The snapshot is a copy of the set metadata and the current data
+ * slot (including the heap) that is not registered in the set tree
+ * and is not associated with any transport. All the metric accessor
+ * functions work on the snapshot, so it can be handed to a thread
+ * that consumes the data after the original set has been updated
+ * again, e.g. a storage worker.
+ *
+ * The caller must ensure that the set data is not being modified
+ * while the snapshot is taken, e.g. by calling this function from the
+ * update completion callback.
+ *
+ * \param s The set handle.
+ * \retval snap The snapshot handle.
+ * \retval NULL If there is an error; \c errno is set to describe it.
+ */
+ldms_set_t ldms_set_snapshot(ldms_set_t s);
+
+/**
+ * \brief Free a snapshot returned by ::ldms_set_snapshot().
+ *
+ * \param snap The snapshot handle.
+ */
+void ldms_set_snapshot_free(ldms_set_t snap);
+
 /**
  * \brief Get the schema name for the set
  *
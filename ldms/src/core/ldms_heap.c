@@ -77,6 +77,15 @@ struct mm_alloc {
 	uint32_t count;
 };
 
+/* A free chunk in a size-class list */
+struct mm_slab {
+	uint32_t count;
+	uint32_t next;		/* Offset of the next chunk in the list */
+};
+
+/* The number of chunks carved at once to refill a size-class list */
+#define LDMS_HEAP_SLAB_OBJS 16
+
 static int compare_size(void *node_key, const void *val_key)
 {
 	/* The key value is the number of grains. */
@@ -149,6 +158,9 @@ void ldms_heap_get_info(ldms_heap_t heap, ldms_heap_info_t info)
 
 	info->smallest = heap->data->size + 1;
 	rrbt_traverse(heap->addr_tree, heap_stat, info);
+	info->slab_chunks = heap->data->slab_chunks;
+	info->slab_bytes = (size_t)heap->data->slab_grains
+					<< heap->data->grain_bits;
 
 	pthread_mutex_unlock(&heap->lock);
 }
@@ -185,6 +197,9 @@ void ldms_heap_init(struct ldms_heap *heap, void *base, size_t size, size_t grai
 
 	heap->size = size;
 	heap->gn = 0;
+	heap->slab_chunks = 0;
+	heap->slab_grains = 0;
+	memset(heap->slab, 0, sizeof(heap->slab));
 
 	/* Inialize the size and address r-b trees */
 	rrbt_init(&heap->size_tree);
@@ -234,34 +249,19 @@ size_t ldms_heap_alloc_size(size_t grain_sz, size_t data_sz)
 	return MMR_ROUNDUP(data_sz, ldms_heap_grain_size(grain_sz));
 }
 
-void *ldms_heap_alloc(ldms_heap_t heap, size_t size)
+/*
+ * Take a chunk of \c count grains from the r-b trees, splitting off
+ * and re-inserting the remainder. Called with the heap lock held.
+ */
+static struct mm_free *__heap_take(ldms_heap_t heap, uint64_t count)
 {
 	struct mm_free *p, *n;
-	struct mm_alloc *a;
 	struct rrbn *rbn;
-	uint64_t count;
 	uint64_t remainder;
 
-
-	size = ldms_heap_alloc_size(heap->data->grain, size);
-	count = size >> heap->data->grain_bits;
-
-#if LDMS_HEAP_DEBUG
-	printf("------- %p: heap_alloc(%ld) -- start\n", heap, count);
-	printf("                         ---size tree ----\n");
-	rrbt_verify(heap->size_tree);
-	rrbt_print(heap->size_tree);
-	printf("                         ---addr tree ----\n");
-	rrbt_verify(heap->addr_tree);
-	rrbt_print(heap->addr_tree);
-#endif /* LDMS_HEAP_DEBUG */
-
-	pthread_mutex_lock(&heap->lock);
 	rbn = rrbt_find_lub(heap->size_tree, &count);
-	if (!rbn) {
-		pthread_mutex_unlock(&heap->lock);
+	if (!rbn)
 		return NULL;
-	}
 
 	p = container_of(rbn, struct mm_free, size_node);
 
@@ -281,17 +281,161 @@ void *ldms_heap_alloc(ldms_heap_t heap, size_t size)
 		rrbt_ins(heap->size_tree, RRBN(n->size_node));
 		rrbt_ins(heap->addr_tree, RRBN(n->addr_node));
 	}
+	return p;
+}
+
+/*
+ * Return the chunk \c p of \c count grains to the r-b trees,
+ * coalescing it with its neighbors. Called with the heap lock held.
+ */
+static void __heap_put(ldms_heap_t heap, struct mm_free *p, uint64_t count)
+{
+	struct mm_free *q;
+	struct rrbn *rbn;
+	uint64_t offset;
+	uint64_t end;
+
+	offset = ldms_heap_off(heap, p);
+	rrbn_init(RRBN(p->size_node), &count, sizeof(count));
+	rrbn_init(RRBN(p->addr_node), &offset, sizeof(offset));
+
+	/* See if we can coalesce with our lesser sibling */
+	rbn = rrbt_find_glb(heap->addr_tree, &offset);
+	if (rbn) {
+		q = container_of(rbn, struct mm_free, addr_node);
+
+		/* See if q is contiguous with p */
+		end = q->addr_node.key_u64[0] + (q->size_node.key_u64[0] << heap->data->grain_bits);
+		if (end == p->addr_node.key_u64[0]) {
+			/* Remove the left sibling from the tree and coelesce */
+			rrbt_del(heap->size_tree, RRBN(q->size_node));
+			rrbt_del(heap->addr_tree, RRBN(q->addr_node));
+			q->size_node.key_u64[0] += p->size_node.key_u64[0];
+			p = q;
+		}
+	}
+	/* See if we can coalesce with our greater sibling */
+	offset = ldms_heap_off(heap, p);
+	rbn = rrbt_find_lub(heap->addr_tree, &offset);
+	if (rbn) {
+		q = container_of(rbn, struct mm_free, addr_node);
+
+		end = p->addr_node.key_u64[0] + (p->size_node.key_u64[0] << heap->data->grain_bits);
+		if (end == q->addr_node.key_u64[0]) {
+			/* Remove the right sibling from the tree and coelesce */
+			rrbt_del(heap->size_tree, RRBN(q->size_node));
+			rrbt_del(heap->addr_tree, RRBN(q->addr_node));
+			p->size_node.key_u64[0] += q->size_node.key_u64[0];
+		}
+	}
+	rrbn_init(RRBN(p->size_node), p->size_node.key_u64, sizeof(uint64_t));
+	rrbn_init(RRBN(p->addr_node), p->addr_node.key_u64, sizeof(uint64_t));
+
+	/* Put 'p' back in the trees */
+	rrbt_ins(heap->size_tree, RRBN(p->size_node));
+	rrbt_ins(heap->addr_tree, RRBN(p->addr_node));
+}
+
+static void __slab_push(ldms_heap_t heap, struct mm_slab *s, uint32_t count)
+{
+	s->count = count;
+	s->next = heap->data->slab[count - 1];
+	heap->data->slab[count - 1] = ldms_heap_off(heap, s);
+	heap->data->slab_chunks++;
+	heap->data->slab_grains += count;
+}
+
+static struct mm_slab *__slab_pop(ldms_heap_t heap, uint32_t count)
+{
+	struct mm_slab *s;
+
+	s = ldms_heap_ptr(heap, heap->data->slab[count - 1]);
+	if (!s)
+		return NULL;
+	heap->data->slab[count - 1] = s->next;
+	heap->data->slab_chunks--;
+	heap->data->slab_grains -= count;
+	return s;
+}
+
+/*
+ * Carve LDMS_HEAP_SLAB_OBJS chunks of \c count grains from one free
+ * chunk, keep the first and queue the rest on the class list.
+ */
+static struct mm_free *__slab_refill(ldms_heap_t heap, uint32_t count)
+{
+	struct mm_free *p;
+	uint8_t *c;
+	int i;
+
+	p = __heap_take(heap, (uint64_t)count * LDMS_HEAP_SLAB_OBJS);
+	if (!p)
+		return NULL;
+	c = (uint8_t *)p + ((uint64_t)count * LDMS_HEAP_SLAB_OBJS
+					<< heap->data->grain_bits);
+	for (i = 1; i < LDMS_HEAP_SLAB_OBJS; i++) {
+		c -= (uint64_t)count << heap->data->grain_bits;
+		__slab_push(heap, (struct mm_slab *)c, count);
+	}
+	return p;
+}
+
+/* Give all the size-class chunks back to the r-b trees */
+static void __slab_flush(ldms_heap_t heap)
+{
+	struct mm_slab *s;
+	uint32_t count;
+
+	for (count = 1; count <= LDMS_HEAP_SLAB_CLASSES; count++) {
+		while ((s = __slab_pop(heap, count)))
+			__heap_put(heap, (struct mm_free *)s, count);
+	}
+}
+
+void *ldms_heap_alloc(ldms_heap_t heap, size_t size)
+{
+	struct mm_free *p = NULL;
+	struct mm_alloc *a;
+	uint64_t count;
+
+
+	size = ldms_heap_alloc_size(heap->data->grain, size);
+	count = size >> heap->data->grain_bits;
+
+#if LDMS_HEAP_DEBUG
+	printf("------- %p: heap_alloc(%ld) -- start\n", heap, count);
+	printf("                         ---size tree ----\n");
+	rrbt_verify(heap->size_tree);
+	rrbt_print(heap->size_tree);
+	printf("                         ---addr tree ----\n");
+	rrbt_verify(heap->addr_tree);
+	rrbt_print(heap->addr_tree);
+#endif /* LDMS_HEAP_DEBUG */
+
+	pthread_mutex_lock(&heap->lock);
+	if (count <= LDMS_HEAP_SLAB_CLASSES) {
+		p = (struct mm_free *)__slab_pop(heap, count);
+		if (!p)
+			p = __slab_refill(heap, count);
+	}
+	if (!p)
+		p = __heap_take(heap, count);
+	if (!p && heap->data->slab_chunks) {
+		/* The free memory may be sitting in the size-class lists */
+		__slab_flush(heap);
+		p = __heap_take(heap, count);
+	}
+	if (!p) {
+		pthread_mutex_unlock(&heap->lock);
+		return NULL;
+	}
+
 	a = (struct mm_alloc *)p;
 	a->count = count;
 	a += 1;
 #if LDMS_HEAP_DEBUG
-	printf("---%lx (size:%lx[%p], addr:%lx[%p], end:%lx) ---- heap_alloc(%ld) -- end\n",
-			ldms_heap_off(heap, a),
-			rrbt_off(heap->size_tree, rbn),
-			rbn,
-			rrbt_off(heap->addr_tree, RRBN(p->addr_node)),
-			&p->addr_node,
-			rrbt_off(heap->addr_tree, RRBN(p->addr_node)) + size,  count);
+	printf("---%lx (size:%lx) ---- heap_alloc(%ld) -- end\n",
+			ldms_heap_off(heap, a), size, count);
 	printf("                         ---size tree ----\n");
 	rrbt_verify(heap->size_tree);
 	rrbt_print(heap->size_tree);
@@ -310,17 +454,18 @@ void ldms_heap_free(ldms_heap_t heap, void *d)
 	uint64_t count;
 	struct mm_alloc *a = d;
 	struct mm_free *p;
+#if LDMS_HEAP_DEBUG
 	struct mm_free *q;
 	struct rrbn *rbn;
 	uint64_t offset;
-	uint64_t end;
+#endif /* LDMS_HEAP_DEBUG */
 
 	a--;
 	p = (void *)a;
 	pthread_mutex_lock(&heap->lock);
-	offset = ldms_heap_off(heap, p);
 	count = a->count;
 #if LDMS_HEAP_DEBUG
+	offset = ldms_heap_off(heap, p);
 	printf("------- %p: heap_free(%lx, %ld) -- start\n",
 			heap,
 			ldms_heap_off(heap, d),
@@ -341,45 +486,10 @@ void ldms_heap_free(ldms_heap_t heap, void *d)
 	rrbt_verify(heap->addr_tree);
 	rrbt_print(heap->addr_tree);
 #endif /* LDMS_HEAP_DEBUG */
-	rrbn_init(RRBN(p->size_node), &count, sizeof(count));
-	rrbn_init(RRBN(p->addr_node), &offset, sizeof(offset));
-
-	/* See if we can coalesce with our lesser sibling */
-	rbn = rrbt_find_glb(heap->addr_tree, &offset);
-	if (rbn) {
-		q = container_of(rbn, struct mm_free, addr_node);
-
-		/* See if q is contiguous with p */
-		end = q->addr_node.key_u64[0] + (q->size_node.key_u64[0] << heap->data->grain_bits);
-		if (end == p->addr_node.key_u64[0]) {
-			/* Remove the left sibling from the tree and coelesce */
-			rrbt_del(heap->size_tree, RRBN(q->size_node));
-			rrbt_del(heap->addr_tree, RRBN(q->addr_node));
-			q->size_node.key_u64[0] += p->size_node.key_u64[0];
-			p = q;
-		}
-	}
-	/* See if we can coalesce with our greater sibling */
-	offset = ldms_heap_off(heap, p);
-	rbn = rrbt_find_lub(heap->addr_tree, &offset);
-	if (rbn) {
-		q = container_of(rbn, struct mm_free, addr_node);
-
-		end = p->addr_node.key_u64[0] + (p->size_node.key_u64[0] << heap->data->grain_bits);
-		if (end == q->addr_node.key_u64[0]) {
-			/* Remove the right sibling from the tree and coelesce */
-			rrbt_del(heap->size_tree, RRBN(q->size_node));
-			rrbt_del(heap->addr_tree, RRBN(q->addr_node));
-			p->size_node.key_u64[0] += q->size_node.key_u64[0];
-		}
-	}
-	offset = ldms_heap_off(heap, p);
-	rrbn_init(RRBN(p->size_node), p->size_node.key_u64, sizeof(uint64_t));
-	rrbn_init(RRBN(p->addr_node), p->addr_node.key_u64, sizeof(uint64_t));
-
-	/* Put 'p' back in the trees */
-	rrbt_ins(heap->size_tree, RRBN(p->size_node));
-	rrbt_ins(heap->addr_tree, RRBN(p->addr_node));
+	if (count <= LDMS_HEAP_SLAB_CLASSES)
+		__slab_push(heap, (struct mm_slab *)p, count);
+	else
+		__heap_put(heap, p, count);
 
 	/* Modify generation nubmer */
 	heap->data->gn++;
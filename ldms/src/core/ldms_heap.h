@@ -60,16 +60,29 @@ typedef struct ldms_heap_info {
 	size_t free_bytes;	/*< number of unallocated grains current */
 	size_t largest;		/*< largest unallocated chunk size in grains */
 	size_t smallest;	/*< smallest unallocated chunk size in grains */
+	size_t slab_chunks;	/*< number of chunks held in the size-class lists */
+	size_t slab_bytes;	/*< number of bytes held in the size-class lists */
 } *ldms_heap_info_t;
 #define LDMS_HEAP_MIN_SIZE 512
 
+/*
+ * Allocations of up to LDMS_HEAP_SLAB_CLASSES grains are size-class
+ * allocations. When freed, they are kept in a per-class free list and
+ * are handed out again without touching the r-b trees.
+ */
+#define LDMS_HEAP_SLAB_CLASSES 8
+
 struct ldms_heap {
 	uint32_t grain_bits:8;
 	uint32_t grain:24;	/* Minimum allocation size and alignment */
+	uint32_t slab_chunks;	/* Chunks in the size-class lists */
 	uint64_t size;		/* Size of the heap in bytes */
 	uint32_t gn;            /* Changes when alloc and free  */
+	uint32_t slab_grains;	/* Grains in the size-class lists */
 	struct rrbt size_tree;	/* Tree ordered by size */
 	struct rrbt addr_tree;	/* Tree ordered by addr/offset */
+	/* Size-class free list heads, offsets from the heap base */
+	uint32_t slab[LDMS_HEAP_SLAB_CLASSES];
 };
 
 typedef struct ldms_heap_instance {
@@ -130,6 +143,12 @@ ldms_heap_t ldms_heap_get(ldms_heap_t h, struct ldms_heap *heap, void *base);
  * allocated will be aligned on the \c grain boundary specified in
  * \c ldms_heap_init().
  *
+ * Requests of up to \c LDMS_HEAP_SLAB_CLASSES grains are served from
+ * the size-class free lists when possible. An empty list is refilled
+ * by carving several chunks of the class at once. The size-class lists
+ * are returned to the heap when a request cannot otherwise be
+ * satisfied.
+ *
  * \param  heap	The heap instance handle.
  * \param  size	The requested buffer size in bytes.
  *
@@ -0,0 +1,198 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <regex.h>
+#include "ldms.h"
+
+#define ERE_META "().[]*+?{}|^$\\"
+#define BRE_META ".[]*^$\\"
+
+/*
+ * Returns the length of the literal character token at \c p stored in
+ * \c *c, or 0 if \c p does not start with a literal character.
+ */
+static int lit_token(const char *p, int ere, char *c)
+{
+	const char *meta = ere ? ERE_META : BRE_META;
+
+	if (!*p)
+		return 0;
+	if (*p == '\\') {
+		if (!p[1] || !strchr(meta, p[1]))
+			return 0;	/* \w, \<, \{, ... */
+		*c = p[1];
+		return 2;
+	}
+	if (strchr(meta, *p))
+		return 0;
+	*c = *p;
+	return 1;
+}
+
+/*
+ * Returns 1 if \c p starts with a quantifier that lets the preceding
+ * token be absent, 2 if the token is required but may repeat, and 0
+ * otherwise.
+ */
+static int quantifier(const char *p, int ere)
+{
+	if (*p == '*')
+		return 1;
+	if (ere) {
+		if (*p == '?' || *p == '{')
+			return 1;
+		if (*p == '+')
+			return 2;
+		return 0;
+	}
+	if (p[0] == '\\' && (p[1] == '?' || p[1] == '{'))
+		return 1;
+	if (p[0] == '\\' && p[1] == '+')
+		return 2;
+	return 0;
+}
+
+static void re_analyze(ldms_name_re_t re, const char *expr, int cflags)
+{
+	int ere = (cflags & REG_EXTENDED);
+	int anchored, len, q;
+	const char *p = expr;
+	char c;
+
+	re->type = LDMS_NAME_RE_REGEX;
+	re->lit_len = re->prefix_len = 0;
+	if (cflags & REG_ICASE)
+		return;
+	if (strstr(expr, ere ? "|" : "\\|"))
+		return;		/* alternation */
+
+	anchored = (*p == '^');
+	if (anchored) {
+		p++;
+	} else {
+		while (0 == strncmp(p, ".*", 2))
+			p += 2;
+	}
+	while ((len = lit_token(p, ere, &c))) {
+		q = quantifier(p + len, ere);
+		if (q == 1)
+			break;
+		re->lit[re->lit_len++] = c;
+		p += len;
+		if (q == 2)
+			break;
+	}
+	re->lit[re->lit_len] = '\0';
+
+	if (!*p || 0 == strcmp(p, ".*") || 0 == strcmp(p, ".*$")) {
+		if (!re->lit_len)
+			re->type = LDMS_NAME_RE_ALL;
+		else if (anchored)
+			re->type = LDMS_NAME_RE_PREFIX;
+		else
+			re->type = LDMS_NAME_RE_SUBSTR;
+	} else if (anchored && 0 == strcmp(p, "$")) {
+		re->type = LDMS_NAME_RE_EXACT;
+	}
+	if (anchored)
+		re->prefix_len = re->lit_len;
+}
+
+int ldms_name_re_comp(ldms_name_re_t re, const char *expr, int cflags)
+{
+	int rc;
+
+	memset(re, 0, sizeof(*re));
+	rc = regcomp(&re->regex, expr, cflags);
+	if (rc)
+		return rc;
+	re->has_regex = 1;
+	re->lit = malloc(strlen(expr) + 1);
+	if (!re->lit)
+		return ENOMEM;
+	re_analyze(re, expr, cflags);
+	return 0;
+}
+
+int ldms_name_re_exact(ldms_name_re_t re, const char *name)
+{
+	memset(re, 0, sizeof(*re));
+	re->lit = strdup(name);
+	if (!re->lit)
+		return ENOMEM;
+	re->type = LDMS_NAME_RE_EXACT;
+	re->lit_len = re->prefix_len = strlen(name);
+	return 0;
+}
+
+int ldms_name_re_exec(ldms_name_re_t re, const char *name)
+{
+	switch (re->type) {
+	case LDMS_NAME_RE_ALL:
+		return 0;
+	case LDMS_NAME_RE_EXACT:
+		return strcmp(name, re->lit) ? REG_NOMATCH : 0;
+	case LDMS_NAME_RE_PREFIX:
+		return strncmp(name, re->lit, re->lit_len) ? REG_NOMATCH : 0;
+	case LDMS_NAME_RE_SUBSTR:
+		return strstr(name, re->lit) ? 0 : REG_NOMATCH;
+	case LDMS_NAME_RE_REGEX:
+		if (re->prefix_len &&
+		    strncmp(name, re->lit, re->prefix_len))
+			return REG_NOMATCH;
+		return regexec(&re->regex, name, 0, NULL, 0);
+	}
+	return REG_NOMATCH;
+}
+
+void ldms_name_re_free(ldms_name_re_t re)
+{
+	if (re->has_regex)
+		regfree(&re->regex);
+	free(re->lit);
+	memset(re, 0, sizeof(*re));
+}
@@ -55,6 +55,7 @@
 #include <openssl/sha.h>
 #include "ovis_util/os_util.h"
 #include "ovis_ref/ref.h"
+#include "coll/htbl.h"
 #include "ldms_heap.h"
 #include "ldms.h"
 
@@ -121,6 +122,10 @@ struct ldms_set_info_pair {
 	LIST_ENTRY(ldms_set_info_pair) entry;
 };
 LIST_HEAD(ldms_set_info_list, ldms_set_info_pair);
+struct ldms_set_schema_key {
+	const char *schema;
+	const char *name;
+};
 struct ldms_set {
 	struct ref_s ref;
 	unsigned long flags;
@@ -131,7 +136,10 @@ struct ldms_set {
 	struct ldms_set_info_list local_info;
 	struct ldms_set_info_list remote_info; /*set info from the lookup operation */
 	struct rbn rb_node;	/* Indexed by instance name */
-	struct rbn id_node;	/* Indexed by set_id */
+	struct rbn schema_node;	/* Indexed by schema and instance name */
+	struct ldms_set_schema_key schema_key;
+	struct hent name_ent;	/* Hash index by instance name */
+	struct hent id_ent;	/* Hash index by set_id */
 	struct rbn del_node;	/* Indexed by timestamp */
 	pthread_mutex_t lock;
 	int curr_idx;
@@ -149,8 +157,19 @@ struct ldms_set {
 	struct ldms_context *notify_ctxt; /* Notify req context */
 	ldms_heap_t heap;
 	struct ldms_heap_instance heap_inst;
+	uint64_t *dirty_gn; /* data gn of the last change of each data block */
+	uint64_t dir_gn; /* directory generation of the last add or update */
+	TAILQ_ENTRY(ldms_set) dir_entry; /* published sets in dir_gn order */
 };
 
+/*
+ * The data section of a local set with at least LDMS_DELTA_MIN_DATA_SZ
+ * bytes of metrics is tracked in blocks of 1 << LDMS_DELTA_BLK_SHIFT
+ * bytes so that updates can carry only the changed blocks.
+ */
+#define LDMS_DELTA_BLK_SHIFT 6
+#define LDMS_DELTA_MIN_DATA_SZ 4096
+
 /* Convenience macro to roundup a value to a multiple of the _s parameter */
 #define roundup(_v,_s) ((_v + (_s - 1)) & ~(_s - 1))
 
@@ -158,7 +177,8 @@ extern int __ldms_xprt_push(ldms_set_t s, int push_flags);
 extern int __ldms_remote_lookup(ldms_t _x, const char *path,
 				enum ldms_lookup_flags flags,
 				ldms_lookup_cb_t cb, void *cb_arg);
-extern int __ldms_remote_dir(ldms_t x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags);
+extern int __ldms_remote_dir(ldms_t x, ldms_dir_cache_t c,
+			     ldms_dir_cb_t cb, void *cb_arg, uint32_t flags);
 extern int __ldms_remote_dir_cancel(ldms_t x);
 extern struct ldms_set *
 __ldms_create_set(const char *instance_name, const char *schema_name,
@@ -168,6 +188,7 @@ __ldms_create_set(const char *instance_name, const char *schema_name,
 extern void __ldms_dir_add_set(struct ldms_set *set);
 extern void __ldms_dir_del_set(struct ldms_set *set);
 extern void __ldms_dir_upd_set(struct ldms_set *set);
+extern void __ldms_dir_unpub_set(struct ldms_set *set);
 extern int __ldms_delete_remote_set(ldms_t _x, ldms_set_t s);
 
 struct ldms_name_entry {
@@ -184,6 +205,8 @@ extern void __ldms_dir_update(ldms_set_t set, enum ldms_dir_type t);
 extern size_t __ldms_format_set_meta_as_json(struct ldms_set *set,
 					     int need_comma,
 					     char *buf, size_t buf_size);
+extern size_t __ldms_format_set_meta_as_bin(struct ldms_set *set,
+					    char *buf, size_t buf_size);
 extern int __ldms_for_all_sets(int (*cb)(struct ldms_set *, void *), void *arg);
 
 extern uint32_t __ldms_set_size_get(struct ldms_set *s);
@@ -192,8 +215,17 @@ extern void __ldms_metric_size_get(const char *name, const char *unit,
 				   uint32_t count, size_t *meta_sz, size_t *data_sz);
 
 extern struct ldms_set *__ldms_find_local_set(const char *path);
+extern struct ldms_set *__ldms_find_local_set_by_id(uint64_t id);
+extern ssize_t __ldms_set_delta_get(struct ldms_set *set, uint64_t gn,
+				    void *buf, size_t len);
 extern struct ldms_set *__ldms_local_set_first(void);
 extern struct ldms_set *__ldms_local_set_next(struct ldms_set *);
+extern struct ldms_set *__ldms_local_set_match_first(ldms_name_re_t re,
+						     int by_schema);
+extern struct ldms_set *__ldms_local_set_match_next(struct ldms_set *s,
+						    ldms_name_re_t re,
+						    int by_schema);
+extern uint64_t __ldms_set_tree_gn(void);
 
 extern int __ldms_remote_update(ldms_t t, ldms_set_t s, ldms_update_cb_t cb, void *arg);
 extern void __ldms_set_tree_lock();
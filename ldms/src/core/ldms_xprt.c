@@ -254,18 +254,48 @@ next:
 	return 0;
 }
 
+/*
+ * The context size classes: a bare context, as used by updates and
+ * lookup reads, and one followed by a request, as used by lookup and
+ * dir requests.
+ */
+static const size_t ctxt_pool_size[LDMS_CTXT_POOL_CLASSES] = {
+	sizeof(struct ldms_context),
+	sizeof(struct ldms_context) + sizeof(struct ldms_request),
+};
+
 /* Must be called with the xprt lock held */
 struct ldms_context *__ldms_alloc_ctxt(struct ldms_xprt *x, size_t sz,
 		ldms_context_type_t type, ...)
 {
 	va_list ap;
 	struct ldms_context *ctxt;
-	va_start(ap, type);
-	ctxt = calloc(1, sz);
-	if (!ctxt) {
-		x->log("%s(): Out of memory\n", __func__);
-		return ctxt;
+	int cls;
+
+	for (cls = 0; cls < LDMS_CTXT_POOL_CLASSES; cls++) {
+		if (sz <= ctxt_pool_size[cls])
+			break;
+	}
+	if (cls < LDMS_CTXT_POOL_CLASSES &&
+	    (ctxt = TAILQ_FIRST(&x->ctxt_pool[cls].list))) {
+		TAILQ_REMOVE(&x->ctxt_pool[cls].list, ctxt, link);
+		x->ctxt_pool[cls].count--;
+		memset(ctxt, 0, sz);
+		x->stats.ctxt_reuse++;
+	} else {
+		ctxt = calloc(1, cls < LDMS_CTXT_POOL_CLASSES ?
+				 ctxt_pool_size[cls] : sz);
+		if (!ctxt) {
+			x->log("%s(): Out of memory\n", __func__);
+			return ctxt;
+		}
 	}
+	if (cls < LDMS_CTXT_POOL_CLASSES &&
+	    ++x->ctxt_pool[cls].in_use > x->ctxt_pool[cls].peak)
+		x->ctxt_pool[cls].peak = x->ctxt_pool[cls].in_use;
+	x->stats.ctxt_alloc++;
+	va_start(ap, type);
+	ctxt->pool_class = cls;
 	ctxt->x = ldms_xprt_get(x);
 	(void)clock_gettime(CLOCK_REALTIME, &ctxt->start);
 #ifdef CTXT_DEBUG
@@ -313,6 +343,14 @@ struct ldms_context *__ldms_alloc_ctxt(struct ldms_xprt *x, size_t sz,
 		ctxt->set_delete.cb = va_arg(ap, ldms_set_delete_cb_t);
 		ctxt->set_delete.cb_arg = ctxt;
 		break;
+	case LDMS_CONTEXT_UPDATE_BATCH:
+		/* The set and cb_arg arrays follow the context */
+		ctxt->update_batch.cb = va_arg(ap, ldms_update_cb_t);
+		ctxt->update_batch.count = va_arg(ap, int);
+		ctxt->update_batch.s = (ldms_set_t *)(ctxt + 1);
+		ctxt->update_batch.cb_arg =
+			(void **)&ctxt->update_batch.s[ctxt->update_batch.count];
+		break;
 	case LDMS_CONTEXT_PUSH:
 	case LDMS_CONTEXT_DIR_CANCEL:
 	case LDMS_CONTEXT_SEND:
@@ -325,12 +363,15 @@ struct ldms_context *__ldms_alloc_ctxt(struct ldms_xprt *x, size_t sz,
 /* Must be called with the ldms xprt lock held */
 void __ldms_free_ctxt(struct ldms_xprt *x, struct ldms_context *ctxt)
 {
+	struct ldms_xprt *ctxt_x;
+	int i, cls;
 	int64_t dur_us;
 	struct timespec end;
 	ldms_stats_entry_t e = NULL;
 
 	(void)clock_gettime(CLOCK_REALTIME, &end);
 	dur_us = ldms_timespec_diff_us(&ctxt->start, &end);
+	ctxt_x = ctxt->x;
 
 	TAILQ_REMOVE(&x->ctxt_list, ctxt, link);
 	switch (ctxt->type) {
@@ -357,6 +398,14 @@ void __ldms_free_ctxt(struct ldms_xprt *x, struct ldms_context *ctxt)
 		if (ctxt->set_delete.s)
 			ref_put(&ctxt->set_delete.s->ref, "__ldms_alloc_ctxt");
 		break;
+	case LDMS_CONTEXT_UPDATE_BATCH:
+		e = &x->stats.ops[LDMS_XPRT_OP_UPDATE];
+		for (i = 0; i < ctxt->update_batch.count; i++) {
+			if (ctxt->update_batch.s[i])
+				ref_put(&ctxt->update_batch.s[i]->ref,
+					"__ldms_alloc_ctxt");
+		}
+		break;
 	case LDMS_CONTEXT_DIR:
 		break;
 	case LDMS_CONTEXT_SEND:
@@ -377,32 +426,47 @@ void __ldms_free_ctxt(struct ldms_xprt *x, struct ldms_context *ctxt)
 		e->count += 1;
 		e->mean_us /= e->count;
 	}
-	ldms_xprt_put(ctxt->x);
-	free(ctxt);
+	cls = ctxt->pool_class;
+	if (cls < LDMS_CTXT_POOL_CLASSES)
+		x->ctxt_pool[cls].in_use--;
+	if (cls < LDMS_CTXT_POOL_CLASSES &&
+	    x->ctxt_pool[cls].count < x->ctxt_pool[cls].peak &&
+	    x->ctxt_pool[cls].count < LDMS_CTXT_POOL_MAX) {
+		TAILQ_INSERT_HEAD(&x->ctxt_pool[cls].list, ctxt, link);
+		x->ctxt_pool[cls].count++;
+	} else {
+		free(ctxt);
+	}
+	ldms_xprt_put(ctxt_x);
 }
 
-static void send_dir_update(struct ldms_xprt *x,
-			    enum ldms_dir_type t,
-			    char *json, size_t json_sz)
+static void send_dir_update(struct ldms_xprt *x, struct ldms_set *set,
+			    uint32_t t,
+			    char *data, size_t data_len)
 {
 	size_t hdr_len;
 	size_t buf_len;
-	size_t json_data_len;
 	struct ldms_reply *reply = NULL;
 
 	if (!ldms_xprt_connected(x))
 		return;
-	assert(t != LDMS_DIR_LIST);
+	assert((t & ~LDMS_DIR_TYPE_F_BIN) != LDMS_DIR_LIST);
 
 	hdr_len = sizeof(struct ldms_reply_hdr)
 		+ sizeof(struct ldms_dir_reply);
-	json_data_len = strlen("{ \"directory\" : [  ]}") + strlen(json) + 1;
-	buf_len = hdr_len + json_data_len;
+	buf_len = hdr_len + data_len;
 
 	if (buf_len >= ldms_xprt_msg_max(x)) {
+		/*
+		 * The peer does not see this update until its next
+		 * directory request, which is not limited in size.
+		 */
 		if (x->log) {
-			x->log("Directory message is too large for "
-					"the max transport message.\n");
+			x->log("%s: the directory update of set '%s' "
+			       "(%zu bytes) is too large for the max transport "
+			       "message (%zu bytes), it is not sent.\n",
+			       __func__, get_instance_name(set->meta)->name,
+			       buf_len, ldms_xprt_msg_max(x));
 		}
 		return;
 	}
@@ -419,10 +483,9 @@ static void send_dir_update(struct ldms_xprt *x,
 	reply->hdr.rc = 0;
 	reply->dir.more = 0;
 	reply->dir.type = htonl(t);
-	reply->dir.json_data_len = htonl(json_data_len);
+	reply->dir.json_data_len = htonl(data_len);
 	reply->hdr.len = htonl(buf_len);
-	(void)snprintf(reply->dir.json_data, json_data_len,
-				"{ \"directory\" : [ %s ]}", json);
+	memcpy(reply->dir.json_data, data, data_len);
 
 #ifdef DEBUG
 	x->log("%s(): x %p: remote dir ctxt %p\n",
@@ -504,24 +567,177 @@ char *__ldms_format_set_for_dir(struct ldms_set *set, size_t *buf_sz)
 	return json_buf;
 }
 
+/*
+ * The directory generation. Every change to the set of published sets
+ * takes the next generation under the xprt_list_lock, which is held
+ * while the change is sent to the peers, so that they see the
+ * generations in order. The last DIR_DEL_LOG_MAX removals are kept so
+ * that a peer that has the directory at a generation since then can be
+ * sent only the changes. The published sets are kept in dir_set_list
+ * in the order of their last change, so these are found at its tail.
+ */
+#define DIR_DEL_LOG_MAX 4096
+struct dir_del_ent {
+	uint64_t gn;
+	uid_t uid;
+	gid_t gid;
+	uint32_t perm;
+	TAILQ_ENTRY(dir_del_ent) entry;
+	char name[OVIS_FLEX];
+};
+static TAILQ_HEAD(dir_del_ent_head, dir_del_ent) dir_del_log =
+		TAILQ_HEAD_INITIALIZER(dir_del_log);
+static int dir_del_count;
+static TAILQ_HEAD(dir_set_head, ldms_set) dir_set_list =
+		TAILQ_HEAD_INITIALIZER(dir_set_list);
+static int dir_set_count;
+static uint64_t dir_id;		/* Identifies this directory instance */
+static uint64_t dir_gn;		/* The current generation */
+static uint64_t dir_trim_gn;	/* Generation of the newest removal dropped */
+
+/* Caller must hold the xprt_list_lock */
+static uint64_t __dir_id_get(void)
+{
+	struct timespec ts;
+	if (!dir_id) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		dir_id = ((uint64_t)ts.tv_sec << 32) ^ ts.tv_nsec ^
+			 ((uint64_t)getpid() << 20);
+		if (!dir_id)
+			dir_id = 1;
+	}
+	return dir_id;
+}
+
+/* Caller must hold the xprt_list_lock */
+static void __dir_set_unlink(struct ldms_set *set)
+{
+	if (!set->dir_entry.tqe_prev)
+		return;
+	TAILQ_REMOVE(&dir_set_list, set, dir_entry);
+	set->dir_entry.tqe_prev = NULL;
+	dir_set_count--;
+}
+
+/* Caller must hold the xprt_list_lock */
+static void __dir_set_touch(struct ldms_set *set)
+{
+	__dir_set_unlink(set);
+	set->dir_gn = ++dir_gn;
+	TAILQ_INSERT_TAIL(&dir_set_list, set, dir_entry);
+	dir_set_count++;
+}
+
+/* Caller must hold the xprt_list_lock */
+static void __dir_del_log(struct ldms_set *set)
+{
+	ldms_name_t name = get_instance_name(set->meta);
+	struct dir_del_ent *ent;
+
+	__dir_set_unlink(set);
+	ent = malloc(sizeof(*ent) + name->len);
+	if (!ent) {
+		/* Peers behind this generation get the whole directory */
+		dir_trim_gn = ++dir_gn;
+		return;
+	}
+	ent->gn = ++dir_gn;
+	ent->uid = __le32_to_cpu(set->meta->uid);
+	ent->gid = __le32_to_cpu(set->meta->gid);
+	ent->perm = __le32_to_cpu(set->meta->perm);
+	memcpy(ent->name, name->name, name->len);
+	TAILQ_INSERT_TAIL(&dir_del_log, ent, entry);
+	if (++dir_del_count > DIR_DEL_LOG_MAX) {
+		ent = TAILQ_FIRST(&dir_del_log);
+		TAILQ_REMOVE(&dir_del_log, ent, entry);
+		dir_trim_gn = ent->gn;
+		dir_del_count--;
+		free(ent);
+	}
+}
+
+/*
+ * Format the set as a binary directory update of generation gn. Returns
+ * the length of the update in *buf_sz.
+ */
+static char *__format_set_for_dir_bin(struct ldms_set *set, uint64_t gn,
+				      size_t *buf_sz)
+{
+	size_t hdr_len = offsetof(struct ldms_dir_bin_hdr, entries);
+	size_t buf_len = 1024;
+	struct ldms_dir_bin_hdr *hdr;
+	size_t cnt;
+
+	hdr = malloc(buf_len);
+	if (!hdr)
+		return NULL;
+	cnt = __ldms_format_set_meta_as_bin(set, hdr->entries,
+					    buf_len - hdr_len);
+	if (cnt > buf_len - hdr_len) {
+		free(hdr);
+		buf_len = hdr_len + cnt;
+		hdr = malloc(buf_len);
+		if (!hdr)
+			return NULL;
+		cnt = __ldms_format_set_meta_as_bin(set, hdr->entries, cnt);
+	}
+	hdr->dir_id = __cpu_to_le64(__dir_id_get());
+	hdr->dir_gn = __cpu_to_le64(gn);
+	hdr->count = __cpu_to_le32(1);
+	hdr->flags = 0;
+	*buf_sz = hdr_len + cnt;
+	return (char *)hdr;
+}
+
 static void dir_update(struct ldms_set *set, enum ldms_dir_type t)
 {
-	char *json_buf;
-	size_t json_cnt;
+	char *json_buf = NULL;
+	char *bin_buf = NULL;
+	size_t json_cnt, bin_cnt;
+	char *json;
 	struct ldms_xprt *x;
-	json_buf = __ldms_format_set_for_dir(set, &json_cnt);
+
 	pthread_mutex_lock(&xprt_list_lock);
+	if (set->flags & LDMS_SET_F_PUBLISHED)
+		__dir_set_touch(set);
+	else
+		set->dir_gn = ++dir_gn;
 	LIST_FOREACH(x, &xprt_list, xprt_link) {
+		if (!x->remote_dir_xid)
+			continue;
+		if (x->remote_dir_bin) {
+			if (!bin_buf)
+				bin_buf = __format_set_for_dir_bin(set,
+							set->dir_gn, &bin_cnt);
+			if (!bin_buf) {
+				x->log("%s: memory allocation error\n", __func__);
+				break;
+			}
+			send_dir_update(x, set, t | LDMS_DIR_TYPE_F_BIN,
+					bin_buf, bin_cnt);
+			continue;
+		}
+		if (!json_buf) {
+			json = __ldms_format_set_for_dir(set, &json_cnt);
+			if (json) {
+				json_cnt += sizeof("{ \"directory\" : [  ]}");
+				json_buf = malloc(json_cnt);
+				if (json_buf)
+					(void)snprintf(json_buf, json_cnt,
+						"{ \"directory\" : [ %s ]}",
+						json);
+				free(json);
+			}
+		}
 		if (!json_buf) {
 			x->log("%s: memory allocation error\n", __func__);
 			break;
 		}
-		if (x->remote_dir_xid)
-			send_dir_update(x, t, json_buf, json_cnt);
+		send_dir_update(x, set, t, json_buf, json_cnt);
 	}
 	pthread_mutex_unlock(&xprt_list_lock);
-	if (json_buf)
-		free(json_buf);
+	free(json_buf);
+	free(bin_buf);
 }
 
 void __ldms_dir_add_set(struct ldms_set *set)
@@ -558,6 +774,8 @@ void __ldms_dir_del_set(struct ldms_set *set)
 	 */
 	struct ldms_xprt *x;
 	pthread_mutex_lock(&xprt_list_lock);
+	if (set->dir_entry.tqe_prev)
+		__dir_del_log(set);
 	LIST_FOREACH(x, &xprt_list, xprt_link) {
 		if (x->remote_dir_xid)
 			ldms_xprt_set_delete(x, set, __set_delete_cb);
@@ -570,6 +788,14 @@ void __ldms_dir_upd_set(struct ldms_set *set)
 	dir_update(set, LDMS_DIR_UPD);
 }
 
+void __ldms_dir_unpub_set(struct ldms_set *set)
+{
+	/* Peers are not told, but incremental directory requests are */
+	pthread_mutex_lock(&xprt_list_lock);
+	__dir_del_log(set);
+	pthread_mutex_unlock(&xprt_list_lock);
+}
+
 void ldms_xprt_close(ldms_t x)
 {
 #ifdef DEBUG
@@ -635,7 +861,8 @@ void __ldms_xprt_resource_free(struct ldms_xprt *x)
 
 void ldms_xprt_put(ldms_t x)
 {
-	int remove = 0;
+	struct ldms_context *ctxt;
+	int remove = 0, i;
 	assert(x->ref_count);
 	if (0 == __sync_sub_and_fetch(&x->ref_count, 1)) {
 		remove = 1;
@@ -652,12 +879,19 @@ void ldms_xprt_put(ldms_t x)
 		return;
 
 	__ldms_xprt_resource_free(x);
+	for (i = 0; i < LDMS_CTXT_POOL_CLASSES; i++) {
+		while ((ctxt = TAILQ_FIRST(&x->ctxt_pool[i].list))) {
+			TAILQ_REMOVE(&x->ctxt_pool[i].list, ctxt, link);
+			free(ctxt);
+		}
+	}
 	sem_destroy(&x->sem);
 	if (x->app_ctxt && x->app_ctxt_free_fn)
 		x->app_ctxt_free_fn(x->app_ctxt);
 	free(x);
 }
 
+static void __dir_cache_set_delete(struct ldms_xprt *x, const char *name);
 static void process_set_delete_request(struct ldms_xprt *x, struct ldms_request *req)
 {
 	struct ldms_reply reply;
@@ -676,6 +910,7 @@ static void process_set_delete_request(struct ldms_xprt *x, struct ldms_request
 			goto reply_1;
 		}
 	}
+	__dir_cache_set_delete(x, req->set_delete.inst_name);
 	if (x->event_cb) {
 		struct ldms_xprt_event event;
 		event.type = LDMS_XPRT_EVENT_SET_DELETE;
@@ -719,6 +954,187 @@ struct make_dir_arg {
 	ssize_t set_list_len;	/* current length of this buffer */
 };
 
+static int __dir_bin_send(struct ldms_xprt *x, struct ldms_reply *reply,
+			  size_t cnt, int count, int more)
+{
+	size_t hdrlen = sizeof(struct ldms_reply_hdr)
+			+ sizeof(struct ldms_dir_reply);
+	struct ldms_dir_bin_hdr *bin = (void *)reply->dir.json_data;
+	zap_err_t zerr;
+
+	bin->count = __cpu_to_le32(count);
+	reply->hdr.len = htonl(cnt + hdrlen);
+	reply->dir.json_data_len = htonl(cnt);
+	reply->dir.more = htonl(more);
+	zerr = zap_send(x->zap_ep, reply, cnt + hdrlen);
+	if (zerr != ZAP_ERR_OK) {
+		x->zerrno = zerr;
+		x->log("%s: x %p: zap_send synchronous error. '%s'\n",
+		       __FUNCTION__, x, zap_err_str(zerr));
+		return zap_zerr2errno(zerr);
+	}
+	return 0;
+}
+
+/*
+ * Reply to a LDMS_DIR_F_BIN request. If the requester has this
+ * directory at a generation that is still in the removal log, only the
+ * sets removed or changed since then are sent.
+ */
+static int process_dir_request_bin(struct ldms_xprt *x,
+				   struct ldms_request *req)
+{
+	size_t bin_hdrlen = offsetof(struct ldms_dir_bin_hdr, entries);
+	size_t hdrlen = sizeof(struct ldms_reply_hdr)
+			+ sizeof(struct ldms_dir_reply);
+	size_t len, cnt, ent_len, max;
+	struct ldms_name_list del_list;
+	struct ldms_name_entry *del;
+	struct ldms_reply *reply;
+	struct ldms_dir_bin_hdr *bin;
+	struct ldms_dir_bin_entry *ent;
+	struct dir_del_ent *log;
+	struct ldms_set *set, **sets = NULL;
+	uint64_t id = 0, since = 0, gn;
+	int i, count, set_count, delta, rc = 0;
+
+	if (ntohl(req->hdr.len) >= sizeof(struct ldms_request_hdr)
+				   + sizeof(struct ldms_dir_cmd_param)) {
+		id = __le64_to_cpu(req->dir.dir_id);
+		since = __le64_to_cpu(req->dir.dir_gn);
+	}
+
+	/*
+	 * Collect the removals and the sets changed since the requester's
+	 * generation, or all sets if it is not known.
+	 */
+	LIST_INIT(&del_list);
+	pthread_mutex_lock(&xprt_list_lock);
+	gn = dir_gn;
+	delta = (id == __dir_id_get() && since >= dir_trim_gn && since <= gn);
+	if (delta) {
+		TAILQ_FOREACH_REVERSE(log, &dir_del_log,
+				      dir_del_ent_head, entry) {
+			if (log->gn <= since)
+				break;
+			if (ldms_access_check(x, LDMS_ACCESS_READ, log->uid,
+					      log->gid, log->perm))
+				continue;
+			len = strlen(log->name) + 1;
+			del = malloc(sizeof(*del) + len);
+			if (!del) {
+				rc = ENOMEM;
+				goto unlock;
+			}
+			memcpy(del->name, log->name, len);
+			LIST_INSERT_HEAD(&del_list, del, entry);
+		}
+		set_count = 0;
+		set = TAILQ_LAST(&dir_set_list, dir_set_head);
+		while (set && set->dir_gn > since) {
+			set_count++;
+			set = TAILQ_PREV(set, dir_set_head, dir_entry);
+		}
+		set = set ? TAILQ_NEXT(set, dir_entry)
+			  : TAILQ_FIRST(&dir_set_list);
+	} else {
+		set_count = dir_set_count;
+		set = TAILQ_FIRST(&dir_set_list);
+	}
+	if (set_count) {
+		sets = malloc(set_count * sizeof(*sets));
+		if (!sets) {
+			rc = ENOMEM;
+			goto unlock;
+		}
+	}
+	for (i = 0; i < set_count; i++) {
+		ref_get(&set->ref, "dir_request");
+		sets[i] = set;
+		set = TAILQ_NEXT(set, dir_entry);
+	}
+	id = __dir_id_get();
+ unlock:
+	pthread_mutex_unlock(&xprt_list_lock);
+	if (rc)
+		goto out;
+
+	len = ldms_xprt_msg_max(x);
+	reply = malloc(len);
+	if (!reply) {
+		rc = ENOMEM;
+		goto out;
+	}
+	max = len - hdrlen;
+	reply->hdr.xid = req->hdr.xid;
+	reply->hdr.cmd = htonl(LDMS_CMD_DIR_REPLY);
+	reply->hdr.rc = 0;
+	reply->dir.type = htonl(LDMS_DIR_LIST | LDMS_DIR_TYPE_F_BIN);
+	bin = (void *)reply->dir.json_data;
+	bin->dir_id = __cpu_to_le64(id);
+	bin->dir_gn = __cpu_to_le64(gn);
+	bin->flags = __cpu_to_le32(delta ? LDMS_DIR_BIN_F_DELTA : 0);
+	cnt = bin_hdrlen;
+	count = 0;
+
+	LIST_FOREACH(del, &del_list, entry) {
+		ent_len = roundup(offsetof(struct ldms_dir_bin_entry, str)
+				  + strlen(del->name) + 1, 8);
+		if (cnt + ent_len > max) {
+			rc = __dir_bin_send(x, reply, cnt, count, 1);
+			if (rc)
+				goto free_reply;
+			cnt = bin_hdrlen;
+			count = 0;
+		}
+		ent = (void *)&reply->dir.json_data[cnt];
+		memset(ent, 0, ent_len);
+		ent->len = __cpu_to_le32(ent_len);
+		ent->flags = __cpu_to_le32(LDMS_DIR_BIN_E_DEL);
+		strcpy(ent->str, del->name);
+		cnt += ent_len;
+		count++;
+	}
+
+	for (i = 0; i < set_count; i++) {
+		set = sets[i];
+		if (ldms_access_check(x, LDMS_ACCESS_READ,
+				      __le32_to_cpu(set->meta->uid),
+				      __le32_to_cpu(set->meta->gid),
+				      __le32_to_cpu(set->meta->perm)))
+			continue;
+		ent_len = __ldms_format_set_meta_as_bin(set,
+				&reply->dir.json_data[cnt], max - cnt);
+		if (cnt + ent_len > max && count) {
+			/* Send what we have and start a new message */
+			rc = __dir_bin_send(x, reply, cnt, count, 1);
+			if (rc)
+				goto free_reply;
+			cnt = bin_hdrlen;
+			count = 0;
+			ent_len = __ldms_format_set_meta_as_bin(set,
+					&reply->dir.json_data[cnt], max - cnt);
+		}
+		if (cnt + ent_len > max) {
+			x->log("%s: the directory entry of set '%s' is too "
+			       "large for the transport message\n", __func__,
+			       get_instance_name(set->meta)->name);
+		} else {
+			cnt += ent_len;
+			count++;
+		}
+	}
+	rc = __dir_bin_send(x, reply, cnt, count, 0);
+ free_reply:
+	free(reply);
+ out:
+	for (i = 0; sets && i < set_count; i++)
+		ref_put(&sets[i]->ref, "dir_request");
+	free(sets);
+	__ldms_empty_name_list(&del_list);
+	return rc;
+}
+
 static void process_dir_request(struct ldms_xprt *x, struct ldms_request *req)
 {
 	size_t len;
@@ -731,10 +1147,12 @@ static void process_dir_request(struct ldms_xprt *x, struct ldms_request *req)
 	ldms_stats_entry_t e = &x->stats.ops[LDMS_XPRT_OP_DIR_REP];
 	int64_t dur_us;
 	struct timespec end, start;
+	uint32_t flags = ntohl(req->dir.flags);
 
 	(void)clock_gettime(CLOCK_REALTIME, &start);
 
-	if (req->dir.flags)
+	x->remote_dir_bin = !!(flags & LDMS_DIR_F_BIN);
+	if (flags & LDMS_DIR_F_NOTIFY)
 		/* Register for directory updates */
 		x->remote_dir_xid = req->hdr.xid;
 	else
@@ -744,6 +1162,13 @@ static void process_dir_request(struct ldms_xprt *x, struct ldms_request *req)
 	hdrlen = sizeof(struct ldms_reply_hdr)
 		+ sizeof(struct ldms_dir_reply);
 
+	if (flags & LDMS_DIR_F_BIN) {
+		rc = process_dir_request_bin(x, req);
+		if (rc)
+			goto out;
+		goto stats;
+	}
+
 	__ldms_set_tree_lock();
 	rc = __ldms_get_local_set_list(&name_list);
 	__ldms_set_tree_unlock();
@@ -868,6 +1293,7 @@ static void process_dir_request(struct ldms_xprt *x, struct ldms_request *req)
 	}
 	free(reply);
 	__ldms_empty_name_list(&name_list);
+ stats:
 	(void)clock_gettime(CLOCK_REALTIME, &end);
 	dur_us = ldms_timespec_diff_us(&start, &end);
 	if (e->min_us > dur_us)
@@ -948,7 +1374,7 @@ process_req_notify_request(struct ldms_xprt *x, struct ldms_request *req)
 	struct rbn *rbn;
 	struct ldms_lookup_peer *np;
 	struct xprt_set_coll_entry *ent;
-	ldms_set_t set = __ldms_set_by_id(req->req_notify.set_id);
+	ldms_set_t set = __ldms_find_local_set_by_id(req->req_notify.set_id);
 	if (!set)
 		return;
 	/* enlist or update the peer */
@@ -960,7 +1386,7 @@ process_req_notify_request(struct ldms_xprt *x, struct ldms_request *req)
 		np->remote_notify_xid = req->hdr.xid;
 		np->notify_flags = ntohl(req->req_notify.flags);
 		pthread_mutex_unlock(&set->lock);
-		return;
+		goto out;
 	}
 	np = calloc(1, sizeof(*np));
 	if (!np) {
@@ -969,7 +1395,7 @@ process_req_notify_request(struct ldms_xprt *x, struct ldms_request *req)
 				__FILE__, __func__, __LINE__);
 		}
 		pthread_mutex_unlock(&set->lock);
-		return;
+		goto out;
 	}
 	rbn_init(&np->rbn, x);
 	np->xprt = ldms_xprt_get(x);
@@ -989,7 +1415,7 @@ process_req_notify_request(struct ldms_xprt *x, struct ldms_request *req)
 					__FILE__, __func__, __LINE__);
 			}
 			pthread_mutex_unlock(&x->lock);
-			return;
+			goto out;
 		}
 		rbn_init(&ent->rbn, set);
 		ent->set = set;
@@ -997,12 +1423,14 @@ process_req_notify_request(struct ldms_xprt *x, struct ldms_request *req)
 		rbt_ins(&x->set_coll, &ent->rbn);
 	}
 	pthread_mutex_unlock(&x->lock);
+ out:
+	ref_put(&set->ref, "__ldms_find_local_set");
 }
 
 static void
 process_cancel_notify_request(struct ldms_xprt *x, struct ldms_request *req)
 {
-	ldms_set_t set = __ldms_set_by_id(req->cancel_notify.set_id);
+	ldms_set_t set = __ldms_find_local_set_by_id(req->cancel_notify.set_id);
 	struct rbn *rbn;
 	struct ldms_lookup_peer *np;
 	if (!set)
@@ -1016,13 +1444,13 @@ process_cancel_notify_request(struct ldms_xprt *x, struct ldms_request *req)
 		np = NULL;
 	}
 	pthread_mutex_unlock(&set->lock);
+	ref_put(&set->ref, "__ldms_find_local_set");
 	if (np) {
 		ldms_xprt_put(np->xprt);
 		free(np);
 	}
 }
 
-extern struct ldms_set *__ldms_set_by_id(uint64_t id);
 static void
 process_cancel_push_request(struct ldms_xprt *x, struct ldms_request *req)
 {
@@ -1030,7 +1458,7 @@ process_cancel_push_request(struct ldms_xprt *x, struct ldms_request *req)
 	struct ldms_push_peer *pp;
 	struct ldms_reply reply;
 	size_t len;
-	ldms_set_t set = __ldms_set_by_id(req->cancel_push.set_id);
+	ldms_set_t set = __ldms_find_local_set_by_id(req->cancel_push.set_id);
 	if (!set)
 		return;
 	pthread_mutex_lock(&set->lock);
@@ -1042,6 +1470,7 @@ process_cancel_push_request(struct ldms_xprt *x, struct ldms_request *req)
 		pp = NULL;
 	}
 	pthread_mutex_unlock(&set->lock);
+	ref_put(&set->ref, "__ldms_find_local_set");
 	if (!pp)
 		return; /* nothing to do */
 	len = sizeof(struct ldms_reply_hdr) + sizeof(struct ldms_push_reply);
@@ -1313,32 +1742,116 @@ static int __send_lookup_reply(struct ldms_xprt *x, struct ldms_set *set,
 	return rc;
 }
 
-static int __re_match(struct ldms_set *set, regex_t *regex, const char *regex_str, int flags)
-{
-	ldms_name_t name;
-	int rc;
-
-	if (flags & LDMS_LOOKUP_BY_SCHEMA)
-		name = get_schema_name(set->meta);
-	else
-		name = get_instance_name(set->meta);
+/*
+ * Cache of the sets matched by recent lookups by schema or regular
+ * expression. Peers reconnecting to an aggregator tend to send the same
+ * lookups; while no set has been added or removed the matches are
+ * reused instead of walking the set tree again. The cache is protected
+ * by the set tree lock.
+ */
+#define LU_CACHE_SIZE 16
+struct lu_cache_ent {
+	char *path;
+	uint32_t flags;
+	struct ldms_name_re re;
+	uint64_t tree_gn;
+	uint64_t tick;
+	struct ldms_set **sets;
+	int count;
+	int alloc;
+};
+static struct lu_cache_ent __lu_cache[LU_CACHE_SIZE];
+static uint64_t __lu_cache_tick;
 
-	if (flags & LDMS_LOOKUP_RE)
-		rc = regexec(regex, name->name, 0, NULL, 0);
-	else
-		rc = strcmp(regex_str, name->name);
+static void __lu_cache_ent_clear(struct lu_cache_ent *ent)
+{
+	if (ent->path)
+		ldms_name_re_free(&ent->re);
+	free(ent->path);
+	free(ent->sets);
+	memset(ent, 0, sizeof(*ent));
+}
 
-	return (rc == 0);
+/* Caller must hold the set tree lock */
+static int __lu_cache_ent_fill(struct lu_cache_ent *ent)
+{
+	struct ldms_set *set, **sets;
+	int by_schema = (ent->flags & LDMS_LOOKUP_BY_SCHEMA);
+
+	ent->count = 0;
+	for (set = __ldms_local_set_match_first(&ent->re, by_schema); set;
+	     set = __ldms_local_set_match_next(set, &ent->re, by_schema)) {
+		if (ent->count == ent->alloc) {
+			sets = realloc(ent->sets, (ent->alloc + 64) * 2 *
+						  sizeof(*sets));
+			if (!sets)
+				return ENOMEM;
+			ent->sets = sets;
+			ent->alloc = (ent->alloc + 64) * 2;
+		}
+		ent->sets[ent->count++] = set;
+	}
+	ent->tree_gn = __ldms_set_tree_gn();
+	return 0;
 }
 
-static struct ldms_set *__next_re_match(struct ldms_set *set,
-					regex_t *regex, const char *regex_str, int flags)
+/*
+ * Returns the cache entry with the current matches of \c path, or
+ * NULL with \c *rc set. Caller must hold the set tree lock.
+ */
+static struct lu_cache_ent *__lu_cache_get(struct ldms_xprt *x,
+					   const char *path, uint32_t flags,
+					   int *rc)
 {
-	for (; set; set = __ldms_local_set_next(set)) {
-		if (__re_match(set, regex, regex_str, flags))
-			break;
+	struct lu_cache_ent *ent, *lru = &__lu_cache[0];
+	char errstr[512];
+	int i;
+
+	flags &= (LDMS_LOOKUP_BY_SCHEMA | LDMS_LOOKUP_RE);
+	for (i = 0; i < LU_CACHE_SIZE; i++) {
+		ent = &__lu_cache[i];
+		if (ent->path && ent->flags == flags &&
+		    0 == strcmp(ent->path, path))
+			goto found;
+		if (ent->tick < lru->tick)
+			lru = &__lu_cache[i];
+	}
+	ent = lru;
+	__lu_cache_ent_clear(ent);
+	if (flags & LDMS_LOOKUP_RE) {
+		*rc = ldms_name_re_comp(&ent->re, path,
+					REG_EXTENDED | REG_NOSUB);
+		if (*rc && *rc != ENOMEM) {
+			(void)regerror(*rc, &ent->re.regex,
+				       errstr, sizeof(errstr));
+			x->log(errstr);
+			*rc = EINVAL;
+		}
+	} else {
+		*rc = ldms_name_re_exact(&ent->re, path);
 	}
-	return set;
+	if (*rc) {
+		ldms_name_re_free(&ent->re);
+		return NULL;
+	}
+	ent->path = strdup(path);
+	if (!ent->path) {
+		ldms_name_re_free(&ent->re);
+		*rc = ENOMEM;
+		return NULL;
+	}
+	ent->flags = flags;
+	ent->tree_gn = __ldms_set_tree_gn() - 1;
+ found:
+	ent->tick = ++__lu_cache_tick;
+	if (ent->tree_gn != __ldms_set_tree_gn()) {
+		*rc = __lu_cache_ent_fill(ent);
+		if (*rc) {
+			__lu_cache_ent_clear(ent);
+			return NULL;
+		}
+	}
+	return ent;
 }
 
 int __xprt_set_access_check(struct ldms_xprt *x, struct ldms_set *set,
@@ -1352,22 +1865,13 @@ int __xprt_set_access_check(struct ldms_xprt *x, struct ldms_set *set,
 
 static void process_lookup_request_re(struct ldms_xprt *x, struct ldms_request *req, uint32_t flags)
 {
-	regex_t regex;
 	struct ldms_reply_hdr hdr;
-	struct ldms_set *set, *nxt_set;
-	int rc, more;
+	struct lu_cache_ent *ent;
+	struct ldms_set *set;
+	int i, rc, more;
 	int matched = 0;
 
-	if (flags & LDMS_LOOKUP_RE) {
-		rc = regcomp(&regex, req->lookup.path, REG_EXTENDED | REG_NOSUB);
-		if (rc) {
-			char errstr[512];
-			(void)regerror(rc, &regex, errstr, sizeof(errstr));
-			x->log(errstr);
-			rc = EINVAL;
-			goto err_0;
-		}
-	} else if (0 == (flags & LDMS_LOOKUP_BY_SCHEMA)) {
+	if (0 == (flags & (LDMS_LOOKUP_RE | LDMS_LOOKUP_BY_SCHEMA))) {
 		__ldms_set_tree_lock();
 		set = __ldms_find_local_set(req->lookup.path);
 		if (!set) {
@@ -1378,48 +1882,33 @@ static void process_lookup_request_re(struct ldms_xprt *x, struct ldms_request *
 		rc = __send_lookup_reply(x, set, req->hdr.xid, 0);
 		ref_put(&set->ref, "__ldms_find_local_set");
 		if (rc)
-			goto err_1;
+			goto err_0;
 		return;
 	}
 
-	/* Get the first match */
 	__ldms_set_tree_lock();
-	set = __ldms_local_set_first();
-	set = __next_re_match(set, &regex, req->lookup.path, flags);
-	if (!set) {
-		rc = ENOENT;
+	ent = __lu_cache_get(x, req->lookup.path, flags, &rc);
+	if (!ent)
 		goto err_1;
-	}
-	while (set) {
-		/* Get the next match if any */
-		nxt_set = __next_re_match(__ldms_local_set_next(set),
-					  &regex, req->lookup.path, flags);
+	for (i = 0; i < ent->count; i++) {
+		set = ent->sets[i];
 		rc = __xprt_set_access_check(x, set, LDMS_ACCESS_READ);
 		if (rc)
-			goto skip;
-		if (nxt_set)
-			more = 1;
-		else
-			more = 0;
+			continue;
+		more = (i + 1 < ent->count);
 		rc = __send_lookup_reply(x, set, req->hdr.xid, more);
 		if (rc)
 			goto err_1;
 		matched = 1;
-	skip:
-		set = nxt_set;
 	}
 	__ldms_set_tree_unlock();
 	if (!matched) {
 		rc = ENOENT;
-		goto err_1;
+		goto err_0;
 	}
-	if (flags & LDMS_LOOKUP_RE)
-		regfree(&regex);
 	return;
  err_1:
 	__ldms_set_tree_unlock();
-	if (flags & LDMS_LOOKUP_RE)
-		regfree(&regex);
  err_0:
 	hdr.rc = htonl(rc);
 	hdr.xid = req->hdr.xid;
@@ -1590,54 +2079,338 @@ int __ldms_remote_update(ldms_t x, ldms_set_t s, ldms_update_cb_t cb, void *arg)
 	return rc;
 }
 
-static
-int ldms_xprt_recv_request(struct ldms_xprt *x, struct ldms_request *req)
+static int __send_update_batch(struct ldms_xprt *x, ldms_set_t *sets,
+			       void **cb_args, int count, ldms_update_cb_t cb,
+			       int flags)
 {
-	int cmd = ntohl(req->hdr.cmd);
-	int rc;
+	struct ldms_context *ctxt;
+	struct ldms_request *req;
+	size_t len;
+	zap_err_t zerr;
+	int i;
 
-	switch (cmd) {
-	case LDMS_CMD_LOOKUP:
-		process_lookup_request(x, req);
-		break;
-	case LDMS_CMD_DIR:
-		process_dir_request(x, req);
-		break;
-	case LDMS_CMD_DIR_CANCEL:
-		process_dir_cancel_request(x, req);
-		break;
-	case LDMS_CMD_REQ_NOTIFY:
-		process_req_notify_request(x, req);
-		break;
-	case LDMS_CMD_CANCEL_NOTIFY:
-		process_cancel_notify_request(x, req);
-		break;
-	case LDMS_CMD_CANCEL_PUSH:
-		process_cancel_push_request(x, req);
-		break;
-	case LDMS_CMD_SEND_MSG:
-		process_send_request(x, req);
-		break;
-	case LDMS_CMD_AUTH_MSG:
-		/* auth message */
-		rc = process_auth_msg(x, req);
-		if (rc) {
-			x->auth_flag = LDMS_XPRT_AUTH_FAILED;
-			__sync_fetch_and_add(&xprt_auth_fail_count, 1);
-			__ldms_xprt_term(x);
-		}
-		break;
-	case LDMS_CMD_SET_DELETE:
-		process_set_delete_request(x, req);
-		break;
-	default:
-		x->log("Unrecognized request %d\n", cmd);
-		assert(0 == "Unrecognized LDMS_CMD request type");
+	len = sizeof(struct ldms_request_hdr)
+		+ sizeof(struct ldms_update_batch_cmd_param)
+		+ count * sizeof(struct ldms_update_batch_set);
+	pthread_mutex_lock(&x->lock);
+	ctxt = __ldms_alloc_ctxt(x, sizeof(*ctxt)
+				 + count * (sizeof(ldms_set_t) + sizeof(void *))
+				 + len, LDMS_CONTEXT_UPDATE_BATCH, cb, count);
+	if (!ctxt) {
+		pthread_mutex_unlock(&x->lock);
+		return ENOMEM;
 	}
-	return 0;
-}
+	req = (void *)&ctxt->update_batch.cb_arg[count];
+	req->hdr.xid = (uint64_t)(unsigned long)ctxt;
+	req->hdr.cmd = htonl(LDMS_CMD_UPDATE_BATCH);
+	req->hdr.len = htonl(len);
+	req->update_batch.count = htonl(count);
+	req->update_batch.flags = htonl(flags);
+	for (i = 0; i < count; i++) {
+		ctxt->update_batch.s[i] = sets[i];
+		ref_get(&sets[i]->ref, "__ldms_alloc_ctxt");
+		ctxt->update_batch.cb_arg[i] = cb_args ? cb_args[i] : NULL;
+		req->update_batch.set[i].set_id = sets[i]->remote_set_id;
+		req->update_batch.set[i].gn =
+			(flags & LDMS_UPDATE_BATCH_F_DELTA) ? sets[i]->data->gn : 0;
+	}
+	pthread_mutex_unlock(&x->lock);
 
-static
+	zerr = zap_send(x->zap_ep, req, len);
+	if (zerr) {
+		x->zerrno = zerr;
+		pthread_mutex_lock(&x->lock);
+		__ldms_free_ctxt(x, ctxt);
+		pthread_mutex_unlock(&x->lock);
+	}
+	return zap_zerr2errno(zerr);
+}
+
+int ldms_xprt_update_batch(ldms_t x, ldms_set_t *sets, void **cb_args,
+			   int count, ldms_update_cb_t cb, int flags)
+{
+	ldms_set_t *batch;
+	void **batch_args;
+	ldms_set_t s;
+	int i, j, k, n, max_sets, rc;
+	int peer_batch;
+
+	if (!cb || !sets || count <= 0)
+		return EINVAL;
+	if (!ldms_xprt_connected(x))
+		return ENOTCONN;
+	if (LDMS_XPRT_AUTH_GUARD(x))
+		return EPERM;
+	/* Peers that predate LDMS_CMD_UPDATE_BATCH would abort on it */
+	peer_batch = !!(x->peer_features & LDMS_CONN_F_UPDATE_BATCH);
+	for (i = 0; i < count; i++) {
+		s = sets[i];
+		if (!s || s->xprt != x || !(s->flags & LDMS_SET_F_REMOTE) ||
+		    !s->lmap || !s->rmap || 0 == s->meta->array_card)
+			return EINVAL;
+	}
+	max_sets = (x->max_msg - sizeof(struct ldms_request_hdr)
+			- sizeof(struct ldms_update_batch_cmd_param))
+			/ sizeof(struct ldms_update_batch_set);
+	batch = malloc(count * (sizeof(*batch) + sizeof(*batch_args)));
+	if (!batch)
+		return ENOMEM;
+	batch_args = (void **)&batch[count];
+
+	ldms_xprt_get(x);
+	n = 0;
+	for (i = 0; i < count; i++) {
+		s = sets[i];
+		if (!peer_batch ||
+		    __le32_to_cpu(s->meta->array_card) != 1 ||
+		    0 == s->meta->meta_gn ||
+		    s->meta->meta_gn != s->data->meta_gn) {
+			/*
+			 * Set arrays, sets with stale metadata and all sets
+			 * of a peer without batch updates are read with RDMA.
+			 */
+			pthread_mutex_lock(&x->lock);
+			rc = __ldms_remote_update(x, s, cb,
+						  cb_args ? cb_args[i] : NULL);
+			pthread_mutex_unlock(&x->lock);
+			if (rc)
+				cb(x, s, LDMS_UPD_ERROR(rc),
+				   cb_args ? cb_args[i] : NULL);
+			continue;
+		}
+		batch[n] = s;
+		batch_args[n] = cb_args ? cb_args[i] : NULL;
+		n++;
+	}
+	for (i = 0; i < n; i += j) {
+		j = (n - i < max_sets) ? (n - i) : max_sets;
+		rc = __send_update_batch(x, &batch[i], &batch_args[i], j, cb,
+				(flags & LDMS_XPRT_UPDATE_F_DELTA) ?
+				LDMS_UPDATE_BATCH_F_DELTA : 0);
+		if (!rc)
+			continue;
+		for (k = i; k < i + j; k++)
+			cb(x, batch[k], LDMS_UPD_ERROR(rc), batch_args[k]);
+	}
+	ldms_xprt_put(x);
+	free(batch);
+	return 0;
+}
+
+static zap_err_t __update_batch_flush(struct ldms_xprt *x,
+				      struct ldms_reply *reply,
+				      size_t len, uint32_t count)
+{
+	reply->hdr.len = htonl(len);
+	reply->update_batch.more = htonl(1);
+	reply->update_batch.count = htonl(count);
+	return zap_send(x->zap_ep, reply, len);
+}
+
+/*
+ * Reply the current data section of each set in the request, or only
+ * the changed ranges if the requester asked for a delta and it is less
+ * than half of the data. The entries are packed into as many replies
+ * as needed, all but the last one have \c more set.
+ */
+static void process_update_batch_request(struct ldms_xprt *x,
+					 struct ldms_request *req)
+{
+	struct ldms_reply_hdr hdr;
+	struct ldms_reply *reply;
+	struct ldms_update_batch_entry *ent;
+	struct ldms_set *set;
+	size_t max_len, hdr_len, len, ent_len, lim, room;
+	uint32_t i, count, data_len, ecount, flags, delta;
+	uint64_t gn;
+	ssize_t dlen;
+	zap_err_t zerr;
+	int rc;
+
+	hdr_len = sizeof(struct ldms_reply_hdr)
+		+ sizeof(struct ldms_update_batch_reply);
+	count = ntohl(req->update_batch.count);
+	flags = ntohl(req->update_batch.flags);
+	len = sizeof(struct ldms_request_hdr)
+		+ sizeof(struct ldms_update_batch_cmd_param);
+	if (ntohl(req->hdr.len) < len ||
+	    count > (ntohl(req->hdr.len) - len) /
+			sizeof(struct ldms_update_batch_set)) {
+		rc = EINVAL;
+		goto err_0;
+	}
+	max_len = x->max_msg;
+	reply = malloc(max_len);
+	if (!reply) {
+		rc = ENOMEM;
+		goto err_0;
+	}
+	reply->hdr.xid = req->hdr.xid;
+	reply->hdr.cmd = htonl(LDMS_CMD_UPDATE_BATCH_REPLY);
+	reply->hdr.rc = 0;
+	len = hdr_len;
+	ecount = 0;
+	for (i = 0; i < count; i++) {
+		data_len = 0;
+		delta = 0;
+		set = __ldms_find_local_set_by_id(req->update_batch.set[i].set_id);
+		if (!set) {
+			rc = ENOENT;
+			goto entry;
+		}
+		rc = __xprt_set_access_check(x, set, LDMS_ACCESS_READ);
+		if (rc)
+			goto entry;
+		data_len = __le32_to_cpu(set->meta->data_sz);
+		gn = __le64_to_cpu(req->update_batch.set[i].gn);
+		if ((flags & LDMS_UPDATE_BATCH_F_DELTA) && set->dirty_gn && gn) {
+			/* Try the room left in this reply, then a new one */
+			lim = data_len / 2;
+			room = (len + sizeof(*ent) < max_len) ?
+				max_len - len - sizeof(*ent) : 0;
+			ent = (void *)reply + len;
+			dlen = __ldms_set_delta_get(set, gn, ent->data,
+						    lim < room ? lim : room);
+			if (dlen < 0 && len > hdr_len && lim > room) {
+				zerr = __update_batch_flush(x, reply, len, ecount);
+				if (zerr != ZAP_ERR_OK) {
+					ref_put(&set->ref,
+						"__ldms_find_local_set");
+					goto err_1;
+				}
+				len = hdr_len;
+				ecount = 0;
+				room = (len + sizeof(*ent) < max_len) ?
+				max_len - len - sizeof(*ent) : 0;
+				ent = (void *)reply + len;
+				dlen = __ldms_set_delta_get(set, gn, ent->data,
+						lim < room ? lim : room);
+			}
+			if (dlen >= 0) {
+				delta = 1;
+				data_len = dlen;
+				goto entry;
+			}
+		}
+		if (hdr_len + sizeof(*ent) + data_len > max_len) {
+			/* The peer shall fall back to the RDMA read */
+			rc = E2BIG;
+			data_len = 0;
+		}
+	entry:
+		ent_len = roundup(sizeof(*ent) + data_len, 8);
+		if (!delta && len + ent_len > max_len) {
+			zerr = __update_batch_flush(x, reply, len, ecount);
+			if (zerr != ZAP_ERR_OK) {
+				if (set)
+					ref_put(&set->ref,
+						"__ldms_find_local_set");
+				goto err_1;
+			}
+			len = hdr_len;
+			ecount = 0;
+		}
+		ent = (void *)reply + len;
+		ent->idx = htonl(i);
+		ent->rc = htonl(rc);
+		ent->data_len = htonl(data_len);
+		if (delta) {
+			ent->flags = htonl(LDMS_UPDATE_BATCH_E_DELTA);
+			ent->base_gn = req->update_batch.set[i].gn;
+		} else {
+			ent->flags = 0;
+			ent->base_gn = 0;
+			if (data_len)
+				memcpy(ent->data, set->data, data_len);
+		}
+		len += ent_len;
+		ecount++;
+		if (set)
+			ref_put(&set->ref, "__ldms_find_local_set");
+	}
+	reply->hdr.len = htonl(len);
+	reply->update_batch.more = 0;
+	reply->update_batch.count = htonl(ecount);
+	zerr = zap_send(x->zap_ep, reply, len);
+	if (zerr != ZAP_ERR_OK)
+		goto err_1;
+	free(reply);
+	return;
+
+ err_1:
+	free(reply);
+	x->zerrno = zerr;
+	x->log("%s: x %p: zap_send synchronously failed with '%s'\n",
+		__func__, x, zap_err_str(zerr));
+	ldms_xprt_close(x);
+	return;
+
+ err_0:
+	hdr.rc = htonl(rc);
+	hdr.xid = req->hdr.xid;
+	hdr.cmd = htonl(LDMS_CMD_UPDATE_BATCH_REPLY);
+	hdr.len = htonl(sizeof(struct ldms_reply_hdr));
+	zerr = zap_send(x->zap_ep, &hdr, sizeof(hdr));
+	if (zerr != ZAP_ERR_OK) {
+		x->zerrno = zerr;
+		x->log("%s: x %p: zap_send synchronously failed with '%s' "
+			"while trying to send local error code %d (%s)\n",
+			__func__, x, zap_err_str(zerr), rc, STRERROR(rc));
+		ldms_xprt_close(x);
+	}
+}
+
+static
+int ldms_xprt_recv_request(struct ldms_xprt *x, struct ldms_request *req)
+{
+	int cmd = ntohl(req->hdr.cmd);
+	int rc;
+
+	switch (cmd) {
+	case LDMS_CMD_LOOKUP:
+		process_lookup_request(x, req);
+		break;
+	case LDMS_CMD_DIR:
+		process_dir_request(x, req);
+		break;
+	case LDMS_CMD_DIR_CANCEL:
+		process_dir_cancel_request(x, req);
+		break;
+	case LDMS_CMD_REQ_NOTIFY:
+		process_req_notify_request(x, req);
+		break;
+	case LDMS_CMD_CANCEL_NOTIFY:
+		process_cancel_notify_request(x, req);
+		break;
+	case LDMS_CMD_CANCEL_PUSH:
+		process_cancel_push_request(x, req);
+		break;
+	case LDMS_CMD_SEND_MSG:
+		process_send_request(x, req);
+		break;
+	case LDMS_CMD_AUTH_MSG:
+		/* auth message */
+		rc = process_auth_msg(x, req);
+		if (rc) {
+			x->auth_flag = LDMS_XPRT_AUTH_FAILED;
+			__sync_fetch_and_add(&xprt_auth_fail_count, 1);
+			__ldms_xprt_term(x);
+		}
+		break;
+	case LDMS_CMD_SET_DELETE:
+		process_set_delete_request(x, req);
+		break;
+	case LDMS_CMD_UPDATE_BATCH:
+		process_update_batch_request(x, req);
+		break;
+	default:
+		x->log("Unrecognized request %d\n", cmd);
+		assert(0 == "Unrecognized LDMS_CMD request type");
+	}
+	return 0;
+}
+
+static
 void process_lookup_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 			  struct ldms_context *ctxt)
 {
@@ -1682,71 +2455,496 @@ void process_dir_cancel_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 }
 
 static int __process_dir_set_info(struct ldms_set *lset, enum ldms_dir_type type,
-				ldms_dir_set_t dset, json_entity_t info_list)
+				ldms_dir_set_t dset)
 {
-	json_entity_t info_entity, k, v;
-	int j, rc = 0  ;
+	int j, rc = 0;
 	int dir_upd = 0;
 	struct ldms_set_info_pair *pair, *nxt_pair;
 
-	if (lset)
-		pthread_mutex_lock(&lset->lock);
-	for (j = 0, info_entity = json_item_first(info_list); info_entity;
-	     info_entity = json_item_next(info_entity), j++) {
-		k = json_value_find(info_entity, "key");
-		v = json_value_find(info_entity, "value");
-		char *nkey = strdup(json_value_str(k)->str);
-		char *nvalue = strdup(json_value_str(v)->str);
-		if (!nkey || !nvalue) {
-			free(nkey);
-			free(nvalue);
-			rc = ENOMEM;
+	pthread_mutex_lock(&lset->lock);
+	for (j = 0; j < dset->info_count; j++) {
+		rc = __ldms_set_info_set(&lset->remote_info, dset->info[j].key,
+					 dset->info[j].value);
+		if (rc > 0)
 			goto out;
-		}
-		dset->info[j].key = nkey;
-		dset->info[j].value = nvalue;
-
-		if (lset) {
-			const char *key = dset->info[j].key;
-			const char *val = dset->info[j].value;
-			rc = __ldms_set_info_set(&lset->remote_info, key, val);
-			if (rc > 0)
-				goto out;
-			else if (rc == 0)
-				dir_upd = 1;
-			else
-				rc = 0; /* no change */
-		}
+		else if (rc == 0)
+			dir_upd = 1;
+		else
+			rc = 0; /* no change */
 	}
-	if (!lset)
-		return 0;
 
 	pair = LIST_FIRST(&lset->remote_info);
 	while (pair) {
 		nxt_pair = LIST_NEXT(pair, entry);
-		for (j = 0, info_entity = json_item_first(info_list); info_entity;
-				info_entity = json_item_next(info_entity)) {
-			k = json_value_find(info_entity, "key");
-			if (0 == strcmp(pair->key, json_value_str(k)->str))
+		for (j = 0; j < dset->info_count; j++) {
+			if (0 == strcmp(pair->key, dset->info[j].key))
 				break;
 		}
-		if (!info_entity) {
+		if (j == dset->info_count) {
 			__ldms_set_info_unset(pair);
 			dir_upd = 1;
 		}
 		pair = nxt_pair;
 	}
 out:
+	pthread_mutex_unlock(&lset->lock);
+	if (!rc) {
+		if ((type == LDMS_DIR_UPD) && dir_upd &&
+				(lset->flags & LDMS_SET_F_PUBLISHED)) {
+			__ldms_dir_upd_set(lset);
+		}
+	}
+	return rc;
+}
+
+/* If this set is in our local set tree, update it's set info */
+static int __dir_set_info_update(enum ldms_dir_type type, ldms_dir_set_t dset)
+{
+	struct ldms_set *lset;
+	int rc = 0;
+
+	__ldms_set_tree_lock();
+	lset = __ldms_find_local_set(dset->inst_name);
 	if (lset) {
-		pthread_mutex_unlock(&lset->lock);
-		if (!rc) {
-			if ((type == LDMS_DIR_UPD) && dir_upd &&
-					(lset->flags & LDMS_SET_F_PUBLISHED)) {
-				__ldms_dir_upd_set(lset);
+		rc = __process_dir_set_info(lset, type, dset);
+		ref_put(&lset->ref, "__ldms_find_local_set");
+	}
+	__ldms_set_tree_unlock();
+	return rc;
+}
+
+static void __dir_set_free(ldms_dir_set_t dset)
+{
+	int j;
+
+	free(dset->inst_name);
+	free(dset->schema_name);
+	free(dset->flags);
+	free(dset->digest_str);
+	free(dset->perm);
+	if (dset->info) {
+		for (j = 0; j < dset->info_count; j++) {
+			free(dset->info[j].key);
+			free(dset->info[j].value);
+		}
+		free(dset->info);
+	}
+	memset(dset, 0, sizeof(*dset));
+}
+
+static int __dir_set_copy(ldms_dir_set_t dst, ldms_dir_set_t src)
+{
+	int j;
+
+	*dst = *src;
+	dst->inst_name = strdup(src->inst_name);
+	dst->schema_name = strdup(src->schema_name);
+	dst->digest_str = strdup(src->digest_str);
+	dst->flags = strdup(src->flags);
+	dst->perm = strdup(src->perm);
+	dst->info = NULL;
+	dst->info_count = 0;
+	if (!dst->inst_name || !dst->schema_name || !dst->digest_str ||
+	    !dst->flags || !dst->perm)
+		goto err;
+	if (!src->info_count)
+		return 0;
+	dst->info = calloc(src->info_count, sizeof(*dst->info));
+	if (!dst->info)
+		goto err;
+	dst->info_count = src->info_count;
+	for (j = 0; j < src->info_count; j++) {
+		dst->info[j].key = strdup(src->info[j].key);
+		dst->info[j].value = strdup(src->info[j].value);
+		if (!dst->info[j].key || !dst->info[j].value)
+			goto err;
+	}
+	return 0;
+ err:
+	__dir_set_free(dst);
+	return ENOMEM;
+}
+
+/*
+ * The directory of a peer kept by ldms_xprt_dir_cached(). The entries
+ * have the epoch of the request that last changed them, so that the
+ * ones that are not in a whole directory reply can be dropped.
+ */
+struct dir_cache_ent {
+	uint64_t epoch;
+	struct rbn rbn;
+	struct ldms_dir_set_s dset;
+};
+
+struct ldms_dir_cache_s {
+	pthread_mutex_t lock;
+	uint64_t dir_id;	/* The peer directory instance, 0 if none */
+	uint64_t dir_gn;	/* The generation of the peer directory */
+	uint64_t epoch;		/* Incremented by every request */
+	int count;
+	struct rbt tree;	/* dir_cache_ent by instance name */
+};
+
+static int dir_cache_cmp(void *a, const void *b)
+{
+	return strcmp(a, b);
+}
+
+ldms_dir_cache_t ldms_dir_cache_new(void)
+{
+	ldms_dir_cache_t c = calloc(1, sizeof(*c));
+	if (!c) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	pthread_mutex_init(&c->lock, NULL);
+	rbt_init(&c->tree, dir_cache_cmp);
+	return c;
+}
+
+/* Caller must hold c->lock */
+static void __dir_cache_remove(ldms_dir_cache_t c, const char *name)
+{
+	struct dir_cache_ent *ent;
+	struct rbn *rbn = rbt_find(&c->tree, name);
+	if (!rbn)
+		return;
+	ent = container_of(rbn, struct dir_cache_ent, rbn);
+	rbt_del(&c->tree, rbn);
+	c->count--;
+	__dir_set_free(&ent->dset);
+	free(ent);
+}
+
+/* Caller must hold c->lock */
+static void __dir_cache_clear(ldms_dir_cache_t c)
+{
+	struct dir_cache_ent *ent;
+	struct rbn *rbn;
+	while ((rbn = rbt_min(&c->tree))) {
+		ent = container_of(rbn, struct dir_cache_ent, rbn);
+		__dir_cache_remove(c, ent->dset.inst_name);
+	}
+	c->dir_id = 0;
+	c->dir_gn = 0;
+}
+
+void ldms_dir_cache_free(ldms_dir_cache_t c)
+{
+	if (!c)
+		return;
+	__dir_cache_clear(c);
+	pthread_mutex_destroy(&c->lock);
+	free(c);
+}
+
+/*
+ * Move dset into the cache. If this fails, the cache is no longer a
+ * copy of any generation and the next request gets the whole
+ * directory. Caller must hold c->lock.
+ */
+static int __dir_cache_put(ldms_dir_cache_t c, ldms_dir_set_t dset)
+{
+	struct dir_cache_ent *ent;
+	struct rbn *rbn = rbt_find(&c->tree, dset->inst_name);
+
+	if (rbn) {
+		ent = container_of(rbn, struct dir_cache_ent, rbn);
+		rbt_del(&c->tree, rbn);
+		__dir_set_free(&ent->dset);
+	} else {
+		ent = malloc(sizeof(*ent));
+		if (!ent) {
+			__dir_set_free(dset);
+			c->dir_id = 0;
+			return ENOMEM;
+		}
+		c->count++;
+	}
+	ent->dset = *dset;
+	memset(dset, 0, sizeof(*dset));
+	ent->epoch = c->epoch;
+	rbn_init(&ent->rbn, ent->dset.inst_name);
+	rbt_ins(&c->tree, &ent->rbn);
+	return 0;
+}
+
+/* Returns an LDMS_DIR_LIST of the cache. Caller must hold c->lock */
+static ldms_dir_t __dir_cache_list(ldms_dir_cache_t c)
+{
+	struct dir_cache_ent *ent;
+	struct rbn *rbn;
+	ldms_dir_t dir;
+
+	dir = calloc(1, sizeof(*dir) + c->count * sizeof(struct ldms_dir_set_s));
+	if (!dir)
+		return NULL;
+	dir->type = LDMS_DIR_LIST;
+	for (rbn = rbt_min(&c->tree); rbn; rbn = rbn_succ(rbn)) {
+		ent = container_of(rbn, struct dir_cache_ent, rbn);
+		if (__dir_set_copy(&dir->set_data[dir->set_count], &ent->dset)) {
+			ldms_xprt_dir_free(NULL, dir);
+			return NULL;
+		}
+		dir->set_count++;
+	}
+	return dir;
+}
+
+/* Caller must hold c->lock */
+static void __dir_cache_drop_stale(ldms_dir_cache_t c)
+{
+	struct dir_cache_ent *ent;
+	struct rbn *rbn, *next;
+
+	for (rbn = rbt_min(&c->tree); rbn; rbn = next) {
+		next = rbn_succ(rbn);
+		ent = container_of(rbn, struct dir_cache_ent, rbn);
+		if (ent->epoch != c->epoch)
+			__dir_cache_remove(c, ent->dset.inst_name);
+	}
+}
+
+/* Remove a set the peer deleted from the cache of the directory request */
+static void __dir_cache_set_delete(struct ldms_xprt *x, const char *name)
+{
+	struct ldms_context *ctxt;
+	ldms_dir_cache_t c = NULL;
+
+	pthread_mutex_lock(&x->lock);
+	ctxt = (struct ldms_context *)(unsigned long)x->local_dir_xid;
+	if (ctxt)
+		c = ctxt->dir.cache;
+	pthread_mutex_unlock(&x->lock);
+	if (!c)
+		return;
+	pthread_mutex_lock(&c->lock);
+	__dir_cache_remove(c, name);
+	pthread_mutex_unlock(&c->lock);
+}
+
+/* Returns the string at *s and moves *s past it, or NULL if there is none */
+static const char *__dir_bin_str(const char **s, const char *end)
+{
+	const char *str = *s;
+	const char *nul = memchr(str, '\0', end - str);
+	if (!nul)
+		return NULL;
+	*s = nul + 1;
+	return str;
+}
+
+static int __dir_bin_decode(struct ldms_dir_bin_entry *ent, size_t ent_len,
+			    ldms_dir_set_t dset)
+{
+	const char *s = ent->str;
+	const char *end = (const char *)ent + ent_len;
+	const char *str[5];
+	const char *key, *value;
+	uint32_t info_count;
+	int i;
+
+	memset(dset, 0, sizeof(*dset));
+	for (i = 0; i < 5; i++) {
+		str[i] = __dir_bin_str(&s, end);
+		if (!str[i])
+			return EINVAL;
+	}
+	dset->inst_name = strdup(str[0]);
+	dset->schema_name = strdup(str[1]);
+	dset->digest_str = strdup(str[2]);
+	dset->flags = strdup(str[3]);
+	dset->perm = strdup(str[4]);
+	if (!dset->inst_name || !dset->schema_name || !dset->digest_str ||
+	    !dset->flags || !dset->perm)
+		goto enomem;
+	dset->meta_size = __le32_to_cpu(ent->meta_size);
+	dset->data_size = __le32_to_cpu(ent->data_size);
+	dset->heap_size = __le32_to_cpu(ent->heap_size);
+	dset->uid = __le32_to_cpu(ent->uid);
+	dset->gid = __le32_to_cpu(ent->gid);
+	dset->card = __le32_to_cpu(ent->card);
+	dset->array_card = __le32_to_cpu(ent->array_card);
+	dset->meta_gn = __le64_to_cpu(ent->meta_gn);
+	dset->data_gn = __le64_to_cpu(ent->data_gn);
+	dset->timestamp.sec = __le32_to_cpu(ent->timestamp.sec);
+	dset->timestamp.usec = __le32_to_cpu(ent->timestamp.usec);
+	dset->duration.sec = __le32_to_cpu(ent->duration.sec);
+	dset->duration.usec = __le32_to_cpu(ent->duration.usec);
+	info_count = __le32_to_cpu(ent->info_count);
+	if (!info_count)
+		return 0;
+	if (info_count > ent_len / 2) {
+		__dir_set_free(dset);
+		return EINVAL;
+	}
+	dset->info = calloc(info_count, sizeof(*dset->info));
+	if (!dset->info)
+		goto enomem;
+	dset->info_count = info_count;
+	for (i = 0; i < info_count; i++) {
+		key = __dir_bin_str(&s, end);
+		value = key ? __dir_bin_str(&s, end) : NULL;
+		if (!value) {
+			__dir_set_free(dset);
+			return EINVAL;
+		}
+		dset->info[i].key = strdup(key);
+		dset->info[i].value = strdup(value);
+		if (!dset->info[i].key || !dset->info[i].value)
+			goto enomem;
+	}
+	return 0;
+ enomem:
+	__dir_set_free(dset);
+	return ENOMEM;
+}
+
+/*
+ * Process a directory reply or update in the binary format. Without a
+ * cache the sets are passed to the application as they arrive. With a
+ * cache, the reply to the request is applied to the cache and the
+ * application gets the whole directory from the cache after the last
+ * reply message.
+ */
+static
+void __process_dir_bin_reply(struct ldms_xprt *x, struct ldms_reply *reply,
+			     struct ldms_context *ctxt, int more)
+{
+	enum ldms_dir_type type = ntohl(reply->dir.type) & ~LDMS_DIR_TYPE_F_BIN;
+	int update = (ntohl(reply->hdr.cmd) == LDMS_CMD_DIR_UPDATE_REPLY);
+	ldms_dir_cache_t c = ctxt->dir.cache;
+	struct ldms_dir_bin_hdr *bin = (void *)reply->dir.json_data;
+	size_t ent_min = offsetof(struct ldms_dir_bin_entry, str);
+	struct ldms_dir_bin_entry *ent;
+	ldms_stats_entry_t e = &x->stats.ops[LDMS_XPRT_OP_DIR_REQ];
+	struct timespec end, start;
+	size_t len, off, ent_len;
+	uint32_t i, count;
+	ldms_dir_t dir = NULL;
+	const char *name;
+	int64_t dur_us;
+	int rc = 0;
+
+	(void)clock_gettime(CLOCK_REALTIME, &start);
+	len = ntohl(reply->hdr.len) - sizeof(struct ldms_reply_hdr)
+				- sizeof(struct ldms_dir_reply);
+	if (len < offsetof(struct ldms_dir_bin_hdr, entries)) {
+		rc = EINVAL;
+		goto out;
+	}
+	count = __le32_to_cpu(bin->count);
+	if (count > len / ent_min) {
+		rc = EINVAL;
+		goto out;
+	}
+	dir = calloc(1, sizeof(*dir) + count * sizeof(struct ldms_dir_set_s));
+	if (!dir) {
+		rc = ENOMEM;
+		goto out;
+	}
+	dir->type = type;
+	dir->more = more;
+
+	/* Decode the sets, the removals are applied to the cache below */
+	off = offsetof(struct ldms_dir_bin_hdr, entries);
+	for (i = 0; i < count; i++) {
+		ent = (void *)&reply->dir.json_data[off];
+		if (len - off < ent_min ||
+		    (ent_len = __le32_to_cpu(ent->len)) < ent_min ||
+		    ent_len > len - off) {
+			rc = EINVAL;
+			goto out;
+		}
+		off += ent_len;
+		if (__le32_to_cpu(ent->flags) & LDMS_DIR_BIN_E_DEL)
+			continue;
+		rc = __dir_bin_decode(ent, ent_len,
+				      &dir->set_data[dir->set_count]);
+		if (rc)
+			goto out;
+		dir->set_count++;
+	}
+	for (i = 0; i < dir->set_count; i++) {
+		if (!dir->set_data[i].info_count)
+			continue;
+		rc = __dir_set_info_update(type, &dir->set_data[i]);
+		if (rc)
+			goto out;
+	}
+	if (!c)
+		goto out;
+
+	pthread_mutex_lock(&c->lock);
+	off = offsetof(struct ldms_dir_bin_hdr, entries);
+	for (i = 0; i < count; i++) {
+		ent = (void *)&reply->dir.json_data[off];
+		ent_len = __le32_to_cpu(ent->len);
+		off += ent_len;
+		if (!(__le32_to_cpu(ent->flags) & LDMS_DIR_BIN_E_DEL))
+			continue;
+		name = ent->str;
+		if (__dir_bin_str(&name, (char *)ent + ent_len))
+			__dir_cache_remove(c, ent->str);
+	}
+	if (update) {
+		struct ldms_dir_set_s dset;
+		for (i = 0; i < dir->set_count; i++) {
+			if (__dir_set_copy(&dset, &dir->set_data[i]) ||
+			    __dir_cache_put(c, &dset)) {
+				c->dir_id = 0;
+				break;
 			}
 		}
+		/*
+		 * c->dir_gn is left alone. Unpublished sets are logged at
+		 * a generation but never pushed, so advancing past a pushed
+		 * update could skip a removal in the next delta request.
+		 */
+		pthread_mutex_unlock(&c->lock);
+		goto out;
 	}
-	return rc;
+	for (i = 0; i < dir->set_count; i++) {
+		rc = __dir_cache_put(c, &dir->set_data[i]);
+		if (rc)
+			break;
+	}
+	ldms_xprt_dir_free(x, dir);
+	dir = NULL;
+	if (!rc && !more) {
+		if (!(__le32_to_cpu(bin->flags) & LDMS_DIR_BIN_F_DELTA))
+			__dir_cache_drop_stale(c);
+		c->dir_id = __le64_to_cpu(bin->dir_id);
+		c->dir_gn = __le64_to_cpu(bin->dir_gn);
+		dir = __dir_cache_list(c);
+		if (!dir)
+			rc = ENOMEM;
+	}
+	if (rc)
+		c->dir_id = 0;
+	pthread_mutex_unlock(&c->lock);
+	if (!rc && more)
+		return; /* Wait for the rest of the directory */
+ out:
+	if (rc && c) {
+		pthread_mutex_lock(&c->lock);
+		c->dir_id = 0;
+		pthread_mutex_unlock(&c->lock);
+	}
+	/* Callback owns dir memory. */
+	ctxt->dir.cb((ldms_t)x, rc, rc ? NULL : dir, ctxt->dir.cb_arg);
+	if (rc && dir)
+		ldms_xprt_dir_free(x, dir);
+	(void)clock_gettime(CLOCK_REALTIME, &end);
+	dur_us = ldms_timespec_diff_us(&start, &end);
+	if (e->min_us > dur_us)
+		e->min_us = dur_us;
+	if (e->max_us < dur_us)
+		e->max_us = dur_us;
+	e->total_us += dur_us;
+	e->mean_us = (e->count * e->mean_us) + dur_us;
+	e->count += 1;
+	e->mean_us /= e->count;
 }
 
 static
@@ -1754,13 +2952,13 @@ void __process_dir_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 		       struct ldms_context *ctxt, int more)
 {
 	enum ldms_dir_type type = ntohl(reply->dir.type);
-	int i, rc = ntohl(reply->hdr.rc);
+	int i, j, rc = ntohl(reply->hdr.rc);
 	size_t count, json_data_len;
 	ldms_dir_t dir = NULL;
 	json_parser_t p = NULL;
 	json_entity_t dir_attr, dir_list, set_entity, info_list;
+	json_entity_t info_entity, k, v;
 	json_entity_t dir_entity = NULL;
-	struct ldms_set *lset;
 	ldms_stats_entry_t e = &x->stats.ops[LDMS_XPRT_OP_DIR_REQ];
 	int64_t dur_us;
 	struct timespec end, start;
@@ -1774,6 +2972,11 @@ void __process_dir_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 	if (rc)
 		goto out;
 
+	if (type & LDMS_DIR_TYPE_F_BIN) {
+		__process_dir_bin_reply(x, reply, ctxt, more);
+		return;
+	}
+
 	(void)clock_gettime(CLOCK_REALTIME, &start);
 
 	p = json_parser_new(0);
@@ -1799,7 +3002,7 @@ void __process_dir_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 	}
 	count = json_list_len(dir_list);
 
-	dir = malloc(sizeof (*dir) +
+	dir = calloc(1, sizeof (*dir) +
 		     (count * sizeof(void *)) +
 		     (count * sizeof(struct ldms_dir_set_s)));
 	rc = ENOMEM;
@@ -1880,20 +3083,25 @@ void __process_dir_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 			dir->set_data[i].info = NULL;
 			continue;
 		}
-		dir->set_data[i].info = malloc(sizeof(struct ldms_key_value_s) * info_count);
+		dir->set_data[i].info = calloc(info_count, sizeof(struct ldms_key_value_s));
 		if (!dir->set_data[i].info) {
 			rc = ENOMEM;
 			goto out;
 		}
-
-		/* If this set is in our local set tree, update it's set info */
-		__ldms_set_tree_lock();
 		dir->set_data[i].info_count = info_count;
-		lset = __ldms_find_local_set(dir->set_data[i].inst_name);
-		rc = __process_dir_set_info(lset, type, &dir->set_data[i], info_list);
-		if (lset)
-			ref_put(&lset->ref, "__ldms_find_local_set");
-		__ldms_set_tree_unlock();
+		for (j = 0, info_entity = json_item_first(info_list); info_entity;
+		     info_entity = json_item_next(info_entity), j++) {
+			k = json_value_find(info_entity, "key");
+			v = json_value_find(info_entity, "value");
+			dir->set_data[i].info[j].key = strdup(json_value_str(k)->str);
+			dir->set_data[i].info[j].value = strdup(json_value_str(v)->str);
+			if (!dir->set_data[i].info[j].key ||
+			    !dir->set_data[i].info[j].value) {
+				rc = ENOMEM;
+				goto out;
+			}
+		}
+		rc = __dir_set_info_update(type, &dir->set_data[i]);
 		if (rc)
 			break;
 	}
@@ -1936,67 +3144,360 @@ void process_dir_reply(struct ldms_xprt *x, struct ldms_reply *reply,
 				x->zap_ep, x->active_dir);
 #endif /* DEBUG */
 	}
-	pthread_mutex_unlock(&x->lock);
+	pthread_mutex_unlock(&x->lock);
+}
+
+static
+void process_dir_update(struct ldms_xprt *x, struct ldms_reply *reply,
+		       struct ldms_context *ctxt)
+{
+	__process_dir_reply(x, reply, ctxt, 0);
+}
+
+static void process_req_notify_reply(struct ldms_xprt *x, struct ldms_reply *reply,
+			      struct ldms_context *ctxt)
+{
+	ldms_notify_event_t event;
+	size_t len = ntohl(reply->req_notify.event.len);
+	if (!ctxt->req_notify.cb)
+		return;
+
+	event = malloc(len);
+	if (!event)
+		return;
+
+	event->type = ntohl(reply->req_notify.event.type);
+	event->len = ntohl(reply->req_notify.event.len);
+
+	if (len > sizeof(struct ldms_notify_event_s))
+		memcpy(event->u_data,
+		       &reply->req_notify.event.u_data,
+		       len - sizeof(struct ldms_notify_event_s));
+
+	ctxt->req_notify.cb((ldms_t)x,
+			    ctxt->req_notify.s,
+			    event, ctxt->req_notify.cb_arg);
+}
+
+static void process_push_reply(struct ldms_xprt *x, struct ldms_reply *reply,
+			      struct ldms_context *ctxt)
+{
+	uint32_t data_off = ntohl(reply->push.data_off);
+	uint32_t data_len = ntohl(reply->push.data_len);
+	int rc;
+	ldms_set_t set;
+
+	set = __ldms_find_local_set_by_id(reply->push.set_id);
+	if (!set) {
+		x->log("%s: set_id %ld not found\n", __func__, reply->push.set_id);
+		return;
+	}
+	rc = __xprt_set_access_check(x, set, LDMS_ACCESS_WRITE);
+	if (rc)
+		goto out; /* NOTE should we terminate the xprt? */
+
+	/* Copy the data to the metric set */
+	if (data_len) {
+		memcpy((char *)set->meta + data_off,
+					reply->push.data, data_len);
+	}
+	if (set->push_cb &&
+		(0 == (ntohl(reply->push.flags) & LDMS_CMD_PUSH_REPLY_F_MORE))) {
+		set->push_cb(x, set, ntohl(reply->push.flags), set->push_cb_arg);
+	}
+ out:
+	ref_put(&set->ref, "__ldms_find_local_set");
+}
+
+/*
+ * Copy all sets of a coalesced push before calling their push
+ * callbacks, so that the application sees the sets of the batch
+ * together. The last callback has LDMS_UPD_F_BATCH_END.
+ *
+ * The callback of a set is held until the next set that has a callback
+ * is found, so that the END flag goes to the last callback actually
+ * made rather than to a set chosen before the callbacks run.
+ */
+static void process_push_batch_reply(struct ldms_xprt *x,
+				     struct ldms_reply *reply)
+{
+	struct ldms_push_reply *ent;
+	struct ldms_set **sets;
+	uint32_t *flags;
+	uint32_t i, n, count, data_off, data_len;
+	size_t off, len, ent_len;
+	ldms_update_cb_t cb, pend_cb = NULL;
+	void *pend_arg = NULL;
+	int pend = -1;
+
+	count = ntohl(reply->push_batch.count);
+	len = ntohl(reply->hdr.len);
+	if (!count)
+		return;
+	sets = calloc(count, sizeof(*sets) + sizeof(*flags));
+	if (!sets) {
+		x->log("%s: x %p: out of memory\n", __func__, x);
+		return;
+	}
+	flags = (uint32_t *)&sets[count];
+	off = sizeof(struct ldms_reply_hdr)
+		+ sizeof(struct ldms_push_batch_reply);
+	for (n = 0; n < count; n++) {
+		if (off + sizeof(*ent) > len)
+			break;
+		ent = (void *)reply + off;
+		data_off = ntohl(ent->data_off);
+		data_len = ntohl(ent->data_len);
+		ent_len = roundup(sizeof(*ent) + data_len, 8);
+		if (off + sizeof(*ent) + data_len > len) {
+			x->log("%s: x %p: malformed push batch reply\n",
+				__func__, x);
+			break;
+		}
+		off += ent_len;
+		sets[n] = __ldms_find_local_set_by_id(ent->set_id);
+		if (!sets[n]) {
+			x->log("%s: set_id %ld not found\n", __func__,
+			       ent->set_id);
+			continue;
+		}
+		if (__xprt_set_access_check(x, sets[n], LDMS_ACCESS_WRITE) ||
+		    (uint64_t)data_off + data_len > __ldms_set_size_get(sets[n])) {
+			ref_put(&sets[n]->ref, "__ldms_find_local_set");
+			sets[n] = NULL;
+			continue;
+		}
+		memcpy((char *)sets[n]->meta + data_off, ent->data, data_len);
+		flags[n] = ntohl(ent->flags) | LDMS_UPD_F_BATCH;
+	}
+	for (i = 0; i < n; i++) {
+		if (!sets[i])
+			continue;
+		cb = sets[i]->push_cb;
+		if (!cb)
+			continue;
+		if (pend_cb)
+			pend_cb(x, sets[pend], flags[pend], pend_arg);
+		pend = i;
+		pend_cb = cb;
+		pend_arg = sets[i]->push_cb_arg;
+	}
+	if (pend_cb)
+		pend_cb(x, sets[pend], flags[pend] | LDMS_UPD_F_BATCH_END,
+			pend_arg);
+	for (i = 0; i < n; i++) {
+		if (sets[i])
+			ref_put(&sets[i]->ref, "__ldms_find_local_set");
+	}
+	free(sets);
+}
+
+/*
+ * Check the ranges of a delta entry, the first one must be the data
+ * header. Returns 0 if they all fit in the data section of the set.
+ */
+static int __update_batch_delta_check(ldms_set_t set,
+				      struct ldms_update_batch_entry *ent)
+{
+	struct ldms_update_batch_range *r;
+	size_t data_sz = __le32_to_cpu(set->meta->data_sz);
+	size_t off, len = 0, data_len = ntohl(ent->data_len);
+
+	if (ent->base_gn != set->data->gn)
+		return E2BIG; /* our copy changed since the request */
+	for (off = 0; off < data_len; off += sizeof(*r) + roundup(len, 8)) {
+		if (off + sizeof(*r) > data_len)
+			return EINVAL;
+		r = (void *)ent->data + off;
+		len = ntohl(r->len);
+		if (off == 0 &&
+		    (r->off || len < sizeof(struct ldms_data_hdr)))
+			return EINVAL;
+		if (off + sizeof(*r) + len > data_len ||
+		    ntohl(r->off) + len > data_sz)
+			return EINVAL;
+	}
+	return data_len ? 0 : EINVAL;
 }
 
-static
-void process_dir_update(struct ldms_xprt *x, struct ldms_reply *reply,
-		       struct ldms_context *ctxt)
+static void __update_batch_delta_apply(ldms_set_t set,
+				       struct ldms_update_batch_entry *ent)
 {
-	__process_dir_reply(x, reply, ctxt, 0);
+	struct ldms_update_batch_range *r;
+	size_t off, len = 0, data_len = ntohl(ent->data_len);
+
+	for (off = 0; off < data_len; off += sizeof(*r) + roundup(len, 8)) {
+		r = (void *)ent->data + off;
+		len = ntohl(r->len);
+		memcpy((void *)set->data + ntohl(r->off), r->data, len);
+	}
 }
 
-static void process_req_notify_reply(struct ldms_xprt *x, struct ldms_reply *reply,
-			      struct ldms_context *ctxt)
+/*
+ * Apply one entry of the batch update reply to the set. The set falls
+ * back to the RDMA update if its metadata has changed or the data did
+ * not fit in the reply.
+ */
+static void __update_batch_set(struct ldms_xprt *x, struct ldms_context *ctxt,
+			       int idx, struct ldms_update_batch_entry *ent)
 {
-	ldms_notify_event_t event;
-	size_t len = ntohl(reply->req_notify.event.len);
-	if (!ctxt->req_notify.cb)
-		return;
+	ldms_set_t set = ctxt->update_batch.s[idx];
+	void *arg = ctxt->update_batch.cb_arg[idx];
+	uint32_t rc = ntohl(ent->rc);
+	uint32_t data_len = ntohl(ent->data_len);
+	int delta = ntohl(ent->flags) & LDMS_UPDATE_BATCH_E_DELTA;
+	struct ldms_data_hdr dhdr;
+	void *base;
 
-	event = malloc(len);
-	if (!event)
+	if (!set)
+		return;
+	if (!rc && delta) {
+		rc = __update_batch_delta_check(set, ent);
+		if (rc == EINVAL)
+			x->log("%s: x %p: malformed delta for set %s\n",
+				__func__, x, ldms_set_instance_name_get(set));
+		if (rc)
+			rc = E2BIG;
+	}
+	if (!rc) {
+		/* The header is the first range of a delta */
+		memcpy(&dhdr, delta ? ent->data +
+			sizeof(struct ldms_update_batch_range) : ent->data,
+		       sizeof(dhdr));
+		if ((!delta && data_len != __le32_to_cpu(set->meta->data_sz)) ||
+		    0 == set->meta->meta_gn ||
+		    dhdr.meta_gn != set->meta->meta_gn)
+			rc = E2BIG;
+	}
+	if (rc == E2BIG) {
+		pthread_mutex_lock(&x->lock);
+		rc = __ldms_remote_update(x, set, ctxt->update_batch.cb, arg);
+		pthread_mutex_unlock(&x->lock);
+		if (rc)
+			ctxt->update_batch.cb(x, set, LDMS_UPD_ERROR(rc), arg);
+		return;
+	}
+	if (rc) {
+		ctxt->update_batch.cb(x, set, LDMS_UPD_ERROR(rc), arg);
 		return;
+	}
+	if (delta)
+		__update_batch_delta_apply(set, ent);
+	else
+		memcpy(set->data, ent->data, data_len);
+	set->curr_idx = 0;
+	if (set->meta->heap_sz) {
+		base = ((void*)set->data) + set->data->size - set->meta->heap_sz;
+		if (ldms_set_is_consistent(set))
+			set->heap = ldms_heap_get(&set->heap_inst, &set->data->heap, base);
+		else
+			set->heap = NULL;
+	}
+	ctxt->update_batch.cb(x, set, 0, arg);
+}
 
-	event->type = ntohl(reply->req_notify.event.type);
-	event->len = ntohl(reply->req_notify.event.len);
+/* The set at idx has had its callback, release it from the batch */
+static void __update_batch_done(struct ldms_context *ctxt, int idx)
+{
+	ref_put(&ctxt->update_batch.s[idx]->ref, "__ldms_alloc_ctxt");
+	ctxt->update_batch.s[idx] = NULL;
+}
 
-	if (len > sizeof(struct ldms_notify_event_s))
-		memcpy(event->u_data,
-		       &reply->req_notify.event.u_data,
-		       len - sizeof(struct ldms_notify_event_s));
+/* Complete the sets of the batch that have not had a callback with rc */
+static void __update_batch_fail(struct ldms_xprt *x,
+				struct ldms_context *ctxt, int rc)
+{
+	int i;
 
-	ctxt->req_notify.cb((ldms_t)x,
-			    ctxt->req_notify.s,
-			    event, ctxt->req_notify.cb_arg);
+	for (i = 0; i < ctxt->update_batch.count; i++) {
+		if (!ctxt->update_batch.s[i])
+			continue;
+		ctxt->update_batch.cb(x, ctxt->update_batch.s[i],
+				      LDMS_UPD_ERROR(rc),
+				      ctxt->update_batch.cb_arg[i]);
+		__update_batch_done(ctxt, i);
+	}
 }
 
-static void process_push_reply(struct ldms_xprt *x, struct ldms_reply *reply,
-			      struct ldms_context *ctxt)
+static void process_update_batch_reply(struct ldms_xprt *x,
+				       struct ldms_reply *reply,
+				       struct ldms_context *ctxt)
 {
-	uint32_t data_off = ntohl(reply->push.data_off);
-	uint32_t data_len = ntohl(reply->push.data_len);
-	int rc;
-	ldms_set_t set;
+	struct ldms_update_batch_entry *ent;
+	uint32_t rc = ntohl(reply->hdr.rc);
+	uint32_t i, idx, count, more = 0;
+	size_t off, len, ent_len;
 
-	set = __ldms_set_by_id(reply->push.set_id);
-	if (!set) {
-		x->log("%s: set_id %ld not found\n", __func__, reply->push.set_id);
-		return;
-	}
-	rc = __xprt_set_access_check(x, set, LDMS_ACCESS_WRITE);
 	if (rc)
-		return; /* NOTE should we terminate the xprt? */
+		goto out;
+	more = ntohl(reply->update_batch.more);
+	count = ntohl(reply->update_batch.count);
+	len = ntohl(reply->hdr.len);
+	off = sizeof(struct ldms_reply_hdr)
+		+ sizeof(struct ldms_update_batch_reply);
+	for (i = 0; i < count; i++) {
+		ent = (void *)reply + off;
+		if (off + sizeof(*ent) > len ||
+		    off + roundup(sizeof(*ent) + ntohl(ent->data_len), 8) > len ||
+		    ntohl(ent->idx) >= ctxt->update_batch.count) {
+			x->log("%s: x %p: malformed update batch reply\n",
+				__func__, x);
+			rc = EINVAL;
+			break;
+		}
+		ent_len = roundup(sizeof(*ent) + ntohl(ent->data_len), 8);
+		idx = ntohl(ent->idx);
+		off += ent_len;
+		if (!ctxt->update_batch.s[idx])
+			continue;
+		__update_batch_set(x, ctxt, idx, ent);
+		__update_batch_done(ctxt, idx);
+	}
+ out:
+	/*
+	 * An error completes the sets that are left right away, the
+	 * entries for them in the rest of the reply are ignored. The last
+	 * message completes the sets the peer did not send an entry for.
+	 */
+	if (rc || !more)
+		__update_batch_fail(x, ctxt, rc ? rc : EINVAL);
+	if (more)
+		return;
+	pthread_mutex_lock(&x->lock);
+	__ldms_free_ctxt(x, ctxt);
+	pthread_mutex_unlock(&x->lock);
+}
 
-	/* Copy the data to the metric set */
-	if (data_len) {
-		memcpy((char *)set->meta + data_off,
-					reply->push.data, data_len);
+/*
+ * The replies to the outstanding batch updates will never come. Complete
+ * them with ENOTCONN, as the transport is disconnected but not yet freed.
+ */
+static void __ldms_xprt_update_batch_disconnected(struct ldms_xprt *x)
+{
+	TAILQ_HEAD(, ldms_context) batch_list = TAILQ_HEAD_INITIALIZER(batch_list);
+	struct ldms_context *ctxt, *next_ctxt;
+
+	pthread_mutex_lock(&x->lock);
+	for (ctxt = TAILQ_FIRST(&x->ctxt_list); ctxt; ctxt = next_ctxt) {
+		next_ctxt = TAILQ_NEXT(ctxt, link);
+		if (ctxt->type != LDMS_CONTEXT_UPDATE_BATCH)
+			continue;
+		TAILQ_REMOVE(&x->ctxt_list, ctxt, link);
+		TAILQ_INSERT_TAIL(&batch_list, ctxt, link);
 	}
-	if (set->push_cb &&
-		(0 == (ntohl(reply->push.flags) & LDMS_CMD_PUSH_REPLY_F_MORE))) {
-		set->push_cb(x, set, ntohl(reply->push.flags), set->push_cb_arg);
+	pthread_mutex_unlock(&x->lock);
+	if (TAILQ_EMPTY(&batch_list))
+		return;
+	TAILQ_FOREACH(ctxt, &batch_list, link)
+		__update_batch_fail(x, ctxt, ENOTCONN);
+	pthread_mutex_lock(&x->lock);
+	while ((ctxt = TAILQ_FIRST(&batch_list))) {
+		TAILQ_REMOVE(&batch_list, ctxt, link);
+		/* __ldms_free_ctxt() removes it from the ctxt_list */
+		TAILQ_INSERT_TAIL(&x->ctxt_list, ctxt, link);
+		__ldms_free_ctxt(x, ctxt);
 	}
+	pthread_mutex_unlock(&x->lock);
 }
 
 void ldms_xprt_dir_free(ldms_t t, ldms_dir_t dir)
@@ -2004,22 +3505,9 @@ void ldms_xprt_dir_free(ldms_t t, ldms_dir_t dir)
 	(void)t;
 	if (!dir)
 		return;
-	int i, j;
-	for (i = 0; i < dir->set_count; i++) {
-		free(dir->set_data[i].inst_name);
-		free(dir->set_data[i].schema_name);
-		free(dir->set_data[i].flags);
-		free(dir->set_data[i].digest_str);
-		free(dir->set_data[i].perm);
-		if (NULL == dir->set_data[i].info)
-			continue;
-		for (j = 0; j < dir->set_data[i].info_count; j++) {
-			ldms_key_value_t kv = &dir->set_data[i].info[j];
-			free(kv->key);
-			free(kv->value);
-		}
-		free(dir->set_data[i].info);
-	}
+	int i;
+	for (i = 0; i < dir->set_count; i++)
+		__dir_set_free(&dir->set_data[i]);
 	free(dir);
 }
 
@@ -2038,6 +3526,9 @@ static int ldms_xprt_recv_reply(struct ldms_xprt *x, struct ldms_reply *reply)
 	case LDMS_CMD_PUSH_REPLY:
 		process_push_reply(x, reply, ctxt);
 		break;
+	case LDMS_CMD_PUSH_BATCH_REPLY:
+		process_push_batch_reply(x, reply);
+		break;
 	case LDMS_CMD_LOOKUP_REPLY:
 		process_lookup_reply(x, reply, ctxt);
 		break;
@@ -2056,6 +3547,9 @@ static int ldms_xprt_recv_reply(struct ldms_xprt *x, struct ldms_reply *reply)
 	case LDMS_CMD_SET_DELETE_REPLY:
 		process_set_delete_reply(x, reply, ctxt);
 		break;
+	case LDMS_CMD_UPDATE_BATCH_REPLY:
+		process_update_batch_reply(x, reply, ctxt);
+		break;
 	default:
 		x->log("Unrecognized reply %d\n", cmd);
 	}
@@ -2126,15 +3620,33 @@ void __ldms_passive_connect_cb(ldms_t x, ldms_xprt_event_t e, void *cb_arg)
 	}
 }
 
+/*
+ * The LDMS_CONN_F_XXX features of this process. Setting LDMS_DIR_JSON
+ * in the environment keeps the JSON directory protocol.
+ */
+static uint32_t __ldms_conn_features(void)
+{
+	uint32_t features = LDMS_CONN_FEATURES;
+	if (getenv("LDMS_DIR_JSON"))
+		features &= ~LDMS_CONN_F_DIR_BIN;
+	return features;
+}
+
+/* Initialize the conn_msg and return its length */
 static
-void __ldms_xprt_conn_msg_init(ldms_t _x, struct ldms_conn_msg *msg)
+size_t __ldms_xprt_conn_msg_init(ldms_t _x, struct ldms_conn_msg *msg)
 {
 	struct ldms_xprt *x = _x;
+	uint32_t features = __cpu_to_le32(__ldms_conn_features());
+	size_t len;
 	bzero(msg, sizeof(*msg));
 	LDMS_VERSION_SET(msg->ver);
 	if (x->auth)
-		strncpy(msg->auth_name,
-			x->auth->plugin->name, sizeof(msg->auth_name));
+		snprintf(msg->auth_name, sizeof(msg->auth_name), "%s",
+			 x->auth->plugin->name);
+	len = sizeof(msg->ver) + strlen(msg->auth_name) + 1;
+	memcpy((char *)msg + len, &features, sizeof(features));
+	return len + sizeof(features);
 }
 
 void __ldms_xprt_init(struct ldms_xprt *x, const char *name,
@@ -2179,10 +3691,11 @@ int ldms_xprt_names(ldms_t x, char *lcl_name, size_t lcl_name_sz,
 	return 0;
 }
 
-static void ldms_zap_handle_conn_req(zap_ep_t zep)
+static void ldms_zap_handle_conn_req(zap_ep_t zep, uint32_t features)
 {
 	static char rej_msg[64] = "Insufficient resources";
 	struct ldms_conn_msg msg;
+	size_t len;
 	int rc;
 	char name[128];
 	zap_err_t zerr;
@@ -2205,6 +3718,7 @@ static void ldms_zap_handle_conn_req(zap_ep_t zep)
 	_x->zap = x->zap;
 	_x->zap_ep = zep;
 	_x->max_msg = zap_max_msg(x->zap);
+	_x->peer_features = features;
 	_x->event_cb = x->event_cb;
 	_x->event_cb_arg = x->event_cb_arg;
 	if (!_x->event_cb)
@@ -2222,12 +3736,12 @@ static void ldms_zap_handle_conn_req(zap_ep_t zep)
 	if (rc)
 		goto err1;
 
-	__ldms_xprt_conn_msg_init(x, &msg);
+	len = __ldms_xprt_conn_msg_init(x, &msg);
 
 	/* Take a 'connect' reference. Dropped in ldms_xprt_close() */
 	ldms_xprt_get(_x);
 
-	zerr = zap_accept(zep, ldms_zap_auto_cb, (void*)&msg, sizeof(msg));
+	zerr = zap_accept(zep, ldms_zap_auto_cb, (void*)&msg, len);
 	if (zerr) {
 		x->log("ERROR: %d accepting connection from %s.\n", zerr, name);
 		goto err2;
@@ -2639,7 +4153,7 @@ static void handle_rendezvous_push(zap_ep_t zep, zap_event_t ev,
 	struct ldms_push_peer *pp;
 	struct xprt_set_coll_entry *ent;
 
-	set = __ldms_set_by_id(push->lookup_set_id);
+	set = __ldms_find_local_set_by_id(push->lookup_set_id);
 	if (!set) {
 		/* The set has been deleted.*/
 		return;
@@ -2653,7 +4167,7 @@ static void handle_rendezvous_push(zap_ep_t zep, zap_event_t ev,
 		pp->push_flags = ntohl(push->flags);
 		pp->remote_set_id = push->push_set_id;
 		pthread_mutex_unlock(&set->lock);
-		return;
+		goto out;
 	}
 	pp = calloc(1, sizeof(*pp));
 	if (!pp) {
@@ -2662,7 +4176,7 @@ static void handle_rendezvous_push(zap_ep_t zep, zap_event_t ev,
 			x->log("%s:%s:%d Not enough memory\n",
 				__FILE__, __func__, __LINE__);
 		}
-		return;
+		goto out;
 	}
 	rbn_init(&pp->rbn, x);
 	pp->xprt = ldms_xprt_get(x);
@@ -2676,7 +4190,7 @@ static void handle_rendezvous_push(zap_ep_t zep, zap_event_t ev,
 	rbn = rbt_find(&x->set_coll, set);
 	if (rbn) {
 		pthread_mutex_unlock(&x->lock);
-		return;
+		goto out;
 	}
 	ent = calloc(1, sizeof(*ent));
 	if (!ent) {
@@ -2685,15 +4199,15 @@ static void handle_rendezvous_push(zap_ep_t zep, zap_event_t ev,
 			x->log("%s:%s:%d Not enough memory\n",
 				__FILE__, __func__, __LINE__);
 		}
-		return;
+		goto out;
 	}
 	rbn_init(&ent->rbn, set);
 	ent->set = set;
 	ref_get(&set->ref, "xprt_set_coll");
 	rbt_ins(&x->set_coll, &ent->rbn);
 	pthread_mutex_unlock(&x->lock);
-
-	return;
+ out:
+	ref_put(&set->ref, "__ldms_find_local_set");
 }
 
 /*
@@ -2727,11 +4241,18 @@ static void handle_zap_rendezvous(zap_ep_t zep, zap_event_t ev)
 	}
 }
 
+/*
+ * Verify the peer's conn_msg and return the features that both sides
+ * support in *features.
+ */
 static int __ldms_conn_msg_verify(struct ldms_xprt *x, const void *data,
-				  int data_len, char *err_msg, int err_msg_len)
+				  int data_len, char *err_msg, int err_msg_len,
+				  uint32_t *features)
 {
 	const struct ldms_conn_msg *msg = data;
 	const struct ldms_version *ver = &msg->ver;
+	uint32_t f = 0;
+	size_t off;
 	if (data_len < sizeof(*ver)) {
 		snprintf(err_msg, err_msg_len, "Bad conn msg");
 		return EINVAL;
@@ -2744,6 +4265,10 @@ static int __ldms_conn_msg_verify(struct ldms_xprt *x, const void *data,
 		snprintf(err_msg, err_msg_len, "Auth mismatch");
 		return EINVAL;
 	}
+	off = sizeof(*ver) + strnlen(msg->auth_name, LDMS_AUTH_NAME_MAX + 1) + 1;
+	if (off + sizeof(f) <= data_len)
+		memcpy(&f, (const char *)data + off, sizeof(f));
+	*features = __le32_to_cpu(f) & __ldms_conn_features();
 	return 0;
 }
 
@@ -2797,6 +4322,7 @@ static void ldms_zap_cb(zap_ep_t zep, zap_event_t ev)
 	event.type = LDMS_XPRT_EVENT_LAST;
 	char rej_msg[128];
 	struct rbt set_coll;
+	uint32_t features;
 	struct ldms_xprt *x = zap_get_ucontext(zep);
 	if (x == NULL)
 		return;
@@ -2820,11 +4346,11 @@ static void ldms_zap_cb(zap_ep_t zep, zap_event_t ev)
 	case ZAP_EVENT_CONNECT_REQUEST:
 		__sync_fetch_and_add(&xprt_connect_request_count, 1);
 		if (0 != __ldms_conn_msg_verify(x, ev->data, ev->data_len,
-					   rej_msg, sizeof(rej_msg))) {
+					   rej_msg, sizeof(rej_msg), &features)) {
 			zap_reject(zep, rej_msg, strlen(rej_msg)+1);
 			break;
 		}
-		ldms_zap_handle_conn_req(zep);
+		ldms_zap_handle_conn_req(zep, features);
 		break;
 	case ZAP_EVENT_REJECTED:
 		(void)clock_gettime(CLOCK_REALTIME, &x->stats.disconnected);
@@ -2841,10 +4367,11 @@ static void ldms_zap_cb(zap_ep_t zep, zap_event_t ev)
 		__sync_fetch_and_add(&xprt_connect_count, 1);
 		/* actively connected -- expecting conn_msg */
 		if (0 != __ldms_conn_msg_verify(x, ev->data, ev->data_len,
-					   rej_msg, sizeof(rej_msg))) {
+					   rej_msg, sizeof(rej_msg), &features)) {
 			__ldms_xprt_term(x);
 			break;
 		}
+		x->peer_features = features;
 		/* then, proceed to authentication */
 		ldms_xprt_auth_begin(x);
 		break;
@@ -2891,6 +4418,7 @@ static void ldms_zap_cb(zap_ep_t zep, zap_event_t ev)
 		set_coll = x->set_coll;
 		x->set_coll.root = NULL;
 		pthread_mutex_unlock(&x->lock);
+		__ldms_xprt_update_batch_disconnected(x);
 		if (x->event_cb)
 			x->event_cb(x, &event, x->event_cb_arg);
 		#ifdef DEBUG
@@ -3023,6 +4551,8 @@ uint64_t ldms_xprt_conn_id(ldms_t ldms)
 void __ldms_xprt_init(struct ldms_xprt *x, const char *name,
 					ldms_log_fn_t log_fn)
 {
+	int i;
+
 	x->conn_id = __sync_add_and_fetch(&__ldms_conn_id, 1);
 	x->name[LDMS_MAX_TRANSPORT_NAME_LEN - 1] = 0;
 	memccpy(x->name, name, 0, LDMS_MAX_TRANSPORT_NAME_LEN - 1);
@@ -3040,6 +4570,9 @@ void __ldms_xprt_init(struct ldms_xprt *x, const char *name,
 
 	x->log = log_fn;
 	TAILQ_INIT(&x->ctxt_list);
+	for (i = 0; i < LDMS_CTXT_POOL_CLASSES; i++)
+		TAILQ_INIT(&x->ctxt_pool[i].list);
+	TAILQ_INIT(&x->push_pending);
 	sem_init(&x->sem, 0, 0);
 	rbt_init(&x->set_coll, rbn_ptr_cmp);
 	pthread_mutex_init(&x->lock, NULL);
@@ -3125,12 +4658,15 @@ size_t format_lookup_req(struct ldms_request *req, enum ldms_lookup_flags flags,
 }
 
 size_t format_dir_req(struct ldms_request *req, uint64_t xid,
-		      uint32_t flags)
+		      uint32_t flags, uint64_t dir_id, uint64_t dir_gn)
 {
 	size_t len;
 	req->hdr.xid = xid;
 	req->hdr.cmd = htonl(LDMS_CMD_DIR);
 	req->dir.flags = htonl(flags);
+	req->dir.reserved = 0;
+	req->dir.dir_id = __cpu_to_le64(dir_id);
+	req->dir.dir_gn = __cpu_to_le64(dir_gn);
 	len = sizeof(struct ldms_request_hdr) +
 		sizeof(struct ldms_dir_cmd_param);
 	req->hdr.len = htonl(len);
@@ -3188,65 +4724,82 @@ size_t format_cancel_notify_req(struct ldms_request *req, uint64_t xid,
 	return len;
 }
 
-int ldms_xprt_send(ldms_t _x, char *msg_buf, size_t msg_len)
+#define LDMS_SEND_IOV_STACK 8
+int ldms_xprt_send_iov(ldms_t _x, const struct iovec *iov, int iovcnt)
 {
 	struct ldms_xprt *x = _x;
-	struct ldms_request *req;
-	size_t len;
-	struct ldms_context *ctxt;
-	int rc;
+	struct iovec _v[LDMS_SEND_IOV_STACK], *v = _v;
+	struct {
+		struct ldms_request_hdr hdr;
+		struct ldms_send_cmd_param send;
+	} req;
+	size_t msg_len = 0;
+	size_t hdr_len = sizeof(struct ldms_request_hdr) +
+			 sizeof(struct ldms_send_cmd_param);
+	int i, rc;
+
+	if (iovcnt < 1 || !iov)
+		return EINVAL;
 
 	if (!ldms_xprt_connected(x))
 		return ENOTCONN;
 
-	assert(msg_len >= 4);
-	if (!msg_buf)
-		return EINVAL;
-
 	if (LDMS_XPRT_AUTH_GUARD(x))
 		return EPERM;
 
-	ldms_xprt_get(x);
-	pthread_mutex_lock(&x->lock);
-	size_t sz = sizeof(struct ldms_request) + sizeof(struct ldms_context) + msg_len;
-	ctxt = __ldms_alloc_ctxt(x, sz, LDMS_CONTEXT_SEND);
-	if (!ctxt) {
-		rc = ENOMEM;
-		goto err_0;
+	if (iovcnt >= LDMS_SEND_IOV_STACK) {
+		v = malloc((iovcnt + 1) * sizeof(*v));
+		if (!v)
+			return ENOMEM;
 	}
-	req = (struct ldms_request *)(ctxt + 1);
-	req->hdr.xid = 0;
-	req->hdr.cmd = htonl(LDMS_CMD_SEND_MSG);
-	req->send.msg_len = htonl(msg_len);
-	memcpy(req->send.msg, msg_buf, msg_len);
-	len = sizeof(struct ldms_request_hdr) +
-		sizeof(struct ldms_send_cmd_param) + msg_len;
-	req->hdr.len = htonl(len);
+	for (i = 0; i < iovcnt; i++) {
+		v[i + 1] = iov[i];
+		msg_len += iov[i].iov_len;
+	}
+	req.hdr.xid = 0;
+	req.hdr.cmd = htonl(LDMS_CMD_SEND_MSG);
+	req.hdr.len = htonl(hdr_len + msg_len);
+	req.send.msg_len = htonl(msg_len);
+	v[0].iov_base = &req;
+	v[0].iov_len = hdr_len;
 
-	rc = zap_send(x->zap_ep, req, len);
+	ldms_xprt_get(x);
+	rc = zap_zerr2errno(zap_send_iov(x->zap_ep, v, iovcnt + 1));
 #ifdef DEBUG
 	if (rc) {
 		x->log("DEBUG: send: error. put ref %p.\n", x->zap_ep);
 	}
 #endif
-	__ldms_free_ctxt(x, ctxt);
- err_0:
-	pthread_mutex_unlock(&x->lock);
 	ldms_xprt_put(x);
+	if (v != _v)
+		free(v);
 	return rc;
 }
 
+int ldms_xprt_send(ldms_t _x, char *msg_buf, size_t msg_len)
+{
+	struct iovec iov = { .iov_base = msg_buf, .iov_len = msg_len };
+
+	assert(msg_len >= 4);
+	if (!msg_buf)
+		return EINVAL;
+	return ldms_xprt_send_iov(_x, &iov, 1);
+}
+
 size_t ldms_xprt_msg_max(ldms_t x)
 {
 	return	x->max_msg - (sizeof(struct ldms_request_hdr) +
 			sizeof(struct ldms_send_cmd_param));
 }
 
-int __ldms_remote_dir(ldms_t _x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
+int __ldms_remote_dir(ldms_t _x, ldms_dir_cache_t c,
+		      ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
 {
 	struct ldms_xprt *x = _x;
 	struct ldms_request *req;
 	struct ldms_context *ctxt;
+	uint64_t dir_id = 0, dir_gn = 0;
+	uint32_t req_flags = flags;
 	size_t len;
 
 	if (!ldms_xprt_connected(x))
@@ -3271,7 +4824,23 @@ int __ldms_remote_dir(ldms_t _x, ldms_dir_cb_t cb, void *cb_arg, uint32_t flags)
 		return ENOMEM;
 	}
 	req = (struct ldms_request *)(ctxt + 1);
-	len = format_dir_req(req, (uint64_t)(unsigned long)ctxt, flags);
+	if (x->peer_features & LDMS_CONN_F_DIR_BIN)
+		req_flags |= LDMS_DIR_F_BIN;
+	if (c) {
+		ctxt->dir.cache = c;
+		pthread_mutex_lock(&c->lock);
+		c->epoch++;
+		if (req_flags & LDMS_DIR_F_BIN) {
+			dir_id = c->dir_id;
+			dir_gn = c->dir_gn;
+		} else {
+			/* The peer sends JSON, which does not update the cache */
+			__dir_cache_clear(c);
+		}
+		pthread_mutex_unlock(&c->lock);
+	}
+	len = format_dir_req(req, (uint64_t)(unsigned long)ctxt, req_flags,
+			     dir_id, dir_gn);
 	if (flags)
 		x->local_dir_xid = (uint64_t)ctxt;
 	pthread_mutex_unlock(&x->lock);
@@ -3651,6 +5220,256 @@ int ldms_xprt_cancel_push(ldms_set_t s)
 	return send_req_cancel_push(s);
 }
 
+/*
+ * Coalesced push. If the window is not 0, the sets pushed to a peer that
+ * supports LDMS_CONN_F_PUSH_BATCH are queued on the transport, and the
+ * push thread sends them when the window of the first one has passed.
+ * The contents are copied when they are sent, so the sets queued
+ * several times within a window are sent once.
+ */
+static uint32_t push_window_us;
+static pthread_once_t push_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t push_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t push_cv;
+static TAILQ_HEAD(, ldms_xprt) push_xprt_list =
+			TAILQ_HEAD_INITIALIZER(push_xprt_list);
+static pthread_t push_thread;
+static int push_thread_started;
+
+static void push_atfork(void)
+{
+	push_thread_started = 0;
+}
+
+static void push_init_once(void)
+{
+	pthread_condattr_t attr;
+	char *s = getenv("LDMS_PUSH_COALESCE_US");
+
+	if (s)
+		push_window_us = strtoul(s, NULL, 0);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&push_cv, &attr);
+	pthread_condattr_destroy(&attr);
+	pthread_atfork(NULL, NULL, push_atfork);
+}
+
+void ldms_xprt_push_coalesce_set(uint32_t usec)
+{
+	pthread_once(&push_once, push_init_once);
+	__atomic_store_n(&push_window_us, usec, __ATOMIC_SEQ_CST);
+}
+
+static inline size_t __push_ent_len(size_t data_len)
+{
+	return roundup(sizeof(struct ldms_push_reply) + data_len, 8);
+}
+
+static int __push_batch_send(struct ldms_xprt *x, struct ldms_reply *reply,
+			     size_t len, int count)
+{
+	int rc;
+
+	reply->hdr.xid = 0;
+	reply->hdr.cmd = htonl(LDMS_CMD_PUSH_BATCH_REPLY);
+	reply->hdr.len = htonl(len);
+	reply->hdr.rc = 0;
+	reply->push_batch.count = htonl(count);
+	reply->push_batch.reserved = 0;
+	pthread_mutex_lock(&x->lock);
+	rc = zap_send(x->zap_ep, reply, len);
+	if (!rc) {
+		x->stats.push_set += count;
+		x->stats.push_msg++;
+	}
+	pthread_mutex_unlock(&x->lock);
+	return rc;
+}
+
+static int __push_pending_queue(struct ldms_xprt *x,
+				struct ldms_push_pending *pe,
+				uint32_t window_us);
+
+/* Send the sets queued on the transport */
+static void __push_flush(struct ldms_xprt *x)
+{
+	TAILQ_HEAD(, ldms_push_pending) list = TAILQ_HEAD_INITIALIZER(list);
+	struct ldms_push_pending *pe;
+	struct ldms_push_peer *p;
+	struct ldms_push_reply *ent;
+	struct ldms_reply *reply;
+	struct ldms_set *set;
+	struct rbn *rbn;
+	size_t max_len = zap_max_msg(x->zap);
+	size_t hdr_len = sizeof(struct ldms_reply_hdr)
+			+ sizeof(struct ldms_push_batch_reply);
+	size_t off = hdr_len, len, doff;
+	uint32_t flags, window_us;
+	int count = 0, rc = 0;
+
+	window_us = __atomic_load_n(&push_window_us, __ATOMIC_SEQ_CST);
+	if (window_us < 1000)
+		window_us = 1000; /* do not spin on an open transaction */
+	pthread_mutex_lock(&x->lock);
+	TAILQ_CONCAT(&list, &x->push_pending, entry);
+	pthread_mutex_unlock(&x->lock);
+
+	reply = malloc(max_len);
+	if (!reply)
+		rc = ENOMEM;
+	while ((pe = TAILQ_FIRST(&list))) {
+		TAILQ_REMOVE(&list, pe, entry);
+		set = pe->set;
+		pthread_mutex_lock(&set->lock);
+		rbn = rbt_find(&set->push_coll, x);
+		if (!rbn)
+			goto next; /* canceled */
+		p = container_of(rbn, struct ldms_push_peer, rbn);
+		if (!rc && !ldms_set_is_consistent(set)) {
+			/*
+			 * Send it in the next window rather than in the
+			 * middle of a transaction. An explicit push or a
+			 * push cancel is not queued again by
+			 * ldms_transaction_end().
+			 */
+			pthread_mutex_lock(&x->lock);
+			if (0 == __push_pending_queue(x, pe, window_us)) {
+				pthread_mutex_unlock(&x->lock);
+				pthread_mutex_unlock(&set->lock);
+				continue; /* p->pending stays set */
+			}
+			pthread_mutex_unlock(&x->lock);
+		}
+		p->pending = 0;
+		if (rc)
+			goto next;
+		flags = LDMS_UPD_F_PUSH;
+		if (p->push_flags & LDMS_RBD_F_PUSH_CANCEL)
+			flags |= LDMS_UPD_F_PUSH_LAST;
+		if (p->meta_gn != __le32_to_cpu(set->meta->meta_gn)) {
+			len = __le32_to_cpu(set->meta->meta_sz)
+				+ __le32_to_cpu(set->meta->data_sz);
+			doff = 0;
+		} else {
+			len = __le32_to_cpu(set->meta->data_sz);
+			doff = (uint8_t *)set->data - (uint8_t *)set->meta;
+		}
+		/* A set fits in a message, __ldms_xprt_push() checks it */
+		if (off + __push_ent_len(len) > max_len) {
+			if (count)
+				rc = __push_batch_send(x, reply, off, count);
+			off = hdr_len;
+			count = 0;
+			if (rc)
+				goto next;
+		}
+		p->meta_gn = __le32_to_cpu(set->meta->meta_gn);
+		ent = (void *)reply + off;
+		ent->set_id = p->remote_set_id;
+		ent->flags = htonl(flags);
+		ent->data_off = htonl(doff);
+		ent->data_len = htonl(len);
+		memcpy(ent->data, (uint8_t *)set->meta + doff, len);
+		off += __push_ent_len(len);
+		count++;
+	next:
+		pthread_mutex_unlock(&set->lock);
+		ref_put(&set->ref, "push_pending");
+		free(pe);
+	}
+	if (count && !rc)
+		rc = __push_batch_send(x, reply, off, count);
+	if (rc && x->log)
+		x->log("%s: x %p: coalesced push error %d\n", __func__, x, rc);
+	free(reply);
+}
+
+static void *push_proc(void *arg)
+{
+	struct ldms_xprt *x;
+	struct timespec now;
+
+	pthread_mutex_lock(&push_lock);
+	while (1) {
+		x = TAILQ_FIRST(&push_xprt_list);
+		if (!x) {
+			pthread_cond_wait(&push_cv, &push_lock);
+			continue;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (now.tv_sec < x->push_due.tv_sec ||
+		    (now.tv_sec == x->push_due.tv_sec &&
+		     now.tv_nsec < x->push_due.tv_nsec)) {
+			pthread_cond_timedwait(&push_cv, &push_lock,
+					       &x->push_due);
+			continue;
+		}
+		TAILQ_REMOVE(&push_xprt_list, x, push_entry);
+		pthread_mutex_unlock(&push_lock);
+		__push_flush(x);
+		ldms_xprt_put(x); /* taken in __push_pending_add() */
+		pthread_mutex_lock(&push_lock);
+	}
+	return NULL;
+}
+
+/*
+ * Queue \c pe for the next coalesced push to \c x. The caller holds the
+ * set lock and the transport lock. The window is the same for all
+ * transports, so the list of the push thread is in due time order.
+ */
+static int __push_pending_queue(struct ldms_xprt *x,
+				struct ldms_push_pending *pe,
+				uint32_t window_us)
+{
+	int rc;
+
+	if (TAILQ_EMPTY(&x->push_pending)) {
+		pthread_mutex_lock(&push_lock);
+		if (!push_thread_started) {
+			rc = pthread_create(&push_thread, NULL, push_proc, NULL);
+			if (rc) {
+				pthread_mutex_unlock(&push_lock);
+				return rc;
+			}
+			pthread_setname_np(push_thread, "ldms_push");
+			push_thread_started = 1;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &x->push_due);
+		x->push_due.tv_nsec += (window_us % 1000000) * 1000;
+		x->push_due.tv_sec += window_us / 1000000
+					+ x->push_due.tv_nsec / 1000000000;
+		x->push_due.tv_nsec %= 1000000000;
+		if (TAILQ_EMPTY(&push_xprt_list))
+			pthread_cond_signal(&push_cv);
+		TAILQ_INSERT_TAIL(&push_xprt_list, ldms_xprt_get(x), push_entry);
+		pthread_mutex_unlock(&push_lock);
+	}
+	TAILQ_INSERT_TAIL(&x->push_pending, pe, entry);
+	return 0;
+}
+
+/* Queue the set for the next coalesced push to \c x, see above */
+static int __push_pending_add(struct ldms_xprt *x, struct ldms_set *set,
+			      uint32_t window_us)
+{
+	struct ldms_push_pending *pe;
+	int rc;
+
+	pe = malloc(sizeof(*pe));
+	if (!pe)
+		return ENOMEM;
+	pe->set = set;
+	rc = __push_pending_queue(x, pe, window_us);
+	if (rc) {
+		free(pe);
+		return rc;
+	}
+	ref_get(&set->ref, "push_pending");
+	return 0;
+}
+
 int __ldms_xprt_push(ldms_set_t set, int push_flags)
 {
 	int rc = 0;
@@ -3658,9 +5477,12 @@ int __ldms_xprt_push(ldms_set_t set, int push_flags)
 	uint32_t meta_meta_gn = __le32_to_cpu(set->meta->meta_gn);
 	uint32_t meta_meta_sz = __le32_to_cpu(set->meta->meta_sz);
 	uint32_t meta_data_heap_sz = __le32_to_cpu(set->meta->data_sz);
+	uint32_t window_us;
 	struct rbn *rbn;
 	struct ldms_push_peer *p;
 
+	pthread_once(&push_once, push_init_once);
+	window_us = __atomic_load_n(&push_window_us, __ATOMIC_SEQ_CST);
 	pthread_mutex_lock(&set->lock);
 	RBT_FOREACH(rbn, &set->push_coll) {
 		p = container_of(rbn, struct ldms_push_peer, rbn);
@@ -3678,6 +5500,20 @@ int __ldms_xprt_push(ldms_set_t set, int push_flags)
 		size_t len;
 		size_t max_len = zap_max_msg(x->zap);
 
+		if (p->pending)
+			goto skip; /* the coalesced push sends the latest data */
+		if (window_us && (x->peer_features & LDMS_CONN_F_PUSH_BATCH) &&
+		    sizeof(struct ldms_reply_hdr)
+		    + sizeof(struct ldms_push_batch_reply)
+		    + __push_ent_len(meta_meta_sz + meta_data_heap_sz)
+		    <= max_len) {
+			if (0 == __push_pending_add(x, set, window_us)) {
+				p->pending = 1;
+				goto skip;
+			}
+			/* push it right away */
+		}
+
 		if (p->meta_gn != meta_meta_gn) {
 			p->meta_gn = meta_meta_gn;
 			len = meta_meta_sz + meta_data_heap_sz;
@@ -3698,6 +5534,7 @@ int __ldms_xprt_push(ldms_set_t set, int push_flags)
 		       ldms_set_instance_name_get(set),
 		       x->zap_ep);
 #endif /* PUSH_DEBUG */
+		x->stats.push_set++;
 		while (len) {
 			size_t data_len;
 
@@ -3722,6 +5559,7 @@ int __ldms_xprt_push(ldms_set_t set, int push_flags)
 			rc = zap_send(x->zap_ep, reply, hdr_len + data_len);
 			if (rc)
 				break;
+			x->stats.push_msg++;
 			doff += data_len;
 			len -= data_len;
 		}
@@ -3749,12 +5587,11 @@ int ldms_xprt_connect(ldms_t x, struct sockaddr *sa, socklen_t sa_len,
 	int rc;
  	struct ldms_xprt *_x = x;
 	struct ldms_conn_msg msg;
-	__ldms_xprt_conn_msg_init(x, &msg);
+	size_t len = __ldms_xprt_conn_msg_init(x, &msg);
 	_x->event_cb = cb;
 	_x->event_cb_arg = cb_arg;
 	ldms_xprt_get(x);
-	rc = zap_connect(_x->zap_ep, sa, sa_len,
-			 (void*)&msg, sizeof(msg.ver) + strlen(msg.auth_name) + 1);
+	rc = zap_connect(_x->zap_ep, sa, sa_len, (void*)&msg, len);
 	if (rc) {
 		__ldms_xprt_resource_free(x);
 		ldms_xprt_put(x);
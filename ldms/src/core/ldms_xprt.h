@@ -90,6 +90,7 @@ struct ldms_push_peer {
 	uint64_t remote_set_id; /* set_id of the peer */
 	uint32_t push_flags;    /* PUSH flags */
 	uint64_t meta_gn; /* track the meta_gn of the last push */
+	int pending;	/* queued for a coalesced push, see __ldms_xprt_push() */
 	struct rbn rbn;
 	struct ev_s ev;
 };
@@ -121,6 +122,7 @@ enum ldms_request_cmd {
 	LDMS_CMD_CANCEL_PUSH,
 	LDMS_CMD_AUTH,
 	LDMS_CMD_SET_DELETE,
+	LDMS_CMD_UPDATE_BATCH,
 	LDMS_CMD_REPLY = 0x100,
 	LDMS_CMD_DIR_REPLY,
 	LDMS_CMD_DIR_CANCEL_REPLY,
@@ -132,13 +134,26 @@ enum ldms_request_cmd {
 	LDMS_CMD_PUSH_REPLY,
 	LDMS_CMD_AUTH_REPLY,
 	LDMS_CMD_SET_DELETE_REPLY,
+	LDMS_CMD_UPDATE_BATCH_REPLY,
+	LDMS_CMD_PUSH_BATCH_REPLY,
 	/* Transport private requests set bit 32 */
 	LDMS_CMD_XPRT_PRIVATE = 0x80000000,
 };
 
+/*
+ * Features of the sender. The flags follow the NUL of auth_name
+ * (unaligned, little endian), peers that predate them end the message
+ * at the NUL or send zeros.
+ */
+#define LDMS_CONN_F_DIR_BIN	1 /*! Binary and incremental directory */
+#define LDMS_CONN_F_PUSH_BATCH	2 /*! Coalesced push replies */
+#define LDMS_CONN_F_UPDATE_BATCH 4 /*! LDMS_CMD_UPDATE_BATCH requests */
+#define LDMS_CONN_FEATURES	(LDMS_CONN_F_DIR_BIN|LDMS_CONN_F_PUSH_BATCH|\
+				 LDMS_CONN_F_UPDATE_BATCH)
 struct ldms_conn_msg {
 	struct ldms_version ver;
 	char auth_name[LDMS_AUTH_NAME_MAX + 1];
+	char features[sizeof(uint32_t)]; /* room for the feature flags */
 };
 
 struct ldms_send_cmd_param {
@@ -152,8 +167,18 @@ struct ldms_lookup_cmd_param {
 	char path[LDMS_LOOKUP_PATH_MAX+1];
 };
 
+/*
+ * A requester that sets LDMS_DIR_F_BIN wants ldms_dir_bin_hdr replies
+ * and may ask for only the changes since generation dir_gn of the
+ * directory dir_id. The flag is only sent to peers that advertise
+ * LDMS_CONN_F_DIR_BIN.
+ */
+#define LDMS_DIR_F_BIN		0x100
 struct ldms_dir_cmd_param {
 	uint32_t flags;		/*! Directory update flags */
+	uint32_t reserved;
+	uint64_t dir_id;	/*! The directory the requester has a copy of */
+	uint64_t dir_gn;	/*! The generation of that copy */
 };
 
 struct ldms_set_delete_cmd_param {
@@ -174,6 +199,18 @@ struct ldms_cancel_push_cmd_param {
 	uint64_t set_id;	/*! The set we want to cancel push updates for  */
 };
 
+#define LDMS_UPDATE_BATCH_F_DELTA 1 /*! Changed data ranges are wanted */
+struct ldms_update_batch_set {
+	uint64_t set_id;	/*! The peer set_id */
+	uint64_t gn;		/*! The data gn of the requester's copy */
+};
+
+struct ldms_update_batch_cmd_param {
+	uint32_t count;		/*! The number of sets */
+	uint32_t flags;		/*! LDMS_UPDATE_BATCH_F_XXX */
+	struct ldms_update_batch_set set[OVIS_FLEX];
+};
+
 struct ldms_request_hdr {
 	uint64_t xid;		/*! Transaction id returned in reply */
 	uint32_t cmd;		/*! The operation being requested  */
@@ -190,6 +227,7 @@ struct ldms_request {
 		struct ldms_req_notify_cmd_param req_notify;
 		struct ldms_cancel_notify_cmd_param cancel_notify;
 		struct ldms_cancel_push_cmd_param cancel_push;
+		struct ldms_update_batch_cmd_param update_batch;
 	};
 };
 
@@ -235,6 +273,49 @@ struct ldms_dir_reply {
 	char json_data[OVIS_FLEX];
 };
 
+/*
+ * With LDMS_DIR_TYPE_F_BIN in ldms_dir_reply.type, json_data holds an
+ * ldms_dir_bin_hdr followed by \c count entries. With
+ * LDMS_DIR_BIN_F_DELTA, the entries are the changes since the
+ * generation in the request, otherwise they replace the requester's
+ * copy. The numbers are little endian.
+ */
+#define LDMS_DIR_TYPE_F_BIN	0x100
+#define LDMS_DIR_BIN_F_DELTA	1
+struct ldms_dir_bin_hdr {
+	uint64_t dir_id;	/*! The directory instance of the peer */
+	uint64_t dir_gn;	/*! The generation the reply brings the copy to */
+	uint32_t count;		/*! The number of entries in this reply */
+	uint32_t flags;		/*! LDMS_DIR_BIN_F_XXX */
+	char entries[OVIS_FLEX];
+};
+
+/*
+ * A set in a binary directory reply. The fixed part is followed by
+ * NUL terminated strings: the instance name, schema name, digest,
+ * state flags and permission, then the key and value of each set
+ * info pair. An LDMS_DIR_BIN_E_DEL entry only has the instance name.
+ * The next entry starts 8-byte aligned.
+ */
+#define LDMS_DIR_BIN_E_DEL	1 /*! The set is no longer published */
+struct ldms_dir_bin_entry {
+	uint32_t len;		/*! Length of the entry and its strings */
+	uint32_t flags;		/*! LDMS_DIR_BIN_E_XXX */
+	uint32_t meta_size;
+	uint32_t data_size;
+	uint32_t heap_size;
+	uint32_t uid;
+	uint32_t gid;
+	uint32_t card;
+	uint32_t array_card;
+	uint32_t info_count;
+	uint64_t meta_gn;
+	uint64_t data_gn;
+	struct ldms_timestamp timestamp;
+	struct ldms_timestamp duration;
+	char str[OVIS_FLEX];
+};
+
 struct ldms_req_notify_reply {
 	struct ldms_notify_event_s event;
 };
@@ -254,6 +335,49 @@ struct ldms_push_reply {
 	char data[OVIS_FLEX];
 };
 
+/*
+ * The sets pushed to a peer within the push window (see
+ * ldms_xprt_push_coalesce_set()) are sent together. \c data holds
+ * \c count ldms_push_reply entries, each starting at an 8-byte aligned
+ * offset. Only sent to peers that advertise LDMS_CONN_F_PUSH_BATCH.
+ */
+struct ldms_push_batch_reply {
+	uint32_t count;
+	uint32_t reserved;
+	char data[OVIS_FLEX];
+};
+
+/*
+ * An entry of the update batch reply. \c data is the current data
+ * section of the set \c set[idx] of the request. \c data_len is 0 if
+ * \c rc is not 0.
+ *
+ * If \c flags has LDMS_UPDATE_BATCH_E_DELTA, \c data is a sequence of
+ * ldms_update_batch_range that brings a copy at data gn \c base_gn up
+ * to date. The first range is always the data header.
+ */
+#define LDMS_UPDATE_BATCH_E_DELTA 1
+struct ldms_update_batch_entry {
+	uint32_t idx;		/*! Index of the set in the request */
+	uint32_t rc;		/*! 0 or an errno */
+	uint32_t flags;		/*! LDMS_UPDATE_BATCH_E_XXX */
+	uint32_t data_len;
+	uint64_t base_gn;	/*! The gn the delta applies to */
+	char data[OVIS_FLEX];
+};
+
+struct ldms_update_batch_range {
+	uint32_t off;		/*! Offset from the data header */
+	uint32_t len;		/*! Length of data, the next range is 8-byte aligned */
+	char data[OVIS_FLEX];
+};
+
+struct ldms_update_batch_reply {
+	uint32_t more;		/*! !0 if more replies follow */
+	uint32_t count;		/*! The number of entries in this reply */
+	char entries[OVIS_FLEX];
+};
+
 struct ldms_reply_hdr {
 	uint64_t xid;
 	uint32_t cmd;
@@ -267,6 +391,8 @@ struct ldms_reply {
 		struct ldms_req_notify_reply req_notify;
 		struct ldms_auth_challenge_reply auth_challenge;
 		struct ldms_push_reply push;
+		struct ldms_push_batch_reply push_batch;
+		struct ldms_update_batch_reply update_batch;
 	};
 };
 #pragma pack()
@@ -282,6 +408,7 @@ typedef enum ldms_context_type {
 	LDMS_CONTEXT_PUSH,
 	LDMS_CONTEXT_UPDATE_META,
 	LDMS_CONTEXT_SET_DELETE,
+	LDMS_CONTEXT_UPDATE_BATCH,
 } ldms_context_type_t;
 
 struct ldms_context {
@@ -294,6 +421,7 @@ struct ldms_context {
 		struct {
 			ldms_dir_cb_t cb;
 			void *cb_arg;
+			ldms_dir_cache_t cache;
 		} dir;
 		struct {
 			ldms_lookup_cb_t cb;
@@ -326,11 +454,34 @@ struct ldms_context {
 			void *cb_arg;
 			int lookup;
 		} set_delete;
+		struct {
+			ldms_update_cb_t cb;
+			int count;
+			ldms_set_t *s;	/* sets in the order of the request */
+			void **cb_arg;	/* callback argument of each set */
+		} update_batch;
 	};
 	struct timespec start;
+	int pool_class;	/* size class, LDMS_CTXT_POOL_CLASSES if none */
 	TAILQ_ENTRY(ldms_context) link;
 };
 
+/*
+ * Contexts are kept for reuse in per-transport free lists by size class,
+ * so that the requests on the update path do not call malloc. A free
+ * list keeps as many contexts as were ever in use at once, up to
+ * LDMS_CTXT_POOL_MAX. A context larger than the largest class is
+ * allocated and freed every time.
+ */
+#define LDMS_CTXT_POOL_CLASSES 2
+#define LDMS_CTXT_POOL_MAX 1024
+
+/* A set waiting in ldms_xprt->push_pending, holds a set reference */
+struct ldms_push_pending {
+	struct ldms_set *set;
+	TAILQ_ENTRY(ldms_push_pending) entry;
+};
+
 #define LDMS_MAX_TRANSPORT_NAME_LEN 16
 
 struct ldms_xprt {
@@ -351,6 +502,10 @@ struct ldms_xprt {
 	uint64_t local_dir_xid;
 	/* This is the peers local_dir_xid that we provide when providing dir updates */
 	uint64_t remote_dir_xid;
+	/* !0 if the peer asked for binary dir updates */
+	int remote_dir_bin;
+	/* LDMS_CONN_F_XXX supported by both sides */
+	uint32_t peer_features;
 
 #ifdef DEBUG
 	int active_dir; /* Number of outstanding dir requests */
@@ -359,6 +514,22 @@ struct ldms_xprt {
 	int active_push; /* Number of outstanding push ctxt */
 #endif /* DEBUG */
 	TAILQ_HEAD(, ldms_context) ctxt_list;
+	/* Free contexts by size class, protected by lock */
+	struct {
+		TAILQ_HEAD(, ldms_context) list;
+		int count;	/* contexts in list */
+		int in_use;	/* contexts of this class in use */
+		int peak;	/* the most contexts ever in use */
+	} ctxt_pool[LDMS_CTXT_POOL_CLASSES];
+
+	/*
+	 * Sets to push with the next coalesced push, protected by lock.
+	 * The transport is on the push thread's list, holding a
+	 * reference, while the list is not empty.
+	 */
+	TAILQ_HEAD(, ldms_push_pending) push_pending;
+	struct timespec push_due;	/* when the push thread sends them */
+	TAILQ_ENTRY(ldms_xprt) push_entry;
 
 	/* Callback that receives the connection event and receive event */
 	ldms_event_cb_t event_cb;
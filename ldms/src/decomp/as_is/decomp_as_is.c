@@ -161,6 +161,24 @@ typedef struct __decomp_as_is_col_cfg_s {
 	int array_len; /* length of the array, if col_type is array */
 } *__decomp_as_is_col_cfg_t;
 
+/* per-column scratch state used while expanding a set into rows */
+typedef struct __decomp_as_is_col_mval_s {
+	__decomp_as_is_col_cfg_t dcol;
+	union {
+		ldms_mval_t set_mval;
+		ldms_mval_t lh;
+		ldms_mval_t rec_array;
+	};
+	union {
+		ldms_mval_t le;
+		ldms_mval_t rec;
+	};
+	ldms_mval_t col_mval;
+	size_t col_mlen;
+	int use_fill;
+	int rec_array_idx;
+} *__decomp_as_is_col_mval_t;
+
 typedef struct __decomp_as_is_row_cfg_s {
 	struct rbn rbn; /* rbn (inserted to cfg->row_cfg_rbt) */
 	char *schema_name; /* row schema name */
@@ -169,6 +187,9 @@ typedef struct __decomp_as_is_row_cfg_s {
 	__decomp_as_is_col_cfg_t cols; /* array of struct */
 	__decomp_index_t idxs; /* array of struct */
 	size_t row_sz;
+	struct ldms_digest_s digest; /* LDMS schema digest of the sets */
+	__decomp_as_is_col_mval_t col_mvals; /* decompose scratch paper */
+	struct ldmsd_row_list_s row_pool; /* released rows, ready for reuse */
 } *__decomp_as_is_row_cfg_t;
 
 int __row_cfg_cmp(void *tree_key, const void *key)
@@ -200,10 +221,43 @@ int str_int_cmp(const void *a, const void *b)
 	return strcmp(sa->str, sb->str);
 }
 
+static void __decomp_as_is_row_cfg_free(__decomp_as_is_row_cfg_t drow)
+{
+	ldmsd_row_t row;
+	int i;
+
+	while ((row = TAILQ_FIRST(&drow->row_pool))) {
+		TAILQ_REMOVE(&drow->row_pool, row, entry);
+		free(row);
+	}
+	if (drow->cols) {
+		for (i = 0; i < drow->col_count; i++) {
+			free(drow->cols[i].name);
+		}
+		free(drow->cols);
+	}
+	if (drow->idxs) {
+		for (i = 0; i < drow->idx_count; i++) {
+			if (!drow->idxs[i].col_idx)
+				continue;
+			free(drow->idxs[i].col_idx);
+		}
+		free(drow->idxs);
+	}
+	free(drow->col_mvals);
+	free(drow->schema_name);
+	free(drow);
+}
+
 static void __decomp_as_is_cfg_free(__decomp_as_is_cfg_t dcfg)
 {
 	int i, j;
 	__decomp_index_t didx;
+	struct rbn *rbn;
+	while ((rbn = rbt_min(&dcfg->row_cfg_rbt))) {
+		rbt_del(&dcfg->row_cfg_rbt, rbn);
+		__decomp_as_is_row_cfg_free((void*)rbn);
+	}
 	for (i = 0; i < dcfg->idx_count; i++) {
 		didx = &dcfg->idxs[i];
 		/* names in idx */
@@ -324,9 +378,22 @@ __get_row_cfg(__decomp_as_is_cfg_t dcfg, ldms_set_t set)
 	const char *mname;
 	const char *ss_name = ldms_set_schema_name_get(set);
 	ldms_digest_t ldms_digest = ldms_set_digest_get(set);
+	char buf[LDMS_SET_NAME_MAX];
 
 	assert(ss_name != NULL);
 	assert(ldms_digest != NULL);
+	/* look up with a name on the stack; allocate only for a new schema */
+	name_len = snprintf(buf, sizeof(buf), "%s_%02hhx%02hhx%02hhx%hhx",
+			ss_name,
+			ldms_digest->digest[0],
+			ldms_digest->digest[1],
+			ldms_digest->digest[2],
+			(unsigned char)(ldms_digest->digest[3] >> 4));
+	if (name_len > 0 && name_len < sizeof(buf)) {
+		drow = (void*)rbt_find(&dcfg->row_cfg_rbt, buf);
+		if (drow)
+			return drow;
+	}
 	name_len = asprintf(&name, "%s_%02hhx%02hhx%02hhx%hhx",
 			ldms_set_schema_name_get(set),
 			ldms_digest->digest[0],
@@ -410,11 +477,16 @@ __get_row_cfg(__decomp_as_is_cfg_t dcfg, ldms_set_t set)
 	drow->schema_name = name; /* give `name` to decomp row config */
 	drow->idx_count = dcfg->idx_count;
 	drow->col_count = col_count;
+	memcpy(&drow->digest, ldms_digest, sizeof(drow->digest));
+	TAILQ_INIT(&drow->row_pool);
 	rbn_init(&drow->rbn, drow->schema_name);
 	name = NULL;
 	drow->cols = calloc(col_count, sizeof(drow->cols[0]));
 	if (!drow->cols)
 		goto err;
+	drow->col_mvals = calloc(col_count, sizeof(drow->col_mvals[0]));
+	if (!drow->col_mvals)
+		goto err;
 	drow->idxs = calloc(dcfg->idx_count, sizeof(drow->idxs[0]));
 	if (!drow->idxs)
 		goto err;
@@ -575,27 +647,80 @@ __get_row_cfg(__decomp_as_is_cfg_t dcfg, ldms_set_t set)
 	return drow;
 
  err:
-	if (drow->cols) {
-		for (i = 0; i < drow->col_count; i++) {
-			free(drow->cols[i].name);
+	__decomp_as_is_row_cfg_free(drow);
+	return NULL;
+}
+
+static union ldms_value fill = {0};
+
+/*
+ * Get a row for `drow` from its pool, or allocate a new one. The parts of
+ * a row that depend only on the row configuration (schema, column names,
+ * types, index wiring and the phony timestamp slot) are set up once when
+ * the row is allocated and kept while the row sits in the pool.
+ */
+static ldmsd_row_t __decomp_as_is_row_get(__decomp_as_is_row_cfg_t drow)
+{
+	ldmsd_row_t row;
+	ldmsd_col_t col;
+	ldmsd_row_index_t idx;
+	__decomp_as_is_col_cfg_t dcol;
+	int j, k, c;
+
+	row = TAILQ_FIRST(&drow->row_pool);
+	if (row) {
+		TAILQ_REMOVE(&drow->row_pool, row, entry);
+		return row;
+	}
+	row = calloc(1, drow->row_sz);
+	if (!row)
+		return NULL;
+	row->schema_name = drow->schema_name;
+	row->schema_digest = &drow->digest;
+	row->idx_count = drow->idx_count;
+	row->col_count = drow->col_count;
+
+	/*
+	 * row memory format:
+	 * - ldmsd_row_s
+	 * - cols[] (array of col structure)
+	 * - idx[idx_count] (array of pointers)
+	 * - idx[0] structure
+	 * - idx[1] structure
+	 * - ...
+	 * - idx[idx_count-1] structure
+	 * - phony[0] (for phony metrics such as timestamp)
+	 */
+
+	/* indices */
+	row->indices = (void*)&row->cols[row->col_count];
+	idx = (void*)&row->indices[row->idx_count];
+	for (j = 0; j < row->idx_count; j++) {
+		row->indices[j] = idx;
+		idx->col_count = drow->idxs[j].col_count;
+		idx->name = drow->idxs[j].name;
+		for (k = 0; k < idx->col_count; k++) {
+			c = drow->idxs[j].col_idx[k];
+			idx->cols[k] = &row->cols[c];
 		}
-		free(drow->cols);
+		idx = (void*)&idx->cols[idx->col_count];
 	}
-	if (drow->idxs) {
-		for (i = 0; i < drow->idx_count; i++) {
-			if (!drow->idxs[i].col_idx)
-				continue;
-			free(drow->idxs[i].col_idx);
+
+	for (j = 0; j < row->col_count; j++) {
+		col = &row->cols[j];
+		dcol = &drow->cols[j];
+		col->metric_id = dcol->set_mid;
+		col->rec_metric_id = dcol->rec_mid;
+		col->name = dcol->name;
+		col->type = dcol->col_type;
+		if (dcol->set_mid == LDMSD_PHONY_METRIC_ID_TIMESTAMP) {
+			/* phony mvals are next to the idx data */
+			col->mval = (void*)idx;
 		}
-		free(drow->idxs);
 	}
-	free(drow->schema_name);
-	free(drow);
-	return NULL;
+	return row;
 }
 
-static union ldms_value fill = {0};
-
 static int __decomp_as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 				    ldmsd_row_list_t row_list, int *row_count)
 {
@@ -604,47 +729,20 @@ static int __decomp_as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	__decomp_as_is_col_cfg_t dcol;
 	ldmsd_row_t row;
 	ldmsd_col_t col;
-	ldmsd_row_index_t idx;
 	ldms_mval_t mval, lh, le;
 	enum ldms_value_type mtype;
 	size_t mlen;
-	int j, k, c, mid, rc, rec_mid;
+	int j, mid, rc, rec_mid;
 	int col_count;
-	struct _col_mval_s {
-		__decomp_as_is_col_cfg_t dcol;
-		union {
-			ldms_mval_t set_mval;
-			ldms_mval_t lh;
-			ldms_mval_t rec_array;
-		};
-		union {
-			ldms_mval_t le;
-			ldms_mval_t rec;
-		};
-		ldms_mval_t col_mval;
-		size_t col_mlen;
-		int use_fill;
-		int rec_array_idx;
-	} *col_mvals = NULL, *mcol;
-	ldms_digest_t ldms_digest;
-	TAILQ_HEAD(, _list_entry) list_cols;
+	__decomp_as_is_col_mval_t col_mvals, mcol;
 	int row_more_le;
 	struct ldms_timestamp ts;
-	const char *set_schema;
-	int row_schema_name_len;
-	ldms_mval_t phony;
-	char *row_schema_name = NULL;
 
 	if (!TAILQ_EMPTY(row_list))
 		return EINVAL;
 
 	ts = ldms_transaction_timestamp_get(set);
 
-	set_schema = ldms_set_schema_name_get(set);
-
-	TAILQ_INIT(&list_cols);
-	ldms_digest = ldms_set_digest_get(set);
-
 	/*
 	 * NOTE Create rows from the set as-is, with list entry expansion.
 	 *
@@ -653,14 +751,6 @@ static int __decomp_as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	 * representation of the SHA (similar to git short commit ID).
 	 *
 	 */
-	row_schema_name_len = asprintf(&row_schema_name, "%s_%02hhx%02hhx%02hhx%hhx", set_schema,
-			ldms_digest->digest[0],
-			ldms_digest->digest[1],
-			ldms_digest->digest[2],
-			(unsigned char)(ldms_digest->digest[3] >> 4));
-	if (row_schema_name_len < 0)
-		return errno;
-
 	drow = __get_row_cfg(dcfg, set);
 	if (!drow)
 		return errno;
@@ -669,14 +759,10 @@ static int __decomp_as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 
 	*row_count = 0;
 
-	/* col_mvals is a temporary scratch paper to create rows from
-	 * a set with records. col_mvals is freed at the end of
-	 * `make_row`. */
-	col_mvals = calloc(col_count, sizeof(col_mvals[0]));
-	if (!col_mvals) {
-		rc = ENOMEM;
-		goto err_0;
-	}
+	/* col_mvals is the scratch paper of the row config to create rows
+	 * from a set with records. */
+	col_mvals = drow->col_mvals;
+	memset(col_mvals, 0, col_count * sizeof(col_mvals[0]));
 	for (j = 0; j < col_count; j++) {
 		dcol = &drow->cols[j];
 		mcol = &col_mvals[j];
@@ -686,16 +772,14 @@ static int __decomp_as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 		mcol->le = NULL;
 
 		if (mid == LDMSD_PHONY_METRIC_ID_TIMESTAMP) {
-			/* mcol->mval will be assigned in `make_row` */
+			/* the row has the phony slot for the value */
 			continue;
 		}
 
 		assert(mid < LDMSD_PHONY_METRIC_ID_FIRST);
 
 		mcol->set_mval = ldms_metric_get(set, mid);
-		mtype = ldms_metric_type_get(set, mid);
-
-		assert( mcol->dcol->set_mtype == mtype );
+		mtype = dcol->set_mtype;
 
 		if (mtype == LDMS_V_LIST)
 			goto col_mvals_list;
@@ -704,7 +788,7 @@ static int __decomp_as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 		assert(mtype <= LDMS_V_D64_ARRAY);
 		/* primitives & array of primitives */
 		mcol->col_mval = mcol->set_mval;
-		mcol->col_mlen = ldms_metric_array_get_len(set, dcol->set_mid);
+		mcol->col_mlen = dcol->array_len;
 		continue;
 
 	col_mvals_list:
@@ -762,44 +846,11 @@ static int __decomp_as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	}
 
  make_row: /* make/expand rows according to col_mvals */
-	row = calloc( 1, drow->row_sz );
+	row = __decomp_as_is_row_get(drow);
 	if (!row) {
 		rc = errno;
 		goto err_0;
 	}
-	row->schema_name = drow->schema_name;
-	row->schema_digest = ldms_digest;
-	row->idx_count = drow->idx_count;
-	row->col_count = drow->col_count;
-
-	/*
-	 * row memory format:
-	 * - ldmsd_row_s
-	 * - cols[] (array of col structure)
-	 * - idx[idx_count] (array of pointers)
-	 * - idx[0] structure
-	 * - idx[1] structure
-	 * - ...
-	 * - idx[idx_count-1] structure
-	 * - phony[0] (for phony metrics such as timestamp)
-	 */
-
-	/* indices */
-	row->indices = (void*)&row->cols[row->col_count];
-	idx = (void*)&row->indices[row->idx_count];
-	for (j = 0; j < row->idx_count; j++) {
-		row->indices[j] = idx;
-		idx->col_count = drow->idxs[j].col_count;
-		idx->name = drow->idxs[j].name;
-		for (k = 0; k < idx->col_count; k++) {
-			c = drow->idxs[j].col_idx[k];
-			idx->cols[k] = &row->cols[c];
-		}
-		idx = (void*)&idx->cols[idx->col_count];
-	}
-
-	/* phony mvals are next to the idx data */
-	phony = (void*)idx;
 
 	row_more_le = 0;
 	/* cols */
@@ -808,15 +859,10 @@ static int __decomp_as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 		dcol = &drow->cols[j];
 		mcol = &col_mvals[j];
 
-		col->metric_id = dcol->set_mid;
-		col->rec_metric_id = dcol->rec_mid;
-
-		col->name = dcol->name;
-		col->type = dcol->col_type;
 		col->array_len = mcol->col_mlen;
 		if (dcol->set_mid == LDMSD_PHONY_METRIC_ID_TIMESTAMP) {
-			phony->v_ts = ts;
-			col->mval = phony;
+			/* col->mval is the phony slot in the row */
+			col->mval->v_ts = ts;
 		} else {
 			col->mval = mcol->col_mval;
 		}
@@ -866,23 +912,23 @@ static int __decomp_as_is_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	row = NULL;
 	if (row_more_le)
 		goto make_row;
-	free(col_mvals);
-	col_mvals = NULL;
 	return 0;
  err_0:
 	/* clean up stuff here */
-	if (col_mvals)
-		free(col_mvals);
 	__decomp_as_is_release_rows(strgp, row_list);
 	return rc;
 }
 
+/* Rows go back to the pool of their row configuration for reuse */
 static void __decomp_as_is_release_rows(ldmsd_strgp_t strgp,
 					 ldmsd_row_list_t row_list)
 {
+	__decomp_as_is_row_cfg_t drow;
 	ldmsd_row_t row;
 	while ((row = TAILQ_FIRST(row_list))) {
 		TAILQ_REMOVE(row_list, row, entry);
-		free(row);
+		drow = container_of(row->schema_digest,
+				    struct __decomp_as_is_row_cfg_s, digest);
+		TAILQ_INSERT_HEAD(&drow->row_pool, row, entry);
 	}
 }
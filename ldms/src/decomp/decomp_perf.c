@@ -0,0 +1,323 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Decomposition microbenchmark.
+ *
+ * Builds a local set with scalar metrics and a list of records, loads a
+ * decomposer plugin the same way ldmsd does and times decompose() /
+ * release_rows() cycles on the set. Heap allocations made by the
+ * decomposer are counted by interposing malloc() and calloc().
+ *
+ * usage: decomp_perf [-d static|as_is] [-n <updates>] [-m <metrics>]
+ *                    [-l <list entries>]
+ *
+ * The plugin is looked up in LDMSD_PLUGIN_LIBPATH (default: the ldmsd
+ * plugin directory).
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <limits.h>
+#include <time.h>
+
+#include "ovis_json/ovis_json.h"
+#include "ldms.h"
+#include "ldmsd.h"
+#include "ldmsd_request.h"
+
+/* ---- allocation counting ---- */
+
+extern void *__libc_malloc(size_t sz);
+extern void *__libc_calloc(size_t n, size_t sz);
+static uint64_t alloc_count;
+
+void *malloc(size_t sz)
+{
+	__atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+	return __libc_malloc(sz);
+}
+
+void *calloc(size_t n, size_t sz)
+{
+	__atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+	return __libc_calloc(n, sz);
+}
+
+/* ---- symbols a decomposer plugin expects from ldmsd ---- */
+
+void ldmsd_lerror(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+size_t Snprintf(char **dst, size_t *len, char *fmt, ...)
+{
+	va_list ap;
+	size_t cnt;
+
+	if (!*dst) {
+		*len = 1024;
+		*dst = __libc_malloc(*len);
+		if (!*dst)
+			return -1;
+	}
+	va_start(ap, fmt);
+	cnt = vsnprintf(*dst, *len, fmt, ap);
+	va_end(ap);
+	return cnt;
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static ldmsd_decomp_t decomp_load(const char *name)
+{
+	char lib[PATH_MAX];
+	const char *dir = getenv("LDMSD_PLUGIN_LIBPATH");
+	ldmsd_decomp_t (*get)();
+	void *d;
+	int len;
+
+	if (!dir)
+		dir = PLUGINDIR;
+	/* only the first directory of the path */
+	len = strcspn(dir, ":");
+	snprintf(lib, sizeof(lib), "%.*s/libdecomp_%s.so", len, dir, name);
+	d = dlopen(lib, RTLD_NOW);
+	if (!d) {
+		printf("dlopen(%s) error: %s\n", lib, dlerror());
+		return NULL;
+	}
+	get = dlsym(d, "get");
+	if (!get) {
+		printf("'%s' has no get()\n", lib);
+		return NULL;
+	}
+	return get();
+}
+
+static ldms_set_t set_create(int m, int l)
+{
+	char name[32];
+	ldms_schema_t schema;
+	ldms_record_t rec_def;
+	ldms_set_t set;
+	ldms_mval_t lh, rec;
+	size_t heap_sz;
+	int i, rec_idx, lh_idx;
+
+	schema = ldms_schema_new("bench");
+	if (!schema)
+		return NULL;
+	ldms_schema_metric_add(schema, "component_id", LDMS_V_U64);
+	for (i = 0; i < m; i++) {
+		snprintf(name, sizeof(name), "m%d", i);
+		ldms_schema_metric_add(schema, name, LDMS_V_U64);
+	}
+	rec_def = ldms_record_create("rec");
+	ldms_record_metric_add(rec_def, "a", "", LDMS_V_U64, 1);
+	ldms_record_metric_add(rec_def, "b", "", LDMS_V_D64, 1);
+	rec_idx = ldms_schema_record_add(schema, rec_def);
+	heap_sz = (l + 1) * ldms_record_heap_size_get(rec_def);
+	lh_idx = ldms_schema_metric_list_add(schema, "list", NULL, heap_sz);
+
+	set = ldms_set_new("bench/0", schema);
+	ldms_schema_delete(schema);
+	if (!set)
+		return NULL;
+	ldms_set_producer_name_set(set, "bench");
+	ldms_transaction_begin(set);
+	ldms_metric_set_u64(set, 0, 1);
+	for (i = 0; i < m; i++)
+		ldms_metric_set_u64(set, i + 1, i);
+	lh = ldms_metric_get(set, lh_idx);
+	for (i = 0; i < l; i++) {
+		rec = ldms_record_alloc(set, rec_idx);
+		if (!rec)
+			return NULL;
+		ldms_record_set_u64(rec, 0, i);
+		ldms_record_set_double(rec, 1, i / 2.0);
+		ldms_list_append_record(set, lh, rec);
+	}
+	ldms_transaction_end(set);
+	return set;
+}
+
+static char *static_cfg(int m)
+{
+	char *buf;
+	size_t sz;
+	FILE *f;
+	int i;
+
+	f = open_memstream(&buf, &sz);
+	if (!f)
+		return NULL;
+	fprintf(f, "{\"type\":\"static\",\"rows\":[{\"schema\":\"bench\","
+		   "\"cols\":["
+		   "{\"src\":\"timestamp\",\"dst\":\"ts\",\"type\":\"ts\"},"
+		   "{\"src\":\"producer\",\"dst\":\"prdcr\",\"type\":\"char_array\",\"array_len\":64},"
+		   "{\"src\":\"component_id\",\"dst\":\"comp\",\"type\":\"u64\"}");
+	for (i = 0; i < m; i++)
+		fprintf(f, ",{\"src\":\"m%d\",\"dst\":\"m%d\",\"type\":\"u64\"}", i, i);
+	fprintf(f, ",{\"src\":\"list\",\"rec_member\":\"a\",\"dst\":\"a\",\"type\":\"u64\"}"
+		   ",{\"src\":\"list\",\"rec_member\":\"b\",\"dst\":\"b\",\"type\":\"d64\"}"
+		   "],\"indices\":[{\"name\":\"time_comp\",\"cols\":[\"ts\",\"comp\"]}]}]}");
+	fclose(f);
+	return buf;
+}
+
+static void usage(const char *argv0)
+{
+	printf("usage: %s [-d static|as_is] [-n <updates>] [-m <metrics>] "
+	       "[-l <list entries>]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+	struct ldmsd_row_list_s row_list = TAILQ_HEAD_INITIALIZER(row_list);
+	struct ldmsd_strgp strgp = {0};
+	const char *dname = "static";
+	int n = 100000, m = 64, l = 16;
+	ldmsd_decomp_t api;
+	json_parser_t jp;
+	json_entity_t jcfg;
+	ldms_set_t set;
+	char *cfg;
+	uint64_t allocs, rows;
+	double t0, t;
+	int op, i, rc, row_count;
+
+	while ((op = getopt(argc, argv, "d:n:m:l:h")) != -1) {
+		switch (op) {
+		case 'd':
+			dname = optarg;
+			break;
+		case 'n':
+			n = atoi(optarg);
+			break;
+		case 'm':
+			m = atoi(optarg);
+			break;
+		case 'l':
+			l = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return op == 'h' ? 0 : EINVAL;
+		}
+	}
+
+	ldms_init(16 * 1024 * 1024);
+	set = set_create(m, l);
+	if (!set) {
+		printf("cannot create the set: %d\n", errno);
+		return 1;
+	}
+
+	api = decomp_load(dname);
+	if (!api)
+		return 1;
+	if (0 == strcmp(dname, "static"))
+		cfg = static_cfg(m);
+	else
+		cfg = strdup("{\"type\":\"as_is\",\"indices\":"
+			     "[{\"name\":\"time\",\"cols\":[\"timestamp\"]}]}");
+	jp = json_parser_new(0);
+	rc = json_parse_buffer(jp, cfg, strlen(cfg), &jcfg);
+	if (rc) {
+		printf("config parse error: %d\n", rc);
+		return 1;
+	}
+	strgp.obj.name = "bench";
+	strgp.decomp = api->config(&strgp, jcfg, NULL);
+	if (!strgp.decomp) {
+		printf("decomposer config error: %d\n", errno);
+		return 1;
+	}
+
+	/* warm up: resolve the set schema and fill the row pools */
+	rc = strgp.decomp->decompose(&strgp, set, &row_list, &row_count);
+	if (rc) {
+		printf("decompose error: %d\n", rc);
+		return 1;
+	}
+	strgp.decomp->release_rows(&strgp, &row_list);
+
+	rows = 0;
+	allocs = alloc_count;
+	t0 = now();
+	for (i = 0; i < n; i++) {
+		strgp.decomp->decompose(&strgp, set, &row_list, &row_count);
+		rows += row_count;
+		strgp.decomp->release_rows(&strgp, &row_list);
+	}
+	t = now() - t0;
+	allocs = alloc_count - allocs;
+
+	printf("decomp: %s, metrics: %d, list entries: %d\n", dname, m, l);
+	printf("updates: %d, rows: %lu\n", n, rows);
+	printf("%.0f ns/update, %.0f rows/sec, %.2f allocations/update\n",
+	       t * 1e9 / n, rows / t, (double)allocs / n);
+
+	strgp.decomp->release_decomp(&strgp);
+	json_entity_free(jcfg);
+	json_parser_free(jp);
+	free(cfg);
+	ldms_set_delete(set);
+	return 0;
+}
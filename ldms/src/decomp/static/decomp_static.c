@@ -340,6 +340,7 @@ typedef struct __decomp_static_row_cfg_s {
 	struct ldms_digest_s schema_digest;
 	size_t row_sz;
 	struct rbt mid_rbt; /* collection of metric IDs mapping */
+	struct ldmsd_row_list_s row_pool; /* released rows, ready for reuse */
 } *__decomp_static_row_cfg_t;
 
 typedef struct __decomp_static_cfg_s {
@@ -348,15 +349,38 @@ typedef struct __decomp_static_cfg_s {
 	struct __decomp_static_row_cfg_s rows[OVIS_FLEX];
 } *__decomp_static_cfg_t;
 
+/* per-column scratch state used while expanding a set into rows */
+typedef struct __decomp_static_col_mval_s {
+	ldms_mval_t mval;
+	ldms_mval_t rec_array;
+	union {
+		ldms_mval_t le;
+		ldms_mval_t rec;
+	};
+	enum ldms_value_type mtype;
+	size_t array_len;
+	int metric_id;
+	int rec_metric_id;
+	int rec_array_len;
+	int rec_array_idx;
+} *__decomp_static_col_mval_t;
+
+/*
+ * The row plan of an LDMS schema (by digest): the metric resolution of
+ * each column, and the scratch `col_mvals` reused by every decompose
+ * call of sets having this digest. Protected by strgp->lock.
+ */
 typedef struct __decomp_static_mid_rbn_s {
 	struct rbn rbn;
 	struct ldms_digest_s ldms_digest;
 	int col_count;
+	__decomp_static_col_mval_t col_mvals; /* col_count entries */
 	struct {
 		int mid;
 		int rec_mid;
 		enum ldms_value_type mtype;
 		enum ldms_value_type rec_mtype;
+		int array_len; /* array length of a primitive metric */
 	} col_mids[OVIS_FLEX];
 } *__decomp_static_mid_rbn_t;
 
@@ -387,8 +411,20 @@ static void __decomp_static_cfg_free(__decomp_static_cfg_t dcfg)
 	int i, j;
 	struct __decomp_static_row_cfg_s *drow;
 	struct __decomp_static_col_cfg_s *dcol;
+	struct rbn *rbn;
+	ldmsd_row_t row;
 	for (i = 0; i < dcfg->row_count; i++) {
 		drow = &dcfg->rows[i];
+		/* row plans */
+		while ((rbn = rbt_min(&drow->mid_rbt))) {
+			rbt_del(&drow->mid_rbt, rbn);
+			free(rbn);
+		}
+		/* pooled rows */
+		while ((row = TAILQ_FIRST(&drow->row_pool))) {
+			TAILQ_REMOVE(&drow->row_pool, row, entry);
+			free(row);
+		}
 		/* cols */
 		for (j = 0; j < drow->col_count; j++) {
 			dcol = &drow->cols[j];
@@ -464,6 +500,7 @@ __decomp_static_config( ldmsd_strgp_t strgp, json_entity_t jcfg,
 		drow->row_sz = sizeof(struct ldmsd_row_s);
 		SHA256_Init(&sha_ctxt);
 		rbt_init(&drow->mid_rbt, __mid_rbn_cmp);
+		TAILQ_INIT(&drow->row_pool);
 
 		/* schema name */
 		jsch = __jdict_str(jrow, "schema");
@@ -782,6 +819,7 @@ static int __decomp_static_resolve_mid(__decomp_static_mid_rbn_t mid_rbn,
 			mid_rbn->col_mids[i].mid = -EINVAL;
 			continue;
 		}
+		mid_rbn->col_mids[i].array_len = ldms_metric_array_get_len(set, mid);
 		mid_rbn->col_mids[i].rec_mid = -EINVAL;
 		mid_rbn->col_mids[i].rec_mtype = LDMS_V_NONE;
 		continue;
@@ -838,6 +876,58 @@ static int __decomp_static_resolve_mid(__decomp_static_mid_rbn_t mid_rbn,
 	return 0;
 }
 
+/*
+ * Get a row for `drow` from its pool, or allocate a new one. The parts of
+ * a row that depend only on the row configuration (schema, column names,
+ * index wiring and the phony timestamp slots) are set up once when the
+ * row is allocated and kept while the row sits in the pool.
+ */
+static ldmsd_row_t __decomp_static_row_get(__decomp_static_row_cfg_t drow)
+{
+	ldmsd_row_t row;
+	ldmsd_row_index_t idx;
+	ldms_mval_t phony;
+	int j, k, c;
+
+	row = TAILQ_FIRST(&drow->row_pool);
+	if (row) {
+		TAILQ_REMOVE(&drow->row_pool, row, entry);
+		return row;
+	}
+	row = calloc(1, drow->row_sz);
+	if (!row)
+		return NULL;
+	row->schema_name = drow->schema_name;
+	row->schema_digest = &drow->schema_digest;
+	row->idx_count = drow->idx_count;
+	row->col_count = drow->col_count;
+
+	/* indices */
+	row->indices = (void*)&row->cols[row->col_count];
+	idx = (void*)&row->indices[row->idx_count];
+	for (j = 0; j < row->idx_count; j++) {
+		row->indices[j] = idx;
+		idx->col_count = drow->idxs[j].col_count;
+		idx->name = drow->idxs[j].name;
+		for (k = 0; k < idx->col_count; k++) {
+			c = drow->idxs[j].col_idx[k];
+			idx->cols[k] = &row->cols[c];
+		}
+		idx = (void*)&idx->cols[idx->col_count];
+	}
+
+	/* phony mvals are next to the idx data */
+	phony = (void*)idx;
+	for (j = 0; j < row->col_count; j++) {
+		row->cols[j].name = drow->cols[j].dst;
+		if (0 == strcmp(drow->cols[j].src, "timestamp")) {
+			row->cols[j].mval = phony;
+			phony++;
+		}
+	}
+	return row;
+}
+
 static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 				     ldmsd_row_list_t row_list, int *row_count)
 {
@@ -846,34 +936,18 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	__decomp_static_col_cfg_t dcol;
 	ldmsd_row_t row;
 	ldmsd_col_t col;
-	ldmsd_row_index_t idx;
 	ldms_mval_t mval, lh, le, rec_array;
 	enum ldms_value_type mtype;
 	size_t mlen;
-	int i, j, k, c, mid, rc, rec_mid;
-	struct _col_mval_s {
-		ldms_mval_t mval;
-		ldms_mval_t rec_array;
-		union {
-			ldms_mval_t le;
-			ldms_mval_t rec;
-		};
-		enum ldms_value_type mtype;
-		size_t array_len;
-		int metric_id;
-		int rec_metric_id;
-		int rec_array_len;
-		int rec_array_idx;
-	} *col_mvals = NULL, *mcol;
+	int i, j, mid, rc, rec_mid;
+	__decomp_static_col_mval_t col_mvals, mcol;
 	__decomp_static_mid_rbn_t mid_rbn;
 	ldms_digest_t ldms_digest;
-	TAILQ_HEAD(, _list_entry) list_cols;
 	int row_more_le;
 	struct ldms_timestamp ts;
 	const char *producer;
 	const char *instance;
 	int producer_len, instance_len;
-	ldms_mval_t phony;
 
 	if (!TAILQ_EMPTY(row_list))
 		return EINVAL;
@@ -885,7 +959,6 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 	instance = ldms_set_instance_name_get(set);
 	instance_len = strlen(instance) + 1;
 
-	TAILQ_INIT(&list_cols);
 	ldms_digest = ldms_set_digest_get(set);
 
 	*row_count = 0;
@@ -898,7 +971,8 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 			goto make_col_mvals;
 		/* Resolving `src` -> metric ID */
 		mid_rbn = calloc(1, sizeof(*mid_rbn) +
-				    drow->col_count * sizeof(mid_rbn->col_mids[0]));
+				    drow->col_count * sizeof(mid_rbn->col_mids[0]) +
+				    drow->col_count * sizeof(mid_rbn->col_mvals[0]));
 		if (!mid_rbn) {
 			rc = ENOMEM;
 			goto err_0;
@@ -906,19 +980,18 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 		memcpy(&mid_rbn->ldms_digest, ldms_digest, sizeof(*ldms_digest));
 		rbn_init(&mid_rbn->rbn, &mid_rbn->ldms_digest);
 		mid_rbn->col_count = drow->col_count;
+		mid_rbn->col_mvals = (void*)&mid_rbn->col_mids[drow->col_count];
 		rbt_ins(&drow->mid_rbt, &mid_rbn->rbn);
 		rc = __decomp_static_resolve_mid(mid_rbn, drow, set);
 		if (rc)
 			goto err_0;
 	make_col_mvals:
-		/* col_mvals is a temporary scratch paper to create rows from
-		 * a set with records. col_mvals is freed at the end of
-		 * `make_row`. */
-		col_mvals = calloc(1, drow->col_count * sizeof(*col_mvals));
-		if (!col_mvals) {
-			rc = ENOMEM;
-			goto err_0;
-		}
+		/* col_mvals is the scratch paper of the row plan to create
+		 * rows from a set with records. The metric types and array
+		 * lengths of primitives were resolved with the plan; sets
+		 * sharing the digest only differ in the value locations. */
+		col_mvals = mid_rbn->col_mvals;
+		memset(col_mvals, 0, drow->col_count * sizeof(*col_mvals));
 		for (j = 0; j < drow->col_count; j++) {
 			mid = mid_rbn->col_mids[j].mid;
 			mcol = &col_mvals[j];
@@ -930,7 +1003,7 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 			mcol->rec_array_len = -1;
 			switch (mid) {
 			case LDMSD_PHONY_METRIC_ID_TIMESTAMP:
-				/* mcol->mval will be assigned in `make_row` */
+				/* the row has the phony slot for the value */
 				mcol->mtype = LDMS_V_TIMESTAMP;
 				mcol->array_len = 1;
 				mcol->le = NULL;
@@ -951,18 +1024,7 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 				continue;
 			}
 			mval = ldms_metric_get(set, mid);
-			mtype = ldms_metric_type_get(set, mid);
-			if (mtype != mid_rbn->col_mids[j].mtype) {
-				ldmsd_lerror("strgp '%s': row '%d' col[dst] '%s': "
-					     "the value type (%s) is not "
-					     "compatible with the source metric type (%s). "
-					     "Please check the decomposition configuration.\n",
-					     strgp->obj.name, i, dcol->dst,
-					     ldms_metric_type_to_str(dcol->type),
-					     ldms_metric_type_to_str(mcol->mtype));
-				rc = EINVAL;
-				goto err_0;
-			}
+			mtype = mid_rbn->col_mids[j].mtype;
 
 			if (mtype == LDMS_V_LIST)
 				goto col_mvals_list;
@@ -971,14 +1033,9 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 			if (mtype > LDMS_V_D64_ARRAY)
 				goto col_mvals_fill;
 			/* primitives */
-			if (ldms_type_is_array(mtype)) {
-				mlen = ldms_metric_array_get_len(set, mid);
-			} else {
-				mlen = 1;
-			}
 			mcol->mval = mval;
 			mcol->mtype = mtype;
-			mcol->array_len = mlen;
+			mcol->array_len = mid_rbn->col_mids[j].array_len;
 			mcol->le = NULL;
 			continue;
 
@@ -1042,32 +1099,11 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 		}
 
 	make_row: /* make/expand rows according to col_mvals */
-		row = calloc(1, drow->row_sz);
+		row = __decomp_static_row_get(drow);
 		if (!row) {
 			rc = errno;
 			goto err_0;
 		}
-		row->schema_name = drow->schema_name;
-		row->schema_digest = &drow->schema_digest;
-		row->idx_count = drow->idx_count;
-		row->col_count = drow->col_count;
-
-		/* indices */
-		row->indices = (void*)&row->cols[row->col_count];
-		idx = (void*)&row->indices[row->idx_count];
-		for (j = 0; j < row->idx_count; j++) {
-			row->indices[j] = idx;
-			idx->col_count = drow->idxs[j].col_count;
-			idx->name = drow->idxs[j].name;
-			for (k = 0; k < idx->col_count; k++) {
-				c = drow->idxs[j].col_idx[k];
-				idx->cols[k] = &row->cols[c];
-			}
-			idx = (void*)&idx->cols[idx->col_count];
-		}
-
-		/* phony mvals are next to the idx data */
-		phony = (void*)idx;
 
 		row_more_le = 0;
 		/* cols */
@@ -1084,6 +1120,7 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 					     strgp->obj.name, i, dcol->dst,
 					     ldms_metric_type_to_str(dcol->type),
 					     ldms_metric_type_to_str(mcol->mtype));
+				TAILQ_INSERT_HEAD(&drow->row_pool, row, entry);
 				rc = EINVAL;
 				goto err_0;
 			}
@@ -1091,13 +1128,11 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 			col->metric_id = mcol->metric_id;
 			col->rec_metric_id = mcol->rec_metric_id;
 
-			col->name = dcol->dst;
 			col->type = mcol->mtype;
 			col->array_len = mcol->array_len;
 			if (mid_rbn->col_mids[j].mid == LDMSD_PHONY_METRIC_ID_TIMESTAMP) {
-				phony->v_ts = ts;
-				col->mval = phony;
-				phony++;
+				/* col->mval is the phony slot in the row */
+				col->mval->v_ts = ts;
 			} else {
 				/* The other phony types are fine */
 				col->mval = mcol->mval;
@@ -1156,24 +1191,25 @@ static int __decomp_static_decompose(ldmsd_strgp_t strgp, ldms_set_t set,
 		row = NULL;
 		if (row_more_le)
 			goto make_row;
-		free(col_mvals);
-		col_mvals = NULL;
 	}
 	return 0;
  err_0:
 	/* clean up stuff here */
-	if (col_mvals)
-		free(col_mvals);
 	__decomp_static_release_rows(strgp, row_list);
 	return rc;
 }
 
+/* Rows go back to the pool of their row configuration for reuse */
 static void __decomp_static_release_rows(ldmsd_strgp_t strgp,
 					 ldmsd_row_list_t row_list)
 {
+	__decomp_static_row_cfg_t drow;
 	ldmsd_row_t row;
 	while ((row = TAILQ_FIRST(row_list))) {
 		TAILQ_REMOVE(row_list, row, entry);
-		free(row);
+		drow = container_of(row->schema_digest,
+				    struct __decomp_static_row_cfg_s,
+				    schema_digest);
+		TAILQ_INSERT_HEAD(&drow->row_pool, row, entry);
 	}
 }
@@ -910,6 +910,13 @@ static void help_updtr_add()
 		"                       updater will schedule the set updates according to\n"
 		"                       the given interval and offset values. If not\n"
 		"                       specified, the value is `false`.\n"
+		"     [batch=]    [true|delta|false] If true, the current data of all sets\n"
+		"                 of a producer are requested in one message instead of one\n"
+		"                 RDMA read per set. 'delta' also asks the producer to send\n"
+		"                 only the data that changed since the last update. Sets of\n"
+		"                 producers without batch updates are read one by one. If\n"
+		"                 `push` is used, `batch` must be `false`. If not specified,\n"
+		"                 the value is `false`.\n"
 		"     [perm=]      The permission to modify the updater in the future.\n"
 		);
 
@@ -1091,8 +1098,9 @@ static void help_updtr_status()
 static void __print_updtr_task(json_entity_t updtr)
 {
 	json_entity_t tasks, task;
-	json_entity_t name, intrvl, offset, is_default;
+	json_entity_t name, intrvl, offset, is_default, sched;
 	char *intrvl_s, *offset_s;
+	char stats[128];
 
 	if (updtr->type != JSON_DICT_VALUE) {
 		printf("Invalid result format\n");
@@ -1106,7 +1114,8 @@ static void __print_updtr_task(json_entity_t updtr)
 		return;
 	}
 	printf("Updater: %s\n", json_value_str(name)->str);
-	printf("   tasks: <interval_us>:<offset_us>\n");
+	printf("   tasks: <interval_us>:<offset_us> <runs> <overruns> "
+	       "<mean latency_us> <jitter_us>\n");
 	for (task = json_item_first(tasks); task; task = json_item_next(task)) {
 		intrvl = json_value_find(task, "interval_us");
 		offset = json_value_find(task, "offset_us");
@@ -1117,11 +1126,22 @@ static void __print_updtr_task(json_entity_t updtr)
 		}
 		intrvl_s = json_value_str(intrvl)->str;
 		offset_s = json_value_str(offset)->str;
+		sched = json_value_find(task, "sched");
+		if (sched) {
+			snprintf(stats, sizeof(stats),
+				 "%" PRId64 " %" PRId64 " %" PRId64 " %" PRId64,
+				 json_value_int(json_value_find(sched, "count")),
+				 json_value_int(json_value_find(sched, "overrun")),
+				 json_value_int(json_value_find(sched, "lat_mean_us")),
+				 json_value_int(json_value_find(sched, "jitter_us")));
+		} else {
+			snprintf(stats, sizeof(stats), "- - - -");
+		}
 		if (0 == strcmp(json_value_str(is_default)->str, "true")) {
-			printf("     %s:%s     default\n",
-					intrvl_s, offset_s);
+			printf("     %s:%s %s     default\n",
+					intrvl_s, offset_s, stats);
 		} else {
-			printf("     %s:%s\n", intrvl_s, offset_s);
+			printf("     %s:%s %s\n", intrvl_s, offset_s, stats);
 		}
 	}
 }
@@ -1183,7 +1203,12 @@ static void help_strgp_add()
 		"     [flush=]     The interval between calls to the storage plugin flush method.\n"
 		"                  By default, the flush method is not called.\n"
 		"     [perm=]      The permission to modify the storage policy in the future.\n"
-		"     [decomposition=]   The path to the decomposition configuration file.\n");
+		"     [decomposition=]   The path to the decomposition configuration file.\n"
+		"     [queue_depth=]     The number of set snapshots that may wait for\n"
+		"                        the store worker. 0 (default) stores the data\n"
+		"                        in the update completion path.\n"
+		"     [queue_policy=]    What to do when the queue is full: block (default),\n"
+		"                        drop_new or drop_old.\n");
 }
 
 static void help_strgp_del()
@@ -1296,6 +1321,29 @@ void __print_strgp_status(json_entity_t strgp)
 		printf(" %s", json_value_str(metric)->str);
 	}
 	printf("\n");
+
+	json_entity_t q = json_value_find(strgp, "queue");
+	if (q && (q->type == JSON_DICT_VALUE)) {
+		json_entity_t depth = json_value_find(q, "depth");
+		if (depth && json_value_int(depth)) {
+			printf("       queue: depth %" PRId64 " policy %s len %" PRId64
+			       " len_max %" PRId64 " enqueued %" PRId64
+			       " stored %" PRId64 " dropped %" PRId64
+			       " blocked %" PRId64 " latency(us) min %" PRId64
+			       " max %" PRId64 " avg %" PRId64 "\n",
+			       json_value_int(depth),
+			       json_value_str(json_value_find(q, "policy"))->str,
+			       json_value_int(json_value_find(q, "len")),
+			       json_value_int(json_value_find(q, "len_max")),
+			       json_value_int(json_value_find(q, "enqueued")),
+			       json_value_int(json_value_find(q, "stored")),
+			       json_value_int(json_value_find(q, "dropped")),
+			       json_value_int(json_value_find(q, "blocked")),
+			       json_value_int(json_value_find(q, "lat_min_us")),
+			       json_value_int(json_value_find(q, "lat_max_us")),
+			       json_value_int(json_value_find(q, "lat_avg_us")));
+		}
+	}
 	return;
 
 invalid_result_format:
@@ -63,6 +63,7 @@
 #include <sys/stat.h>
 #include <sys/fcntl.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <pthread.h>
 #include <netinet/in.h>
 #include <signal.h>
@@ -173,8 +174,6 @@ static struct rbt set_tree = {
 };
 static pthread_mutex_t set_tree_lock = PTHREAD_MUTEX_INITIALIZER;
 
-int find_least_busy_thread();
-
 int passive = 0;
 int quiet = 0; /* Is verbosity quiet? 0 for no and 1 for yes */
 
@@ -288,46 +287,437 @@ err:
 	return rc;
 }
 
-int __log(enum ldmsd_loglevel level, char *msg, struct timeval *tv, struct tm *tm)
+/*
+ * Log messages are formatted on the calling thread into a ring owned by
+ * that thread and written to the log file by the logger worker.
+ *
+ * A ring has a single producer, the thread that owns it, and a single
+ * consumer, the thread draining the rings under log_flush_lock, so its
+ * head and tail are advanced without a lock. A producer posts an event
+ * to the logger only when no drain has been requested since the last
+ * one started. When a ring is full, the message is dropped and counted;
+ * the next drain reports the number of dropped messages in the log.
+ */
+#define LOG_RING_SZ_DEFAULT	65536
+#define LOG_RING_SZ_MIN		4096
+#define LOG_RING_SZ_MAX		(64UL << 20)
+#define LOG_MSG_INLINE		1024	/* longer messages are kept by reference */
+#define LOG_BATCH		64	/* records per writev() */
+#define LOG_PREFIX_SZ		80
+
+#define LOG_REC_F_SKIP	1	/* filler up to the end of the ring */
+#define LOG_REC_F_PTR	2	/* msg holds a pointer to a malloc'd string */
+
+struct log_rec {
+	uint32_t size;		/* bytes taken in the ring, header included */
+	uint32_t msg_len;
+	int16_t level;
+	uint16_t flags;
+	uint32_t pad;
+	struct timeval tv;
+	char msg[];
+};
+
+struct log_ring {
+	uint64_t head;		/* advanced by the owner */
+	uint64_t dropped;	/* counted by the owner */
+	int exited;		/* set when the owner exits */
+	/* advanced by the drain */
+	uint64_t tail __attribute__((aligned(64)));
+	uint64_t dropped_reported;
+	size_t mask;
+	char *buf;
+	LIST_ENTRY(log_ring) entry;
+};
+
+/* The position of a drain in a ring */
+struct log_cursor {
+	struct log_ring *r;
+	uint64_t tail;
+	uint64_t head;
+};
+
+static size_t log_ring_sz;
+static pthread_once_t log_ring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t log_ring_key;
+static __thread struct log_ring *log_ring;
+static LIST_HEAD(, log_ring) log_ring_list = LIST_HEAD_INITIALIZER(log_ring_list);
+static pthread_mutex_t log_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t log_flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread int log_flushing;	/* this thread holds log_flush_lock */
+static int log_kicked;
+static uint64_t log_dropped;
+
+uint64_t ldmsd_log_dropped()
+{
+	return __atomic_load_n(&log_dropped, __ATOMIC_RELAXED);
+}
+
+/*
+ * Formats the time and level prefix of a log line. The date string is
+ * only recomputed when the second changes.
+ */
+static size_t __log_prefix(char *buf, size_t sz, enum ldmsd_loglevel level,
+			   struct timeval *tv)
+{
+	static __thread time_t date_sec = -1;
+	static __thread char date[64];
+	static __thread size_t date_len;
+	struct tm tm;
+	size_t len;
+
+	if (log_time_sec) {
+		len = snprintf(buf, sz, "%lu.%06lu: ", tv->tv_sec, tv->tv_usec);
+	} else {
+		if (tv->tv_sec != date_sec) {
+			localtime_r(&tv->tv_sec, &tm);
+			date_len = strftime(date, sizeof(date),
+					    "%a %b %d %H:%M:%S %Y: ", &tm);
+			date_sec = tv->tv_sec;
+		}
+		len = date_len;
+		memcpy(buf, date, len);
+	}
+	if (level < LDMSD_LALL)
+		len += snprintf(&buf[len], sz - len, "%-10s: ",
+				ldmsd_loglevel_names[level]);
+	return len;
+}
+
+int __log(enum ldmsd_loglevel level, char *msg, struct timeval *tv)
 {
+	char prefix[LOG_PREFIX_SZ];
+
 	if (log_fp == LDMSD_LOG_SYSLOG) {
 		syslog(ldmsd_loglevel_to_syslog(level), "%s", msg);
 		return 0;
 	}
+	__log_prefix(prefix, sizeof(prefix), level, tv);
+	fprintf(log_fp, "%s%s", prefix, msg);
+	return 0;
+}
 
-	if (log_time_sec) {
-		fprintf(log_fp, "%lu.%06lu: ", tv->tv_sec, tv->tv_usec);
+static void __log_writev(int fd, struct iovec *iov, int cnt)
+{
+	ssize_t n;
+
+	while (cnt) {
+		n = writev(fd, iov, cnt);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		while (cnt && n >= iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if (cnt) {
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+}
+
+/* Returns the next record to write from the cursor or NULL */
+static struct log_rec *__log_cursor_rec(struct log_cursor *c)
+{
+	struct log_rec *rec;
+	size_t off, contig;
+
+	while (c->tail != c->head) {
+		off = c->tail & c->r->mask;
+		contig = c->r->mask + 1 - off;
+		if (contig < sizeof(*rec)) {
+			/* too short for a filler record */
+			c->tail += contig;
+			continue;
+		}
+		rec = (struct log_rec *)&c->r->buf[off];
+		if (!(rec->flags & LOG_REC_F_SKIP))
+			return rec;
+		c->tail += rec->size;
+	}
+	return NULL;
+}
+
+/*
+ * Writes the records of all the rings to the log, oldest first, in
+ * batches of LOG_BATCH records per writev().
+ *
+ * If \c deadline is not NULL, the function gives up without writing
+ * anything when another thread is still draining the rings at that time.
+ */
+static void __log_drain(const struct timespec *deadline)
+{
+	static struct log_cursor *cur;
+	static int cur_alloc;
+	struct iovec iov[2 * (LOG_BATCH + 1)];
+	char prefix[LOG_BATCH + 1][LOG_PREFIX_SZ];
+	char *ptrs[LOG_BATCH];
+	char drop_msg[128];
+	struct log_ring *r, *next;
+	struct log_cursor *c, *best;
+	struct log_rec *rec, *best_rec;
+	struct timeval tv;
+	uint64_t head, d, dropped = 0;
+	int i, n, cnt, nrec, nptr, fd, exited;
+	char *msg;
+
+	if (!deadline)
+		pthread_mutex_lock(&log_flush_lock);
+	else if (pthread_mutex_timedlock(&log_flush_lock, deadline))
+		return;
+	log_flushing = 1;
+
+	n = 0;
+	pthread_mutex_lock(&log_ring_lock);
+	for (r = LIST_FIRST(&log_ring_list); r; r = next) {
+		next = LIST_NEXT(r, entry);
+		exited = __atomic_load_n(&r->exited, __ATOMIC_ACQUIRE);
+		head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		d = __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+		dropped += d - r->dropped_reported;
+		r->dropped_reported = d;
+		if (head == r->tail) {
+			if (exited) {
+				/* the owner is gone and all is written */
+				LIST_REMOVE(r, entry);
+				free(r->buf);
+				free(r);
+			}
+			continue;
+		}
+		if (n == cur_alloc) {
+			c = realloc(cur, (cur_alloc + 16) * sizeof(*c));
+			if (!c)
+				break;
+			cur = c;
+			cur_alloc += 16;
+		}
+		cur[n].r = r;
+		cur[n].tail = r->tail;
+		cur[n].head = head;
+		n++;
+	}
+	pthread_mutex_unlock(&log_ring_lock);
+
+	if (log_fp == LDMSD_LOG_SYSLOG) {
+		fd = -1;
 	} else {
-		char dtsz[200];
-		if (strftime(dtsz, sizeof(dtsz), "%a %b %d %H:%M:%S %Y", tm))
-			fprintf(log_fp, "%s: ", dtsz);
+		fflush(log_fp);
+		fd = fileno(log_fp);
 	}
+	cnt = nrec = nptr = 0;
+	if (dropped) {
+		__atomic_add_fetch(&log_dropped, dropped, __ATOMIC_RELAXED);
+		gettimeofday(&tv, NULL);
+		snprintf(drop_msg, sizeof(drop_msg), "%" PRIu64 " log messages "
+			 "were dropped because the log ring was full.\n",
+			 dropped);
+		if (fd < 0) {
+			syslog(ldmsd_loglevel_to_syslog(LDMSD_LWARNING),
+			       "%s", drop_msg);
+		} else {
+			iov[cnt].iov_base = prefix[LOG_BATCH];
+			iov[cnt++].iov_len = __log_prefix(prefix[LOG_BATCH],
+					LOG_PREFIX_SZ, LDMSD_LWARNING, &tv);
+			iov[cnt].iov_base = drop_msg;
+			iov[cnt++].iov_len = strlen(drop_msg);
+		}
+	}
+	for (;;) {
+		best = NULL;
+		best_rec = NULL;
+		for (i = 0; i < n; i++) {
+			rec = __log_cursor_rec(&cur[i]);
+			if (rec && (!best_rec ||
+				    timercmp(&rec->tv, &best_rec->tv, <))) {
+				best = &cur[i];
+				best_rec = rec;
+			}
+		}
+		if (nrec == LOG_BATCH || (!best && (nrec || cnt))) {
+			if (fd >= 0)
+				__log_writev(fd, iov, cnt);
+			while (nptr)
+				free(ptrs[--nptr]);
+			for (i = 0; i < n; i++)
+				__atomic_store_n(&cur[i].r->tail, cur[i].tail,
+						 __ATOMIC_RELEASE);
+			cnt = nrec = 0;
+		}
+		if (!best)
+			break;
+		if (best_rec->flags & LOG_REC_F_PTR) {
+			memcpy(&msg, best_rec->msg, sizeof(msg));
+			ptrs[nptr++] = msg;
+		} else {
+			msg = best_rec->msg;
+		}
+		if (fd < 0) {
+			syslog(ldmsd_loglevel_to_syslog(best_rec->level),
+			       "%s", msg);
+		} else {
+			iov[cnt].iov_base = prefix[nrec];
+			iov[cnt++].iov_len = __log_prefix(prefix[nrec],
+					LOG_PREFIX_SZ, best_rec->level,
+					&best_rec->tv);
+			iov[cnt].iov_base = msg;
+			iov[cnt++].iov_len = best_rec->msg_len;
+		}
+		best->tail += best_rec->size;
+		nrec++;
+	}
+	log_flushing = 0;
+	pthread_mutex_unlock(&log_flush_lock);
+}
+
+/* Asks the logger to drain the rings unless a drain is already pending */
+static void __log_kick()
+{
+	ev_t ev;
 
-	if (level < LDMSD_LALL) {
-		fprintf(log_fp, "%-10s: ", ldmsd_loglevel_names[level]);
+	/* Orders the head update of the caller before reading the flag */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&log_kicked, __ATOMIC_RELAXED) ||
+	    __atomic_exchange_n(&log_kicked, 1, __ATOMIC_SEQ_CST))
+		return;
+	ev = ev_new(log_type);
+	if (!ev) {
+		__atomic_store_n(&log_kicked, 0, __ATOMIC_SEQ_CST);
+		return;
 	}
+	EV_DATA(ev, struct log_data)->is_rotate = 0;
+	ev_post(NULL, logger_w, ev, NULL);
+}
 
-	fprintf(log_fp, "%s", msg);
+static void __log_ring_exit(void *arg)
+{
+	struct log_ring *r = arg;
+	int pending = r->head != __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+
+	/* The drain frees the ring once it is exited and empty */
+	log_ring = NULL;
+	__atomic_store_n(&r->exited, 1, __ATOMIC_RELEASE);
+	if (pending)
+		__log_kick();
+}
+
+static void __log_ring_once()
+{
+	char *s = getenv("LDMSD_LOG_RING_SIZE");
+	size_t sz = LOG_RING_SZ_DEFAULT;
+	long long v;
+	char *end;
+
+	if (s) {
+		errno = 0;
+		v = strtoll(s, &end, 0);
+		/* An unparsable or non-positive size keeps the default */
+		if (!errno && end != s && *end == '\0' && v > 0)
+			sz = (v > LOG_RING_SZ_MAX) ? LOG_RING_SZ_MAX : v;
+	}
+	log_ring_sz = LOG_RING_SZ_MIN;
+	while (log_ring_sz < sz)
+		log_ring_sz <<= 1;
+	(void)pthread_key_create(&log_ring_key, __log_ring_exit);
+}
+
+static struct log_ring *__log_ring_get()
+{
+	struct log_ring *r = log_ring;
 
+	if (r)
+		return r;
+	pthread_once(&log_ring_once, __log_ring_once);
+	if (posix_memalign((void **)&r, 64, sizeof(*r)))
+		return NULL;
+	memset(r, 0, sizeof(*r));
+	r->buf = malloc(log_ring_sz);
+	if (!r->buf) {
+		free(r);
+		return NULL;
+	}
+	r->mask = log_ring_sz - 1;
+	pthread_mutex_lock(&log_ring_lock);
+	LIST_INSERT_HEAD(&log_ring_list, r, entry);
+	pthread_mutex_unlock(&log_ring_lock);
+	(void)pthread_setspecific(log_ring_key, r);
+	log_ring = r;
+	return r;
+}
+
+/*
+ * Copies a message into the ring of the calling thread. If \c msg is
+ * not \c buf, only the pointer is stored and the drain frees it.
+ */
+static int __log_ring_put(enum ldmsd_loglevel level, struct timeval *tv,
+			  char *msg, size_t len, char *buf)
+{
+	struct log_ring *r = __log_ring_get();
+	struct log_rec *rec;
+	uint64_t head, tail;
+	size_t ring_sz, off, contig, skip, size;
+
+	if (!r) {
+		__atomic_add_fetch(&log_dropped, 1, __ATOMIC_RELAXED);
+		return ENOMEM;
+	}
+	if (msg == buf)
+		size = (sizeof(*rec) + len + 1 + 7) & ~7;
+	else
+		size = sizeof(*rec) + sizeof(msg);
+	ring_sz = r->mask + 1;
+	head = r->head;
+	tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	off = head & r->mask;
+	contig = ring_sz - off;
+	skip = 0;
+	if (size > contig) {
+		/* wrap around, leaving a filler at the end of the ring */
+		skip = contig;
+		off = 0;
+	}
+	if (skip + size > ring_sz - (head - tail)) {
+		r->dropped++;
+		return ENOSPC;
+	}
+	if (skip >= sizeof(*rec)) {
+		rec = (struct log_rec *)&r->buf[head & r->mask];
+		rec->size = skip;
+		rec->flags = LOG_REC_F_SKIP;
+	}
+	rec = (struct log_rec *)&r->buf[off];
+	rec->size = size;
+	rec->msg_len = len;
+	rec->level = level;
+	rec->tv = *tv;
+	if (msg == buf) {
+		rec->flags = 0;
+		memcpy(rec->msg, msg, len + 1);
+	} else {
+		rec->flags = LOG_REC_F_PTR;
+		memcpy(rec->msg, &msg, sizeof(msg));
+	}
+	__atomic_store_n(&r->head, head + skip + size, __ATOMIC_RELEASE);
 	return 0;
 }
 
 int log_actor(ev_worker_t src, ev_worker_t dst, ev_status_t status, ev_t ev)
 {
-	enum ldmsd_loglevel level = EV_DATA(ev, struct log_data)->level;
-	char *msg = EV_DATA(ev, struct log_data)->msg;
-	uint8_t is_rotate = EV_DATA(ev, struct log_data)->is_rotate;
-	struct timeval *tv = &EV_DATA(ev, struct log_data)->tv;
-	struct tm *tm = &EV_DATA(ev, struct log_data)->tm;
-	int rc;
+	int rc = 0;
 
-	if (is_rotate) {
+	if (EV_DATA(ev, struct log_data)->is_rotate) {
+		pthread_mutex_lock(&log_flush_lock);
+		log_flushing = 1;
 		rc = __logrotate();
+		log_flushing = 0;
+		pthread_mutex_unlock(&log_flush_lock);
 	} else {
-		rc = __log(level, msg, tv, tm);
-		if (0 == ev_pending(logger_w))
-			fflush(log_fp);
-		free(msg);
+		__atomic_store_n(&log_kicked, 0, __ATOMIC_SEQ_CST);
+		__log_drain(NULL);
 	}
 	ev_put(ev);
 	return rc;
@@ -335,12 +725,11 @@ int log_actor(ev_worker_t src, ev_worker_t dst, ev_status_t status, ev_t ev)
 
 void __ldmsd_log(enum ldmsd_loglevel level, const char *fmt, va_list ap)
 {
-	ev_t log_ev;
-	char *msg;
-	int rc;
+	char buf[LOG_MSG_INLINE];
 	struct timeval tv;
-	struct tm tm;
-	time_t t;
+	va_list ap2;
+	char *msg;
+	int len;
 
 	if ((level != LDMSD_LALL) &&
 			(quiet || ((0 <= level) && (level < log_level_thr))))
@@ -353,36 +742,34 @@ void __ldmsd_log(enum ldmsd_loglevel level, const char *fmt, va_list ap)
 		else
 			log_time_sec = 0;
 	}
-	if (log_time_sec) {
-		gettimeofday(&tv, NULL);
-
-	} else {
-		t = time(NULL);
-		localtime_r(&t, &tm);
-	}
+	gettimeofday(&tv, NULL);
 
-	rc = vasprintf(&msg, fmt, ap);
-	if (rc < 0)
+	va_copy(ap2, ap);
+	len = vsnprintf(buf, sizeof(buf), fmt, ap2);
+	va_end(ap2);
+	if (len < 0)
 		return;
+	msg = buf;
+	if (len >= sizeof(buf)) {
+		len = vasprintf(&msg, fmt, ap);
+		if (len < 0)
+			return;
+	}
 
 	if (!ldmsd_is_initialized()) {
 		/* No workers, so directly log to the file */
-		(void) __log(level, msg, &tv, &tm);
+		(void) __log(level, msg, &tv);
+		if (msg != buf)
+			free(msg);
 		return;
 	}
 
-	log_ev = ev_new(log_type);
-	if (!log_ev)
+	if (__log_ring_put(level, &tv, msg, len, buf)) {
+		if (msg != buf)
+			free(msg);
 		return;
-	EV_DATA(log_ev, struct log_data)->msg = msg;
-	EV_DATA(log_ev, struct log_data)->level = level;
-	EV_DATA(log_ev, struct log_data)->is_rotate = 0;
-
-	if (log_time_sec)
-		EV_DATA(log_ev, struct log_data)->tv = tv;
-	else
-		EV_DATA(log_ev, struct log_data)->tm = tm;
-	ev_post(NULL, logger_w, log_ev, NULL);
+	}
+	__log_kick();
 }
 
 void ldmsd_log(enum ldmsd_loglevel level, const char *fmt, ...)
@@ -527,6 +914,17 @@ void cleanup(int x, const char *reason)
 	auth_opt = NULL;
 	cleaned = 1;
 	pthread_mutex_unlock(&cleanup_lock);
+	/*
+	 * Write out what the logger has not written yet. This is skipped
+	 * when the caller is the logger itself, e.g. a failed log rotation,
+	 * or when a drain in progress does not finish within a second.
+	 */
+	if (!log_flushing) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += 1;
+		__log_drain(&deadline);
+	}
 	exit(x);
 }
 
@@ -581,7 +979,6 @@ int ldmsd_logrotate() {
 	if (!ev)
 		return ENOMEM;
 	EV_DATA(ev, struct log_data)->is_rotate = 1;
-	EV_DATA(ev, struct log_data)->msg = NULL;
 	ev_post(NULL, logger_w, ev, NULL);
 	return 0;
 }
@@ -639,7 +1036,8 @@ void usage_hint(char *argv[],char *hint)
 	printf("    -s PATH,      --kernel_set_path PATH          Text file containing kernel metric sets to publish.\n"
 	       "                                                  [" LDMSD_SETFILE "]\n");
 	printf("  Thread Options\n");
-	printf("    -P COUNT,     --worker_threads COUNT          Count of event threads to start.\n");
+	printf("    -P COUNT,     --worker_threads COUNT          Count of worker threads running the sampler and\n"
+	       "                                                  updater tasks.\n");
 	printf("  Configuration Options\n");
 	printf("    -c PATH                                       The path to configuration file (optional, default: <none>).\n");
 	printf("    -V                                            Print LDMS version and exit.\n");
@@ -655,41 +1053,13 @@ void usage(char *argv[]) {
 	usage_hint(argv,NULL);
 }
 
-#define EVTH_MAX 1024
-int ev_thread_count = 0;
-ovis_scheduler_t *ovis_scheduler;
-pthread_t *ev_thread;		/* sampler threads */
-int *ev_count;			/* number of hosts/samplers assigned to each thread */
-
-int find_least_busy_thread()
-{
-	int i;
-	int idx = 0;
-	int count = ev_count[0];
-	for (i = 1; i < ev_thread_count; i++) {
-		if (ev_count[i] < count) {
-			idx = i;
-			count = ev_count[i];
-		}
-	}
-	return idx;
-}
-
-ovis_scheduler_t get_ovis_scheduler(int idx)
-{
-	__sync_add_and_fetch(&ev_count[idx], 1);
-	return ovis_scheduler[idx];
-}
-
-void release_ovis_scheduler(int idx)
-{
-	__sync_sub_and_fetch(&ev_count[idx], 1);
-}
-
-pthread_t get_thread(int idx)
-{
-	return ev_thread[idx];
-}
+int ev_thread_count = 0;	/* scheduler pool worker threads */
+/*
+ * The sampler and task scheduler. Its loop thread tracks the wake-up times
+ * and its worker threads run the sampler and task callbacks.
+ */
+ovis_scheduler_t ovis_scheduler;
+pthread_t ev_thread;		/* scheduler loop thread */
 
 void kpublish(int map_fd, int set_no, int set_size, char *set_name)
 {
@@ -788,16 +1158,19 @@ int publish_kernel(const char *setfile)
 static void stop_sampler(struct ldmsd_plugin_cfg *pi)
 {
 	ovis_scheduler_event_del(pi->os, &pi->oev);
-	release_ovis_scheduler(pi->thread_id);
 	pi->ref_count--;
 	pi->os = NULL;
-	pi->thread_id = -1;
 }
 
 void plugin_sampler_cb(ovis_event_t oev)
 {
 	struct ldmsd_plugin_cfg *pi = oev->param.ctxt;
 	pthread_mutex_lock(&pi->lock);
+	if (!pi->os || oev->cb.gen != pi->start_gen) {
+		/* stopped, and maybe restarted, after a worker took the event */
+		pthread_mutex_unlock(&pi->lock);
+		return;
+	}
 	assert(pi->plugin->type == LDMSD_PLUGIN_SAMPLER);
 	int rc = pi->sampler->sample(pi->sampler);
 	if (rc) {
@@ -1053,6 +1426,12 @@ static void task_cb_fn(ovis_event_t ev)
 	enum ldmsd_task_state next_state = 0;
 
 	pthread_mutex_lock(&task->lock);
+	if (task->state == LDMSD_TASK_STATE_STOPPED ||
+	    ev->cb.gen != task->start_gen) {
+		/* stopped, and maybe restarted, after a worker took the event */
+		pthread_mutex_unlock(&task->lock);
+		return;
+	}
 	if (task->os) {
 		ovis_scheduler_event_del(task->os, ev);
 		resched_task(task);
@@ -1074,7 +1453,6 @@ static void task_cb_fn(ovis_event_t ev)
 		if (task->os)
 			ovis_scheduler_event_del(task->os, &task->oev);
 		task->os = NULL;
-		release_ovis_scheduler(task->thread_id);
 		pthread_cond_signal(&task->join_cv);
 	}
 	pthread_mutex_unlock(&task->lock);
@@ -1097,7 +1475,6 @@ void ldmsd_task_stop(ldmsd_task_t task)
 	if (task->state != LDMSD_TASK_STATE_RUNNING) {
 		ovis_scheduler_event_del(task->os, &task->oev);
 		task->os = NULL;
-		release_ovis_scheduler(task->thread_id);
 		task->state = LDMSD_TASK_STATE_STOPPED;
 		pthread_cond_signal(&task->join_cv);
 	} else {
@@ -1135,17 +1512,18 @@ int ldmsd_task_start(ldmsd_task_t task,
 		rc = EBUSY;
 		goto out;
 	}
-	task->thread_id = find_least_busy_thread();
-	task->os = get_ovis_scheduler(task->thread_id);
+	task->os = ovis_scheduler;
 	task->fn = task_fn;
 	task->fn_arg = task_arg;
 	task->flags = flags;
 	task->sched_us = sched_us;
 	task->offset_us = offset_us;
 	OVIS_EVENT_INIT(&task->oev);
+	ovis_event_stats_reset(task->os, &task->oev);
 	task->oev.param.type = OVIS_EVENT_TIMEOUT;
 	task->oev.param.cb_fn = task_cb_fn;
 	task->oev.param.ctxt = task;
+	task->oev.param.gen = ++task->start_gen;
 	resched_task(task);
 	task->state = start_task(task);
 	if (task->state != LDMSD_TASK_STATE_STARTED)
@@ -1161,6 +1539,9 @@ void ldmsd_task_join(ldmsd_task_t task)
 	while (task->state != LDMSD_TASK_STATE_STOPPED)
 		pthread_cond_wait(&task->join_cv, &task->lock);
 	pthread_mutex_unlock(&task->lock);
+	/* The callback may not have seen the stop yet */
+	if (ovis_scheduler)
+		ovis_scheduler_event_join(ovis_scheduler, &task->oev);
 }
 
 char *ldmsd_set_info_origin_enum2str(enum ldmsd_set_origin_type type)
@@ -1371,7 +1752,7 @@ int ldmsd_start_sampler(char *plugin_name, char *interval, char *offset)
 		rc = -EINVAL;
 		goto out;
 	}
-	if (pi->thread_id >= 0) {
+	if (pi->os) {
 		rc = EBUSY;
 		goto out;
 	}
@@ -1391,6 +1772,7 @@ int ldmsd_start_sampler(char *plugin_name, char *interval, char *offset)
 		pi->sample_offset_us = sample_offset;
 	}
 	OVIS_EVENT_INIT(&pi->oev);
+	ovis_event_stats_reset(ovis_scheduler, &pi->oev);
 	if (pi->synchronous) {
 		pi->oev.param.type = OVIS_EVENT_PERIODIC;
 		pi->oev.param.periodic.period_us = sample_interval;
@@ -1402,11 +1784,11 @@ int ldmsd_start_sampler(char *plugin_name, char *interval, char *offset)
 	}
 	pi->oev.param.ctxt = pi;
 	pi->oev.param.cb_fn = plugin_sampler_cb;
+	pi->oev.param.gen = ++pi->start_gen;
 
 	pi->ref_count++;
 
-	pi->thread_id = find_least_busy_thread();
-	pi->os = get_ovis_scheduler(pi->thread_id);
+	pi->os = ovis_scheduler;
 	rc = ovis_scheduler_event_add(pi->os, &pi->oev);
 out:
 	pthread_mutex_unlock(&pi->lock);
@@ -1428,7 +1810,6 @@ void oneshot_sample_cb(ovis_event_t ev)
 	assert(pi->plugin->type == LDMSD_PLUGIN_SAMPLER);
 	pi->sampler->sample(pi->sampler);
 	pi->ref_count--;
-	release_ovis_scheduler(pi->thread_id);
 	free(os);
 	pthread_mutex_unlock(&pi->lock);
 }
@@ -1488,13 +1869,13 @@ int ldmsd_oneshot_sample(const char *plugin_name, const char *ts,
 	}
 	pi->ref_count++;
 	ossample->pi = pi;
-	if (pi->thread_id < 0) {
+	if (!pi->os) {
 		snprintf(errstr, errlen, "Sampler '%s' not started yet.",
 								plugin_name);
 		rc = EPERM;
 		goto err;
 	}
-	ossample->os = get_ovis_scheduler(pi->thread_id);
+	ossample->os = pi->os;
 	OVIS_EVENT_INIT(&ossample->oev);
 	ossample->oev.param.type = OVIS_EVENT_TIMEOUT;
 	ossample->oev.param.ctxt = ossample;
@@ -1533,14 +1914,14 @@ int ldmsd_stop_sampler(char *plugin_name)
 	if (pi->os) {
 		ovis_scheduler_event_del(pi->os, &pi->oev);
 		pi->os = NULL;
-		release_ovis_scheduler(pi->thread_id);
-		pi->thread_id = -1;
 		pi->ref_count--;
 	} else {
 		rc = -EBUSY;
 	}
 out:
 	pthread_mutex_unlock(&pi->lock);
+	if (!rc)
+		ovis_scheduler_event_join(ovis_scheduler, &pi->oev);
 	return rc;
 }
 
@@ -1920,8 +2301,6 @@ int ldmsd_process_cmd_line_arg(char opt, char *value)
 			ev_thread_count = atoi(value);
 			if (ev_thread_count < 1 )
 				ev_thread_count = 1;
-			if (ev_thread_count > EVTH_MAX)
-				ev_thread_count = EVTH_MAX;
 		}
 		break;
 	case 'm':
@@ -2296,36 +2675,17 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	ev_count = calloc(ev_thread_count, sizeof(int));
-	if (!ev_count) {
-		ldmsd_log(LDMSD_LCRITICAL, "Memory allocation failure.\n");
-		av_free(auth_opt);
-		exit(1);
-	}
-	ovis_scheduler = calloc(ev_thread_count, sizeof(*ovis_scheduler));
+	ovis_scheduler = ovis_scheduler_pool_new(ev_thread_count);
 	if (!ovis_scheduler) {
-		ldmsd_log(LDMSD_LCRITICAL, "Memory allocation failure.\n");
-		av_free(auth_opt);
-		exit(1);
-	}
-	ev_thread = calloc(ev_thread_count, sizeof(pthread_t));
-	if (!ev_thread) {
-		ldmsd_log(LDMSD_LCRITICAL, "Memory allocation failure.\n");
-		av_free(auth_opt);
-		exit(1);
+		ldmsd_log(LDMSD_LERROR, "Error %d creating an OVIS scheduler.\n",
+			  errno);
+		cleanup(6, "OVIS scheduler create failed");
 	}
-	for (op = 0; op < ev_thread_count; op++) {
-		ovis_scheduler[op] = ovis_scheduler_new();
-		if (!ovis_scheduler[op]) {
-			ldmsd_log(LDMSD_LERROR, "Error creating an OVIS scheduler.\n");
-			cleanup(6, "OVIS scheduler create failed");
-		}
-		ret = pthread_create(&ev_thread[op], NULL, event_proc, ovis_scheduler[op]);
-		if (ret) {
-			ldmsd_log(LDMSD_LERROR, "Error %d creating the event "
-					"thread.\n", ret);
-			cleanup(7, "event thread create fail");
-		}
+	ret = pthread_create(&ev_thread, NULL, event_proc, ovis_scheduler);
+	if (ret) {
+		ldmsd_log(LDMSD_LERROR, "Error %d creating the event "
+				"thread.\n", ret);
+		cleanup(7, "event thread create fail");
 	}
 
 	if (!setfile)
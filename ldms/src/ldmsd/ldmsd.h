@@ -125,7 +125,6 @@ typedef struct ldmsd_plugin_set_list {
 struct ldmsd_task;
 typedef void (*ldmsd_task_fn_t)(struct ldmsd_task *, void *arg);
 typedef struct ldmsd_task {
-	int thread_id;
 	int flags;
 	long sched_us;
 	long offset_us;
@@ -140,6 +139,7 @@ typedef struct ldmsd_task {
 	ldmsd_task_fn_t fn;
 	void *fn_arg;
 	ovis_scheduler_t os;
+	uint64_t start_gen; /* incremented by each ldmsd_task_start() */
 	struct ovis_event_s oev;
 } *ldmsd_task_t;
 
@@ -254,6 +254,29 @@ typedef struct ldmsd_prdcr {
 	 * quick lookup by the logic that handles update schedule.
 	 */
 	struct rbt hint_set_tree;
+	/**
+	 * The producer's directory, kept across connections so that a
+	 * reconnect only transfers the changes.
+	 */
+	ldms_dir_cache_t dir_cache;
+	/*
+	 * Reconnect scheduling, see prdcr_conn_admit(). The sched_
+	 * fields and lookup_active are protected by the scheduler lock.
+	 */
+	enum ldmsd_prdcr_sched_state {
+		/** Neither holding nor waiting for a connect slot */
+		LDMSD_PRDCR_SCHED_IDLE,
+		/** Waiting for a connect slot */
+		LDMSD_PRDCR_SCHED_WAIT,
+		/** Connecting or waiting for the directory */
+		LDMSD_PRDCR_SCHED_ACTIVE,
+	} sched_state;
+	TAILQ_ENTRY(ldmsd_prdcr) sched_entry;
+	int lookup_active;	/* outstanding set lookups */
+	int conn_fail;		/* connect attempts since the last directory */
+	struct timespec down_ts; /* start of the current reconnect */
+	int ttfu_pending;	/* no set updated since down_ts */
+	int64_t ttfu_us;	/* time to first update, -1 if none yet */
 #ifdef LDMSD_UPDATE_TIME
 	double sched_update_time;
 #endif /* LDMSD_UPDATE_TIME */
@@ -351,6 +374,19 @@ struct ldmsd_updt_time {
 #define LDMSD_UPDTR_OFFSET_INCR_DEFAULT	100000
 #define LDMSD_UPDTR_OFFSET_INCR_VAR	"LDMSD_UPDTR_OFFSET_INCR"
 
+/*
+ * Producer reconnect storm control: the number of producers that may be
+ * connecting or fetching their directory at a time, the number of set
+ * lookups that may be outstanding and the cap of the reconnect backoff
+ * in microseconds. 0 disables the limit or the backoff.
+ */
+#define LDMSD_PRDCR_CONN_MAX_DEFAULT	256
+#define LDMSD_PRDCR_CONN_MAX_VAR	"LDMSD_PRDCR_CONN_MAX"
+#define LDMSD_PRDCR_LOOKUP_MAX_DEFAULT	4096
+#define LDMSD_PRDCR_LOOKUP_MAX_VAR	"LDMSD_PRDCR_LOOKUP_MAX"
+#define LDMSD_PRDCR_BACKOFF_MAX_DEFAULT	60000000
+#define LDMSD_PRDCR_BACKOFF_MAX_VAR	"LDMSD_PRDCR_BACKOFF_MAX"
+
 struct ldmsd_updtr;
 typedef struct ldmsd_updtr_task {
 	struct ldmsd_updtr *updtr;
@@ -392,6 +428,14 @@ typedef struct ldmsd_updtr {
 	 */
 	uint8_t is_auto_task;
 
+	/*
+	 * If not 0, the sets of a producer are updated with one batch
+	 * update request instead of one update per set.
+	 */
+	uint8_t is_batch;
+	/* If not 0, the batch update asks for the changed data only. */
+	uint8_t is_delta;
+
 	/* The default schedule specified from configuration */
 	struct ldmsd_updtr_task default_task;
 	/*
@@ -418,7 +462,7 @@ typedef struct ldmsd_updtr {
 typedef struct ldmsd_name_match {
 	/** Regular expresion matching schema or instance name */
 	char *regex_str;
-	regex_t regex;
+	struct ldms_name_re regex;
 
 	/** see man recomp */
 	int regex_flags;
@@ -445,6 +489,20 @@ typedef struct ldmsd_strgp_metric {
 typedef struct ldmsd_row_s *ldmsd_row_t;
 typedef struct ldmsd_row_list_s *ldmsd_row_list_t;
 typedef void (*strgp_update_fn_t)(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set);
+
+/** A set snapshot waiting in the storage policy store queue */
+typedef struct ldmsd_strgp_qent {
+	ldms_set_t snap;	/* see ldms_set_snapshot() */
+	struct timespec enq_ts;	/* time at which the snapshot was queued */
+	TAILQ_ENTRY(ldmsd_strgp_qent) entry;
+} *ldmsd_strgp_qent_t;
+
+/** What to do when an update completes and the store queue is full */
+typedef enum ldmsd_strgp_q_policy {
+	LDMSD_STRGP_Q_BLOCK,	/* wait for the store worker to make room */
+	LDMSD_STRGP_Q_DROP_NEW,	/* discard the new snapshot */
+	LDMSD_STRGP_Q_DROP_OLD,	/* discard the oldest queued snapshot */
+} ldmsd_strgp_q_policy_t;
 struct ldmsd_strgp {
 	struct ldmsd_cfgobj obj;
 
@@ -491,7 +549,31 @@ struct ldmsd_strgp {
 	char *decomp_name;
 
 	/** Regular expression for the schema */
-	regex_t schema_regex;
+	struct ldms_name_re schema_regex;
+
+	/**
+	 * Store queue. If \c depth is 0, the data is stored synchronously
+	 * in the update completion path. Otherwise, a snapshot of the set
+	 * is queued and stored by the strgp's store worker.
+	 */
+	struct ldmsd_strgp_queue {
+		int depth;		/* maximum number of queued snapshots */
+		ldmsd_strgp_q_policy_t policy;
+		pthread_mutex_t lock;
+		pthread_cond_t cv;	/* signaled when an entry is dequeued */
+		TAILQ_HEAD(, ldmsd_strgp_qent) head;
+		int len;		/* current queue length */
+		int len_max;		/* queue length high-water mark */
+		struct ev_worker_s *worker;
+		struct ev_s *ev;	/* wakes up the worker */
+		uint64_t enqueued;	/* snapshots queued */
+		uint64_t stored;	/* snapshots given to the store */
+		uint64_t dropped;	/* snapshots discarded */
+		uint64_t blocked;	/* updates that waited for room */
+		uint64_t lat_min_us;	/* time spent in the queue */
+		uint64_t lat_max_us;
+		uint64_t lat_sum_us;
+	} q;
 };
 
 
@@ -651,6 +733,71 @@ int ldmsd_row_to_json_array(ldmsd_row_t row, char **str, int *len);
  */
 int ldmsd_row_to_json_object(ldmsd_row_t row, char **str, int *len);
 
+/**
+ * A growable buffer for serialized rows.
+ *
+ * The \c ldmsd_row_to_*_buf() functions append a row to the buffer,
+ * growing it as needed. A store that serializes many rows can keep one
+ * buffer and set \c len to 0 to reuse it instead of allocating a string
+ * per row. A zero-initialized buffer is empty and valid.
+ */
+struct ldmsd_row_buf_s {
+	char *buf;        /* The serialized rows */
+	size_t len;       /* The number of bytes used in buf */
+	size_t alloc_len; /* The allocated size of buf */
+};
+typedef struct ldmsd_row_buf_s *ldmsd_row_buf_t;
+
+/**
+ * Free the memory of \c b and reset it to empty.
+ */
+void ldmsd_row_buf_free(ldmsd_row_buf_t b);
+
+/**
+ * Append \c row to \c b as a JSON array (see ldmsd_row_to_json_array()).
+ *
+ * The JSON text is '\0'-terminated; the terminator is not counted in
+ * \c b->len. On error, \c b->len is left unchanged.
+ *
+ * \retval 0     If succeeded.
+ * \retval errno If there is an error.
+ */
+int ldmsd_row_to_json_array_buf(ldmsd_row_t row, ldmsd_row_buf_t b);
+
+/**
+ * Append \c row to \c b as a JSON object (see ldmsd_row_to_json_object()).
+ *
+ * The JSON text is '\0'-terminated; the terminator is not counted in
+ * \c b->len. On error, \c b->len is left unchanged.
+ *
+ * \retval 0     If succeeded.
+ * \retval errno If there is an error.
+ */
+int ldmsd_row_to_json_object_buf(ldmsd_row_t row, ldmsd_row_buf_t b);
+
+/**
+ * Append \c row to \c b in the compact binary row encoding.
+ *
+ * All integers are little-endian. The row is encoded as
+ * \code
+ *   u32 col_count
+ *   col_count x {
+ *     u8  type   (enum ldms_value_type)
+ *     u32 count  (1 for scalars, the array length for arrays, the string
+ *                 length for LDMS_V_CHAR_ARRAY)
+ *     count x value (1, 2, 4 or 8 bytes by type; F32 and D64 as their
+ *                    IEEE-754 bits; TIMESTAMP as u32 sec, u32 usec)
+ *   }
+ * \endcode
+ * Column names are not encoded; the columns are in the order of the
+ * decomposition that produced the row.
+ *
+ * \retval 0     If succeeded.
+ * \retval errno If there is an error. \c b->len is left unchanged and, if
+ *               \c b held '\0'-terminated text, it still does.
+ */
+int ldmsd_row_to_binary_buf(ldmsd_row_t row, ldmsd_row_buf_t b);
+
 /**
  * Configure strgp decomposer.
  *
@@ -734,7 +881,6 @@ struct ldmsd_plugin_cfg {
 	unsigned long sample_interval_us;
 	long sample_offset_us;
 	int synchronous;
-	int thread_id;
 	int ref_count;
 	union {
 		struct ldmsd_plugin *plugin;
@@ -744,6 +890,7 @@ struct ldmsd_plugin_cfg {
 	struct timeval timeout;
 	pthread_mutex_t lock;
 	ovis_scheduler_t os;
+	uint64_t start_gen; /* incremented by each start of the sampler */
 	struct ovis_event_s oev;
 	LIST_ENTRY(ldmsd_plugin_cfg) entry;
 };
@@ -831,6 +978,11 @@ void ldmsd_log(enum ldmsd_loglevel level, const char *fmt, ...);
 int ldmsd_loglevel_set(char *verbose_level);
 enum ldmsd_loglevel ldmsd_loglevel_get();
 
+/**
+ * \brief Number of log messages dropped because a log ring was full
+ */
+uint64_t ldmsd_log_dropped();
+
 enum ldmsd_loglevel ldmsd_str_to_loglevel(const char *level_s);
 const char *ldmsd_loglevel_to_str(enum ldmsd_loglevel level);
 
@@ -1045,6 +1197,11 @@ static inline const char *ldmsd_prdcr_set_state_str(enum ldmsd_prdcr_set_state s
 void ldmsd_prdcr_set_ref_get(ldmsd_prdcr_set_t set);
 void ldmsd_prdcr_set_ref_put(ldmsd_prdcr_set_t set);
 void ldmsd_prd_set_updtr_task_update(ldmsd_prdcr_set_t prd_set);
+int ldmsd_prdcr_lookup_admit(ldmsd_prdcr_t prdcr);
+void ldmsd_prdcr_lookup_done(ldmsd_prdcr_t prdcr);
+void ldmsd_prdcr_set_updated(ldmsd_prdcr_t prdcr);
+void ldmsd_prdcr_sched_stats(int *conn_active, int *conn_waiting,
+			     int *lookup_active);
 int ldmsd_prdcr_start(const char *name, const char *interval_str,
 		      ldmsd_sec_ctxt_t ctxt);
 int ldmsd_prdcr_start_regex(const char *prdcr_regex, const char *interval_str,
@@ -1156,6 +1313,17 @@ static inline const char *ldmsd_strgp_state_str(enum ldmsd_strgp_state state) {
 	}
 	return "BAD STATE";
 }
+static inline const char *ldmsd_strgp_q_policy_str(ldmsd_strgp_q_policy_t policy) {
+	switch (policy) {
+	case LDMSD_STRGP_Q_BLOCK:
+		return "block";
+	case LDMSD_STRGP_Q_DROP_NEW:
+		return "drop_new";
+	case LDMSD_STRGP_Q_DROP_OLD:
+		return "drop_old";
+	}
+	return "BAD POLICY";
+}
 int ldmsd_strgp_stop(const char *strgp_name, ldmsd_sec_ctxt_t ctxt);
 int ldmsd_strgp_start(const char *name, ldmsd_sec_ctxt_t ctxt);
 
@@ -1166,6 +1334,14 @@ int __ldmsd_strgp_stop(ldmsd_strgp_t strgp, ldmsd_sec_ctxt_t ctxt);
 /* Function to update inter-dependent configuration objects */
 void ldmsd_prdcr_update(ldmsd_strgp_t strgp);
 void ldmsd_strgp_update(ldmsd_prdcr_set_t prd_set);
+/*
+ * Between ldmsd_strgp_batch_begin() and ldmsd_strgp_batch_end(), the
+ * store workers of the storage policies that queue snapshots in the
+ * calling thread are woken up once, at the end of the batch. Ending a
+ * batch that is not active does nothing.
+ */
+void ldmsd_strgp_batch_begin(void);
+void ldmsd_strgp_batch_end(void);
 int ldmsd_strgp_update_prdcr_set(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set);
 int ldmsd_strgp_prdcr_add(const char *strgp_name, const char *regex_str,
 			  char *rep_buf, size_t rep_len, ldmsd_sec_ctxt_t ctxt);
@@ -1218,6 +1394,7 @@ int ldmsd_set_update_hint_get(ldms_set_t set, long *interva_us, long *offset_us)
 
 /** Regular expressions */
 int ldmsd_compile_regex(regex_t *regex, const char *ex, char *errbuf, size_t errsz);
+int ldmsd_compile_name_re(ldms_name_re_t re, const char *ex, char *errbuf, size_t errsz);
 
 /* Receive a message from an ldms endpoint */
 void ldmsd_recv_msg(ldms_t x, char *data, size_t data_len);
@@ -171,7 +171,6 @@ struct ldmsd_plugin_cfg *new_plugin(char *plugin_name,
 	if (!pi)
 		goto enomem;
 	pthread_mutex_init(&pi->lock, NULL);
-	pi->thread_id = -1;
 	pi->handle = d;
 	pi->name = strdup(plugin_name);
 	if (!pi->name)
@@ -255,6 +254,25 @@ int ldmsd_compile_regex(regex_t *regex, const char *regex_str,
 	return rc;
 }
 
+int ldmsd_compile_name_re(ldms_name_re_t re, const char *regex_str,
+				char *errbuf, size_t errsz)
+{
+	int rc = ldms_name_re_comp(re, regex_str, REG_EXTENDED | REG_NOSUB);
+	if (rc == ENOMEM) {
+		snprintf(errbuf, errsz, "12Out of memory\n");
+	} else if (rc) {
+		snprintf(errbuf, errsz, "22");
+		(void)regerror(rc,
+			       &re->regex,
+			       &errbuf[2],
+			       errsz - 2);
+		strcat(errbuf, "\n");
+	}
+	if (rc)
+		ldms_name_re_free(re);
+	return rc;
+}
+
 /*
  * Load a plugin
  */
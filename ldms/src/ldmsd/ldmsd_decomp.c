@@ -57,6 +57,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdarg.h>
+#include <endian.h>
 
 #include <openssl/sha.h>
 
@@ -305,148 +306,132 @@ int ldmsd_decomp_config(ldmsd_strgp_t strgp, const char *json_path, ldmsd_req_ct
 	return rc;
 }
 
-typedef struct strbuf_s {
-	TAILQ_ENTRY(strbuf_s) entry;
-	int off; /* current write offset */
-	int remain; /* remaining bytes */
-	char buf[];
-} *strbuf_t;
-TAILQ_HEAD(strbuf_tailq_s, strbuf_s);
-typedef struct strbuf_tailq_s *strbuf_tailq_t;
+void ldmsd_row_buf_free(ldmsd_row_buf_t b)
+{
+	free(b->buf);
+	b->buf = NULL;
+	b->len = 0;
+	b->alloc_len = 0;
+}
 
-void strbuf_purge(strbuf_tailq_t h)
+/* make room for `len` more bytes in `b` */
+static int strbuf_reserve(ldmsd_row_buf_t b, size_t len)
 {
-	strbuf_t b;
-	while ((b = TAILQ_FIRST(h))) {
-		TAILQ_REMOVE(h, b, entry);
-		free(b);
-	}
+	size_t sz;
+	char *buf;
+
+	if (b->len + len <= b->alloc_len)
+		return 0;
+	sz = (b->len + len + BUFSIZ - 1) & ~(size_t)(BUFSIZ - 1);
+	if (sz < 2 * b->alloc_len)
+		sz = 2 * b->alloc_len;
+	buf = realloc(b->buf, sz);
+	if (!buf)
+		return ENOMEM;
+	b->buf = buf;
+	b->alloc_len = sz;
+	return 0;
+}
+
+/* drop a partial append past `len`, keeping `b` '\0'-terminated */
+static void strbuf_rollback(ldmsd_row_buf_t b, size_t len)
+{
+	b->len = len;
+	if (len < b->alloc_len)
+		b->buf[len] = '\0';
 }
 
 __attribute__(( format(printf, 2, 3) ))
-int strbuf_printf(strbuf_tailq_t h, const char *fmt, ...)
+int strbuf_printf(ldmsd_row_buf_t h, const char *fmt, ...)
 {
 	va_list ap;
 	int len;
-	strbuf_t b = TAILQ_LAST(h, strbuf_tailq_s);
-
-	if (b)
-		goto print;
-
-	/* no buffer, allocate one */
-	len = BUFSIZ;
 
- alloc:
-	len = (len + BUFSIZ - 1) & ~(BUFSIZ-1);
-	b = malloc(sizeof(*b) + len);
-	if (!b)
+	if (strbuf_reserve(h, 64))
 		return ENOMEM;
-	b->remain = len;
-	b->off = 0;
-	TAILQ_INSERT_TAIL(h, b, entry);
-
- print:
+ again:
 	va_start(ap, fmt);
-	len = vsnprintf(b->buf + b->off, b->remain, fmt, ap);
+	len = vsnprintf(h->buf + h->len, h->alloc_len - h->len, fmt, ap);
 	va_end(ap);
-	if (len >= b->remain) {
-		b->buf[b->off] = '\0'; /* recover */
-		goto alloc;
-	}
-	b->remain -= len;
-	b->off += len;
-	return 0;
-}
-
-static int strbuf_str(strbuf_tailq_t h, char **out_str, int *out_len)
-{
-	int len = 0, off = 0;
-	char *str;
-	strbuf_t b;
-	TAILQ_FOREACH(b, h, entry) {
-		len += b->off;
-	}
-	str = malloc(len + 1);
-	if (!str)
-		return ENOMEM;
-	TAILQ_FOREACH(b, h, entry) {
-		memcpy(str + off, b->buf, b->off);
-		off += b->off;
+	if (len < 0)
+		return EINVAL;
+	if (len >= h->alloc_len - h->len) {
+		if (strbuf_reserve(h, len + 1))
+			return ENOMEM;
+		goto again;
 	}
-	str[len] = '\0';
-	*out_str = str;
-	*out_len = len;
+	h->len += len;
 	return 0;
 }
 
-static int strbuf_printcol_s8(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s8(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%hhd", col->mval->v_s8);
 }
 
-static int strbuf_printcol_u8(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u8(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%hhu", col->mval->v_u8);
 }
 
-static int strbuf_printcol_s16(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s16(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%hd", col->mval->v_s16);
 }
 
-static int strbuf_printcol_u16(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u16(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%hu", col->mval->v_u16);
 }
 
-static int strbuf_printcol_s32(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s32(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%d", col->mval->v_s32);
 }
 
-static int strbuf_printcol_u32(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u32(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%u", col->mval->v_u32);
 }
 
-static int strbuf_printcol_s64(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s64(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%ld", col->mval->v_s64);
 }
 
-static int strbuf_printcol_u64(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u64(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%lu", col->mval->v_u64);
 }
 
-static int strbuf_printcol_f(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_f(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%.9g", col->mval->v_f);
 }
 
-static int strbuf_printcol_d(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_d(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "%.17g", col->mval->v_d);
 }
 
-static int strbuf_printcol_char(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_char(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "\"%c\"", col->mval->v_char);
 }
 
-static int strbuf_printcol_str(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_str(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	return strbuf_printf(h, "\"%s\"", col->mval->a_char);
 }
 
-static int strbuf_printcol_ts(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_ts(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	/* print TS as float */
 	return strbuf_printf(h, "%u.%06u", col->mval->v_ts.sec,
 					   col->mval->v_ts.usec);
 }
 
-static int strbuf_printcol_s8_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s8_array(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -465,7 +450,7 @@ static int strbuf_printcol_s8_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_u8_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u8_array(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -484,7 +469,7 @@ static int strbuf_printcol_u8_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_s16_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s16_array(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -503,7 +488,7 @@ static int strbuf_printcol_s16_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_u16_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u16_array(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -522,7 +507,7 @@ static int strbuf_printcol_u16_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_s32_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s32_array(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -541,7 +526,7 @@ static int strbuf_printcol_s32_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_u32_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u32_array(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -560,7 +545,7 @@ static int strbuf_printcol_u32_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_s64_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_s64_array(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -579,7 +564,7 @@ static int strbuf_printcol_s64_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_u64_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_u64_array(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -598,7 +583,7 @@ static int strbuf_printcol_u64_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_f_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_f_array(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -617,7 +602,7 @@ static int strbuf_printcol_f_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-static int strbuf_printcol_d_array(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol_d_array(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	int rc;
 	int i;
@@ -636,7 +621,7 @@ static int strbuf_printcol_d_array(strbuf_tailq_t h, ldmsd_col_t col)
 	return rc;
 }
 
-typedef int (*printcol_fn)(strbuf_tailq_t h, ldmsd_col_t col);
+typedef int (*printcol_fn)(ldmsd_row_buf_t h, ldmsd_col_t col);
 printcol_fn printcol_tbl[] = {
 	[LDMS_V_S8] = strbuf_printcol_s8,
 	[LDMS_V_U8] = strbuf_printcol_u8,
@@ -664,7 +649,7 @@ printcol_fn printcol_tbl[] = {
 	[LDMS_V_LAST+1] = NULL,
 };
 
-static int strbuf_printcol(strbuf_tailq_t h, ldmsd_col_t col)
+static int strbuf_printcol(ldmsd_row_buf_t h, ldmsd_col_t col)
 {
 	printcol_fn fn;
 	if (col->type > LDMS_V_LAST)
@@ -675,71 +660,220 @@ static int strbuf_printcol(strbuf_tailq_t h, ldmsd_col_t col)
 	return fn(h, col);
 }
 
-int ldmsd_row_to_json_array(ldmsd_row_t row, char **str, int *len)
+int ldmsd_row_to_json_array_buf(ldmsd_row_t row, ldmsd_row_buf_t h)
 {
-	struct strbuf_tailq_s h = TAILQ_HEAD_INITIALIZER(h);
 	ldmsd_col_t col;
+	size_t len = h->len;
 	int i, rc;
 
-	rc = strbuf_printf(&h, "[");
+	rc = strbuf_printf(h, "[");
 	if (rc)
 		goto err_0;
 	for (i = 0; i < row->col_count; i++) {
 		col = &row->cols[i];
 		if (i) { /* comma */
-			rc = strbuf_printf(&h, ",");
+			rc = strbuf_printf(h, ",");
 			if (rc)
 				goto err_0;
 		}
-		rc = strbuf_printcol(&h, col);
+		rc = strbuf_printcol(h, col);
 		if (rc)
 			goto err_0;
 	}
-	rc = strbuf_printf(&h, "]");
+	rc = strbuf_printf(h, "]");
 	if (rc)
 		goto err_0;
-
-	rc = strbuf_str(&h, str, len);
-	strbuf_purge(&h);
-	return rc;
+	return 0;
 
  err_0:
-	strbuf_purge(&h);
+	strbuf_rollback(h, len);
 	return rc;
 }
 
-int ldmsd_row_to_json_object(ldmsd_row_t row, char **str, int *len)
+int ldmsd_row_to_json_object_buf(ldmsd_row_t row, ldmsd_row_buf_t h)
 {
-	struct strbuf_tailq_s h = TAILQ_HEAD_INITIALIZER(h);
 	ldmsd_col_t col;
+	size_t len = h->len;
 	int i, rc;
 
-	rc = strbuf_printf(&h, "{");
+	rc = strbuf_printf(h, "{");
 	if (rc)
 		goto err_0;
 	for (i = 0; i < row->col_count; i++) {
 		col = &row->cols[i];
 		if (i) { /* comma */
-			rc = strbuf_printf(&h, ",");
+			rc = strbuf_printf(h, ",");
 			if (rc)
 				goto err_0;
 		}
-		rc = strbuf_printf(&h, "\"%s\":", col->name);
+		rc = strbuf_printf(h, "\"%s\":", col->name);
 		if (rc)
 			goto err_0;
-		rc = strbuf_printcol(&h, col);
+		rc = strbuf_printcol(h, col);
 		if (rc)
 			goto err_0;
 	}
-	rc = strbuf_printf(&h, "}");
+	rc = strbuf_printf(h, "}");
 	if (rc)
 		goto err_0;
+	return 0;
 
-	rc = strbuf_str(&h, str, len);
-	strbuf_purge(&h);
+ err_0:
+	strbuf_rollback(h, len);
 	return rc;
+}
+
+int ldmsd_row_to_json_array(ldmsd_row_t row, char **str, int *len)
+{
+	struct ldmsd_row_buf_s h = {0};
+	int rc;
+
+	rc = ldmsd_row_to_json_array_buf(row, &h);
+	if (rc) {
+		ldmsd_row_buf_free(&h);
+		return rc;
+	}
+	*str = h.buf;
+	*len = h.len;
+	return 0;
+}
+
+int ldmsd_row_to_json_object(ldmsd_row_t row, char **str, int *len)
+{
+	struct ldmsd_row_buf_s h = {0};
+	int rc;
+
+	rc = ldmsd_row_to_json_object_buf(row, &h);
+	if (rc) {
+		ldmsd_row_buf_free(&h);
+		return rc;
+	}
+	*str = h.buf;
+	*len = h.len;
+	return 0;
+}
+
+static void binbuf_put(ldmsd_row_buf_t h, const void *v, size_t sz)
+{
+	memcpy(h->buf + h->len, v, sz);
+	h->len += sz;
+}
+
+static void binbuf_put_u16(ldmsd_row_buf_t h, uint16_t v)
+{
+	v = htole16(v);
+	binbuf_put(h, &v, sizeof(v));
+}
+
+static void binbuf_put_u32(ldmsd_row_buf_t h, uint32_t v)
+{
+	v = htole32(v);
+	binbuf_put(h, &v, sizeof(v));
+}
+
+static void binbuf_put_u64(ldmsd_row_buf_t h, uint64_t v)
+{
+	v = htole64(v);
+	binbuf_put(h, &v, sizeof(v));
+}
+
+/* the encoded size of a single element of `type` */
+static size_t binbuf_esz(enum ldms_value_type type)
+{
+	switch (type) {
+	case LDMS_V_CHAR:
+	case LDMS_V_S8:
+	case LDMS_V_U8:
+	case LDMS_V_CHAR_ARRAY:
+	case LDMS_V_S8_ARRAY:
+	case LDMS_V_U8_ARRAY:
+		return 1;
+	case LDMS_V_S16:
+	case LDMS_V_U16:
+	case LDMS_V_S16_ARRAY:
+	case LDMS_V_U16_ARRAY:
+		return 2;
+	case LDMS_V_S32:
+	case LDMS_V_U32:
+	case LDMS_V_F32:
+	case LDMS_V_S32_ARRAY:
+	case LDMS_V_U32_ARRAY:
+	case LDMS_V_F32_ARRAY:
+		return 4;
+	case LDMS_V_S64:
+	case LDMS_V_U64:
+	case LDMS_V_D64:
+	case LDMS_V_S64_ARRAY:
+	case LDMS_V_U64_ARRAY:
+	case LDMS_V_D64_ARRAY:
+	case LDMS_V_TIMESTAMP:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+static int binbuf_putcol(ldmsd_row_buf_t h, ldmsd_col_t col)
+{
+	enum ldms_value_type type = col->type;
+	uint32_t n = 1;
+	size_t esz;
+	int i, rc;
+
+	if (type == LDMS_V_CHAR_ARRAY)
+		n = strnlen(col->mval->a_char, col->array_len);
+	else if (ldms_type_is_array(type))
+		n = col->array_len;
+	esz = binbuf_esz(type);
+	if (!esz)
+		return EINVAL;
+	rc = strbuf_reserve(h, 1 + sizeof(n) + (size_t)n * esz);
+	if (rc)
+		return rc;
+	h->buf[h->len++] = (char)type;
+	binbuf_put_u32(h, n);
+	if (type == LDMS_V_TIMESTAMP) {
+		binbuf_put_u32(h, col->mval->v_ts.sec);
+		binbuf_put_u32(h, col->mval->v_ts.usec);
+		return 0;
+	}
+	switch (esz) {
+	case 1:
+		binbuf_put(h, col->mval->a_u8, n);
+		break;
+	case 2:
+		for (i = 0; i < n; i++)
+			binbuf_put_u16(h, col->mval->a_u16[i]);
+		break;
+	case 4:
+		for (i = 0; i < n; i++)
+			binbuf_put_u32(h, col->mval->a_u32[i]);
+		break;
+	case 8:
+		for (i = 0; i < n; i++)
+			binbuf_put_u64(h, col->mval->a_u64[i]);
+		break;
+	}
+	return 0;
+}
+
+int ldmsd_row_to_binary_buf(ldmsd_row_t row, ldmsd_row_buf_t h)
+{
+	size_t len = h->len;
+	int i, rc;
+
+	rc = strbuf_reserve(h, sizeof(uint32_t));
+	if (rc)
+		goto err_0;
+	binbuf_put_u32(h, row->col_count);
+	for (i = 0; i < row->col_count; i++) {
+		rc = binbuf_putcol(h, &row->cols[i]);
+		if (rc)
+			goto err_0;
+	}
+	return 0;
 
  err_0:
-	strbuf_purge(&h);
+	strbuf_rollback(h, len);
 	return rc;
 }
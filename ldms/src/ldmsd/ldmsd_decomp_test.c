@@ -0,0 +1,429 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Check the ldmsd row encoders.
+ *
+ * Every metric type, scalar and array, is encoded with
+ * ldmsd_row_to_binary_buf() and compared byte by byte against the
+ * documented little-endian layout. A row with an unsupported column must
+ * leave a '\0'-terminated buffer exactly as it was.
+ *
+ * usage: test_decomp
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
+#include "ldms.h"
+#include "ldmsd.h"
+
+static int nfail;
+
+/* ---- symbols ldmsd_decomp.c expects from ldmsd ---- */
+
+void ldmsd_lerror(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+size_t Snprintf(char **dst, size_t *len, char *fmt, ...)
+{
+	va_list ap;
+	size_t cnt;
+
+	if (!*dst) {
+		*len = 1024;
+		*dst = malloc(*len);
+		if (!*dst)
+			return -1;
+	}
+	va_start(ap, fmt);
+	cnt = vsnprintf(*dst, *len, fmt, ap);
+	va_end(ap);
+	return cnt;
+}
+
+/* the expected encoding, built independently of the encoder */
+struct expect {
+	unsigned char buf[4096];
+	size_t len;
+};
+
+static void exp_le(struct expect *e, uint64_t v, int sz)
+{
+	int i;
+	for (i = 0; i < sz; i++)
+		e->buf[e->len++] = (v >> (8 * i)) & 0xff;
+}
+
+static void exp_col(struct expect *e, enum ldms_value_type type, uint32_t n)
+{
+	e->buf[e->len++] = (unsigned char)type;
+	exp_le(e, n, 4);
+}
+
+static void check(ldmsd_row_buf_t h, size_t off, struct expect *e,
+		  const char *what)
+{
+	size_t i;
+
+	if (h->len - off != e->len) {
+		printf("ERROR: %s: encoded %zu bytes, expected %zu\n",
+		       what, h->len - off, e->len);
+		nfail++;
+		return;
+	}
+	for (i = 0; i < e->len; i++) {
+		if ((unsigned char)h->buf[off + i] == e->buf[i])
+			continue;
+		printf("ERROR: %s: byte %zu is 0x%02x, expected 0x%02x\n",
+		       what, i, (unsigned char)h->buf[off + i], e->buf[i]);
+		nfail++;
+		return;
+	}
+}
+
+#define NCOLS 25
+#define ALEN 3
+
+static uint64_t vals[NCOLS][8];
+
+static ldmsd_row_t row_new(int ncols)
+{
+	ldmsd_row_t row;
+
+	row = calloc(1, sizeof(*row) + ncols * sizeof(row->cols[0]));
+	if (!row) {
+		printf("ERROR: out of memory\n");
+		exit(1);
+	}
+	row->col_count = ncols;
+	return row;
+}
+
+static void col_set(ldmsd_row_t row, int i, enum ldms_value_type type,
+		    int array_len)
+{
+	row->cols[i].name = ldms_metric_type_to_str(type);
+	row->cols[i].type = type;
+	row->cols[i].array_len = array_len;
+	row->cols[i].mval = (ldms_mval_t)vals[i];
+}
+
+/* one column of every type, values chosen so every byte differs */
+static void check_types(void)
+{
+	struct ldmsd_row_buf_s h = {0};
+	struct expect e = {.len = 0};
+	ldmsd_row_t row;
+	ldms_mval_t v;
+	uint32_t f32;
+	uint64_t d64;
+	int i, c, rc;
+
+	row = row_new(NCOLS);
+	exp_le(&e, NCOLS, 4);
+	c = 0;
+
+	col_set(row, c, LDMS_V_CHAR, 1);
+	row->cols[c++].mval->v_char = 'x';
+	exp_col(&e, LDMS_V_CHAR, 1);
+	exp_le(&e, 'x', 1);
+
+	col_set(row, c, LDMS_V_S8, 1);
+	row->cols[c++].mval->v_s8 = -2;
+	exp_col(&e, LDMS_V_S8, 1);
+	exp_le(&e, 0xfe, 1);
+
+	col_set(row, c, LDMS_V_U8, 1);
+	row->cols[c++].mval->v_u8 = 0xa5;
+	exp_col(&e, LDMS_V_U8, 1);
+	exp_le(&e, 0xa5, 1);
+
+	col_set(row, c, LDMS_V_S16, 1);
+	row->cols[c++].mval->v_s16 = -300;
+	exp_col(&e, LDMS_V_S16, 1);
+	exp_le(&e, (uint16_t)-300, 2);
+
+	col_set(row, c, LDMS_V_U16, 1);
+	row->cols[c++].mval->v_u16 = 0x1234;
+	exp_col(&e, LDMS_V_U16, 1);
+	exp_le(&e, 0x1234, 2);
+
+	col_set(row, c, LDMS_V_S32, 1);
+	row->cols[c++].mval->v_s32 = -70000;
+	exp_col(&e, LDMS_V_S32, 1);
+	exp_le(&e, (uint32_t)-70000, 4);
+
+	col_set(row, c, LDMS_V_U32, 1);
+	row->cols[c++].mval->v_u32 = 0x89abcdef;
+	exp_col(&e, LDMS_V_U32, 1);
+	exp_le(&e, 0x89abcdef, 4);
+
+	col_set(row, c, LDMS_V_S64, 1);
+	row->cols[c++].mval->v_s64 = -5000000000LL;
+	exp_col(&e, LDMS_V_S64, 1);
+	exp_le(&e, (uint64_t)-5000000000LL, 8);
+
+	col_set(row, c, LDMS_V_U64, 1);
+	row->cols[c++].mval->v_u64 = 0x0102030405060708ULL;
+	exp_col(&e, LDMS_V_U64, 1);
+	exp_le(&e, 0x0102030405060708ULL, 8);
+
+	col_set(row, c, LDMS_V_F32, 1);
+	row->cols[c++].mval->v_f = 1.5f;
+	exp_col(&e, LDMS_V_F32, 1);
+	exp_le(&e, 0x3fc00000, 4);
+
+	col_set(row, c, LDMS_V_D64, 1);
+	row->cols[c++].mval->v_d = -0.25;
+	exp_col(&e, LDMS_V_D64, 1);
+	exp_le(&e, 0xbfd0000000000000ULL, 8);
+
+	col_set(row, c, LDMS_V_TIMESTAMP, 1);
+	v = row->cols[c++].mval;
+	v->v_ts.sec = 1700000000;
+	v->v_ts.usec = 123456;
+	exp_col(&e, LDMS_V_TIMESTAMP, 1);
+	exp_le(&e, 1700000000, 4);
+	exp_le(&e, 123456, 4);
+
+	/* the string length, not the array length, is encoded */
+	col_set(row, c, LDMS_V_CHAR_ARRAY, 16);
+	strcpy(row->cols[c++].mval->a_char, "node01");
+	exp_col(&e, LDMS_V_CHAR_ARRAY, 6);
+	for (i = 0; i < 6; i++)
+		exp_le(&e, "node01"[i], 1);
+
+	/* an unterminated string stops at the array length */
+	col_set(row, c, LDMS_V_CHAR_ARRAY, 4);
+	memcpy(row->cols[c++].mval->a_char, "abcdefgh", 8);
+	exp_col(&e, LDMS_V_CHAR_ARRAY, 4);
+	for (i = 0; i < 4; i++)
+		exp_le(&e, "abcd"[i], 1);
+
+	col_set(row, c, LDMS_V_S8_ARRAY, ALEN);
+	v = row->cols[c++].mval;
+	exp_col(&e, LDMS_V_S8_ARRAY, ALEN);
+	for (i = 0; i < ALEN; i++) {
+		v->a_s8[i] = -1 - i;
+		exp_le(&e, (uint8_t)(-1 - i), 1);
+	}
+
+	col_set(row, c, LDMS_V_U8_ARRAY, ALEN);
+	v = row->cols[c++].mval;
+	exp_col(&e, LDMS_V_U8_ARRAY, ALEN);
+	for (i = 0; i < ALEN; i++) {
+		v->a_u8[i] = 0xf0 + i;
+		exp_le(&e, 0xf0 + i, 1);
+	}
+
+	col_set(row, c, LDMS_V_S16_ARRAY, ALEN);
+	v = row->cols[c++].mval;
+	exp_col(&e, LDMS_V_S16_ARRAY, ALEN);
+	for (i = 0; i < ALEN; i++) {
+		v->a_s16[i] = -1000 * (i + 1);
+		exp_le(&e, (uint16_t)(-1000 * (i + 1)), 2);
+	}
+
+	col_set(row, c, LDMS_V_U16_ARRAY, ALEN);
+	v = row->cols[c++].mval;
+	exp_col(&e, LDMS_V_U16_ARRAY, ALEN);
+	for (i = 0; i < ALEN; i++) {
+		v->a_u16[i] = 0xbe00 + i;
+		exp_le(&e, 0xbe00 + i, 2);
+	}
+
+	col_set(row, c, LDMS_V_S32_ARRAY, ALEN);
+	v = row->cols[c++].mval;
+	exp_col(&e, LDMS_V_S32_ARRAY, ALEN);
+	for (i = 0; i < ALEN; i++) {
+		v->a_s32[i] = -100000 * (i + 1);
+		exp_le(&e, (uint32_t)(-100000 * (i + 1)), 4);
+	}
+
+	col_set(row, c, LDMS_V_U32_ARRAY, ALEN);
+	v = row->cols[c++].mval;
+	exp_col(&e, LDMS_V_U32_ARRAY, ALEN);
+	for (i = 0; i < ALEN; i++) {
+		v->a_u32[i] = 0xdead0000 + i;
+		exp_le(&e, 0xdead0000 + i, 4);
+	}
+
+	col_set(row, c, LDMS_V_S64_ARRAY, ALEN);
+	v = row->cols[c++].mval;
+	exp_col(&e, LDMS_V_S64_ARRAY, ALEN);
+	for (i = 0; i < ALEN; i++) {
+		v->a_s64[i] = -(1LL << 40) - i;
+		exp_le(&e, (uint64_t)(-(1LL << 40) - i), 8);
+	}
+
+	col_set(row, c, LDMS_V_U64_ARRAY, ALEN);
+	v = row->cols[c++].mval;
+	exp_col(&e, LDMS_V_U64_ARRAY, ALEN);
+	for (i = 0; i < ALEN; i++) {
+		v->a_u64[i] = 0x1122334455667700ULL + i;
+		exp_le(&e, 0x1122334455667700ULL + i, 8);
+	}
+
+	col_set(row, c, LDMS_V_F32_ARRAY, ALEN);
+	v = row->cols[c++].mval;
+	exp_col(&e, LDMS_V_F32_ARRAY, ALEN);
+	for (i = 0; i < ALEN; i++) {
+		v->a_f[i] = 0.5f * (i + 1);
+		memcpy(&f32, &v->a_f[i], sizeof(f32));
+		exp_le(&e, f32, 4);
+	}
+
+	col_set(row, c, LDMS_V_D64_ARRAY, ALEN);
+	v = row->cols[c++].mval;
+	exp_col(&e, LDMS_V_D64_ARRAY, ALEN);
+	for (i = 0; i < ALEN; i++) {
+		v->a_d[i] = -1.125 * (i + 1);
+		memcpy(&d64, &v->a_d[i], sizeof(d64));
+		exp_le(&e, d64, 8);
+	}
+
+	/* an empty array is just the header */
+	col_set(row, c, LDMS_V_U64_ARRAY, 0);
+	c++;
+	exp_col(&e, LDMS_V_U64_ARRAY, 0);
+
+	if (c != NCOLS) {
+		printf("ERROR: built %d columns, expected %d\n", c, NCOLS);
+		exit(1);
+	}
+
+	rc = ldmsd_row_to_binary_buf(row, &h);
+	if (rc) {
+		printf("ERROR: ldmsd_row_to_binary_buf() returned %d\n", rc);
+		nfail++;
+		goto out;
+	}
+	check(&h, 0, &e, "all types");
+
+	/* a second row is appended after the first */
+	rc = ldmsd_row_to_binary_buf(row, &h);
+	if (rc) {
+		printf("ERROR: append returned %d\n", rc);
+		nfail++;
+		goto out;
+	}
+	check(&h, e.len, &e, "appended row");
+ out:
+	ldmsd_row_buf_free(&h);
+	free(row);
+}
+
+/* a failed append must leave the buffer exactly as it was */
+static void check_rollback(void)
+{
+	struct ldmsd_row_buf_s h = {0};
+	ldmsd_row_t row;
+	int rc;
+
+	row = row_new(3);
+	col_set(row, 0, LDMS_V_U64, 1);
+	row->cols[0].mval->v_u64 = 0xffffffffffffffffULL;
+	col_set(row, 1, LDMS_V_CHAR_ARRAY, 8);
+	strcpy(row->cols[1].mval->a_char, "zzzzzzz");
+	col_set(row, 2, LDMS_V_NONE, 1);
+
+	/* a previous JSON row that a failed append must not clobber */
+	row->col_count = 2;
+	rc = ldmsd_row_to_json_array_buf(row, &h);
+	if (rc) {
+		printf("ERROR: ldmsd_row_to_json_array_buf() returned %d\n", rc);
+		nfail++;
+		goto out;
+	}
+	row->col_count = 3;
+
+	rc = ldmsd_row_to_binary_buf(row, &h);
+	if (rc != EINVAL) {
+		printf("ERROR: binary: bad column returned %d, expected %d\n",
+		       rc, EINVAL);
+		nfail++;
+	}
+	if (h.len != strlen(h.buf) ||
+	    strcmp(h.buf, "[18446744073709551615,\"zzzzzzz\"]")) {
+		printf("ERROR: binary: failed append left \"%.*s\" (len %zu)\n",
+		       (int)h.len, h.buf, h.len);
+		nfail++;
+	}
+
+	rc = ldmsd_row_to_json_object_buf(row, &h);
+	if (rc != EINVAL) {
+		printf("ERROR: json: bad column returned %d, expected %d\n",
+		       rc, EINVAL);
+		nfail++;
+	}
+	if (h.len != strlen(h.buf) ||
+	    strcmp(h.buf, "[18446744073709551615,\"zzzzzzz\"]")) {
+		printf("ERROR: json: failed append left \"%.*s\" (len %zu)\n",
+		       (int)h.len, h.buf, h.len);
+		nfail++;
+	}
+ out:
+	ldmsd_row_buf_free(&h);
+	free(row);
+}
+
+int main(int argc, char **argv)
+{
+	check_types();
+	check_rollback();
+	if (nfail) {
+		printf("%d check(s) failed\n", nfail);
+		return 1;
+	}
+	printf("all row encoding checks passed\n");
+	return 0;
+}
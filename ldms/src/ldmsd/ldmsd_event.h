@@ -62,12 +62,19 @@ extern ev_worker_t logger_w;
 /* LDMSD log */
 extern ev_type_t log_type;
 
+/*
+ * Log messages are kept in per-thread rings in ldmsd.c; the event only
+ * asks the logger to write them out, or to rotate the log file.
+ */
 struct log_data {
 	uint8_t is_rotate;
-	enum ldmsd_loglevel level;
-	char *msg;
-	struct timeval tv;
-	struct tm tm;
+};
+
+/* Storage policy store queue */
+extern ev_type_t strgp_store_type;
+
+struct strgp_store_data {
+	ldmsd_strgp_t strgp;
 };
 
 int ldmsd_ev_init(void);
@@ -88,6 +88,225 @@ int prdcr_resolve(const char *hostname, unsigned short port_no,
 	return 0;
 }
 
+/*
+ * Reconnect storm control
+ *
+ * When an aggregator starts, or the daemons it aggregates restart, all
+ * producers would connect, fetch their directories and look up their
+ * sets at once. Instead at most conn_max producers may be connecting or
+ * waiting for their directory at a time; the others wait in wait_q and
+ * are handed a slot in order as slots are released. At most lookup_max
+ * set lookups may be outstanding; the updaters retry the others on
+ * their next schedule. Connect attempts that fail back off
+ * exponentially with jitter, up to backoff_max_us.
+ */
+#define PRDCR_SCHED_KICK_US 1000
+static struct prdcr_sched {
+	pthread_mutex_t lock;
+	pthread_once_t once;
+	int conn_max;
+	int lookup_max;
+	long backoff_max_us;
+	int conn_active;	/* producers holding a connect slot */
+	int conn_waiting;	/* producers in wait_q */
+	int lookup_active;	/* outstanding lookups of all producers */
+	TAILQ_HEAD(, ldmsd_prdcr) wait_q;
+} prdcr_sched = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.once = PTHREAD_ONCE_INIT,
+	.wait_q = TAILQ_HEAD_INITIALIZER(prdcr_sched.wait_q),
+};
+
+static long prdcr_sched_env(const char *var, long dflt)
+{
+	char *str = getenv(var);
+	if (str)
+		return strtol(str, NULL, 0);
+	return dflt;
+}
+
+static void prdcr_sched_init(void)
+{
+	prdcr_sched.conn_max = prdcr_sched_env(LDMSD_PRDCR_CONN_MAX_VAR,
+					LDMSD_PRDCR_CONN_MAX_DEFAULT);
+	prdcr_sched.lookup_max = prdcr_sched_env(LDMSD_PRDCR_LOOKUP_MAX_VAR,
+					LDMSD_PRDCR_LOOKUP_MAX_DEFAULT);
+	prdcr_sched.backoff_max_us = prdcr_sched_env(LDMSD_PRDCR_BACKOFF_MAX_VAR,
+					LDMSD_PRDCR_BACKOFF_MAX_DEFAULT);
+}
+
+/*
+ * Returns 1 if the producer may connect now, or 0 if it has been queued
+ * for a connect slot. Must be called with the prdcr->lock held.
+ */
+static int prdcr_conn_admit(ldmsd_prdcr_t prdcr)
+{
+	int rc = 1;
+
+	pthread_once(&prdcr_sched.once, prdcr_sched_init);
+	pthread_mutex_lock(&prdcr_sched.lock);
+	switch (prdcr->sched_state) {
+	case LDMSD_PRDCR_SCHED_ACTIVE:
+		break;
+	case LDMSD_PRDCR_SCHED_WAIT:
+		rc = 0;
+		break;
+	case LDMSD_PRDCR_SCHED_IDLE:
+		if (!prdcr_sched.conn_max ||
+		    prdcr_sched.conn_active < prdcr_sched.conn_max) {
+			prdcr_sched.conn_active++;
+			prdcr->sched_state = LDMSD_PRDCR_SCHED_ACTIVE;
+			break;
+		}
+		ldmsd_prdcr_get(prdcr);	/* put when leaving wait_q */
+		TAILQ_INSERT_TAIL(&prdcr_sched.wait_q, prdcr, sched_entry);
+		prdcr_sched.conn_waiting++;
+		prdcr->sched_state = LDMSD_PRDCR_SCHED_WAIT;
+		rc = 0;
+		break;
+	}
+	pthread_mutex_unlock(&prdcr_sched.lock);
+	return rc;
+}
+
+/*
+ * Give up the producer's connect slot, handing it to the first waiting
+ * producer, or its place in wait_q. Must be called with the prdcr->lock
+ * held.
+ */
+static void prdcr_conn_release(ldmsd_prdcr_t prdcr)
+{
+	ldmsd_prdcr_t next = NULL;
+	int waited = 0;
+
+	pthread_mutex_lock(&prdcr_sched.lock);
+	switch (prdcr->sched_state) {
+	case LDMSD_PRDCR_SCHED_IDLE:
+		break;
+	case LDMSD_PRDCR_SCHED_WAIT:
+		TAILQ_REMOVE(&prdcr_sched.wait_q, prdcr, sched_entry);
+		prdcr_sched.conn_waiting--;
+		waited = 1;
+		break;
+	case LDMSD_PRDCR_SCHED_ACTIVE:
+		next = TAILQ_FIRST(&prdcr_sched.wait_q);
+		if (next) {
+			TAILQ_REMOVE(&prdcr_sched.wait_q, next, sched_entry);
+			prdcr_sched.conn_waiting--;
+			next->sched_state = LDMSD_PRDCR_SCHED_ACTIVE;
+		} else {
+			prdcr_sched.conn_active--;
+		}
+		break;
+	}
+	prdcr->sched_state = LDMSD_PRDCR_SCHED_IDLE;
+	pthread_mutex_unlock(&prdcr_sched.lock);
+	if (waited)
+		ldmsd_prdcr_put(prdcr);
+	if (next) {
+		/* Let its task connect it right away */
+		ldmsd_task_resched(&next->task, 0, PRDCR_SCHED_KICK_US, 0);
+		ldmsd_prdcr_put(next);
+	}
+}
+
+/*
+ * The delay until the next connect attempt: the reconnect interval,
+ * doubled for every failed attempt up to backoff_max_us, and drawn
+ * uniformly from its upper half so that producers that lost their
+ * connections together do not retry together.
+ */
+static long prdcr_conn_delay(ldmsd_prdcr_t prdcr)
+{
+	long delay = prdcr->conn_intrvl_us;
+	int i;
+
+	pthread_once(&prdcr_sched.once, prdcr_sched_init);
+	for (i = 0; i < prdcr->conn_fail &&
+		    delay < prdcr_sched.backoff_max_us; i++)
+		delay <<= 1;
+	if (delay > prdcr_sched.backoff_max_us &&
+	    prdcr_sched.backoff_max_us > prdcr->conn_intrvl_us)
+		delay = prdcr_sched.backoff_max_us;
+	if (delay < 2)
+		return 1;
+	return delay - random() % (delay / 2);
+}
+
+int ldmsd_prdcr_lookup_admit(ldmsd_prdcr_t prdcr)
+{
+	int rc = 0;
+
+	pthread_once(&prdcr_sched.once, prdcr_sched_init);
+	pthread_mutex_lock(&prdcr_sched.lock);
+	if (!prdcr_sched.lookup_max ||
+	    prdcr_sched.lookup_active < prdcr_sched.lookup_max) {
+		prdcr_sched.lookup_active++;
+		prdcr->lookup_active++;
+		rc = 1;
+	}
+	pthread_mutex_unlock(&prdcr_sched.lock);
+	return rc;
+}
+
+void ldmsd_prdcr_lookup_done(ldmsd_prdcr_t prdcr)
+{
+	pthread_mutex_lock(&prdcr_sched.lock);
+	/* The lookups of a lost connection have already been dropped */
+	if (prdcr->lookup_active) {
+		prdcr->lookup_active--;
+		prdcr_sched.lookup_active--;
+	}
+	pthread_mutex_unlock(&prdcr_sched.lock);
+}
+
+/* The lookups outstanding on a lost connection never complete */
+static void prdcr_lookup_reset(ldmsd_prdcr_t prdcr)
+{
+	pthread_mutex_lock(&prdcr_sched.lock);
+	prdcr_sched.lookup_active -= prdcr->lookup_active;
+	prdcr->lookup_active = 0;
+	pthread_mutex_unlock(&prdcr_sched.lock);
+}
+
+void ldmsd_prdcr_sched_stats(int *conn_active, int *conn_waiting,
+			     int *lookup_active)
+{
+	pthread_mutex_lock(&prdcr_sched.lock);
+	*conn_active = prdcr_sched.conn_active;
+	*conn_waiting = prdcr_sched.conn_waiting;
+	*lookup_active = prdcr_sched.lookup_active;
+	pthread_mutex_unlock(&prdcr_sched.lock);
+}
+
+/* Must be called with the prdcr->lock held */
+static void prdcr_down(ldmsd_prdcr_t prdcr)
+{
+	/* A reconnect lasts until a set is updated again */
+	if (!prdcr->ttfu_pending) {
+		clock_gettime(CLOCK_REALTIME, &prdcr->down_ts);
+		prdcr->ttfu_pending = 1;
+	}
+}
+
+/*
+ * Called when a set of the producer has been updated. The first update
+ * after the producer lost its connection completes the reconnect.
+ */
+void ldmsd_prdcr_set_updated(ldmsd_prdcr_t prdcr)
+{
+	struct timespec now;
+
+	if (!prdcr->ttfu_pending ||
+	    !__sync_bool_compare_and_swap(&prdcr->ttfu_pending, 1, 0))
+		return;
+	clock_gettime(CLOCK_REALTIME, &now);
+	prdcr->ttfu_us = ldms_timespec_diff_us(&prdcr->down_ts, &now);
+	ldmsd_log(LDMSD_LINFO, "Producer %s: first set update %ld us after "
+		  "it began to connect\n", prdcr->obj.name,
+		  (long)prdcr->ttfu_us);
+}
+
 void ldmsd_prdcr___del(ldmsd_cfgobj_t obj)
 {
 	ldmsd_prdcr_t prdcr = (ldmsd_prdcr_t)obj;
@@ -99,6 +318,7 @@ void ldmsd_prdcr___del(ldmsd_cfgobj_t obj)
 		free(prdcr->conn_auth);
 	if (prdcr->conn_auth_args)
 		av_free(prdcr->conn_auth_args);
+	ldms_dir_cache_free(prdcr->dir_cache);
 	ldmsd_cfgobj___del(obj);
 }
 
@@ -282,7 +502,7 @@ void ldmsd_prd_set_updtr_task_update(ldmsd_prdcr_set_t prd_set)
 					str = prd_set->inst_name;
 				else
 					str = prd_set->schema_name;
-				rc = regexec(&match->regex, str, 0, NULL, 0);
+				rc = ldms_name_re_exec(&match->regex, str);
 				if (!rc)
 					goto update_tasks;
 			}
@@ -462,12 +682,18 @@ static void prdcr_dir_cb(ldms_t xprt, int status, ldms_dir_t dir, void *arg)
 	if (status) {
 		ldmsd_log(LDMSD_LINFO, "Error %d in dir on producer %s host %s.\n",
 			 status, prdcr->obj.name, prdcr->host_name);
+		ldmsd_prdcr_lock(prdcr);
+		prdcr_conn_release(prdcr);
+		ldmsd_prdcr_unlock(prdcr);
 		return;
 	}
 	ldmsd_prdcr_lock(prdcr);
 	switch (dir->type) {
 	case LDMS_DIR_LIST:
 		prdcr_dir_cb_list(xprt, dir, prdcr);
+		/* The sets are known, let the next producer connect */
+		prdcr->conn_fail = 0;
+		prdcr_conn_release(prdcr);
 		break;
 	case LDMS_DIR_ADD:
 		prdcr_dir_cb_add(xprt, dir, prdcr);
@@ -611,8 +837,8 @@ static void prdcr_connect_cb(ldms_t x, ldms_xprt_event_t e, void *cb_arg)
 				  "Could not subscribe to stream data on producer %s\n",
 				  prdcr->obj.name);
 		}
-		if (ldms_xprt_dir(prdcr->xprt, prdcr_dir_cb, prdcr,
-				  LDMS_DIR_F_NOTIFY))
+		if (ldms_xprt_dir_cached(prdcr->xprt, prdcr->dir_cache,
+					 prdcr_dir_cb, prdcr, LDMS_DIR_F_NOTIFY))
 			ldms_xprt_close(prdcr->xprt);
 		ldmsd_task_stop(&prdcr->task);
 		break;
@@ -649,6 +875,8 @@ static void prdcr_connect_cb(ldms_t x, ldms_xprt_event_t e, void *cb_arg)
 
 reset_prdcr:
 	prdcr_reset_sets(prdcr);
+	prdcr_lookup_reset(prdcr);
+	prdcr_conn_release(prdcr);
 	switch (prdcr->conn_state) {
 	case LDMSD_PRDCR_STATE_STOPPING:
 		prdcr->conn_state = LDMSD_PRDCR_STATE_STOPPED;
@@ -657,8 +885,9 @@ reset_prdcr:
 	case LDMSD_PRDCR_STATE_CONNECTING:
 	case LDMSD_PRDCR_STATE_CONNECTED:
 		prdcr->conn_state = LDMSD_PRDCR_STATE_DISCONNECTED;
+		prdcr_down(prdcr);
 		ldmsd_task_start(&prdcr->task, prdcr_task_cb, prdcr,
-				 0, prdcr->conn_intrvl_us, 0);
+				 0, prdcr_conn_delay(prdcr), 0);
 		break;
 	case LDMSD_PRDCR_STATE_STOPPED:
 		assert(0 == "STOPPED shouldn't have xprt event");
@@ -734,7 +963,18 @@ static void prdcr_task_cb(ldmsd_task_t task, void *arg)
 		ldmsd_task_stop(&prdcr->task);
 		break;
 	case LDMSD_PRDCR_STATE_DISCONNECTED:
+		if (prdcr->type != LDMSD_PRDCR_TYPE_ACTIVE) {
+			prdcr_connect(prdcr);
+			break;
+		}
+		if (!prdcr_conn_admit(prdcr))
+			break;
 		prdcr_connect(prdcr);
+		if (prdcr->conn_state == LDMSD_PRDCR_STATE_DISCONNECTED)
+			prdcr_conn_release(prdcr);
+		/* Back off until the next attempt */
+		prdcr->conn_fail++;
+		ldmsd_task_resched(&prdcr->task, 0, prdcr_conn_delay(prdcr), 0);
 		break;
 	case LDMSD_PRDCR_STATE_CONNECTING:
 		break;
@@ -799,6 +1039,7 @@ ldmsd_prdcr_new_with_auth(const char *name, const char *xprt_name,
 	prdcr->conn_intrvl_us = conn_intrvl_us;
 	prdcr->port_no = port_no;
 	prdcr->conn_state = LDMSD_PRDCR_STATE_STOPPED;
+	prdcr->ttfu_us = -1;
 	rbt_init(&prdcr->set_tree, set_cmp);
 	rbt_init(&prdcr->hint_set_tree, ldmsd_updtr_schedule_cmp);
 	prdcr->host_name = strdup(host_name);
@@ -831,6 +1072,10 @@ ldmsd_prdcr_new_with_auth(const char *name, const char *xprt_name,
 			goto out;
 	}
 
+	prdcr->dir_cache = ldms_dir_cache_new();
+	if (!prdcr->dir_cache)
+		goto out;
+
 	ldmsd_task_init(&prdcr->task);
 	ldmsd_cfgobj_unlock(&prdcr->obj);
 	return prdcr;
@@ -921,6 +1166,7 @@ int __ldmsd_prdcr_start(ldmsd_prdcr_t prdcr, ldmsd_sec_ctxt_t ctxt)
 	}
 
 	prdcr->conn_state = LDMSD_PRDCR_STATE_DISCONNECTED;
+	prdcr_down(prdcr);
 
 	prdcr->obj.perm |= LDMSD_PERM_DSTART;
 	ldmsd_task_start(&prdcr->task, prdcr_task_cb, prdcr,
@@ -965,6 +1211,7 @@ int __ldmsd_prdcr_stop(ldmsd_prdcr_t prdcr, ldmsd_sec_ctxt_t ctxt)
 	if (prdcr->type == LDMSD_PRDCR_TYPE_LOCAL)
 		prdcr_reset_sets(prdcr);
 	ldmsd_task_stop(&prdcr->task);
+	prdcr_conn_release(prdcr);
 	prdcr->obj.perm &= ~LDMSD_PERM_DSTART;
 	prdcr->conn_state = LDMSD_PRDCR_STATE_STOPPING;
 	if (prdcr->xprt)
@@ -1215,7 +1462,7 @@ void ldmsd_prdcr_update(ldmsd_strgp_t strgp)
 		int rc;
 		ldmsd_name_match_t match = ldmsd_strgp_prdcr_first(strgp);
 		for (rc = 0; match; match = ldmsd_strgp_prdcr_next(match)) {
-			rc = regexec(&match->regex, prdcr->obj.name, 0, NULL, 0);
+			rc = ldms_name_re_exec(&match->regex, prdcr->obj.name);
 			if (!rc)
 				break;
 		}
@@ -72,6 +72,7 @@
 #include "ldmsd_request.h"
 #include "ldmsd_stream.h"
 #include "ldms_xprt.h"
+#include "ovis_ev/ev.h"
 
 #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
 /*
@@ -2039,11 +2040,13 @@ int __prdcr_status_json_obj(ldmsd_req_ctxt_t reqc, ldmsd_prdcr_t prdcr, int prdc
 			"\"transport\":\"%s\","
 			"\"reconnect_us\":\"%ld\","
 			"\"state\":\"%s\","
+			"\"first_update_us\":%" PRId64 ","
 			"\"sets\": [",
 			prdcr->obj.name, ldmsd_prdcr_type2str(prdcr->type),
 			prdcr->host_name, prdcr->port_no, prdcr->xprt_name,
 			prdcr->conn_intrvl_us,
-			prdcr_state_str(prdcr->conn_state));
+			prdcr_state_str(prdcr->conn_state),
+			prdcr->ttfu_pending ? -1 : prdcr->ttfu_us);
 	if (rc)
 		goto out;
 
@@ -2302,8 +2305,10 @@ int strgp_decomp_init(ldmsd_strgp_t strgp, ldmsd_req_ctxt_t req);
 static int strgp_add_handler(ldmsd_req_ctxt_t reqc)
 {
 	char *attr_name, *name, *plugin, *container, *schema, *interval, *regex;
-	char *decomp;
-	name = plugin = container = schema = NULL;
+	char *decomp, *qdepth, *qpolicy;
+	name = plugin = container = schema = qdepth = qpolicy = NULL;
+	int queue_depth = 0;
+	ldmsd_strgp_q_policy_t queue_policy = LDMSD_STRGP_Q_BLOCK;
 	size_t cnt = 0;
 	uid_t uid;
 	gid_t gid;
@@ -2370,6 +2375,34 @@ static int strgp_add_handler(ldmsd_req_ctxt_t reqc)
 		}
 	}
 
+	qdepth = ldmsd_req_attr_str_value_get_by_id(reqc, LDMSD_ATTR_QUEUE_DEPTH);
+	if (qdepth) {
+		char *endptr;
+		queue_depth = strtol(qdepth, &endptr, 0);
+		if (*endptr != '\0' || queue_depth < 0) {
+			reqc->errcode = EINVAL;
+			cnt = Snprintf(&reqc->line_buf, &reqc->line_len,
+					"The queue_depth '%s' is invalid.", qdepth);
+			goto send_reply;
+		}
+	}
+	qpolicy = ldmsd_req_attr_str_value_get_by_id(reqc, LDMSD_ATTR_QUEUE_POLICY);
+	if (qpolicy) {
+		if (0 == strcasecmp(qpolicy, "block")) {
+			queue_policy = LDMSD_STRGP_Q_BLOCK;
+		} else if (0 == strcasecmp(qpolicy, "drop_new")) {
+			queue_policy = LDMSD_STRGP_Q_DROP_NEW;
+		} else if (0 == strcasecmp(qpolicy, "drop_old")) {
+			queue_policy = LDMSD_STRGP_Q_DROP_OLD;
+		} else {
+			reqc->errcode = EINVAL;
+			cnt = Snprintf(&reqc->line_buf, &reqc->line_len,
+					"The queue_policy '%s' is invalid. "
+					"It must be one of 'block', 'drop_new' "
+					"or 'drop_old'.", qpolicy);
+			goto send_reply;
+		}
+	}
 
 	struct ldmsd_plugin_cfg *store;
 	store = ldmsd_get_plugin(plugin);
@@ -2406,7 +2439,7 @@ static int strgp_add_handler(ldmsd_req_ctxt_t reqc)
 
 	char regex_err[512] = "";
 	if (regex) {
-		rc = ldmsd_compile_regex(&strgp->schema_regex, regex, regex_err, sizeof(regex_err));
+		rc = ldmsd_compile_name_re(&strgp->schema_regex, regex, regex_err, sizeof(regex_err));
 		if (rc)
 			goto eregex;
 	} else {
@@ -2420,6 +2453,8 @@ static int strgp_add_handler(ldmsd_req_ctxt_t reqc)
 		goto enomem;
 
 	strgp->flush_interval = flush_interval;
+	strgp->q.depth = queue_depth;
+	strgp->q.policy = queue_policy;
 
 	if (decomp) {
 		strgp->decomp_name = strdup(decomp);
@@ -2469,6 +2504,8 @@ send_reply:
 	free(container);
 	free(schema);
 	free(perm_s);
+	free(qdepth);
+	free(qpolicy);
 	return 0;
 }
 
@@ -2882,8 +2919,7 @@ int __strgp_status_json_obj(ldmsd_req_ctxt_t reqc, ldmsd_strgp_t strgp,
 		       "\"schema\":\"%s\","
 		       "\"plugin\":\"%s\","
 		       "\"flush\":\"%ld.%06ld\","
-		       "\"state\":\"%s\","
-		       "\"producers\":[",
+		       "\"state\":\"%s\",",
 		       strgp->obj.name,
 		       strgp->container,
 		       strgp->schema,
@@ -2894,6 +2930,37 @@ int __strgp_status_json_obj(ldmsd_req_ctxt_t reqc, ldmsd_strgp_t strgp,
 	if (rc)
 		goto out;
 
+	pthread_mutex_lock(&strgp->q.lock);
+	rc = linebuf_printf(reqc,
+		       "\"queue\":{"
+		       "\"depth\":%d,"
+		       "\"policy\":\"%s\","
+		       "\"len\":%d,"
+		       "\"len_max\":%d,"
+		       "\"enqueued\":%"PRIu64","
+		       "\"stored\":%"PRIu64","
+		       "\"dropped\":%"PRIu64","
+		       "\"blocked\":%"PRIu64","
+		       "\"lat_min_us\":%"PRIu64","
+		       "\"lat_max_us\":%"PRIu64","
+		       "\"lat_avg_us\":%"PRIu64
+		       "},\"producers\":[",
+		       strgp->q.depth,
+		       ldmsd_strgp_q_policy_str(strgp->q.policy),
+		       strgp->q.len,
+		       strgp->q.len_max,
+		       strgp->q.enqueued,
+		       strgp->q.stored,
+		       strgp->q.dropped,
+		       strgp->q.blocked,
+		       strgp->q.lat_min_us,
+		       strgp->q.lat_max_us,
+		       (strgp->q.stored ?
+			strgp->q.lat_sum_us / strgp->q.stored : 0));
+	pthread_mutex_unlock(&strgp->q.lock);
+	if (rc)
+		goto out;
+
 	match_count = 0;
 	for (match = ldmsd_strgp_prdcr_first(strgp); match;
 	     match = ldmsd_strgp_prdcr_next(match)) {
@@ -3007,14 +3074,15 @@ out:
 static int updtr_add_handler(ldmsd_req_ctxt_t reqc)
 {
 	char *name, *offset_str, *interval_str, *push, *auto_interval, *attr_name;
-	name = offset_str = interval_str = push = auto_interval = NULL;
+	char *batch;
+	name = offset_str = interval_str = push = auto_interval = batch = NULL;
 	size_t cnt = 0;
 	uid_t uid;
 	gid_t gid;
 	int perm;
 	char *perm_s = NULL;
 	char *endptr;
-	int push_flags, is_auto_task;
+	int push_flags, is_auto_task, is_batch;
 	long interval, offset;
 
 	reqc->errcode = 0;
@@ -3103,6 +3171,7 @@ static int updtr_add_handler(ldmsd_req_ctxt_t reqc)
 
 	push = ldmsd_req_attr_str_value_get_by_id(reqc, LDMSD_ATTR_PUSH);
 	auto_interval = ldmsd_req_attr_str_value_get_by_id(reqc, LDMSD_ATTR_AUTO_INTERVAL);
+	batch = ldmsd_req_attr_str_value_get_by_id(reqc, LDMSD_ATTR_BATCH);
 
 	struct ldmsd_sec_ctxt sctxt;
 	ldmsd_req_ctxt_sec_get(reqc, &sctxt);
@@ -3151,6 +3220,26 @@ static int updtr_add_handler(ldmsd_req_ctxt_t reqc)
 		}
 		is_auto_task = 0;
 	}
+	is_batch = 0;
+	if (batch) {
+		if (0 == strcasecmp(batch, "true") ||
+		    0 == strcasecmp(batch, "delta")) {
+			if (push) {
+				reqc->errcode = EINVAL;
+				cnt = Snprintf(&reqc->line_buf, &reqc->line_len,
+						"batch and push are "
+						"incompatible options");
+				goto send_reply;
+			}
+			is_batch = (0 == strcasecmp(batch, "delta")) ? 2 : 1;
+		} else if (0 != strcasecmp(batch, "false")) {
+			reqc->errcode = EINVAL;
+			cnt = Snprintf(&reqc->line_buf, &reqc->line_len,
+				       "The batch option requires "
+				       "'true', 'delta', or 'false'\n");
+			goto send_reply;
+		}
+	}
 	ldmsd_updtr_t updtr = ldmsd_updtr_new_with_auth(name, interval_str,
 							offset_str ? offset_str : "0",
 							push_flags,
@@ -3170,6 +3259,9 @@ static int updtr_add_handler(ldmsd_req_ctxt_t reqc)
 			cnt = Snprintf(&reqc->line_buf, &reqc->line_len,
 				       "The updtr could not be created.");
 		}
+	} else {
+		updtr->is_batch = (is_batch != 0);
+		updtr->is_delta = (is_batch == 2);
 	}
 
 send_reply:
@@ -3177,6 +3269,7 @@ send_reply:
 	free(name);
 	free(interval_str);
 	free(auto_interval);
+	free(batch);
 	free(offset_str);
 	free(push);
 	free(perm_s);
@@ -3807,6 +3900,7 @@ int __updtr_status_json_obj(ldmsd_req_ctxt_t reqc, ldmsd_updtr_t updtr,
 		"\"sync\":\"%s\","
 		"\"mode\":\"%s\","
 		"\"auto\":\"%s\","
+		"\"batch\":\"%s\","
 		"\"state\":\"%s\","
 		"\"producers\":[",
 		updtr->obj.name,
@@ -3815,6 +3909,8 @@ int __updtr_status_json_obj(ldmsd_req_ctxt_t reqc, ldmsd_updtr_t updtr,
 		((updtr->default_task.task_flags==LDMSD_TASK_F_SYNCHRONOUS)?"true":"false"),
 		update_mode(updtr->push_flags),
 		(updtr->is_auto_task ? "true" : "false"),
+		(updtr->is_delta ? "delta" :
+			(updtr->is_batch ? "true" : "false")),
 		ldmsd_updtr_state_str(updtr->state));
 	if (rc)
 		goto out;
@@ -3927,6 +4023,25 @@ out:
 	return rc;
 }
 
+extern ovis_scheduler_t ovis_scheduler;
+
+/* The dispatch statistics of a sampler or task event */
+static int __sched_stats_json(ldmsd_req_ctxt_t reqc, ovis_event_t ev)
+{
+	struct ovis_event_stats_s st = {0};
+
+	(void)ovis_event_stats_get(ovis_scheduler, ev, &st);
+	return linebuf_printf(reqc,
+		"{\"count\":%" PRIu64 ","
+		"\"overrun\":%" PRIu64 ","
+		"\"lat_min_us\":%" PRIu64 ","
+		"\"lat_max_us\":%" PRIu64 ","
+		"\"lat_mean_us\":%.0f,"
+		"\"jitter_us\":%.0f}",
+		st.count, st.overrun, st.lat_min_us, st.lat_max_us,
+		st.lat_mean_us, st.jitter_us);
+}
+
 static int __updtr_task_json_obj(ldmsd_req_ctxt_t reqc, ldmsd_updtr_task_t task)
 {
 	int rc;
@@ -3942,8 +4057,14 @@ static int __updtr_task_json_obj(ldmsd_req_ctxt_t reqc, ldmsd_updtr_task_t task)
 	}
 	if (rc)
 		return rc;
-	rc = linebuf_printf(reqc, "\"default_task\":\"%s\"}",
+	rc = linebuf_printf(reqc, "\"default_task\":\"%s\",\"sched\":",
 			(task->is_default)?"true":"false");
+	if (rc)
+		return rc;
+	rc = __sched_stats_json(reqc, &task->task.oev);
+	if (rc)
+		return rc;
+	rc = linebuf_printf(reqc, "}");
 	return rc;
 }
 
@@ -4683,13 +4804,20 @@ int __plugn_status_json_obj(ldmsd_req_ctxt_t reqc)
 			       "{\"name\":\"%s\",\"type\":\"%s\","
 			       "\"sample_interval_us\":%ld,"
 			       "\"sample_offset_us\":%ld,"
-			       "\"libpath\":\"%s\"}",
+			       "\"libpath\":\"%s\","
+			       "\"sched\":",
 			       p->plugin->name,
 			       plugn_state_str(p->plugin->type),
 			       p->sample_interval_us, p->sample_offset_us,
 			       p->libpath);
 		if (rc)
 			return rc;
+		rc = __sched_stats_json(reqc, &p->oev);
+		if (rc)
+			return rc;
+		rc = linebuf_printf(reqc, "}");
+		if (rc)
+			return rc;
 	}
 	rc = linebuf_printf(reqc, "]");
 	return rc;
@@ -5912,6 +6040,10 @@ out:
  *     "xprt_count"  : <int>,
  *     "open_count"  : <int>,
  *     "close_count" : <int>,
+ *     "ctxt_alloc_count" : <int>,
+ *     "ctxt_reuse_count" : <int>,
+ *     "push_set_count"   : <int>,
+ *     "push_msg_count"   : <int>,
  *     "lookup_req"  : {
  *        "count"    : <int>
  *        "total_us" : <int>
@@ -5993,6 +6125,8 @@ static char *__xprt_stats_as_json(size_t *json_sz)
 	int xprt_connecting_count = 0;
 	int xprt_listen_count = 0;
 	int xprt_close_count = 0;
+	uint64_t ctxt_alloc = 0, ctxt_reuse = 0;
+	uint64_t push_set = 0, push_msg = 0;
 	struct timespec start, end;
 	struct sockaddr_storage ss_local, ss_remote;
 	struct sockaddr_in *sin;
@@ -6024,6 +6158,10 @@ static char *__xprt_stats_as_json(size_t *json_sz)
 
 		ldms_xprt_stats(x, &xs);
 		xprt_count += 1;
+		ctxt_alloc += xs.ctxt_alloc;
+		ctxt_reuse += xs.ctxt_reuse;
+		push_set += xs.push_set;
+		push_msg += xs.push_msg;
 		zap_ep_state_t ep_state =
 			(x->zap_ep ? zap_ep_state(x->zap_ep) : ZAP_EP_CLOSE);
 		switch (ep_state) {
@@ -6083,6 +6221,10 @@ static char *__xprt_stats_as_json(size_t *json_sz)
 	__APPEND(" \"connecting_count\": %d,\n", xprt_connecting_count);
 	__APPEND(" \"listen_count\": %d,\n", xprt_listen_count);
 	__APPEND(" \"close_count\": %d,\n", xprt_close_count);
+	__APPEND(" \"ctxt_alloc_count\": %" PRIu64 ",\n", ctxt_alloc);
+	__APPEND(" \"ctxt_reuse_count\": %" PRIu64 ",\n", ctxt_reuse);
+	__APPEND(" \"push_set_count\": %" PRIu64 ",\n", push_set);
+	__APPEND(" \"push_msg_count\": %" PRIu64 ",\n", push_msg);
 	__APPEND(" \"duration\": %g,\n", rate_data.duration);
 	__APPEND(" \"op_stats\": {\n");
 	for (op_e = 0; op_e < LDMS_XPRT_OP_COUNT; op_e++) {
@@ -6185,8 +6327,31 @@ err:
 	return ENOMEM;
 }
 
+struct ev_worker_list {
+	int count;
+	int alloc;
+	ev_worker_t *w;
+};
+
+static int __ev_worker_collect(ev_worker_t w, void *arg)
+{
+	struct ev_worker_list *l = arg;
+	ev_worker_t *n;
+
+	if (l->count == l->alloc) {
+		n = realloc(l->w, (l->alloc + 16) * sizeof(*n));
+		if (!n)
+			return ENOMEM;
+		l->w = n;
+		l->alloc += 16;
+	}
+	l->w[l->count++] = w;
+	return 0;
+}
+
 /*
- * Sends a JSON formatted summary of Zap thread statistics as follows:
+ * Sends a JSON formatted summary of Zap thread statistics and of the
+ * event workers as follows:
  *
  * { "count" : <int>,
  *   "entries" : [
@@ -6196,7 +6361,20 @@ err:
  *        "utilization" : <float>
  *      },
  *      . . .
- *   ]
+ *   ],
+ *   "ev_workers" : [
+ *      { "name" : <string>,
+ *        "threads" : <int>,
+ *        "queue_depth" : <int>,
+ *        "queue_depth_max" : <int>,
+ *        "timed" : <int>,
+ *        "processed" : <int>,
+ *        "wait_avg_us" : <float>,
+ *        "wait_max_us" : <float>
+ *      },
+ *      . . .
+ *   ],
+ *   "log_dropped" : <int>
  * }
  */
 static char * __thread_stats_as_json(size_t *json_sz)
@@ -6206,12 +6384,19 @@ static char * __thread_stats_as_json(size_t *json_sz)
 	int i;
 	struct timespec start, end;
 	struct zap_thrstat_result *res;
+	struct ev_worker_list evl = {};
+	struct ev_worker_stats_s evs;
 
 	(void)clock_gettime(CLOCK_REALTIME, &start);
 
 	res = zap_thrstat_get_result();
 	if (!res)
 		return NULL;
+	if (ev_worker_iter(__ev_worker_collect, &evl)) {
+		zap_thrstat_free_result(res);
+		free(evl.w);
+		return NULL;
+	}
 
 	buff = malloc(sz);
 	if (!buff)
@@ -6232,21 +6417,48 @@ static char * __thread_stats_as_json(size_t *json_sz)
 		else
 			__APPEND("  }\n");
 	}
+	__APPEND(" ],\n"); /* end of entries array */
+	__APPEND(" \"ev_workers\": [\n");
+	for (i = 0; i < evl.count; i++) {
+		ev_worker_stats(evl.w[i], &evs);
+		__APPEND("  {\n");
+		__APPEND("   \"name\": \"%s\",\n", ev_worker_name(evl.w[i]));
+		__APPEND("   \"threads\": %d,\n", evs.threads);
+		__APPEND("   \"queue_depth\": %d,\n", evs.queue_depth);
+		__APPEND("   \"queue_depth_max\": %d,\n", evs.queue_depth_max);
+		__APPEND("   \"timed\": %d,\n", evs.timed);
+		__APPEND("   \"processed\": %" PRIu64 ",\n", evs.processed);
+		__APPEND("   \"wait_avg_us\": %g,\n", evs.wait_avg_us);
+		__APPEND("   \"wait_max_us\": %g\n", evs.wait_max_us);
+		if (i < evl.count - 1)
+			__APPEND("  },\n");
+		else
+			__APPEND("  }\n");
+	}
 	(void)clock_gettime(CLOCK_REALTIME, &end);
 	uint64_t compute_time = ldms_timespec_diff_us(&start, &end);
-	__APPEND(" ],\n"); /* end of entries array */
+	__APPEND(" ],\n"); /* end of ev_workers array */
+	__APPEND(" \"log_dropped\": %" PRIu64 ",\n", ldmsd_log_dropped());
 	__APPEND(" \"compute_time\": %ld\n", compute_time);
 	__APPEND("}"); /* end */
 
 	*json_sz = s - buff + 1;
 	zap_thrstat_free_result(res);
+	free(evl.w);
 	return buff;
 __APPEND_ERR:
 	zap_thrstat_free_result(res);
+	free(evl.w);
 	free(buff);
 	return NULL;
 }
 
+static int __ev_worker_stats_reset(ev_worker_t w, void *arg)
+{
+	ev_worker_stats_reset(w);
+	return 0;
+}
+
 static int thread_stats_handler(ldmsd_req_ctxt_t req)
 {
 	char *json_s, *s;
@@ -6278,8 +6490,10 @@ static int thread_stats_handler(ldmsd_req_ctxt_t req)
 		goto err;
 
 	free(json_s);
-	if (reset)
+	if (reset) {
 		zap_thrstat_reset_all();
+		ev_worker_iter(__ev_worker_stats_reset, NULL);
+	}
 	return 0;
 err:
 	free(json_s);
@@ -6298,8 +6512,20 @@ err:
  *   "connecting" : <int>,
  * 	 "connected" : <int>,
  *   "stopping"	: <int>,
+ *   "set_count" : <int>,
+ *   "conn_active" : <int>,
+ *   "conn_waiting" : <int>,
+ *   "lookup_active" : <int>,
+ *   "first_update_max_us" : <int>,
+ *   "first_update_avg_us" : <int>,
  *   "compute_time" : <int>
  * }
+ *
+ * conn_active and conn_waiting are the producers that hold or wait for
+ * a connect slot and lookup_active the outstanding set lookups. The
+ * first_update values summarize the time from starting to connect to
+ * the first set update of the producers whose last reconnect is
+ * complete.
  */
 static char * __prdcr_stats_as_json(size_t *json_sz)
 {
@@ -6309,7 +6535,9 @@ static char * __prdcr_stats_as_json(size_t *json_sz)
 	size_t sz = __APPEND_SZ;
 	int prdcr_count = 0, stopped_count = 0, disconnected_count = 0,
 		connecting_count = 0, connected_count = 0, stopping_count = 0,
-		set_count = 0;
+		set_count = 0, ttfu_count = 0;
+	int conn_active, conn_waiting, lookup_active;
+	int64_t ttfu_max = 0, ttfu_sum = 0;
 
 	(void)clock_gettime(CLOCK_REALTIME, &start);
 	ldmsd_cfg_lock(LDMSD_CFGOBJ_PRDCR);
@@ -6334,8 +6562,15 @@ static char * __prdcr_stats_as_json(size_t *json_sz)
 			break;
 		}
 		set_count += rbt_card(&prdcr->set_tree);
+		if (!prdcr->ttfu_pending && prdcr->ttfu_us >= 0) {
+			ttfu_count++;
+			ttfu_sum += prdcr->ttfu_us;
+			if (prdcr->ttfu_us > ttfu_max)
+				ttfu_max = prdcr->ttfu_us;
+		}
 	}
 	ldmsd_cfg_unlock(LDMSD_CFGOBJ_PRDCR);
+	ldmsd_prdcr_sched_stats(&conn_active, &conn_waiting, &lookup_active);
 
 	buff = malloc(sz);
 	if (!buff)
@@ -6350,6 +6585,12 @@ static char * __prdcr_stats_as_json(size_t *json_sz)
 	__APPEND(" \"connected_count\": %d,\n", connected_count);
 	__APPEND(" \"stopping_count\": %d,\n", stopping_count);
 	__APPEND(" \"set_count\": %d,\n", set_count);
+	__APPEND(" \"conn_active\": %d,\n", conn_active);
+	__APPEND(" \"conn_waiting\": %d,\n", conn_waiting);
+	__APPEND(" \"lookup_active\": %d,\n", lookup_active);
+	__APPEND(" \"first_update_max_us\": %" PRId64 ",\n", ttfu_max);
+	__APPEND(" \"first_update_avg_us\": %" PRId64 ",\n",
+		 ttfu_count ? ttfu_sum / ttfu_count : 0);
 	(void)clock_gettime(CLOCK_REALTIME, &end);
 	uint64_t compute_time = ldms_timespec_diff_us(&start, &end);
 	__APPEND(" \"compute_time\": %ld\n", compute_time);
@@ -6439,7 +6680,7 @@ static char * __set_stats_as_json(size_t *json_sz)
 					ldmsd_prdcr_set_t prd_set;
 					for (prd_set = ldmsd_prdcr_set_first(ref->prdcr); prd_set;
 							prd_set = ldmsd_prdcr_set_next(prd_set)) {
-						rc = regexec(&match->regex, prd_set->inst_name, 0, NULL, 0);
+						rc = ldms_name_re_exec(&match->regex, prd_set->inst_name);
 						if (rc)
 							continue;
 						freq = 1000000 / (double)prd_set->updt_interval;
@@ -207,6 +207,9 @@ enum ldmsd_request_attr {
 	LDMSD_ATTR_AUTH,
 	LDMSD_ATTR_RESET,
 	LDMSD_ATTR_DECOMP,
+	LDMSD_ATTR_QUEUE_DEPTH,
+	LDMSD_ATTR_QUEUE_POLICY,
+	LDMSD_ATTR_BATCH,
 	LDMSD_ATTR_LAST,
 };
 
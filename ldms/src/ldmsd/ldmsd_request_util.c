@@ -147,6 +147,7 @@ const struct req_str_id attr_str_id_table[] = {
 	{  "auto_interval",     LDMSD_ATTR_AUTO_INTERVAL  },
 	{  "auto_switch",       LDMSD_ATTR_AUTO_SWITCH  },
 	{  "base",              LDMSD_ATTR_BASE  },
+	{  "batch",             LDMSD_ATTR_BATCH  },
 	{  "container",         LDMSD_ATTR_CONTAINER  },
 	{  "decomposition",     LDMSD_ATTR_DECOMP  },
 	{  "flush",		LDMSD_ATTR_INTERVAL },
@@ -168,6 +169,8 @@ const struct req_str_id attr_str_id_table[] = {
 	{  "port",              LDMSD_ATTR_PORT  },
 	{  "producer",          LDMSD_ATTR_PRODUCER  },
 	{  "push",              LDMSD_ATTR_PUSH  },
+	{  "queue_depth",       LDMSD_ATTR_QUEUE_DEPTH  },
+	{  "queue_policy",      LDMSD_ATTR_QUEUE_POLICY  },
 	{  "regex",             LDMSD_ATTR_REGEX  },
 	{  "schema",            LDMSD_ATTR_SCHEMA  },
 	{  "stream",            LDMSD_ATTR_STREAM  },
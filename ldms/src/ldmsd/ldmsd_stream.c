@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,6 +8,8 @@
 #include <sys/time.h>
 #include <unistd.h>
 #include <semaphore.h>
+#include <pthread.h>
+#include <sys/queue.h>
 #include <ovis_json/ovis_json.h>
 #include <execinfo.h> /* for backtrace_symbols() */
 #include "ldms.h"
@@ -43,14 +46,48 @@ typedef struct ldmsd_stream_publisher_s {
 } *ldmsd_stream_publisher_t;
 
 typedef struct ldmsd_stream_s *ldmsd_stream_t;
+
+/* A message waiting in a client delivery queue */
+struct ldmsd_stream_qent_s {
+	ldmsd_stream_type_t q_type;
+	size_t q_len;
+	TAILQ_ENTRY(ldmsd_stream_qent_s) q_ent;
+	char q_data[OVIS_FLEX];
+};
+
 struct ldmsd_stream_client_s {
 	ldmsd_stream_recv_cb_t c_cb_fn;
 	void *c_ctxt;
 	ldmsd_stream_t c_s;
 	int c_flags;
+	int c_ref;	/* the client handle + one per subscriber snapshot */
+	int c_busy;	/* callbacks in progress */
+	int c_closed;
+	pthread_mutex_t c_lock;
+	pthread_cond_t c_cv;	/* signaled when c_busy drops to 0 or on enqueue */
+	/* Optional delivery queue, see ldmsd_stream_queue_set() */
+	int c_q_stop;
+	pthread_t c_q_thread;
+	size_t c_q_depth;	/* 0 if the client has no queue */
+	size_t c_q_len;
+	uint64_t c_q_drops;
+	TAILQ_HEAD(, ldmsd_stream_qent_s) c_q;
 	LIST_ENTRY(ldmsd_stream_client_s) c_ent;
 };
 
+/*
+ * Immutable snapshot of the subscribers of a stream. The snapshot is
+ * replaced (copy-on-write) by subscribe and close under the stream
+ * lock. A delivery takes a reference on the current snapshot and
+ * invokes the callbacks without holding the stream lock, so a slow
+ * subscriber neither blocks other publishers nor subscribe/close.
+ */
+struct ldmsd_stream_clist_s {
+	int ref;
+	int count;
+	ldmsd_stream_client_t clients[OVIS_FLEX];
+};
+
 static int p_cmp(void *tree_key, const void *key)
 {
 	return strcmp((char *)tree_key, (const char *)key);
@@ -62,6 +99,7 @@ struct ldmsd_stream_s {
 	struct rbn s_ent;
 	pthread_mutex_t s_lock;
 	LIST_HEAD(ldmsd_client_list, ldmsd_stream_client_s) s_c_list;
+	struct ldmsd_stream_clist_s *s_clist; /* delivery snapshot of s_c_list */
 	struct rbt s_p_tree;
 };
 
@@ -263,15 +301,214 @@ int ldmsd_stream_subscriber_count(const char *stream_name)
 	return subscriber_count;
 }
 
+static pthread_once_t __parser_once = PTHREAD_ONCE_INIT;
+static pthread_key_t __parser_key;
+
+static void __parser_key_free(void *arg)
+{
+	json_parser_free(arg);
+}
+
+static void __parser_key_init(void)
+{
+	pthread_key_create(&__parser_key, __parser_key_free);
+}
+
+/*
+ * Parse \c data with the parser of the calling thread. The parser is
+ * created on first use and freed when the thread exits.
+ */
+static int __stream_parse(const char *data, size_t data_len,
+			  json_entity_t *entity)
+{
+	json_parser_t parser;
+	pthread_once(&__parser_once, __parser_key_init);
+	parser = pthread_getspecific(__parser_key);
+	if (!parser) {
+		parser = json_parser_new(0);
+		if (!parser)
+			return ENOMEM;
+		if (pthread_setspecific(__parser_key, parser)) {
+			json_parser_free(parser);
+			return ENOMEM;
+		}
+	}
+	return json_parse_buffer_arena(parser, data, data_len, entity);
+}
+
+/* The client whose callback is running on this thread */
+static __thread ldmsd_stream_client_t __cb_client;
+
+static void __client_put(ldmsd_stream_client_t c)
+{
+	if (__sync_sub_and_fetch(&c->c_ref, 1))
+		return;
+	pthread_mutex_destroy(&c->c_lock);
+	pthread_cond_destroy(&c->c_cv);
+	free(c);
+}
+
+static void __clist_put(struct ldmsd_stream_clist_s *cl)
+{
+	int i;
+	if (!cl || __sync_sub_and_fetch(&cl->ref, 1))
+		return;
+	for (i = 0; i < cl->count; i++)
+		__client_put(cl->clients[i]);
+	free(cl);
+}
+
+/* Replace the delivery snapshot. The caller must hold the stream lock. */
+static int __clist_update(ldmsd_stream_t s)
+{
+	struct ldmsd_stream_clist_s *cl, *old;
+	ldmsd_stream_client_t c;
+	int count = 0;
+
+	LIST_FOREACH(c, &s->s_c_list, c_ent) {
+		count++;
+	}
+	cl = malloc(sizeof(*cl) + count * sizeof(cl->clients[0]));
+	if (!cl)
+		return ENOMEM;
+	cl->ref = 1;
+	cl->count = 0;
+	LIST_FOREACH(c, &s->s_c_list, c_ent) {
+		__sync_add_and_fetch(&c->c_ref, 1);
+		cl->clients[cl->count++] = c;
+	}
+	old = s->s_clist;
+	s->s_clist = cl;
+	__clist_put(old);
+	return 0;
+}
+
+static void __client_cb(ldmsd_stream_client_t c, ldmsd_stream_type_t stream_type,
+			const char *data, size_t data_len, json_entity_t entity)
+{
+	ldmsd_stream_client_t prev = __cb_client;
+
+	/*
+	 * c_busy is raised before c_closed is read, and
+	 * ldmsd_stream_close() sets c_closed before it reads c_busy;
+	 * with sequentially consistent accesses either the callback is
+	 * skipped here or close waits for it.
+	 */
+	__atomic_add_fetch(&c->c_busy, 1, __ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&c->c_closed, __ATOMIC_SEQ_CST)) {
+		__cb_client = c;
+		c->c_cb_fn(c, c->c_ctxt, stream_type, data, data_len, entity);
+		__cb_client = prev;
+	}
+	if (0 == __atomic_sub_fetch(&c->c_busy, 1, __ATOMIC_SEQ_CST) &&
+	    __atomic_load_n(&c->c_closed, __ATOMIC_SEQ_CST)) {
+		/* wake up ldmsd_stream_close() */
+		pthread_mutex_lock(&c->c_lock);
+		pthread_cond_broadcast(&c->c_cv);
+		pthread_mutex_unlock(&c->c_lock);
+	}
+}
+
+static void __client_enqueue(ldmsd_stream_client_t c,
+			     ldmsd_stream_type_t stream_type,
+			     const char *data, size_t data_len)
+{
+	struct ldmsd_stream_qent_s *q;
+
+	q = malloc(sizeof(*q) + data_len + 1);
+	pthread_mutex_lock(&c->c_lock);
+	if (!q || c->c_q_len >= c->c_q_depth || c->c_q_stop) {
+		/* Drop the message rather than stall the publisher */
+		c->c_q_drops++;
+		pthread_mutex_unlock(&c->c_lock);
+		free(q);
+		return;
+	}
+	q->q_type = stream_type;
+	q->q_len = data_len;
+	memcpy(q->q_data, data, data_len);
+	q->q_data[data_len] = '\0';
+	TAILQ_INSERT_TAIL(&c->c_q, q, q_ent);
+	c->c_q_len++;
+	pthread_cond_broadcast(&c->c_cv);
+	pthread_mutex_unlock(&c->c_lock);
+}
+
+static void *__client_q_proc(void *arg)
+{
+	ldmsd_stream_client_t c = arg;
+	struct ldmsd_stream_qent_s *q;
+	json_entity_t entity;
+
+	pthread_mutex_lock(&c->c_lock);
+	while (!c->c_q_stop) {
+		q = TAILQ_FIRST(&c->c_q);
+		if (!q) {
+			pthread_cond_wait(&c->c_cv, &c->c_lock);
+			continue;
+		}
+		TAILQ_REMOVE(&c->c_q, q, q_ent);
+		c->c_q_len--;
+		pthread_mutex_unlock(&c->c_lock);
+		entity = NULL;
+		if (q->q_type == LDMSD_STREAM_JSON
+		    && !(c->c_flags & LDMSD_STREAM_F_RAW)) {
+			if (__stream_parse(q->q_data, q->q_len, &entity))
+				goto next;
+		}
+		__client_cb(c, q->q_type, q->q_data, q->q_len, entity);
+		if (entity)
+			json_entity_free(entity);
+	next:
+		free(q);
+		pthread_mutex_lock(&c->c_lock);
+	}
+	/* The client is closed, discard the undelivered messages */
+	while ((q = TAILQ_FIRST(&c->c_q))) {
+		TAILQ_REMOVE(&c->c_q, q, q_ent);
+		free(q);
+	}
+	c->c_q_len = 0;
+	pthread_mutex_unlock(&c->c_lock);
+	__client_put(c);
+	return NULL;
+}
+
+int ldmsd_stream_queue_set(ldmsd_stream_client_t c, size_t depth)
+{
+	int rc = 0;
+
+	if (!depth)
+		return EINVAL;
+	pthread_mutex_lock(&c->c_lock);
+	if (c->c_q_depth) {
+		c->c_q_depth = depth;
+		goto out;
+	}
+	__sync_add_and_fetch(&c->c_ref, 1); /* put by __client_q_proc() */
+	rc = pthread_create(&c->c_q_thread, NULL, __client_q_proc, c);
+	if (rc) {
+		__sync_sub_and_fetch(&c->c_ref, 1);
+		goto out;
+	}
+	pthread_setname_np(c->c_q_thread, "stream_queue");
+	c->c_q_depth = depth;
+ out:
+	pthread_mutex_unlock(&c->c_lock);
+	return rc;
+}
+
 void ldmsd_stream_deliver(const char *stream_name, ldmsd_stream_type_t stream_type,
 			  const char *data, size_t data_len,
 			  json_entity_t entity, const char *p_name)
 {
-	json_parser_t parser = NULL;
+	struct ldmsd_stream_clist_s *cl;
 	ldmsd_stream_client_t c;
 	ldmsd_stream_publisher_t p;
 	ldmsd_stream_t s = __find_stream(stream_name);
 	int need_free = 0;
+	int parse_rc = 0;
+	int i;
 	time_t now;
 
 	now = time(NULL);
@@ -287,42 +524,52 @@ void ldmsd_stream_deliver(const char *stream_name, ldmsd_stream_type_t stream_ty
 	s->s_info.last_ts = now;
 	s->s_info.total_bytes += data_len;
 
-	LIST_FOREACH(c, &s->s_c_list, c_ent) {
+	if (p_name) {
+		p = __find_publisher(s, p_name);
+		if (!p) {
+			p = __new_publisher(p_name);
+			if (p) {
+				p->p_info.first_ts = now;
+				rbt_ins(&s->s_p_tree, &p->p_ent);
+			}
+		}
+		if (p) {
+			p->p_info.last_ts = now;
+			p->p_info.count += 1;
+			p->p_info.total_bytes += data_len;
+		}
+	}
+
+	cl = s->s_clist;
+	if (cl)
+		__sync_add_and_fetch(&cl->ref, 1);
+	pthread_mutex_unlock(&s->s_lock);
+	if (!cl)
+		return;
+
+	for (i = 0; i < cl->count; i++) {
+		c = cl->clients[i];
+		if (c->c_q_depth) {
+			__client_enqueue(c, stream_type, data, data_len);
+			continue;
+		}
 		if (stream_type == LDMSD_STREAM_JSON
-			&& c->c_flags == 0	/* client wants parsed data */
-			&& entity == NULL	/* data hasn't been parsed yet */
-			&& parser == NULL)	/* we haven't tried and failed already */
+			&& !(c->c_flags & LDMSD_STREAM_F_RAW) /* client wants parsed data */
+			&& entity == NULL)	/* data hasn't been parsed yet */
 		{
-			parser = json_parser_new(0);
-			if (!parser)
+			if (parse_rc)	/* we have tried and failed already */
 				continue;
-			int rc = json_parse_buffer(parser, (char *)data, data_len, &entity);
-			if (rc)
+			parse_rc = __stream_parse(data, data_len, &entity);
+			if (parse_rc)
 				continue;
 			need_free = 1;
 		}
-		c->c_cb_fn(c, c->c_ctxt, stream_type, data, data_len, entity);
-	}
-
-	if (p_name) {
-		p = __find_publisher(s, p_name);
-		if (!p) {
-			p = __new_publisher(p_name);
-			if (!p)
-				return;
-			p->p_info.first_ts = now;
-			rbt_ins(&s->s_p_tree, &p->p_ent);
-		}
-		p->p_info.last_ts = now;
-		p->p_info.count += 1;
-		p->p_info.total_bytes += data_len;
+		__client_cb(c, stream_type, data, data_len, entity);
 	}
 
 	if (entity && need_free)
 		json_entity_free(entity);
-	if (parser)
-		json_parser_free(parser);
-	pthread_mutex_unlock(&s->s_lock);
+	__clist_put(cl);
 }
 
 ldmsd_stream_client_t
@@ -331,9 +578,13 @@ ldmsd_stream_subscribe(const char *stream_name,
 {
 	ldmsd_stream_t s;
 	ldmsd_stream_client_t cc, c;
-	c = malloc(sizeof *c);
+	c = calloc(1, sizeof *c);
 	if (!c)
 		goto err_0;
+	c->c_ref = 1;
+	pthread_mutex_init(&c->c_lock, NULL);
+	pthread_cond_init(&c->c_cv, NULL);
+	TAILQ_INIT(&c->c_q);
 
 	/* Find the stream */
 	s = __find_stream(stream_name);
@@ -357,10 +608,16 @@ ldmsd_stream_subscribe(const char *stream_name,
 	c->c_cb_fn = cb_fn;
 	c->c_ctxt = ctxt;
 	LIST_INSERT_HEAD(&s->s_c_list, c, c_ent);
+	if (__clist_update(s)) {
+		LIST_REMOVE(c, c_ent);
+		errno = ENOMEM;
+		pthread_mutex_unlock(&s->s_lock);
+		goto err_1;
+	}
 	pthread_mutex_unlock(&s->s_lock);
 	return c;
  err_1:
-	free(c);
+	__client_put(c);
  err_0:
 	return NULL;
 }
@@ -387,10 +644,40 @@ const char *ldmsd_stream_client_name(ldmsd_stream_client_t c)
 
 void ldmsd_stream_close(ldmsd_stream_client_t c)
 {
+	int self;
+
 	pthread_mutex_lock(&c->c_s->s_lock);
 	LIST_REMOVE(c, c_ent);
+	/*
+	 * If the new snapshot cannot be allocated, the client stays in
+	 * the old one until the next update; c_closed keeps it from
+	 * being called.
+	 */
+	(void)__clist_update(c->c_s);
 	pthread_mutex_unlock(&c->c_s->s_lock);
-	free(c);
+
+	__atomic_store_n(&c->c_closed, 1, __ATOMIC_SEQ_CST);
+
+	pthread_mutex_lock(&c->c_lock);
+	if (c->c_q_depth) {
+		c->c_q_stop = 1;
+		pthread_cond_broadcast(&c->c_cv);
+		pthread_mutex_unlock(&c->c_lock);
+		if (pthread_equal(pthread_self(), c->c_q_thread))
+			pthread_detach(c->c_q_thread);
+		else
+			pthread_join(c->c_q_thread, NULL);
+		pthread_mutex_lock(&c->c_lock);
+	}
+	/*
+	 * Wait for the callbacks in progress on other threads; after
+	 * close returns the callback is not called again.
+	 */
+	self = (__cb_client == c);
+	while (__atomic_load_n(&c->c_busy, __ATOMIC_SEQ_CST) > self)
+		pthread_cond_wait(&c->c_cv, &c->c_lock);
+	pthread_mutex_unlock(&c->c_lock);
+	__client_put(c);
 }
 
 static int stream_send(struct stream_ctxt *ctxt, struct ldmsd_msg_buf *buf,
@@ -817,12 +1104,26 @@ char * ldmsd_stream_client_dump()
 			}
 			rc = buf_printf(&buf, "%s{"
 					"\"cb_fn\":\"%s\","
-					"\"ctxt\":\"%p\""
-					"}",
+					"\"ctxt\":\"%p\"",
 					first_client?"":",",
 					sym?sym[0]:_pbuf,
 					c->c_ctxt);
 			free(sym);
+			if (rc)
+				goto err_3;
+			if (c->c_q_depth) {
+				pthread_mutex_lock(&c->c_lock);
+				rc = buf_printf(&buf, ","
+						"\"queue_depth\":%zu,"
+						"\"queue_len\":%zu,"
+						"\"queue_drops\":%" PRIu64,
+						c->c_q_depth, c->c_q_len,
+						c->c_q_drops);
+				pthread_mutex_unlock(&c->c_lock);
+				if (rc)
+					goto err_3;
+			}
+			rc = buf_printf(&buf, "}");
 			if (rc)
 				goto err_3;
 			first_client = 0;
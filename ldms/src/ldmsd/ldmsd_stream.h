@@ -98,6 +98,11 @@ ldmsd_stream_subscribe(const char *stream_name,
 		       ldmsd_stream_recv_cb_t cb_fn, void *cb_arg);
 /**
  * \brief Close a subscribed stream
+ *
+ * The callback of \c c is not called after this function returns. If
+ * a delivery is calling it on another thread, the function waits for
+ * the callback to return. The client may close itself in its callback.
+ *
  * \param c The client handle
  */
 extern void ldmsd_stream_close(ldmsd_stream_client_t c);
@@ -159,6 +164,26 @@ void ldmsd_stream_flags_set(ldmsd_stream_client_t c, uint32_t flags);
  */
 uint32_t ldmsd_stream_flags_get(ldmsd_stream_client_t c);
 
+/**
+ * \brief Deliver to the client through a queue
+ *
+ * By default the client callback runs on the thread delivering the
+ * stream data, so a slow client delays the publisher and the other
+ * subscribers. With a queue, the data is copied and the callback is
+ * called from a thread owned by the client. If the queue already holds
+ * \c depth messages, new messages are dropped and counted in the
+ * "queue_drops" of ldmsd_stream_client_dump().
+ *
+ * Calling this function again changes the depth of the queue.
+ *
+ * \param c The stream client handle
+ * \param depth The maximum number of queued messages
+ * \retval 0 If succeeded
+ * \retval EINVAL If \c depth is 0
+ * \retval errno If the queue thread could not be created
+ */
+int ldmsd_stream_queue_set(ldmsd_stream_client_t c, size_t depth);
+
 /**
  * \brief Report the number of subscribers
  *
@@ -60,14 +60,18 @@
 #include "ldms.h"
 #include "ldmsd.h"
 #include "ldms_xprt.h"
+#include "ldmsd_event.h"
 #include "config.h"
 
+static void strgp_qent_free(ldmsd_strgp_qent_t ent);
+
 void ldmsd_strgp___del(ldmsd_cfgobj_t obj)
 {
 	ldmsd_strgp_t strgp = (ldmsd_strgp_t)obj;
 
 	if (strgp->schema)
 		free(strgp->schema);
+	ldms_name_re_free(&strgp->schema_regex);
 	if (strgp->container)
 		free(strgp->container);
 	if (strgp->metric_arry)
@@ -86,7 +90,7 @@ void ldmsd_strgp___del(ldmsd_cfgobj_t obj)
 		match = LIST_FIRST(&strgp->prdcr_list);
 		if (match->regex_str)
 			free(match->regex_str);
-		regfree(&match->regex);
+		ldms_name_re_free(&match->regex);
 		LIST_REMOVE(match, entry);
 		free(match);
 	}
@@ -95,6 +99,16 @@ void ldmsd_strgp___del(ldmsd_cfgobj_t obj)
 	if (strgp->decomp_name)
 		free(strgp->decomp_name);
 	free(strgp->digest);
+
+	ldmsd_strgp_qent_t ent;
+	while ((ent = TAILQ_FIRST(&strgp->q.head))) {
+		TAILQ_REMOVE(&strgp->q.head, ent, entry);
+		strgp_qent_free(ent);
+	}
+	if (strgp->q.ev)
+		ev_put(strgp->q.ev);
+	pthread_mutex_destroy(&strgp->q.lock);
+	pthread_cond_destroy(&strgp->q.cv);
 	ldmsd_cfgobj___del(obj);
 }
 
@@ -175,16 +189,16 @@ out:
 	return rc;
 }
 
-static void strgp_decompose(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set)
+static void strgp_decompose(ldmsd_strgp_t strgp, ldms_set_t set)
 {
 	struct ldmsd_row_list_s row_list = TAILQ_HEAD_INITIALIZER(row_list);
 	int row_count, rc;
-	rc = strgp->decomp->decompose(strgp, prd_set->set, &row_list, &row_count);
+	rc = strgp->decomp->decompose(strgp, set, &row_list, &row_count);
 	if (rc) {
 		ldmsd_log(LDMSD_LERROR, "strgp decompose error: %d\n", rc);
 		return;
 	}
-	rc = strgp->store->commit(strgp, prd_set->set, &row_list, row_count);
+	rc = strgp->store->commit(strgp, set, &row_list, row_count);
 	if (rc) {
 		ldmsd_log(LDMSD_LERROR, "strgp row commit error: %d\n", rc);
 	}
@@ -192,10 +206,8 @@ static void strgp_decompose(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set)
 }
 
 /* protected by strgp lock */
-static void strgp_update_fn(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set)
+static void strgp_store(ldmsd_strgp_t strgp, ldms_set_t set)
 {
-	if (strgp->state != LDMSD_STRGP_STATE_RUNNING)
-		return;
 	if (!strgp->decomp_name)
 		goto store_routine;
 
@@ -204,7 +216,7 @@ static void strgp_update_fn(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set)
 		strgp->state = LDMSD_STRGP_STATE_STOPPED;
 		return;
 	}
-	strgp_decompose(strgp, prd_set);
+	strgp_decompose(strgp, set);
 	goto out;
 
 	/* store() interface routine */
@@ -213,7 +225,7 @@ static void strgp_update_fn(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set)
 		strgp->state = LDMSD_STRGP_STATE_STOPPED;
 		return;
 	}
-	strgp->store->store(strgp->store_handle, prd_set->set,
+	strgp->store->store(strgp->store_handle, set,
 			    strgp->metric_arry, strgp->metric_count);
  out:
 	if (strgp->flush_interval.tv_sec || strgp->flush_interval.tv_nsec) {
@@ -228,6 +240,261 @@ static void strgp_update_fn(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set)
 	}
 }
 
+static void strgp_qent_free(ldmsd_strgp_qent_t ent)
+{
+	ldms_set_snapshot_free(ent->snap);
+	free(ent);
+}
+
+static ldmsd_strgp_qent_t strgp_dequeue(ldmsd_strgp_t strgp)
+{
+	ldmsd_strgp_qent_t ent;
+	pthread_mutex_lock(&strgp->q.lock);
+	ent = TAILQ_FIRST(&strgp->q.head);
+	if (ent) {
+		TAILQ_REMOVE(&strgp->q.head, ent, entry);
+		strgp->q.len--;
+		pthread_cond_broadcast(&strgp->q.cv);
+	}
+	pthread_mutex_unlock(&strgp->q.lock);
+	return ent;
+}
+
+/* protected by strgp lock */
+static void strgp_qent_store(ldmsd_strgp_t strgp, ldmsd_strgp_qent_t ent)
+{
+	struct timespec now, lat;
+	uint64_t lat_us;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	ldmsd_timespec_diff(&ent->enq_ts, &now, &lat);
+	lat_us = lat.tv_sec * 1000000 + lat.tv_nsec / 1000;
+
+	pthread_mutex_lock(&strgp->q.lock);
+	if (strgp->state == LDMSD_STRGP_STATE_RUNNING) {
+		strgp->q.stored++;
+		if (!strgp->q.lat_min_us || lat_us < strgp->q.lat_min_us)
+			strgp->q.lat_min_us = lat_us;
+		if (lat_us > strgp->q.lat_max_us)
+			strgp->q.lat_max_us = lat_us;
+		strgp->q.lat_sum_us += lat_us;
+	} else {
+		strgp->q.dropped++;
+	}
+	pthread_mutex_unlock(&strgp->q.lock);
+
+	if (strgp->state == LDMSD_STRGP_STATE_RUNNING)
+		strgp_store(strgp, ent->snap);
+	strgp_qent_free(ent);
+}
+
+/* protected by strgp lock */
+static void strgp_queue_drain(ldmsd_strgp_t strgp)
+{
+	ldmsd_strgp_qent_t ent;
+	while ((ent = strgp_dequeue(strgp)))
+		strgp_qent_store(strgp, ent);
+}
+
+/*
+ * The store worker actor. The event is posted whenever a snapshot is
+ * queued; the actor drains the queue. The strgp lock is taken after
+ * an entry has been dequeued so that an update path blocked on a full
+ * queue (while holding the strgp lock) can proceed.
+ */
+static int strgp_store_actor(ev_worker_t src, ev_worker_t dst,
+			     ev_status_t status, ev_t ev)
+{
+	ldmsd_strgp_t strgp = EV_DATA(ev, struct strgp_store_data)->strgp;
+	ldmsd_strgp_qent_t ent;
+
+	while ((ent = strgp_dequeue(strgp))) {
+		ldmsd_strgp_lock(strgp);
+		strgp_qent_store(strgp, ent);
+		ldmsd_strgp_unlock(strgp);
+	}
+	ldmsd_strgp_put(strgp); /* taken in strgp_enqueue() */
+	return 0;
+}
+
+/* Wake up the store worker */
+static void strgp_post(ldmsd_strgp_t strgp)
+{
+	/* The event holds a strgp reference while it is posted */
+	ldmsd_strgp_get(strgp);
+	if (ev_post(NULL, strgp->q.worker, strgp->q.ev, NULL))
+		ldmsd_strgp_put(strgp); /* already posted */
+}
+
+/*
+ * The storage policies that queued snapshots in this thread since
+ * ldmsd_strgp_batch_begin(). Their store workers are woken up once by
+ * ldmsd_strgp_batch_end().
+ *
+ * A batch that is not ended within STRGP_BATCH_MAX_NS, e.g. because the
+ * callback that should have ended it was never made, is ended by the
+ * next batch that begins in this thread, and the snapshots queued in the
+ * meantime wake their store workers right away.
+ */
+#define STRGP_BATCH_MAX_NS 100000000
+
+static __thread struct strgp_batch {
+	int active;
+	int count;
+	int alloc;
+	struct timespec begin;
+	ldmsd_strgp_t *strgp;
+} strgp_batch;
+
+static int strgp_batch_stale(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - strgp_batch.begin.tv_sec) * 1000000000L +
+	       (now.tv_nsec - strgp_batch.begin.tv_nsec) > STRGP_BATCH_MAX_NS;
+}
+
+static int strgp_batch_add(ldmsd_strgp_t strgp)
+{
+	ldmsd_strgp_t *a;
+	int i;
+
+	for (i = 0; i < strgp_batch.count; i++) {
+		if (strgp_batch.strgp[i] == strgp)
+			return 0;
+	}
+	if (strgp_batch.count == strgp_batch.alloc) {
+		a = realloc(strgp_batch.strgp,
+			    (strgp_batch.alloc + 16) * sizeof(*a));
+		if (!a)
+			return ENOMEM;
+		strgp_batch.strgp = a;
+		strgp_batch.alloc += 16;
+	}
+	strgp_batch.strgp[strgp_batch.count++] = ldmsd_strgp_get(strgp);
+	return 0;
+}
+
+void ldmsd_strgp_batch_begin(void)
+{
+	if (strgp_batch.active) {
+		if (!strgp_batch_stale())
+			return;
+		ldmsd_strgp_batch_end();
+	}
+	strgp_batch.active = 1;
+	clock_gettime(CLOCK_MONOTONIC, &strgp_batch.begin);
+}
+
+void ldmsd_strgp_batch_end(void)
+{
+	int i;
+
+	strgp_batch.active = 0;
+	for (i = 0; i < strgp_batch.count; i++) {
+		strgp_post(strgp_batch.strgp[i]);
+		ldmsd_strgp_put(strgp_batch.strgp[i]);
+	}
+	strgp_batch.count = 0;
+}
+
+/* protected by strgp lock */
+static void strgp_enqueue(ldmsd_strgp_t strgp, ldms_set_t set)
+{
+	ldmsd_strgp_qent_t ent, old = NULL;
+
+	ent = malloc(sizeof(*ent));
+	if (!ent)
+		goto enomem;
+	ent->snap = ldms_set_snapshot(set);
+	if (!ent->snap) {
+		free(ent);
+		goto enomem;
+	}
+
+	pthread_mutex_lock(&strgp->q.lock);
+	if (strgp->q.len >= strgp->q.depth) {
+		switch (strgp->q.policy) {
+		case LDMSD_STRGP_Q_BLOCK:
+			strgp->q.blocked++;
+			/* The worker is not woken up before a batch ends */
+			strgp_post(strgp);
+			while (strgp->q.len >= strgp->q.depth)
+				pthread_cond_wait(&strgp->q.cv, &strgp->q.lock);
+			break;
+		case LDMSD_STRGP_Q_DROP_NEW:
+			strgp->q.dropped++;
+			pthread_mutex_unlock(&strgp->q.lock);
+			strgp_qent_free(ent);
+			return;
+		case LDMSD_STRGP_Q_DROP_OLD:
+			old = TAILQ_FIRST(&strgp->q.head);
+			TAILQ_REMOVE(&strgp->q.head, old, entry);
+			strgp->q.len--;
+			strgp->q.dropped++;
+			break;
+		}
+	}
+	clock_gettime(CLOCK_REALTIME, &ent->enq_ts);
+	TAILQ_INSERT_TAIL(&strgp->q.head, ent, entry);
+	strgp->q.len++;
+	strgp->q.enqueued++;
+	if (strgp->q.len > strgp->q.len_max)
+		strgp->q.len_max = strgp->q.len;
+	pthread_mutex_unlock(&strgp->q.lock);
+	if (old)
+		strgp_qent_free(old);
+
+	if (strgp_batch.active && !strgp_batch_stale() &&
+	    0 == strgp_batch_add(strgp))
+		return;
+	strgp_post(strgp);
+	return;
+
+ enomem:
+	ldmsd_log(LDMSD_LERROR, "strgp '%s': out of memory queueing "
+		  "set '%s'.\n", strgp->obj.name,
+		  ldms_set_instance_name_get(set));
+	pthread_mutex_lock(&strgp->q.lock);
+	strgp->q.dropped++;
+	pthread_mutex_unlock(&strgp->q.lock);
+}
+
+/* protected by strgp lock */
+static int strgp_queue_init(ldmsd_strgp_t strgp)
+{
+	char name[128];
+
+	if (!strgp->q.ev) {
+		strgp->q.ev = ev_new(strgp_store_type);
+		if (!strgp->q.ev)
+			return ENOMEM;
+		EV_DATA(strgp->q.ev, struct strgp_store_data)->strgp = strgp;
+	}
+	if (strgp->q.worker)
+		return 0;
+	/* The worker survives the strgp, reuse it if the strgp is re-added */
+	snprintf(name, sizeof(name), "strgp:%s", strgp->obj.name);
+	strgp->q.worker = ev_worker_get(name);
+	if (!strgp->q.worker)
+		strgp->q.worker = ev_worker_new(name, strgp_store_actor);
+	if (!strgp->q.worker)
+		return errno;
+	return 0;
+}
+
+/* protected by strgp lock */
+static void strgp_update_fn(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set)
+{
+	if (strgp->state != LDMSD_STRGP_STATE_RUNNING)
+		return;
+	if (strgp->q.depth)
+		strgp_enqueue(strgp, prd_set->set);
+	else
+		strgp_store(strgp, prd_set->set);
+}
+
 ldmsd_strgp_t
 ldmsd_strgp_new_with_auth(const char *name, uid_t uid, gid_t gid, int perm)
 {
@@ -246,6 +513,10 @@ ldmsd_strgp_new_with_auth(const char *name, uid_t uid, gid_t gid, int perm)
 	strgp->last_flush.tv_sec = 0;
 	strgp->last_flush.tv_nsec = 0;
 	strgp->update_fn = strgp_update_fn;
+	strgp->q.policy = LDMSD_STRGP_Q_BLOCK;
+	pthread_mutex_init(&strgp->q.lock, NULL);
+	pthread_cond_init(&strgp->q.cv, NULL);
+	TAILQ_INIT(&strgp->q.head);
 	LIST_INIT(&strgp->prdcr_list);
 	TAILQ_INIT(&strgp->metric_list);
 	ldmsd_task_init(&strgp->task);
@@ -350,7 +621,7 @@ int ldmsd_strgp_prdcr_add(const char *strgp_name, const char *regex_str,
 		rc = ENOMEM;
 		goto out_2;
 	}
-	rc = ldmsd_compile_regex(&match->regex, regex_str,
+	rc = ldmsd_compile_name_re(&match->regex, regex_str,
 					rep_buf, rep_len);
 	if (rc)
 		goto out_3;
@@ -390,7 +661,7 @@ int ldmsd_strgp_prdcr_del(const char *strgp_name, const char *regex_str,
 	}
 	LIST_REMOVE(match, entry);
 	free(match->regex_str);
-	regfree(&match->regex);
+	ldms_name_re_free(&match->regex);
 	free(match);
 out_1:
 	ldmsd_strgp_unlock(strgp);
@@ -631,7 +902,7 @@ int ldmsd_strgp_update_prdcr_set(ldmsd_strgp_t strgp, ldmsd_prdcr_set_t prd_set)
 			return ENOENT;
 	} else {
 		/* regex match */
-		if (regexec(&strgp->schema_regex, prd_set->schema_name, 0, NULL, 0))
+		if (ldms_name_re_exec(&strgp->schema_regex, prd_set->schema_name))
 			return ENOENT;
 	}
 
@@ -703,7 +974,7 @@ void ldmsd_strgp_update(ldmsd_prdcr_set_t prd_set)
 		ldmsd_strgp_lock(strgp);
 		ldmsd_name_match_t match = ldmsd_strgp_prdcr_first(strgp);
 		for (rc = 0; match; match = ldmsd_strgp_prdcr_next(match)) {
-			rc = regexec(&match->regex, prd_set->prdcr->obj.name, 0, NULL, 0);
+			rc = ldms_name_re_exec(&match->regex, prd_set->prdcr->obj.name);
 			if (!rc)
 				break;
 		}
@@ -729,6 +1000,11 @@ int __ldmsd_strgp_start(ldmsd_strgp_t strgp, ldmsd_sec_ctxt_t ctxt)
 		rc = EBUSY;
 		goto out;
 	}
+	if (strgp->q.depth) {
+		rc = strgp_queue_init(strgp);
+		if (rc)
+			goto out;
+	}
 	strgp->state = LDMSD_STRGP_STATE_RUNNING;
 	clock_gettime(CLOCK_REALTIME, &strgp->last_flush);
 	strgp->obj.perm |= LDMSD_PERM_DSTART;
@@ -764,6 +1040,7 @@ int __ldmsd_strgp_stop(ldmsd_strgp_t strgp, ldmsd_sec_ctxt_t ctxt)
 		goto out;
 	}
 	ldmsd_task_stop(&strgp->task);
+	strgp_queue_drain(strgp);
 	strgp_close(strgp);
 	strgp->state = LDMSD_STRGP_STATE_STOPPED;
 	strgp->obj.perm &= ~LDMSD_PERM_DSTART;
@@ -839,6 +1116,7 @@ void ldmsd_strgp_close()
 			goto next;
 		}
 		ldmsd_task_stop(&strgp->task);
+		strgp_queue_drain(strgp);
 		strgp_close(strgp);
 		strgp->state = LDMSD_STRGP_STATE_STOPPED;
 		ldmsd_strgp_unlock(strgp);
@@ -68,7 +68,7 @@ void ldmsd_updtr___del(ldmsd_cfgobj_t obj)
 		match = LIST_FIRST(&updtr->match_list);
 		if (match->regex_str)
 			free(match->regex_str);
-		regfree(&match->regex);
+		ldms_name_re_free(&match->regex);
 		LIST_REMOVE(match, entry);
 		free(match);
 	}
@@ -237,6 +237,14 @@ static void updtr_update_cb(ldms_t t, ldms_set_t set, int status, void *arg)
 	ldmsd_prdcr_set_t prd_set = arg;
 	int errcode;
 
+	/*
+	 * The sets of a coalesced push are stored together. Any other
+	 * update ends a batch left open in this thread.
+	 */
+	if (status & LDMS_UPD_F_BATCH)
+		ldmsd_strgp_batch_begin();
+	else
+		ldmsd_strgp_batch_end();
 	pthread_mutex_lock(&prd_set->lock);
 	gettimeofday(&prd_set->updt_end, NULL);
 #ifdef LDMSD_UPDATE_TIME
@@ -271,6 +279,7 @@ static void updtr_update_cb(ldms_t t, ldms_set_t set, int status, void *arg)
 		goto set_ready;
 	}
 	prd_set->last_gn = gn;
+	ldmsd_prdcr_set_updated(prd_set->prdcr);
 
 	ldmsd_strgp_ref_t str_ref;
 	LIST_FOREACH(str_ref, &prd_set->strgp_list, entry) {
@@ -298,6 +307,8 @@ out:
 	if (0 == (status & (LDMS_UPD_F_PUSH|LDMS_UPD_F_MORE)))
 		/* Put reference taken before calling ldms_xprt_update. */
 		ldmsd_prdcr_set_ref_put(prd_set);
+	if (status & LDMS_UPD_F_BATCH_END)
+		ldmsd_strgp_batch_end();
 	return;
 }
 
@@ -330,9 +341,68 @@ __grp_iter_cb(ldms_set_t grp, const char *name, void *arg)
 	return 0;
 }
 
+/* The sets of a producer to be updated with one batch update */
+struct updtr_batch {
+	int count;
+	int alloc;
+	ldms_set_t *sets;
+	void **args;
+};
+
+static int updtr_batch_add(struct updtr_batch *batch, ldmsd_prdcr_set_t prd_set)
+{
+	ldms_set_t *sets;
+	void **args;
+	int alloc;
+
+	if (batch->count == batch->alloc) {
+		alloc = batch->alloc ? batch->alloc * 2 : 64;
+		sets = realloc(batch->sets, alloc * sizeof(*sets));
+		if (!sets)
+			return ENOMEM;
+		batch->sets = sets;
+		args = realloc(batch->args, alloc * sizeof(*args));
+		if (!args)
+			return ENOMEM;
+		batch->args = args;
+		batch->alloc = alloc;
+	}
+	batch->sets[batch->count] = prd_set->set;
+	batch->args[batch->count] = prd_set;
+	batch->count++;
+	return 0;
+}
+
+static void updtr_batch_flush(struct updtr_batch *batch, ldmsd_prdcr_t prdcr,
+			      ldmsd_updtr_t updtr)
+{
+	ldmsd_prdcr_set_t prd_set;
+	int i, rc;
+
+	if (!batch->count)
+		return;
+	rc = ldms_xprt_update_batch(prdcr->xprt, batch->sets, batch->args,
+				    batch->count, updtr_update_cb,
+				    updtr->is_delta ? LDMS_XPRT_UPDATE_F_DELTA : 0);
+	if (rc) {
+		for (i = 0; i < batch->count; i++) {
+			prd_set = batch->args[i];
+#ifdef LDMSD_UPDATE_TIME
+			__updt_time_put(prd_set->updt_time);
+#endif
+			ldmsd_log(LDMSD_LINFO, "Synchronous error %d: "
+				  "Batch updating Set %s\n",
+				  rc, prd_set->inst_name);
+			ldmsd_prdcr_set_ref_put(prd_set);
+		}
+	}
+	batch->count = 0;
+}
+
 void __ldmsd_prdset_lookup_cb(ldms_t xprt, enum ldms_lookup_status status,
 			      int more, ldms_set_t set, void *arg);
-static int schedule_set_updates(ldmsd_prdcr_set_t prd_set, ldmsd_updtr_task_t task)
+static int schedule_set_updates(ldmsd_prdcr_set_t prd_set, ldmsd_updtr_task_t task,
+				struct updtr_batch *batch)
 {
 	int rc = 0;
 	int flags;
@@ -371,7 +441,8 @@ static int schedule_set_updates(ldmsd_prdcr_set_t prd_set, ldmsd_updtr_task_t ta
 				pset = ldmsd_prdcr_set_find(prd_set->prdcr, ent->str);
 				if (!pset)
 					continue; /* It is OK. Try again next iteration */
-				if (pset->state == LDMSD_PRDCR_SET_STATE_START) {
+				if (pset->state == LDMSD_PRDCR_SET_STATE_START &&
+				    ldmsd_prdcr_lookup_admit(pset->prdcr)) {
 					/*
 					 * The lookup callback of the setgroup
 					 * is received before the DIR_ADD
@@ -383,12 +454,14 @@ static int schedule_set_updates(ldmsd_prdcr_set_t prd_set, ldmsd_updtr_task_t ta
 							      pset->inst_name,
 							      LDMS_LOOKUP_BY_INSTANCE,
 							      __ldmsd_prdset_lookup_cb, pset);
-					if (rc)
+					if (rc) {
+						ldmsd_prdcr_lookup_done(pset->prdcr);
 						goto out;
+					}
 				}
 				if (pset->state != LDMSD_PRDCR_SET_STATE_READY)
 					continue; /* It is OK. The set might not be ready */
-				rc = schedule_set_updates(pset, task);
+				rc = schedule_set_updates(pset, task, batch);
 				if (rc)
 					goto out;
 			}
@@ -397,6 +470,9 @@ static int schedule_set_updates(ldmsd_prdcr_set_t prd_set, ldmsd_updtr_task_t ta
 			 * No metrics in the setgroup, so
 			 * do not update the setgroup.
 			 */
+		} else if (batch) {
+			op_s = "Batching";
+			rc = updtr_batch_add(batch, prd_set);
 		} else {
 			rc = ldms_xprt_update(prd_set->set, updtr_update_cb, prd_set);
 		}
@@ -498,6 +574,8 @@ static int __setgrp_members_lookup(ldmsd_prdcr_set_t setgrp)
 						ldmsd_prdcr_set_state_str(pset->state));
 				continue;
 			case LDMSD_PRDCR_SET_STATE_START:
+				if (!ldmsd_prdcr_lookup_admit(setgrp->prdcr))
+					continue;
 				ldmsd_prdcr_set_ref_get(pset);
 				pset->state = LDMSD_PRDCR_SET_STATE_LOOKUP;
 				rc = ldms_xprt_lookup(setgrp->prdcr->xprt,
@@ -509,6 +587,7 @@ static int __setgrp_members_lookup(ldmsd_prdcr_set_t setgrp)
 					ldmsd_log(LDMSD_LINFO,
 						"Synchronous error %d "
 						"from ldms_lookup\n", rc);
+					ldmsd_prdcr_lookup_done(setgrp->prdcr);
 					ldmsd_prdcr_set_ref_put(pset);
 					goto out;
 				}
@@ -532,6 +611,7 @@ void __ldmsd_prdset_lookup_cb(ldms_t xprt, enum ldms_lookup_status status,
 	ldmsd_prdcr_set_t prd_set = arg;
 	int ready = 0;
 	int flags;
+	ldmsd_prdcr_lookup_done(prd_set->prdcr);
 	pthread_mutex_lock(&prd_set->lock);
 	if (status != LDMS_LOOKUP_OK) {
 		assert(NULL == set);
@@ -599,6 +679,7 @@ static void schedule_prdcr_updates(ldmsd_updtr_task_t task,
 				   ldmsd_prdcr_t prdcr, ldmsd_name_match_t match)
 {
 	ldmsd_updtr_t updtr = task->updtr;
+	struct updtr_batch batch = {0};
 	struct timespec ts;
 #ifdef LDMSD_UPDATE_TIME
 	struct timeval start, end;
@@ -623,7 +704,7 @@ static void schedule_prdcr_updates(ldmsd_updtr_task_t task,
 				str = prd_set->inst_name;
 			else
 				str = prd_set->schema_name;
-			rc = regexec(&match->regex, str, 0, NULL, 0);
+			rc = ldms_name_re_exec(&match->regex, str);
 			if (rc)
 				goto next_prd_set;
 		}
@@ -640,6 +721,9 @@ static void schedule_prdcr_updates(ldmsd_updtr_task_t task,
 			}
 			break;
 		case LDMSD_PRDCR_SET_STATE_START:
+			/* Too many lookups in flight, retry on the next schedule */
+			if (!ldmsd_prdcr_lookup_admit(prdcr))
+				goto next_prd_set;
 			ldmsd_prdcr_set_ref_get(prd_set); /* It will be put back in lookup_cb */
 			/* Lookup the set */
 			prd_set->state = LDMSD_PRDCR_SET_STATE_LOOKUP;
@@ -663,6 +747,7 @@ static void schedule_prdcr_updates(ldmsd_updtr_task_t task,
 							"%d from ldms_lookup\n", rc);
 				}
 				prd_set->state = LDMSD_PRDCR_SET_STATE_START;
+				ldmsd_prdcr_lookup_done(prdcr);
 				ldmsd_prdcr_set_ref_put(prd_set);
 			}
 			goto next_prd_set;
@@ -680,7 +765,9 @@ static void schedule_prdcr_updates(ldmsd_updtr_task_t task,
 			goto next_prd_set;
 		}
 
-		schedule_set_updates(prd_set, task);
+		schedule_set_updates(prd_set, task,
+				     (updtr->is_batch && !updtr->push_flags) ?
+				     &batch : NULL);
 
 next_prd_set:
 		if (updtr->is_auto_task)
@@ -688,8 +775,11 @@ next_prd_set:
 		else
 			prd_set = ldmsd_prdcr_set_next(prd_set);
 	}
+	updtr_batch_flush(&batch, prdcr, updtr);
 out:
 	ldmsd_prdcr_unlock(prdcr);
+	free(batch.sets);
+	free(batch.args);
 
 #ifdef LDMSD_UPDATE_TIME
 	gettimeofday(&end, NULL);
@@ -720,7 +810,7 @@ static void cancel_prdcr_updates(ldmsd_updtr_t updtr,
 			str = prd_set->inst_name;
 		else
 			str = prd_set->schema_name;
-		rc = regexec(&match->regex, str, 0, NULL, 0);
+		rc = ldms_name_re_exec(&match->regex, str);
 		if (!rc) {
 			cancel_set_updates(prd_set, updtr);
 		}
@@ -922,7 +1012,7 @@ static int updtr_tasks_create(ldmsd_updtr_t updtr)
 						str = prd_set->inst_name;
 					else
 						str = prd_set->schema_name;
-					rc = regexec(&match->regex, str, 0, NULL, 0);
+					rc = ldms_name_re_exec(&match->regex, str);
 					if (!rc)
 						goto update_tasks;
 				}
@@ -1327,7 +1417,7 @@ int ldmsd_updtr_match_add(const char *updtr_name, const char *regex_str,
 		goto out_3;
 	}
 
-	if (ldmsd_compile_regex(&match->regex, regex_str, rep_buf, rep_len)) {
+	if (ldmsd_compile_name_re(&match->regex, regex_str, rep_buf, rep_len)) {
 		rc = -EINVAL;
 		goto out_3;
 	}
@@ -1378,7 +1468,7 @@ int ldmsd_updtr_match_del(const char *updtr_name, const char *regex_str,
 		goto out_1;
 	}
 	LIST_REMOVE(match, entry);
-	regfree(&match->regex);
+	ldms_name_re_free(&match->regex);
 	free(match->regex_str);
 	free(match);
 out_1:
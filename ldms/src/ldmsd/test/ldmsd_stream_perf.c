@@ -0,0 +1,281 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Throughput benchmark of the local stream delivery path,
+ * ldmsd_stream_deliver(). Publisher threads deliver JSON messages to a
+ * stream with a number of subscribers that want parsed data.
+ *
+ * usage: ldmsd_stream_perf [-n <msgs per publisher>] [-p <publishers>]
+ *                          [-c <subscribers>] [-q <queue depth>]
+ *
+ * The benchmark runs three rounds:
+ *   fan-out  - all subscribers are fast;
+ *   slow     - one subscriber takes 50us per message, called in-line;
+ *   queued   - as "slow", but the slow subscriber has a delivery queue.
+ * During every round another thread subscribes and closes a client in a
+ * loop, the number of subscribe/close pairs it completed is reported.
+ *
+ * A round fails if a callback gets a message other than the one
+ * published, if an in-line subscriber misses a message, or if a client
+ * is called after it was closed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <ovis_json/ovis_json.h>
+#include "ldms.h"
+#include "../ldmsd_stream.h"
+
+static int num_msgs = 100000;
+static int num_pubs = 4;
+static int num_subs = 4;
+static int q_depth = 1024;
+
+static const char *msg =
+	"{\"job_id\":1234,\"rank\":17,\"ProducerName\":\"node0001\","
+	"\"file\":\"/scratch/out.dat\",\"op\":\"write\","
+	"\"seg\":[{\"off\":0,\"len\":4096,\"dur\":0.000123}]}";
+
+static int msg_len;
+static const char *stream = "perf";
+
+struct sub_s {
+	int slow;
+	int closed;
+	uint64_t count;
+	uint64_t bad;
+	uint64_t after_close;
+};
+
+static int recv_cb(ldmsd_stream_client_t c, void *ctxt,
+		   ldmsd_stream_type_t stream_type,
+		   const char *data, size_t data_len,
+		   json_entity_t entity)
+{
+	struct sub_s *sub = ctxt;
+	if (!entity || json_entity_type(entity) != JSON_DICT_VALUE)
+		return EINVAL;
+	if (sub->closed)
+		sub->after_close++;
+	if (data_len != msg_len || memcmp(data, msg, msg_len))
+		__sync_add_and_fetch(&sub->bad, 1);
+	__sync_add_and_fetch(&sub->count, 1);
+	if (sub->slow)
+		usleep(50);
+	return 0;
+}
+
+static void *pub_proc(void *arg)
+{
+	int i;
+	for (i = 0; i < num_msgs; i++)
+		ldmsd_stream_deliver(stream, LDMSD_STREAM_JSON, msg, msg_len,
+				     NULL, "perf_pub");
+	return NULL;
+}
+
+static int churn_stop;
+static uint64_t churn_count;
+static struct sub_s churn_sub;
+
+static void *churn_proc(void *arg)
+{
+	ldmsd_stream_client_t c;
+	while (!churn_stop) {
+		churn_sub.closed = 0;
+		c = ldmsd_stream_subscribe(stream, recv_cb, &churn_sub);
+		if (!c)
+			continue;
+		ldmsd_stream_close(c);
+		churn_sub.closed = 1;
+		churn_count++;
+	}
+	return NULL;
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int run(const char *name, int slow, int queue)
+{
+	ldmsd_stream_client_t *clients;
+	struct sub_s *subs;
+	pthread_t *pubs, churn;
+	double t0, t1;
+	uint64_t delivered = 0;
+	uint64_t total = (uint64_t)num_msgs * num_pubs;
+	int i, rc = 0;
+
+	clients = calloc(num_subs, sizeof(*clients));
+	subs = calloc(num_subs, sizeof(*subs));
+	pubs = calloc(num_pubs, sizeof(*pubs));
+	if (!clients || !subs || !pubs) {
+		rc = ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < num_subs; i++) {
+		subs[i].slow = (slow && i == 0);
+		clients[i] = ldmsd_stream_subscribe(stream, recv_cb, &subs[i]);
+		if (!clients[i]) {
+			rc = errno;
+			goto out;
+		}
+		if (queue && subs[i].slow) {
+			rc = ldmsd_stream_queue_set(clients[i], q_depth);
+			if (rc)
+				goto out;
+		}
+	}
+	churn_stop = 0;
+	churn_count = 0;
+	pthread_create(&churn, NULL, churn_proc, NULL);
+	t0 = now_sec();
+	for (i = 0; i < num_pubs; i++)
+		pthread_create(&pubs[i], NULL, pub_proc, NULL);
+	for (i = 0; i < num_pubs; i++)
+		pthread_join(pubs[i], NULL);
+	t1 = now_sec();
+	churn_stop = 1;
+	pthread_join(churn, NULL);
+	for (i = 0; i < num_subs; i++) {
+		ldmsd_stream_close(clients[i]);
+		clients[i] = NULL;
+		subs[i].closed = 1;
+		delivered += subs[i].count;
+	}
+	printf("%-8s %12.0f msgs/s %12.0f callbacks/s %10" PRIu64
+	       " subscribe/close\n", name,
+	       (double)num_msgs * num_pubs / (t1 - t0),
+	       delivered / (t1 - t0), churn_count);
+	for (i = 0; i < num_subs; i++) {
+		if (subs[i].bad || churn_sub.bad) {
+			printf("ERROR: %s: %" PRIu64 " corrupted messages\n",
+			       name, subs[i].bad + churn_sub.bad);
+			rc = EINVAL;
+			break;
+		}
+		/* a queued client may drop, an in-line one may not */
+		if (queue && subs[i].slow) {
+			if (subs[i].count <= total)
+				continue;
+		} else if (subs[i].count == total) {
+			continue;
+		}
+		printf("ERROR: %s: subscriber %d got %" PRIu64 " of %" PRIu64
+		       " messages\n", name, i, subs[i].count, total);
+		rc = EINVAL;
+	}
+	if (churn_sub.after_close) {
+		printf("ERROR: %" PRIu64 " callbacks after close\n",
+		       churn_sub.after_close);
+		rc = EINVAL;
+	}
+ out:
+	if (clients) {
+		for (i = 0; i < num_subs; i++) {
+			if (clients[i])
+				ldmsd_stream_close(clients[i]);
+		}
+	}
+	free(clients);
+	free(subs);
+	free(pubs);
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	int op, rc;
+
+	while ((op = getopt(argc, argv, "n:p:c:q:")) != -1) {
+		switch (op) {
+		case 'n':
+			num_msgs = atoi(optarg);
+			break;
+		case 'p':
+			num_pubs = atoi(optarg);
+			break;
+		case 'c':
+			num_subs = atoi(optarg);
+			break;
+		case 'q':
+			q_depth = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-n <msgs>] [-p <publishers>] "
+			       "[-c <subscribers>] [-q <queue depth>]\n",
+			       argv[0]);
+			return 1;
+		}
+	}
+	if (num_subs < 1 || num_pubs < 1 || q_depth < 1) {
+		printf("The number of subscribers, publishers, and "
+		       "the queue depth must be positive\n");
+		return 1;
+	}
+	msg_len = strlen(msg);
+	printf("%d publishers x %d messages, %d subscribers\n",
+	       num_pubs, num_msgs, num_subs);
+	rc = run("fan-out", 0, 0);
+	if (rc)
+		goto out;
+	rc = run("slow", 1, 0);
+	if (rc)
+		goto out;
+	rc = run("queued", 1, 1);
+ out:
+	if (rc)
+		printf("error %d\n", rc);
+	return rc ? 1 : 0;
+}
@@ -60,6 +60,9 @@
 #include <dirent.h>
 #include <ctype.h>
 #include <assert.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/syscall.h>
 
 #include <coll/rbt.h>
 
@@ -421,9 +424,9 @@ struct linux_proc_sampler_set {
 	int64_t task_rank;
 	struct rbn rbn;
 	int dead;
-	LIST_ENTRY(linux_proc_sampler_set) del;
+	int dirfd; /* /proc/<pid>, kept open for the life of the set;
+		      -1 reads the files by path, see __pid_dir_open() */
 };
-LIST_HEAD(set_del_list, linux_proc_sampler_set);
 
 
 #if 0
@@ -473,12 +476,41 @@ static void string_to_timeval(struct timeval *t, char *s)
 #endif
 
 typedef struct linux_proc_sampler_inst_s *linux_proc_sampler_inst_t;
-typedef int (*handler_fn_t)(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set);
+typedef struct lps_ctxt_s *lps_ctxt_t;
+typedef int (*handler_fn_t)(linux_proc_sampler_inst_t inst,
+			    struct linux_proc_sampler_set *as, lps_ctxt_t c);
 struct handler_info {
 	handler_fn_t fn;
 	const char *fn_name;
 };
 
+#define N_HANDLERS 17
+
+struct handler_stat {
+	uint64_t calls;
+	uint64_t errors;
+	uint64_t ns;
+	uint64_t max_ns;
+};
+
+#define LPS_BUF_SZ 16384
+#define LPS_THREADS_MAX 64
+
+/*
+ * Per-thread state of a sample pass: the read buffer shared by the
+ * handlers and the handler timings, merged into the instance totals at the
+ * end of the pass.
+ */
+struct lps_ctxt_s {
+	char *buf;
+	size_t buf_sz;
+	struct timespec start; /* start of the set being sampled */
+	struct handler_stat hs[N_HANDLERS];
+	pthread_t thread;
+	uint64_t pass; /* the last pass the worker took part in */
+	linux_proc_sampler_inst_t inst;
+};
+
 struct linux_proc_sampler_inst_s {
 	struct ldmsd_sampler samp;
 
@@ -487,7 +519,6 @@ struct linux_proc_sampler_inst_s {
 	char *instance_prefix;
 	bool exe_suffix;
 	long sc_clk_tck;
-	struct timeval sample_start;
 
 	struct rbt set_rbt;
 	pthread_mutex_t mutex;
@@ -496,9 +527,35 @@ struct linux_proc_sampler_inst_s {
 	ldmsd_stream_client_t stream;
 	char *argv_sep;
 
-	struct handler_info fn[17];
+	struct handler_info fn[N_HANDLERS];
 	int n_fn;
 
+	/* sample pass; the sets are split among n_threads workers and
+	 * the sampling thread */
+	int n_threads;
+	lps_ctxt_t ctxt; /* n_threads + 1, [0] is the sampling thread's */
+	struct linux_proc_sampler_set **work;
+	int n_work;
+	int work_alloc;
+	int work_next;
+	pthread_mutex_t pool_mutex;
+	pthread_cond_t pool_cv;
+	pthread_cond_t done_cv;
+	uint64_t pass;
+	int busy;
+	int pool_stop;
+
+	int pid_dir_warned; /* out of fds for /proc/<pid> was logged */
+
+	/* handler timing, reported every stats_interval seconds */
+	int stats_interval;
+	time_t stats_last;
+	struct handler_stat hs[N_HANDLERS];
+	uint64_t passes;
+	uint64_t pass_sets;
+	uint64_t pass_ns;
+	uint64_t pass_max_ns;
+
 	int task_rank_idx;
 	int start_time_idx;
 	int start_tick_idx;
@@ -522,18 +579,18 @@ static void data_set_key(linux_proc_sampler_inst_t inst, struct linux_proc_sampl
 
 }
 
-static int cmdline_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int n_open_files_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int io_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int oom_score_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int oom_score_adj_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int root_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int stat_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int status_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int syscall_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int timerslack_ns_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int wchan_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
-static int timing_handler(linux_proc_sampler_inst_t, pid_t, ldms_set_t);
+static int cmdline_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int n_open_files_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int io_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int oom_score_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int oom_score_adj_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int root_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int stat_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int status_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int syscall_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int timerslack_ns_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int wchan_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
+static int timing_handler(linux_proc_sampler_inst_t, struct linux_proc_sampler_set *, lps_ctxt_t);
 
 /* mapping metric -> handler */
 struct handler_info handler_info_tbl[] = {
@@ -555,29 +612,95 @@ static inline linux_proc_sampler_metric_info_t find_metric_info_by_name(const ch
 
 /* ============ Handlers ============ */
 
+/* openat() the file `name` of the process directory */
+static int __pid_openat(struct linux_proc_sampler_set *as, const char *name,
+			int flags)
+{
+	char path[PROCPID_SZ];
+
+	if (as->dirfd >= 0)
+		return openat(as->dirfd, name, flags);
+	snprintf(path, sizeof(path), "/proc/%" PRId64 "/%s",
+		 as->key.os_pid, name);
+	return open(path, flags);
+}
+
 /*
- * Read content of the file (given `path`) into string metric at `idx` in `set`,
- * with maximum length `max_len`.
+ * Read the file `name` of the process directory into the context buffer,
+ * growing it if the file does not fit, and '\0'-terminate it.
+ *
+ * Returns the length read or -errno.
+ */
+static int __read_at(struct linux_proc_sampler_set *as, lps_ctxt_t c,
+		     const char *name)
+{
+	int fd, len;
+	ssize_t rc;
+	char *buf;
+
+	fd = __pid_openat(as, name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	len = 0;
+	while (1) {
+		rc = pread(fd, c->buf + len, c->buf_sz - 1 - len, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			rc = -errno;
+			goto out;
+		}
+		if (rc == 0)
+			break;
+		len += rc;
+		if (len < c->buf_sz - 1)
+			continue;
+		/* re-read the whole file into a bigger buffer */
+		buf = realloc(c->buf, c->buf_sz * 2);
+		if (!buf) {
+			rc = -ENOMEM;
+			goto out;
+		}
+		c->buf = buf;
+		c->buf_sz *= 2;
+		len = 0;
+	}
+	c->buf[len] = '\0';
+	rc = len;
+ out:
+	close(fd);
+	return rc;
+}
+
+/*
+ * Read content of the file `name` of the process directory into string
+ * metric at `idx` in `set`, with maximum length `max_len`.
  *
  * **REMARK**: The metric is not '\0'-terminated.
  */
-static int __read_str(ldms_set_t set, int idx, const char *path, int max_len)
+static int __read_str(struct linux_proc_sampler_set *as, int idx,
+		      const char *name, int max_len)
 {
 	int fd, rlen;
-	ldms_mval_t str = ldms_metric_get(set, idx);
-	fd = open(path, O_RDONLY);
+	ldms_mval_t str = ldms_metric_get(as->set, idx);
+	fd = __pid_openat(as, name, O_RDONLY | O_CLOEXEC);
 	if (fd < 0)
-		return errno;
+		return -errno;
 	rlen = read(fd, str->a_char, max_len);
+	if (rlen < 0)
+		rlen = -errno;
 	close(fd);
 	return rlen;
 }
 
 /* like `__read_str()`, but also '\0'-terminate the string */
-static int __read_str0(ldms_set_t set, int idx, const char *path, int max_len)
+static int __read_str0(struct linux_proc_sampler_set *as, int idx,
+		       const char *name, int max_len)
 {
-	ldms_mval_t str = ldms_metric_get(set, idx);
-	int rlen = __read_str(set, idx, path, max_len);
+	ldms_mval_t str = ldms_metric_get(as->set, idx);
+	int rlen = __read_str(as, idx, name, max_len);
+	if (rlen < 0)
+		return rlen;
 	if (rlen == max_len)
 		rlen = max_len - 1;
 	str->a_char[rlen] = '\0';
@@ -668,132 +791,150 @@ static int check_sep(linux_proc_sampler_inst_t inst, const char *sep)
 	return 0;
 }
 
-static int cmdline_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int cmdline_handler(linux_proc_sampler_inst_t inst,
+			   struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
 	/* populate `cmdline` and `cmdline_len` */
 	ldms_mval_t cmdline;
 	int len;
-	char path[CMDLINE_SZ];
-	cmdline = ldms_metric_get(set, inst->metric_idx[APP_CMDLINE]);
+	cmdline = ldms_metric_get(as->set, inst->metric_idx[APP_CMDLINE]);
 	if (cmdline->a_char[0])
 		return 0; /* already set */
-	snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
-	len = __read_str(set, inst->metric_idx[APP_CMDLINE], path, CMDLINE_SZ);
+	len = __read_str(as, inst->metric_idx[APP_CMDLINE], "cmdline", CMDLINE_SZ);
+	if (len < 0)
+		return -len;
 	cmdline->a_char[CMDLINE_SZ - 1] = 0; /* in case len == CMDLINE_SZ */
 	len = quote_argv(inst, len, cmdline->a_char, CMDLINE_SZ, inst->argv_sep);
-	ldms_metric_set_u64(set, inst->metric_idx[APP_CMDLINE_LEN], len);
+	ldms_metric_set_u64(as->set, inst->metric_idx[APP_CMDLINE_LEN], len);
 	return 0;
 }
 
-static int n_open_files_handler(linux_proc_sampler_inst_t inst, pid_t pid,
-				ldms_set_t set)
+struct lps_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+static int n_open_files_handler(linux_proc_sampler_inst_t inst,
+				struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
-	/* populate n_open_files */
-	char path[PROCPID_SZ];
-	DIR *dir;
-	struct dirent *dent;
-	int n;
-	snprintf(path, sizeof(path), "/proc/%d/fd", pid);
-	dir = opendir(path);
-	if (!dir)
+	/* populate n_open_files; count the entries of fd/ with getdents64()
+	 * into the context buffer instead of a DIR stream per sample */
+	struct lps_dirent64 *d;
+	int fd, n, off;
+	long len;
+	fd = __pid_openat(as, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
 		return errno;
 	n = 0;
-	while ((dent = readdir(dir))) {
-		if (strcmp(dent->d_name, ".") == 0)
-			continue; /* skip self */
-		if (strcmp(dent->d_name, "..") == 0)
-			continue; /* skip parent */
-		n += 1;
-	}
-	ldms_metric_set_u64(set, inst->metric_idx[APP_N_OPEN_FILES], n);
-	closedir(dir);
+	while ((len = syscall(SYS_getdents64, fd, c->buf, c->buf_sz)) > 0) {
+		for (off = 0; off < len; off += d->d_reclen) {
+			d = (void *)(c->buf + off);
+			if (strcmp(d->d_name, ".") == 0)
+				continue; /* skip self */
+			if (strcmp(d->d_name, "..") == 0)
+				continue; /* skip parent */
+			n += 1;
+		}
+	}
+	if (len < 0) {
+		n = errno;
+		close(fd);
+		return n;
+	}
+	close(fd);
+	ldms_metric_set_u64(as->set, inst->metric_idx[APP_N_OPEN_FILES], n);
 	return 0;
 }
 
-static int io_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int io_handler(linux_proc_sampler_inst_t inst,
+		      struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
-	/* populate io_* */
-	char path[PROCPID_SZ];
+	/* populate io_*; the file is 7 lines of "<name>: <value>" in order:
+	 * rchar, wchar, syscr, syscw, read_bytes, write_bytes and
+	 * cancelled_write_bytes */
 	uint64_t val[7];
-	int n, rc;
-	snprintf(path, sizeof(path), "/proc/%d/io", pid);
-	FILE *f = fopen(path, "r");
-	if (!f)
-		return errno;
-	n = fscanf(f,   "rchar: %lu\n"
-			"wchar: %lu\n"
-			"syscr: %lu\n"
-			"syscw: %lu\n"
-			"read_bytes: %lu\n"
-			"write_bytes: %lu\n"
-			"cancelled_write_bytes: %lu\n",
-			val+0, val+1, val+2, val+3, val+4, val+5, val+6);
-	if (n != 7) {
-		rc = EINVAL;
-		goto out;
+	char *s, *end;
+	int i, rc;
+	rc = __read_at(as, c, "io");
+	if (rc < 0)
+		return -rc;
+	s = c->buf;
+	for (i = 0; i < 7; i++) {
+		s = strchr(s, ':');
+		if (!s)
+			return EINVAL;
+		s++;
+		val[i] = strtoull(s, &end, 10);
+		if (end == s)
+			return EINVAL;
+		s = end;
 	}
-	__may_set_u64(set, inst->metric_idx[APP_IO_READ_B]	   , val[0]);
-	__may_set_u64(set, inst->metric_idx[APP_IO_WRITE_B]	  , val[1]);
-	__may_set_u64(set, inst->metric_idx[APP_IO_N_READ]	   , val[2]);
-	__may_set_u64(set, inst->metric_idx[APP_IO_N_WRITE]	  , val[3]);
-	__may_set_u64(set, inst->metric_idx[APP_IO_READ_DEV_B]       , val[4]);
-	__may_set_u64(set, inst->metric_idx[APP_IO_WRITE_DEV_B]      , val[5]);
-	__may_set_u64(set, inst->metric_idx[APP_IO_WRITE_CANCELLED_B], val[6]);
-	rc = 0;
- out:
-	fclose(f);
-	return rc;
+	__may_set_u64(as->set, inst->metric_idx[APP_IO_READ_B]	   , val[0]);
+	__may_set_u64(as->set, inst->metric_idx[APP_IO_WRITE_B]	  , val[1]);
+	__may_set_u64(as->set, inst->metric_idx[APP_IO_N_READ]	   , val[2]);
+	__may_set_u64(as->set, inst->metric_idx[APP_IO_N_WRITE]	  , val[3]);
+	__may_set_u64(as->set, inst->metric_idx[APP_IO_READ_DEV_B]       , val[4]);
+	__may_set_u64(as->set, inst->metric_idx[APP_IO_WRITE_DEV_B]      , val[5]);
+	__may_set_u64(as->set, inst->metric_idx[APP_IO_WRITE_CANCELLED_B], val[6]);
+	return 0;
 }
 
-static int oom_score_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int oom_score_handler(linux_proc_sampler_inst_t inst,
+			     struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
 	/* according to `proc_oom_score()` in Linux kernel src tree, oom_score
 	 * is `unsigned long` */
-	char path[PROCPID_SZ];
 	uint64_t x;
-	int n;
-	snprintf(path, sizeof(path), "/proc/%d/oom_score", pid);
-	FILE *f = fopen(path, "r");
-	if (!f)
-		return errno;
-	n = fscanf(f, "%lu", &x);
-	fclose(f);
-	if (n != 1)
+	char *end;
+	int rc;
+	rc = __read_at(as, c, "oom_score");
+	if (rc < 0)
+		return -rc;
+	x = strtoull(c->buf, &end, 10);
+	if (end == c->buf)
 		return EINVAL;
-	ldms_metric_set_u64(set, inst->metric_idx[APP_OOM_SCORE], x);
+	ldms_metric_set_u64(as->set, inst->metric_idx[APP_OOM_SCORE], x);
 	return 0;
 }
 
-static int oom_score_adj_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int oom_score_adj_handler(linux_proc_sampler_inst_t inst,
+				 struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
 	/* according to `proc_oom_score_adj_read()` in Linux kernel src tree,
 	 * oom_score_adj is `short` */
-	char path[PROCPID_SZ];
-	int x;
-	int n;
-	snprintf(path, sizeof(path), "/proc/%d/oom_score_adj", pid);
-	FILE *f = fopen(path, "r");
-	if (!f)
-		return errno;
-	n = fscanf(f, "%d", &x);
-	fclose(f);
-	if (n != 1)
+	long x;
+	char *end;
+	int rc;
+	rc = __read_at(as, c, "oom_score_adj");
+	if (rc < 0)
+		return -rc;
+	x = strtol(c->buf, &end, 10);
+	if (end == c->buf)
 		return EINVAL;
-	ldms_metric_set_s64(set, inst->metric_idx[APP_OOM_SCORE_ADJ], x);
+	ldms_metric_set_s64(as->set, inst->metric_idx[APP_OOM_SCORE_ADJ], x);
 	return 0;
 }
 
-static int root_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int root_handler(linux_proc_sampler_inst_t inst,
+			struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
-	char path[PROCPID_SZ];
 	ssize_t len;
+	char path[PROCPID_SZ];
 	int midx = inst->metric_idx[APP_ROOT];
 	assert(midx > 0);
-	ldms_mval_t mval = ldms_metric_get(set, midx);
-	int alen = ldms_metric_array_get_len(set, midx);
+	ldms_mval_t mval = ldms_metric_get(as->set, midx);
+	int alen = ldms_metric_array_get_len(as->set, midx);
 	/* /proc/<PID>/root is a soft link */
-	snprintf(path, sizeof(path), "/proc/%d/root", pid);
-	len = readlink(path, mval->a_char, alen - 1);
+	if (as->dirfd >= 0) {
+		len = readlinkat(as->dirfd, "root", mval->a_char, alen - 1);
+	} else {
+		snprintf(path, sizeof(path), "/proc/%" PRId64 "/root",
+			 as->key.os_pid);
+		len = readlink(path, mval->a_char, alen - 1);
+	}
 	if (len < 0) {
 		mval->a_char[0] = '\0';
 		return errno;
@@ -802,49 +943,48 @@ static int root_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t se
 	return 0;
 }
 
-static int stat_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int stat_handler(linux_proc_sampler_inst_t inst,
+			struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
-	char buff[CMDLINE_SZ];
-	char *str;
+	char *str, *end, *comm;
 	char name[128]; /* should be enough to hold program name */
-	int off, n;
+	int n;
 	uint64_t val;
 	char state;
 	pid_t _pid;
 	linux_proc_sampler_metric_e code;
-	FILE *f;
-	snprintf(buff, sizeof(buff), "/proc/%d/stat", pid);
-	f = fopen(buff, "r");
-	if (!f)
-		return errno;
-	char *s;
-	errno = 0;
-	s = fgets(buff, sizeof(buff), f);
-	fclose(f);
-	str = buff;
-	if (s != buff) {
-		if (errno) {
-			INST_LOG(inst, LDMSD_LDEBUG,
-				"error reading /proc/%d/stat %s\n", pid, STRERROR(errno));
-			return errno;
-		}
-		return EINVAL;
+	n = __read_at(as, c, "stat");
+	if (n < 0) {
+		INST_LOG(inst, LDMSD_LDEBUG, "error reading /proc/%d/stat %s\n",
+			 (int)as->key.os_pid, STRERROR(-n));
+		return -n;
 	}
-	n = sscanf(str, "%d (%[^)]) %c%n", &_pid, name, &state, &off);
-	if (n != 3)
+	/* <pid> (<comm>) <state> <ppid> ...; comm may contain ')' */
+	_pid = strtol(c->buf, &end, 10);
+	if (end == c->buf || end[0] != ' ' || end[1] != '(')
 		return EINVAL;
-	str += off;
-	if (_pid != pid)
+	comm = end + 2;
+	str = strrchr(comm, ')');
+	if (!str || str[1] != ' ' || !str[2])
+		return EINVAL;
+	n = str - comm;
+	if (n >= sizeof(name))
+		n = sizeof(name) - 1;
+	memcpy(name, comm, n);
+	name[n] = '\0';
+	state = str[2];
+	str += 3;
+	if (_pid != as->key.os_pid)
 		return EINVAL; /* should not happen */
-	__may_set_u64(set, inst->metric_idx[APP_STAT_PID], _pid);
-	__may_set_str(set, inst->metric_idx[APP_STAT_COMM], name);
-	__may_set_char(set, inst->metric_idx[APP_STAT_STATE], state);
+	__may_set_u64(as->set, inst->metric_idx[APP_STAT_PID], _pid);
+	__may_set_str(as->set, inst->metric_idx[APP_STAT_COMM], name);
+	__may_set_char(as->set, inst->metric_idx[APP_STAT_STATE], state);
 	for (code = APP_STAT_PPID; code <= _APP_STAT_LAST; code++) {
-		n = sscanf(str, "%lu%n", &val, &off);
-		if (n != 1)
+		val = strtoull(str, &end, 10);
+		if (end == str)
 			return EINVAL;
-		str += off;
-		__may_set_u64(set, inst->metric_idx[code], val);
+		str = end;
+		__may_set_u64(as->set, inst->metric_idx[code], val);
 	}
 	return 0;
 }
@@ -966,32 +1106,38 @@ struct status_line_handler_s status_line_tbl[] = {
 	{ "nonvoluntary_ctxt_switches", APP_STATUS_NONVOLUNTARY_CTXT_SWITCHES, __line_dec},
 };
 
-static int status_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int status_handler(linux_proc_sampler_inst_t inst,
+			  struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
-	char buff[CMDLINE_SZ];
-	FILE *f;
-	char *line, *key, *ptr;
+	char *line, *key, *ptr, *next;
 	status_line_handler_t sh;
+	int rc;
 
-	snprintf(buff, sizeof(buff), "/proc/%d/status", pid);
-	f = fopen(buff, "r");
-	if (!f)
-		return errno;
-	while ((line = fgets(buff, sizeof(buff), f))) {
-		key = strtok_r(line, ":", &ptr);
+	rc = __read_at(as, c, "status");
+	if (rc < 0)
+		return -rc;
+	for (line = c->buf; *line; line = next) {
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0'; /* eliminate trailing newline */
+		else
+			next = line + strlen(line);
+		ptr = strchr(line, ':');
+		if (!ptr)
+			continue;
+		*ptr++ = '\0';
+		key = line;
 		sh = find_status_line_handler(key);
 		if (!sh)
 			continue;
 		while (isspace(*ptr)) {
 			ptr++;
 		}
-		ptr[strlen(ptr)-1] = '\0'; /* eliminate trailing space */
 		if (inst->metric_idx[sh->code] > 0
 				|| sh->code == APP_STATUS_SIG_QUEUED) {
-			sh->fn(inst, set, ptr, sh->code);
+			sh->fn(inst, as->set, ptr, sh->code);
 		}
 	}
-	fclose(f);
 	return 0;
 }
 
@@ -1114,14 +1260,12 @@ int __line_bitmap(linux_proc_sampler_inst_t inst, ldms_set_t set, const char *li
 	return 0;
 }
 
-static int syscall_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int syscall_handler(linux_proc_sampler_inst_t inst,
+			   struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
-	char buff[CMDLINE_SZ];
-	FILE *f;
-	char *ret;
-	int i, n;
+	char *s, *end;
+	int i, n, rc;
 	uint64_t val[9] = {0};
-	snprintf(buff, sizeof(buff), "/proc/%d/syscall", pid);
 	/*
 	 * NOTE: The file contains single line wcich could be:
 	 * - "running": the process is running.
@@ -1130,76 +1274,73 @@ static int syscall_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t
 	 * - "<SYSCALL_NUM> <ARG0> ... <ARG5> <STACK_PTR> <PROGRAM_CTR>": the
 	 *   syscall number, 6 arguments, stack pointer and program counter.
 	 */
-	f = fopen(buff, "r");
-	if (!f)
-		return errno;
-	ret = fgets(buff, sizeof(buff), f);
-	fclose(f);
-	if (!ret)
-		return errno;
-	if (0 == strncmp(buff, "running", 7)) {
-		n = 0;
-	} else {
-		n = sscanf(buff, "%ld %lx %lx %lx %lx %lx %lx %lx %lx",
-				 val+0, val+1, val+2, val+3, val+4,
-				 val+5, val+6, val+7, val+8);
+	rc = __read_at(as, c, "syscall");
+	if (rc < 0)
+		return -rc;
+	n = 0;
+	if (0 != strncmp(c->buf, "running", 7)) {
+		s = c->buf;
+		for (n = 0; n < 9; n++) {
+			/* the syscall number is decimal, the rest are hex */
+			val[n] = strtoull(s, &end, n ? 16 : 10);
+			if (end == s)
+				break;
+			s = end;
+		}
 	}
 	for (i = 0; i < n; i++) {
-		ldms_metric_array_set_u64(set, inst->metric_idx[APP_SYSCALL],
+		ldms_metric_array_set_u64(as->set, inst->metric_idx[APP_SYSCALL],
 					  i, val[i]);
 	}
 	for (i = n; i < 9; i++) {
 		/* zero */
-		ldms_metric_array_set_u64(set, inst->metric_idx[APP_SYSCALL],
+		ldms_metric_array_set_u64(as->set, inst->metric_idx[APP_SYSCALL],
 					  i, 0);
 	}
 	return 0;
 }
 
-static int timerslack_ns_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int timerslack_ns_handler(linux_proc_sampler_inst_t inst,
+				 struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
-	char path[PROCPID_SZ];
 	uint64_t x;
-	int n;
-	snprintf(path, sizeof(path), "/proc/%d/timerslack_ns", pid);
-	FILE *f = fopen(path, "r");
-	if (!f && errno != ENOENT)
-		return errno;
-	if (!f) {
-		ldms_metric_set_u64(set, inst->metric_idx[APP_TIMERSLACK_NS], 0);
+	char *end;
+	int rc;
+	rc = __read_at(as, c, "timerslack_ns");
+	if (rc == -ENOENT) {
+		ldms_metric_set_u64(as->set, inst->metric_idx[APP_TIMERSLACK_NS], 0);
 		return 0;
 	}
-	n = fscanf(f, "%lu", &x);
-	fclose(f);
-	if (n != 1)
+	if (rc < 0)
+		return -rc;
+	x = strtoull(c->buf, &end, 10);
+	if (end == c->buf)
 		return EINVAL;
-	ldms_metric_set_u64(set, inst->metric_idx[APP_TIMERSLACK_NS], x);
+	ldms_metric_set_u64(as->set, inst->metric_idx[APP_TIMERSLACK_NS], x);
 	return 0;
 }
 
-static int wchan_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int wchan_handler(linux_proc_sampler_inst_t inst,
+			 struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
-	char path[PROCPID_SZ];
-	snprintf(path, sizeof(path), "/proc/%d/wchan", pid);
-	__read_str0(set, inst->metric_idx[APP_WCHAN], path, WCHAN_SZ);
+	__read_str0(as, inst->metric_idx[APP_WCHAN], "wchan", WCHAN_SZ);
 	return 0;
 }
 
+static inline uint64_t __ts_diff_ns(struct timespec *t0, struct timespec *t1)
+{
+	return (t1->tv_sec - t0->tv_sec) * 1000000000 +
+		t1->tv_nsec - t0->tv_nsec;
+}
 
-static int timing_handler(linux_proc_sampler_inst_t inst, pid_t pid, ldms_set_t set)
+static int timing_handler(linux_proc_sampler_inst_t inst,
+			  struct linux_proc_sampler_set *as, lps_ctxt_t c)
 {
-	struct timeval t2;
-	gettimeofday(&t2, NULL);
-	uint64_t x_us = (t2.tv_sec - inst->sample_start.tv_sec)*1000000;
-	int64_t d_us = (int64_t)t2.tv_usec - (int64_t)inst->sample_start.tv_usec;
-	if (d_us < 0)
-		x_us += (uint64_t)(1000000 + d_us);
-	else
-		x_us += (uint64_t) d_us;
+	struct timespec t2;
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+	uint64_t x_us = __ts_diff_ns(&c->start, &t2) / 1000;
 
-	ldms_metric_set_u64(set, inst->metric_idx[APP_TIMING], x_us);
-	inst->sample_start.tv_sec = 0;
-	inst->sample_start.tv_usec = 0;
+	ldms_metric_set_u64(as->set, inst->metric_idx[APP_TIMING], x_us);
 #ifdef LPDEBUG
 	INST_LOG(inst, LDMSD_LDEBUG, "In %" PRIu64 " microseconds\n", x_us);
 #endif
@@ -1281,53 +1422,307 @@ void app_set_destroy(linux_proc_sampler_inst_t inst, struct linux_proc_sampler_s
 	ldmsd_set_deregister(ldms_set_instance_name_get(a->set), SAMP);
 	ldms_set_unpublish(a->set);
 	ldms_set_delete(a->set);
+	if (a->dirfd >= 0)
+		close(a->dirfd);
+	a->dirfd = -1;
 	a->key.start_tick = 0;
 	a->key.os_pid = 0;
 	a->set = NULL;
 	free(a);
 }
 
+static int __open_pid_dir(pid_t pid)
+{
+	char path[PROCPID_SZ];
+	snprintf(path, sizeof(path), "/proc/%d", pid);
+	return open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+/*
+ * Open /proc/<pid> of `app_set`. Returns ENOENT or ESRCH if the process
+ * is gone. Any other error, such as EMFILE when ldmsd tracks more
+ * processes than RLIMIT_NOFILE allows, leaves dirfd at -1; the handlers
+ * then read /proc/<pid>/<file> by path and the open is retried at the
+ * next sample.
+ */
+static int __pid_dir_open(linux_proc_sampler_inst_t inst,
+			  struct linux_proc_sampler_set *app_set)
+{
+	int rc;
+
+	app_set->dirfd = __open_pid_dir(app_set->key.os_pid);
+	if (app_set->dirfd >= 0) {
+		/* warn again if the descriptors run out again */
+		if (inst->pid_dir_warned)
+			inst->pid_dir_warned = 0;
+		return 0;
+	}
+	rc = errno;
+	if (rc == ENOENT || rc == ESRCH)
+		return rc;
+	if (!__atomic_exchange_n(&inst->pid_dir_warned, 1, __ATOMIC_RELAXED))
+		INST_LOG(inst, LDMSD_LWARNING, "Error %d(%s) opening /proc/%"
+			 PRId64 ", reading the files of this and other "
+			 "processes by path\n", rc, STRERROR(rc),
+			 app_set->key.os_pid);
+	return 0;
+}
+
+static void __sample_set(linux_proc_sampler_inst_t inst,
+			 struct linux_proc_sampler_set *app_set, lps_ctxt_t c)
+{
+	struct timespec t0, t1;
+	struct handler_stat *hs;
+	uint64_t ns;
+	int i, rc = 0;
+
+	if (app_set->dirfd < 0) {
+		rc = __pid_dir_open(inst, app_set);
+		if (rc) {
+			app_set->dead = rc;
+			INST_LOG(inst, LDMSD_LDEBUG, "Removing set %s. Error %d(%s) "
+				"opening /proc/%" PRId64 "\n",
+				ldms_set_instance_name_get(app_set->set),
+				rc, STRERROR(rc), app_set->key.os_pid);
+			return;
+		}
+	}
+	ldms_transaction_begin(app_set->set);
+	clock_gettime(CLOCK_MONOTONIC, &c->start);
+	t0 = c->start;
+	for (i = 0; i < inst->n_fn; i++) {
+		rc = inst->fn[i].fn(inst, app_set, c);
+		if (inst->stats_interval) {
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			ns = __ts_diff_ns(&t0, &t1);
+			hs = &c->hs[i];
+			hs->calls++;
+			hs->ns += ns;
+			if (ns > hs->max_ns)
+				hs->max_ns = ns;
+			if (rc)
+				hs->errors++;
+			t0 = t1;
+		}
+		if (rc) {
+			INST_LOG(inst, LDMSD_LDEBUG, "Removing set %s. Error %d(%s) from %s\n",
+				ldms_set_instance_name_get(app_set->set),
+				rc, STRERROR(rc), inst->fn[i].fn_name);
+			app_set->dead = rc;
+			break;
+		}
+	}
+#ifdef LPDEBUG
+	INST_LOG(inst, LDMSD_LDEBUG, "Got data for %s\n",
+		ldms_set_instance_name_get(app_set->set));
+#endif
+	ldms_transaction_end(app_set->set);
+}
+
+/* Sample the sets of the pass until there are none left to claim. */
+static void __sample_work(linux_proc_sampler_inst_t inst, lps_ctxt_t c)
+{
+	int i;
+	while ((i = __sync_fetch_and_add(&inst->work_next, 1)) < inst->n_work)
+		__sample_set(inst, inst->work[i], c);
+}
+
+static void *__worker_proc(void *arg)
+{
+	lps_ctxt_t c = arg;
+	linux_proc_sampler_inst_t inst = c->inst;
+
+	pthread_mutex_lock(&inst->pool_mutex);
+	while (1) {
+		while (!inst->pool_stop && inst->pass == c->pass)
+			pthread_cond_wait(&inst->pool_cv, &inst->pool_mutex);
+		if (inst->pool_stop)
+			break;
+		c->pass = inst->pass;
+		pthread_mutex_unlock(&inst->pool_mutex);
+		__sample_work(inst, c);
+		pthread_mutex_lock(&inst->pool_mutex);
+		if (--inst->busy == 0)
+			pthread_cond_signal(&inst->done_cv);
+	}
+	pthread_mutex_unlock(&inst->pool_mutex);
+	return NULL;
+}
+
+static void __pool_stop(linux_proc_sampler_inst_t inst)
+{
+	int i;
+
+	if (!inst->ctxt)
+		return;
+	pthread_mutex_lock(&inst->pool_mutex);
+	inst->pool_stop = 1;
+	pthread_cond_broadcast(&inst->pool_cv);
+	pthread_mutex_unlock(&inst->pool_mutex);
+	for (i = 1; i <= inst->n_threads; i++) {
+		if (inst->ctxt[i].thread)
+			pthread_join(inst->ctxt[i].thread, NULL);
+	}
+	for (i = 0; i <= inst->n_threads; i++)
+		free(inst->ctxt[i].buf);
+	free(inst->ctxt);
+	inst->ctxt = NULL;
+	free(inst->work);
+	inst->work = NULL;
+	inst->work_alloc = 0;
+	inst->n_work = 0;
+	inst->pool_stop = 0;
+}
+
+static int __pool_start(linux_proc_sampler_inst_t inst)
+{
+	int i, rc;
+
+	inst->ctxt = calloc(inst->n_threads + 1, sizeof(*inst->ctxt));
+	if (!inst->ctxt)
+		return ENOMEM;
+	for (i = 0; i <= inst->n_threads; i++) {
+		inst->ctxt[i].inst = inst;
+		inst->ctxt[i].pass = inst->pass;
+		inst->ctxt[i].buf_sz = LPS_BUF_SZ;
+		inst->ctxt[i].buf = malloc(LPS_BUF_SZ);
+		if (!inst->ctxt[i].buf) {
+			rc = ENOMEM;
+			goto err;
+		}
+	}
+	for (i = 1; i <= inst->n_threads; i++) {
+		rc = pthread_create(&inst->ctxt[i].thread, NULL,
+				    __worker_proc, &inst->ctxt[i]);
+		if (rc) {
+			inst->ctxt[i].thread = 0;
+			goto err;
+		}
+		pthread_setname_np(inst->ctxt[i].thread, "linux_proc");
+	}
+	return 0;
+ err:
+	__pool_stop(inst);
+	return rc;
+}
+
+static void __stats_report(linux_proc_sampler_inst_t inst)
+{
+	struct handler_stat *hs;
+	struct timespec now;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (!inst->stats_last)
+		inst->stats_last = now.tv_sec;
+	if (now.tv_sec - inst->stats_last < inst->stats_interval)
+		return;
+	inst->stats_last = now.tv_sec;
+	if (!inst->passes)
+		return;
+	INST_LOG(inst, LDMSD_LINFO, "%" PRIu64 " samples, %.1f sets/sample, "
+		 "%.1f us/sample (max %.1f us), %d threads\n",
+		 inst->passes, (double)inst->pass_sets / inst->passes,
+		 inst->pass_ns / 1e3 / inst->passes, inst->pass_max_ns / 1e3,
+		 inst->n_threads);
+	for (i = 0; i < inst->n_fn; i++) {
+		hs = &inst->hs[i];
+		if (!hs->calls)
+			continue;
+		INST_LOG(inst, LDMSD_LINFO, "%s: %" PRIu64 " calls, "
+			 "%.2f us/call (max %.2f us), %" PRIu64 " errors\n",
+			 inst->fn[i].fn_name, hs->calls,
+			 hs->ns / 1e3 / hs->calls, hs->max_ns / 1e3,
+			 hs->errors);
+	}
+	memset(inst->hs, 0, sizeof(inst->hs));
+	inst->passes = 0;
+	inst->pass_sets = 0;
+	inst->pass_ns = 0;
+	inst->pass_max_ns = 0;
+}
+
+/* Fold the handler timings of the pass into the instance totals */
+static void __stats_merge(linux_proc_sampler_inst_t inst, uint64_t ns)
+{
+	struct handler_stat *hs;
+	int i, j;
+
+	for (j = 0; j <= inst->n_threads; j++) {
+		for (i = 0; i < inst->n_fn; i++) {
+			hs = &inst->ctxt[j].hs[i];
+			inst->hs[i].calls += hs->calls;
+			inst->hs[i].errors += hs->errors;
+			inst->hs[i].ns += hs->ns;
+			if (hs->max_ns > inst->hs[i].max_ns)
+				inst->hs[i].max_ns = hs->max_ns;
+		}
+		memset(inst->ctxt[j].hs, 0, sizeof(inst->ctxt[j].hs));
+	}
+	inst->passes++;
+	inst->pass_sets += inst->n_work;
+	inst->pass_ns += ns;
+	if (ns > inst->pass_max_ns)
+		inst->pass_max_ns = ns;
+	__stats_report(inst);
+}
+
 static int linux_proc_sampler_sample(struct ldmsd_sampler *pi)
 {
 	linux_proc_sampler_inst_t inst = (void*)pi;
-	int i, rc;
+	struct timespec t0, t1;
 	struct rbn *rbn;
+	void *work;
+	int i;
 #ifdef LPDEBUG
 	INST_LOG(inst, LDMSD_LDEBUG, "Sampling\n");
 #endif
 	struct linux_proc_sampler_set *app_set;
-	struct set_del_list del_list;
-	LIST_INIT(&del_list);
 	pthread_mutex_lock(&inst->mutex);
+	if (!inst->ctxt) {
+		pthread_mutex_unlock(&inst->mutex);
+		return EINVAL;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	inst->n_work = 0;
 	RBT_FOREACH(rbn, &inst->set_rbt) {
-		app_set = container_of(rbn, struct linux_proc_sampler_set, rbn);
-		ldms_transaction_begin(app_set->set);
-		gettimeofday(&inst->sample_start, NULL);
-		for (i = 0; i < inst->n_fn; i++) {
-			rc = inst->fn[i].fn(inst, app_set->key.os_pid, app_set->set);
-			if (rc) {
-				INST_LOG(inst, LDMSD_LDEBUG, "Removing set %s. Error %d(%s) from %s\n",
-					ldms_set_instance_name_get(app_set->set),
-					rc, STRERROR(rc), inst->fn[i].fn_name);
-				LIST_INSERT_HEAD(&del_list, app_set, del);
-				app_set->dead = rc;
-				break;
-			}
+		if (inst->n_work == inst->work_alloc) {
+			i = inst->work_alloc ? 2 * inst->work_alloc : 64;
+			work = realloc(inst->work, i * sizeof(*inst->work));
+			if (!work)
+				break; /* sample what we have */
+			inst->work = work;
+			inst->work_alloc = i;
 		}
-#ifdef LPDEBUG
-		INST_LOG(inst, LDMSD_LDEBUG, "Got data for %s\n",
-			ldms_set_instance_name_get(app_set->set));
-#endif
-		ldms_transaction_end(app_set->set);
-	}
-	while (!LIST_EMPTY(&del_list)) {
-                app_set = LIST_FIRST(&del_list);
-		rbn = rbt_find(&inst->set_rbt, &app_set->key);
-		if (rbn)
-			rbt_del(&inst->set_rbt, rbn);
-                LIST_REMOVE(app_set, del);
-                app_set_destroy(inst, app_set);
-        }
+		app_set = container_of(rbn, struct linux_proc_sampler_set, rbn);
+		inst->work[inst->n_work++] = app_set;
+	}
+	inst->work_next = 0;
+	if (inst->n_threads && inst->n_work > 1) {
+		pthread_mutex_lock(&inst->pool_mutex);
+		inst->busy = inst->n_threads;
+		inst->pass++;
+		pthread_cond_broadcast(&inst->pool_cv);
+		pthread_mutex_unlock(&inst->pool_mutex);
+		__sample_work(inst, &inst->ctxt[0]);
+		pthread_mutex_lock(&inst->pool_mutex);
+		while (inst->busy)
+			pthread_cond_wait(&inst->done_cv, &inst->pool_mutex);
+		pthread_mutex_unlock(&inst->pool_mutex);
+	} else {
+		__sample_work(inst, &inst->ctxt[0]);
+	}
+	for (i = 0; i < inst->n_work; i++) {
+		app_set = inst->work[i];
+		if (!app_set->dead)
+			continue;
+		rbt_del(&inst->set_rbt, &app_set->rbn);
+		app_set_destroy(inst, app_set);
+	}
+	if (inst->stats_interval) {
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		__stats_merge(inst, __ts_diff_ns(&t0, &t1));
+	}
 	pthread_mutex_unlock(&inst->mutex);
 	return 0;
 }
@@ -1340,6 +1735,7 @@ char *_help = "\
 linux_proc_sampler config synopsis: \n\
     config name=linux_proc_sampler [COMMON_OPTIONS] [stream=STREAM]\n\
 	    [sc_clk_tck=1] [metrics=METRICS] [cfg_file=FILE] [exe_suffix=1]]\n\
+	    [threads=N] [stats_interval=SEC]\n\
 \n\
 Option descriptions:\n\
     instance_prefix    The prefix for generated instance names. Typically a cluster name\n\
@@ -1355,6 +1751,10 @@ Option descriptions:\n\
 	      metrics.\n\
     argv_sep  The separator character to replace nul with in the cmdline string.\n\
               Special specifiers \n,\t,\b etc are also supported.\n\
+    threads   The number of additional threads that sample processes in\n\
+              parallel with the sampling thread (default: 0).\n\
+    stats_interval  Log the time spent in each /proc file handler every SEC\n\
+              seconds at INFO level (default: 0, disabled).\n\
     cfg_file  The alternative config file in JSON format. The file is\n\
 	      expected to have an object that contains the following \n\
 	      attributes:\n\
@@ -1884,6 +2284,10 @@ int __handle_task_init(linux_proc_sampler_inst_t inst, json_entity_t data)
 	if (inst->sc_clk_tck)
 		ldms_metric_set_s64(set, inst->sc_clk_tck_idx, inst->sc_clk_tck);
 	app_set->set = set;
+	/* Hold on to the process directory; the handlers open its files
+	 * relative to it and it will not follow a recycled pid. If the
+	 * process is already gone, the first sample removes the set. */
+	(void)__pid_dir_open(inst, app_set);
 	rbn_init(&app_set->rbn, (void*)&app_set->key);
 
 	pthread_mutex_lock(&inst->mutex);
@@ -1900,6 +2304,8 @@ int __handle_task_init(linux_proc_sampler_inst_t inst, json_entity_t data)
 					ldms_set_instance_name_get(app_set->set));
 #endif
 				ldms_set_delete(app_set->set);
+				if (app_set->dirfd >= 0)
+					close(app_set->dirfd);
 				free(app_set);
 			} else {
 				/* remove/replace set pointer in app_set with newly named set instance */
@@ -1913,6 +2319,9 @@ int __handle_task_init(linux_proc_sampler_inst_t inst, json_entity_t data)
 				ldms_set_delete(old_app_set->set);
 				old_app_set->set = set;
 				old_app_set->task_rank = task_rank_val;
+				if (app_set->dirfd >= 0)
+					close(app_set->dirfd);
+				free(app_set);
 				ldms_set_publish(set);
 				ldmsd_set_register(set, SAMP);
 			}
@@ -1925,6 +2334,8 @@ int __handle_task_init(linux_proc_sampler_inst_t inst, json_entity_t data)
 				ldms_set_instance_name_get(app_set->set));
 #endif
 			ldms_set_delete(app_set->set);
+			if (app_set->dirfd >= 0)
+				close(app_set->dirfd);
 			free(app_set);
 		}
 		pthread_mutex_unlock(&inst->mutex);
@@ -2130,6 +2541,28 @@ linux_proc_sampler_config(struct ldmsd_plugin *pi, struct attr_value_list *kwl,
 		}
 	}
 
+	/* these apply with or without cfg_file */
+	val = av_value(avl, "threads");
+	if (val) {
+		inst->n_threads = atoi(val);
+		if (inst->n_threads < 0 || inst->n_threads > LPS_THREADS_MAX) {
+			INST_LOG(inst, LDMSD_LERROR, "Config threads=%s must be "
+				 "0 to %d.\n", val, LPS_THREADS_MAX);
+			rc = EINVAL;
+			goto err;
+		}
+	}
+	val = av_value(avl, "stats_interval");
+	if (val) {
+		inst->stats_interval = atoi(val);
+		if (inst->stats_interval < 0) {
+			INST_LOG(inst, LDMSD_LERROR, "Config stats_interval=%s "
+				 "must not be negative.\n", val);
+			rc = EINVAL;
+			goto err;
+		}
+	}
+
 	/* default stream */
 	if (!inst->stream_name) {
 		inst->stream_name = strdup("slurm");
@@ -2161,6 +2594,13 @@ linux_proc_sampler_config(struct ldmsd_plugin *pi, struct attr_value_list *kwl,
 	if (rc)
 		goto err;
 
+	rc = __pool_start(inst);
+	if (rc) {
+		INST_LOG(inst, LDMSD_LERROR, "Error %d starting %d sampling "
+			 "threads\n", rc, inst->n_threads);
+		goto err;
+	}
+
 	/* subscribe to the stream */
 	inst->stream = ldmsd_stream_subscribe(inst->stream_name, __stream_cb, inst);
 	if (!inst->stream) {
@@ -2188,7 +2628,9 @@ void linux_proc_sampler_term(struct ldmsd_plugin *pi)
 
 	if (inst->stream)
 		ldmsd_stream_close(inst->stream);
+	inst->stream = NULL;
 	pthread_mutex_lock(&inst->mutex);
+	__pool_stop(inst);
 	while ((rbn = rbt_min(&inst->set_rbt))) {
 		rbt_del(&inst->set_rbt, rbn);
 		app_set = container_of(rbn, struct linux_proc_sampler_set, rbn);
@@ -2203,8 +2645,17 @@ void linux_proc_sampler_term(struct ldmsd_plugin *pi)
 	inst->argv_sep = NULL;
 	if (inst->base_data)
 		base_del(inst->base_data);
+	inst->base_data = NULL;
 	bzero(inst->fn, sizeof(inst->fn));
 	inst->n_fn = 0;
+	inst->n_threads = 0;
+	inst->stats_interval = 0;
+	inst->stats_last = 0;
+	bzero(inst->hs, sizeof(inst->hs));
+	inst->passes = 0;
+	inst->pass_sets = 0;
+	inst->pass_ns = 0;
+	inst->pass_max_ns = 0;
 	bzero(inst->metric_idx, sizeof(inst->metric_idx));
 }
 
@@ -2265,7 +2716,10 @@ struct linux_proc_sampler_inst_s __inst = {
 		},
 		.sample = linux_proc_sampler_sample,
 	},
-	.log = ldmsd_log
+	.log = ldmsd_log,
+	.pool_mutex = PTHREAD_MUTEX_INITIALIZER,
+	.pool_cv = PTHREAD_COND_INITIALIZER,
+	.done_cv = PTHREAD_COND_INITIALIZER,
 };
 
 struct ldmsd_plugin *get_plugin(ldmsd_msg_log_f pf)
@@ -64,28 +64,29 @@
 #include "ldms.h"
 #include "ldmsd.h"
 #include "sampler_base.h"
+#include "procfs_parser.h"
 
 #define PROC_FILE "/proc/meminfo"
 
 static char *procfile = PROC_FILE;
 static ldms_set_t set = NULL;
-static FILE *mf = 0;
+static procfs_parser_t mf;
 static ldmsd_msg_log_f msglog;
 #define SAMP "meminfo"
 static int metric_offset;
+static int num_metrics;
 static base_data_t base;
 
 #define LBUFSZ 256
 static int create_metric_set(base_data_t base)
 {
 	ldms_schema_t schema;
-	int rc, i;
+	int rc, i, n;
 	uint64_t metric_value;
-	char *s;
-	char lbuf[LBUFSZ];
+	struct procfs_line *l;
 	char metric_name[LBUFSZ];
 
-	mf = fopen(procfile, "r");
+	mf = procfs_parser_new(procfile);
 	if (!mf) {
 		msglog(LDMSD_LERROR, "Could not open the " SAMP " file "
 				"'%s'...exiting sampler\n", procfile);
@@ -105,30 +106,33 @@ static int create_metric_set(base_data_t base)
 	metric_offset = ldms_schema_metric_count_get(schema);
 
 	/*
-	 * Process the file to define all the metrics.
+	 * Process the file to define all the metrics. The parser remembers
+	 * the line of each key so that sample() does not have to search.
 	 */
-	fseek(mf, 0, SEEK_SET);
-	do {
-		s = fgets(lbuf, sizeof(lbuf), mf);
-		if (!s)
+	rc = procfs_parser_read(mf);
+	if (rc)
+		goto err;
+	n = procfs_parser_line_count(mf);
+	for (i = 0; i < n; i++) {
+		l = procfs_parser_line(mf, i);
+		if (!l->key_len || l->key_len >= LBUFSZ)
 			break;
-
-		rc = sscanf(lbuf, "%s %" PRIu64,
-			    metric_name, &metric_value);
-		if (rc < 2)
+		if (1 != procfs_parse_u64s(l->val, &metric_value, 1, NULL))
 			break;
-
-		/* Strip the colon from metric name if present */
-		i = strlen(metric_name);
-		if (i && metric_name[i-1] == ':')
-			metric_name[i-1] = '\0';
-
+		snprintf(metric_name, sizeof(metric_name), "%.*s",
+			 l->key_len, l->key);
 		rc = ldms_schema_metric_add(schema, metric_name, LDMS_V_U64);
 		if (rc < 0) {
 			rc = ENOMEM;
 			goto err;
 		}
-	} while (s);
+		rc = procfs_parser_key_add(mf, metric_name);
+		if (rc < 0) {
+			rc = -rc;
+			goto err;
+		}
+	}
+	num_metrics = i;
 
 	set = base_set_new(base);
 	if (!set) {
@@ -139,8 +143,7 @@ static int create_metric_set(base_data_t base)
 	return 0;
 
  err:
-	if (mf)
-		fclose(mf);
+	procfs_parser_free(mf);
 	mf = NULL;
 	return rc;
 }
@@ -211,10 +214,8 @@ static ldms_set_t get_set(struct ldmsd_sampler *self)
 static int sample(struct ldmsd_sampler *self)
 {
 	int rc;
-	int metric_no;
-	char *s;
-	char lbuf[256];
-	char metric_name[LBUFSZ];
+	int i;
+	struct procfs_line *l;
 	union ldms_value v;
 
 	if (!set) {
@@ -222,31 +223,26 @@ static int sample(struct ldmsd_sampler *self)
 		return EINVAL;
 	}
 
+	rc = procfs_parser_read(mf);
+	if (rc) {
+		msglog(LDMSD_LERROR, SAMP ": error %d reading '%s'\n",
+		       rc, procfile);
+		return 0;
+	}
 	base_sample_begin(base);
-	metric_no = metric_offset;
-	fseek(mf, 0, SEEK_SET);
-	do {
-		s = fgets(lbuf, sizeof(lbuf), mf);
-		if (!s)
-			break;
-		rc = sscanf(lbuf, "%s %"PRIu64, metric_name, &v.v_u64);
-		if (rc != 2 && rc != 3) {
-			rc = EINVAL;
-			goto out;
-		}
-
-		ldms_metric_set(set, metric_no, &v);
-		metric_no++;
-	} while (s);
- out:
+	for (i = 0; i < num_metrics; i++) {
+		l = procfs_parser_key_line(mf, i);
+		if (!l || 1 != procfs_parse_u64s(l->val, &v.v_u64, 1, NULL))
+			continue;
+		ldms_metric_set(set, metric_offset + i, &v);
+	}
 	base_sample_end(base);
 	return 0;
 }
 
 static void term(struct ldmsd_plugin *self)
 {
-	if (mf)
-		fclose(mf);
+	procfs_parser_free(mf);
 	mf = NULL;
 	if (base)
 		base_del(base);
@@ -0,0 +1,283 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "procfs_parser.h"
+
+#define PROCFS_BUF_INIT_SZ 4096
+#define PROCFS_LINES_INIT 64
+
+struct procfs_key {
+	char *key;
+	int key_len;
+	int hint;	/* line the key was last seen on */
+};
+
+struct procfs_parser_s {
+	int fd;
+	char *buf;
+	size_t buf_sz;
+	struct procfs_line *lines;
+	int line_count;
+	int line_alloc;
+	struct procfs_key *keys;
+	int key_count;
+	int key_alloc;
+	uint64_t relearn;
+};
+
+procfs_parser_t procfs_parser_new(const char *path)
+{
+	procfs_parser_t p = calloc(1, sizeof(*p));
+	if (!p)
+		return NULL;
+	p->buf = malloc(PROCFS_BUF_INIT_SZ);
+	p->lines = malloc(PROCFS_LINES_INIT * sizeof(*p->lines));
+	if (!p->buf || !p->lines) {
+		errno = ENOMEM;
+		goto err;
+	}
+	p->buf_sz = PROCFS_BUF_INIT_SZ;
+	p->line_alloc = PROCFS_LINES_INIT;
+	p->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (p->fd < 0)
+		goto err;
+	return p;
+ err:
+	free(p->buf);
+	free(p->lines);
+	free(p);
+	return NULL;
+}
+
+void procfs_parser_free(procfs_parser_t p)
+{
+	int i;
+
+	if (!p)
+		return;
+	close(p->fd);
+	for (i = 0; i < p->key_count; i++)
+		free(p->keys[i].key);
+	free(p->keys);
+	free(p->lines);
+	free(p->buf);
+	free(p);
+}
+
+static int __line_add(procfs_parser_t p, char *s)
+{
+	struct procfs_line *l;
+	char *k;
+
+	if (p->line_count == p->line_alloc) {
+		l = realloc(p->lines, 2 * p->line_alloc * sizeof(*l));
+		if (!l)
+			return ENOMEM;
+		p->lines = l;
+		p->line_alloc *= 2;
+	}
+	l = &p->lines[p->line_count++];
+	l->line = s;
+	while (*s == ' ' || *s == '\t')
+		s++;
+	for (k = s; *s && *s != ' ' && *s != '\t' && *s != ':'; s++)
+		;
+	l->key = k;
+	l->key_len = s - k;
+	if (*s == ':')
+		s++;
+	l->val = s;
+	return 0;
+}
+
+int procfs_parser_read(procfs_parser_t p)
+{
+	size_t len = 0;
+	ssize_t rc;
+	char *s, *e, *nl;
+
+	/*
+	 * Keep one byte for the terminating '\0'. A file that does not fit
+	 * is read again from the start into a bigger buffer so that the
+	 * content comes from one pass of the kernel seq_file.
+	 */
+	while (1) {
+		rc = pread(p->fd, p->buf + len, p->buf_sz - len - 1, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (rc == 0)
+			break;
+		len += rc;
+		if (len + 1 < p->buf_sz)
+			continue;
+		s = realloc(p->buf, 2 * p->buf_sz);
+		if (!s)
+			return ENOMEM;
+		p->buf = s;
+		p->buf_sz *= 2;
+		len = 0;
+	}
+	p->buf[len] = '\0';
+
+	p->line_count = 0;
+	e = p->buf + len;
+	for (s = p->buf; s < e; s = nl + 1) {
+		nl = memchr(s, '\n', e - s);
+		if (!nl)
+			nl = e;
+		*nl = '\0';
+		if (__line_add(p, s))
+			return ENOMEM;
+	}
+	return 0;
+}
+
+int procfs_parser_line_count(procfs_parser_t p)
+{
+	return p->line_count;
+}
+
+struct procfs_line *procfs_parser_line(procfs_parser_t p, int i)
+{
+	if (i < 0 || i >= p->line_count)
+		return NULL;
+	return &p->lines[i];
+}
+
+static inline int __key_match(struct procfs_line *l, struct procfs_key *k)
+{
+	return l->key_len == k->key_len && 0 == memcmp(l->key, k->key, k->key_len);
+}
+
+static int __key_find(procfs_parser_t p, struct procfs_key *k)
+{
+	int i;
+	for (i = 0; i < p->line_count; i++) {
+		if (__key_match(&p->lines[i], k))
+			return i;
+	}
+	return -1;
+}
+
+int procfs_parser_key_add(procfs_parser_t p, const char *key)
+{
+	struct procfs_key *k;
+
+	if (p->key_count == p->key_alloc) {
+		int n = p->key_alloc ? 2 * p->key_alloc : PROCFS_LINES_INIT;
+		k = realloc(p->keys, n * sizeof(*k));
+		if (!k)
+			return -ENOMEM;
+		p->keys = k;
+		p->key_alloc = n;
+	}
+	k = &p->keys[p->key_count];
+	k->key = strdup(key);
+	if (!k->key)
+		return -ENOMEM;
+	k->key_len = strlen(key);
+	k->hint = __key_find(p, k);
+	return p->key_count++;
+}
+
+struct procfs_line *procfs_parser_key_line(procfs_parser_t p, int slot)
+{
+	struct procfs_key *k = &p->keys[slot];
+
+	if (k->hint >= 0 && k->hint < p->line_count &&
+	    __key_match(&p->lines[k->hint], k))
+		return &p->lines[k->hint];
+	p->relearn++;
+	k->hint = __key_find(p, k);
+	if (k->hint < 0)
+		return NULL;
+	return &p->lines[k->hint];
+}
+
+uint64_t procfs_parser_relearn_count(procfs_parser_t p)
+{
+	return p->relearn;
+}
+
+int procfs_parse_u64s(const char *s, uint64_t *v, int n, char **endp)
+{
+	const char *end = s;
+	uint64_t x;
+	int i, d, neg, ovf;
+
+	for (i = 0; i < n; i++) {
+		while (*s == ' ' || *s == '\t')
+			s++;
+		neg = (*s == '-');
+		if (neg)
+			s++;
+		if (*s < '0' || *s > '9')
+			break;
+		x = 0;
+		ovf = 0;
+		do {
+			d = *s - '0';
+			if (x > (UINT64_MAX - d) / 10)
+				ovf = 1;
+			x = x * 10 + d;
+			s++;
+		} while (*s >= '0' && *s <= '9');
+		if (ovf)
+			v[i] = UINT64_MAX; /* like strtoull() */
+		else
+			v[i] = neg ? -x : x;
+		end = s;
+	}
+	if (endp)
+		*endp = (char *)end;
+	return i;
+}
@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Single-read parser for line oriented procfs files.
+ *
+ * The whole file is read with pread() into a buffer that is kept across
+ * samples and split into lines in place. Each line is presented as a key,
+ * the first token of the line without a trailing ':', and the rest of the
+ * line. Samplers register the keys they want at config time and get a
+ * slot number back; the slot remembers the line the key was found on, so
+ * a lookup during sampling is a single key comparison as long as the file
+ * layout does not change. When it does, the key is searched for and the
+ * line hint updated.
+ */
+#ifndef __PROCFS_PARSER_H__
+#define __PROCFS_PARSER_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+struct procfs_line {
+	char *line;	/* the line, '\0' terminated */
+	char *key;	/* first token; not terminated */
+	int key_len;
+	char *val;	/* the rest of the line after the key */
+};
+
+typedef struct procfs_parser_s *procfs_parser_t;
+
+/**
+ * \brief Open a procfs file for parsing.
+ *
+ * \param path	The path of the file.
+ *
+ * \retval parser The parser handle.
+ * \retval NULL   If the file cannot be opened or there is not enough
+ *                memory; \c errno is set.
+ */
+procfs_parser_t procfs_parser_new(const char *path);
+
+/**
+ * \brief Close the file and free the parser.
+ */
+void procfs_parser_free(procfs_parser_t p);
+
+/**
+ * \brief Read the whole file and split it into lines.
+ *
+ * The lines returned by previous calls are invalid after this call.
+ *
+ * \retval 0     Success.
+ * \retval errno The error returned by pread().
+ */
+int procfs_parser_read(procfs_parser_t p);
+
+/**
+ * \brief The number of lines of the last read.
+ */
+int procfs_parser_line_count(procfs_parser_t p);
+
+/**
+ * \brief Get line \c i of the last read, or NULL if there is no such line.
+ */
+struct procfs_line *procfs_parser_line(procfs_parser_t p, int i);
+
+/**
+ * \brief Register a key.
+ *
+ * If the key is present in the last read its line is used as the hint
+ * for the first lookup.
+ *
+ * \retval slot    The slot number to pass to procfs_parser_key_line().
+ *                 Slots are numbered from 0 in the order they were added.
+ * \retval -ENOMEM If there is not enough memory.
+ */
+int procfs_parser_key_add(procfs_parser_t p, const char *key);
+
+/**
+ * \brief Get the line of the last read with the key of \c slot.
+ *
+ * \retval line The line.
+ * \retval NULL If the key is not in the file.
+ */
+struct procfs_line *procfs_parser_key_line(procfs_parser_t p, int slot);
+
+/**
+ * \brief The number of key lookups that missed the line hint.
+ *
+ * A non-zero value means the file layout changed since the keys were
+ * added.
+ */
+uint64_t procfs_parser_relearn_count(procfs_parser_t p);
+
+/**
+ * \brief Parse unsigned decimal numbers separated by blanks.
+ *
+ * Parsing stops at the first token that is not a number, the end of the
+ * string or after \c n numbers. A number that does not fit is UINT64_MAX
+ * and a leading '-' negates the value modulo 2^64, like strtoull() does.
+ *
+ * \param s    The string to parse.
+ * \param v    Receives the numbers.
+ * \param n    The capacity of \c v.
+ * \param endp If not NULL, receives the position after the last number.
+ *
+ * \returns The count of numbers parsed.
+ */
+int procfs_parse_u64s(const char *s, uint64_t *v, int n, char **endp);
+
+#endif
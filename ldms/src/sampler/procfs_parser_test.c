@@ -0,0 +1,507 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * procfs_parser checks and the per-sample CPU cost of parsing procfs files.
+ *
+ * The parser is first checked against the files in <dir>
+ * (procfs_parser_test.d under $srcdir by default), whose values are known:
+ * keyed lookups, a relearn after the layout of a file changes, buffer
+ * growth for a file larger than the initial buffer, a last line without
+ * a newline and the edge cases of procfs_parse_u64s().
+ *
+ * Then, every <interval> microseconds (100000, i.e. 10 Hz, by default) each
+ * live file is parsed the way the meminfo, vmstat, procstat and procnetdev2
+ * samplers used to, fseek() + fgets() + sscanf() on a stdio stream, and with
+ * the procfs_parser helper of libsampler_base. The thread CPU time of each is
+ * reported per sample and as the fraction of a core used at that rate.
+ * Both must find the same number of values.
+ *
+ * usage: procfs_parser_test [-d <dir>] [-n <samples>] [-i <interval>]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include "procfs_parser.h"
+
+static int num_samples = 100;
+static int interval = 100000;
+static char fixture_dir[4096];
+static int errors;
+
+#define CHECK(cond, fmt, ...) do { \
+	if (!(cond)) { \
+		printf("ERROR: %s:%d: " fmt "\n", __func__, __LINE__, \
+		       ##__VA_ARGS__); \
+		errors++; \
+	} \
+} while (0)
+
+struct pfile {
+	const char *path;
+	int skip;	/* header lines */
+	int nval;	/* values per line to parse; 1 or the row width */
+	FILE *f;
+	procfs_parser_t p;
+	int nkeys;
+	double old_cpu;
+	double new_cpu;
+	int old_count;
+	int new_count;
+};
+
+static struct pfile files[] = {
+	{ "/proc/meminfo",  0, 1 },
+	{ "/proc/vmstat",   0, 1 },
+	{ "/proc/stat",     0, 10 },
+	{ "/proc/net/dev",  2, 16 },
+};
+
+#define NUM_FILES (sizeof(files) / sizeof(files[0]))
+
+static double cpu_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* The fgets()/sscanf() loop of the samplers; returns the values parsed */
+static int old_parse(struct pfile *pf)
+{
+	static char lbuf[65536];
+	char name[256];
+	uint64_t v[16];
+	char *s;
+	int i, rc, count = 0;
+
+	fseek(pf->f, 0, SEEK_SET);
+	for (i = 0; i < pf->skip; i++)
+		s = fgets(lbuf, sizeof(lbuf), pf->f);
+	while ((s = fgets(lbuf, sizeof(lbuf), pf->f))) {
+		if (pf->nval == 1) {
+			rc = sscanf(lbuf, "%s %" PRIu64, name, &v[0]);
+			if (rc == 2)
+				count++;
+			continue;
+		}
+		s = strchr(lbuf, ':');
+		if (s)
+			*s = ' ';
+		rc = sscanf(lbuf, "%s %" PRIu64 " %" PRIu64 " %" PRIu64
+			    " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+			    " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+			    " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+			    " %" PRIu64, name, &v[0], &v[1], &v[2], &v[3],
+			    &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], &v[10],
+			    &v[11], &v[12], &v[13], &v[14], &v[15]);
+		if (rc > 1)
+			count += (rc - 1 < pf->nval) ? rc - 1 : pf->nval;
+	}
+	return count;
+}
+
+static int new_parse(struct pfile *pf)
+{
+	struct procfs_line *l;
+	uint64_t v[16];
+	int i, n, count = 0;
+
+	if (procfs_parser_read(pf->p))
+		return -1;
+	if (pf->nval == 1) {
+		/* keyed lookup, as meminfo and vmstat do */
+		for (i = 0; i < pf->nkeys; i++) {
+			l = procfs_parser_key_line(pf->p, i);
+			if (l && procfs_parse_u64s(l->val, v, 1, NULL) == 1)
+				count++;
+		}
+		return count;
+	}
+	n = procfs_parser_line_count(pf->p);
+	for (i = pf->skip; i < n; i++) {
+		l = procfs_parser_line(pf->p, i);
+		count += procfs_parse_u64s(l->val, v, pf->nval, NULL);
+	}
+	return count;
+}
+
+static int open_file(struct pfile *pf)
+{
+	struct procfs_line *l;
+	char key[256];
+	int i, n;
+
+	pf->f = fopen(pf->path, "r");
+	pf->p = procfs_parser_new(pf->path);
+	if (!pf->f || !pf->p)
+		return -1;
+	if (pf->nval != 1)
+		return 0;
+	if (procfs_parser_read(pf->p))
+		return -1;
+	n = procfs_parser_line_count(pf->p);
+	for (i = 0; i < n; i++) {
+		l = procfs_parser_line(pf->p, i);
+		snprintf(key, sizeof(key), "%.*s", l->key_len, l->key);
+		if (procfs_parser_key_add(pf->p, key) < 0)
+			return -1;
+	}
+	pf->nkeys = n;
+	return 0;
+}
+
+static procfs_parser_t fixture_open(const char *name)
+{
+	char path[4200];
+	procfs_parser_t p;
+
+	snprintf(path, sizeof(path), "%s/%s", fixture_dir, name);
+	p = procfs_parser_new(path);
+	CHECK(p, "cannot open %s, errno %d", path, errno);
+	if (p && procfs_parser_read(p)) {
+		CHECK(0, "cannot read %s", path);
+		procfs_parser_free(p);
+		p = NULL;
+	}
+	return p;
+}
+
+/* The first value of the line of key, or -1 */
+static int64_t key_value(procfs_parser_t p, int slot)
+{
+	struct procfs_line *l = procfs_parser_key_line(p, slot);
+	uint64_t v;
+
+	if (!l || procfs_parse_u64s(l->val, &v, 1, NULL) != 1)
+		return -1;
+	return v;
+}
+
+/* Replace the content of the file at path, keeping its inode */
+static int file_rewrite(const char *path, const char *name)
+{
+	char src[4200], buf[4096];
+	ssize_t n;
+	int in, out, rc = -1;
+
+	snprintf(src, sizeof(src), "%s/%s", fixture_dir, name);
+	in = open(src, O_RDONLY);
+	out = open(path, O_WRONLY | O_TRUNC);
+	if (in < 0 || out < 0)
+		goto out;
+	while ((n = read(in, buf, sizeof(buf))) > 0) {
+		if (write(out, buf, n) != n)
+			goto out;
+	}
+	rc = n;
+ out:
+	if (in >= 0)
+		close(in);
+	if (out >= 0)
+		close(out);
+	return rc;
+}
+
+static void check_keys(void)
+{
+	static const char *keys[] = { "MemTotal", "MemFree", "MemAvailable",
+		"Cached", "SwapCached", "HugePages_Total", "Hugepagesize",
+		"NoSuchKey" };
+	static const int64_t before[] = { 16318480, 612344, 9874512, 9327496,
+		0, 0, 2048, -1 };
+	static const int64_t after[] = { 16318480, 598112, 9860004, 9327512,
+		-1, 4, 2048, -1 };
+	char path[] = "/tmp/procfs_parser_test.XXXXXX";
+	procfs_parser_t p;
+	struct procfs_line *l;
+	int i, fd, slot;
+
+	/* The file is rewritten in place to change its layout */
+	fd = mkstemp(path);
+	CHECK(fd >= 0, "mkstemp errno %d", errno);
+	if (fd < 0)
+		return;
+	close(fd);
+	p = NULL;
+	if (file_rewrite(path, "meminfo")) {
+		CHECK(0, "cannot copy the meminfo fixture to %s", path);
+		goto out;
+	}
+	p = procfs_parser_new(path);
+	CHECK(p && !procfs_parser_read(p), "cannot parse %s", path);
+	if (!p)
+		goto out;
+	CHECK(procfs_parser_line_count(p) == 8, "%d lines",
+	      procfs_parser_line_count(p));
+	l = procfs_parser_line(p, 2);
+	CHECK(l && l->key_len == 12 && !memcmp(l->key, "MemAvailable", 12),
+	      "line 2 key");
+	CHECK(!procfs_parser_line(p, 8) && !procfs_parser_line(p, -1),
+	      "lines out of range");
+	for (i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+		slot = procfs_parser_key_add(p, keys[i]);
+		CHECK(slot == i, "key %s slot %d", keys[i], slot);
+	}
+	for (i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+		CHECK(key_value(p, i) == before[i], "%s %" PRId64
+		      ", expected %" PRId64, keys[i], key_value(p, i),
+		      before[i]);
+	/* Only the missing key is searched for */
+	CHECK(procfs_parser_relearn_count(p) == 1, "%" PRIu64 " relearns",
+	      procfs_parser_relearn_count(p));
+
+	if (file_rewrite(path, "meminfo.moved")) {
+		CHECK(0, "cannot rewrite %s", path);
+		goto out;
+	}
+	CHECK(!procfs_parser_read(p), "cannot read %s again", path);
+	CHECK(procfs_parser_line_count(p) == 7, "%d lines after the change",
+	      procfs_parser_line_count(p));
+	for (i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+		CHECK(key_value(p, i) == after[i], "moved %s %" PRId64
+		      ", expected %" PRId64, keys[i], key_value(p, i),
+		      after[i]);
+	CHECK(procfs_parser_relearn_count(p) > 1, "no relearn after the "
+	      "layout change");
+ out:
+	procfs_parser_free(p);
+	unlink(path);
+}
+
+static void check_rows(void)
+{
+	static const uint64_t eth0[16] = { 123456789012ULL, 98765432, 1, 2,
+		3, 4, 5, 6, 987654321, 7654321, 7, 8, 9, 10, 11, 12 };
+	procfs_parser_t p;
+	struct procfs_line *l;
+	uint64_t v[17];
+	int i, n;
+
+	p = fixture_open("net_dev");
+	if (!p)
+		return;
+	CHECK(procfs_parser_line_count(p) == 4, "net_dev: %d lines",
+	      procfs_parser_line_count(p));
+	l = procfs_parser_line(p, 3);
+	CHECK(l && l->key_len == 4 && !memcmp(l->key, "eth0", 4),
+	      "net_dev: the eth0 key");
+	n = l ? procfs_parse_u64s(l->val, v, 17, NULL) : 0;
+	CHECK(n == 16, "net_dev: %d eth0 values", n);
+	for (i = 0; i < n && i < 16; i++)
+		CHECK(v[i] == eth0[i], "net_dev: eth0 value %d is %" PRIu64,
+		      i, v[i]);
+	procfs_parser_free(p);
+
+	/* The last line has no newline */
+	p = fixture_open("stat");
+	if (!p)
+		return;
+	n = procfs_parser_line_count(p);
+	CHECK(n == 6, "stat: %d lines", n);
+	l = procfs_parser_line(p, 0);
+	CHECK(l && l->key_len == 3 &&
+	      procfs_parse_u64s(l->val, v, 10, NULL) == 10 &&
+	      v[0] == 1000 && v[3] == 400000 && v[9] == 0, "stat: cpu line");
+	l = procfs_parser_line(p, 5);
+	CHECK(l && l->key_len == 9 && !memcmp(l->key, "processes", 9) &&
+	      procfs_parse_u64s(l->val, v, 1, NULL) == 1 && v[0] == 4242,
+	      "stat: the last line");
+	procfs_parser_free(p);
+}
+
+/* A file several times the initial 4096 byte buffer */
+static void check_growth(void)
+{
+	procfs_parser_t p;
+	struct procfs_line *l;
+	char key[32];
+	int i, slot;
+
+	p = fixture_open("vmstat");
+	if (!p)
+		return;
+	CHECK(procfs_parser_line_count(p) == 600, "vmstat: %d lines",
+	      procfs_parser_line_count(p));
+	for (i = 0; i < 600; i += 97) {
+		snprintf(key, sizeof(key), "nr_counter_%03d", i);
+		slot = procfs_parser_key_add(p, key);
+		CHECK(key_value(p, slot) == (int64_t)i * 1000003,
+		      "vmstat: %s", key);
+	}
+	/* A second read reuses the grown buffer */
+	CHECK(!procfs_parser_read(p), "vmstat: second read");
+	l = procfs_parser_line(p, 599);
+	CHECK(l && !strcmp(l->line, "nr_counter_599 599001797"),
+	      "vmstat: the last line after a second read");
+	CHECK(procfs_parser_relearn_count(p) == 0, "vmstat: relearns");
+	procfs_parser_free(p);
+}
+
+static void check_u64s(void)
+{
+	uint64_t v[4] = { 7, 7, 7, 7 };
+	char *end;
+	int n;
+
+	n = procfs_parse_u64s("", v, 4, &end);
+	CHECK(n == 0 && *end == '\0' && v[0] == 7, "empty string");
+	n = procfs_parse_u64s("   \t ", v, 4, &end);
+	CHECK(n == 0 && !strcmp(end, "   \t "), "blank string, %d values",
+	      n);
+	n = procfs_parse_u64s(" 1  2\t3 ", v, 4, &end);
+	CHECK(n == 3 && v[0] == 1 && v[1] == 2 && v[2] == 3 && *end == ' ',
+	      "blanks, %d values", n);
+	n = procfs_parse_u64s("1 2 3 4 5", v, 2, &end);
+	CHECK(n == 2 && v[1] == 2 && !strcmp(end, " 3 4 5"), "capacity");
+	n = procfs_parse_u64s("10 kB", v, 4, &end);
+	CHECK(n == 1 && v[0] == 10 && !strcmp(end, " kB"), "unit");
+	n = procfs_parse_u64s("5 - 6", v, 4, &end);
+	CHECK(n == 1 && !strcmp(end, " - 6"), "lone minus, %d values", n);
+	n = procfs_parse_u64s("-1", v, 4, NULL);
+	CHECK(n == 1 && v[0] == UINT64_MAX, "-1 is %" PRIu64, v[0]);
+	n = procfs_parse_u64s("18446744073709551615 18446744073709551616 "
+			      "99999999999999999999999", v, 4, NULL);
+	CHECK(n == 3 && v[0] == UINT64_MAX && v[1] == UINT64_MAX &&
+	      v[2] == UINT64_MAX, "overflow, %d values", n);
+	n = procfs_parse_u64s("1844674407370955161 184467440737095516", v, 4,
+			      NULL);
+	CHECK(n == 2 && v[0] == 1844674407370955161ULL &&
+	      v[1] == 184467440737095516ULL, "near the limit");
+}
+
+int main(int argc, char **argv)
+{
+	struct pfile *pf;
+	double t0, old_total = 0, new_total = 0;
+	int i, r, op, rc = 0;
+
+	snprintf(fixture_dir, sizeof(fixture_dir), "%s/procfs_parser_test.d",
+		 getenv("srcdir") ? getenv("srcdir") : ".");
+	while ((op = getopt(argc, argv, "d:n:i:")) != -1) {
+		switch (op) {
+		case 'd':
+			snprintf(fixture_dir, sizeof(fixture_dir), "%s",
+				 optarg);
+			break;
+		case 'n':
+			num_samples = atoi(optarg);
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-d <dir>] [-n <samples>] "
+			       "[-i <interval>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (num_samples < 1 || interval < 0) {
+		printf("<samples> must be positive\n");
+		return 1;
+	}
+	check_keys();
+	check_rows();
+	check_growth();
+	check_u64s();
+	if (errors) {
+		printf("%d fixture checks failed\n", errors);
+		return 1;
+	}
+	printf("fixture checks passed\n");
+
+	for (i = 0; i < NUM_FILES; i++) {
+		if (open_file(&files[i])) {
+			printf("cannot open %s\n", files[i].path);
+			return 1;
+		}
+	}
+
+	for (r = 0; r < num_samples; r++) {
+		for (i = 0; i < NUM_FILES; i++) {
+			pf = &files[i];
+			t0 = cpu_sec();
+			pf->old_count = old_parse(pf);
+			pf->old_cpu += cpu_sec() - t0;
+			t0 = cpu_sec();
+			pf->new_count = new_parse(pf);
+			pf->new_cpu += cpu_sec() - t0;
+		}
+		if (interval)
+			usleep(interval);
+	}
+
+	printf("%d samples, %d us apart\n", num_samples, interval);
+	printf("%-16s %12s %12s %8s\n", "file", "old us/samp", "new us/samp",
+	       "speedup");
+	for (i = 0; i < NUM_FILES; i++) {
+		pf = &files[i];
+		printf("%-16s %12.2f %12.2f %7.2fx\n", pf->path,
+		       pf->old_cpu * 1e6 / num_samples,
+		       pf->new_cpu * 1e6 / num_samples,
+		       pf->old_cpu / pf->new_cpu);
+		old_total += pf->old_cpu;
+		new_total += pf->new_cpu;
+		if (pf->old_count != pf->new_count) {
+			printf("ERROR: %s: %d values with fgets, %d with "
+			       "the parser\n", pf->path, pf->old_count,
+			       pf->new_count);
+			rc = 1;
+		}
+		fclose(pf->f);
+		procfs_parser_free(pf->p);
+	}
+	if (interval)
+		printf("%-16s %11.4f%% %11.4f%% of a core\n", "total",
+		       old_total * 1e8 / num_samples / interval,
+		       new_total * 1e8 / num_samples / interval);
+	return rc;
+}
@@ -67,6 +67,7 @@
 #include "ldms.h"
 #include "ldmsd.h"
 #include "../sampler_base.h"
+#include "../procfs_parser.h"
 
 #ifndef ARRAY_LEN
 #define ARRAY_LEN(a) (sizeof(a) / sizeof(*a))
@@ -130,7 +131,7 @@ static char iface[MAXIFACE][20];
 
 static ldms_set_t set;
 #define SAMP "procnetdev2"
-static FILE *mf = NULL;
+static procfs_parser_t mf = NULL;
 static ldmsd_msg_log_f msglog;
 static int metric_offset;
 static base_data_t base;
@@ -146,7 +147,7 @@ static int create_metric_set(base_data_t base)
 	ldms_schema_t schema;
 	size_t heap_sz;
 
-	mf = fopen(procfile, "r");
+	mf = procfs_parser_new(procfile);
 	if (!mf) {
 		msglog(LDMSD_LERROR, "Could not open " SAMP " file "
 				"'%s'...exiting\n",
@@ -196,8 +197,7 @@ static int create_metric_set(base_data_t base)
 
 err:
 
-	if (mf)
-		fclose(mf);
+	procfs_parser_free(mf);
 	mf = NULL;
 
 	return rc;
@@ -308,11 +308,10 @@ static int config(struct ldmsd_plugin *self, struct attr_value_list *kwl, struct
 static int sample(struct ldmsd_sampler *self)
 {
 	int rc;
-	char *s;
-	char lbuf[256];
 	char curriface[IFNAMSIZ];
-	union ldms_value v[REC_METRICS_LEN];
-	int i;
+	uint64_t v[REC_METRICS_LEN];
+	struct procfs_line *l;
+	int i, li, nlines;
 	ldms_mval_t lh, rec_inst, name_mval;
 	size_t heap_sz;
 
@@ -322,12 +321,18 @@ static int sample(struct ldmsd_sampler *self)
 	}
 
 	if (!mf)
-		mf = fopen(procfile, "r");
+		mf = procfs_parser_new(procfile);
 	if (!mf) {
 		msglog(LDMSD_LERROR, SAMP ": Could not open /proc/net/dev file "
 				"'%s'...exiting\n", procfile);
 		return ENOENT;
 	}
+	rc = procfs_parser_read(mf);
+	if (rc) {
+		msglog(LDMSD_LERROR, SAMP ": error %d reading '%s'\n",
+		       rc, procfile);
+		return rc;
+	}
 begin:
 	base_sample_begin(base);
 
@@ -336,36 +341,21 @@ begin:
 	/* reset device data */
 	ldms_list_purge(set, lh);
 
-	fseek(mf, 0, SEEK_SET); //seek should work if get to EOF
-	s = fgets(lbuf, sizeof(lbuf), mf);
-	s = fgets(lbuf, sizeof(lbuf), mf);
-
-	/* data */
-	do {
-		s = fgets(lbuf, sizeof(lbuf), mf);
-		if (!s)
-			break;
-
-		char *pch = strchr(lbuf, ':');
-		if (pch != NULL){
-			*pch = ' ';
-		}
+	/* skip the two header lines */
+	nlines = procfs_parser_line_count(mf);
+	for (li = 2; li < nlines; li++) {
+		l = procfs_parser_line(mf, li);
+		if (!l->key_len)
+			continue;
 
-		int rc = sscanf(lbuf, "%s %" PRIu64 " %" PRIu64 " %" PRIu64
-				" %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
-				" %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
-				" %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
-				" %" PRIu64 "\n", curriface, &v[1].v_u64,
-				&v[2].v_u64, &v[3].v_u64, &v[4].v_u64,
-				&v[5].v_u64, &v[6].v_u64, &v[7].v_u64,
-				&v[8].v_u64, &v[9].v_u64, &v[10].v_u64,
-				&v[11].v_u64, &v[12].v_u64, &v[13].v_u64,
-				&v[14].v_u64, &v[15].v_u64, &v[16].v_u64);
-		if (rc != 17){
+		rc = procfs_parse_u64s(l->val, &v[1], 16, NULL);
+		if (rc != 16 || l->key_len >= IFNAMSIZ){
 			msglog(LDMSD_LINFO, SAMP ": wrong number of "
-					"fields in sscanf\n");
+					"fields in '%s'\n", procfile);
 			continue;
 		}
+		memcpy(curriface, l->key, l->key_len);
+		curriface[l->key_len] = '\0';
 
 		if (niface) {
 			/* ifaces list was given in config */
@@ -385,10 +375,10 @@ begin:
 		snprintf(name_mval->a_char, IFNAMSIZ, "%s", curriface);
 		/* metrics */
 		for (i = 1; i < REC_METRICS_LEN; i++) {
-			ldms_record_set_u64(rec_inst, rec_metric_ids[i], v[i].v_u64);
+			ldms_record_set_u64(rec_inst, rec_metric_ids[i], v[i]);
 		}
 		ldms_list_append_record(set, lh, rec_inst);
-	} while (s);
+	}
 
 	base_sample_end(base);
 	return 0;
@@ -412,8 +402,7 @@ resize:
 
 static void term(struct ldmsd_plugin *self)
 {
-	if (mf)
-		fclose(mf);
+	procfs_parser_free(mf);
 	mf = NULL;
 	if (base)
 		base_del(base);
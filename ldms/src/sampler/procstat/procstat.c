@@ -50,7 +50,7 @@
  * \file procstat.c
  * \brief /proc/stat data provider
  */
-#define _GNU_SOURCE // for getline(). use a compat lib if not glibc platform
+#define _GNU_SOURCE
 #include <inttypes.h>
 #include <unistd.h>
 #include <sys/errno.h>
@@ -64,6 +64,7 @@
 #include "ldms.h"
 #include "ldmsd.h"
 #include "sampler_base.h"
+#include "procfs_parser.h"
 
 #define SAMP "procstat"
 
@@ -118,9 +119,7 @@ struct sampler_data {
 	base_data_t base;
 	ldms_schema_t schema;
 	ldms_set_t set;
-	FILE *mf;	/* /proc/stat file pointer */
-	char *line;
-	size_t line_sz;
+	procfs_parser_t mf;	/* /proc/stat parser */
 	ldmsd_msg_log_f msglog;
 	int warn_col_count;
 	int warn_row_count;
@@ -138,8 +137,6 @@ struct sampler_data {
 } g = {
 	.maxcpu = -2, // note: -2, not -1 for count_cpu to work right.
 	.base = NULL,
-	.line = NULL,
-	.line_sz = 0,
 	.warn_col_count = 0,
 	.warn_row_count = 0,
 	.compid = 0,
@@ -157,7 +154,7 @@ static ldms_set_t get_set(struct ldmsd_sampler *self)
 On initial call of a sample, cpu_count, should have -1
 and it will be the size of the total stats row after that.
 */
-int measure_cpu(int *cpu_count, int *column_count, char *token, char **saveptr)
+int measure_cpu(int *cpu_count, int *column_count, struct procfs_line *l)
 {
 
 	int column = 0;
@@ -168,8 +165,8 @@ int measure_cpu(int *cpu_count, int *column_count, char *token, char **saveptr)
 		return 0;
 	}
 	if (*cpu_count > -1) {
-		if (token) {
-			char *tmp = token+3;
+		if (l) {
+			char *tmp = l->key + 3;
 			char *end = NULL;
 			curcpu = strtol(tmp, &end, 10);
 			if (end == tmp) {
@@ -187,32 +184,19 @@ int measure_cpu(int *cpu_count, int *column_count, char *token, char **saveptr)
 			(*cpu_count)++;
 		}
 	}
-	if (!token) {
+	if (!l) {
 		return 0;
 	}
-	column = 0;
 	uint64_t *row;
 	if (curcpu == -1) {
 		row = g.sum_data;
 	} else {
 		row = g.core_metric[curcpu];
-		row[column] = 1;
+		row[0] = 1;
 	}
-	for (token = strtok_r(NULL, " \t\n", saveptr);
-		token;
-		token = strtok_r(NULL, " \t\n", saveptr)) {
-
-		if (column >= MAX_CPU_METRICS) {
-			break;
-		}
-		uint64_t val = 0;
-		char *end = NULL;
-		val = strtoull(token,&end,10);
-		if (end == token) {
-			return EINVAL;
-		}
-		column++;
-		row[column] = val;
+	column = procfs_parse_u64s(l->val, &row[1], MAX_CPU_METRICS - 1, NULL);
+	if (column == 0) {
+		return EINVAL;
 	}
 	if ( (*column_count) > 0 && column < (*column_count)) {
 		rc = 1;
@@ -231,8 +215,9 @@ result is undefined if token!='cpu*' (where * is 0 or more digits).
 on normal exit, cpu_count has the number of cores so far found.
 On initial call, cpu_count, should have -1.
 */
-int count_cpu( int *cpu_count, int *column_count, char *token, char **saveptr) {
-
+int count_cpu( int *cpu_count, int *column_count, struct procfs_line *l) {
+	uint64_t val[MAX_CPU_METRICS];
+	char *end;
 	int column = 0;
 	long curcpu = -1;
 	if (*cpu_count == g.maxcpu) {
@@ -245,8 +230,8 @@ int count_cpu( int *cpu_count, int *column_count, char *token, char **saveptr) {
 		return 0;
 	}
 	if (*cpu_count > -1) {
-		if (token) {
-			char *tmp = token+3;
+		if (l) {
+			char *tmp = l->key + 3;
 			char *end = NULL;
 			curcpu = strtol(tmp,&end,10);
 			if (end == tmp) {
@@ -261,24 +246,16 @@ int count_cpu( int *cpu_count, int *column_count, char *token, char **saveptr) {
 			(*cpu_count)++;
 		}
 	}
-	if (!token) {
+	if (!l) {
 		return 0;
 	}
-	column = 1;
-
-	for (token = strtok_r(NULL, " \t\n", saveptr);
-		token;
-		token = strtok_r(NULL, " \t\n", saveptr)) {
-
-		if (column >= MAX_CPU_METRICS) {
-			if (g.warn_col_count < 3) {
-				g.msglog(LDMSD_LERROR,
-				SAMP ": extra cpu metric found\n");
-				g.warn_col_count++;
-			}
-			break;
+	column = 1 + procfs_parse_u64s(l->val, val, MAX_CPU_METRICS - 1, &end);
+	if (column == MAX_CPU_METRICS && procfs_parse_u64s(end, val, 1, NULL)) {
+		if (g.warn_col_count < 3) {
+			g.msglog(LDMSD_LERROR,
+			SAMP ": extra cpu metric found\n");
+			g.warn_col_count++;
 		}
-		column++;
 	}
 	*column_count = column;
 	(*cpu_count)++;
@@ -296,9 +273,11 @@ static int create_metric_set(base_data_t base)
 	int rc,i;
 	int column_count = 0;
 	int cpu_count;
-	char *saveptr;
+	int li, nlines;
+	struct procfs_line *l;
+	char token[32];
 
-	g.mf = fopen("/proc/stat", "r");
+	g.mf = procfs_parser_new("/proc/stat");
 	if (!g.mf) {
 		g.msglog(LDMSD_LERROR,"Could not open the /proc/stat file.\n");
 		return ENOENT;
@@ -313,7 +292,11 @@ static int create_metric_set(base_data_t base)
 		goto err;
 	}
 
-	fseek(g.mf, 0, SEEK_SET);
+	rc = procfs_parser_read(g.mf);
+	if (rc) {
+		g.msglog(LDMSD_LERROR, SAMP ": error %d reading /proc/stat.\n", rc);
+		goto err1;
+	}
 
 	MID_NCORE = ldms_schema_metric_add(g.schema, "cores_up", LDMS_V_U64);
 
@@ -328,29 +311,24 @@ static int create_metric_set(base_data_t base)
 	}
 
 	cpu_count = -1;
-	do {
-		char *token;
-		int nchar=0;
-		nchar = getline(&g.line, &g.line_sz, g.mf);
-		if (nchar < 4)
-			break;
+	nlines = procfs_parser_line_count(g.mf);
+	for (li = 0; li < nlines; li++) {
+		l = procfs_parser_line(g.mf, li);
 
 		/* Do not throw away first column which is the CPU 'name'.
 		 on systems where a core is downed, linux does not report
 		it at all. keep core number in the metrics;
 		issue empty row if missing.
 		 */
-		saveptr = NULL;
-		token = strtok_r(g.line, " \t\n", &saveptr);
-		if (token == NULL)
+		if (l->key_len == 0)
 			continue;
+		snprintf(token, sizeof(token), "%.*s", l->key_len, l->key);
 
 #define STAT_UNEXPECTED(S) \
 	g.msglog(LDMSD_LINFO,SAMP ": unexpected %s in /proc/stat names\n",S)
 
 #define STAT_SCALAR(X,Y, POS) \
 if (strcmp(token,X)==0) { \
-	token = strtok_r(NULL, " \t\n", &saveptr); \
 	rc = ldms_schema_metric_add(g.schema, Y, LDMS_V_U64); \
 	if (rc < 0) { \
 		g.msglog(LDMSD_LERROR, SAMP ": add " X " failed (finish).\n"); \
@@ -367,7 +345,7 @@ if (strcmp(token,X)==0) { \
 #define FINISH_CPUS \
 	if (cpu_count < g.maxcpu) { \
 		int errcpu = count_cpu(&cpu_count, \
-			&column_count, NULL, NULL); \
+			&column_count, NULL); \
 		if (errcpu) { \
 			g.msglog(LDMSD_LERROR, SAMP ": count_cpu" \
 				" failed (finish).\n"); \
@@ -380,7 +358,7 @@ if (strcmp(token,X)==0) { \
 		case 'c':
 			if (0 == strncmp(token, "cpu", 3)) {
 				int errcpu = count_cpu(&cpu_count,
-					&column_count, token, &saveptr);
+					&column_count, l);
 				if (errcpu) {
 					// log something here?
 					rc = errcpu;
@@ -435,7 +413,7 @@ if (strcmp(token,X)==0) { \
 			STAT_UNEXPECTED(token);
 		}
 
-	} while (1);
+	}
 
 	if (g.maxcpu < 1 && cpu_count >= 0) {
 		g.maxcpu = cpu_count;
@@ -470,8 +448,8 @@ if (strcmp(token,X)==0) { \
 	ldms_schema_delete(g.schema);
 	g.schema = NULL;
  err:
-	if (g.mf)
-		fclose(g.mf);
+	procfs_parser_free(g.mf);
+	g.mf = NULL;
 	return rc ;
 #undef STAT_UNEXPECTED
 #undef STAT_SCALAR
@@ -587,28 +565,28 @@ static int config(struct ldmsd_plugin *self, struct attr_value_list *kwl, struct
 static int sample(struct ldmsd_sampler *self)
 {
 	int rc = 0;
-	char *saveptr = NULL;
 	int column_count = 0;
 	int cpu_count;
+	int li, nlines;
+	struct procfs_line *l;
+	char token[32];
 
 	if (!g.set ){
 		g.msglog(LDMSD_LERROR, SAMP ": plugin not initialized\n");
 		return EINVAL;
 	}
-	int err = fseek(g.mf, 0, SEEK_SET);
-	if (err < 0) {
-		g.msglog(LDMSD_LERROR, SAMP ": failure seeking /proc/stat.\n");
+	int err = procfs_parser_read(g.mf);
+	if (err) {
+		g.msglog(LDMSD_LERROR, SAMP ": failure reading /proc/stat.\n");
 		return 0;
 	}
 
 	base_sample_begin(g.base);
 
 	cpu_count = -1;
-	do {
-		ssize_t nchar = 0;
-		nchar = getline(&g.line, &g.line_sz, g.mf);
-		if (nchar < 4)
-			break;
+	nlines = procfs_parser_line_count(g.mf);
+	for (li = 0; li < nlines; li++) {
+		l = procfs_parser_line(g.mf, li);
 
 #define S_STAT_UNEXPECTED(S) \
 	g.msglog(LDMSD_LINFO,SAMP ": unexpected %s in /proc/stat names\n",S)
@@ -616,12 +594,10 @@ static int sample(struct ldmsd_sampler *self)
 /* verify name and set value. */
 #define GET_STAT_SCALAR(X, pos) \
 	if (strcmp(X, ldms_metric_name_get(g.set, pos))==0) { \
-		token = strtok_r(NULL, " \t\n", &saveptr); \
-		char *endp = NULL; \
-		uint64_t val = strtoull(token,&endp,10); \
-		if (endp == token) { \
+		uint64_t val; \
+		if (1 != procfs_parse_u64s(l->val, &val, 1, NULL)) { \
 			g.msglog(LDMSD_LINFO,SAMP ": non-int value " \
-			"in line %s in /proc/stat: %s\n", X, token); \
+			"in line %s in /proc/stat: %s\n", X, l->val); \
 		} else { \
 			ldms_metric_set_u64(g.set, pos, val); \
 		} \
@@ -638,28 +614,23 @@ static int sample(struct ldmsd_sampler *self)
 #define S_FINISH_CPUS \
 	if (cpu_count < g.maxcpu) { \
 		int errcpu = measure_cpu(&cpu_count, &column_count, \
-			NULL, NULL ); \
+			NULL); \
 		if (errcpu) { \
 			rc = errcpu; \
 			goto err1; \
 		} \
 	}
 
-		char *token;
-		if (nchar < 4)
-			break;
-		saveptr = NULL;
-		token = strtok_r(g.line, " \t\n", &saveptr);
 		/* First time have to check for corner case NULL  */
-		if (token == NULL)
+		if (l->key_len == 0)
 			continue;
+		snprintf(token, sizeof(token), "%.*s", l->key_len, l->key);
 
 		switch (token[0]) {
 		case 'c':
 			if (0 == strncmp(token, "cpu", 3)) {
 				int errcpu = measure_cpu(&cpu_count,
-					&column_count,
-					token, &saveptr);
+					&column_count, l);
 				if (errcpu) {
 					/* log something here? */
 					rc = errcpu;
@@ -705,7 +676,7 @@ static int sample(struct ldmsd_sampler *self)
 		default:
 			S_FINISH_CPUS;
 		}
-	} while (1);
+	}
 
 	int i,j;
 	uint64_t ncore = 0;
@@ -757,10 +728,8 @@ static void term(struct ldmsd_plugin *self)
 		ldms_schema_delete(g.schema);
 		g.schema = NULL;
 	}
-	free(g.line);
-	g.line = NULL;
-	if (g.mf)
-		fclose(g.mf);
+	procfs_parser_free(g.mf);
+	g.mf = NULL;
 }
 
 static struct ldmsd_sampler procstat_plugin = {
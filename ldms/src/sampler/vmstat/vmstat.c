@@ -64,6 +64,7 @@
 #include "ldms.h"
 #include "ldmsd.h"
 #include "sampler_base.h"
+#include "procfs_parser.h"
 
 #define PROC_FILE "/proc/vmstat"
 
@@ -71,9 +72,10 @@ static char *procfile = PROC_FILE;
 
 static ldms_set_t set;
 #define SAMP "vmstat"
-static FILE *mf = 0;
+static procfs_parser_t mf;
 static ldmsd_msg_log_f msglog;
 static int metric_offset = 1;
+static int num_metrics;
 static base_data_t base;
 
 static ldms_set_t get_set(struct ldmsd_sampler *self)
@@ -83,14 +85,13 @@ static ldms_set_t get_set(struct ldmsd_sampler *self)
 #define LBUFSZ 256
 static int create_metric_set(base_data_t base)
 {
-	int rc;
+	int rc, i, n;
 	uint64_t metric_value;
-	char *s;
-	char lbuf[LBUFSZ];
+	struct procfs_line *l;
 	char metric_name[LBUFSZ];
 	ldms_schema_t schema;
 
-	mf = fopen(procfile, "r");
+	mf = procfs_parser_new(procfile);
 	if (!mf) {
 		msglog(LDMSD_LERROR, "Could not open the " SAMP " file "
 				"'%s'...exiting\n", procfile);
@@ -109,18 +110,29 @@ static int create_metric_set(base_data_t base)
 	/* Location of first metric from proc/vmstat file */
 	metric_offset = ldms_schema_metric_count_get(schema);
 
-	fseek(mf, 0, SEEK_SET);
-	do {
-		s = fgets(lbuf, sizeof(lbuf), mf);
-		if (!s)
-			break;
-		rc = sscanf(lbuf, "%s %" PRIu64 "\n", metric_name, &metric_value);
-		if (rc < 2)
+	rc = procfs_parser_read(mf);
+	if (rc)
+		goto err;
+	n = procfs_parser_line_count(mf);
+	for (i = 0; i < n; i++) {
+		l = procfs_parser_line(mf, i);
+		if (!l->key_len || l->key_len >= LBUFSZ ||
+		    1 != procfs_parse_u64s(l->val, &metric_value, 1, NULL)) {
+			rc = EINVAL;
 			goto err;
+		}
+		snprintf(metric_name, sizeof(metric_name), "%.*s",
+			 l->key_len, l->key);
 		rc = ldms_schema_metric_add(schema, metric_name, LDMS_V_U64);
 		if (rc < 0)
 			goto err;
-	} while (s);
+		rc = procfs_parser_key_add(mf, metric_name);
+		if (rc < 0) {
+			rc = -rc;
+			goto err;
+		}
+	}
+	num_metrics = n;
 
 	set = base_set_new(base);
 	if (!set) {
@@ -130,8 +142,7 @@ static int create_metric_set(base_data_t base)
 	return 0;
 
  err:
-	if (mf)
-		fclose(mf);
+	procfs_parser_free(mf);
 	mf = NULL;
 	return rc;
 }
@@ -195,10 +206,8 @@ static int config(struct ldmsd_plugin *self, struct attr_value_list *kwl, struct
 static int sample(struct ldmsd_sampler *self)
 {
 	int rc;
-	int metric_no;
-	char *s;
-	char lbuf[LBUFSZ];
-	char metric_name[LBUFSZ];
+	int i;
+	struct procfs_line *l;
 	union ldms_value v;
 
 	if (!set) {
@@ -206,21 +215,21 @@ static int sample(struct ldmsd_sampler *self)
 		return EINVAL;
 	}
 
+	rc = procfs_parser_read(mf);
+	if (rc)
+		return rc;
 	base_sample_begin(base);
-	metric_no = metric_offset;
-	fseek(mf, 0, SEEK_SET);
-	do {
-		s = fgets(lbuf, sizeof(lbuf), mf);
-		if (!s)
-			break;
-		rc = sscanf(lbuf, "%s %" PRIu64 "\n", metric_name, &v.v_u64);
-		if (rc != 2) {
+	for (i = 0; i < num_metrics; i++) {
+		/* counters missing after a kernel change are left as is */
+		l = procfs_parser_key_line(mf, i);
+		if (!l)
+			continue;
+		if (1 != procfs_parse_u64s(l->val, &v.v_u64, 1, NULL)) {
 			rc = EINVAL;
 			goto out;
 		}
-		ldms_metric_set(set, metric_no, &v);
-		metric_no++;
-	} while (s);
+		ldms_metric_set(set, metric_offset + i, &v);
+	}
 	rc = 0;
  out:
 	base_sample_end(base);
@@ -229,8 +238,7 @@ static int sample(struct ldmsd_sampler *self)
 
 static void term(struct ldmsd_plugin *self)
 {
-	if (mf)
-		fclose(mf);
+	procfs_parser_free(mf);
 	mf = NULL;
 	if (base)
 		base_del(base);
@@ -38,6 +38,7 @@
  * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#define _GNU_SOURCE
 #include <sys/queue.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -55,11 +56,34 @@
 #include <pwd.h>
 #include <sys/syscall.h>
 #include <assert.h>
+#include <time.h>
 #include <curl/curl.h>
 #include "ldms.h"
 #include "ldmsd.h"
 
 static char host_port[64];	/* hostname:port_no for influxdb */
+
+/*
+ * Lines for one InfluxDB write URL, accumulated across sets and stores.
+ * Producers append to `buf`; the sender thread swaps it with `sbuf` and
+ * POSTs `sbuf` on the keep-alive `curl` handle, which only it uses.
+ */
+struct influx_batch {
+	char *url;
+	CURL *curl;
+	struct curl_slist *headers;
+	char *buf;		/* lines being accumulated */
+	size_t len;
+	size_t alloc_len;
+	int lines;
+	struct timespec start;	/* time of the first line in buf */
+	char *sbuf;		/* lines being sent */
+	size_t slen;
+	size_t salloc_len;
+	int slines;
+	LIST_ENTRY(influx_batch) entry;
+};
+
 struct influx_store {
 	struct ldmsd_store *store;
 	void *ucontext;
@@ -70,18 +94,45 @@ struct influx_store {
 	int job_mid;
 	int comp_mid;
 	char **metric_name;
-	CURL *curl;
+	struct influx_batch *batch;
 	LIST_ENTRY(influx_store) entry;
 	size_t measurement_limit;
 	char measurement[0];
 };
 
 #define MEASUREMENT_LIMIT_DEFAULT	4096
+#define BATCH_SIZE_DEFAULT		65536
+#define BATCH_TIME_DEFAULT		1000	/* ms */
+#define BATCH_PENDING_MAX		16	/* x batch_size before dropping */
+#define STATS_INTERVAL			60	/* seconds */
 static size_t measurement_limit = MEASUREMENT_LIMIT_DEFAULT;
+static size_t batch_size = BATCH_SIZE_DEFAULT;
+static long batch_time = BATCH_TIME_DEFAULT;
 static pthread_mutex_t cfg_lock = PTHREAD_MUTEX_INITIALIZER;
 LIST_HEAD(influx_store_list, influx_store) store_list;
 static ldmsd_msg_log_f msglog;
 
+/* Batches and the sender thread; protected by batch_lock */
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t batch_cv = PTHREAD_COND_INITIALIZER;
+static LIST_HEAD(, influx_batch) batch_list;
+static pthread_t sender_thread;
+static int sender_running;
+static int sender_stop;
+static int flush_req;
+
+static struct influx_stats {
+	uint64_t batches;
+	uint64_t lines;
+	uint64_t bytes;
+	uint64_t errors;
+	uint64_t dropped;
+	double lat_min;		/* ms */
+	double lat_max;		/* ms */
+	double lat_sum;		/* ms */
+	time_t last_report;
+} stats;
+
 static int set_none_fn(char *line, size_t *line_off, size_t line_len, ldms_set_t s, int i)
 {
 	assert(0 == "Invalid LDMS metric type");
@@ -178,10 +229,35 @@ static int config(struct ldmsd_plugin *self, struct attr_value_list *kwl, struct
 	value = av_value(avl, "host_port");
 	if (!value) {
 		msglog(LDMSD_LERROR, "The 'host_port' keyword is required.\n");
+		pthread_mutex_unlock(&cfg_lock);
 		return EINVAL;
 	}
 	strncpy(host_port, value, sizeof(host_port));
 
+	value = av_value(avl, "batch_size");
+	if (value) {
+		long sz = strtol(value, NULL, 0);
+		if (sz < 0) {
+			msglog(LDMSD_LERROR,
+			       "'%s' is not a valid 'batch_size' value\n",
+			       value);
+		} else {
+			batch_size = sz;
+		}
+	}
+
+	value = av_value(avl, "batch_time");
+	if (value) {
+		long ms = strtol(value, NULL, 0);
+		if (ms <= 0) {
+			msglog(LDMSD_LERROR,
+			       "'%s' is not a valid 'batch_time' value\n",
+			       value);
+		} else {
+			batch_time = ms;
+		}
+	}
+
 	value = av_value(avl, "measurement_limit");
 	if (value) {
 		measurement_limit = strtol(value, NULL, 0);
@@ -197,13 +273,335 @@ static int config(struct ldmsd_plugin *self, struct attr_value_list *kwl, struct
 	return 0;
 }
 
+static void sender_stop_join(void);
+
 static void term(struct ldmsd_plugin *self)
 {
+	sender_stop_join();
 }
 
 static const char *usage(struct ldmsd_plugin *self)
 {
-	return  "    config name=influx host_port=<hostname>':'<port_no>\n";
+	return  "    config name=influx host_port=<hostname>':'<port_no>\n"
+		"           [measurement_limit=<bytes>] [batch_size=<bytes>]\n"
+		"           [batch_time=<ms>]\n"
+		"        measurement_limit The maximum length of a line (default 4096).\n"
+		"        batch_size        Lines for the same InfluxDB database are\n"
+		"                          accumulated across sets and storage\n"
+		"                          policies and written with one POST when\n"
+		"                          the batch reaches batch_size bytes\n"
+		"                          (default 65536), 0 sends every line\n"
+		"                          on its own.\n"
+		"        batch_time        The maximum time in milliseconds a line\n"
+		"                          waits in a batch (default 1000).\n"
+		"    The batches are sent by a background thread over keep-alive\n"
+		"    connections. Batch statistics are logged at INFO level.\n";
+}
+
+static double ts_diff_ms(struct timespec *a, struct timespec *b)
+{
+	return (a->tv_sec - b->tv_sec) * 1e3 + (a->tv_nsec - b->tv_nsec) / 1e6;
+}
+
+static int buf_reserve(char **buf, size_t *alloc_len, size_t len)
+{
+	size_t sz;
+	char *p;
+	if (len <= *alloc_len)
+		return 0;
+	sz = *alloc_len ? *alloc_len : 4096;
+	while (sz < len)
+		sz *= 2;
+	p = realloc(*buf, sz);
+	if (!p)
+		return ENOMEM;
+	*buf = p;
+	*alloc_len = sz;
+	return 0;
+}
+
+/* Find or create the batch of `url`. The caller must hold batch_lock. */
+static struct influx_batch *batch_get(const char *url)
+{
+	struct influx_batch *b;
+
+	LIST_FOREACH(b, &batch_list, entry) {
+		if (0 == strcmp(b->url, url))
+			return b;
+	}
+	b = calloc(1, sizeof(*b));
+	if (!b)
+		return NULL;
+	b->url = strdup(url);
+	if (!b->url)
+		goto err;
+	b->curl = curl_easy_init();
+	if (!b->curl)
+		goto err;
+	b->headers = curl_slist_append(NULL, "Content-Type: application/influx");
+	curl_easy_setopt(b->curl, CURLOPT_URL, b->url);
+	curl_easy_setopt(b->curl, CURLOPT_HTTPHEADER, b->headers);
+	curl_easy_setopt(b->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(b->curl, CURLOPT_NOSIGNAL, 1L);
+	LIST_INSERT_HEAD(&batch_list, b, entry);
+	return b;
+ err:
+	if (b->curl)
+		curl_easy_cleanup(b->curl);
+	free(b->url);
+	free(b);
+	return NULL;
+}
+
+static void batch_free(struct influx_batch *b)
+{
+	curl_easy_cleanup(b->curl);
+	curl_slist_free_all(b->headers);
+	free(b->url);
+	free(b->buf);
+	free(b->sbuf);
+	free(b);
+}
+
+/* Append a line to the batch, waking the sender when the batch is full */
+static int batch_add(struct influx_batch *b, const char *line, size_t len)
+{
+	int rc;
+
+	pthread_mutex_lock(&batch_lock);
+	if (b->len + len + 1 > BATCH_PENDING_MAX *
+			       (batch_size ? batch_size : BATCH_SIZE_DEFAULT)) {
+		/* InfluxDB does not keep up */
+		stats.dropped++;
+		rc = ENOBUFS;
+		goto out;
+	}
+	rc = buf_reserve(&b->buf, &b->alloc_len, b->len + len + 1);
+	if (rc)
+		goto out;
+	memcpy(b->buf + b->len, line, len);
+	b->len += len;
+	b->buf[b->len++] = '\n';
+	if (!b->lines++)
+		clock_gettime(CLOCK_MONOTONIC, &b->start);
+	if (b->len >= batch_size)
+		pthread_cond_signal(&batch_cv);
+ out:
+	pthread_mutex_unlock(&batch_lock);
+	return rc;
+}
+
+/*
+ * Move the accumulated lines of `b` to its send buffer if the batch is
+ * due. The caller must hold batch_lock.
+ */
+static int batch_take(struct influx_batch *b, struct timespec *now, int force)
+{
+	char *buf;
+	size_t alloc_len;
+
+	if (!b->lines)
+		return 0;
+	if (!force && b->len < batch_size &&
+	    ts_diff_ms(now, &b->start) < batch_time)
+		return 0;
+	buf = b->sbuf;
+	alloc_len = b->salloc_len;
+	b->sbuf = b->buf;
+	b->salloc_len = b->alloc_len;
+	b->slen = b->len;
+	b->slines = b->lines;
+	b->buf = buf;
+	b->alloc_len = alloc_len;
+	b->len = 0;
+	b->lines = 0;
+	return 1;
+}
+
+/* POST the send buffers of the `n` batches concurrently */
+static void batch_send(CURLM *multi, struct influx_batch **v, int n)
+{
+	struct timespec t0, t1;
+	struct influx_batch *b;
+	CURLMsg *msg;
+	long code;
+	int i, running, q;
+	uint64_t errors = 0, lines = 0, bytes = 0;
+	double lat;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n; i++) {
+		b = v[i];
+		curl_easy_setopt(b->curl, CURLOPT_POSTFIELDS, b->sbuf);
+		curl_easy_setopt(b->curl, CURLOPT_POSTFIELDSIZE, (long)b->slen);
+		curl_multi_add_handle(multi, b->curl);
+		lines += b->slines;
+		bytes += b->slen;
+	}
+	do {
+		if (curl_multi_perform(multi, &running) != CURLM_OK)
+			break;
+		if (running)
+			curl_multi_wait(multi, NULL, 0, 1000, NULL);
+	} while (running);
+	while ((msg = curl_multi_info_read(multi, &q))) {
+		if (msg->msg != CURLMSG_DONE)
+			continue;
+		code = 0;
+		curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &code);
+		if (msg->data.result != CURLE_OK || code < 200 || code >= 300) {
+			errors++;
+			msglog(LDMSD_LERROR, "store_influx: write error: %s, "
+			       "HTTP status %ld\n",
+			       curl_easy_strerror(msg->data.result), code);
+		}
+	}
+	for (i = 0; i < n; i++) {
+		curl_multi_remove_handle(multi, v[i]->curl);
+		v[i]->slen = 0;
+		v[i]->slines = 0;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	lat = ts_diff_ms(&t1, &t0);
+	msglog(LDMSD_LDEBUG, "store_influx: sent %d batches, %lu lines, "
+	       "%lu bytes in %.3f ms\n", n, lines, bytes, lat);
+
+	pthread_mutex_lock(&batch_lock);
+	if (!stats.batches || lat < stats.lat_min)
+		stats.lat_min = lat;
+	if (lat > stats.lat_max)
+		stats.lat_max = lat;
+	stats.lat_sum += lat * n;
+	stats.batches += n;
+	stats.lines += lines;
+	stats.bytes += bytes;
+	stats.errors += errors;
+	pthread_mutex_unlock(&batch_lock);
+}
+
+/* The caller must hold batch_lock */
+static void stats_report(time_t now)
+{
+	if (now - stats.last_report < STATS_INTERVAL)
+		return;
+	stats.last_report = now;
+	if (!stats.batches)
+		return;
+	msglog(LDMSD_LINFO, "store_influx: %lu batches, %.1f lines/batch, "
+	       "%.0f bytes/batch, latency ms min %.3f mean %.3f max %.3f, "
+	       "%lu errors, %lu lines dropped\n",
+	       stats.batches, (double)stats.lines / stats.batches,
+	       (double)stats.bytes / stats.batches, stats.lat_min,
+	       stats.lat_sum / stats.batches, stats.lat_max,
+	       stats.errors, stats.dropped);
+}
+
+static void *sender_proc(void *arg)
+{
+	struct influx_batch **v = NULL, *b;
+	struct timespec now, wait, first;
+	CURLM *multi = arg;
+	int n, len = 0, stop, force;
+	double ms;
+
+	pthread_mutex_lock(&batch_lock);
+	while (1) {
+		stop = sender_stop;
+		force = stop || flush_req;
+		flush_req = 0;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		stats_report(now.tv_sec);
+		n = 0;
+		first.tv_sec = 0;
+		LIST_FOREACH(b, &batch_list, entry) {
+			if (n == len) {
+				struct influx_batch **p;
+				p = realloc(v, (len + 16) * sizeof(*v));
+				if (!p)
+					break;
+				v = p;
+				len += 16;
+			}
+			if (batch_take(b, &now, force)) {
+				v[n++] = b;
+			} else if (b->lines && (!first.tv_sec ||
+				   ts_diff_ms(&first, &b->start) > 0)) {
+				first = b->start;
+			}
+		}
+		if (n) {
+			pthread_mutex_unlock(&batch_lock);
+			batch_send(multi, v, n);
+			pthread_mutex_lock(&batch_lock);
+			continue;
+		}
+		if (stop)
+			break;
+		/* sleep until the oldest pending line is due */
+		ms = first.tv_sec ? batch_time - ts_diff_ms(&now, &first)
+				  : STATS_INTERVAL * 1000;
+		if (ms < 1)
+			ms = 1;
+		clock_gettime(CLOCK_REALTIME, &wait);
+		wait.tv_sec += (long)ms / 1000;
+		wait.tv_nsec += ((long)ms % 1000) * 1000000;
+		if (wait.tv_nsec >= 1000000000) {
+			wait.tv_sec++;
+			wait.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&batch_cv, &batch_lock, &wait);
+	}
+	pthread_mutex_unlock(&batch_lock);
+	free(v);
+	curl_multi_cleanup(multi);
+	return NULL;
+}
+
+/* The caller must hold batch_lock */
+static int sender_start(void)
+{
+	CURLM *multi;
+	int rc;
+
+	if (sender_running)
+		return 0;
+	multi = curl_multi_init();
+	if (!multi)
+		return ENOMEM;
+	sender_stop = 0;
+	rc = pthread_create(&sender_thread, NULL, sender_proc, multi);
+	if (rc) {
+		curl_multi_cleanup(multi);
+		return rc;
+	}
+	pthread_setname_np(sender_thread, "influx:send");
+	sender_running = 1;
+	return 0;
+}
+
+/* Send what is pending, stop the sender thread and free the batches */
+static void sender_stop_join(void)
+{
+	struct influx_batch *b;
+
+	pthread_mutex_lock(&batch_lock);
+	if (!sender_running) {
+		pthread_mutex_unlock(&batch_lock);
+		return;
+	}
+	sender_stop = 1;
+	pthread_cond_signal(&batch_cv);
+	pthread_mutex_unlock(&batch_lock);
+	pthread_join(sender_thread, NULL);
+	pthread_mutex_lock(&batch_lock);
+	sender_running = 0;
+	stats.last_report = 0;
+	stats_report(STATS_INTERVAL);
+	while ((b = LIST_FIRST(&batch_list))) {
+		LIST_REMOVE(b, entry);
+		batch_free(b);
+	}
+	pthread_mutex_unlock(&batch_lock);
 }
 
 static ldmsd_store_handle_t
@@ -231,13 +629,21 @@ open_store(struct ldmsd_store *s, const char *container, const char *schema,
 	is->job_mid = -1;
 	is->comp_mid = -1;
 
-	is->curl = curl_easy_init();
-	if (!is->curl)
-		goto err3;
+	char url[256];
+	snprintf(url, sizeof(url), "http://%s/write?db=%s", is->host_port, is->container);
+	pthread_mutex_lock(&batch_lock);
+	is->batch = batch_get(url);
+	if (is->batch && sender_start())
+		is->batch = NULL;
+	pthread_mutex_unlock(&batch_lock);
+	if (!is->batch)
+		goto err4;
 	pthread_mutex_lock(&cfg_lock);
 	LIST_INSERT_HEAD(&store_list, is, entry);
 	pthread_mutex_unlock(&cfg_lock);
 	return is;
+ err4:
+	free(is->host_port);
  err3:
 	free(is->schema);
  err2:
@@ -340,13 +746,6 @@ store(ldmsd_store_handle_t _sh, ldms_set_t set, int *metric_arry, size_t metric_
 			goto err;
 	}
 
-	char url[128];
-	snprintf(url, sizeof(url), "http://%s/write?db=%s", is->host_port, is->container);
-	curl_easy_setopt(is->curl, CURLOPT_URL, url);
-
-	struct curl_slist *headers = NULL;
-	headers = curl_slist_append(headers, "Content-Type: application/influx");
-
 	measurement = is->measurement;
 	cnt = snprintf(measurement, is->measurement_limit,
 		       "%s,job_id=%lui,component_id=%lui ",
@@ -393,13 +792,12 @@ store(ldmsd_store_handle_t _sh, ldms_set_t set, int *metric_arry, size_t metric_
 	cnt = snprintf(&measurement[off], is->measurement_limit - off, " %lld", ts);
 	off += cnt;
 
-	curl_easy_setopt(is->curl, CURLOPT_POSTFIELDS, measurement);
-	curl_easy_setopt(is->curl, CURLOPT_POSTFIELDSIZE, off);
-	curl_easy_setopt(is->curl, CURLOPT_HTTPHEADER, headers);
-	curl_easy_perform(is->curl);
-	curl_slist_free_all(headers);
+	rc = batch_add(is->batch, measurement, off);
 	pthread_mutex_unlock(&is->lock);
-	return 0;
+	if (rc == ENOBUFS)
+		msglog(LDMSD_LDEBUG, "store_influx: %s: batch full, line dropped\n",
+		       is->schema);
+	return rc;
 err:
 	pthread_mutex_unlock(&is->lock);
 
@@ -409,6 +807,10 @@ err:
 
 static int flush_store(ldmsd_store_handle_t _sh)
 {
+	pthread_mutex_lock(&batch_lock);
+	flush_req = 1;
+	pthread_cond_signal(&batch_cv);
+	pthread_mutex_unlock(&batch_lock);
 	return 0;
 }
 
@@ -425,6 +827,7 @@ static void close_store(ldmsd_store_handle_t _sh)
 
 	free(is->container);
 	free(is->schema);
+	free(is->host_port);
 	free(is);
 }
 
@@ -460,9 +863,11 @@ static void store_influx_init()
 {
 	curl_global_init(CURL_GLOBAL_DEFAULT);
 	LIST_INIT(&store_list);
+	LIST_INIT(&batch_list);
 }
 
 static void __attribute__ ((destructor)) store_influx_fini(void);
 static void store_influx_fini()
 {
+	sender_stop_join();
 }
@@ -66,6 +66,7 @@
 #include <assert.h>
 #include <librdkafka/rdkafka.h>
 #include <ovis_json/ovis_json.h>
+#include "coll/rbt.h"
 #include "ldms.h"
 #include "ldmsd.h"
 
@@ -78,7 +79,7 @@ static ldmsd_msg_log_f msglog __attribute__(( format(printf, 2, 3) ));
 #define LOG_WARN(FMT, ...) LOG(LDMSD_LWARNING, FMT, ## __VA_ARGS__)
 
 static const char *_help_str =
-"    config name=store_kafka [path=JSON_FILE]\n"
+"    config name=store_kafka [path=JSON_FILE] [encoding=json|binary]\n"
 "        path=JSON_FILE is an optional JSON file containing a dictionary with\n"
 "                       KEYS being Kafka configuration properties and\n"
 "                       VALUES being their corresponding values.\n"
@@ -86,6 +87,13 @@ static const char *_help_str =
 "                       Kafka connections from store_kafka.\n"
 "                       Please see https://github.com/edenhill/librdkafka/blob/master/CONFIGURATION.md\n"
 "                       for a list of supported properties.\n"
+"        encoding=json|binary is the message encoding of the rows (default:\n"
+"                       json). `json` produces a JSON object per row.\n"
+"                       `binary` produces the compact length-prefixed\n"
+"                       encoding of ldmsd_row_to_binary_buf(): a u32\n"
+"                       column count followed by a (u8 type, u32 count,\n"
+"                       values) triple per column, little-endian, without\n"
+"                       the column names.\n"
 "\n"
 "    STRGP WITH STORE_KAFKA\n"
 "    ----------------------\n"
@@ -104,6 +112,12 @@ static const char *usage(struct ldmsd_plugin *self)
 pthread_mutex_t sk_lock = PTHREAD_MUTEX_INITIALIZER;
 static rd_kafka_conf_t *common_rconf = NULL;
 
+typedef enum sk_encoding_e {
+	SK_ENCODING_JSON,
+	SK_ENCODING_BINARY,
+} sk_encoding_t;
+static sk_encoding_t sk_encoding = SK_ENCODING_JSON;
+
 static int config(struct ldmsd_plugin *self, struct attr_value_list *kwl,
 		  struct attr_value_list *avl)
 {
@@ -134,6 +148,17 @@ static int config(struct ldmsd_plugin *self, struct attr_value_list *kwl,
 		goto out;
 	}
 
+	val = av_value(avl, "encoding");
+	if (!val || 0 == strcasecmp(val, "json")) {
+		sk_encoding = SK_ENCODING_JSON;
+	} else if (0 == strcasecmp(val, "binary")) {
+		sk_encoding = SK_ENCODING_BINARY;
+	} else {
+		LOG_ERROR("Unknown encoding: %s\n", val);
+		rc = EINVAL;
+		goto out;
+	}
+
 	path = av_value(avl, "path");
 	if (!path)
 		goto out; /* nothing more to do */
@@ -300,11 +325,29 @@ static int flush_store(ldmsd_store_handle_t _sh)
 	return 0;
 }
 
+/* A cached Kafka topic, one per row schema */
+typedef struct sk_topic_s {
+	struct rbn rbn; /* key is name */
+	rd_kafka_topic_t *rkt;
+	char name[OVIS_FLEX];
+} *sk_topic_t;
+
 typedef struct store_kafka_handle_s {
 	rd_kafka_t *rk; /* The Kafka handle */
 	rd_kafka_conf_t *rconf; /* The Kafka configuration */
+	sk_encoding_t encoding; /* The row encoding */
+	struct rbt topic_rbt; /* sk_topic_s by row schema name */
+	struct ldmsd_row_buf_s rbuf; /* serialized rows of a batch */
+	rd_kafka_message_t *msgs; /* messages of a batch */
+	size_t *msg_off; /* offsets of the messages in rbuf */
+	int msgs_len; /* the allocated length of msgs and msg_off */
 } *store_kafka_handle_t;
 
+static int topic_cmp(void *tree_key, const void *key)
+{
+	return strcmp(tree_key, key);
+}
+
 static int
 store(ldmsd_store_handle_t _sh, ldms_set_t set,
       int *metric_arry, size_t metric_count)
@@ -321,9 +364,20 @@ static void close_store(ldmsd_store_handle_t _sh)
 
 	/* This is called when strgp stopped to clean up resources */
 	store_kafka_handle_t sh = _sh;
+	struct rbn *rbn;
+	sk_topic_t t;
+	while ((rbn = rbt_min(&sh->topic_rbt))) {
+		rbt_del(&sh->topic_rbt, rbn);
+		t = container_of(rbn, struct sk_topic_s, rbn);
+		rd_kafka_topic_destroy(t->rkt);
+		free(t);
+	}
 	if (sh->rk) {
 		rd_kafka_destroy(sh->rk);
 	}
+	ldmsd_row_buf_free(&sh->rbuf);
+	free(sh->msgs);
+	free(sh->msg_off);
 	if (sh->rconf) {
 		rd_kafka_conf_destroy(sh->rconf);
 	}
@@ -338,6 +392,8 @@ static store_kafka_handle_t __handle_new(ldmsd_strgp_t strgp)
 	store_kafka_handle_t sh = calloc(1, sizeof(*sh));
 	if (!sh)
 		goto err_0;
+	rbt_init(&sh->topic_rbt, topic_cmp);
+	sh->encoding = sk_encoding;
 	sh->rconf = rd_kafka_conf_dup(common_rconf);
 	if (!sh->rconf)
 		goto err_1;
@@ -369,16 +425,98 @@ static store_kafka_handle_t __handle_new(ldmsd_strgp_t strgp)
 	return NULL;
 }
 
+/* Get the cached topic for `name`, creating it on the first use */
+static rd_kafka_topic_t *__topic_get(store_kafka_handle_t sh, const char *name)
+{
+	struct rbn *rbn;
+	sk_topic_t t;
+
+	rbn = rbt_find(&sh->topic_rbt, name);
+	if (rbn)
+		return container_of(rbn, struct sk_topic_s, rbn)->rkt;
+	t = malloc(sizeof(*t) + strlen(name) + 1);
+	if (!t)
+		return NULL;
+	strcpy(t->name, name);
+	t->rkt = rd_kafka_topic_new(sh->rk, name, NULL);
+	if (!t->rkt) {
+		free(t);
+		return NULL;
+	}
+	rbn_init(&t->rbn, t->name);
+	rbt_ins(&sh->topic_rbt, &t->rbn);
+	return t->rkt;
+}
+
+static int __msgs_reserve(store_kafka_handle_t sh, int n)
+{
+	rd_kafka_message_t *msgs;
+	size_t *off;
+
+	if (n <= sh->msgs_len)
+		return 0;
+	n = (n + 63) & ~63;
+	msgs = realloc(sh->msgs, n * sizeof(*msgs));
+	if (!msgs)
+		return ENOMEM;
+	sh->msgs = msgs;
+	off = realloc(sh->msg_off, n * sizeof(*off));
+	if (!off)
+		return ENOMEM;
+	sh->msg_off = off;
+	sh->msgs_len = n;
+	return 0;
+}
+
+/*
+ * Produce the `n` messages serialized in sh->rbuf to `schema_name` with a
+ * single rd_kafka_produce_batch(). librdkafka copies the payloads, so the
+ * buffer is ready for reuse when this returns.
+ */
+static void __produce_batch(store_kafka_handle_t sh, const char *schema_name,
+			    int n)
+{
+	rd_kafka_topic_t *rkt;
+	int i, cnt;
+
+	if (!n)
+		return;
+	rkt = __topic_get(sh, schema_name);
+	if (!rkt) {
+		LOG_ERROR("rd_kafka_topic_new(\"%s\") failed, "
+			  "errno: %d\n", schema_name, errno);
+		return;
+	}
+	/* rbuf may have moved while it grew, set the payloads now */
+	memset(sh->msgs, 0, n * sizeof(*sh->msgs));
+	for (i = 0; i < n; i++) {
+		sh->msgs[i].payload = sh->rbuf.buf + sh->msg_off[i];
+		sh->msgs[i].len = ((i + 1 < n) ? sh->msg_off[i + 1]
+					       : sh->rbuf.len) - sh->msg_off[i];
+	}
+	cnt = rd_kafka_produce_batch(rkt, RD_KAFKA_PARTITION_UA,
+				     RD_KAFKA_MSG_F_COPY, sh->msgs, n);
+	if (cnt == n)
+		return;
+	for (i = 0; i < n; i++) {
+		if (!sh->msgs[i].err)
+			continue;
+		LOG_ERROR("rd_kafka_produce_batch(\"%s\") failed, "
+			  "error: %s\n", schema_name,
+			  rd_kafka_err2str(sh->msgs[i].err));
+		break;
+	}
+}
+
 /* protected by strgp->lock */
 static int
 commit_rows(ldmsd_strgp_t strgp, ldms_set_t set, ldmsd_row_list_t row_list,
 	    int row_count)
 {
 	store_kafka_handle_t sh;
-	rd_kafka_topic_t *rkt;
 	ldmsd_row_t row;
-	char *buf;
-	int rc, len;
+	const char *schema_name = NULL;
+	int rc, n = 0;
 
 	sh = strgp->store_handle;
 	if (!sh) {
@@ -388,31 +526,42 @@ commit_rows(ldmsd_strgp_t strgp, ldms_set_t set, ldmsd_row_list_t row_list,
 		strgp->store_handle = sh;
 	}
 
+	rc = __msgs_reserve(sh, row_count);
+	if (rc)
+		return rc;
+
+	/*
+	 * Consecutive rows of the same schema (the "topic") are serialized
+	 * back to back into sh->rbuf and produced as one batch.
+	 */
+	sh->rbuf.len = 0;
 	TAILQ_FOREACH(row, row_list, entry) {
-		rc = ldmsd_row_to_json_object(row, &buf, &len);
-		if (rc) {
-			LOG_ERROR("ldmsd_row_to_json_object() error: %d\n", rc);
-			continue;
+		if (schema_name && strcmp(schema_name, row->schema_name)) {
+			__produce_batch(sh, schema_name, n);
+			sh->rbuf.len = 0;
+			n = 0;
 		}
-
-		/* row schema is the "topic" */
-		rkt = rd_kafka_topic_new(sh->rk, row->schema_name, NULL);
-		if (!rkt) {
-			LOG_ERROR("rd_kafka_topic_new(\"%s\") failed, "
-				  "errno: %d\n", row->schema_name, errno);
-			free(buf);
-			continue;
+		schema_name = row->schema_name;
+		if (n == sh->msgs_len) {
+			/* row_count is short; should not happen */
+			rc = __msgs_reserve(sh, n + 1);
+			if (rc)
+				break;
 		}
-
-		rc = rd_kafka_produce(rkt, RD_KAFKA_PARTITION_UA,
-				RD_KAFKA_MSG_F_FREE, buf, len, NULL, 0, NULL);
+		sh->msg_off[n] = sh->rbuf.len;
+		if (sh->encoding == SK_ENCODING_BINARY)
+			rc = ldmsd_row_to_binary_buf(row, &sh->rbuf);
+		else
+			rc = ldmsd_row_to_json_object_buf(row, &sh->rbuf);
 		if (rc) {
-			LOG_ERROR("rd_kafka_produce(\"%s\") failed, "
-				  "errno: %d\n", row->schema_name, rc);
-			free(buf);
+			LOG_ERROR("row serialization error: %d\n", rc);
+			continue;
 		}
-		rd_kafka_topic_destroy(rkt);
+		n++;
 	}
+	__produce_batch(sh, schema_name, n);
+	/* serve the delivery reports */
+	rd_kafka_poll(sh->rk, 0);
 
 	return 0;
 }
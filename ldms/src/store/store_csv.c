@@ -73,6 +73,7 @@
 #include "ldmsd_plugattr.h"
 #include "store_common.h"
 #include "store_csv_common.h"
+#include "store_csv_rowbuf.h"
 
 #define TV_SEC_COL    0
 #define TV_USEC_COL    1
@@ -171,6 +172,8 @@ struct csv_store_handle {
 	int num_lists; /* Number of list metrics */
 	struct csv_lent *lents;
 	int ref_count; /* number of strgp using the csv file; protected by cfg_lock */
+	int rowbuf; /* format rows in rb and write each with one fwrite() */
+	struct csv_rowbuf rb;
 	CSV_STORE_HANDLE_COMMON;
 };
 
@@ -497,6 +500,19 @@ static int config_handle(struct csv_store_handle *s_handle)
 		return EINVAL;
 	}
 	s_handle->expand_array = r;
+	r = false;
+	cvt = ldmsd_plugattr_bool(pa, "rowbuf", k, &r);
+	if (cvt == -1) {
+		msglog(LDMSD_LERROR, PNAME ": improper rowbuf= input.\n");
+		return EINVAL;
+	}
+	if (r && !s_handle->rb.buf) {
+		if (csv_rowbuf_init(&s_handle->rb, CSV_ROWBUF_INIT_SZ)) {
+			msglog(LDMSD_LCRITICAL, PNAME ": Out of memory\n");
+			return ENOMEM;
+		}
+	}
+	s_handle->rowbuf = r;
 	if (!s_handle->expand_array) {
 		s_handle->array_sep = ':';
 		s_handle->array_lquote = '\"';
@@ -636,6 +652,7 @@ static int config(struct ldmsd_plugin *self, struct attr_value_list *kwl, struct
 		"schema",
 		"path",
 		"userdata",
+		"rowbuf",
 		"rollagain",
 		"rollover",
 		"rolltype",
@@ -803,7 +820,7 @@ static void term(struct ldmsd_plugin *self)
 static const char *usage(struct ldmsd_plugin *self)
 {
 	return  "    config name=store_csv path=<path> rollover=<num> rolltype=<num>\n"
-		"           [altheader=<0/!0> userdata=<0/!0>]\n"
+		"           [altheader=<0/!0> userdata=<0/!0> rowbuf=<0/!0>]\n"
 		"           [buffer=<0/1/N> buffertype=<3/4>]\n"
 		"           [rename_template=<metapath> [rename_uid=<int-uid> [rename_gid=<int-gid]\n"
 		"               rename_perm=<octal-mode>]]\n"
@@ -819,6 +836,7 @@ static const char *usage(struct ldmsd_plugin *self)
 		"                1- Time_msec,Time_usec: <milliseconds since epoch>,<microseconds remainder>\n"
 		FILE_PROPS_USAGE
 		"         - userdata     UserData in printout (optional, default 0)\n"
+		"         - rowbuf    Format each row in memory and write it at once (optional, default 0)\n"
 		"         - metapath A string template for the file rename, where %[BCDPSTs]\n"
 		"           are replaced per the man page Plugin_store_csv.\n"
 		"         - rollover  Greater than or equal to zero; enables file rollover and sets interval\n"
@@ -1462,6 +1480,228 @@ store_time_job_app(struct csv_store_handle *sh, const struct ldms_timestamp *ts,
 	}
 }
 
+/*
+ * The rowbuf write engine. The functions below produce the same text as
+ * store_metric(), store_time_job_app() and store_col(), but format into
+ * sh->rb without going through stdio, and the caller hands the finished
+ * row to the file with a single fwrite().
+ */
+
+/* Append element i (0 for scalars) of an integer, f32 or d64 metric */
+static inline void
+rb_store_value(struct csv_rowbuf *rb, enum ldms_value_type mtype,
+	       ldms_mval_t mval, int i)
+{
+	switch (mtype) {
+	case LDMS_V_U8:
+		csv_rowbuf_u64(rb, mval->v_u8);
+		break;
+	case LDMS_V_U8_ARRAY:
+		csv_rowbuf_u64(rb, mval->a_u8[i]);
+		break;
+	case LDMS_V_S8:
+		csv_rowbuf_s64(rb, mval->v_s8);
+		break;
+	case LDMS_V_S8_ARRAY:
+		csv_rowbuf_s64(rb, mval->a_s8[i]);
+		break;
+	case LDMS_V_U16:
+		csv_rowbuf_u64(rb, mval->v_u16);
+		break;
+	case LDMS_V_U16_ARRAY:
+		csv_rowbuf_u64(rb, mval->a_u16[i]);
+		break;
+	case LDMS_V_S16:
+		csv_rowbuf_s64(rb, mval->v_s16);
+		break;
+	case LDMS_V_S16_ARRAY:
+		csv_rowbuf_s64(rb, mval->a_s16[i]);
+		break;
+	case LDMS_V_U32:
+		csv_rowbuf_u64(rb, mval->v_u32);
+		break;
+	case LDMS_V_U32_ARRAY:
+		csv_rowbuf_u64(rb, mval->a_u32[i]);
+		break;
+	case LDMS_V_S32:
+		csv_rowbuf_s64(rb, mval->v_s32);
+		break;
+	case LDMS_V_S32_ARRAY:
+		csv_rowbuf_s64(rb, mval->a_s32[i]);
+		break;
+	case LDMS_V_U64:
+		csv_rowbuf_u64(rb, mval->v_u64);
+		break;
+	case LDMS_V_U64_ARRAY:
+		csv_rowbuf_u64(rb, mval->a_u64[i]);
+		break;
+	case LDMS_V_S64:
+		csv_rowbuf_s64(rb, mval->v_s64);
+		break;
+	case LDMS_V_S64_ARRAY:
+		csv_rowbuf_s64(rb, mval->a_s64[i]);
+		break;
+	case LDMS_V_F32:
+		csv_rowbuf_g(rb, mval->v_f, 9);
+		break;
+	case LDMS_V_F32_ARRAY:
+		csv_rowbuf_g(rb, mval->a_f[i], 9);
+		break;
+	case LDMS_V_D64:
+		csv_rowbuf_g(rb, mval->v_d, 17);
+		break;
+	case LDMS_V_D64_ARRAY:
+		csv_rowbuf_g(rb, mval->a_d[i], 17);
+		break;
+	default:
+		break;
+	}
+}
+
+static inline void rb_store_udata(struct csv_store_handle *sh, uint64_t udata)
+{
+	if (sh->udata) {
+		csv_rowbuf_char(&sh->rb, ',');
+		csv_rowbuf_u64(&sh->rb, udata);
+	}
+}
+
+static void
+rb_store_metric(struct csv_store_handle *sh, const char *wsqt, uint64_t udata,
+		enum ldms_value_type mtype, size_t count, ldms_mval_t mval)
+{
+	struct csv_rowbuf *rb = &sh->rb;
+	char lquote, sep, rquote;
+	ldms_mval_t v;
+	int i;
+
+	switch (mtype) {
+	case LDMS_V_CHAR_ARRAY:
+		rb_store_udata(sh, udata);
+		/* our csv does not included embedded nuls */
+		csv_rowbuf_char(rb, ',');
+		csv_rowbuf_str(rb, wsqt);
+		csv_rowbuf_str(rb, mval->a_char);
+		csv_rowbuf_str(rb, wsqt);
+		break;
+	case LDMS_V_CHAR:
+		rb_store_udata(sh, udata);
+		csv_rowbuf_char(rb, ',');
+		csv_rowbuf_char(rb, mval->v_char);
+		break;
+	case LDMS_V_U8:
+	case LDMS_V_S8:
+	case LDMS_V_U16:
+	case LDMS_V_S16:
+	case LDMS_V_U32:
+	case LDMS_V_S32:
+	case LDMS_V_U64:
+	case LDMS_V_S64:
+	case LDMS_V_F32:
+	case LDMS_V_D64:
+		rb_store_udata(sh, udata);
+		csv_rowbuf_char(rb, ',');
+		rb_store_value(rb, mtype, mval, 0);
+		break;
+	case LDMS_V_U8_ARRAY:
+	case LDMS_V_S8_ARRAY:
+	case LDMS_V_U16_ARRAY:
+	case LDMS_V_S16_ARRAY:
+	case LDMS_V_U32_ARRAY:
+	case LDMS_V_S32_ARRAY:
+	case LDMS_V_U64_ARRAY:
+	case LDMS_V_S64_ARRAY:
+	case LDMS_V_F32_ARRAY:
+	case LDMS_V_D64_ARRAY:
+		if (sh->expand_array) {
+			for (i = 0; i < count; i++) {
+				rb_store_udata(sh, udata);
+				csv_rowbuf_char(rb, ',');
+				rb_store_value(rb, mtype, mval, i);
+			}
+			break;
+		}
+		rb_store_udata(sh, udata);
+		if (mtype == LDMS_V_S64_ARRAY) {
+			/* store_metric() always quotes s64 arrays this way */
+			lquote = rquote = '"';
+			sep = ',';
+		} else {
+			lquote = sh->array_lquote;
+			rquote = sh->array_rquote;
+			sep = sh->array_sep;
+		}
+		for (i = 0; i < count; i++) {
+			if (i == 0) {
+				csv_rowbuf_char(rb, ',');
+				csv_rowbuf_char(rb, lquote);
+			} else {
+				csv_rowbuf_char(rb, sep);
+			}
+			rb_store_value(rb, mtype, mval, i);
+		}
+		csv_rowbuf_char(rb, rquote);
+		break;
+	case LDMS_V_RECORD_INST:
+		for (i = 0; i < ldms_record_card(mval); i++) {
+			mtype = ldms_record_metric_type_get(mval, i, &count);
+			v = ldms_record_metric_get(mval, i);
+			rb_store_metric(sh, wsqt, udata, mtype, count, v);
+		}
+		break;
+	default:
+		msglog(LDMSD_LERROR, PNAME ": Received unrecognized metric value type %d\n", mtype);
+		/* print no value */
+		if (sh->udata)
+			csv_rowbuf_char(rb, ',');
+		csv_rowbuf_char(rb, ',');
+		break;
+	}
+}
+
+static void
+rb_store_time_job_app(struct csv_store_handle *sh, const struct ldms_timestamp *ts, ldms_set_t set)
+{
+	struct csv_rowbuf *rb = &sh->rb;
+	const char *pname;
+
+	if (sh->time_format == TF_MILLISEC) {
+		csv_rowbuf_u64(rb, ((uint64_t)ts->sec * 1000) + (ts->usec / 1000));
+		csv_rowbuf_char(rb, ',');
+		csv_rowbuf_u64(rb, ts->usec % 1000);
+	} else {
+		csv_rowbuf_u64(rb, ts->sec);
+		csv_rowbuf_char(rb, '.');
+		csv_rowbuf_u64_w(rb, ts->usec, 6);
+		csv_rowbuf_char(rb, ',');
+		csv_rowbuf_u64(rb, ts->usec);
+	}
+	csv_rowbuf_char(rb, ',');
+	pname = ldms_set_producer_name_get(set);
+	if (pname != NULL)
+		csv_rowbuf_str(rb, pname);
+}
+
+/* Write out the row accumulated in sh->rb; caller MUST hold sh->lock */
+static int rb_commit(struct csv_store_handle *sh)
+{
+	ssize_t len;
+
+	csv_rowbuf_char(&sh->rb, '\n');
+	len = csv_rowbuf_write(&sh->rb, sh->file);
+	if (len < 0) {
+		msglog(LDMSD_LERROR, PNAME ": Error %d writing to '%s'\n",
+		       (int)-len, sh->path);
+		return -len;
+	}
+	sh->byte_count += len;
+	return 0;
+}
+
+typedef void (*store_metric_fn_t)(struct csv_store_handle *sh,
+		const char *wsqt, uint64_t udata, enum ldms_value_type mtype,
+		size_t count, ldms_mval_t mval);
+
 static int store(ldmsd_store_handle_t _s_handle, ldms_set_t set, int *metric_array, size_t metric_count)
 {
 	const struct ldms_timestamp _ts = ldms_transaction_timestamp_get(set);
@@ -1552,9 +1792,14 @@ static int store(ldmsd_store_handle_t _s_handle, ldms_set_t set, int *metric_arr
 	size_t count;
 	union ldms_value v;
 	struct csv_lent *lents = s_handle->lents;
+	store_metric_fn_t store_metric_fn = s_handle->rowbuf ?
+					    rb_store_metric : store_metric;
 	do {
 		int lidx = 0;
-		store_time_job_app(s_handle, ts, set);
+		if (s_handle->rowbuf)
+			rb_store_time_job_app(s_handle, ts, set);
+		else
+			store_time_job_app(s_handle, ts, set);
 		for (i = 0; i < metric_count; i++) {
 			mval = ldms_metric_get(set, metric_array[i]);
 			udata = ldms_metric_user_data_get(set, metric_array[i]);
@@ -1594,11 +1839,11 @@ static int store(ldmsd_store_handle_t _s_handle, ldms_set_t set, int *metric_arr
 
 				/* Store list entry index */
 				v.v_u64 = lents[lidx].idx;
-				store_metric(s_handle, wsqt, udata, LDMS_V_U64, 1, &v);
+				store_metric_fn(s_handle, wsqt, udata, LDMS_V_U64, 1, &v);
 
 				assert(lents[lidx].mval);
 				/* Store list entry */
-				store_metric(s_handle, wsqt, udata,
+				store_metric_fn(s_handle, wsqt, udata,
 						lents[lidx].mtype,
 						lents[lidx].count,
 						lents[lidx].mval);
@@ -1609,11 +1854,14 @@ static int store(ldmsd_store_handle_t _s_handle, ldms_set_t set, int *metric_arr
 				} else {
 					count = 1;
 				}
-				store_metric(s_handle, wsqt, udata,
-					     metric_type, count, mval);
+				store_metric_fn(s_handle, wsqt, udata,
+						metric_type, count, mval);
 			}
 		}
-		fprintf(s_handle->file,"\n");
+		if (s_handle->rowbuf)
+			rb_commit(s_handle);
+		else
+			fprintf(s_handle->file,"\n");
 	} while (done < s_handle->num_lists);
 
 	s_handle->store_count++;
@@ -1667,6 +1915,7 @@ static void __csv_handle_close(struct csv_store_handle *s_handle)
 	if (s_handle->headerfile && s_handle->altheader)
 		fclose(s_handle->headerfile);
 	s_handle->headerfile = NULL;
+	csv_rowbuf_free(&s_handle->rb);
 	CLOSE_STORE_COMMON(s_handle);
 
 	idx_delete(store_idx, s_handle->store_key, strlen(s_handle->store_key));
@@ -2179,6 +2428,78 @@ static int store_col(ldms_set_t set, struct csv_store_handle *s_handle,
 	return rc;
 }
 
+/* rowbuf counterpart of store_col(); caller MUST hold s_handle->lock */
+static int rb_store_col(ldms_set_t set, struct csv_store_handle *s_handle,
+			ldmsd_col_t col, int is_first)
+{
+	struct csv_rowbuf *rb = &s_handle->rb;
+	ldms_mval_t v = col->mval;
+	uint64_t udata = 0;
+	int has_udata = 0;
+	int i, n;
+
+	if (col->type > LDMS_V_LAST || !__store_col_fn_tbl[col->type]) {
+		ERR_LOG("Unsupported type %d: %s\n", col->type, ldms_metric_type_to_str(col->type));
+		return EINVAL;
+	}
+
+	if (s_handle->udata && !is_phony_metric_id(col->metric_id)) {
+		/* NOTE: Phony metrics do NOT have udata. */
+		udata = ldms_metric_user_data_get(set, col->metric_id);
+		has_udata = 1;
+	}
+
+	if (ldms_type_is_array(col->type) && col->type != LDMS_V_CHAR_ARRAY)
+		n = col->array_len;
+	else
+		n = 1;
+	for (i = 0; i < n; i++) {
+		if (!is_first || i)
+			csv_rowbuf_char(rb, ',');
+		if (has_udata) {
+			csv_rowbuf_u64(rb, udata);
+			csv_rowbuf_char(rb, ',');
+		}
+		switch (col->type) {
+		case LDMS_V_CHAR:
+			csv_rowbuf_char(rb, v->v_char);
+			break;
+		case LDMS_V_CHAR_ARRAY:
+			if (s_handle->ietfcsv)
+				csv_rowbuf_char(rb, '"');
+			csv_rowbuf_str(rb, v->a_char);
+			if (s_handle->ietfcsv)
+				csv_rowbuf_char(rb, '"');
+			break;
+		case LDMS_V_F32:
+			/* store_col_f() prints scalars with %f */
+			csv_rowbuf_f(rb, v->v_f);
+			break;
+		case LDMS_V_D64:
+			csv_rowbuf_f(rb, v->v_d);
+			break;
+		case LDMS_V_TIMESTAMP:
+			if (s_handle->time_format == TF_MILLISEC) {
+				csv_rowbuf_u64(rb, ((uint64_t)v->v_ts.sec * 1000) +
+						   (v->v_ts.usec / 1000));
+				csv_rowbuf_char(rb, ',');
+				csv_rowbuf_u64(rb, v->v_ts.usec % 1000);
+			} else {
+				csv_rowbuf_u64(rb, v->v_ts.sec);
+				csv_rowbuf_char(rb, '.');
+				csv_rowbuf_u64_w(rb, v->v_ts.usec, 6);
+				csv_rowbuf_char(rb, ',');
+				csv_rowbuf_u64(rb, v->v_ts.usec);
+			}
+			break;
+		default:
+			rb_store_value(rb, col->type, v, i);
+			break;
+		}
+	}
+	return 0;
+}
+
 static int
 store_row(ldmsd_strgp_t strgp, ldms_set_t set, struct csv_store_handle *s_handle, ldmsd_row_t row)
 {
@@ -2213,11 +2534,20 @@ store_row(ldmsd_strgp_t strgp, ldms_set_t set, struct csv_store_handle *s_handle
 
 	for (i = 0; i < row->col_count; i++) {
 		col = &row->cols[i];
-		col_rc = store_col(set, s_handle, col, 0 == i);
+		if (s_handle->rowbuf)
+			col_rc = rb_store_col(set, s_handle, col, 0 == i);
+		else
+			col_rc = store_col(set, s_handle, col, 0 == i);
 		if (col_rc)
 			rc = col_rc;
 	}
-	fprintf(s_handle->file, "\n");
+	if (s_handle->rowbuf) {
+		col_rc = rb_commit(s_handle);
+		if (col_rc)
+			rc = col_rc;
+	} else {
+		fprintf(s_handle->file, "\n");
+	}
 	int doflush = 0;
 	if ((s_handle->buffer_type == 3) &&
 	    ((s_handle->store_count - s_handle->lastflush) >=
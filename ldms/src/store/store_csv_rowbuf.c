@@ -0,0 +1,364 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include "store_csv_rowbuf.h"
+
+#define POW5_MAX 27
+
+static const uint64_t pow5[POW5_MAX + 1] = {
+	1ULL, 5ULL, 25ULL, 125ULL, 625ULL, 3125ULL, 15625ULL, 78125ULL,
+	390625ULL, 1953125ULL, 9765625ULL, 48828125ULL, 244140625ULL,
+	1220703125ULL, 6103515625ULL, 30517578125ULL, 152587890625ULL,
+	762939453125ULL, 3814697265625ULL, 19073486328125ULL,
+	95367431640625ULL, 476837158203125ULL, 2384185791015625ULL,
+	11920928955078125ULL, 59604644775390625ULL, 298023223876953125ULL,
+	1490116119384765625ULL, 7450580596923828125ULL,
+};
+
+static const uint64_t pow10[20] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+	100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+	100000000000000000ULL, 1000000000000000000ULL,
+	10000000000000000000ULL,
+};
+
+static const char digits2[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+int csv_rowbuf_init(struct csv_rowbuf *rb, size_t sz)
+{
+	if (!sz)
+		sz = CSV_ROWBUF_INIT_SZ;
+	rb->buf = malloc(sz);
+	if (!rb->buf)
+		return ENOMEM;
+	rb->sz = sz;
+	rb->len = 0;
+	rb->err = 0;
+	return 0;
+}
+
+void csv_rowbuf_free(struct csv_rowbuf *rb)
+{
+	free(rb->buf);
+	rb->buf = NULL;
+	rb->sz = rb->len = 0;
+}
+
+int __csv_rowbuf_grow(struct csv_rowbuf *rb, size_t n)
+{
+	size_t sz;
+	char *buf;
+
+	if (rb->err)
+		return rb->err;
+	sz = rb->sz ? rb->sz : CSV_ROWBUF_INIT_SZ;
+	while (sz < rb->len + n)
+		sz *= 2;
+	buf = realloc(rb->buf, sz);
+	if (!buf) {
+		rb->err = ENOMEM;
+		return ENOMEM;
+	}
+	rb->buf = buf;
+	rb->sz = sz;
+	return 0;
+}
+
+/* Write the decimal digits of v to the end of tmp; return the start. */
+static inline char *__u64_digits(char *end, uint64_t v)
+{
+	char *p = end;
+	unsigned i;
+	while (v >= 100) {
+		i = (v % 100) * 2;
+		v /= 100;
+		*--p = digits2[i + 1];
+		*--p = digits2[i];
+	}
+	if (v >= 10) {
+		i = v * 2;
+		*--p = digits2[i + 1];
+		*--p = digits2[i];
+	} else {
+		*--p = '0' + v;
+	}
+	return p;
+}
+
+void csv_rowbuf_u64_w(struct csv_rowbuf *rb, uint64_t v, int width)
+{
+	char tmp[24];
+	char *s = __u64_digits(tmp + sizeof(tmp), v);
+	size_t n = tmp + sizeof(tmp) - s;
+	char *p;
+
+	if (width > n) {
+		p = csv_rowbuf_reserve(rb, width);
+		if (!p)
+			return;
+		memset(p, '0', width - n);
+		memcpy(p + width - n, s, n);
+		rb->len += width;
+		return;
+	}
+	csv_rowbuf_mem(rb, s, n);
+}
+
+/*
+ * Express the finite, non-negative \c v exactly as \c n / 10^k with n
+ * fitting in 64 bits. Returns 0 on success, -1 if v has no such form.
+ */
+static int __exact_dec(double v, uint64_t *n, int *k)
+{
+	double t;
+	uint64_t m;
+	int i;
+
+	if (v < 18446744073709551616.0) {
+		m = (uint64_t)v;
+		if ((double)m == v) {
+			*n = m;
+			*k = 0;
+			return 0;
+		}
+	} else {
+		return -1;
+	}
+	/* non-integral; v < 2^53 here, and v * 2^i is exact */
+	for (i = 1; i <= POW5_MAX; i++) {
+		t = ldexp(v, i);
+		if (t == floor(t))
+			break;
+	}
+	if (i > POW5_MAX)
+		return -1;
+	m = (uint64_t)t;
+	if (m > UINT64_MAX / pow5[i])
+		return -1;
+	*n = m * pow5[i];
+	*k = i;
+	return 0;
+}
+
+static void __fmt_g(struct csv_rowbuf *rb, int neg, uint64_t n, int k, int prec)
+{
+	char tmp[24];
+	char *d, *p;
+	int nd, x, i, up;
+	unsigned e;
+
+	if (neg)
+		csv_rowbuf_char(rb, '-');
+	if (!n) {
+		csv_rowbuf_char(rb, '0');
+		return;
+	}
+	d = __u64_digits(tmp + sizeof(tmp), n);
+	nd = tmp + sizeof(tmp) - d;
+	x = nd - 1 - k; /* decimal exponent of the leading digit */
+	while (d[nd - 1] == '0')
+		nd--;
+	if (nd > prec) {
+		/* the value is exact, so ties round to even */
+		up = (d[prec] > '5') ||
+		     (d[prec] == '5' && (nd > prec + 1 || (d[prec-1] & 1)));
+		nd = prec;
+		if (up) {
+			for (i = nd - 1; i >= 0 && d[i] == '9'; i--)
+				d[i] = '0';
+			if (i < 0) {
+				d[0] = '1';
+				x++;
+			} else {
+				d[i]++;
+			}
+		}
+		while (d[nd - 1] == '0')
+			nd--;
+	}
+
+	if (x < -4 || x >= prec) {
+		/* d[.ddd]e[+-]XX */
+		p = csv_rowbuf_reserve(rb, nd + 8);
+		if (!p)
+			return;
+		*p++ = d[0];
+		if (nd > 1) {
+			*p++ = '.';
+			memcpy(p, d + 1, nd - 1);
+			p += nd - 1;
+		}
+		*p++ = 'e';
+		*p++ = x < 0 ? '-' : '+';
+		e = x < 0 ? -x : x;
+		if (e >= 100)
+			*p++ = '0' + e / 100;
+		e %= 100;
+		*p++ = digits2[e * 2];
+		*p++ = digits2[e * 2 + 1];
+		rb->len = p - rb->buf;
+		return;
+	}
+	p = csv_rowbuf_reserve(rb, nd + prec + 8);
+	if (!p)
+		return;
+	if (x >= 0) {
+		if (nd <= x + 1) {
+			memcpy(p, d, nd);
+			memset(p + nd, '0', x + 1 - nd);
+			p += x + 1;
+		} else {
+			memcpy(p, d, x + 1);
+			p += x + 1;
+			*p++ = '.';
+			memcpy(p, d + x + 1, nd - x - 1);
+			p += nd - x - 1;
+		}
+	} else {
+		*p++ = '0';
+		*p++ = '.';
+		memset(p, '0', -x - 1);
+		p += -x - 1;
+		memcpy(p, d, nd);
+		p += nd;
+	}
+	rb->len = p - rb->buf;
+}
+
+void csv_rowbuf_g(struct csv_rowbuf *rb, double v, int prec)
+{
+	uint64_t n;
+	int k, len;
+	char *p;
+	int neg = signbit(v);
+
+	if (isfinite(v) && prec > 0 && prec < 20 &&
+	    0 == __exact_dec(neg ? -v : v, &n, &k)) {
+		__fmt_g(rb, neg, n, k, prec);
+		return;
+	}
+	p = csv_rowbuf_reserve(rb, 32);
+	if (!p)
+		return;
+	len = snprintf(p, 32, "%.*g", prec, v);
+	if (len > 0 && len < 32)
+		rb->len += len;
+}
+
+void csv_rowbuf_f(struct csv_rowbuf *rb, double v)
+{
+	uint64_t n, q, r, half, ip, fp;
+	int k, len;
+	char *p;
+	int neg = signbit(v);
+
+	if (!isfinite(v) || __exact_dec(neg ? -v : v, &n, &k)) {
+		/* %f of a double is at most 317 characters */
+		p = csv_rowbuf_reserve(rb, 320);
+		if (!p)
+			return;
+		len = snprintf(p, 320, "%f", v);
+		if (len > 0 && len < 320)
+			rb->len += len;
+		return;
+	}
+	if (k <= 6) {
+		ip = n / pow10[k];
+		fp = (n % pow10[k]) * pow10[6 - k];
+	} else {
+		if (k - 6 >= 20) {
+			/* n < 2^64 is below half of 10^(k-6) */
+			q = 0;
+		} else {
+			q = n / pow10[k - 6];
+			r = n % pow10[k - 6];
+			half = pow10[k - 6] / 2;
+			if (r > half || (r == half && (q & 1)))
+				q++;
+		}
+		ip = q / 1000000;
+		fp = q % 1000000;
+	}
+	if (neg)
+		csv_rowbuf_char(rb, '-');
+	csv_rowbuf_u64_w(rb, ip, 1);
+	csv_rowbuf_char(rb, '.');
+	csv_rowbuf_u64_w(rb, fp, 6);
+}
+
+ssize_t csv_rowbuf_write(struct csv_rowbuf *rb, FILE *f)
+{
+	ssize_t rc;
+	size_t n;
+
+	if (rb->err) {
+		rc = -rb->err;
+		goto out;
+	}
+	n = fwrite(rb->buf, 1, rb->len, f);
+	if (n != rb->len) {
+		rc = errno ? -errno : -EIO;
+		goto out;
+	}
+	rc = n;
+ out:
+	csv_rowbuf_reset(rb);
+	return rc;
+}
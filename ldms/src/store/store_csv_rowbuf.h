@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Row buffer used by the store_csv "rowbuf" write engine.
+ *
+ * A row is formatted into a per-handle buffer with hand-rolled
+ * number-to-text conversion and handed to the stream with a single
+ * fwrite(). The text produced is identical to the printf() conversions
+ * used by the fprintf() engine (%u/%d, %.9g, %.17g and %f).
+ */
+#ifndef __STORE_CSV_ROWBUF_H__
+#define __STORE_CSV_ROWBUF_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#define CSV_ROWBUF_INIT_SZ 4096
+
+struct csv_rowbuf {
+	char *buf;
+	size_t len;	/* bytes in the current row */
+	size_t sz;	/* allocated size of buf */
+	int err;	/* sticky error; set when the buffer cannot grow */
+};
+
+/**
+ * \brief Initialize \c rb with an initial capacity of \c sz bytes.
+ *
+ * \retval 0 on success.
+ * \retval ENOMEM if the buffer cannot be allocated.
+ */
+int csv_rowbuf_init(struct csv_rowbuf *rb, size_t sz);
+
+/**
+ * \brief Release the memory owned by \c rb.
+ */
+void csv_rowbuf_free(struct csv_rowbuf *rb);
+
+/**
+ * \brief Grow \c rb so that at least \c n more bytes fit.
+ *
+ * On failure \c rb->err is set and further appends are ignored until
+ * the next csv_rowbuf_reset().
+ *
+ * \retval 0 on success.
+ * \retval ENOMEM if the buffer cannot grow.
+ */
+int __csv_rowbuf_grow(struct csv_rowbuf *rb, size_t n);
+
+static inline void csv_rowbuf_reset(struct csv_rowbuf *rb)
+{
+	rb->len = 0;
+	rb->err = 0;
+}
+
+static inline char *csv_rowbuf_reserve(struct csv_rowbuf *rb, size_t n)
+{
+	if (rb->len + n > rb->sz && __csv_rowbuf_grow(rb, n))
+		return NULL;
+	if (rb->err)
+		return NULL;
+	return rb->buf + rb->len;
+}
+
+static inline void csv_rowbuf_mem(struct csv_rowbuf *rb, const void *m, size_t n)
+{
+	char *p = csv_rowbuf_reserve(rb, n);
+	if (!p)
+		return;
+	memcpy(p, m, n);
+	rb->len += n;
+}
+
+static inline void csv_rowbuf_str(struct csv_rowbuf *rb, const char *s)
+{
+	csv_rowbuf_mem(rb, s, strlen(s));
+}
+
+static inline void csv_rowbuf_char(struct csv_rowbuf *rb, char c)
+{
+	char *p = csv_rowbuf_reserve(rb, 1);
+	if (!p)
+		return;
+	*p = c;
+	rb->len++;
+}
+
+/**
+ * \brief Append \c v in decimal, zero-padded to at least \c width digits.
+ *
+ * Equivalent to printf("%0*" PRIu64, width, v).
+ */
+void csv_rowbuf_u64_w(struct csv_rowbuf *rb, uint64_t v, int width);
+
+/** \brief Append \c v as printf("%" PRIu64) would. */
+static inline void csv_rowbuf_u64(struct csv_rowbuf *rb, uint64_t v)
+{
+	csv_rowbuf_u64_w(rb, v, 1);
+}
+
+/** \brief Append \c v as printf("%" PRId64) would. */
+static inline void csv_rowbuf_s64(struct csv_rowbuf *rb, int64_t v)
+{
+	if (v < 0) {
+		csv_rowbuf_char(rb, '-');
+		csv_rowbuf_u64_w(rb, -(uint64_t)v, 1);
+	} else {
+		csv_rowbuf_u64_w(rb, v, 1);
+	}
+}
+
+/**
+ * \brief Append \c v as printf("%.*g", prec, v) would.
+ *
+ * Integers and values that are exact short decimal fractions are
+ * converted directly. Anything else (values needing more than 64 bits
+ * of exact decimal mantissa, inf and nan) falls back to snprintf() into
+ * the row buffer so that the text is always identical.
+ */
+void csv_rowbuf_g(struct csv_rowbuf *rb, double v, int prec);
+
+/** \brief Append \c v as printf("%f", v) would. */
+void csv_rowbuf_f(struct csv_rowbuf *rb, double v);
+
+/**
+ * \brief Write the current row to \c f with a single fwrite() and reset
+ * the buffer.
+ *
+ * \retval >=0 the number of bytes written.
+ * \retval <0  a negative errno on failure; the row is discarded.
+ */
+ssize_t csv_rowbuf_write(struct csv_rowbuf *rb, FILE *f);
+
+#endif
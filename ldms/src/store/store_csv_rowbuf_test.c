@@ -0,0 +1,301 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Conformance check and benchmark for the store_csv row buffer.
+ *
+ * The conformance pass compares every csv_rowbuf conversion against
+ * snprintf() with the format the fprintf() engine uses. The benchmark
+ * then formats the same synthetic rows with both engines and reports
+ * rows/sec for each.
+ *
+ * usage: store_csv_rowbuf_test [-n <rows>] [-m <metrics>] [-o <file>]
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include "store_csv_rowbuf.h"
+
+static int nfail;
+
+static void check(struct csv_rowbuf *rb, const char *exp, const char *what)
+{
+	if (rb->len != strlen(exp) || memcmp(rb->buf, exp, rb->len)) {
+		if (nfail < 20)
+			printf("MISMATCH %s: expected '%s', got '%.*s'\n",
+			       what, exp, (int)rb->len, rb->buf);
+		nfail++;
+	}
+	csv_rowbuf_reset(rb);
+}
+
+static double rand_double(int i)
+{
+	uint64_t bits;
+	double d;
+
+	switch (i % 6) {
+	case 0: /* integral */
+		return (double)(int64_t)(random() - RAND_MAX/2);
+	case 1: /* short dyadic fraction */
+		return ldexp((double)(random() % 100000), -(int)(random() % 20));
+	case 2: /* short decimal fraction */
+		return (random() % 1000000) / 1000.0;
+	case 3: /* large or tiny magnitude */
+		return ldexp((double)random(), (int)(random() % 200) - 100);
+	case 4: /* ties for %.9g and %f */
+		return (random() % 100000) + 0.5 + (random() % 2) * 1e-7;
+	default: /* arbitrary bit patterns */
+		bits = ((uint64_t)random() << 33) ^ ((uint64_t)random() << 11) ^ random();
+		memcpy(&d, &bits, sizeof(d));
+		return d;
+	}
+}
+
+static void conformance(int iter)
+{
+	static const double special[] = {
+		0.0, -0.0, 1.0, -1.0, 0.5, 0.1, 1e-5, 1e-4, 123456789.0,
+		1234567890.0, 999999999.5, 0.00012345, 1e15, 1e16, 1e17,
+		9.5, 10.5, 2.5e-7, 18446744073709549568.0, 1e300, -1e-300,
+		INFINITY, -INFINITY, NAN,
+	};
+	struct csv_rowbuf rb;
+	char exp[512];
+	uint64_t u;
+	int64_t s;
+	double d;
+	float f;
+	int i, w;
+
+	csv_rowbuf_init(&rb, 16);
+	for (i = 0; i < iter; i++) {
+		u = ((uint64_t)random() << 32) ^ random();
+		u >>= random() % 64;
+		snprintf(exp, sizeof(exp), "%" PRIu64, u);
+		csv_rowbuf_u64(&rb, u);
+		check(&rb, exp, "u64");
+		s = (int64_t)u * (i & 1 ? -1 : 1);
+		snprintf(exp, sizeof(exp), "%" PRId64, s);
+		csv_rowbuf_s64(&rb, s);
+		check(&rb, exp, "s64");
+		w = random() % 8;
+		snprintf(exp, sizeof(exp), "%0*" PRIu64, w, u % 1000000);
+		csv_rowbuf_u64_w(&rb, u % 1000000, w);
+		check(&rb, exp, "u64_w");
+	}
+	for (i = 0; i < iter + sizeof(special)/sizeof(special[0]); i++) {
+		d = i < iter ? rand_double(i) : special[i - iter];
+		f = d;
+		snprintf(exp, sizeof(exp), "%.17g", d);
+		csv_rowbuf_g(&rb, d, 17);
+		check(&rb, exp, "%.17g");
+		snprintf(exp, sizeof(exp), "%.9g", f);
+		csv_rowbuf_g(&rb, f, 9);
+		check(&rb, exp, "%.9g");
+		snprintf(exp, sizeof(exp), "%f", d);
+		csv_rowbuf_f(&rb, d);
+		check(&rb, exp, "%f");
+		snprintf(exp, sizeof(exp), "%f", f);
+		csv_rowbuf_f(&rb, f);
+		check(&rb, exp, "%f (float)");
+	}
+	csv_rowbuf_free(&rb);
+}
+
+struct row {
+	uint32_t sec, usec;
+	const char *producer;
+	int m;
+	uint64_t *u64;
+	double *d;
+};
+
+static int fprintf_row(FILE *f, struct row *r)
+{
+	int i, rc, n;
+	n = fprintf(f, "%" PRIu32 ".%06" PRIu32 ",%" PRIu32 ",%s",
+		    r->sec, r->usec, r->usec, r->producer);
+	for (i = 0; i < r->m; i++) {
+		rc = fprintf(f, ",%" PRIu64, r->u64[i]);
+		if (rc < 0)
+			return rc;
+		n += rc;
+		rc = fprintf(f, ",%.17g", r->d[i]);
+		if (rc < 0)
+			return rc;
+		n += rc;
+	}
+	fprintf(f, "\n");
+	return n + 1;
+}
+
+static int rowbuf_row(FILE *f, struct csv_rowbuf *rb, struct row *r)
+{
+	int i;
+	csv_rowbuf_u64(rb, r->sec);
+	csv_rowbuf_char(rb, '.');
+	csv_rowbuf_u64_w(rb, r->usec, 6);
+	csv_rowbuf_char(rb, ',');
+	csv_rowbuf_u64(rb, r->usec);
+	csv_rowbuf_char(rb, ',');
+	csv_rowbuf_str(rb, r->producer);
+	for (i = 0; i < r->m; i++) {
+		csv_rowbuf_char(rb, ',');
+		csv_rowbuf_u64(rb, r->u64[i]);
+		csv_rowbuf_char(rb, ',');
+		csv_rowbuf_g(rb, r->d[i], 17);
+	}
+	csv_rowbuf_char(rb, '\n');
+	return csv_rowbuf_write(rb, f);
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *argv0)
+{
+	printf("usage: %s [-n <rows>] [-m <metrics>] [-o <file>]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = "/dev/null";
+	struct csv_rowbuf rb;
+	struct row r = {0};
+	int nrows = 200000;
+	int op, i, j, rc;
+	double t0, t_fprintf, t_rowbuf;
+	FILE *f;
+
+	while ((op = getopt(argc, argv, "n:m:o:h")) != -1) {
+		switch (op) {
+		case 'n':
+			nrows = atoi(optarg);
+			break;
+		case 'm':
+			r.m = atoi(optarg);
+			break;
+		case 'o':
+			path = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return op == 'h' ? 0 : EINVAL;
+		}
+	}
+	if (!r.m)
+		r.m = 64;
+
+	srandom(1);
+	conformance(200000);
+	if (nfail) {
+		printf("conformance: %d mismatches\n", nfail);
+		return 1;
+	}
+	printf("conformance: ok\n");
+
+	r.producer = "node0001";
+	r.u64 = calloc(r.m, sizeof(*r.u64));
+	r.d = calloc(r.m, sizeof(*r.d));
+	if (!r.u64 || !r.d)
+		return ENOMEM;
+	rc = csv_rowbuf_init(&rb, 0);
+	if (rc)
+		return rc;
+	f = fopen(path, "w");
+	if (!f) {
+		printf("cannot open '%s': %d\n", path, errno);
+		return errno;
+	}
+
+	/* counters, gauges and the occasional non-integral value */
+	for (j = 0; j < r.m; j++) {
+		r.u64[j] = ((uint64_t)random() << 16) ^ random();
+		r.d[j] = (j % 4) ? (double)(random() % 100000) : random() / 1024.0;
+	}
+
+	t0 = now();
+	for (i = 0; i < nrows; i++) {
+		r.sec = 1700000000 + i;
+		r.usec = i % 1000000;
+		r.u64[i % r.m] += i;
+		if (fprintf_row(f, &r) < 0)
+			return EIO;
+	}
+	fflush(f);
+	t_fprintf = now() - t0;
+
+	t0 = now();
+	for (i = 0; i < nrows; i++) {
+		r.sec = 1700000000 + i;
+		r.usec = i % 1000000;
+		r.u64[i % r.m] += i;
+		if (rowbuf_row(f, &rb, &r) < 0)
+			return EIO;
+	}
+	fflush(f);
+	t_rowbuf = now() - t0;
+
+	printf("rows: %d, metrics/row: %d\n", nrows, 2 * r.m);
+	printf("fprintf: %12.0f rows/sec\n", nrows / t_fprintf);
+	printf("rowbuf:  %12.0f rows/sec (%.2fx)\n", nrows / t_rowbuf,
+	       t_fprintf / t_rowbuf);
+
+	fclose(f);
+	csv_rowbuf_free(&rb);
+	free(r.u64);
+	free(r.d);
+	return 0;
+}
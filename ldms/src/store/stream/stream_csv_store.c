@@ -167,6 +167,10 @@ static cfg_state cfgstate = CFG_PRE;
 /* Well known: written order will be singletonkeys followed by listentry keys */
 struct linedata {
 	int nsingleton;
+	/*
+	 * followed by listkey, if any, so that the values of a message
+	 * can be extracted with one json_token_find()
+	 */
 	char **singletonkey;
 	int nlist;
 	char *listkey; /* will have at most one list; */
@@ -179,6 +183,7 @@ struct linedata {
 	int nkey;
 	int nheaderkey; /* number of keys in the header */
 	char *header;
+	struct json_token_s *tok; /* values of the message being stored */
 };
 
 struct csv_stream_handle {
@@ -235,6 +240,8 @@ static void _clear_key_info(struct linedata *dataline)
 	dataline->nheaderkey = 0;
 	free(dataline->header);
 	dataline->header = NULL;
+	free(dataline->tok);
+	dataline->tok = NULL;
 }
 
 static void close_streamstore(void *obj, void *cb_arg)
@@ -417,8 +424,8 @@ static int _get_header_from_data(struct linedata *dataline, json_entity_t e)
 
 	dataline->nsingleton = isingleton;
 	dataline->nlist = ilist;
-	dataline->singletonkey = (char**) calloc(dataline->nsingleton, sizeof(char*));
-	if (dataline->nsingleton && !dataline->singletonkey) {
+	dataline->singletonkey = (char**) calloc(dataline->nsingleton + 1, sizeof(char*));
+	if (!dataline->singletonkey) {
 		rc = ENOMEM;
 		goto err;
 	}
@@ -462,7 +469,16 @@ static int _get_header_from_data(struct linedata *dataline, json_entity_t e)
 		i++;
 	}
 
+	dataline->singletonkey[dataline->nsingleton] = dataline->listkey;
 	dataline->nheaderkey = dataline->nsingleton + dataline->ndict;
+	i = dataline->nsingleton + dataline->nlist;
+	if (i < dataline->ndict)
+		i = dataline->ndict;
+	dataline->tok = calloc(i, sizeof(*dataline->tok));
+	if (!dataline->tok) {
+		rc = ENOMEM;
+		goto err;
+	}
 
 	/*
 	 * order will be order of singletons and order of dict.
@@ -505,33 +521,33 @@ err:
 	return rc;
 }
 
-static int _append_singleton(json_entity_t en, jbuf_t jb)
+static int _append_singleton(json_token_t tok, jbuf_t *jb)
 {
 
-	switch (en->type) {
+	switch (tok->type) {
 	case JSON_INT_VALUE:
-		jb = jbuf_append_str(jb, "%ld", en->value.int_);
+		*jb = jbuf_append_str(*jb, "%ld", json_token_int(tok));
 		break;
 	case JSON_BOOL_VALUE:
-		if (en->value.bool_)
-			jb = jbuf_append_str(jb, "true");
+		if (json_token_bool(tok))
+			*jb = jbuf_append_str(*jb, "true");
 		else
-			jb = jbuf_append_str(jb, "false");
+			*jb = jbuf_append_str(*jb, "false");
 		break;
 	case JSON_FLOAT_VALUE:
-		jb = jbuf_append_str(jb, "%f", en->value.double_);
+		*jb = jbuf_append_str(*jb, "%f", json_token_float(tok));
 		break;
 	case JSON_STRING_VALUE:
-		jb = jbuf_append_str(jb, "\"%s\"", en->value.str_->str);
+		*jb = jbuf_append_str(*jb, "\"%.*s\"", (int)tok->len, tok->str);
 		break;
 	case JSON_NULL_VALUE:
-		jb = jbuf_append_str(jb, "null");
+		*jb = jbuf_append_str(*jb, "null");
 		break;
 	default:
 		/* this should not happen */
 		msglog(LDMSD_LDEBUG,
 				PNAME, ": cannot process JSON type '%s' "
-				"as singleton\n", json_type_name(en->type));
+				"as singleton\n", json_type_name(tok->type));
 		return -1;
 		break;
 	}
@@ -556,11 +572,11 @@ static int _print_header(struct csv_stream_handle *stream_handle)
 }
 
 static int _print_data_lines(struct csv_stream_handle *stream_handle,
-				struct timeval *tv_prev, json_entity_t e)
+				struct timeval *tv_prev, json_token_t e)
 {
 	/* well known order */
 
-	json_entity_t en, li;
+	struct json_token_s en, li;
 	jbuf_t jbs, jb;
 	int iheaderkey;
 	int i;
@@ -577,17 +593,28 @@ static int _print_data_lines(struct csv_stream_handle *stream_handle,
 
 	struct linedata *dataline = &stream_handle->dataline;
 
+	/* the singletons and the list in one pass over the message */
+	rc = json_token_find(e, dataline->nsingleton + dataline->nlist,
+			(const char * const *)dataline->singletonkey,
+			dataline->tok);
+	if (rc) {
+		msglog(LDMSD_LERROR, PNAME ": malformed message. "
+						"skipping this data.\n");
+		return rc;
+	}
+	if (dataline->nlist)
+		en = dataline->tok[dataline->nsingleton];
+
 	iheaderkey = 0;
 
 	jbs = NULL;
 	jbs = jbuf_new();
 	if (dataline->nsingleton > 0) {
 		for (i = 0; i < dataline->nsingleton; i++) {
-			en = json_value_find(e, dataline->singletonkey[i]);
-			if (en == NULL) {
+			if (dataline->tok[i].str == NULL) {
 				/* this may or may not be ok.... */
 			} else {
-				rc = _append_singleton(en, jbs);
+				rc = _append_singleton(&dataline->tok[i], &jbs);
 				if (rc) {
 					msglog(LDMSD_LDEBUG,
 						PNAME ": Cannot print data because "
@@ -628,9 +655,8 @@ static int _print_data_lines(struct csv_stream_handle *stream_handle,
 	}
 
 	/* if header has a list..... */
-	en = json_value_find(e, dataline->listkey);
 	/* if data has no list */
-	if (en == NULL) {
+	if (en.str == NULL) {
 		msglog(LDMSD_LDEBUG, PNAME ": no match for %s\n", dataline->listkey);
 		/* write out just the singleton line and empty vals for the dict items */
 		for (i = 0; i < dataline->ndict - 1; i++) {
@@ -650,11 +676,11 @@ static int _print_data_lines(struct csv_stream_handle *stream_handle,
 	}
 
 	/* if we got the val, but its not a list */
-	if (en->type != JSON_LIST_VALUE) {
+	if (en.type != JSON_LIST_VALUE) {
 		msglog(LDMSD_LERROR, PNAME ": %s is not a LIST type %s. "
 						"skipping this data.\n",
 						dataline->listkey,
-						json_type_name(en->type));
+						json_type_name(en.type));
 		/*
 		 * NOTE: this is bad. currently writing out nothing,
 		 * but could change this later.
@@ -664,7 +690,9 @@ static int _print_data_lines(struct csv_stream_handle *stream_handle,
 	}
 
 	/* if there are no dicts */
-	if (json_item_first(en) == NULL) {
+	li.str = NULL;
+	rc = json_token_item_next(&en, &li);
+	if (rc == ENOENT) {
 		for (i = 0; i < dataline->ndict - 1; i++) {
 			jbs = jbuf_append_str(jbs, ",");
 		}
@@ -682,13 +710,16 @@ static int _print_data_lines(struct csv_stream_handle *stream_handle,
 	}
 
 	/* if there are dicts */
-	for (li = json_item_first(en); li; li = json_item_next(li)) {
-		if (li->type != JSON_DICT_VALUE) {
+	for (; rc == 0; rc = json_token_item_next(&en, &li)) {
+		if (li.type != JSON_DICT_VALUE ||
+		    json_token_find(&li, dataline->ndict,
+				(const char * const *)dataline->dictkey,
+				dataline->tok)) {
 			msglog(LDMSD_LERROR,
 					PNAME ": LIST %s has innards that are not "
 					"a DICT type %s. skipping this data.\n",
 					dataline->listkey,
-					json_type_name(li->type));
+					json_type_name(li.type));
 			/* no output */
 			jbuf_free(jbs);
 			return -1;
@@ -698,14 +729,13 @@ static int _print_data_lines(struct csv_stream_handle *stream_handle,
 		jb = jbuf_new();
 		jb = jbuf_append_str(jb, "%s", jbs->buf);
 		for (i = 0; i < dataline->ndict; i++) {
-			json_entity_t edict = json_value_find(li, dataline->dictkey[i]);
-			if (edict == NULL) {
+			if (dataline->tok[i].str == NULL) {
 				msglog(LDMSD_LDEBUG,
 						PNAME ": NULL return from find for "
 						"key <%s>\n", dataline->dictkey[i]);
 				/* print nothing */
 			} else {
-				rc = _append_singleton(edict, jb);
+				rc = _append_singleton(&dataline->tok[i], &jb);
 				if (rc) {
 					msglog(LDMSD_LDEBUG,
 						PNAME ": Cannot print data because "
@@ -747,6 +777,9 @@ static int stream_cb(ldmsd_stream_client_t c, void *ctxt,
 {
 
 	struct csv_stream_handle *stream_handle;
+	struct json_token_s tok;
+	json_parser_t parser;
+	json_entity_t entity;
 	struct timeval tv_prev;
 	int gottime = 0;
 	int rc = 0;
@@ -817,8 +850,8 @@ static int stream_cb(ldmsd_stream_client_t c, void *ctxt,
 	}
 
 	/*
-	 * msg will be populated. if the type was json,
-	 * entity will also be populated.
+	 * msg will be populated. the client is raw, so json is not
+	 * parsed for us; the values are extracted from msg.
 	 */
 
 	if (stream_type == LDMSD_STREAM_STRING) {
@@ -842,21 +875,34 @@ static int stream_cb(ldmsd_stream_client_t c, void *ctxt,
 			fsync(fileno(stream_handle->file));
 		}
 	} else if (stream_type == LDMSD_STREAM_JSON) {
-		if (!e) {
-			msglog(LDMSD_LERROR, PNAME ": why is entity NULL?\n");
-			rc = EINVAL;
+		rc = json_token_parse(msg, msg_len, &tok);
+		if (rc) {
+			msglog(LDMSD_LERROR, PNAME ": cannot parse message\n");
 			goto out;
 		}
 
-		if (e->type != JSON_DICT_VALUE) {
+		if (tok.type != JSON_DICT_VALUE) {
 			msglog(LDMSD_LERROR, PNAME ": Expected a dict object, "
-					"not a %s.\n", json_type_name(e->type));
+					"not a %s.\n", json_type_name(tok.type));
 			rc = EINVAL;
 			goto out;
 		}
 
 		if (!stream_handle->dataline.header) {
-			rc = _get_header_from_data(&stream_handle->dataline, e);
+			/* only the header needs the whole message parsed */
+			parser = json_parser_new(0);
+			if (!parser) {
+				rc = ENOMEM;
+				goto out;
+			}
+			rc = json_parse_buffer_arena(parser, msg, msg_len, &entity);
+			json_parser_free(parser);
+			if (rc) {
+				msglog(LDMSD_LERROR, PNAME ": cannot parse message\n");
+				goto out;
+			}
+			rc = _get_header_from_data(&stream_handle->dataline, entity);
+			json_entity_free(entity);
 			if (rc != 0) {
 				msglog(LDMSD_LDEBUG, PNAME ": error getting header "
 							"from data <%d>\n", rc);
@@ -869,7 +915,7 @@ static int stream_cb(ldmsd_stream_client_t c, void *ctxt,
 			_print_header(stream_handle);
 		}
 
-		_print_data_lines(stream_handle, &tv_prev, e);
+		_print_data_lines(stream_handle, &tv_prev, &tok);
 
 		if (!buffer) {
 			fflush(stream_handle->file);
@@ -969,6 +1015,9 @@ static int open_streamstore(char *stream)
 	msglog(LDMSD_LDEBUG, PNAME ": subscribing to stream '%s'\n", stream);
 	stream_handle->client = ldmsd_stream_subscribe(stream, stream_cb,
 								stream_handle);
+	/* stream_cb() extracts the values it needs without the parse */
+	if (stream_handle->client)
+		ldmsd_stream_flags_set(stream_handle->client, LDMSD_STREAM_F_RAW);
 	idx_add(stream_idx, (void*) stream, strlen(stream), stream_handle);
 	pthread_mutex_unlock(&stream_handle->lock);
 
@@ -0,0 +1,738 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Directory benchmark.
+ *
+ * A forked server process publishes <sets> sets with two set info
+ * pairs each. The client then reports the time, the server CPU time and
+ * the loopback bytes of
+ *
+ * json   - ldms_xprt_dir() with the JSON encoding (LDMS_DIR_JSON set),
+ * binary - ldms_xprt_dir() with the binary encoding,
+ * cached - ldms_xprt_dir_cached() on a new connection each round, after
+ *          the server has removed, added and changed the set info of
+ *          <changes> sets.
+ *
+ * Every directory is checked against the first JSON one, and each cached
+ * one against a binary ldms_xprt_dir() of the same connection.
+ *
+ * Then a connection with LDMS_DIR_F_NOTIFY must be told of exactly the
+ * sets the server deleted (LDMS_XPRT_EVENT_SET_DELETE), added
+ * (LDMS_DIR_ADD) and changed the set info of (LDMS_DIR_UPD) in one more
+ * round of changes.
+ *
+ * Finally a cache that has received a pushed LDMS_DIR_ADD after the
+ * server unpublished a set is checked on a new connection, the
+ * unpublished set must not remain in it.
+ *
+ * usage: test_ldms_dir [-x <xprt>] [-p <port>] [-s <sets>]
+ *                      [-c <changes>] [-r <rounds>]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <semaphore.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include "ldms.h"
+
+#define SCHEMA_NAME "dir_schema"
+#define SET_FMT "node%06d/dir"
+
+static char *xprt = "sock";
+static char *port = "10603";
+static int num_sets = 10000;
+static int num_changes = 10;
+static int num_rounds = 20;
+
+static pid_t pid;
+static int pipe_fd[2];
+static sem_t sem;
+static volatile int change;
+static volatile int unpub;
+/* The client's copy of the server's first published set */
+static int srv_first;
+
+/* The result of a directory request */
+static int dir_rc;
+static int dir_sets;
+static int dir_callbacks;
+static uint64_t dir_sum;
+
+static void _log(const char *fmt, ...)
+{
+	va_list l;
+	va_start(l, fmt);
+	vprintf(fmt, l);
+	va_end(l);
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Bytes received on the loopback interface */
+static uint64_t lo_bytes(void)
+{
+	char line[512];
+	uint64_t bytes = 0;
+	FILE *f = fopen("/proc/net/dev", "r");
+
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (1 == sscanf(line, " lo: %" SCNu64, &bytes))
+			break;
+	}
+	fclose(f);
+	return bytes;
+}
+
+/* CPU time of the server process in seconds */
+static double server_cpu(void)
+{
+	char path[64], buf[1024], *p;
+	unsigned long utime, stime;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	f = fopen(path, "r");
+	if (!f)
+		return 0;
+	p = fgets(buf, sizeof(buf), f);
+	fclose(f);
+	if (!p)
+		return 0;
+	p = strrchr(buf, ')');
+	if (!p || 2 != sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u "
+			      "%*u %*u %lu %lu", &utime, &stime))
+		return 0;
+	return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static void change_handler(int sig)
+{
+	change = 1;
+}
+
+static void unpub_handler(int sig)
+{
+	unpub = 1;
+}
+
+static void server(void)
+{
+	ldms_schema_t schema;
+	ldms_set_t *sets;
+	ldms_t x;
+	char name[64], value[64];
+	int i, j, first = 0, last, gen = 0, rc;
+
+	signal(SIGUSR1, change_handler);
+	signal(SIGUSR2, unpub_handler);
+	x = ldms_xprt_new(xprt, _log);
+	if (!x) {
+		printf("server: ldms_xprt_new error %d\n", errno);
+		exit(1);
+	}
+	rc = ldms_xprt_listen_by_name(x, "0.0.0.0", port, NULL, NULL);
+	if (rc) {
+		printf("server: listen error %d\n", rc);
+		exit(1);
+	}
+	schema = ldms_schema_new(SCHEMA_NAME);
+	for (j = 0; j < 4; j++) {
+		snprintf(name, sizeof(name), "metric_%d", j);
+		ldms_schema_metric_add(schema, name, LDMS_V_U64);
+	}
+	/* Sets first to last - 1 are published */
+	last = num_sets + num_changes * (num_rounds + 2) + 1;
+	sets = calloc(last, sizeof(*sets));
+	for (i = 0; i < last; i++) {
+		snprintf(name, sizeof(name), SET_FMT, i);
+		sets[i] = ldms_set_new(name, schema);
+		if (!sets[i]) {
+			printf("server: ldms_set_new error %d\n", errno);
+			exit(1);
+		}
+		ldms_set_info_set(sets[i], "updt_hint_us", "1000000:0");
+		snprintf(value, sizeof(value), "%d", i);
+		ldms_set_info_set(sets[i], "gen", value);
+	}
+	last = num_sets;
+	for (i = 0; i < last; i++)
+		ldms_set_publish(sets[i]);
+	while (1) {
+		if (unpub) {
+			/* The removal is not pushed, the publish is */
+			unpub = 0;
+			ldms_set_unpublish(sets[first]);
+			first++;
+			ldms_set_publish(sets[last]);
+			last++;
+			if (write(pipe_fd[1], &gen, sizeof(gen)) != sizeof(gen))
+				exit(1);
+			continue;
+		}
+		if (!change) {
+			usleep(1000);
+			continue;
+		}
+		change = 0;
+		gen++;
+		for (i = 0; i < num_changes; i++) {
+			ldms_set_delete(sets[first]);
+			first++;
+			ldms_set_publish(sets[last]);
+			last++;
+			snprintf(value, sizeof(value), "%d.%d",
+				 first + num_changes + i, gen);
+			ldms_set_info_set(sets[first + num_changes + i],
+					  "gen", value);
+		}
+		if (write(pipe_fd[1], &gen, sizeof(gen)) != sizeof(gen))
+			exit(1);
+	}
+}
+
+static uint64_t fnv(uint64_t h, const void *p, size_t len)
+{
+	const unsigned char *c = p;
+	while (len--) {
+		h ^= *c++;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/* A hash of the set that does not depend on the order of the sets */
+static uint64_t dir_set_hash(ldms_dir_set_t d)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	uint64_t num[] = { d->meta_size, d->data_size, d->heap_size, d->uid,
+			   d->gid, d->card, d->array_card, d->meta_gn,
+			   d->data_gn, d->info_count };
+	int i;
+
+	h = fnv(h, d->inst_name, strlen(d->inst_name));
+	h = fnv(h, d->schema_name, strlen(d->schema_name));
+	h = fnv(h, d->digest_str, strlen(d->digest_str));
+	h = fnv(h, d->perm, strlen(d->perm));
+	h = fnv(h, num, sizeof(num));
+	for (i = 0; i < d->info_count; i++) {
+		h = fnv(h, d->info[i].key, strlen(d->info[i].key) + 1);
+		h = fnv(h, d->info[i].value, strlen(d->info[i].value) + 1);
+	}
+	return h;
+}
+
+static void dir_cb(ldms_t x, int status, ldms_dir_t dir, void *arg)
+{
+	int i;
+
+	if (status) {
+		dir_rc = status;
+		sem_post(&sem);
+		return;
+	}
+	dir_callbacks++;
+	dir_sets += dir->set_count;
+	for (i = 0; i < dir->set_count; i++)
+		dir_sum += dir_set_hash(&dir->set_data[i]);
+	if (!dir->more)
+		sem_post(&sem);
+	ldms_xprt_dir_free(x, dir);
+}
+
+/* The pushed directory changes, by kind */
+enum { PUSH_DEL, PUSH_ADD, PUSH_UPD, PUSH_LAST };
+static int push_count[PUSH_LAST];
+static uint64_t push_sum[PUSH_LAST];
+
+static uint64_t name_hash(const char *name)
+{
+	return fnv(0xcbf29ce484222325ULL, name, strlen(name));
+}
+
+static void push_record(int kind, const char *name)
+{
+	__sync_add_and_fetch(&push_sum[kind], name_hash(name));
+	__sync_add_and_fetch(&push_count[kind], 1);
+}
+
+static void connect_cb(ldms_t x, ldms_xprt_event_t e, void *arg)
+{
+	switch (e->type) {
+	case LDMS_XPRT_EVENT_CONNECTED:
+	case LDMS_XPRT_EVENT_REJECTED:
+	case LDMS_XPRT_EVENT_ERROR:
+		*(int *)arg = e->type;
+		sem_post(&sem);
+		break;
+	case LDMS_XPRT_EVENT_SET_DELETE:
+		push_record(PUSH_DEL, e->set_delete.name);
+		break;
+	default:
+		break;
+	}
+}
+
+static ldms_t connect_server(int json)
+{
+	ldms_t x;
+	int i, rc, ev = -1;
+
+	if (json)
+		setenv("LDMS_DIR_JSON", "1", 1);
+	for (i = 0; i < 50; i++) {
+		x = ldms_xprt_new(xprt, _log);
+		if (!x) {
+			printf("ldms_xprt_new error %d\n", errno);
+			break;
+		}
+		rc = ldms_xprt_connect_by_name(x, "localhost", port,
+					       connect_cb, &ev);
+		if (!rc) {
+			sem_wait(&sem);
+			if (ev == LDMS_XPRT_EVENT_CONNECTED)
+				break;
+		}
+		ldms_xprt_put(x);
+		x = NULL;
+		usleep(100000);
+	}
+	unsetenv("LDMS_DIR_JSON");
+	return x;
+}
+
+/* Request the directory and wait for it */
+static int dir(ldms_t x, ldms_dir_cache_t c)
+{
+	int rc;
+
+	dir_rc = dir_sets = dir_callbacks = 0;
+	dir_sum = 0;
+	if (c)
+		rc = ldms_xprt_dir_cached(x, c, dir_cb, NULL, 0);
+	else
+		rc = ldms_xprt_dir(x, dir_cb, NULL, 0);
+	if (rc)
+		return rc;
+	sem_wait(&sem);
+	return dir_rc;
+}
+
+static void report(const char *name, int rounds, double t, double cpu,
+		   uint64_t bytes)
+{
+	printf("%-8s %10.3f ms/dir %10.3f ms server CPU/dir %12.0f bytes/dir\n",
+	       name, t * 1000 / rounds, cpu * 1000 / rounds,
+	       (double)bytes / rounds);
+}
+
+static int run(ldms_t x, const char *name, uint64_t expect_sum)
+{
+	double t, cpu;
+	uint64_t b;
+	int r, rc;
+
+	t = now_sec();
+	cpu = server_cpu();
+	b = lo_bytes();
+	for (r = 0; r < num_rounds; r++) {
+		rc = dir(x, NULL);
+		if (rc) {
+			printf("%s: dir error %d\n", name, rc);
+			return rc;
+		}
+		if (dir_sets != num_sets || dir_sum != expect_sum) {
+			printf("ERROR: %s: %d sets, expected %d or "
+			       "a different directory\n",
+			       name, dir_sets, num_sets);
+			return EINVAL;
+		}
+	}
+	report(name, num_rounds, now_sec() - t, server_cpu() - cpu,
+	       lo_bytes() - b);
+	return 0;
+}
+
+static int run_cached(void)
+{
+	ldms_dir_cache_t c;
+	double t = 0, cpu = 0, t0, c0;
+	uint64_t b = 0, b0, sum;
+	ldms_t x;
+	int r, gen, rc = 0;
+
+	c = ldms_dir_cache_new();
+	if (!c)
+		return errno;
+	for (r = 0; r <= num_rounds; r++) {
+		x = connect_server(0);
+		if (!x)
+			return ENOTCONN;
+		t0 = now_sec();
+		c0 = server_cpu();
+		b0 = lo_bytes();
+		rc = dir(x, c);
+		if (rc) {
+			printf("cached: dir error %d\n", rc);
+			break;
+		}
+		/* The first round fills the cache */
+		if (r) {
+			t += now_sec() - t0;
+			cpu += server_cpu() - c0;
+			b += lo_bytes() - b0;
+		}
+		if (dir_callbacks != 1) {
+			printf("ERROR: cached: %d callbacks\n", dir_callbacks);
+			rc = EINVAL;
+			break;
+		}
+		sum = dir_sum;
+		rc = dir(x, NULL);
+		if (rc || dir_sum != sum) {
+			printf("ERROR: cached: round %d directory differs "
+			       "from the peer's\n", r);
+			rc = EINVAL;
+			break;
+		}
+		ldms_xprt_close(x);
+		ldms_xprt_put(x);
+		/* Change the server's directory for the next round */
+		kill(pid, SIGUSR1);
+		if (read(pipe_fd[0], &gen, sizeof(gen)) != sizeof(gen)) {
+			rc = EIO;
+			break;
+		}
+		srv_first += num_changes;
+	}
+	ldms_dir_cache_free(c);
+	if (!rc)
+		report("cached", num_rounds, t, cpu, b);
+	return rc;
+}
+
+static int notify_rc;
+static int notify_updates;
+
+static void notify_cb(ldms_t x, int status, ldms_dir_t dir, void *arg)
+{
+	if (status) {
+		notify_rc = status;
+	} else {
+		if (dir->type == LDMS_DIR_ADD)
+			notify_updates++;
+		ldms_xprt_dir_free(x, dir);
+	}
+	sem_post(&sem);
+}
+
+static void push_cb(ldms_t x, int status, ldms_dir_t dir, void *arg)
+{
+	int i, kind;
+
+	if (status) {
+		notify_rc = status;
+		sem_post(&sem);
+		return;
+	}
+	switch (dir->type) {
+	case LDMS_DIR_LIST:
+		if (!dir->more)
+			sem_post(&sem);
+		goto out;
+	case LDMS_DIR_DEL:
+		kind = PUSH_DEL;
+		break;
+	case LDMS_DIR_ADD:
+		kind = PUSH_ADD;
+		break;
+	case LDMS_DIR_UPD:
+		kind = PUSH_UPD;
+		break;
+	default:
+		goto out;
+	}
+	for (i = 0; i < dir->set_count; i++)
+		push_record(kind, dir->set_data[i].inst_name);
+ out:
+	ldms_xprt_dir_free(x, dir);
+}
+
+/* One round of server changes must push exactly the changed sets */
+static int run_notify(void)
+{
+	static const char *kind_name[] = { "delete", "add", "update" };
+	uint64_t expect_sum[PUSH_LAST] = { 0 };
+	char name[64];
+	ldms_t x;
+	int i, k, gen, rc;
+
+	/* The sets the server's next change deletes, adds and updates */
+	for (i = 0; i < num_changes; i++) {
+		snprintf(name, sizeof(name), SET_FMT, srv_first + i);
+		expect_sum[PUSH_DEL] += name_hash(name);
+		snprintf(name, sizeof(name), SET_FMT,
+			 srv_first + num_sets + i);
+		expect_sum[PUSH_ADD] += name_hash(name);
+		snprintf(name, sizeof(name), SET_FMT,
+			 srv_first + 1 + num_changes + 2 * i);
+		expect_sum[PUSH_UPD] += name_hash(name);
+	}
+
+	x = connect_server(0);
+	if (!x)
+		return ENOTCONN;
+	notify_rc = 0;
+	memset(push_count, 0, sizeof(push_count));
+	memset(push_sum, 0, sizeof(push_sum));
+	rc = ldms_xprt_dir(x, push_cb, NULL, LDMS_DIR_F_NOTIFY);
+	if (rc)
+		goto out;
+	sem_wait(&sem);
+	if (notify_rc) {
+		rc = notify_rc;
+		goto out;
+	}
+	kill(pid, SIGUSR1);
+	if (read(pipe_fd[0], &gen, sizeof(gen)) != sizeof(gen)) {
+		rc = EIO;
+		goto out;
+	}
+	srv_first += num_changes;
+	/* Wait for the pushes, then a little longer for duplicates */
+	for (i = 0; i < 500; i++) {
+		for (k = 0; k < PUSH_LAST; k++) {
+			if (__atomic_load_n(&push_count[k], __ATOMIC_ACQUIRE)
+			    < num_changes)
+				break;
+		}
+		if (k == PUSH_LAST)
+			break;
+		usleep(10000);
+	}
+	usleep(100000);
+	for (k = 0; k < PUSH_LAST; k++) {
+		if (push_count[k] == num_changes &&
+		    push_sum[k] == expect_sum[k])
+			continue;
+		printf("ERROR: notify: %d sets pushed as %s, expected %d "
+		       "or other sets\n", push_count[k], kind_name[k],
+		       num_changes);
+		rc = EINVAL;
+	}
+	if (!rc)
+		printf("notify: pushed changes OK\n");
+ out:
+	ldms_xprt_close(x);
+	ldms_xprt_put(x);
+	return rc;
+}
+
+/* unpublish -> publish -> reconnect with the same cache */
+static int run_unpublish(void)
+{
+	ldms_dir_cache_t c;
+	uint64_t sum;
+	ldms_t x;
+	int gen, rc;
+
+	c = ldms_dir_cache_new();
+	if (!c)
+		return errno;
+	rc = ENOTCONN;
+	x = connect_server(0);
+	if (!x)
+		goto out;
+	notify_rc = notify_updates = 0;
+	rc = ldms_xprt_dir_cached(x, c, notify_cb, NULL, LDMS_DIR_F_NOTIFY);
+	if (rc)
+		goto close;
+	sem_wait(&sem);
+	kill(pid, SIGUSR2);
+	if (read(pipe_fd[0], &gen, sizeof(gen)) != sizeof(gen)) {
+		rc = EIO;
+		goto close;
+	}
+	srv_first++;
+	/* Wait for the pushed LDMS_DIR_ADD of the published set */
+	sem_wait(&sem);
+	if (notify_rc || notify_updates != 1) {
+		printf("ERROR: unpublish: status %d, %d updates\n",
+		       notify_rc, notify_updates);
+		rc = EINVAL;
+		goto close;
+	}
+	ldms_xprt_close(x);
+	ldms_xprt_put(x);
+
+	rc = ENOTCONN;
+	x = connect_server(0);
+	if (!x)
+		goto out;
+	rc = dir(x, c);
+	if (rc) {
+		printf("unpublish: dir error %d\n", rc);
+		goto close;
+	}
+	sum = dir_sum;
+	rc = dir(x, NULL);
+	if (rc || dir_sum != sum || dir_sets != num_sets) {
+		printf("ERROR: unpublish: the cached directory differs "
+		       "from the peer's\n");
+		rc = EINVAL;
+		goto close;
+	}
+	printf("unpublish: cached directory OK\n");
+ close:
+	ldms_xprt_close(x);
+	ldms_xprt_put(x);
+ out:
+	ldms_dir_cache_free(c);
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	ldms_t x;
+	uint64_t sum;
+	int op, rc;
+
+	while ((op = getopt(argc, argv, "x:p:s:c:r:")) != -1) {
+		switch (op) {
+		case 'x':
+			xprt = optarg;
+			break;
+		case 'p':
+			port = optarg;
+			break;
+		case 's':
+			num_sets = atoi(optarg);
+			break;
+		case 'c':
+			num_changes = atoi(optarg);
+			break;
+		case 'r':
+			num_rounds = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-x <xprt>] [-p <port>] [-s <sets>] "
+			       "[-c <changes>] [-r <rounds>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (num_sets < 1 || num_rounds < 1 || num_changes < 1 ||
+	    2 * num_changes > num_sets) {
+		printf("All parameters must be positive and <changes> must "
+		       "not exceed half of <sets>\n");
+		return 1;
+	}
+
+	if (pipe(pipe_fd)) {
+		printf("pipe error %d\n", errno);
+		return 1;
+	}
+	ldms_init((num_sets + num_changes * (num_rounds + 2) + 1) * 4096L);
+	pid = fork();
+	if (pid == 0)
+		server();
+
+	sem_init(&sem, 0, 0);
+	printf("%d sets, %d changes per cached round, %d rounds\n",
+	       num_sets, num_changes, num_rounds);
+	x = connect_server(1);
+	if (!x) {
+		printf("cannot connect to the server\n");
+		goto err;
+	}
+	/* Let the server create and publish its sets */
+	sleep(1 + num_sets / 20000);
+	rc = dir(x, NULL);
+	if (rc) {
+		printf("dir error %d\n", rc);
+		goto err;
+	}
+	sum = dir_sum;
+	if (run(x, "json", sum))
+		goto err;
+	ldms_xprt_close(x);
+	ldms_xprt_put(x);
+
+	x = connect_server(0);
+	if (!x) {
+		printf("cannot connect to the server\n");
+		goto err;
+	}
+	if (run(x, "binary", sum))
+		goto err;
+	ldms_xprt_close(x);
+	ldms_xprt_put(x);
+
+	if (run_cached())
+		goto err;
+	if (run_notify())
+		goto err;
+	if (run_unpublish())
+		goto err;
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	return 0;
+ err:
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	return 1;
+}
@@ -0,0 +1,418 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Set heap checks and churn benchmark.
+ *
+ * check - Every size class is allocated, freed and allocated again from
+ *         its free list, a chunk of the whole heap is then allocated
+ *         from memory that is only free in the size-class lists, and
+ *         the ldms_heap_get_info() counts are checked at each step.
+ * list - A set with a list metric is filled with <items> char array
+ *        entries of 8 to 200 bytes. Every round removes the first
+ *        entry and appends a new one of a random length.
+ * heap - A <size> byte heap is filled with <items> chunks of the same
+ *        sizes, plus one in <large> chunks of 1 to 4KB. Every round
+ *        frees a random chunk and allocates a new one. The contents of
+ *        every chunk are checked before it is freed.
+ *
+ * The rate of remove/append pairs and the heap statistics from
+ * ldms_heap_get_info() are reported at the end of each run. The
+ * statistics of the heap run must account for every byte of the heap.
+ *
+ * usage: test_ldms_heap [-n <items>] [-r <rounds>] [-s <heap size>]
+ *                       [-l <large>]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include "ldms.h"
+#include "ldms_heap.h"
+
+#define SCHEMA_NAME "heap_schema"
+
+static int num_items = 1000;
+static int num_rounds = 1000000;
+static size_t heap_size = 1024 * 1024;
+static int large = 64;
+
+static uint64_t x = 0x9E3779B97F4A7C15ULL;
+
+/* xorshift64 */
+static uint64_t rnd(void)
+{
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}
+
+static size_t rnd_len(void)
+{
+	if (large && rnd() % large == 0)
+		return 1024 + rnd() % 3072;
+	return 8 + rnd() % 193;
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int list_run(void)
+{
+	ldms_schema_t schema;
+	ldms_set_t set;
+	ldms_mval_t lh, v;
+	size_t heap_sz;
+	double t0, t1;
+	int i, idx;
+
+	schema = ldms_schema_new(SCHEMA_NAME);
+	if (!schema)
+		return ENOMEM;
+	heap_sz = ldms_list_heap_size_get(LDMS_V_CHAR_ARRAY, num_items, 200);
+	idx = ldms_schema_metric_list_add(schema, "list", NULL, heap_sz);
+	if (idx < 0)
+		return -idx;
+	set = ldms_set_new("heap_test/list", schema);
+	if (!set)
+		return errno;
+	lh = ldms_metric_get(set, idx);
+	for (i = 0; i < num_items; i++) {
+		v = ldms_list_append_item(set, lh, LDMS_V_CHAR_ARRAY,
+					  8 + rnd() % 193);
+		if (!v) {
+			printf("list: append %d failed\n", i);
+			return ENOMEM;
+		}
+	}
+	t0 = now_sec();
+	for (i = 0; i < num_rounds; i++) {
+		v = ldms_list_first(set, lh, NULL, NULL);
+		ldms_list_remove_item(set, lh, v);
+		v = ldms_list_append_item(set, lh, LDMS_V_CHAR_ARRAY,
+					  8 + rnd() % 193);
+		if (!v) {
+			printf("list: append failed in round %d\n", i);
+			return ENOMEM;
+		}
+	}
+	t1 = now_sec();
+	printf("list %12.0f remove/append per second\n",
+	       num_rounds / (t1 - t0));
+	ldms_set_delete(set);
+	ldms_schema_delete(schema);
+	return 0;
+}
+
+struct chunk {
+	uint8_t *p;
+	size_t len;
+	uint8_t tag;
+};
+
+/* The bytes of the heap that are free, allocated or in the lists add up */
+static int heap_info_check(ldms_heap_t h, size_t in_use, const char *when)
+{
+	struct ldms_heap_info info;
+	size_t free_bytes;
+
+	ldms_heap_get_info(h, &info);
+	free_bytes = info.free_bytes << info.grain_bits;
+	if (free_bytes + info.slab_bytes + in_use != info.size) {
+		printf("ERROR: %s: %zu free + %zu size-class + %zu in use "
+		       "bytes, expected %zu\n", when, free_bytes,
+		       info.slab_bytes, in_use, info.size);
+		return EINVAL;
+	}
+	if (info.slab_bytes % info.grain ||
+	    (info.slab_chunks && info.slab_bytes < info.slab_chunks * info.grain) ||
+	    info.slab_bytes > info.slab_chunks * info.grain *
+				LDMS_HEAP_SLAB_CLASSES) {
+		printf("ERROR: %s: %zu size-class chunks of %zu bytes\n",
+		       when, info.slab_chunks, info.slab_bytes);
+		return EINVAL;
+	}
+	return 0;
+}
+
+static int heap_check(void)
+{
+	struct ldms_heap heap;
+	struct ldms_heap_instance inst;
+	struct ldms_heap_info info, prev;
+	size_t size = 64 * 1024, in_use = 0, len;
+	ldms_heap_t h;
+	uint8_t *p, *q;
+	void *base;
+	int c, rc = EINVAL;
+
+	base = calloc(1, ldms_heap_size(size));
+	if (!base)
+		return ENOMEM;
+	ldms_heap_init(&heap, base, size, 32);
+	h = ldms_heap_get(&inst, &heap, base);
+	ldms_heap_get_info(h, &info);
+	if (info.free_chunks != 1 || info.slab_chunks || info.slab_bytes ||
+	    info.largest != info.free_bytes ||
+	    (info.free_bytes << info.grain_bits) != size) {
+		printf("ERROR: check: the new heap is not one free chunk\n");
+		goto out;
+	}
+	for (c = 1; c <= LDMS_HEAP_SLAB_CLASSES; c++) {
+		/* The largest request of c grains */
+		len = c * info.grain - sizeof(uint32_t);
+		if (ldms_heap_alloc_size(info.grain, len) != c * info.grain) {
+			printf("ERROR: check: %zu bytes are not %d grains\n",
+			       len, c);
+			goto out;
+		}
+		p = ldms_heap_alloc(h, len);
+		if (!p) {
+			printf("ERROR: check: class %d allocation failed\n", c);
+			goto out;
+		}
+		memset(p, c, len);
+		in_use += c * info.grain;
+		if (heap_info_check(h, in_use, "class alloc"))
+			goto out;
+		ldms_heap_get_info(h, &prev);
+		ldms_heap_free(h, p);
+		in_use -= c * info.grain;
+		ldms_heap_get_info(h, &info);
+		if (info.slab_chunks != prev.slab_chunks + 1 ||
+		    info.slab_bytes != prev.slab_bytes + c * info.grain ||
+		    info.free_bytes != prev.free_bytes) {
+			printf("ERROR: check: class %d free did not go to its "
+			       "list\n", c);
+			goto out;
+		}
+		q = ldms_heap_alloc(h, len);
+		if (q != p) {
+			printf("ERROR: check: class %d chunk %p was not "
+			       "reused, got %p\n", c, p, q);
+			goto out;
+		}
+		ldms_heap_free(h, q);
+		if (heap_info_check(h, in_use, "class free"))
+			goto out;
+	}
+
+	/* The whole heap only fits once the lists are flushed */
+	ldms_heap_get_info(h, &info);
+	if (!info.slab_chunks || (info.largest << info.grain_bits) >= size) {
+		printf("ERROR: check: no memory in the size-class lists\n");
+		goto out;
+	}
+	p = ldms_heap_alloc(h, size - sizeof(uint32_t));
+	if (!p) {
+		printf("ERROR: check: the flushed lists were not reused\n");
+		goto out;
+	}
+	memset(p, 0xa5, size - sizeof(uint32_t));
+	ldms_heap_get_info(h, &info);
+	if (info.slab_chunks || info.slab_bytes || info.free_chunks ||
+	    info.free_bytes) {
+		printf("ERROR: check: %zu free and %zu size-class chunks in a "
+		       "full heap\n", info.free_chunks, info.slab_chunks);
+		goto out;
+	}
+	ldms_heap_free(h, p);
+	ldms_heap_get_info(h, &info);
+	if (info.free_chunks != 1 ||
+	    (info.free_bytes << info.grain_bits) != size) {
+		printf("ERROR: check: the freed heap is not one chunk\n");
+		goto out;
+	}
+	printf("check ok\n");
+	rc = 0;
+ out:
+	free(base);
+	return rc;
+}
+
+static int chunk_new(ldms_heap_t h, struct chunk *c)
+{
+	c->len = rnd_len();
+	c->tag = rnd();
+	c->p = ldms_heap_alloc(h, c->len);
+	if (!c->p)
+		return ENOMEM;
+	memset(c->p, c->tag, c->len);
+	return 0;
+}
+
+static int chunk_free(ldms_heap_t h, struct chunk *c)
+{
+	size_t i;
+
+	for (i = 0; i < c->len; i++) {
+		if (c->p[i] != c->tag) {
+			printf("heap: chunk %p corrupted at %zu\n", c->p, i);
+			return EINVAL;
+		}
+	}
+	ldms_heap_free(h, c->p);
+	return 0;
+}
+
+static int heap_run(void)
+{
+	struct ldms_heap heap;
+	struct ldms_heap_instance inst;
+	struct ldms_heap_info info;
+	struct chunk *c;
+	ldms_heap_t h;
+	void *base;
+	size_t live = 0, in_use = 0;
+	double t0, t1;
+	int i, j, rc;
+
+	base = calloc(1, ldms_heap_size(heap_size));
+	c = calloc(num_items, sizeof(*c));
+	if (!base || !c)
+		return ENOMEM;
+	ldms_heap_init(&heap, base, heap_size, 32);
+	h = ldms_heap_get(&inst, &heap, base);
+	if (!h)
+		return EINVAL;
+	for (i = 0; i < num_items; i++) {
+		rc = chunk_new(h, &c[i]);
+		if (rc) {
+			printf("heap: allocation %d failed\n", i);
+			return rc;
+		}
+	}
+	t0 = now_sec();
+	for (i = 0; i < num_rounds; i++) {
+		j = rnd() % num_items;
+		rc = chunk_free(h, &c[j]);
+		if (rc)
+			return rc;
+		rc = chunk_new(h, &c[j]);
+		if (rc) {
+			printf("heap: allocation failed in round %d\n", i);
+			return rc;
+		}
+	}
+	t1 = now_sec();
+	for (i = 0; i < num_items; i++) {
+		live += c[i].len;
+		in_use += ldms_heap_alloc_size(32, c[i].len);
+	}
+	rc = heap_info_check(h, in_use, "heap");
+	if (rc)
+		return rc;
+	ldms_heap_get_info(h, &info);
+	printf("heap %12.0f free/alloc per second\n",
+	       num_rounds / (t1 - t0));
+	printf("     %zu bytes live in %zu byte heap, %zu bytes in use\n",
+	       live, info.size, in_use);
+	printf("     %zu free chunks, largest %zu bytes, "
+	       "%zu size-class chunks of %zu bytes\n",
+	       info.free_chunks, info.largest << info.grain_bits,
+	       info.slab_chunks, info.slab_bytes);
+	for (i = 0; i < num_items; i++) {
+		rc = chunk_free(h, &c[i]);
+		if (rc)
+			return rc;
+	}
+	free(c);
+	free(base);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int op, rc;
+
+	while ((op = getopt(argc, argv, "n:r:s:l:")) != -1) {
+		switch (op) {
+		case 'n':
+			num_items = atoi(optarg);
+			break;
+		case 'r':
+			num_rounds = atoi(optarg);
+			break;
+		case 's':
+			heap_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			large = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-n <items>] [-r <rounds>] "
+			       "[-s <heap size>] [-l <large>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (num_items < 1 || num_rounds < 1 || large < 0 ||
+	    heap_size < LDMS_HEAP_MIN_SIZE) {
+		printf("<items> and <rounds> must be positive, <large> must "
+		       "not be negative and <heap size> must be at least %d\n",
+		       LDMS_HEAP_MIN_SIZE);
+		return 1;
+	}
+	printf("%d items, %d rounds\n", num_items, num_rounds);
+	ldms_init(16 * 1024 * 1024);
+	rc = heap_check();
+	if (rc)
+		goto out;
+	rc = list_run();
+	if (rc)
+		goto out;
+	rc = heap_run();
+ out:
+	if (rc)
+		printf("error %d\n", rc);
+	return rc ? 1 : 0;
+}
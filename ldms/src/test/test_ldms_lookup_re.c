@@ -0,0 +1,409 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Lookup-by-regex test and benchmark.
+ *
+ * First checks that ldms_name_re_exec() agrees with regexec() for a set
+ * of expressions and names.
+ *
+ * Then a forked server process creates <sets> sets named node%06d/<schema>
+ * with the schemas "meminfo" and "vmstat" alternating, and "lustre" for
+ * every 1000th set. The client runs each of the lookups in main() <rounds>
+ * times and reports the lookup rate, the server CPU time per lookup and
+ * the number of sets each lookup matched. With -c the server also creates
+ * and deletes a set every millisecond, so it can rarely reuse the matches
+ * of a previous lookup.
+ *
+ * Every set a lookup returns must match the lookup, and every round must
+ * return as many sets as the server's naming scheme has matches.
+ *
+ * usage: test_ldms_lookup_re [-x <xprt>] [-p <port>] [-s <sets>]
+ *                            [-r <rounds>] [-c]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <semaphore.h>
+#include <regex.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include "ldms.h"
+
+static char *xprt = "sock";
+static char *port = "10602";
+static int num_sets = 100000;
+static int num_rounds = 100;
+static int churn;
+
+static pid_t pid;
+static sem_t sem;
+static int lookup_count;
+static int lookup_errors;
+static int wrong_match;
+
+/* the lookup run() is timing */
+static const char *cur_name;
+static int cur_flags;
+static regex_t cur_regex;
+
+static const char *exprs[] = {
+	"", ".*", "node", "^node", "^node.*", "^node000001/meminfo$",
+	"^node00001[0-9]/", "^node0000(1|2)", "meminfo$", ".*info.*",
+	"^node\\.x", "^nod?e", "^no+de", "^[n]ode", "a|b", "^node00*1",
+	"\\w", "^node000001/meminfo", NULL
+};
+
+static const char *names[] = {
+	"node000001/meminfo", "node000012/vmstat", "node", "nod", "noode",
+	"ne", "node.x", "nodex", "a", "xyz/meminfo", "", NULL
+};
+
+static int check_name_re(void)
+{
+	struct ldms_name_re re;
+	regex_t regex;
+	int i, j, a, b, err = 0;
+
+	for (i = 0; exprs[i]; i++) {
+		if (ldms_name_re_comp(&re, exprs[i], REG_EXTENDED | REG_NOSUB) ||
+		    regcomp(&regex, exprs[i], REG_EXTENDED | REG_NOSUB)) {
+			printf("cannot compile '%s'\n", exprs[i]);
+			return 1;
+		}
+		for (j = 0; names[j]; j++) {
+			a = ldms_name_re_exec(&re, names[j]);
+			b = regexec(&regex, names[j], 0, NULL, 0);
+			if (!a != !b) {
+				printf("ERROR: '%s' on '%s': %d, regexec %d\n",
+				       exprs[i], names[j], a, b);
+				err++;
+			}
+		}
+		ldms_name_re_free(&re);
+		regfree(&regex);
+	}
+	return err;
+}
+
+static void _log(const char *fmt, ...)
+{
+	va_list l;
+	va_start(l, fmt);
+	vprintf(fmt, l);
+	va_end(l);
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* CPU time of the server process in seconds */
+static double server_cpu(void)
+{
+	char path[64], buf[1024], *p;
+	unsigned long utime, stime;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	f = fopen(path, "r");
+	if (!f)
+		return 0;
+	p = fgets(buf, sizeof(buf), f);
+	fclose(f);
+	if (!p)
+		return 0;
+	p = strrchr(buf, ')');
+	if (!p || 2 != sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u "
+			      "%*u %*u %lu %lu", &utime, &stime))
+		return 0;
+	return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static void server(void)
+{
+	const char *schema_name[] = { "meminfo", "vmstat", "lustre" };
+	ldms_schema_t schema[3];
+	ldms_set_t set;
+	ldms_t x;
+	char name[64];
+	int i, s, rc;
+
+	x = ldms_xprt_new(xprt, _log);
+	if (!x) {
+		printf("server: ldms_xprt_new error %d\n", errno);
+		exit(1);
+	}
+	rc = ldms_xprt_listen_by_name(x, "0.0.0.0", port, NULL, NULL);
+	if (rc) {
+		printf("server: listen error %d\n", rc);
+		exit(1);
+	}
+	for (s = 0; s < 3; s++) {
+		schema[s] = ldms_schema_new(schema_name[s]);
+		ldms_schema_metric_add(schema[s], "value", LDMS_V_U64);
+	}
+	for (i = 0; i < num_sets; i++) {
+		s = (i % 1000) ? (i & 1) : 2;
+		snprintf(name, sizeof(name), "node%06d/%s", i,
+			 schema_name[s]);
+		set = ldms_set_new(name, schema[s]);
+		if (!set) {
+			printf("server: ldms_set_new error %d\n", errno);
+			exit(1);
+		}
+		ldms_set_publish(set);
+	}
+	for (i = 0; ; i++) {
+		if (churn) {
+			snprintf(name, sizeof(name), "churn%d", i);
+			set = ldms_set_new(name, schema[0]);
+			if (set) {
+				ldms_set_publish(set);
+				ldms_set_delete(set);
+			}
+		}
+		usleep(1000);
+	}
+}
+
+static int lookup_match(const char *str)
+{
+	if (cur_flags & LDMS_LOOKUP_RE)
+		return !regexec(&cur_regex, str, 0, NULL, 0);
+	return !strcmp(cur_name, str);
+}
+
+/* the number of the server's sets that the current lookup matches */
+static int lookup_expected(void)
+{
+	const char *schema_name[] = { "meminfo", "vmstat", "lustre" };
+	char name[64];
+	int i, s, n = 0;
+
+	for (i = 0; i < num_sets; i++) {
+		s = (i % 1000) ? (i & 1) : 2;
+		snprintf(name, sizeof(name), "node%06d/%s", i,
+			 schema_name[s]);
+		if (lookup_match((cur_flags & LDMS_LOOKUP_BY_SCHEMA) ?
+				 schema_name[s] : name))
+			n++;
+	}
+	return n;
+}
+
+static void lookup_cb(ldms_t x, enum ldms_lookup_status status, int more,
+		      ldms_set_t s, void *arg)
+{
+	if (status) {
+		__sync_add_and_fetch(&lookup_errors, 1);
+		sem_post(&sem);
+		return;
+	}
+	lookup_count++;
+	if (!lookup_match((cur_flags & LDMS_LOOKUP_BY_SCHEMA) ?
+			  ldms_set_schema_name_get(s) :
+			  ldms_set_instance_name_get(s))) {
+		printf("ERROR: '%s' returned %s\n", cur_name,
+		       ldms_set_instance_name_get(s));
+		wrong_match++;
+	}
+	ldms_set_delete(s);
+	if (!more)
+		sem_post(&sem);
+}
+
+static void connect_cb(ldms_t x, ldms_xprt_event_t e, void *arg)
+{
+	switch (e->type) {
+	case LDMS_XPRT_EVENT_CONNECTED:
+	case LDMS_XPRT_EVENT_REJECTED:
+	case LDMS_XPRT_EVENT_ERROR:
+		*(int *)arg = e->type;
+		sem_post(&sem);
+		break;
+	default:
+		break;
+	}
+}
+
+static int run(ldms_t x, const char *name, int flags)
+{
+	double t0, t1, c0, c1;
+	int r, rc, expected;
+
+	cur_name = name;
+	cur_flags = flags;
+	if ((flags & LDMS_LOOKUP_RE) &&
+	    regcomp(&cur_regex, name, REG_EXTENDED | REG_NOSUB)) {
+		printf("cannot compile '%s'\n", name);
+		return EINVAL;
+	}
+	expected = lookup_expected();
+	lookup_count = 0;
+	lookup_errors = 0;
+	wrong_match = 0;
+	c0 = server_cpu();
+	t0 = now_sec();
+	for (r = 0; r < num_rounds; r++) {
+		rc = ldms_xprt_lookup(x, name, flags, lookup_cb, NULL);
+		if (rc) {
+			printf("ldms_xprt_lookup error %d\n", rc);
+			goto out;
+		}
+		sem_wait(&sem);
+	}
+	t1 = now_sec();
+	c1 = server_cpu();
+	printf("%-24s %-8s %10.1f lookups/s %10.3f ms server CPU/lookup "
+	       "%8d sets\n", name,
+	       (flags & LDMS_LOOKUP_BY_SCHEMA) ? "schema" : "instance",
+	       num_rounds / (t1 - t0), (c1 - c0) * 1000 / num_rounds,
+	       lookup_count / num_rounds);
+	rc = 0;
+	if (wrong_match) {
+		rc = EINVAL;
+	} else if (expected ? lookup_errors : lookup_errors != num_rounds) {
+		/* a lookup that matches nothing fails with ENOENT */
+		printf("ERROR: '%s': %d lookups failed, expected %d\n", name,
+		       lookup_errors, expected ? 0 : num_rounds);
+		rc = EINVAL;
+	} else if (lookup_count != expected * num_rounds) {
+		printf("ERROR: '%s': %d sets in %d lookups, expected %d each\n",
+		       name, lookup_count, num_rounds, expected);
+		rc = EINVAL;
+	}
+ out:
+	if (flags & LDMS_LOOKUP_RE)
+		regfree(&cur_regex);
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	ldms_t x;
+	int i, op, rc, ev = -1;
+
+	while ((op = getopt(argc, argv, "x:p:s:r:c")) != -1) {
+		switch (op) {
+		case 'x':
+			xprt = optarg;
+			break;
+		case 'p':
+			port = optarg;
+			break;
+		case 's':
+			num_sets = atoi(optarg);
+			break;
+		case 'r':
+			num_rounds = atoi(optarg);
+			break;
+		case 'c':
+			churn = 1;
+			break;
+		default:
+			printf("usage: %s [-x <xprt>] [-p <port>] [-s <sets>] "
+			       "[-r <rounds>] [-c]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (num_sets < 1 || num_rounds < 1) {
+		printf("All parameters must be positive\n");
+		return 1;
+	}
+	if (check_name_re())
+		return 1;
+
+	ldms_init(num_sets * 4096L);
+	pid = fork();
+	if (pid == 0)
+		server();
+
+	sem_init(&sem, 0, 0);
+	for (i = 0; i < 50; i++) {
+		x = ldms_xprt_new(xprt, _log);
+		if (!x) {
+			printf("ldms_xprt_new error %d\n", errno);
+			goto err;
+		}
+		rc = ldms_xprt_connect_by_name(x, "localhost", port,
+					       connect_cb, &ev);
+		if (!rc) {
+			sem_wait(&sem);
+			if (ev == LDMS_XPRT_EVENT_CONNECTED)
+				break;
+		}
+		ldms_xprt_put(x);
+		usleep(100000);
+	}
+	if (ev != LDMS_XPRT_EVENT_CONNECTED) {
+		printf("cannot connect to the server\n");
+		goto err;
+	}
+	/* Let the server create and publish its sets */
+	sleep(1 + num_sets / 50000);
+
+	rc = run(x, "^node00001[0-9]/", LDMS_LOOKUP_RE);
+	rc = rc ? rc : run(x, "^node000013/vmstat$", LDMS_LOOKUP_RE);
+	rc = rc ? rc : run(x, "node00001[0-9]/", LDMS_LOOKUP_RE);
+	rc = rc ? rc : run(x, "^lus", LDMS_LOOKUP_RE | LDMS_LOOKUP_BY_SCHEMA);
+	rc = rc ? rc : run(x, "lustre", LDMS_LOOKUP_BY_SCHEMA);
+	if (rc)
+		goto err;
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	return 0;
+ err:
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	return 1;
+}
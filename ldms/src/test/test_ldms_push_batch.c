@@ -0,0 +1,447 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Coalesced push benchmark.
+ *
+ * A forked server process creates <sets> sets of <metrics> U64 metrics
+ * and, every <interval> microseconds, sets all the metrics of every set
+ * to the round number in one transaction. The client registers for the
+ * pushes on change of all the sets and counts the push callbacks for
+ * <seconds> seconds. This is done once with pushes sent right away and
+ * once with a <window> microseconds coalescing window on the server.
+ * It reports the sets received per second, the messages they came in,
+ * and the CPU time of the server and the client per set received.
+ * A third run registers for explicit pushes, which the server makes with
+ * ldms_xprt_push() while the transaction is still open; the coalesced
+ * pushes must be sent once the transaction ends.
+ *
+ * Every set received must have all of its metrics equal and no older
+ * than the last one received. Without a window no push may be flagged
+ * LDMS_UPD_F_BATCH; with one every push must be, a set may appear only
+ * once in a batch, every batch must end with LDMS_UPD_F_BATCH_END and
+ * some batches must hold more than one set. Every set must be received.
+ *
+ * usage: test_ldms_push_batch [-x <xprt>] [-p <port>] [-s <sets>]
+ *                             [-m <metrics>] [-i <interval>]
+ *                             [-w <window>] [-t <seconds>]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <semaphore.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "ldms.h"
+
+#define SCHEMA_NAME "push_schema"
+#define SET_FMT "node%06d/push"
+
+static char *xprt = "sock";
+static char *port = "10603";
+static int num_sets = 200;
+static int num_metrics = 32;
+static int interval = 10000;
+static int window = 5000;
+static int seconds = 5;
+
+static ldms_set_t *sets;
+static sem_t sem;
+static int lookup_count;
+static int push_count;
+static int msg_count;
+static int bad_count;
+static int flag_count;
+static int explicit_push;	/* ldms_xprt_push() in the transaction */
+static int coalesce;		/* pushes are expected in batches */
+static int in_batch;		/* a batch has begun but not ended */
+static int batch_id;
+static int *set_batch;		/* the last batch each set was in */
+static uint64_t *set_value;	/* the last value each set had */
+
+static void _log(const char *fmt, ...)
+{
+	va_list l;
+	va_start(l, fmt);
+	vprintf(fmt, l);
+	va_end(l);
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* CPU time of the process in seconds */
+static double proc_cpu(pid_t pid)
+{
+	char path[64], buf[1024], *p;
+	unsigned long utime, stime;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	f = fopen(path, "r");
+	if (!f)
+		return 0;
+	p = fgets(buf, sizeof(buf), f);
+	fclose(f);
+	if (!p)
+		return 0;
+	p = strrchr(buf, ')');
+	if (!p || 2 != sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u "
+			      "%*u %*u %lu %lu", &utime, &stime))
+		return 0;
+	return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static void server(int window_us)
+{
+	ldms_schema_t schema;
+	ldms_t x;
+	char name[64];
+	uint64_t v;
+	int i, j, rc;
+
+	ldms_xprt_push_coalesce_set(window_us);
+	x = ldms_xprt_new(xprt, _log);
+	if (!x) {
+		printf("server: ldms_xprt_new error %d\n", errno);
+		exit(1);
+	}
+	rc = ldms_xprt_listen_by_name(x, "0.0.0.0", port, NULL, NULL);
+	if (rc) {
+		printf("server: listen error %d\n", rc);
+		exit(1);
+	}
+	schema = ldms_schema_new(SCHEMA_NAME);
+	for (j = 0; j < num_metrics; j++) {
+		snprintf(name, sizeof(name), "metric_%d", j);
+		ldms_schema_metric_add(schema, name, LDMS_V_U64);
+	}
+	sets = calloc(num_sets, sizeof(*sets));
+	for (i = 0; i < num_sets; i++) {
+		snprintf(name, sizeof(name), SET_FMT, i);
+		sets[i] = ldms_set_new(name, schema);
+		if (!sets[i]) {
+			printf("server: ldms_set_new error %d\n", errno);
+			exit(1);
+		}
+		ldms_set_publish(sets[i]);
+	}
+	for (v = 1; ; v++) {
+		if (explicit_push) {
+			for (i = 0; i < num_sets; i++) {
+				ldms_transaction_begin(sets[i]);
+				for (j = 0; j < num_metrics; j++)
+					ldms_metric_set_u64(sets[i], j, v);
+				ldms_xprt_push(sets[i]);
+			}
+			/* past the window with the transactions open */
+			usleep(2 * window_us);
+			for (i = 0; i < num_sets; i++)
+				ldms_transaction_end(sets[i]);
+			usleep(interval);
+			continue;
+		}
+		for (i = 0; i < num_sets; i++) {
+			ldms_transaction_begin(sets[i]);
+			for (j = 0; j < num_metrics; j++)
+				ldms_metric_set_u64(sets[i], j, v);
+			ldms_transaction_end(sets[i]);
+		}
+		usleep(interval);
+	}
+}
+
+static void lookup_cb(ldms_t x, enum ldms_lookup_status status, int more,
+		      ldms_set_t s, void *arg)
+{
+	if (status) {
+		printf("lookup error %d\n", status);
+		exit(1);
+	}
+	sets[(uintptr_t)arg] = s;
+	if (__sync_add_and_fetch(&lookup_count, 1) == num_sets)
+		sem_post(&sem);
+}
+
+static void push_cb(ldms_t x, ldms_set_t s, int flags, void *arg)
+{
+	uintptr_t i = (uintptr_t)arg;
+	uint64_t v;
+	int j;
+
+	if (LDMS_UPD_ERROR(flags) || (flags & LDMS_UPD_F_PUSH_LAST))
+		return;
+	push_count++;
+	if (!(flags & LDMS_UPD_F_BATCH) || (flags & LDMS_UPD_F_BATCH_END))
+		msg_count++;
+	if (!(flags & LDMS_UPD_F_PUSH) ||
+	    !(flags & LDMS_UPD_F_BATCH) != !coalesce ||
+	    ((flags & LDMS_UPD_F_BATCH_END) && !(flags & LDMS_UPD_F_BATCH)))
+		flag_count++;
+	if (flags & LDMS_UPD_F_BATCH) {
+		if (in_batch && set_batch[i] == batch_id)
+			flag_count++;	/* twice in one batch */
+		in_batch = 1;
+		set_batch[i] = batch_id;
+		if (flags & LDMS_UPD_F_BATCH_END) {
+			in_batch = 0;
+			batch_id++;
+		}
+	} else if (in_batch) {
+		flag_count++;		/* the batch did not end */
+		in_batch = 0;
+		batch_id++;
+	}
+	v = ldms_metric_get_u64(s, 0);
+	if (v < set_value[i])
+		bad_count++;
+	set_value[i] = v;
+	for (j = 1; j < num_metrics; j++) {
+		if (ldms_metric_get_u64(s, j) != v) {
+			bad_count++;
+			break;
+		}
+	}
+}
+
+static void connect_cb(ldms_t x, ldms_xprt_event_t e, void *arg)
+{
+	switch (e->type) {
+	case LDMS_XPRT_EVENT_CONNECTED:
+	case LDMS_XPRT_EVENT_REJECTED:
+	case LDMS_XPRT_EVENT_ERROR:
+		*(int *)arg = e->type;
+		sem_post(&sem);
+		break;
+	default:
+		break;
+	}
+}
+
+static double self_cpu(void)
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+	       ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+}
+
+static int run(const char *label, int window_us)
+{
+	char name[64];
+	double t0, t1, s0, s1, c0, c1;
+	ldms_t x;
+	pid_t pid;
+	int i, rc, ev = -1;
+
+	pid = fork();
+	if (pid == 0)
+		server(window_us);
+
+	for (i = 0; i < 50; i++) {
+		x = ldms_xprt_new(xprt, _log);
+		if (!x) {
+			printf("ldms_xprt_new error %d\n", errno);
+			goto err;
+		}
+		rc = ldms_xprt_connect_by_name(x, "localhost", port,
+					       connect_cb, &ev);
+		if (!rc) {
+			sem_wait(&sem);
+			if (ev == LDMS_XPRT_EVENT_CONNECTED)
+				break;
+		}
+		ldms_xprt_put(x);
+		usleep(100000);
+	}
+	if (ev != LDMS_XPRT_EVENT_CONNECTED) {
+		printf("cannot connect to the server\n");
+		goto err;
+	}
+	/* Let the server create and publish its sets */
+	sleep(1);
+	lookup_count = 0;
+	for (i = 0; i < num_sets; i++) {
+		snprintf(name, sizeof(name), SET_FMT, i);
+		rc = ldms_xprt_lookup(x, name, LDMS_LOOKUP_BY_INSTANCE,
+				      lookup_cb, (void *)(uintptr_t)i);
+		if (rc) {
+			printf("ldms_xprt_lookup error %d\n", rc);
+			goto err;
+		}
+	}
+	sem_wait(&sem);
+	coalesce = (window_us != 0);
+	in_batch = 0;
+	batch_id = 1;
+	memset(set_batch, 0, num_sets * sizeof(*set_batch));
+	memset(set_value, 0, num_sets * sizeof(*set_value));
+	for (i = 0; i < num_sets; i++) {
+		rc = ldms_xprt_register_push(sets[i], explicit_push ? 0 :
+					     LDMS_XPRT_PUSH_F_CHANGE,
+					     push_cb, (void *)(uintptr_t)i);
+		if (rc) {
+			printf("ldms_xprt_register_push error %d\n", rc);
+			goto err;
+		}
+	}
+	sleep(1);
+
+	push_count = msg_count = 0;
+	s0 = proc_cpu(pid);
+	c0 = self_cpu();
+	t0 = now_sec();
+	sleep(seconds);
+	t1 = now_sec();
+	c1 = self_cpu();
+	s1 = proc_cpu(pid);
+	printf("%-10s %10.0f sets/s %8.1f sets/msg %8.2f us server CPU/set "
+	       "%8.2f us client CPU/set\n", label, push_count / (t1 - t0),
+	       msg_count ? (double)push_count / msg_count : 0.0,
+	       push_count ? (s1 - s0) * 1e6 / push_count : 0.0,
+	       push_count ? (c1 - c0) * 1e6 / push_count : 0.0);
+
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	ldms_xprt_close(x);
+	for (i = 0; i < num_sets; i++)
+		ldms_set_delete(sets[i]);
+	if (!push_count) {
+		printf("ERROR: %s: no pushes received\n", label);
+		return 1;
+	}
+	if (coalesce && msg_count >= push_count) {
+		printf("ERROR: %s: no pushes were coalesced\n", label);
+		return 1;
+	}
+	for (i = 0, rc = 0; i < num_sets; i++) {
+		if (!set_value[i])
+			rc++;
+	}
+	if (rc) {
+		printf("ERROR: %s: %d sets were never pushed\n", label, rc);
+		return 1;
+	}
+	return 0;
+ err:
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	char label[32];
+	int op, rc;
+
+	while ((op = getopt(argc, argv, "x:p:s:m:i:w:t:")) != -1) {
+		switch (op) {
+		case 'x':
+			xprt = optarg;
+			break;
+		case 'p':
+			port = optarg;
+			break;
+		case 's':
+			num_sets = atoi(optarg);
+			break;
+		case 'm':
+			num_metrics = atoi(optarg);
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 'w':
+			window = atoi(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-x <xprt>] [-p <port>] [-s <sets>] "
+			       "[-m <metrics>] [-i <interval>] [-w <window>] "
+			       "[-t <seconds>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (num_sets < 1 || num_metrics < 1 || interval < 1 ||
+	    window < 1 || seconds < 1) {
+		printf("All parameters must be positive\n");
+		return 1;
+	}
+
+	ldms_init(num_sets * (1024L + num_metrics * 64));
+	sem_init(&sem, 0, 0);
+	sets = calloc(num_sets, sizeof(*sets));
+	set_batch = calloc(num_sets, sizeof(*set_batch));
+	set_value = calloc(num_sets, sizeof(*set_value));
+	if (!sets || !set_batch || !set_value) {
+		printf("out of memory\n");
+		return 1;
+	}
+	printf("%d sets x %d metrics, all changed every %dus\n",
+	       num_sets, num_metrics, interval);
+	rc = run("immediate", 0);
+	snprintf(label, sizeof(label), "%dus", window);
+	rc = rc ? rc : run(label, window);
+	explicit_push = 1;
+	snprintf(label, sizeof(label), "explicit");
+	rc = rc ? rc : run(label, window);
+	if (rc || bad_count || flag_count) {
+		printf("ERROR: %d inconsistent sets received, %d pushes with "
+		       "wrong flags\n", bad_count, flag_count);
+		return 1;
+	}
+	return 0;
+}
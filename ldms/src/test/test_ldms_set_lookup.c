@@ -0,0 +1,240 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Local set directory scaling benchmark.
+ *
+ * Creates <sets> sets and runs ldms_set_by_name() lookups from 1, 2, 4,
+ * ... <threads> threads while another thread keeps creating and
+ * deleting sets. Reports the lookup rate for each thread count.
+ *
+ * usage: test_ldms_set_lookup [-s <sets>] [-t <max threads>]
+ *                             [-n <lookups per thread>]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <assert.h>
+#include "ldms.h"
+
+#define SCHEMA_NAME "lookup_schema"
+#define SET_FMT "node%06d/meminfo"
+
+static int num_sets = 100000;
+static int max_threads = 8;
+static int num_lookups = 1000000;
+
+static int churn_stop;
+static uint64_t churn_count;
+static uint64_t wrong_set;
+
+static void set_name(char *buf, size_t sz, int i)
+{
+	snprintf(buf, sz, SET_FMT, i);
+}
+
+static void *lookup_proc(void *arg)
+{
+	uint64_t x = (uintptr_t)arg * 0x9E3779B97F4A7C15ULL + 1;
+	uint64_t miss = 0;
+	char name[64];
+	ldms_set_t set;
+	int i;
+
+	for (i = 0; i < num_lookups; i++) {
+		/* xorshift64 */
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		set_name(name, sizeof(name), x % num_sets);
+		set = ldms_set_by_name(name);
+		if (!set) {
+			miss++;
+			continue;
+		}
+		if (strcmp(ldms_set_instance_name_get(set), name))
+			__atomic_add_fetch(&wrong_set, 1, __ATOMIC_RELAXED);
+		ldms_set_put(set);
+	}
+	return (void *)(uintptr_t)miss;
+}
+
+static void *churn_proc(void *arg)
+{
+	ldms_schema_t schema = arg;
+	ldms_set_t set;
+	char name[64];
+
+	while (!churn_stop) {
+		snprintf(name, sizeof(name), "churn%" PRIu64, churn_count);
+		set = ldms_set_new(name, schema);
+		if (!set)
+			continue;
+		ldms_set_publish(set);
+		ldms_set_delete(set);
+		churn_count++;
+	}
+	return NULL;
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	ldms_schema_t schema;
+	ldms_set_t *sets, set;
+	pthread_t *thr, churn;
+	char name[64];
+	double t0, t1;
+	uint64_t miss;
+	void *ret;
+	int i, n, op;
+
+	while ((op = getopt(argc, argv, "s:t:n:")) != -1) {
+		switch (op) {
+		case 's':
+			num_sets = atoi(optarg);
+			break;
+		case 't':
+			max_threads = atoi(optarg);
+			break;
+		case 'n':
+			num_lookups = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-s <sets>] [-t <max threads>] "
+			       "[-n <lookups per thread>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (num_sets < 1 || max_threads < 1 || num_lookups < 1) {
+		printf("All parameters must be positive\n");
+		return 1;
+	}
+
+	ldms_init(num_sets * 4096L);
+	schema = ldms_schema_new(SCHEMA_NAME);
+	assert(schema);
+	ldms_schema_metric_add(schema, "MemFree", LDMS_V_U64);
+	sets = calloc(num_sets, sizeof(*sets));
+	thr = calloc(max_threads, sizeof(*thr));
+	assert(sets && thr);
+
+	t0 = now_sec();
+	for (i = 0; i < num_sets; i++) {
+		set_name(name, sizeof(name), i);
+		sets[i] = ldms_set_new(name, schema);
+		if (!sets[i]) {
+			printf("ldms_set_new(%s) error %d\n", name, errno);
+			return 1;
+		}
+		ldms_set_publish(sets[i]);
+	}
+	t1 = now_sec();
+	printf("%d sets created in %.3f s\n", num_sets, t1 - t0);
+
+	for (n = 1; n <= max_threads; n *= 2) {
+		churn_stop = 0;
+		churn_count = 0;
+		pthread_create(&churn, NULL, churn_proc, schema);
+		t0 = now_sec();
+		for (i = 0; i < n; i++)
+			pthread_create(&thr[i], NULL, lookup_proc,
+				       (void *)(uintptr_t)(i + 1));
+		miss = 0;
+		for (i = 0; i < n; i++) {
+			pthread_join(thr[i], &ret);
+			miss += (uintptr_t)ret;
+		}
+		t1 = now_sec();
+		churn_stop = 1;
+		pthread_join(churn, NULL);
+		printf("%3d threads %12.0f lookups/s %10" PRIu64
+		       " create/delete\n", n,
+		       (double)n * num_lookups / (t1 - t0), churn_count);
+		if (miss) {
+			printf("ERROR: %" PRIu64 " lookups failed\n", miss);
+			return 1;
+		}
+		if (wrong_set) {
+			printf("ERROR: %" PRIu64 " lookups returned the wrong "
+			       "set\n", wrong_set);
+			return 1;
+		}
+		/* every churn set was deleted, so none may be found */
+		for (i = 0; i < churn_count; i++) {
+			snprintf(name, sizeof(name), "churn%d", i);
+			set = ldms_set_by_name(name);
+			if (set) {
+				printf("ERROR: deleted set %s is still found\n",
+				       name);
+				return 1;
+			}
+		}
+	}
+
+	for (i = 0; i < num_sets; i++)
+		ldms_set_delete(sets[i]);
+	for (i = 0; i < num_sets; i++) {
+		set_name(name, sizeof(name), i);
+		set = ldms_set_by_name(name);
+		if (set) {
+			printf("ERROR: deleted set %s is still found\n", name);
+			return 1;
+		}
+	}
+	free(sets);
+	free(thr);
+	ldms_schema_delete(schema);
+	return 0;
+}
@@ -0,0 +1,441 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Batch update benchmark.
+ *
+ * A forked server process creates <sets> sets of <metrics> U64 metrics
+ * and changes <changed> metrics of every set every 10ms. The client
+ * looks them up and updates all the sets <rounds> times with
+ * ldms_xprt_update(), ldms_xprt_update_batch() and
+ * ldms_xprt_update_batch() with LDMS_XPRT_UPDATE_F_DELTA. It reports the
+ * set update rate, the loopback bytes per set update and the share of
+ * request contexts taken from the transport's free lists of each. With
+ * -i the rounds are <interval> microseconds apart like an updater's.
+ *
+ * Every update must call back once per set, with the set's own handle
+ * and argument and without an error status. At the end the server is
+ * paused and the sets are updated with a delta and then whole; both
+ * copies must be identical.
+ *
+ * usage: test_ldms_update_batch [-x <xprt>] [-p <port>] [-s <sets>]
+ *                               [-m <metrics>] [-c <changed>]
+ *                               [-r <rounds>] [-i <interval>]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <semaphore.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include "ldms.h"
+
+#define SCHEMA_NAME "batch_schema"
+#define SET_FMT "node%06d/batch"
+
+static char *xprt = "sock";
+static char *port = "10601";
+static int num_sets = 1000;
+static int num_metrics = 1024;
+static int num_changed = 16;
+static int num_rounds = 100;
+static int interval;
+
+static ldms_set_t *sets;
+static void **set_args;
+static int *set_cb_count;
+static sem_t sem;
+static int lookup_count;
+static int upd_count;
+static int upd_errors;
+static int cb_errors;
+static volatile int paused;
+
+static void _log(const char *fmt, ...)
+{
+	va_list l;
+	va_start(l, fmt);
+	vprintf(fmt, l);
+	va_end(l);
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Bytes received on the loopback interface */
+static uint64_t lo_bytes(void)
+{
+	char line[512];
+	uint64_t bytes = 0;
+	FILE *f = fopen("/proc/net/dev", "r");
+
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (1 == sscanf(line, " lo: %" SCNu64, &bytes))
+			break;
+	}
+	fclose(f);
+	return bytes;
+}
+
+static void pause_handler(int sig)
+{
+	paused = 1;
+}
+
+static void server(void)
+{
+	ldms_schema_t schema;
+	ldms_t x;
+	char name[64];
+	uint64_t v;
+	int i, j, k, rc;
+
+	signal(SIGUSR1, pause_handler);
+	x = ldms_xprt_new(xprt, _log);
+	if (!x) {
+		printf("server: ldms_xprt_new error %d\n", errno);
+		exit(1);
+	}
+	rc = ldms_xprt_listen_by_name(x, "0.0.0.0", port, NULL, NULL);
+	if (rc) {
+		printf("server: listen error %d\n", rc);
+		exit(1);
+	}
+	schema = ldms_schema_new(SCHEMA_NAME);
+	for (j = 0; j < num_metrics; j++) {
+		snprintf(name, sizeof(name), "metric_%d", j);
+		ldms_schema_metric_add(schema, name, LDMS_V_U64);
+	}
+	sets = calloc(num_sets, sizeof(*sets));
+	for (i = 0; i < num_sets; i++) {
+		snprintf(name, sizeof(name), SET_FMT, i);
+		sets[i] = ldms_set_new(name, schema);
+		if (!sets[i]) {
+			printf("server: ldms_set_new error %d\n", errno);
+			exit(1);
+		}
+		ldms_set_publish(sets[i]);
+	}
+	for (v = 1; ; v++) {
+		while (paused)
+			pause();
+		for (i = 0; i < num_sets; i++) {
+			ldms_transaction_begin(sets[i]);
+			for (k = 0; k < num_changed; k++) {
+				j = (v * num_changed + k) % num_metrics;
+				ldms_metric_set_u64(sets[i], j, v);
+			}
+			ldms_transaction_end(sets[i]);
+		}
+		usleep(10000);
+	}
+}
+
+static void lookup_cb(ldms_t x, enum ldms_lookup_status status, int more,
+		      ldms_set_t s, void *arg)
+{
+	if (status) {
+		printf("lookup error %d\n", status);
+		exit(1);
+	}
+	sets[(uintptr_t)arg] = s;
+	if (__sync_add_and_fetch(&lookup_count, 1) == num_sets)
+		sem_post(&sem);
+}
+
+static void update_cb(ldms_t x, ldms_set_t s, int flags, void *arg)
+{
+	uintptr_t i = (uintptr_t)arg;
+
+	if (LDMS_UPD_ERROR(flags))
+		__sync_add_and_fetch(&upd_errors, 1);
+	if (i >= (uintptr_t)num_sets || s != sets[i]) {
+		__sync_add_and_fetch(&cb_errors, 1);
+		return;
+	}
+	if (flags & LDMS_UPD_F_MORE)
+		return;
+	__sync_add_and_fetch(&set_cb_count[i], 1);
+	if (__sync_add_and_fetch(&upd_count, 1) == num_sets)
+		sem_post(&sem);
+}
+
+static void connect_cb(ldms_t x, ldms_xprt_event_t e, void *arg)
+{
+	switch (e->type) {
+	case LDMS_XPRT_EVENT_CONNECTED:
+	case LDMS_XPRT_EVENT_REJECTED:
+	case LDMS_XPRT_EVENT_ERROR:
+		*(int *)arg = e->type;
+		sem_post(&sem);
+		break;
+	default:
+		break;
+	}
+}
+
+enum mode {
+	UPDATE,
+	BATCH,
+	DELTA,
+};
+
+static void update_all(ldms_t x, enum mode mode)
+{
+	int i, rc;
+
+	upd_count = 0;
+	if (mode == UPDATE) {
+		for (i = 0; i < num_sets; i++) {
+			rc = ldms_xprt_update(sets[i], update_cb, set_args[i]);
+			if (rc) {
+				printf("ldms_xprt_update error %d\n", rc);
+				exit(1);
+			}
+		}
+	} else {
+		rc = ldms_xprt_update_batch(x, sets, set_args, num_sets,
+				update_cb,
+				(mode == DELTA) ? LDMS_XPRT_UPDATE_F_DELTA : 0);
+		if (rc) {
+			printf("ldms_xprt_update_batch error %d\n", rc);
+			exit(1);
+		}
+	}
+	sem_wait(&sem);
+	for (i = 0; i < num_sets; i++) {
+		/* a missing set would have kept sem_wait() from returning */
+		if (set_cb_count[i] != 1)
+			__sync_add_and_fetch(&cb_errors, 1);
+		set_cb_count[i] = 0;
+	}
+}
+
+static void run(ldms_t x, const char *name, enum mode mode)
+{
+	struct ldms_xprt_stats s0, s1;
+	uint64_t b0;
+	double t0, t1;
+	int r;
+
+	/* Start from the current data */
+	update_all(x, BATCH);
+	b0 = lo_bytes();
+	ldms_xprt_stats(x, &s0);
+	t0 = now_sec();
+	for (r = 0; r < num_rounds; r++) {
+		update_all(x, mode);
+		if (interval)
+			usleep(interval);
+	}
+	t1 = now_sec();
+	ldms_xprt_stats(x, &s1);
+	printf("%-8s %12.0f sets/s %10.0f bytes/set %6.1f%% contexts reused\n",
+	       name, (double)num_rounds * num_sets / (t1 - t0),
+	       (double)(lo_bytes() - b0) / num_rounds / num_sets,
+	       s1.ctxt_alloc == s0.ctxt_alloc ? 0.0 :
+	       100.0 * (s1.ctxt_reuse - s0.ctxt_reuse) /
+			(s1.ctxt_alloc - s0.ctxt_alloc));
+}
+
+/* Returns the number of sets that differ after a delta and a full update */
+static int check(ldms_t x)
+{
+	uint64_t *copy;
+	int i, j, diff = 0;
+
+	copy = calloc((size_t)num_sets * (num_metrics + 1), sizeof(*copy));
+	if (!copy)
+		return num_sets;
+	update_all(x, DELTA);
+	for (i = 0; i < num_sets; i++) {
+		copy[i * (num_metrics + 1)] = ldms_set_data_gn_get(sets[i]);
+		for (j = 0; j < num_metrics; j++)
+			copy[i * (num_metrics + 1) + j + 1] =
+				ldms_metric_get_u64(sets[i], j);
+	}
+	update_all(x, BATCH);
+	for (i = 0; i < num_sets; i++) {
+		if (copy[i * (num_metrics + 1)] != ldms_set_data_gn_get(sets[i])) {
+			diff++;
+			continue;
+		}
+		for (j = 0; j < num_metrics; j++) {
+			if (copy[i * (num_metrics + 1) + j + 1] !=
+			    ldms_metric_get_u64(sets[i], j)) {
+				diff++;
+				break;
+			}
+		}
+	}
+	free(copy);
+	return diff;
+}
+
+int main(int argc, char **argv)
+{
+	char name[64];
+	ldms_t x;
+	pid_t pid;
+	int i, op, rc, diff, ev = -1;
+
+	while ((op = getopt(argc, argv, "x:p:s:m:c:r:i:")) != -1) {
+		switch (op) {
+		case 'x':
+			xprt = optarg;
+			break;
+		case 'p':
+			port = optarg;
+			break;
+		case 's':
+			num_sets = atoi(optarg);
+			break;
+		case 'm':
+			num_metrics = atoi(optarg);
+			break;
+		case 'c':
+			num_changed = atoi(optarg);
+			break;
+		case 'r':
+			num_rounds = atoi(optarg);
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-x <xprt>] [-p <port>] [-s <sets>] "
+			       "[-m <metrics>] [-c <changed>] [-r <rounds>] "
+			       "[-i <interval>]\n",
+			       argv[0]);
+			return 1;
+		}
+	}
+	if (num_sets < 1 || num_metrics < 1 || num_rounds < 1 ||
+	    num_changed < 1 || num_changed > num_metrics || interval < 0) {
+		printf("All parameters must be positive and "
+		       "<changed> must not exceed <metrics>\n");
+		return 1;
+	}
+
+	ldms_init(num_sets * (1024L + num_metrics * 64));
+	pid = fork();
+	if (pid == 0)
+		server();
+
+	sem_init(&sem, 0, 0);
+	sets = calloc(num_sets, sizeof(*sets));
+	set_args = calloc(num_sets, sizeof(*set_args));
+	set_cb_count = calloc(num_sets, sizeof(*set_cb_count));
+	if (!sets || !set_args || !set_cb_count) {
+		printf("out of memory\n");
+		goto err;
+	}
+	for (i = 0; i < num_sets; i++)
+		set_args[i] = (void *)(uintptr_t)i;
+	for (i = 0; i < 50; i++) {
+		x = ldms_xprt_new(xprt, _log);
+		if (!x) {
+			printf("ldms_xprt_new error %d\n", errno);
+			goto err;
+		}
+		rc = ldms_xprt_connect_by_name(x, "localhost", port,
+					       connect_cb, &ev);
+		if (!rc) {
+			sem_wait(&sem);
+			if (ev == LDMS_XPRT_EVENT_CONNECTED)
+				break;
+		}
+		ldms_xprt_put(x);
+		usleep(100000);
+	}
+	if (ev != LDMS_XPRT_EVENT_CONNECTED) {
+		printf("cannot connect to the server\n");
+		goto err;
+	}
+	/* Let the server create and publish its sets */
+	sleep(1);
+	for (i = 0; i < num_sets; i++) {
+		snprintf(name, sizeof(name), SET_FMT, i);
+		rc = ldms_xprt_lookup(x, name, LDMS_LOOKUP_BY_INSTANCE,
+				      lookup_cb, (void *)(uintptr_t)i);
+		if (rc) {
+			printf("ldms_xprt_lookup error %d\n", rc);
+			goto err;
+		}
+	}
+	sem_wait(&sem);
+	printf("%d sets x %d metrics, %d changed every 10ms, %d rounds\n",
+	       num_sets, num_metrics, num_changed, num_rounds);
+
+	run(x, "update", UPDATE);
+	run(x, "batch", BATCH);
+	run(x, "delta", DELTA);
+
+	kill(pid, SIGUSR1);
+	usleep(100000);
+	diff = check(x);
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	if (upd_errors || cb_errors || diff) {
+		printf("ERROR: %d update errors, %d bad callbacks, "
+		       "%d sets differ\n", upd_errors, cb_errors, diff);
+		return 1;
+	}
+	return 0;
+ err:
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	return 1;
+}
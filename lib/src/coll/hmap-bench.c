@@ -0,0 +1,275 @@
+/*
+ * Hash map benchmark.
+ *
+ * For 1k, 10k, ... up to <max> entries, inserts all the keys into an
+ * empty map, looks every key up in random order, looks up as many keys
+ * that are not in the map, and deletes all the keys. String keys are
+ * compared across hmap, htbl, rbt and str_map, and uint64_t keys across
+ * hmap and rbt. hmap starts from its smallest table and grows while the
+ * keys are inserted; htbl and str_map are given one bucket per entry.
+ *
+ * Reports the average time of each operation in nanoseconds and the
+ * longest single insert in microseconds. Every insert is timed, so the
+ * insert average includes the cost of reading the clock.
+ *
+ * usage: hmap_bench [-n <max entries>]
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include "hmap.h"
+#include "htbl.h"
+#include "rbt.h"
+#include "str_map.h"
+
+#define KEY_SZ 32
+
+static size_t nkeys;
+static char *keys;		/* 2 * nkeys keys, the second half is never inserted */
+static int *order;		/* random lookup order */
+static uint64_t sum;		/* keeps the lookups from being optimized out */
+
+struct result {
+	double ins_ns, ins_max_us, hit_ns, miss_ns, del_ns;
+};
+
+static inline const char *key_str(size_t i)
+{
+	return &keys[i * KEY_SZ];
+}
+
+static inline uint64_t key_u64(size_t i)
+{
+	return (uint64_t)i * 0x9e3779b97f4a7c15ULL + 1;
+}
+
+static inline double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#define TIME_INS(r, n, stmt) do { \
+	double __t0 = now_ns(), __t, __p = __t0; \
+	size_t i; \
+	(r)->ins_max_us = 0; \
+	for (i = 0; i < (n); i++) { \
+		stmt; \
+		__t = now_ns(); \
+		if (__t - __p > (r)->ins_max_us) \
+			(r)->ins_max_us = __t - __p; \
+		__p = __t; \
+	} \
+	(r)->ins_ns = (__p - __t0) / (n); \
+	(r)->ins_max_us /= 1e3; \
+} while (0)
+
+#define TIME_OPS(res, n, stmt) do { \
+	double __t0 = now_ns(); \
+	size_t i; \
+	for (i = 0; i < (n); i++) { \
+		stmt; \
+	} \
+	res = (now_ns() - __t0) / (n); \
+} while (0)
+
+static void bench_hmap_str(size_t n, struct result *r)
+{
+	hmap_t m = hmap_str_new(0);
+	uint64_t obj;
+
+	TIME_INS(r, n, hmap_str_ins(m, key_str(i), i));
+	TIME_OPS(r->hit_ns, n,
+		 hmap_str_find(m, key_str(order[i]), &obj); sum += obj);
+	TIME_OPS(r->miss_ns, n,
+		 sum += hmap_str_find(m, key_str(n + order[i]), &obj));
+	TIME_OPS(r->del_ns, n, hmap_str_del(m, key_str(i), NULL));
+	hmap_free(m);
+}
+
+static int str_cmp(const void *a, const void *b, size_t len)
+{
+	return strcmp(a, b);
+}
+
+static void bench_htbl(size_t n, struct result *r)
+{
+	htbl_t t = htbl_alloc(str_cmp, n);
+	struct hent *ents = calloc(n, sizeof(*ents));
+	hent_t e;
+
+	TIME_INS(r, n, hent_init(&ents[i], key_str(i), strlen(key_str(i)));
+		       htbl_ins(t, &ents[i]));
+	TIME_OPS(r->hit_ns, n,
+		 e = htbl_find(t, key_str(order[i]),
+			       strlen(key_str(order[i])));
+		 sum += e - ents);
+	TIME_OPS(r->miss_ns, n,
+		 e = htbl_find(t, key_str(n + order[i]),
+			       strlen(key_str(n + order[i])));
+		 sum += (e != NULL));
+	TIME_OPS(r->del_ns, n,
+		 e = htbl_find(t, key_str(i), strlen(key_str(i)));
+		 htbl_del(t, e));
+	htbl_free(t);
+	free(ents);
+}
+
+struct rb_ent {
+	struct rbn rbn;
+	uint64_t u64;
+};
+
+static int rb_str_cmp(void *a, const void *b)
+{
+	return strcmp(a, b);
+}
+
+static int rb_u64_cmp(void *a, const void *b)
+{
+	uint64_t x = *(uint64_t *)a, y = *(uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void bench_rbt_str(size_t n, struct result *r)
+{
+	struct rbt t;
+	struct rb_ent *ents = calloc(n, sizeof(*ents));
+	struct rbn *rbn;
+
+	rbt_init(&t, rb_str_cmp);
+	TIME_INS(r, n, rbn_init(&ents[i].rbn, (void *)key_str(i));
+		       rbt_ins(&t, &ents[i].rbn));
+	TIME_OPS(r->hit_ns, n,
+		 rbn = rbt_find(&t, key_str(order[i]));
+		 sum += (struct rb_ent *)rbn - ents);
+	TIME_OPS(r->miss_ns, n,
+		 rbn = rbt_find(&t, key_str(n + order[i]));
+		 sum += (rbn != NULL));
+	TIME_OPS(r->del_ns, n,
+		 rbn = rbt_find(&t, key_str(i));
+		 rbt_del(&t, rbn));
+	free(ents);
+}
+
+static void bench_str_map(size_t n, struct result *r)
+{
+	str_map_t m = str_map_create(n);
+
+	TIME_INS(r, n, str_map_insert(m, key_str(i), i));
+	TIME_OPS(r->hit_ns, n, sum += str_map_get(m, key_str(order[i])));
+	TIME_OPS(r->miss_ns, n, sum += str_map_get(m, key_str(n + order[i])));
+	TIME_OPS(r->del_ns, n, str_map_remove(m, key_str(i)));
+	str_map_free(m);
+}
+
+static void bench_hmap_u64(size_t n, struct result *r)
+{
+	hmap_t m = hmap_u64_new(0);
+	uint64_t obj;
+
+	TIME_INS(r, n, hmap_u64_ins(m, key_u64(i), i));
+	TIME_OPS(r->hit_ns, n,
+		 hmap_u64_find(m, key_u64(order[i]), &obj); sum += obj);
+	TIME_OPS(r->miss_ns, n,
+		 sum += hmap_u64_find(m, key_u64(n + order[i]), &obj));
+	TIME_OPS(r->del_ns, n, hmap_u64_del(m, key_u64(i), NULL));
+	hmap_free(m);
+}
+
+static void bench_rbt_u64(size_t n, struct result *r)
+{
+	struct rbt t;
+	struct rb_ent *ents = calloc(n, sizeof(*ents));
+	struct rbn *rbn;
+	uint64_t k;
+
+	rbt_init(&t, rb_u64_cmp);
+	TIME_INS(r, n, ents[i].u64 = key_u64(i);
+		       rbn_init(&ents[i].rbn, &ents[i].u64);
+		       rbt_ins(&t, &ents[i].rbn));
+	TIME_OPS(r->hit_ns, n,
+		 k = key_u64(order[i]); rbn = rbt_find(&t, &k);
+		 sum += (struct rb_ent *)rbn - ents);
+	TIME_OPS(r->miss_ns, n,
+		 k = key_u64(n + order[i]); rbn = rbt_find(&t, &k);
+		 sum += (rbn != NULL));
+	TIME_OPS(r->del_ns, n,
+		 k = key_u64(i); rbn = rbt_find(&t, &k);
+		 rbt_del(&t, rbn));
+	free(ents);
+}
+
+static struct {
+	const char *name;
+	void (*fn)(size_t n, struct result *r);
+} benches[] = {
+	{ "hmap_str", bench_hmap_str },
+	{ "htbl", bench_htbl },
+	{ "rbt_str", bench_rbt_str },
+	{ "str_map", bench_str_map },
+	{ "hmap_u64", bench_hmap_u64 },
+	{ "rbt_u64", bench_rbt_u64 },
+};
+
+int main(int argc, char *argv[])
+{
+	struct result r;
+	size_t n, i, j;
+	int op, b, tmp;
+
+	nkeys = 10000000;
+	while ((op = getopt(argc, argv, "n:")) != -1) {
+		switch (op) {
+		case 'n':
+			nkeys = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			printf("usage: %s [-n <max entries>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (nkeys < 1000) {
+		printf("The maximum number of entries must be at least 1000\n");
+		return 1;
+	}
+
+	keys = malloc(2 * nkeys * KEY_SZ);
+	order = malloc(nkeys * sizeof(*order));
+	if (!keys || !order) {
+		printf("Out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < nkeys; i++)
+		snprintf(&keys[i * KEY_SZ], KEY_SZ, "node%08zu/metric", i);
+
+	printf("%-10s %10s %10s %12s %10s %10s %10s\n", "map", "entries",
+	       "ins ns", "ins max us", "hit ns", "miss ns", "del ns");
+	for (n = 1000; n <= nkeys; n *= 10) {
+		/* the second half of the keys starts at n */
+		for (i = 0; i < n; i++)
+			snprintf(&keys[(n + i) * KEY_SZ], KEY_SZ,
+				 "node%08zu/metric", n + i);
+		for (i = 0; i < n; i++)
+			order[i] = i;
+		srandom(n);
+		for (i = n - 1; i > 0; i--) {
+			j = random() % (i + 1);
+			tmp = order[i];
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+		for (b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+			benches[b].fn(n, &r);
+			printf("%-10s %10zu %10.1f %12.1f %10.1f %10.1f %10.1f\n",
+			       benches[b].name, n, r.ins_ns, r.ins_max_us,
+			       r.hit_ns, r.miss_ns, r.del_ns);
+		}
+		printf("\n");
+	}
+	return sum == 42;	/* never, keeps sum live */
+}
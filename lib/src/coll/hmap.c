@@ -0,0 +1,666 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include "fnv_hash.h"
+#include "hmap.h"
+
+/*
+ * Robin Hood hashing: an entry is placed by linear probing from its home
+ * slot, but takes the slot of any entry that is closer to its own home.
+ * This keeps the probe sequence lengths (psl) short and even, and lets a
+ * lookup stop at the first slot whose entry is closer to its home than
+ * the key would be. A delete shifts the following displaced entries back
+ * by one slot instead of leaving a tombstone.
+ *
+ * While the table grows, the old table is kept until all of its slots
+ * have been moved. Its slots below hmap::mig have been moved already and
+ * are ignored. They are left in place so that the probe sequences of the
+ * remaining entries are not broken; for the same reason, entries deleted
+ * from the old table are marked dead instead of being shifted out.
+ *
+ * Large tables are mapped rather than allocated so that the memory of the
+ * old table can be given back as the move progresses, rather than all at
+ * once when it ends. No entry left in the old table probes a slot more
+ * than hmap_tbl::max_psl slots below hmap::mig.
+ */
+
+#define HMAP_MIN_CAP	16
+#define HMAP_MIGRATE	16	/* old slots moved per insert or delete */
+#define HMAP_MAX_CAP	((size_t)1 << 32)	/* indexed by a 32-bit hash */
+#define HMAP_MMAP_SZ	(256 * 1024)	/* tables this large are mapped */
+#define HMAP_RELEASE_SZ	(64 * 1024)	/* old table memory given back at once */
+
+#define HMAP_SLOT_F_DEAD	1
+
+#define FNV_64_SEED	0xcbf29ce484222325ULL
+
+enum hmap_key_e {
+	HMAP_KEY_BYTES,
+	HMAP_KEY_STR,
+	HMAP_KEY_U64,
+};
+
+struct hmap_slot {
+	uint32_t psl;		/* probe sequence length + 1, 0 if empty */
+	uint32_t hash;
+	uint32_t key_len;
+	uint32_t flags;
+	uint64_t key;		/* the key, or a pointer to it */
+	uint64_t obj;
+};
+
+struct hmap_tbl {
+	size_t mask;		/* capacity - 1 */
+	uint32_t max_psl;	/* the longest probe sequence put */
+	int mapped;
+	size_t released;	/* bytes of a mapped old table given back */
+	struct hmap_slot *slots;
+};
+
+struct hmap {
+	enum hmap_key_e type;
+	hmap_hash_fn_t hash_fn;
+	hmap_cmp_fn_t cmp_fn;
+	size_t count;
+	size_t grow_at;		/* count at which the table grows */
+	struct hmap_tbl tbl;	/* all inserts go here */
+	struct hmap_tbl old;	/* the table being moved, slots is NULL if none */
+	size_t mig;		/* the next old slot to move */
+};
+
+static inline uint32_t __hash_fold(uint64_t h)
+{
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+/* MurmurHash3 64-bit finalizer */
+static inline uint32_t __hash_u64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return (uint32_t)k;
+}
+
+static inline uint32_t __hash_bytes(hmap_t m, const void *key, size_t key_len)
+{
+	if (m->hash_fn)
+		return __hash_fold(m->hash_fn(key, key_len));
+	return __hash_fold(fnv_hash_a1_64(key, key_len, FNV_64_SEED));
+}
+
+static inline int __key_eq(hmap_t m, struct hmap_slot *s, uint32_t h,
+			   uint64_t key, size_t key_len)
+{
+	if (s->hash != h)
+		return 0;
+	if (m->type == HMAP_KEY_U64)
+		return s->key == key;
+	if (s->key_len != key_len)
+		return 0;
+	if (m->cmp_fn)
+		return 0 == m->cmp_fn((void *)s->key, (void *)key, key_len);
+	return 0 == memcmp((void *)s->key, (void *)key, key_len);
+}
+
+/* Find a key in a table, ignoring the slots below lo */
+static struct hmap_slot *__tbl_find(hmap_t m, struct hmap_tbl *t, size_t lo,
+				    uint32_t h, uint64_t key, size_t key_len)
+{
+	size_t idx = h & t->mask;
+	uint32_t psl = 1;
+	struct hmap_slot *s;
+
+	for (;;) {
+		s = &t->slots[idx];
+		if (s->psl < psl)
+			return NULL;
+		if (idx >= lo && !(s->flags & HMAP_SLOT_F_DEAD) &&
+		    __key_eq(m, s, h, key, key_len))
+			return s;
+		psl++;
+		idx = (idx + 1) & t->mask;
+	}
+}
+
+static void __tbl_put(struct hmap_tbl *t, struct hmap_slot *e)
+{
+	size_t idx = e->hash & t->mask;
+	struct hmap_slot *s, tmp;
+
+	e->psl = 1;
+	for (;;) {
+		s = &t->slots[idx];
+		if (!s->psl) {
+			*s = *e;
+			return;
+		}
+		if (s->psl < e->psl) {
+			/* the resident is closer to home, displace it */
+			tmp = *s;
+			*s = *e;
+			*e = tmp;
+		}
+		e->psl++;
+		if (e->psl > t->max_psl)
+			t->max_psl = e->psl;
+		idx = (idx + 1) & t->mask;
+	}
+}
+
+static void __tbl_remove(struct hmap_tbl *t, struct hmap_slot *s)
+{
+	size_t idx = s - t->slots;
+	size_t next;
+
+	for (;;) {
+		next = (idx + 1) & t->mask;
+		if (t->slots[next].psl <= 1)
+			break;
+		t->slots[idx] = t->slots[next];
+		t->slots[idx].psl--;
+		idx = next;
+	}
+	t->slots[idx].psl = 0;
+}
+
+static int __tbl_alloc(struct hmap_tbl *t, size_t cap)
+{
+	size_t sz = cap * sizeof(*t->slots);
+
+	if (cap > HMAP_MAX_CAP)
+		return ENOMEM;
+	if (sz >= HMAP_MMAP_SZ) {
+		t->slots = mmap(NULL, sz, PROT_READ|PROT_WRITE,
+				MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if (t->slots == MAP_FAILED)
+			return ENOMEM;
+		t->mapped = 1;
+	} else {
+		t->slots = calloc(cap, sizeof(*t->slots));
+		if (!t->slots)
+			return ENOMEM;
+		t->mapped = 0;
+	}
+	t->mask = cap - 1;
+	t->max_psl = 1;
+	t->released = 0;
+	return 0;
+}
+
+static void __tbl_free(struct hmap_tbl *t)
+{
+	if (!t->slots)
+		return;
+	if (t->mapped)
+		munmap(t->slots, (t->mask + 1) * sizeof(*t->slots));
+	else
+		free(t->slots);
+	t->slots = NULL;
+}
+
+/* Give back the memory of the old table that no probe reaches anymore */
+static void __tbl_release(struct hmap_tbl *t, size_t mig)
+{
+	size_t end;
+
+	if (!t->mapped || mig <= t->max_psl)
+		return;
+	end = (mig - t->max_psl) * sizeof(*t->slots);
+	end &= ~((size_t)HMAP_RELEASE_SZ - 1);
+	if (end <= t->released)
+		return;
+	madvise((char *)t->slots + t->released, end - t->released,
+		MADV_DONTNEED);
+	t->released = end;
+}
+
+/* Move up to n slots of the old table to the new one */
+static void __migrate(hmap_t m, size_t n)
+{
+	struct hmap_slot *s, e;
+	size_t end = m->old.mask + 1;
+
+	if (n < end - m->mig)
+		end = m->mig + n;
+	for (; m->mig < end; m->mig++) {
+		s = &m->old.slots[m->mig];
+		if (s->psl && !(s->flags & HMAP_SLOT_F_DEAD)) {
+			e = *s;
+			__tbl_put(&m->tbl, &e);
+		}
+	}
+	if (m->mig > m->old.mask)
+		__tbl_free(&m->old);
+	else
+		__tbl_release(&m->old, m->mig);
+}
+
+static int __grow(hmap_t m)
+{
+	struct hmap_tbl t;
+	size_t cap = (m->tbl.mask + 1) * 2;
+	int rc;
+
+	if (m->old.slots)
+		__migrate(m, m->old.mask + 1);
+	rc = __tbl_alloc(&t, cap);
+	if (rc)
+		return rc;
+	m->old = m->tbl;
+	m->tbl = t;
+	m->mig = 0;
+	m->grow_at = cap - cap / 8;
+	return 0;
+}
+
+static struct hmap_slot *__find(hmap_t m, uint32_t h, uint64_t key,
+				size_t key_len, struct hmap_tbl **t)
+{
+	struct hmap_slot *s;
+
+	*t = &m->tbl;
+	s = __tbl_find(m, &m->tbl, 0, h, key, key_len);
+	if (s || !m->old.slots)
+		return s;
+	*t = &m->old;
+	return __tbl_find(m, &m->old, m->mig, h, key, key_len);
+}
+
+static int __ins(hmap_t m, uint32_t h, uint64_t key, size_t key_len,
+		 uint64_t obj)
+{
+	struct hmap_slot e;
+	struct hmap_tbl *t;
+	int rc;
+
+	if (m->old.slots)
+		__migrate(m, HMAP_MIGRATE);
+	if (__find(m, h, key, key_len, &t))
+		return EEXIST;
+	if (m->count >= m->grow_at) {
+		rc = __grow(m);
+		if (rc)
+			return rc;
+	}
+	e.hash = h;
+	e.key_len = key_len;
+	e.flags = 0;
+	e.key = key;
+	e.obj = obj;
+	__tbl_put(&m->tbl, &e);
+	m->count++;
+	return 0;
+}
+
+static int __del(hmap_t m, uint32_t h, uint64_t key, size_t key_len,
+		 uint64_t *obj)
+{
+	struct hmap_slot *s;
+	struct hmap_tbl *t;
+
+	if (m->old.slots)
+		__migrate(m, HMAP_MIGRATE);
+	s = __find(m, h, key, key_len, &t);
+	if (!s)
+		return ENOENT;
+	if (obj)
+		*obj = s->obj;
+	if (t == &m->old)
+		s->flags |= HMAP_SLOT_F_DEAD;
+	else
+		__tbl_remove(t, s);
+	m->count--;
+	return 0;
+}
+
+static inline int __get(hmap_t m, uint32_t h, uint64_t key, size_t key_len,
+			uint64_t *obj)
+{
+	struct hmap_slot *s;
+	struct hmap_tbl *t;
+
+	s = __find(m, h, key, key_len, &t);
+	if (!s)
+		return ENOENT;
+	*obj = s->obj;
+	return 0;
+}
+
+static hmap_t __hmap_new(enum hmap_key_e type, size_t count_hint,
+			 hmap_hash_fn_t hash_fn, hmap_cmp_fn_t cmp_fn)
+{
+	size_t cap = HMAP_MIN_CAP;
+	hmap_t m;
+
+	while (cap - cap / 8 < count_hint)
+		cap <<= 1;
+	m = calloc(1, sizeof(*m));
+	if (!m)
+		return NULL;
+	errno = __tbl_alloc(&m->tbl, cap);
+	if (errno) {
+		free(m);
+		return NULL;
+	}
+	m->type = type;
+	m->hash_fn = hash_fn;
+	m->cmp_fn = cmp_fn;
+	m->grow_at = cap - cap / 8;
+	return m;
+}
+
+hmap_t hmap_new(size_t count_hint, hmap_hash_fn_t hash_fn, hmap_cmp_fn_t cmp_fn)
+{
+	return __hmap_new(HMAP_KEY_BYTES, count_hint, hash_fn, cmp_fn);
+}
+
+hmap_t hmap_str_new(size_t count_hint)
+{
+	return __hmap_new(HMAP_KEY_STR, count_hint, NULL, NULL);
+}
+
+hmap_t hmap_u64_new(size_t count_hint)
+{
+	return __hmap_new(HMAP_KEY_U64, count_hint, NULL, NULL);
+}
+
+void hmap_free(hmap_t m)
+{
+	if (!m)
+		return;
+	__tbl_free(&m->old);
+	__tbl_free(&m->tbl);
+	free(m);
+}
+
+size_t hmap_count(hmap_t m)
+{
+	return m->count;
+}
+
+int hmap_ins(hmap_t m, const void *key, size_t key_len, uint64_t obj)
+{
+	if (key_len > UINT32_MAX)
+		return EINVAL;
+	return __ins(m, __hash_bytes(m, key, key_len), (uint64_t)key,
+		     key_len, obj);
+}
+
+int hmap_find(hmap_t m, const void *key, size_t key_len, uint64_t *obj)
+{
+	return __get(m, __hash_bytes(m, key, key_len), (uint64_t)key,
+		     key_len, obj);
+}
+
+int hmap_del(hmap_t m, const void *key, size_t key_len, uint64_t *obj)
+{
+	return __del(m, __hash_bytes(m, key, key_len), (uint64_t)key,
+		     key_len, obj);
+}
+
+int hmap_str_ins(hmap_t m, const char *key, uint64_t obj)
+{
+	return hmap_ins(m, key, strlen(key), obj);
+}
+
+int hmap_str_find(hmap_t m, const char *key, uint64_t *obj)
+{
+	return hmap_find(m, key, strlen(key), obj);
+}
+
+int hmap_str_del(hmap_t m, const char *key, uint64_t *obj)
+{
+	return hmap_del(m, key, strlen(key), obj);
+}
+
+int hmap_u64_ins(hmap_t m, uint64_t key, uint64_t obj)
+{
+	return __ins(m, __hash_u64(key), key, 0, obj);
+}
+
+int hmap_u64_find(hmap_t m, uint64_t key, uint64_t *obj)
+{
+	return __get(m, __hash_u64(key), key, 0, obj);
+}
+
+int hmap_u64_del(hmap_t m, uint64_t key, uint64_t *obj)
+{
+	return __del(m, __hash_u64(key), key, 0, obj);
+}
+
+void hmap_iter_init(hmap_iter_t it, hmap_t m)
+{
+	it->map = m;
+	it->tbl = 0;
+	it->idx = 0;
+}
+
+int hmap_iter_next(hmap_iter_t it, struct hmap_ent_s *ent)
+{
+	hmap_t m = it->map;
+	struct hmap_tbl *t;
+	struct hmap_slot *s;
+
+	for (;;) {
+		if (it->tbl) {
+			t = &m->old;
+			if (!t->slots)
+				return ENOENT;
+			if (it->idx < m->mig)
+				it->idx = m->mig;
+		} else {
+			t = &m->tbl;
+		}
+		for (; it->idx <= t->mask; it->idx++) {
+			s = &t->slots[it->idx];
+			if (!s->psl || (s->flags & HMAP_SLOT_F_DEAD))
+				continue;
+			if (m->type == HMAP_KEY_U64) {
+				ent->key.u64 = s->key;
+				ent->key_len = 0;
+			} else {
+				ent->key.ptr = (const void *)s->key;
+				ent->key_len = s->key_len;
+			}
+			ent->obj = s->obj;
+			it->idx++;
+			return 0;
+		}
+		if (it->tbl)
+			return ENOENT;
+		it->tbl = 1;
+		it->idx = 0;
+	}
+}
+
+#ifdef HMAP_TEST
+#include <stdio.h>
+#include "ovis-test/test.h"
+
+#define NKEYS	20000
+#define NOPS	1000000
+
+static uint64_t test_key(int i)
+{
+	return (uint64_t)i * 0x9e3779b97f4a7c15ULL + 1;
+}
+
+/* Check the iterator returns exactly the present keys */
+static int iter_check(hmap_t m, const char *present)
+{
+	static char seen[NKEYS];
+	struct hmap_iter_s it;
+	struct hmap_ent_s ent;
+	size_t n = 0;
+	int i;
+
+	memset(seen, 0, sizeof(seen));
+	hmap_iter_init(&it, m);
+	while (0 == hmap_iter_next(&it, &ent)) {
+		i = (int)ent.obj;
+		if (i < 0 || i >= NKEYS || !present[i] || seen[i] ||
+		    ent.key.u64 != test_key(i))
+			return 0;
+		seen[i] = 1;
+		n++;
+	}
+	return n == hmap_count(m);
+}
+
+static int attr_cmp(const void *a, const void *b, size_t key_len)
+{
+	return strncmp(a, b, key_len);
+}
+
+int main(int argc, char *argv[])
+{
+	static char present[NKEYS];
+	static char names[NKEYS][16];
+	int i, k, op, rc, errs = 0, iters = 0, iter_errs = 0;
+	size_t count = 0;
+	uint64_t obj;
+	hmap_t m;
+
+	/* Random operations on a growing and shrinking set of u64 keys */
+	m = hmap_u64_new(0);
+	TEST_ASSERT(m != NULL, "hmap_u64_new\n");
+	srandom(1);
+	for (i = 0; i < NOPS; i++) {
+		k = random() % NKEYS;
+		op = random() % 3;
+		if (i > NOPS / 2)
+			op = random() % 4 ? 2 : op;	/* mostly deletes */
+		switch (op) {
+		case 0:
+			rc = hmap_u64_ins(m, test_key(k), k);
+			if (rc != (present[k] ? EEXIST : 0))
+				errs++;
+			if (!present[k]) {
+				present[k] = 1;
+				count++;
+			}
+			break;
+		case 1:
+			rc = hmap_u64_find(m, test_key(k), &obj);
+			if (rc != (present[k] ? 0 : ENOENT) ||
+			    (!rc && obj != k))
+				errs++;
+			break;
+		case 2:
+			rc = hmap_u64_del(m, test_key(k), &obj);
+			if (rc != (present[k] ? 0 : ENOENT) ||
+			    (!rc && obj != k))
+				errs++;
+			if (present[k]) {
+				present[k] = 0;
+				count--;
+			}
+			break;
+		}
+		if (hmap_count(m) != count)
+			errs++;
+		if (m->old.slots && (i & 0xff) == 0) {
+			iters++;
+			iter_errs += !iter_check(m, present);
+		}
+	}
+	TEST_ASSERT(errs == 0, "u64 random operations, %d errors\n", errs);
+	TEST_ASSERT(iters > 0 && iter_errs == 0,
+		    "iteration during resize, %d of %d wrong\n",
+		    iter_errs, iters);
+	TEST_ASSERT(iter_check(m, present), "iteration after resize\n");
+	errs += iter_errs;
+	hmap_free(m);
+
+	/* String keys, growing from the smallest table */
+	m = hmap_str_new(0);
+	for (i = 0; i < NKEYS; i++) {
+		snprintf(names[i], sizeof(names[i]), "key%d", i);
+		if (hmap_str_ins(m, names[i], i))
+			errs++;
+	}
+	for (i = 0; i < NKEYS; i++) {
+		char key[16];
+		snprintf(key, sizeof(key), "key%d", i);
+		if (hmap_str_find(m, key, &obj) || obj != i)
+			errs++;
+		if (hmap_str_ins(m, key, i) != EEXIST)
+			errs++;
+	}
+	if (hmap_str_find(m, "key", &obj) != ENOENT)
+		errs++;
+	for (i = 0; i < NKEYS; i += 2)
+		if (hmap_str_del(m, names[i], NULL))
+			errs++;
+	for (i = 0; i < NKEYS; i++)
+		if (hmap_str_find(m, names[i], &obj) != (i & 1 ? 0 : ENOENT))
+			errs++;
+	TEST_ASSERT(errs == 0 && hmap_count(m) == NKEYS / 2,
+		    "string keys\n");
+	hmap_free(m);
+
+	/* Byte keys with a caller comparator */
+	m = hmap_new(8, NULL, attr_cmp);
+	for (i = 0; i < 100; i++)
+		if (hmap_ins(m, names[i], strlen(names[i]) + 1, i))
+			errs++;
+	for (i = 0; i < 100; i++)
+		if (hmap_find(m, names[i], strlen(names[i]) + 1, &obj) ||
+		    obj != i)
+			errs++;
+	if (hmap_find(m, names[1], strlen(names[1]), &obj) != ENOENT)
+		errs++;
+	TEST_ASSERT(errs == 0, "byte keys\n");
+	hmap_free(m);
+
+	return errs ? 1 : 0;
+}
+#endif
@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file hmap.h
+ * \brief Resizable open-addressing hash map.
+ *
+ * \c hmap maps keys to objects that can be encoded in \c uint64_t
+ * (integers and \c void*). Entries are kept in a single array of slots
+ * using Robin Hood linear probing, so a lookup touches one or two cache
+ * lines instead of following a chain.
+ *
+ * The table doubles when it is 7/8 full. The entries of the old table are
+ * moved to the new one a few slots at a time by the following insert and
+ * delete calls, so no single call pays for moving the whole table.
+ *
+ * Three kinds of keys are supported:
+ * - byte sequences with a caller supplied length (::hmap_new()),
+ * - NUL-terminated strings (::hmap_str_new()),
+ * - \c uint64_t values stored in the slot (::hmap_u64_new()).
+ *
+ * Byte and string keys are not copied; the caller must keep the key
+ * memory valid while the entry is in the map.
+ */
+#ifndef __HMAP_H__
+#define __HMAP_H__
+#include <inttypes.h>
+#include <stddef.h>
+
+typedef struct hmap *hmap_t;
+
+typedef uint64_t (*hmap_hash_fn_t)(const void *key, size_t key_len);
+typedef int (*hmap_cmp_fn_t)(const void *a, const void *b, size_t key_len);
+
+/**
+ * \brief Create a map of byte sequence keys.
+ *
+ * \param count_hint The expected number of entries; the map is sized so
+ *                   that it does not grow before this many entries.
+ * \param hash_fn The key hash function, or NULL for 64-bit FNV-1a.
+ * \param cmp_fn The key comparison function, or NULL for \c memcmp().
+ *               It is only called for keys of equal length.
+ * \returns The new map, or NULL with \c errno set.
+ */
+hmap_t hmap_new(size_t count_hint, hmap_hash_fn_t hash_fn, hmap_cmp_fn_t cmp_fn);
+
+/**
+ * \brief Create a map of NUL-terminated string keys.
+ */
+hmap_t hmap_str_new(size_t count_hint);
+
+/**
+ * \brief Create a map of \c uint64_t keys.
+ */
+hmap_t hmap_u64_new(size_t count_hint);
+
+/**
+ * \brief Free the map. The keys are not freed. Ignores NULL input.
+ */
+void hmap_free(hmap_t m);
+
+/**
+ * \brief The number of entries in the map.
+ */
+size_t hmap_count(hmap_t m);
+
+/**
+ * \brief Insert an entry.
+ * \retval 0      The entry was inserted.
+ * \retval EEXIST The key is already in the map.
+ * \retval ENOMEM The table could not grow.
+ */
+int hmap_ins(hmap_t m, const void *key, size_t key_len, uint64_t obj);
+
+/**
+ * \brief Find the object of a key.
+ * \param obj Set to the object if the key is found.
+ * \retval 0      The key was found.
+ * \retval ENOENT The key is not in the map.
+ */
+int hmap_find(hmap_t m, const void *key, size_t key_len, uint64_t *obj);
+
+/**
+ * \brief Delete the entry of a key.
+ * \param obj If not NULL, set to the object of the deleted entry.
+ * \retval 0      The entry was deleted.
+ * \retval ENOENT The key is not in the map.
+ */
+int hmap_del(hmap_t m, const void *key, size_t key_len, uint64_t *obj);
+
+/* String key versions of the above */
+int hmap_str_ins(hmap_t m, const char *key, uint64_t obj);
+int hmap_str_find(hmap_t m, const char *key, uint64_t *obj);
+int hmap_str_del(hmap_t m, const char *key, uint64_t *obj);
+
+/* uint64_t key versions of the above */
+int hmap_u64_ins(hmap_t m, uint64_t key, uint64_t obj);
+int hmap_u64_find(hmap_t m, uint64_t key, uint64_t *obj);
+int hmap_u64_del(hmap_t m, uint64_t key, uint64_t *obj);
+
+/**
+ * An entry returned by ::hmap_iter_next().
+ */
+struct hmap_ent_s {
+	union {
+		const void *ptr;	/* byte and string keys */
+		uint64_t u64;		/* uint64_t keys */
+	} key;
+	size_t key_len;			/* 0 for uint64_t keys */
+	uint64_t obj;
+};
+
+/**
+ * Iterator over the entries of a map in no particular order.
+ *
+ * Inserting or deleting entries invalidates the iterator.
+ */
+typedef struct hmap_iter_s {
+	hmap_t map;
+	int tbl;
+	size_t idx;
+} *hmap_iter_t;
+
+/**
+ * \brief Position the iterator before the first entry of the map.
+ */
+void hmap_iter_init(hmap_iter_t it, hmap_t m);
+
+/**
+ * \brief Get the next entry.
+ * \retval 0      \c ent is set to the next entry.
+ * \retval ENOENT There are no more entries.
+ */
+int hmap_iter_next(hmap_iter_t it, struct hmap_ent_s *ent);
+
+#endif
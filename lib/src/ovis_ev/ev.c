@@ -122,6 +122,20 @@ int ev_canceled(ev_t ev)
 	return (e->e_status == EV_FLUSH);
 }
 
+/* Queue an immediate event and wake up a thread of \c w if they all sleep */
+static void __ev_queue(ev_worker_t w, ev__t e)
+{
+	int depth;
+
+	e->e_post_ns = ev_now_ns();
+	ev_q_push(w, &e->e_qnode);
+	depth = __sync_add_and_fetch(&w->w_ev_list_len, 1);
+	if (depth > w->w_depth_max)
+		w->w_depth_max = depth;	/* racy, but only a statistic */
+	if (__atomic_load_n(&w->w_idle, __ATOMIC_SEQ_CST))
+		sem_post(&w->w_sem);
+}
+
 int ev_post(ev_worker_t src, ev_worker_t dst, ev_t ev, struct timespec *to)
 {
 	ev__t e = EV(ev);
@@ -144,19 +158,24 @@ int ev_post(ev_worker_t src, ev_worker_t dst, ev_t ev, struct timespec *to)
 
 	e->e_src = src;
 	e->e_dst = dst;
-	rbn_init(&e->e_to_rbn, &e->e_to);
 
+	if (!to) {
+		/* The immediate events do not take the worker lock */
+		if (dst->w_state == EV_WORKER_FLUSHING) {
+			e->e_posted = 0;
+			return EBUSY;
+		}
+		ev_get(&e->e_ev);
+		__ev_queue(dst, e);
+		return 0;
+	}
+
+	rbn_init(&e->e_to_rbn, &e->e_to);
 	pthread_mutex_lock(&dst->w_lock);
 	if (dst->w_state == EV_WORKER_FLUSHING)
 		goto err;
 	ev_get(&e->e_ev);
-	if (to) {
-		rbt_ins(&dst->w_event_tree, &e->e_to_rbn);
-	} else {
-		__sync_fetch_and_add(&dst->w_ev_list_len, 1);
-		TAILQ_INSERT_TAIL(&dst->w_event_list, e, e_entry);
-
-	}
+	rbt_ins(&dst->w_event_tree, &e->e_to_rbn);
 	rc = (ev_time_cmp(&e->e_to, &dst->w_sem_wait) <= 0);
 	pthread_mutex_unlock(&dst->w_lock);
 	if (rc)
@@ -196,12 +215,9 @@ int ev_cancel(ev_t ev)
 	}
 
 	rbt_del(&e->e_dst->w_event_tree, &e->e_to_rbn);
-	__sync_fetch_and_add(&e->e_dst->w_ev_list_len, 1);
-	TAILQ_INSERT_TAIL(&e->e_dst->w_event_list, e, e_entry);
+	__ev_queue(e->e_dst, e);
  out:
 	pthread_mutex_unlock(&e->e_dst->w_lock);
-	if (!rc)
-		sem_post(&e->e_dst->w_sem);
 	return rc;
 }
 
@@ -68,6 +68,25 @@ void ev_put(ev_t ev);
  */
 ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn);
 
+/**
+ * \brief Creates a worker with a pool of threads
+ *
+ * Like ev_worker_new(), but the events of the worker are delivered by
+ * \c threads threads. The actors of a pool must be thread-safe, and
+ * the events posted to it are delivered concurrently, so their
+ * delivery order is unspecified.
+ *
+ * \param name The worker name
+ * \param actor_fn A pointer to the worker's actor function
+ * \param threads The number of threads
+ * \retval 0 The worker was created
+ * \retval EINVAL An invalid argument was specified
+ * \retval ENOMEM Insufficient resources
+ * \retval EEXIST A worker named \c name already exists
+ */
+ev_worker_t ev_worker_pool_new(const char *name, ev_actor_t actor_fn,
+			       int threads);
+
 /**
  * \brief Return the worker's name
  *
@@ -299,4 +318,44 @@ double ev_time_diff(struct timespec *tsa, const struct timespec *tsb);
  */
 int ev_pending(ev_worker_t w);
 
+struct ev_worker_stats_s {
+	int threads;		/* threads of the worker */
+	int timed;		/* events waiting for their timeout */
+	int queue_depth;	/* immediate events waiting for a thread */
+	int queue_depth_max;
+	uint64_t processed;	/* events delivered */
+	uint64_t queued;	/* immediate events delivered */
+	double wait_avg_us;	/* from ev_post() to the actor, immediate events */
+	double wait_max_us;
+};
+
+/**
+ * \brief Get the statistics of a worker
+ *
+ * The statistics accumulate from the creation of the worker or the
+ * last ev_worker_stats_reset().
+ *
+ * \param w Worker
+ * \param stats Receives the statistics
+ */
+void ev_worker_stats(ev_worker_t w, struct ev_worker_stats_s *stats);
+
+/**
+ * \brief Reset the accumulated statistics of a worker
+ * \param w Worker
+ */
+void ev_worker_stats_reset(ev_worker_t w);
+
+/**
+ * \brief Call \c fn for each worker
+ *
+ * The iteration stops when \c fn returns non-zero. Workers cannot be
+ * created from \c fn.
+ *
+ * \param fn The function to call
+ * \param arg Passed to \c fn
+ * \returns The last value returned by \c fn
+ */
+int ev_worker_iter(int (*fn)(ev_worker_t w, void *arg), void *arg);
+
 #endif
@@ -14,6 +14,11 @@ struct ev_type_s {
 	size_t t_size;
 };
 
+/* A link of the immediate event queue of a worker */
+struct ev_qnode_s {
+	struct ev_qnode_s *next;
+};
+
 typedef struct ev__s {
 	ev_worker_t e_src;
 	ev_worker_t e_dst;
@@ -23,7 +28,8 @@ typedef struct ev__s {
 	ev_status_t e_status;
 	struct timespec e_to;
 	struct rbn e_to_rbn;
-	TAILQ_ENTRY(ev__s) e_entry;
+	uint64_t e_post_ns;	/* when an immediate event was queued */
+	struct ev_qnode_s e_qnode;
 	struct ev_s e_ev;
 } *ev__t;
 
@@ -33,24 +39,61 @@ enum evw_state_e {
 	EV_WORKER_FLUSHING
 };
 
+/* The most immediate events a worker thread takes from the queue at once */
+#define EV_BATCH 32
+
 struct ev_worker_s {
 	char *w_name;
 	ev_actor_t w_actor;
-	pthread_t w_thread;
+	int w_thread_count;
+	pthread_t *w_threads;
 	enum evw_state_e w_state;
 	struct timespec w_sem_wait;
 	sem_t w_sem;
+	int w_idle;		/* threads waiting on w_sem */
 	struct rbn w_rbn;
 	pthread_mutex_t w_lock;
 	ev_actor_t *w_dispatch;
 	size_t w_dispatch_len;
 	/* An ordered tree of events with timeouts */
 	struct rbt w_event_tree;
-	/* A list of events without timeouts */
-	TAILQ_HEAD(w_event_list, ev__s) w_event_list;
+	/*
+	 * The events without timeouts are in an intrusive queue that
+	 * ev_post() appends to without a lock. The worker threads take
+	 * the events from w_q_tail under w_pop_lock, which is only
+	 * contended by the threads of a pool.
+	 */
+	struct ev_qnode_s *w_q_head __attribute__((aligned(64)));
 	int w_ev_list_len;
+	struct ev_qnode_s *w_q_tail __attribute__((aligned(64)));
+	struct ev_qnode_s w_q_stub;
+	pthread_mutex_t w_pop_lock;
+	int w_batch;
+	/* Statistics, see ev_worker_stats() */
+	int w_depth_max;	/* set by ev_post() */
+	uint64_t w_timed;	/* under w_lock */
+	uint64_t w_queued;	/* the rest under w_pop_lock */
+	uint64_t w_wait_ns;
+	uint64_t w_wait_max_ns;
 };
 
 #define EV(_e_) container_of(_e_, struct ev__s, e_ev);
+
+/* Append \c n to the immediate event queue of \c w, any thread may call */
+static inline void ev_q_push(ev_worker_t w, struct ev_qnode_s *n)
+{
+	struct ev_qnode_s *prev;
+
+	n->next = NULL;
+	prev = __atomic_exchange_n(&w->w_q_head, n, __ATOMIC_ACQ_REL);
+	__atomic_store_n(&prev->next, n, __ATOMIC_RELEASE);
+}
+
+static inline uint64_t ev_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 #endif
 
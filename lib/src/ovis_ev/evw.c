@@ -44,35 +44,92 @@ int ev_time_cmp(struct timespec *tsa, const struct timespec *tsb)
 }
 
 /*
- * Process all of the events in the worker's event list.
+ * Take the next immediate event from the queue, NULL if the queue is
+ * empty or an ev_post() has not finished linking its event yet.
  *
- * Called with the worker lock held.
+ * Called with w_pop_lock held.
  */
-static void process_immediate_events(ev_worker_t w)
+static ev__t ev_q_pop(ev_worker_t w)
 {
+	struct ev_qnode_s *tail = w->w_q_tail;
+	struct ev_qnode_s *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+	if (tail == &w->w_q_stub) {
+		if (!next)
+			return NULL;
+		w->w_q_tail = tail = next;
+		next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	}
+	if (next)
+		goto out;
+	if (tail != __atomic_load_n(&w->w_q_head, __ATOMIC_ACQUIRE))
+		return NULL;
+	/* tail is the last event, put the stub behind it */
+	ev_q_push(w, &w->w_q_stub);
+	next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	if (!next)
+		return NULL;
+ out:
+	w->w_q_tail = next;
+	return container_of(tail, struct ev__s, e_qnode);
+}
+
+/* The delivery statistics a worker thread accumulates between batches */
+struct ev_wait_s {
+	uint64_t count;
+	uint64_t wait_ns;
+	uint64_t wait_max_ns;
+};
+
+/*
+ * Process the events in the worker's event queue. The events are taken
+ * from the queue w_batch at a time.
+ */
+static void process_immediate_events(ev_worker_t w, struct ev_wait_s *acc)
+{
+	ev__t batch[EV_BATCH];
 	ev__t e;
 	ev_actor_t actor;
+	uint64_t wait;
+	int i, n;
  next:
-	if (TAILQ_EMPTY(&w->w_event_list))
+	pthread_mutex_lock(&w->w_pop_lock);
+	w->w_queued += acc->count;
+	w->w_wait_ns += acc->wait_ns;
+	if (acc->wait_max_ns > w->w_wait_max_ns)
+		w->w_wait_max_ns = acc->wait_max_ns;
+	memset(acc, 0, sizeof(*acc));
+	for (n = 0; n < w->w_batch; n++) {
+		batch[n] = ev_q_pop(w);
+		if (!batch[n])
+			break;
+	}
+	pthread_mutex_unlock(&w->w_pop_lock);
+	if (!n)
 		return;
 
-	e = TAILQ_FIRST(&w->w_event_list);
-	TAILQ_REMOVE(&w->w_event_list, e, e_entry);
-	__sync_fetch_and_sub(&w->w_ev_list_len, 1);
-	e->e_posted = 0;
+	for (i = 0; i < n; i++) {
+		e = batch[i];
+		__sync_fetch_and_sub(&w->w_ev_list_len, 1);
+		e->e_posted = 0;
 
-	if (w->w_state == EV_WORKER_FLUSHING)
-		e->e_status = EV_FLUSH;
+		if (w->w_state == EV_WORKER_FLUSHING)
+			e->e_status = EV_FLUSH;
 
-	pthread_mutex_unlock(&w->w_lock);
-	actor = NULL;
-	if (e->e_type->t_id < w->w_dispatch_len)
-		actor = w->w_dispatch[e->e_type->t_id];
-	if (!actor)
-		actor = w->w_actor;
-	actor(e->e_src, e->e_dst, e->e_status, &e->e_ev);
-	ev_put(&e->e_ev);
-	pthread_mutex_lock(&w->w_lock);
+		wait = ev_now_ns() - e->e_post_ns;
+		acc->count++;
+		acc->wait_ns += wait;
+		if (wait > acc->wait_max_ns)
+			acc->wait_max_ns = wait;
+
+		actor = NULL;
+		if (e->e_type->t_id < w->w_dispatch_len)
+			actor = w->w_dispatch[e->e_type->t_id];
+		if (!actor)
+			actor = w->w_actor;
+		actor(e->e_src, e->e_dst, e->e_status, &e->e_ev);
+		ev_put(&e->e_ev);
+	}
 	goto next;
 }
 
@@ -105,6 +162,7 @@ static ev__t process_to_events(ev_worker_t w)
 
 	rbt_del(&w->w_event_tree, &e->e_to_rbn);
 	e->e_posted = 0;
+	w->w_timed++;
 	pthread_mutex_unlock(&w->w_lock);
 	actor = NULL;
 	if (e->e_type->t_id < w->w_dispatch_len)
@@ -131,22 +189,36 @@ static void *worker_proc(void *arg)
 {
 	ev__t e;
 	ev_worker_t w = arg;
-	w->w_state = EV_WORKER_RUNNING;
-	ev_sched_to(&w->w_sem_wait, 0, 0);
-	sem_timedwait(&w->w_sem, &w->w_sem_wait);
+	struct ev_wait_s acc = {};
+	struct timespec wait;
+
 	while (1) {
+		process_immediate_events(w, &acc);
 		pthread_mutex_lock(&w->w_lock);
-		process_immediate_events(w);
 		e = process_to_events(w);
 		if (e) {
-			w->w_sem_wait = e->e_to;
+			wait = e->e_to;
 		} else {
-			ev_sched_to(&w->w_sem_wait, 10, 0);
+			ev_sched_to(&wait, 10, 0);
 		}
+		/*
+		 * The last thread to go to sleep wakes up for the
+		 * earliest timeout, see ev_post()
+		 */
+		w->w_sem_wait = wait;
 		if (w->w_state == EV_WORKER_FLUSHING)
 			w->w_state = EV_WORKER_RUNNING;
 		pthread_mutex_unlock(&w->w_lock);
-		sem_timedwait(&w->w_sem, &w->w_sem_wait);
+
+		/*
+		 * ev_post() queues and then checks w_idle, this thread
+		 * counts itself idle and then checks the queue, so one
+		 * of them sees the other.
+		 */
+		__atomic_add_fetch(&w->w_idle, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&w->w_ev_list_len, __ATOMIC_SEQ_CST) <= 0)
+			sem_timedwait(&w->w_sem, &wait);
+		__atomic_sub_fetch(&w->w_idle, 1, __ATOMIC_SEQ_CST);
 	}
 	return NULL;
 }
@@ -159,27 +231,41 @@ void ev_flush(ev_worker_t w)
 	sem_post(&w->w_sem);
 }
 
-ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn)
+ev_worker_t ev_worker_pool_new(const char *name, ev_actor_t actor_fn,
+			       int threads)
 {
 	int err = ENOMEM;
 	ev_worker_t w;
 	struct rbn *rbn;
+	size_t namelen, nameoff;
+	int i;
 
+	if (threads < 1) {
+		errno = EINVAL;
+		return NULL;
+	}
 	w = calloc(1, sizeof(*w));
 	if (!w)
 		goto err_0;
 	w->w_name = strdup(name);
 	if (!w->w_name)
 		goto err_1;
+	w->w_threads = calloc(threads, sizeof(*w->w_threads));
+	if (!w->w_threads)
+		goto err_1;
 	w->w_actor = actor_fn;
 	err = sem_init(&w->w_sem, 0, 0);
 	if (err)
-		goto err_2;
+		goto err_1;
 
-	w->w_state = EV_WORKER_STOPPED;
+	w->w_state = EV_WORKER_RUNNING;
 	pthread_mutex_init(&w->w_lock, NULL);
+	pthread_mutex_init(&w->w_pop_lock, NULL);
 	rbt_init(&w->w_event_tree, (int (*)(void *, const void*))ev_time_cmp);
-	TAILQ_INIT(&w->w_event_list);
+	w->w_q_head = w->w_q_tail = &w->w_q_stub;
+	/* A single thread drains in batches, a pool shares the events out */
+	w->w_batch = (threads == 1 ? EV_BATCH : 1);
+	ev_sched_to(&w->w_sem_wait, 0, 0);
 
 	pthread_mutex_lock(&worker_lock);
 	err = EEXIST;
@@ -188,22 +274,28 @@ ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn)
 		goto err_2;
 	rbn_init(&w->w_rbn, w->w_name);
 	rbt_ins(&worker_tree, &w->w_rbn);
-	pthread_mutex_unlock(&worker_lock);
 
-	err = pthread_create(&w->w_thread, NULL, worker_proc, w);
-	if (err)
+	/* Use the last 16 chars of the worker name */
+	namelen = strlen(w->w_name);
+	nameoff = (namelen > 15 ? namelen - 15 : 0);
+	for (i = 0; i < threads; i++) {
+		err = pthread_create(&w->w_threads[i], NULL, worker_proc, w);
+		if (err)
+			break;
+		pthread_setname_np(w->w_threads[i], &w->w_name[nameoff]);
+	}
+	if (!i) {
+		rbt_del(&worker_tree, &w->w_rbn);
 		goto err_2;
-	size_t namelen = strlen(w->w_name);
-	size_t nameoff = 0;
-	if (namelen > 15)
-		/* Use the last 16 chars of the worker name */
-		nameoff = namelen - 15;
-	pthread_setname_np(w->w_thread, &w->w_name[nameoff]);
+	}
+	w->w_thread_count = i;
+	pthread_mutex_unlock(&worker_lock);
 	errno = 0;
 	return w;
  err_2:
 	pthread_mutex_unlock(&worker_lock);
  err_1:
+	free(w->w_threads);
 	free(w->w_name);
  err_0:
 	free(w);
@@ -211,6 +303,11 @@ ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn)
 	return NULL;
 }
 
+ev_worker_t ev_worker_new(const char *name, ev_actor_t actor_fn)
+{
+	return ev_worker_pool_new(name, actor_fn, 1);
+}
+
 ev_worker_t ev_worker_get(const char *name)
 {
 	ev_worker_t w = NULL;
@@ -277,10 +374,63 @@ int ev_dispatch(ev_worker_t w, ev_type_t t, ev_actor_t fn)
 int ev_pending(ev_worker_t w)
 {
 	int count = 0;
+	int len;
 
 	pthread_mutex_lock(&w->w_lock);
 	count = rbt_card(&w->w_event_tree);
-	count += w->w_ev_list_len;
 	pthread_mutex_unlock(&w->w_lock);
+	/* Briefly negative while an ev_post() is finishing */
+	len = __atomic_load_n(&w->w_ev_list_len, __ATOMIC_RELAXED);
+	if (len > 0)
+		count += len;
 	return count;
 }
+
+void ev_worker_stats(ev_worker_t w, struct ev_worker_stats_s *stats)
+{
+	int len;
+
+	pthread_mutex_lock(&w->w_lock);
+	stats->timed = rbt_card(&w->w_event_tree);
+	stats->processed = w->w_timed;
+	pthread_mutex_unlock(&w->w_lock);
+	len = __atomic_load_n(&w->w_ev_list_len, __ATOMIC_RELAXED);
+	stats->queue_depth = (len > 0 ? len : 0);
+	stats->threads = w->w_thread_count;
+	pthread_mutex_lock(&w->w_pop_lock);
+	stats->queue_depth_max = w->w_depth_max;
+	stats->processed += w->w_queued;
+	stats->queued = w->w_queued;
+	stats->wait_avg_us = w->w_queued ?
+		(double)w->w_wait_ns / w->w_queued / 1000.0 : 0.0;
+	stats->wait_max_us = w->w_wait_max_ns / 1000.0;
+	pthread_mutex_unlock(&w->w_pop_lock);
+}
+
+void ev_worker_stats_reset(ev_worker_t w)
+{
+	pthread_mutex_lock(&w->w_lock);
+	w->w_timed = 0;
+	pthread_mutex_unlock(&w->w_lock);
+	pthread_mutex_lock(&w->w_pop_lock);
+	w->w_depth_max = 0;
+	w->w_queued = 0;
+	w->w_wait_ns = 0;
+	w->w_wait_max_ns = 0;
+	pthread_mutex_unlock(&w->w_pop_lock);
+}
+
+int ev_worker_iter(int (*fn)(ev_worker_t w, void *arg), void *arg)
+{
+	struct rbn *rbn;
+	int rc = 0;
+
+	pthread_mutex_lock(&worker_lock);
+	RBT_FOREACH(rbn, &worker_tree) {
+		rc = fn(container_of(rbn, struct ev_worker_s, w_rbn), arg);
+		if (rc)
+			break;
+	}
+	pthread_mutex_unlock(&worker_lock);
+	return rc;
+}
@@ -0,0 +1,291 @@
+/**
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Event posting benchmark.
+ *
+ * <producers> threads each post <count> immediate events to a worker
+ * of <threads> threads whose actor only counts them. Reports the
+ * events delivered per second, the producer CPU time per post and the
+ * statistics of the worker.
+ *
+ * Every event must be delivered exactly once and with a single worker
+ * thread the events of each producer must arrive in the order they were
+ * posted. Then <timed> events posted with decreasing timeouts must be
+ * delivered in timeout order.
+ *
+ * usage: ovis_ev_bench [-p <producers>] [-n <count>] [-t <threads>]
+ */
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "ev.h"
+
+static int producers = 4;
+static int count = 1000000;
+static int threads = 1;
+
+#define TIMED_EVENTS 100
+
+static ev_type_t bench_type;
+static ev_worker_t bench_w;
+static uint64_t delivered;
+static sem_t done;
+
+struct bench_data {
+	int producer;
+	int seq;
+};
+
+static int *next_seq;		/* the next seq expected of each producer */
+static int *recv_count;		/* the events received of each producer */
+static int order_errors;
+
+static int bench_actor(ev_worker_t src, ev_worker_t dst, ev_status_t status,
+		       ev_t ev)
+{
+	struct bench_data *d = EV_DATA(ev, struct bench_data);
+
+	if (status != EV_OK)
+		__sync_add_and_fetch(&order_errors, 1);
+	__sync_add_and_fetch(&recv_count[d->producer], 1);
+	if (threads == 1) {
+		if (d->seq != next_seq[d->producer])
+			order_errors++;
+		next_seq[d->producer] = d->seq + 1;
+	}
+	if (__sync_add_and_fetch(&delivered, 1) == (uint64_t)producers * count)
+		sem_post(&done);
+	return 0;
+}
+
+static int timed_next;
+static int timed_errors;
+static sem_t timed_done;
+
+static int timed_actor(ev_worker_t src, ev_worker_t dst, ev_status_t status,
+		       ev_t ev)
+{
+	struct bench_data *d = EV_DATA(ev, struct bench_data);
+
+	/* event i has the i-th earliest timeout */
+	if (status != EV_OK || d->seq != timed_next)
+		timed_errors++;
+	if (++timed_next == TIMED_EVENTS)
+		sem_post(&timed_done);
+	return 0;
+}
+
+/* post events with decreasing timeouts, they must arrive increasing */
+static int check_timed(void)
+{
+	struct timespec now, to;
+	ev_worker_t w;
+	ev_type_t t;
+	ev_t ev;
+	int i;
+
+	sem_init(&timed_done, 0, 0);
+	t = ev_type_new("bench_timed", sizeof(struct bench_data));
+	w = ev_worker_new("bench_timed", timed_actor);
+	if (!t || !w) {
+		printf("cannot create the timed worker, error %d\n", errno);
+		return 1;
+	}
+	clock_gettime(CLOCK_REALTIME, &now);
+	for (i = TIMED_EVENTS - 1; i >= 0; i--) {
+		ev = ev_new(t);
+		if (!ev) {
+			printf("ev_new error %d\n", errno);
+			return 1;
+		}
+		EV_DATA(ev, struct bench_data)->seq = i;
+		to = now;
+		ev_sched_to(&to, 0, (i + 1) * 1000000);
+		if (ev_post(NULL, w, ev, &to)) {
+			printf("ev_post error\n");
+			return 1;
+		}
+		ev_put(ev);
+	}
+	sem_wait(&timed_done);
+	if (timed_errors) {
+		printf("ERROR: %d of %d timed events out of order\n",
+		       timed_errors, TIMED_EVENTS);
+		return 1;
+	}
+	printf("%d timed events delivered in timeout order\n", TIMED_EVENTS);
+	return 0;
+}
+
+static double thread_cpu(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double *cpu;
+
+static void *producer_proc(void *arg)
+{
+	int p = (uintptr_t)arg;
+	double t0 = thread_cpu();
+	ev_t ev;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		ev = ev_new(bench_type);
+		if (!ev) {
+			printf("ev_new error %d\n", errno);
+			exit(1);
+		}
+		EV_DATA(ev, struct bench_data)->producer = p;
+		EV_DATA(ev, struct bench_data)->seq = i;
+		if (ev_post(NULL, bench_w, ev, NULL)) {
+			printf("ev_post error\n");
+			exit(1);
+		}
+		ev_put(ev);
+	}
+	cpu[p] = thread_cpu() - t0;
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec t0, t1;
+	struct ev_worker_stats_s stats;
+	pthread_t *thr;
+	double sum, secs;
+	int op, i, rc = 0;
+
+	while ((op = getopt(argc, argv, "p:n:t:")) != -1) {
+		switch (op) {
+		case 'p':
+			producers = atoi(optarg);
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-p <producers>] [-n <count>] "
+			       "[-t <threads>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (producers < 1 || count < 1 || threads < 1) {
+		printf("All parameters must be positive\n");
+		return 1;
+	}
+
+	sem_init(&done, 0, 0);
+	bench_type = ev_type_new("bench", sizeof(struct bench_data));
+	bench_w = ev_worker_pool_new("bench", bench_actor, threads);
+	if (!bench_type || !bench_w) {
+		printf("cannot create the worker, error %d\n", errno);
+		return 1;
+	}
+	thr = calloc(producers, sizeof(*thr));
+	cpu = calloc(producers, sizeof(*cpu));
+	next_seq = calloc(producers, sizeof(*next_seq));
+	recv_count = calloc(producers, sizeof(*recv_count));
+	if (!thr || !cpu || !next_seq || !recv_count) {
+		printf("out of memory\n");
+		return 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < producers; i++)
+		pthread_create(&thr[i], NULL, producer_proc,
+			       (void *)(uintptr_t)i);
+	for (i = 0, sum = 0; i < producers; i++) {
+		pthread_join(thr[i], NULL);
+		sum += cpu[i];
+	}
+	sem_wait(&done);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+	printf("%d producers x %d events, %d worker threads: "
+	       "%.0f events/s, %.3f us producer CPU/post\n",
+	       producers, count, threads, producers * count / secs,
+	       sum * 1e6 / ((double)producers * count));
+	/* the worker adds a batch to its statistics after delivering it */
+	for (i = 0; i < 1000; i++) {
+		ev_worker_stats(bench_w, &stats);
+		if (stats.processed >= (uint64_t)producers * count)
+			break;
+		usleep(1000);
+	}
+	printf("delivered %" PRIu64 ", max queue depth %d, "
+	       "wait avg %.1f us max %.1f us\n", stats.processed,
+	       stats.queue_depth_max, stats.wait_avg_us, stats.wait_max_us);
+	if (stats.processed != (uint64_t)producers * count) {
+		printf("ERROR: the worker counted %" PRIu64 " events, "
+		       "expected %" PRIu64 "\n", stats.processed,
+		       (uint64_t)producers * count);
+		rc = 1;
+	}
+	for (i = 0; i < producers; i++) {
+		if (recv_count[i] == count)
+			continue;
+		printf("ERROR: producer %d: %d of %d events delivered\n",
+		       i, recv_count[i], count);
+		rc = 1;
+	}
+	if (order_errors) {
+		printf("ERROR: %d events delivered out of order\n",
+		       order_errors);
+		rc = 1;
+	}
+	if (check_timed())
+		rc = 1;
+	return rc;
+}
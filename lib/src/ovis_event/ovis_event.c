@@ -54,7 +54,9 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <assert.h>
+#include <math.h>
 
 #define __TIMER_VALID(tv) ((tv)->tv_sec >= 0)
 
@@ -67,6 +69,9 @@ static
 void ovis_scheduler_destroy(ovis_scheduler_t m);
 
 static void __ovis_event_next_wakeup(const struct timeval *now, ovis_event_t ev);
+static void __ovis_event_next_expiry(const struct timeval *now,
+				     const struct timeval *sched_tv,
+				     ovis_event_t ev);
 
 static inline
 void ovis_scheduler_ref_get(ovis_scheduler_t m)
@@ -213,6 +218,382 @@ ovis_event_t ovis_event_heap_top(struct ovis_event_heap *h)
 	return NULL;
 }
 
+static inline
+uint64_t __tv_us(const struct timeval *tv)
+{
+	return (uint64_t)tv->tv_sec * USEC + tv->tv_usec;
+}
+
+static
+struct ovis_event_wheel *ovis_event_wheel_create()
+{
+	struct ovis_event_wheel *w = calloc(1, sizeof(*w));
+	struct timeval tv;
+	if (!w)
+		return NULL;
+	gettimeofday(&tv, NULL);
+	w->tick = __tv_us(&tv) / OVIS_WHEEL_TICK_US;
+	w->wakeup_tick = UINT64_MAX;
+	return w;
+}
+
+static inline
+void ovis_event_wheel_link(struct ovis_event_wheel *w, int idx, ovis_event_t ev)
+{
+	ovis_event_t *head = &w->slot[idx];
+	ev->priv.wnext = *head;
+	if (*head)
+		(*head)->priv.wpprev = &ev->priv.wnext;
+	*head = ev;
+	ev->priv.wpprev = head;
+	ev->priv.idx = idx;
+	if (idx < OVIS_WHEEL_SLOTS)
+		w->map[idx / 64] |= 1ULL << (idx % 64);
+}
+
+static inline
+void ovis_event_wheel_unlink(struct ovis_event_wheel *w, ovis_event_t ev)
+{
+	int idx = ev->priv.idx;
+	*ev->priv.wpprev = ev->priv.wnext;
+	if (ev->priv.wnext)
+		ev->priv.wnext->priv.wpprev = ev->priv.wpprev;
+	if (idx < OVIS_WHEEL_SLOTS && !w->slot[idx])
+		w->map[idx / 64] &= ~(1ULL << (idx % 64));
+	ev->priv.idx = -1;
+}
+
+/* Link the event to the slot of its expiration tick */
+static
+void ovis_event_wheel_place(struct ovis_event_wheel *w, ovis_event_t ev)
+{
+	uint64_t tick = ev->priv.tick;
+	uint64_t delta;
+	int lvl;
+
+	if (tick < w->tick)
+		tick = w->tick;
+	delta = tick - w->tick;
+	if (delta >> (OVIS_WHEEL_BITS * OVIS_WHEEL_LEVELS)) {
+		/* beyond the wheel; placed again when its slot expires */
+		delta = (1ULL << (OVIS_WHEEL_BITS * OVIS_WHEEL_LEVELS)) - 1;
+		tick = w->tick + delta;
+	}
+	for (lvl = 0; lvl < OVIS_WHEEL_LEVELS - 1; lvl++) {
+		if (!(delta >> (OVIS_WHEEL_BITS * (lvl + 1))))
+			break;
+	}
+	ovis_event_wheel_link(w, lvl * OVIS_WHEEL_SIZE +
+			((tick >> (OVIS_WHEEL_BITS * lvl)) & OVIS_WHEEL_MASK), ev);
+}
+
+static
+void ovis_event_wheel_insert(struct ovis_event_wheel *w, ovis_event_t ev,
+			     const struct timeval *now)
+{
+	uint64_t us = __tv_us(&ev->priv.tv);
+	if (!w->count) {
+		/* nothing to expire in between */
+		w->tick = __tv_us(now) / OVIS_WHEEL_TICK_US;
+	}
+	/* round up so that the event never expires early */
+	ev->priv.tick = (us + OVIS_WHEEL_TICK_US - 1) / OVIS_WHEEL_TICK_US;
+	if (ev->priv.tick <= w->tick)
+		ev->priv.tick = w->tick + 1;
+	ovis_event_wheel_place(w, ev);
+	w->count++;
+}
+
+static inline
+void ovis_event_wheel_remove(struct ovis_event_wheel *w, ovis_event_t ev)
+{
+	if (ev->priv.idx < 0)
+		return;
+	ovis_event_wheel_unlink(w, ev);
+	w->count--;
+}
+
+/*
+ * Returns the offset from \c start of the first non-empty slot of the level
+ * \c lvl, circularly, or -1 if the level is empty.
+ */
+static
+int ovis_event_wheel_level_next(struct ovis_event_wheel *w, int lvl, int start)
+{
+	const uint64_t *map = &w->map[lvl * OVIS_WHEEL_SIZE / 64];
+	int nwords = OVIS_WHEEL_SIZE / 64;
+	uint64_t bits;
+	int i, k;
+
+	for (i = 0; i <= nwords; i++) {
+		k = (start / 64 + i) % nwords;
+		bits = map[k];
+		if (i == 0)
+			bits &= ~0ULL << (start % 64);
+		else if (i == nwords)
+			bits &= ~(~0ULL << (start % 64));
+		if (bits) {
+			k = k * 64 + __builtin_ctzll(bits);
+			return (k - start + OVIS_WHEEL_SIZE) % OVIS_WHEEL_SIZE;
+		}
+	}
+	return -1;
+}
+
+/*
+ * The next tick at which a slot expires or cascades, UINT64_MAX if the wheel
+ * is empty. The events of a cascaded slot may still be further away.
+ */
+static
+uint64_t ovis_event_wheel_next_tick(struct ovis_event_wheel *w)
+{
+	uint64_t base, tick, next = UINT64_MAX;
+	int lvl, off, shift;
+
+	for (lvl = 0; lvl < OVIS_WHEEL_LEVELS; lvl++) {
+		shift = OVIS_WHEEL_BITS * lvl;
+		base = (w->tick >> shift) + 1;
+		off = ovis_event_wheel_level_next(w, lvl, base & OVIS_WHEEL_MASK);
+		if (off < 0)
+			continue;
+		tick = (base + off) << shift;
+		if (tick < next)
+			next = tick;
+	}
+	return next;
+}
+
+/* Move the events of a slot down to the lower levels or the due list */
+static
+void ovis_event_wheel_cascade(struct ovis_event_wheel *w, int idx)
+{
+	ovis_event_t ev, next;
+
+	ev = w->slot[idx];
+	w->slot[idx] = NULL;
+	w->map[idx / 64] &= ~(1ULL << (idx % 64));
+	for (; ev; ev = next) {
+		next = ev->priv.wnext;
+		if (idx < OVIS_WHEEL_SIZE && ev->priv.tick <= w->tick)
+			ovis_event_wheel_link(w, OVIS_WHEEL_DUE, ev);
+		else
+			ovis_event_wheel_place(w, ev);
+	}
+}
+
+/* Advance the wheel to \c now_tick moving the expired events to the due list */
+static
+void ovis_event_wheel_advance(struct ovis_event_wheel *w, uint64_t now_tick)
+{
+	uint64_t next, idx;
+	int lvl;
+
+	while (w->tick < now_tick) {
+		next = ovis_event_wheel_next_tick(w);
+		if (next > now_tick) {
+			w->tick = now_tick;
+			break;
+		}
+		/* nothing happens in between */
+		w->tick = next;
+		if (!(w->tick & OVIS_WHEEL_MASK)) {
+			for (lvl = 1; lvl < OVIS_WHEEL_LEVELS; lvl++) {
+				idx = (w->tick >> (OVIS_WHEEL_BITS * lvl))
+					& OVIS_WHEEL_MASK;
+				ovis_event_wheel_cascade(w,
+						lvl * OVIS_WHEEL_SIZE + idx);
+				if (idx)
+					break;
+			}
+		}
+		ovis_event_wheel_cascade(w, w->tick & OVIS_WHEEL_MASK);
+	}
+}
+
+#define OVIS_EVENT_DEQUE_INIT_LEN 16
+
+static
+int ovis_event_deque_push(struct ovis_event_deque *dq, ovis_event_t ev)
+{
+	ovis_event_t *a;
+	uint32_t i, alloc_len;
+
+	if (dq->len == dq->alloc_len) {
+		alloc_len = dq->alloc_len ? 2 * dq->alloc_len
+					  : OVIS_EVENT_DEQUE_INIT_LEN;
+		a = malloc(alloc_len * sizeof(*a));
+		if (!a)
+			return ENOMEM;
+		for (i = 0; i < dq->len; i++)
+			a[i] = dq->ev[(dq->head + i) % dq->alloc_len];
+		free(dq->ev);
+		dq->ev = a;
+		dq->alloc_len = alloc_len;
+		dq->head = 0;
+	}
+	dq->ev[(dq->head + dq->len) % dq->alloc_len] = ev;
+	dq->len++;
+	return 0;
+}
+
+/* The owner takes the oldest expiration */
+static inline
+ovis_event_t ovis_event_deque_pop(struct ovis_event_deque *dq)
+{
+	ovis_event_t ev;
+	if (!dq->len)
+		return NULL;
+	ev = dq->ev[dq->head];
+	dq->head = (dq->head + 1) % dq->alloc_len;
+	dq->len--;
+	return ev;
+}
+
+/* A thief takes from the other end */
+static inline
+ovis_event_t ovis_event_deque_steal(struct ovis_event_deque *dq)
+{
+	if (!dq->len)
+		return NULL;
+	dq->len--;
+	return dq->ev[(dq->head + dq->len) % dq->alloc_len];
+}
+
+static
+int ovis_event_deque_remove(struct ovis_event_deque *dq, ovis_event_t ev)
+{
+	uint32_t i;
+	for (i = 0; i < dq->len; i++) {
+		if (dq->ev[(dq->head + i) % dq->alloc_len] == ev)
+			break;
+	}
+	if (i == dq->len)
+		return ENOENT;
+	for (; i + 1 < dq->len; i++) {
+		dq->ev[(dq->head + i) % dq->alloc_len] =
+			dq->ev[(dq->head + i + 1) % dq->alloc_len];
+	}
+	dq->len--;
+	return 0;
+}
+
+static
+void __ovis_event_stats_update(ovis_event_t ev, const struct timeval *sched_tv,
+			       const struct timeval *now)
+{
+	struct timeval dtv;
+	uint64_t lat = 0;
+
+	if (timercmp(now, sched_tv, >)) {
+		timersub(now, sched_tv, &dtv);
+		lat = dtv.tv_sec * USEC + dtv.tv_usec;
+	}
+	if (!ev->priv.count || lat < ev->priv.lat_min_us)
+		ev->priv.lat_min_us = lat;
+	if (lat > ev->priv.lat_max_us)
+		ev->priv.lat_max_us = lat;
+	ev->priv.count++;
+	ev->priv.lat_sum_us += lat;
+	ev->priv.lat_sq_sum_us += (double)lat * lat;
+}
+
+/* Caller must hold m->mutex */
+static
+int __ovis_event_busy(ovis_scheduler_t m, ovis_event_t ev)
+{
+	int i;
+	if (ev->priv.worker >= 0)
+		return 1;
+	for (i = 0; i < m->nworkers; i++) {
+		if (m->workers[i].current == ev)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Queue the expired event to a worker deque. Caller must hold m->mutex.
+ */
+static
+void __ovis_event_dispatch(ovis_scheduler_t m, ovis_event_t ev,
+			   const struct timeval *sched_tv)
+{
+	int i;
+
+	if (__ovis_event_busy(m, ev)) {
+		ev->priv.overrun++;
+		return;
+	}
+	i = ev->priv.affinity;
+	if (i < 0 || i >= m->nworkers) {
+		i = m->next_worker;
+		m->next_worker = (i + 1) % m->nworkers;
+	}
+	if (ovis_event_deque_push(&m->workers[i].dq, ev)) {
+		ev->priv.overrun++;
+		return;
+	}
+	ev->priv.worker = i;
+	ev->priv.sched_tv = *sched_tv;
+	ev->cb.gen = ev->param.gen;
+	m->pending++;
+	pthread_cond_signal(&m->pool_cv);
+}
+
+/* Caller must hold m->mutex */
+static
+ovis_event_t __ovis_worker_steal(struct ovis_worker_s *w)
+{
+	ovis_scheduler_t m = w->m;
+	ovis_event_t ev;
+	int i, v;
+
+	if (!m->pending)
+		return NULL;
+	for (i = 1; i < m->nworkers; i++) {
+		v = (w->idx + i) % m->nworkers;
+		ev = ovis_event_deque_steal(&m->workers[v].dq);
+		if (ev)
+			return ev;
+	}
+	return NULL;
+}
+
+static
+void *__ovis_worker_proc(void *arg)
+{
+	struct ovis_worker_s *w = arg;
+	ovis_scheduler_t m = w->m;
+	struct timeval tv;
+	ovis_event_t ev;
+
+	pthread_mutex_lock(&m->mutex);
+	while (!m->pool_term) {
+		ev = ovis_event_deque_pop(&w->dq);
+		if (!ev)
+			ev = __ovis_worker_steal(w);
+		if (!ev) {
+			pthread_cond_wait(&m->pool_cv, &m->mutex);
+			continue;
+		}
+		m->pending--;
+		ev->priv.worker = -1;
+		ev->priv.affinity = w->idx;
+		w->current = ev;
+		gettimeofday(&tv, NULL);
+		__ovis_event_stats_update(ev, &ev->priv.sched_tv, &tv);
+		pthread_mutex_unlock(&m->mutex);
+		/* The callback may delete and free the event */
+		ev->param.cb_fn(ev);
+		pthread_mutex_lock(&m->mutex);
+		w->current = NULL;
+		if (m->done_waiters)
+			pthread_cond_broadcast(&m->done_cv);
+	}
+	pthread_mutex_unlock(&m->mutex);
+	return NULL;
+}
+
 static
 void __ovis_event_pipe_cb(ovis_event_t ev)
 {
@@ -238,11 +619,39 @@ static inline int __ovis_event_get_heap_size()
 	return strtoul(sz_str, NULL, 0);
 }
 
+static inline ovis_scheduler_timer_t __ovis_event_get_timer()
+{
+	char *s = getenv("OVIS_EVENT_TIMER");
+	if (s && 0 == strcasecmp(s, "wheel"))
+		return OVIS_SCHEDULER_TIMER_WHEEL;
+	return OVIS_SCHEDULER_TIMER_HEAP;
+}
+
 ovis_scheduler_t ovis_scheduler_new()
 {
-	int rc;
+	return ovis_scheduler_timer_new(OVIS_SCHEDULER_TIMER_DEFAULT, 0);
+}
+
+ovis_scheduler_t ovis_scheduler_pool_new(int nworkers)
+{
+	return ovis_scheduler_timer_new(OVIS_SCHEDULER_TIMER_DEFAULT, nworkers);
+}
+
+ovis_scheduler_t ovis_scheduler_timer_new(ovis_scheduler_timer_t timer,
+					  int nworkers)
+{
+	int rc, i;
 	uint32_t heap_sz;
-	ovis_scheduler_t m = calloc(1,sizeof(*m));
+	ovis_scheduler_t m;
+
+	if (timer == OVIS_SCHEDULER_TIMER_DEFAULT)
+		timer = __ovis_event_get_timer();
+	if (nworkers < 0 || (timer != OVIS_SCHEDULER_TIMER_HEAP &&
+			     timer != OVIS_SCHEDULER_TIMER_WHEEL)) {
+		errno = EINVAL;
+		return NULL;
+	}
+	m = calloc(1,sizeof(*m));
 	if (!m)
 		goto out;
 
@@ -251,6 +660,19 @@ ovis_scheduler_t ovis_scheduler_new()
 		free(m);
 		goto err2;
 	}
+	rc = pthread_cond_init(&m->pool_cv, NULL);
+	if (rc) {
+		pthread_mutex_destroy(&m->mutex);
+		free(m);
+		goto err2;
+	}
+	rc = pthread_cond_init(&m->done_cv, NULL);
+	if (rc) {
+		pthread_cond_destroy(&m->pool_cv);
+		pthread_mutex_destroy(&m->mutex);
+		free(m);
+		goto err2;
+	}
 	m->efd = -1;
 	m->pfd[0] = -1;
 	m->pfd[1] = -1;
@@ -259,10 +681,16 @@ ovis_scheduler_t ovis_scheduler_new()
 	m->refcount = 1;
 	m->state = OVIS_EVENT_MANAGER_INIT;
 
-	heap_sz = __ovis_event_get_heap_size();
-	m->heap = ovis_event_heap_create(heap_sz);
-	if (!m->heap)
-		goto err;
+	if (timer == OVIS_SCHEDULER_TIMER_WHEEL) {
+		m->wheel = ovis_event_wheel_create();
+		if (!m->wheel)
+			goto err;
+	} else {
+		heap_sz = __ovis_event_get_heap_size();
+		m->heap = ovis_event_heap_create(heap_sz);
+		if (!m->heap)
+			goto err;
+	}
 
 	m->efd = epoll_create(4096); /* size is ignored since Linux 2.6.8 */
 	if (m->efd == -1)
@@ -295,6 +723,26 @@ ovis_scheduler_t ovis_scheduler_new()
 	if (rc != 0)
 		goto err;
 
+	if (nworkers) {
+		m->workers = calloc(nworkers, sizeof(*m->workers));
+		if (!m->workers)
+			goto err;
+		for (i = 0; i < nworkers; i++) {
+			m->workers[i].idx = i;
+			m->workers[i].m = m;
+			rc = pthread_create(&m->workers[i].thread, NULL,
+					    __ovis_worker_proc, &m->workers[i]);
+			if (rc) {
+				errno = rc;
+				goto err;
+			}
+			/* only the started workers are joined */
+			pthread_mutex_lock(&m->mutex);
+			m->nworkers++;
+			pthread_mutex_unlock(&m->mutex);
+		}
+	}
+
 	goto out;
 
 err:
@@ -308,6 +756,20 @@ out:
 static
 void ovis_scheduler_destroy(ovis_scheduler_t m)
 {
+	int i;
+
+	if (m->workers) {
+		pthread_mutex_lock(&m->mutex);
+		m->pool_term = 1;
+		pthread_cond_broadcast(&m->pool_cv);
+		pthread_mutex_unlock(&m->mutex);
+		for (i = 0; i < m->nworkers; i++)
+			pthread_join(m->workers[i].thread, NULL);
+		for (i = 0; i < m->nworkers; i++)
+			free(m->workers[i].dq.ev);
+		free(m->workers);
+	}
+
 	if (m->efd >= 0)
 		close(m->efd);
 
@@ -320,6 +782,10 @@ void ovis_scheduler_destroy(ovis_scheduler_t m)
 	if (m->heap)
 		ovis_event_heap_free(m->heap);
 
+	free(m->wheel);
+
+	pthread_cond_destroy(&m->done_cv);
+	pthread_cond_destroy(&m->pool_cv);
 	pthread_mutex_destroy(&m->mutex);
 	free(m);
 }
@@ -337,8 +803,7 @@ void ovis_scheduler_free(ovis_scheduler_t m)
 static
 int ovis_event_heap_process(ovis_scheduler_t m)
 {
-	struct timeval tv, dtv;
-	uint64_t us;
+	struct timeval tv, dtv, sched_tv;
 	ovis_event_t ev;
 	int timeout = -1;
 
@@ -369,6 +834,7 @@ loop:
 	goto out;
 
 process_event:
+	sched_tv = ev->priv.tv;
 	switch (ev->param.type) {
 	case OVIS_EVENT_TIMEOUT:
 	case OVIS_EVENT_EPOLL_TIMEOUT:
@@ -381,17 +847,20 @@ process_event:
 	case OVIS_EVENT_PERIODIC:
 		/* periodic event application callback */
 		gettimeofday(&tv, NULL);
-		us = tv.tv_sec * USEC + tv.tv_usec;
-		us = ROUND(us, ev->param.periodic.period_us);
-		us += ev->param.periodic.phase_us;
-		ev->priv.tv.tv_sec = us / USEC;
-		ev->priv.tv.tv_usec = us % USEC;
+		__ovis_event_next_expiry(&tv, &sched_tv, ev);
 		ovis_event_heap_update(m->heap, ev->priv.idx);
 		ev->cb.type = OVIS_EVENT_PERIODIC;
 		break;
 	default:
 		assert(0 == "Unexpected event type");
 	}
+	if (m->nworkers) {
+		__ovis_event_dispatch(m, ev, &sched_tv);
+		pthread_mutex_unlock(&m->mutex);
+		goto loop;
+	}
+	__ovis_event_stats_update(ev, &sched_tv, &tv);
+	ev->cb.gen = ev->param.gen;
 	pthread_mutex_unlock(&m->mutex);
 	ev->param.cb_fn(ev);
 	goto loop;
@@ -402,6 +871,58 @@ out:
 	return timeout;
 }
 
+/**
+ * Process the expired events in the wheel and returns time-to-next-event.
+ *
+ * All events expired in the same tick are rescheduled in one pass; with a
+ * worker pool they are also dispatched without releasing the lock.
+ *
+ * \retval timeout the timeout (milliseconds) to the next event.
+ */
+static
+int ovis_event_wheel_process(ovis_scheduler_t m)
+{
+	struct ovis_event_wheel *w = m->wheel;
+	struct timeval tv, sched_tv;
+	uint64_t next, us;
+	ovis_event_t ev;
+	int timeout = -1;
+
+	pthread_mutex_lock(&m->mutex);
+loop:
+	gettimeofday(&tv, NULL);
+	ovis_event_wheel_advance(w, __tv_us(&tv) / OVIS_WHEEL_TICK_US);
+	while ((ev = w->slot[OVIS_WHEEL_DUE])) {
+		ovis_event_wheel_remove(w, ev);
+		sched_tv = ev->priv.tv;
+		__ovis_event_next_expiry(&tv, &sched_tv, ev);
+		ovis_event_wheel_insert(w, ev, &tv);
+		ev->cb.type = (ev->param.type == OVIS_EVENT_PERIODIC)?
+				OVIS_EVENT_PERIODIC:OVIS_EVENT_TIMEOUT;
+		if (m->nworkers) {
+			__ovis_event_dispatch(m, ev, &sched_tv);
+			continue;
+		}
+		__ovis_event_stats_update(ev, &sched_tv, &tv);
+		ev->cb.gen = ev->param.gen;
+		pthread_mutex_unlock(&m->mutex);
+		ev->param.cb_fn(ev);
+		pthread_mutex_lock(&m->mutex);
+		goto loop;
+	}
+	next = ovis_event_wheel_next_tick(w);
+	w->wakeup_tick = next;
+	if (next != UINT64_MAX) {
+		us = next * OVIS_WHEEL_TICK_US;
+		timeout = (us > __tv_us(&tv))?
+				(us - __tv_us(&tv) + 999) / 1000 : 0;
+	}
+	if (m->state == OVIS_EVENT_MANAGER_RUNNING)
+		m->state = OVIS_EVENT_MANAGER_WAITING;
+	pthread_mutex_unlock(&m->mutex);
+	return timeout;
+}
+
 static
 int __ovis_event_timer_update(ovis_scheduler_t m, ovis_event_t ev)
 {
@@ -409,7 +930,12 @@ int __ovis_event_timer_update(ovis_scheduler_t m, ovis_event_t ev)
 	pthread_mutex_lock(&m->mutex);
 	gettimeofday(&tv, NULL);
 	timeradd(&tv, &ev->param.timeout, &ev->priv.tv);
-	ovis_event_heap_update(m->heap, ev->priv.idx);
+	if (m->wheel) {
+		ovis_event_wheel_remove(m->wheel, ev);
+		ovis_event_wheel_insert(m->wheel, ev, &tv);
+	} else {
+		ovis_event_heap_update(m->heap, ev->priv.idx);
+	}
 	pthread_mutex_unlock(&m->mutex);
 	return 0;
 }
@@ -509,9 +1035,37 @@ static void __ovis_event_next_wakeup(const struct timeval *now, ovis_event_t ev)
 	}
 }
 
+/*
+ * Reschedule an expired event. A periodic event expires one period after
+ * the time it was scheduled for, \c sched_tv, rather than at the period
+ * boundary following \c now; a callback that runs a little late then does
+ * not skip a period when the phase is close to the period. The missed
+ * expiries are skipped only when the event is more than a period behind.
+ */
+static void __ovis_event_next_expiry(const struct timeval *now,
+				     const struct timeval *sched_tv,
+				     ovis_event_t ev)
+{
+	uint64_t us, sched, period;
+
+	if (ev->param.type != OVIS_EVENT_PERIODIC) {
+		__ovis_event_next_wakeup(now, ev);
+		return;
+	}
+	period = ev->param.periodic.period_us;
+	sched = __tv_us(sched_tv);
+	us = __tv_us(now);
+	if (us >= sched + period)
+		sched += (us - sched) / period * period;
+	sched += period;
+	ev->priv.tv.tv_sec = sched / USEC;
+	ev->priv.tv.tv_usec = sched % USEC;
+}
+
 int ovis_scheduler_event_add(ovis_scheduler_t m, ovis_event_t ev)
 {
 	int rc = 0;
+	int notify;
 	ssize_t wb;
 
 	if (ev->param.type & OVIS_EVENT_EPOLL) {
@@ -535,18 +1089,24 @@ int ovis_scheduler_event_add(ovis_scheduler_t m, ovis_event_t ev)
 		}
 		pthread_mutex_lock(&m->mutex);
 		struct timeval tv;
+		ev->priv.worker = -1;
 		/* calculate wake up time */
 		gettimeofday(&tv, NULL);
 		__ovis_event_next_wakeup(&tv, ev);
-		rc = ovis_event_heap_insert(m->heap, ev);
-		if (rc) {
-			pthread_mutex_unlock(&m->mutex);
-			goto out;
+		if (m->wheel) {
+			ovis_event_wheel_insert(m->wheel, ev, &tv);
+			notify = (ev->priv.tick < m->wheel->wakeup_tick);
+		} else {
+			rc = ovis_event_heap_insert(m->heap, ev);
+			if (rc) {
+				pthread_mutex_unlock(&m->mutex);
+				goto out;
+			}
+			notify = (ev->priv.idx == 0);
 		}
 		m->evcount++;
 		/* notify only if the new event affect the next timeout */
-		if (m->state == OVIS_EVENT_MANAGER_WAITING
-				&& ev->priv.idx == 0) {
+		if (m->state == OVIS_EVENT_MANAGER_WAITING && notify) {
 			wb = write(m->pfd[1], &ev, sizeof(ev));
 			if (wb == -1) {
 				rc = errno;
@@ -585,8 +1145,18 @@ int ovis_scheduler_event_del(ovis_scheduler_t m, ovis_event_t ev)
 	}
 
 	pthread_mutex_lock(&m->mutex);
+	if (ev->priv.worker >= 0 && ev->priv.worker < m->nworkers) {
+		/* drop the pending expiration */
+		if (0 == ovis_event_deque_remove(&m->workers[ev->priv.worker].dq,
+						 ev))
+			m->pending--;
+		ev->priv.worker = -1;
+	}
 	if (ev->priv.idx >= 0) {
-		ovis_event_heap_remove(m->heap, ev);
+		if (m->wheel)
+			ovis_event_wheel_remove(m->wheel, ev);
+		else
+			ovis_event_heap_remove(m->heap, ev);
 		m->evcount--;
 		/* notify only last delete event */
 		if (m->state == OVIS_EVENT_MANAGER_WAITING && m->evcount == 0) {
@@ -603,11 +1173,65 @@ out:
 	return rc;
 }
 
+void ovis_scheduler_event_join(ovis_scheduler_t m, ovis_event_t ev)
+{
+	int i;
+
+	pthread_mutex_lock(&m->mutex);
+	for (i = 0; i < m->nworkers; i++) {
+		if (m->workers[i].current != ev ||
+		    pthread_equal(m->workers[i].thread, pthread_self()))
+			continue;
+		m->done_waiters++;
+		while (m->workers[i].current == ev)
+			pthread_cond_wait(&m->done_cv, &m->mutex);
+		m->done_waiters--;
+	}
+	pthread_mutex_unlock(&m->mutex);
+}
+
 void ovis_event_free(ovis_event_t ev)
 {
 	free(ev);
 }
 
+int ovis_event_stats_get(ovis_scheduler_t m, ovis_event_t ev,
+			 struct ovis_event_stats_s *st)
+{
+	double sum, sq_sum, var;
+
+	if (!(ev->param.type & (OVIS_EVENT_TIMEOUT|OVIS_EVENT_PERIODIC)))
+		return EINVAL;
+	memset(st, 0, sizeof(*st));
+	/* the statistics are updated under m->mutex */
+	pthread_mutex_lock(&m->mutex);
+	st->count = ev->priv.count;
+	st->overrun = ev->priv.overrun;
+	st->lat_min_us = ev->priv.lat_min_us;
+	st->lat_max_us = ev->priv.lat_max_us;
+	sum = ev->priv.lat_sum_us;
+	sq_sum = ev->priv.lat_sq_sum_us;
+	pthread_mutex_unlock(&m->mutex);
+	if (!st->count)
+		return 0;
+	st->lat_mean_us = sum / st->count;
+	var = sq_sum / st->count - st->lat_mean_us * st->lat_mean_us;
+	st->jitter_us = (var > 0) ? sqrt(var) : 0;
+	return 0;
+}
+
+void ovis_event_stats_reset(ovis_scheduler_t m, ovis_event_t ev)
+{
+	pthread_mutex_lock(&m->mutex);
+	ev->priv.count = 0;
+	ev->priv.overrun = 0;
+	ev->priv.lat_min_us = 0;
+	ev->priv.lat_max_us = 0;
+	ev->priv.lat_sum_us = 0;
+	ev->priv.lat_sq_sum_us = 0;
+	pthread_mutex_unlock(&m->mutex);
+}
+
 static
 int ovis_event_term_check(ovis_scheduler_t m)
 {
@@ -658,7 +1282,10 @@ int ovis_scheduler_loop(ovis_scheduler_t m, int return_on_empty)
 		goto out;
 
 loop:
-	timeout = ovis_event_heap_process(m);
+	if (m->wheel)
+		timeout = ovis_event_wheel_process(m);
+	else
+		timeout = ovis_event_heap_process(m);
 	pthread_mutex_lock(&m->mutex);
 	if (!m->evcount && return_on_empty) {
 		pthread_mutex_unlock(&m->mutex);
@@ -688,6 +1315,7 @@ loop:
 		ev = m->ev[i].data.ptr;
 		ev->cb.type = OVIS_EVENT_EPOLL;
 		ev->cb.epoll_events = m->ev[i].events;
+		ev->cb.gen = ev->param.gen;
 		if (ev->param.type & OVIS_EVENT_TIMEOUT && ev->priv.idx != -1) {
 			/* i/o event has an active timeout */
 			rc = __ovis_event_timer_update(m, ev);
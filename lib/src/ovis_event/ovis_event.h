@@ -65,6 +65,9 @@
  * typedef void (*ovis_event_cb)(ovis_event_t ev);
  *
  * ovis_scheduler_t ovis_scheduler_new();
+ * ovis_scheduler_t ovis_scheduler_pool_new(int nworkers);
+ * ovis_scheduler_t ovis_scheduler_timer_new(ovis_scheduler_timer_t timer,
+ *                                           int nworkers);
  * ovis_event_t ovis_event_epoll_new(ovis_event_cb_fn cb, void *ctxt,
  *                                   int fd, uint32_t epoll_events);
  * ovis_event_t ovis_event_timeout_new(ovis_event_cb_fn cb, void *ctxt,
@@ -76,7 +79,10 @@
  *                                      const struct ovis_periodic_s *p);
  * int ovis_scheduler_event_add(ovis_scheduler_t m, ovis_event_t ev);
  * int ovis_scheduler_event_del(ovis_scheduler_t m, ovis_event_t ev);
+ * void ovis_scheduler_event_join(ovis_scheduler_t m, ovis_event_t ev);
  * int ovis_scheduler_loop(struct ovis_scheduler *m, int return_on_empty);
+ * int ovis_event_stats_get(ovis_scheduler_t m, ovis_event_t ev,
+ *                          struct ovis_event_stats_s *st);
  * \endcode
  *
  *
@@ -112,6 +118,30 @@
  * event might have a slight wake up time slack, but it does not have
  * continuously time shifting like the timeout event.
  *
+ * A scheduler created by ::ovis_scheduler_pool_new() does not call timeout and
+ * periodic callbacks on the ::ovis_scheduler_loop() thread. Each expiration is
+ * queued to a deque of one of the pool's worker threads (the one that ran the
+ * event last) and a worker with an empty deque steals from the others, so a
+ * slow callback only holds up the worker running it. The wake-up times are
+ * still computed by the loop thread and are not affected by slow callbacks.
+ * An event is never called concurrently with itself; an expiration that
+ * happens while the event is queued or its callback is still running is
+ * skipped and counted as an overrun. Epoll events are always delivered on the
+ * ::ovis_scheduler_loop() thread.
+ *
+ * The scheduler keeps the timeout and periodic events either in a binary heap
+ * (O(log n) insert and removal, microsecond wake-up precision) or in a
+ * hierarchical timing wheel of millisecond ticks (O(1) insert and removal, and
+ * all events expiring in the same tick are handled in one pass). Use
+ * ::ovis_scheduler_timer_new() to choose one. The other constructors use the
+ * one named by the \c OVIS_EVENT_TIMER environment variable (\c "heap" or
+ * \c "wheel"), the heap by default. The heap holds at most
+ * \c OVIS_EVENT_HEAP_SIZE (default 16384) events; the wheel has no limit.
+ *
+ * ::ovis_event_stats_get() reports the number of callbacks of a timeout or
+ * periodic event, the overruns, and the latency from the scheduled wake-up time
+ * to the start of the callback together with its jitter.
+ *
  *
  * \section example EXAMPLE
  *
@@ -238,28 +268,72 @@ struct ovis_event_s {
 			struct ovis_periodic_s periodic;
 		};
 		void *ctxt;
+		uint64_t gen; /* application generation, see cb.gen */
 	} param;
 
 	/* callback information from ovis_scheduler to application */
 	struct {
 		ovis_event_type_t type; /* what causes the callback */
 		uint32_t epoll_events; /* for event = OVIS_EVENT_EPOLL */
+		/*
+		 * param.gen when the callback was dispatched; an application
+		 * that deletes and re-adds the event can compare the two to
+		 * drop a callback dispatched before the event was deleted.
+		 */
+		uint64_t gen;
 	} cb;
 
 	/* private data for ovis_scheduler */
 	struct {
 		struct timeval tv;
-		int idx;
+		int idx; /* heap index or wheel slot, -1 if not scheduled */
+		uint64_t tick; /* wheel expiration tick */
+		struct ovis_event_s *wnext; /* wheel slot list */
+		struct ovis_event_s **wpprev;
+		int worker; /* the worker deque holding the event, or -1 */
+		int affinity; /* the worker that ran the event last */
+		struct timeval sched_tv; /* the expiration being dispatched */
+		/* dispatch statistics, see ::ovis_event_stats_get() */
+		uint64_t count;
+		uint64_t overrun;
+		uint64_t lat_min_us;
+		uint64_t lat_max_us;
+		double lat_sum_us;
+		double lat_sq_sum_us;
 	} priv; /* private data for ovis_scheduler */
 };
 
-#define OVIS_EVENT_INITIALIZER {.param = {.fd=-1}, .priv = {.idx=-1},}
+#define OVIS_EVENT_INITIALIZER {.param = {.fd=-1}, \
+				.priv = {.idx=-1, .worker=-1, .affinity=-1},}
 
 #define OVIS_EVENT_INIT(ev) do {\
 	(ev)->param.fd = -1; \
 	(ev)->priv.idx = -1; \
+	(ev)->priv.worker = -1; \
+	(ev)->priv.affinity = -1; \
 } while(0)
 
+typedef enum ovis_scheduler_timer_e {
+	OVIS_SCHEDULER_TIMER_DEFAULT, /* OVIS_EVENT_TIMER, or the heap */
+	OVIS_SCHEDULER_TIMER_HEAP,
+	OVIS_SCHEDULER_TIMER_WHEEL,
+} ovis_scheduler_timer_t;
+
+/**
+ * Dispatch statistics of a timeout or periodic event.
+ *
+ * The latency is the time from the scheduled wake-up time to the start of the
+ * callback. The jitter is the standard deviation of the latency.
+ */
+struct ovis_event_stats_s {
+	uint64_t count; /* number of callbacks */
+	uint64_t overrun; /* expirations skipped, the callback was busy */
+	uint64_t lat_min_us;
+	uint64_t lat_max_us;
+	double lat_mean_us;
+	double jitter_us;
+};
+
 /**
  * Create an OVIS event scheduler.
  *
@@ -275,6 +349,37 @@ struct ovis_event_s {
  */
 ovis_scheduler_t ovis_scheduler_new();
 
+/**
+ * Create an OVIS event scheduler with a pool of \c nworkers worker threads.
+ *
+ * The timeout and periodic event callbacks are called on the worker threads
+ * instead of the ::ovis_scheduler_loop() thread. The worker threads are
+ * created by this call and are joined when the scheduler is freed.
+ *
+ * \param nworkers the number of worker threads. If it is 0, the scheduler is
+ *                 the same as one created by ::ovis_scheduler_new().
+ *
+ * \retval m a handle to \c ovis_scheduler.
+ * \retval NULL on failure. In this case, \c errno is also set to describe the
+ *              error.
+ */
+ovis_scheduler_t ovis_scheduler_pool_new(int nworkers);
+
+/**
+ * Create an OVIS event scheduler with the given timer implementation.
+ *
+ * \param timer \c OVIS_SCHEDULER_TIMER_HEAP, \c OVIS_SCHEDULER_TIMER_WHEEL or
+ *              \c OVIS_SCHEDULER_TIMER_DEFAULT.
+ * \param nworkers the number of worker threads, see
+ *                 ::ovis_scheduler_pool_new().
+ *
+ * \retval m a handle to \c ovis_scheduler.
+ * \retval NULL on failure. In this case, \c errno is also set to describe the
+ *              error.
+ */
+ovis_scheduler_t ovis_scheduler_timer_new(ovis_scheduler_timer_t timer,
+					  int nworkers);
+
 /**
  * Destroy the unused event manager.
  *
@@ -325,6 +430,10 @@ int ovis_scheduler_event_add(ovis_scheduler_t s, ovis_event_t ev);
 /**
  * Remove an event \c ev from the scheduler.
  *
+ * With a worker pool, a callback of \c ev that a worker has already taken
+ * may still be running, or about to run, when this returns. Call
+ * ovis_scheduler_event_join() before freeing the event or its context.
+ *
  * \param s the scheduler handle.
  * \param ev the event handle.
  *
@@ -333,6 +442,18 @@ int ovis_scheduler_event_add(ovis_scheduler_t s, ovis_event_t ev);
  */
 int ovis_scheduler_event_del(ovis_scheduler_t m, ovis_event_t ev);
 
+/**
+ * Wait for the callback of a removed event \c ev to return.
+ *
+ * With a worker pool, this returns once no worker other than the calling
+ * one is calling back \c ev. The caller must not hold a lock that the
+ * callback takes. Without workers this returns right away.
+ *
+ * \param s the scheduler handle.
+ * \param ev the event handle, removed by ovis_scheduler_event_del().
+ */
+void ovis_scheduler_event_join(ovis_scheduler_t m, ovis_event_t ev);
+
 /**
  * Modify epoll events of an ovis event \p ev in the scheduler \p s.
  *
@@ -349,6 +470,24 @@ int ovis_scheduler_epoll_event_mod(ovis_scheduler_t s, ovis_event_t ev,
  */
 void ovis_event_free(ovis_event_t ev);
 
+/**
+ * Get the dispatch statistics of the timeout or periodic event \c ev.
+ *
+ * \param m the scheduler that the event is, or was, added to.
+ * \param ev the event handle.
+ * \param[out] st the statistics.
+ *
+ * \retval 0 if OK.
+ * \retval EINVAL if \c ev is not a timeout or periodic event.
+ */
+int ovis_event_stats_get(ovis_scheduler_t m, ovis_event_t ev,
+			 struct ovis_event_stats_s *st);
+
+/**
+ * Reset the dispatch statistics of the event \c ev of the scheduler \c m.
+ */
+void ovis_event_stats_reset(ovis_scheduler_t m, ovis_event_t ev);
+
 /**
  * Event loop function for the scheduler \c m to manage and deliver events.
  * \param s the scheduler handle.
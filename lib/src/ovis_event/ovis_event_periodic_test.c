@@ -47,6 +47,21 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+/*
+ * usage: ovis_event_periodic_test [<period_ms>]
+ *        ovis_event_periodic_test -b [-n <timers>] [-p <period_ms>]
+ *                                 [-t <seconds>]
+ *        ovis_event_periodic_test -c
+ *
+ * The first form prints the wake-up times of a periodic event. The second
+ * form benchmarks the heap and the timing wheel schedulers with <timers>
+ * periodic events whose phases are spread over the period. It reports the
+ * add and delete cost per event, the CPU time per callback and the callback
+ * latency from the scheduled time. The third form checks that periodic
+ * events of the timing wheel that run a few milliseconds late, with a phase
+ * close to the period, still expire once per period.
+ */
+
 #include <assert.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -54,6 +69,7 @@
 #include <pthread.h>
 #include <time.h>
 #include <sys/time.h>
+#include <sys/resource.h>
 #include <stdlib.h>
 
 #include "ovis_event.h"
@@ -65,15 +81,213 @@ void cb(ovis_event_t ev)
 	printf("tv: %ld.%06ld\n", tv.tv_sec, tv.tv_usec);
 }
 
+static uint64_t bench_count;
+
+void bench_cb(ovis_event_t ev)
+{
+	bench_count++;
+}
+
+void *bench_loop(void *arg)
+{
+	ovis_scheduler_loop(arg, 0);
+	return NULL;
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double cpu_sec(void)
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+	       ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+}
+
+int bench(const char *name, ovis_scheduler_timer_t timer, int n,
+	  int period_ms, int seconds)
+{
+	ovis_scheduler_t sch;
+	ovis_event_t *ev;
+	struct ovis_periodic_s p;
+	struct ovis_event_stats_s st;
+	double t0, t_add, t_del, c0, c_run, lat = 0, lat_max = 0;
+	pthread_t thr;
+	char buf[32];
+	int i, rc;
+
+	/* let the heap hold all timers */
+	snprintf(buf, sizeof(buf), "%d", n);
+	setenv("OVIS_EVENT_HEAP_SIZE", buf, 1);
+	sch = ovis_scheduler_timer_new(timer, 0);
+	ev = calloc(n, sizeof(*ev));
+	assert(sch && ev);
+	p.period_us = period_ms * 1000;
+	for (i = 0; i < n; i++) {
+		p.phase_us = random() % p.period_us;
+		ev[i] = ovis_event_periodic_new(bench_cb, NULL, &p);
+		assert(ev[i]);
+	}
+	t0 = now_sec();
+	for (i = 0; i < n; i++) {
+		rc = ovis_scheduler_event_add(sch, ev[i]);
+		assert(rc == 0);
+	}
+	t_add = now_sec() - t0;
+
+	bench_count = 0;
+	c0 = cpu_sec();
+	rc = pthread_create(&thr, NULL, bench_loop, sch);
+	assert(rc == 0);
+	sleep(seconds);
+	ovis_scheduler_term(sch);
+	pthread_join(thr, NULL);
+	c_run = cpu_sec() - c0;
+
+	t0 = now_sec();
+	for (i = 0; i < n; i++)
+		ovis_scheduler_event_del(sch, ev[i]);
+	t_del = now_sec() - t0;
+
+	for (i = 0; i < n; i++) {
+		ovis_event_stats_get(sch, ev[i], &st);
+		lat += st.lat_mean_us * st.count;
+		if (st.lat_max_us > lat_max)
+			lat_max = st.lat_max_us;
+		ovis_event_free(ev[i]);
+	}
+	free(ev);
+	ovis_scheduler_free(sch);
+	printf("%-6s %8.0f %8.0f %10lu %10.2f %10.0f %10.0f\n", name,
+	       t_add * 1e9 / n, t_del * 1e9 / n, (unsigned long)bench_count,
+	       bench_count ? c_run * 1e6 / bench_count : 0,
+	       bench_count ? lat / bench_count : 0, lat_max);
+	return 0;
+}
+
+#define CHECK_PERIOD_US 255000
+#define CHECK_PHASE_US 253139
+#define CHECK_COUNT 6
+
+struct check_s {
+	struct timeval last;
+	int count;
+	uint64_t max_us;
+};
+
+static int check_done;
+
+void check_cb(ovis_event_t ev)
+{
+	struct check_s *c = ev->param.ctxt;
+	struct timeval tv;
+	uint64_t us;
+
+	gettimeofday(&tv, NULL);
+	if (c->count) {
+		us = (tv.tv_sec - c->last.tv_sec) * 1000000 +
+		     tv.tv_usec - c->last.tv_usec;
+		if (us > c->max_us)
+			c->max_us = us;
+	}
+	c->last = tv;
+	if (++c->count == CHECK_COUNT)
+		__atomic_add_fetch(&check_done, 1, __ATOMIC_SEQ_CST);
+	/* make the other event due at the same time run late */
+	usleep(3000);
+}
+
+int check(void)
+{
+	ovis_scheduler_t sch;
+	ovis_event_t ev[2];
+	struct check_s c[2] = {};
+	struct ovis_periodic_s p;
+	pthread_t thr;
+	int i, rc = 0;
+
+	sch = ovis_scheduler_timer_new(OVIS_SCHEDULER_TIMER_WHEEL, 0);
+	assert(sch);
+	p.period_us = CHECK_PERIOD_US;
+	p.phase_us = CHECK_PHASE_US;
+	for (i = 0; i < 2; i++) {
+		ev[i] = ovis_event_periodic_new(check_cb, &c[i], &p);
+		assert(ev[i]);
+		rc = ovis_scheduler_event_add(sch, ev[i]);
+		assert(rc == 0);
+	}
+	rc = pthread_create(&thr, NULL, bench_loop, sch);
+	assert(rc == 0);
+	while (__atomic_load_n(&check_done, __ATOMIC_SEQ_CST) < 2)
+		usleep(10000);
+	ovis_scheduler_term(sch);
+	pthread_join(thr, NULL);
+	for (i = 0; i < 2; i++) {
+		printf("event %d: max interval %lu us\n", i,
+		       (unsigned long)c[i].max_us);
+		if (c[i].max_us > CHECK_PERIOD_US * 3 / 2) {
+			printf("ERROR: event %d skipped a period\n", i);
+			rc = 1;
+		}
+		ovis_scheduler_event_del(sch, ev[i]);
+		ovis_event_free(ev[i]);
+	}
+	ovis_scheduler_free(sch);
+	return rc;
+}
+
 int main(int argc, char **argv)
 {
-	int rc;
+	int rc, op;
 	ovis_event_t ev;
 	ovis_scheduler_t sch;
 	struct ovis_periodic_s p;
 	int msec = 1000;
-	if (argc > 1) {
-		msec = atoi(argv[1]);
+	int do_bench = 0, ntimers = 100000, seconds = 5;
+
+	while ((op = getopt(argc, argv, "bcn:p:t:")) != -1) {
+		switch (op) {
+		case 'c':
+			return check();
+		case 'b':
+			do_bench = 1;
+			break;
+		case 'n':
+			ntimers = atoi(optarg);
+			break;
+		case 'p':
+			msec = atoi(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [<period_ms>]\n"
+			       "       %s -b [-n <timers>] [-p <period_ms>] "
+			       "[-t <seconds>]\n"
+			       "       %s -c\n", argv[0], argv[0], argv[0]);
+			return 1;
+		}
+	}
+	if (optind < argc)
+		msec = atoi(argv[optind]);
+	if (do_bench) {
+		if (ntimers < 1 || msec < 1 || seconds < 1) {
+			printf("All parameters must be positive\n");
+			return 1;
+		}
+		printf("%d timers, period %d ms, %d s\n",
+		       ntimers, msec, seconds);
+		printf("timer    add_ns   del_ns  callbacks cpu_us/cb "
+		       "lat_mean_us lat_max_us\n");
+		bench("heap", OVIS_SCHEDULER_TIMER_HEAP, ntimers, msec, seconds);
+		bench("wheel", OVIS_SCHEDULER_TIMER_WHEEL, ntimers, msec, seconds);
+		return 0;
 	}
 	p.period_us = msec * 1000;
 	p.phase_us = 0;
@@ -0,0 +1,179 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Worker pool test.
+ *
+ * Runs <events> periodic events for <seconds> on a scheduler with <workers>
+ * worker threads. Event 0 is slow: its callback takes three periods. The
+ * other events are fast. The dispatch statistics of every event are printed
+ * at the end. With workers, the slow event must not delay the fast ones by
+ * more than half a period and it must report overruns. The slow callback
+ * must not be running once its event has been removed and joined.
+ *
+ * usage: ovis_event_pool_test [-w <workers>] [-n <events>] [-p <period_ms>]
+ *                             [-t <seconds>]
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "ovis_event.h"
+
+static int nworkers = 4;
+static int nevents = 8;
+static int period_ms = 100;
+static int seconds = 3;
+static volatile int slow_running;
+
+void cb(ovis_event_t ev)
+{
+	int i = (int)(long)ev->param.ctxt;
+	if (i == 0) {
+		slow_running = 1;
+		usleep(3 * period_ms * 1000);
+		slow_running = 0;
+	}
+}
+
+void *loop_proc(void *arg)
+{
+	ovis_scheduler_loop(arg, 0);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	int rc, i, op, err = 0;
+	ovis_scheduler_t sch;
+	ovis_event_t *ev;
+	struct ovis_periodic_s p;
+	struct ovis_event_stats_s st;
+	pthread_t thr;
+
+	while ((op = getopt(argc, argv, "w:n:p:t:")) != -1) {
+		switch (op) {
+		case 'w':
+			nworkers = atoi(optarg);
+			break;
+		case 'n':
+			nevents = atoi(optarg);
+			break;
+		case 'p':
+			period_ms = atoi(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		default:
+			printf("usage: %s [-w <workers>] [-n <events>] "
+			       "[-p <period_ms>] [-t <seconds>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (nworkers < 0 || nevents < 2 || period_ms < 1 || seconds < 1) {
+		printf("bad parameters\n");
+		return 1;
+	}
+
+	sch = ovis_scheduler_pool_new(nworkers);
+	assert(sch);
+	ev = calloc(nevents, sizeof(*ev));
+	assert(ev);
+	p.period_us = period_ms * 1000;
+	for (i = 0; i < nevents; i++) {
+		/* spread the phases over the first half of the period */
+		p.phase_us = (p.period_us / 2) * i / nevents;
+		ev[i] = ovis_event_periodic_new(cb, (void *)(long)i, &p);
+		assert(ev[i]);
+		rc = ovis_scheduler_event_add(sch, ev[i]);
+		assert(rc == 0);
+	}
+	rc = pthread_create(&thr, NULL, loop_proc, sch);
+	assert(rc == 0);
+	sleep(seconds);
+	for (i = 0; i < nevents; i++) {
+		ovis_scheduler_event_del(sch, ev[i]);
+		ovis_scheduler_event_join(sch, ev[i]);
+	}
+	if (nworkers && slow_running) {
+		printf("ERROR: the slow event runs after its removal\n");
+		err = 1;
+	}
+	ovis_scheduler_term(sch);
+	pthread_join(thr, NULL);
+
+	printf("%d workers, %d events, period %d ms, %d s\n",
+	       nworkers, nevents, period_ms, seconds);
+	printf("event    count  overrun  lat_min  lat_max lat_mean   jitter\n");
+	for (i = 0; i < nevents; i++) {
+		rc = ovis_event_stats_get(sch, ev[i], &st);
+		assert(rc == 0);
+		printf("%5d %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64
+		       " %8.0f %8.0f\n", i,
+		       st.count, st.overrun, st.lat_min_us, st.lat_max_us,
+		       st.lat_mean_us, st.jitter_us);
+		if (!nworkers)
+			continue;
+		if (i == 0 && !st.overrun) {
+			printf("ERROR: the slow event has no overrun\n");
+			err = 1;
+		}
+		if (i && st.lat_max_us > p.period_us / 2) {
+			printf("ERROR: event %d is delayed\n", i);
+			err = 1;
+		}
+	}
+	ovis_scheduler_free(sch);
+	for (i = 0; i < nevents; i++)
+		ovis_event_free(ev[i]);
+	free(ev);
+	return err;
+}
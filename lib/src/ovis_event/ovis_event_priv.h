@@ -62,6 +62,47 @@ struct ovis_event_heap {
 	ovis_event_t ev[OVIS_FLEX];
 };
 
+/*
+ * Hierarchical timing wheel. Level L has OVIS_WHEEL_SIZE slots of
+ * OVIS_WHEEL_SIZE^L ticks each. An event goes to the lowest level whose span
+ * covers its expiration; the slots of the upper levels are cascaded down as
+ * the lower levels wrap around. The expired events are moved to the due list.
+ */
+#define OVIS_WHEEL_BITS 8
+#define OVIS_WHEEL_SIZE (1 << OVIS_WHEEL_BITS)
+#define OVIS_WHEEL_MASK (OVIS_WHEEL_SIZE - 1)
+#define OVIS_WHEEL_LEVELS 4
+#define OVIS_WHEEL_SLOTS (OVIS_WHEEL_LEVELS * OVIS_WHEEL_SIZE)
+#define OVIS_WHEEL_DUE OVIS_WHEEL_SLOTS /* the slot index of the due list */
+#define OVIS_WHEEL_TICK_US 1000
+
+struct ovis_event_wheel {
+	uint64_t tick; /* the last processed tick */
+	uint64_t wakeup_tick; /* the tick the loop waits for */
+	uint32_t count; /* number of events, including the due list */
+	uint64_t map[OVIS_WHEEL_SLOTS / 64]; /* non-empty slots */
+	ovis_event_t slot[OVIS_WHEEL_SLOTS + 1];
+};
+
+/*
+ * A worker deque of expired events, a ring of event pointers. The owner takes
+ * events from the head; the other workers steal from the tail.
+ */
+struct ovis_event_deque {
+	uint32_t alloc_len;
+	uint32_t head;
+	uint32_t len;
+	ovis_event_t *ev;
+};
+
+struct ovis_worker_s {
+	int idx;
+	pthread_t thread;
+	ovis_scheduler_t m;
+	ovis_event_t current; /* the event being called back */
+	struct ovis_event_deque dq;
+};
+
 struct ovis_scheduler_s {
 	int evcount;
 	int refcount;
@@ -70,13 +111,24 @@ struct ovis_scheduler_s {
 	struct ovis_event_s ovis_ev;
 	struct epoll_event ev[MAX_EPOLL_EVENTS];
 	pthread_mutex_t mutex;
-	struct ovis_event_heap *heap;
+	struct ovis_event_heap *heap; /* NULL if the wheel is used */
+	struct ovis_event_wheel *wheel;
 	enum {
 		OVIS_EVENT_MANAGER_INIT,
 		OVIS_EVENT_MANAGER_RUNNING,
 		OVIS_EVENT_MANAGER_WAITING,
 		OVIS_EVENT_MANAGER_TERM,
 	} state;
+
+	/* worker pool, see ovis_scheduler_pool_new() */
+	int nworkers;
+	int next_worker; /* round-robin for events without an affinity */
+	int pending; /* number of events in the worker deques */
+	int pool_term;
+	pthread_cond_t pool_cv;
+	int done_waiters; /* threads waiting in ovis_scheduler_event_join() */
+	pthread_cond_t done_cv; /* a worker returned from a callback */
+	struct ovis_worker_s *workers;
 };
 
 #endif
@@ -13,3 +13,11 @@ eslowdown=$(echo "scale=2;$je/$st" |bc)
 bslowdown=$(echo "scale=2;$jb/$st" |bc)
 echo elements/sprintf duration ratio is $eslowdown
 echo bulkfmt/sprintf duration ratio is $bslowdown
+for m in darshan kokkos; do
+	mb=$(cat $tmp |grep "$m parse MB/s" |sed -e 's/.* //g')
+	amb=$(cat $tmp |grep "$m arena parse MB/s" |sed -e 's/.* //g')
+	echo $m parse MB/s $mb, arena parse MB/s $amb
+done
+tmb=$(cat $tmp |grep "darshan extract msgs/s" |sed -e 's/.* //g')
+tok=$(cat $tmp |grep "darshan token extract msgs/s" |sed -e 's/.* //g')
+echo darshan extract msgs/s $tmb, token extract msgs/s $tok
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <errno.h>
+#include <coll/fnv_hash.h>
 #include "ovis_json.h"
 
 #define JSON_BUF_START_LEN 8192
@@ -95,76 +96,197 @@ jbuf_t jbuf_append_attr(jbuf_t jb, const char *name, const char *fmt, ...)
 	return jb;
 }
 
-json_entity_t json_attr_first(json_entity_t d)
+/*
+ * The entities of json_parse_buffer_arena() are carved out of chunks
+ * that are freed together. The arena itself is at the start of the
+ * first chunk, right before the root entity of the document.
+ */
+struct json_arena_chunk_s {
+	struct json_arena_chunk_s *next;
+	size_t size;
+	size_t used;
+	char data[] __attribute__((aligned(8)));
+};
+
+struct json_arena_s {
+	struct json_arena_chunk_s *chunk; /* the current chunk */
+	int foreign;	/* !0 if malloc'd entities were added */
+};
+
+#define JSON_ARENA_OFF	((sizeof(struct json_arena_s) + 7) & ~7)
+
+static void *json_arena_alloc(json_arena_t arena, size_t sz)
 {
-	hent_t ent;
-	assert(d->type == JSON_DICT_VALUE);
-	ent = htbl_first(d->value.dict_->attr_table);
-	if (!ent)
+	struct json_arena_chunk_s *c = arena->chunk;
+	size_t csz;
+	void *p;
+
+	sz = (sz + 7) & ~7;
+	if (c->used + sz > c->size) {
+		csz = c->size * 2;
+		if (csz < sz)
+			csz = sz;
+		c = malloc(sizeof(*c) + csz);
+		if (!c)
+			return NULL;
+		c->size = csz;
+		c->used = 0;
+		c->next = arena->chunk;
+		arena->chunk = c;
+	}
+	p = c->data + c->used;
+	c->used += sz;
+	return p;
+}
+
+static json_arena_t json_arena_new(size_t size)
+{
+	struct json_arena_chunk_s *c;
+	json_arena_t arena;
+
+	size = (size + 7) & ~7;
+	if (size < 1024)
+		size = 1024;
+	c = malloc(sizeof(*c) + size);
+	if (!c)
 		return NULL;
-	json_attr_t a = container_of(ent, struct json_attr_s, attr_ent);
-	return &a->base;
+	c->size = size;
+	c->used = JSON_ARENA_OFF;
+	c->next = NULL;
+	arena = (json_arena_t)c->data;
+	arena->chunk = c;
+	arena->foreign = 0;
+	return arena;
 }
 
-json_entity_t json_attr_next(json_entity_t a)
+static void json_arena_free(json_arena_t arena)
 {
-	hent_t ent;
-	json_attr_t next;
-	assert(a->type == JSON_ATTR_VALUE);
-	ent = htbl_next(&a->value.attr_->attr_ent);
-	if (ent) {
-		next = container_of(ent, struct json_attr_s, attr_ent);
-		return &next->base;
+	struct json_arena_chunk_s *c, *next;
+
+	/* The arena is in the first chunk, free it last */
+	for (c = arena->chunk; c; c = next) {
+		next = c->next;
+		free(c);
 	}
-	return NULL;
 }
 
-json_entity_t json_attr_find(json_entity_t d, const char *name)
+static int attr_cmp(const void *a, const void *b, size_t key_len)
 {
-	hent_t ent;
+#ifdef JDEBUG
+	fprintf(stderr, "attr_cmp( %s, %s, %zu)\n",
+		(char *)a, (char *)b, key_len);
+#endif
+	/* a is the NUL terminated name of an attribute */
+	if (strncmp(a, b, key_len))
+		return 1;
+	return ((const char *)a)[key_len] != '\0';
+}
+
+static uint64_t attr_hash(const void *key, size_t key_len)
+{
+	return fnv_hash_a1_64(key, key_len, 0);
+}
+
+#define JSON_HTBL_DEPTH	23
+
+/* Index the attributes of \c d by name */
+static int __dict_index(json_dict_t d)
+{
+	size_t sz = sizeof(struct htbl)
+			+ JSON_HTBL_DEPTH * sizeof(struct hent_list_head);
+	json_entity_t e;
 	json_attr_t a;
-	assert (d->type == JSON_DICT_VALUE);
-	ent = htbl_find(d->value.dict_->attr_table, name, strlen(name));
+	htbl_t t;
+
+	if (d->arena) {
+		t = json_arena_alloc(d->arena, sz);
+		if (!t)
+			return ENOMEM;
+		memset(t, 0, sz);
+		t->table_depth = JSON_HTBL_DEPTH;
+		t->cmp_fn = attr_cmp;
+	} else {
+		t = htbl_alloc(attr_cmp, JSON_HTBL_DEPTH);
+		if (!t)
+			return ENOMEM;
+	}
+	t->hash_fn = attr_hash;
+	TAILQ_FOREACH(e, &d->attr_list, item_entry) {
+		a = e->value.attr_;
+		hent_init(&a->attr_ent, a->name->value.str_->str,
+			  a->name->value.str_->str_len);
+		htbl_ins(t, &a->attr_ent);
+	}
+	d->attr_table = t;
+	return 0;
+}
+
+static json_entity_t __attr_find(json_dict_t d, const char *name, size_t len)
+{
+	json_entity_t e;
+	json_str_t s;
+	hent_t ent;
+
+	if (!d->attr_table &&
+	    (d->attr_count <= JSON_DICT_SCAN_MAX || __dict_index(d))) {
+		TAILQ_FOREACH(e, &d->attr_list, item_entry) {
+			s = e->value.attr_->name->value.str_;
+			if (s->str_len == len && 0 == memcmp(s->str, name, len))
+				return e;
+		}
+		return NULL;
+	}
+	ent = htbl_find(d->attr_table, name, len);
 	if (ent) {
 #ifdef JDEBUG
 		fprintf(stderr, "json found attr %s while searching for %s\n",
 			(char *)ent->key, name);
 #endif
-		a = container_of(ent, struct json_attr_s, attr_ent);
-		return &a->base;
+		return &container_of(ent, struct json_attr_s, attr_ent)->base;
 	}
 	return NULL;
 }
 
-int json_attr_count(json_entity_t d)
+json_entity_t json_attr_first(json_entity_t d)
 {
 	assert(d->type == JSON_DICT_VALUE);
-	json_dict_t dict = (json_dict_t)d;
-	return dict->attr_table->entry_count;
+	return TAILQ_FIRST(&d->value.dict_->attr_list);
 }
 
-int attr_cmp(const void *a, const void *b, size_t key_len)
+json_entity_t json_attr_next(json_entity_t a)
 {
-#ifdef JDEBUG
-	fprintf(stderr, "attr_cmp( %s, %s, %zu)\n",
-		(char *)a, (char *)b, key_len);
-#endif
-	return strncmp(a, b, key_len);
+	assert(a->type == JSON_ATTR_VALUE);
+	return TAILQ_NEXT(a, item_entry);
 }
 
-#define JSON_HTBL_DEPTH	23
+json_entity_t json_attr_find(json_entity_t d, const char *name)
+{
+	assert (d->type == JSON_DICT_VALUE);
+	return __attr_find(d->value.dict_, name, strlen(name));
+}
+
+int json_attr_count(json_entity_t d)
+{
+	assert(d->type == JSON_DICT_VALUE);
+	return d->value.dict_->attr_count;
+}
+
+static void json_dict_init(json_dict_t d, json_arena_t arena)
+{
+	d->base.type = JSON_DICT_VALUE;
+	d->base.value.dict_ = d;
+	d->attr_table = NULL;
+	d->attr_count = 0;
+	TAILQ_INIT(&d->attr_list);
+	d->arena = arena;
+}
 
 static json_entity_t json_dict_new(void)
 {
 	json_dict_t d = malloc(sizeof *d);
 	if (d) {
-		d->base.type = JSON_DICT_VALUE;
-		d->base.value.dict_ = d;
-		d->attr_table = htbl_alloc(attr_cmp, JSON_HTBL_DEPTH);
-		if (!d->attr_table) {
-			free(d);
-			return NULL;
-		}
+		d->base.flags = 0;
+		json_dict_init(d, NULL);
 		return &d->base;
 	}
 	return NULL;
@@ -175,6 +297,7 @@ static json_entity_t json_str_new(const char *s)
 	json_str_t str = malloc(sizeof *str);
 	if (str) {
 		str->base.type = JSON_STRING_VALUE;
+		str->base.flags = 0;
 		str->base.value.str_ = str;
 		str->str = strdup(s);
 		if (!str->str) {
@@ -192,9 +315,11 @@ static json_entity_t json_list_new(void)
 	json_list_t a = malloc(sizeof *a);
 	if (a) {
 		a->base.type = JSON_LIST_VALUE;
+		a->base.flags = 0;
 		a->base.value.list_ = a;
 		a->item_count = 0;
 		TAILQ_INIT(&a->item_list);
+		a->arena = NULL;
 		return &a->base;
 	}
 	return NULL;
@@ -205,6 +330,8 @@ void json_item_add(json_entity_t a, json_entity_t e)
 	assert(a->type == JSON_LIST_VALUE);
 	a->value.list_->item_count++;
 	TAILQ_INSERT_TAIL(&a->value.list_->item_list, e, item_entry);
+	if (a->value.list_->arena && !(e->flags & JSON_F_ARENA))
+		a->value.list_->arena->foreign = 1;
 }
 
 json_entity_t json_item_first(json_entity_t a)
@@ -261,6 +388,7 @@ static json_entity_t json_attr_new(const char *name, json_entity_t value)
 	json_attr_t a = malloc(sizeof *a);
 	if (a) {
 		a->base.type = JSON_ATTR_VALUE;
+		a->base.flags = 0;
 		a->base.value.attr_ = a;
 		a->name = s;
 		a->value = value;
@@ -285,6 +413,7 @@ json_entity_t json_entity_new(enum json_value_e type, ...)
 		if (!e)
 			goto out;
 		e->type = type;
+		e->flags = 0;
 		i = va_arg(ap, uint64_t);
 		e->value.int_ = i;
 		break;
@@ -293,6 +422,7 @@ json_entity_t json_entity_new(enum json_value_e type, ...)
 		if (!e)
 			goto out;
 		e->type = type;
+		e->flags = 0;
 		i = va_arg(ap, int);
 		e->value.bool_ = i;
 		break;
@@ -301,6 +431,7 @@ json_entity_t json_entity_new(enum json_value_e type, ...)
 		if (!e)
 			goto out;
 		e->type = type;
+		e->flags = 0;
 		d = va_arg(ap, double);
 		e->value.double_ = d;
 		break;
@@ -324,6 +455,7 @@ json_entity_t json_entity_new(enum json_value_e type, ...)
 		if (!e)
 			goto out;
 		e->type = type;
+		e->flags = 0;
 		e->value.int_ = 0;
 		break;
 	default:
@@ -496,20 +628,25 @@ json_entity_t json_entity_copy(json_entity_t e)
 	return new;
 }
 
-static void json_attr_free(json_attr_t a);
 static inline void __attr_rem(json_entity_t d, json_entity_t a)
 {
-	htbl_del(d->value.dict_->attr_table, &a->value.attr_->attr_ent);
-	json_attr_free(a->value.attr_);
+	json_dict_t dict = d->value.dict_;
+
+	TAILQ_REMOVE(&dict->attr_list, a, item_entry);
+	dict->attr_count--;
+	if (dict->attr_table)
+		htbl_del(dict->attr_table, &a->value.attr_->attr_ent);
+	json_entity_free(a);
 }
 
 void __attr_add(json_entity_t d, json_entity_t a)
 {
+	json_dict_t dict = d->value.dict_;
 	json_str_t name;
 	json_entity_t a_;
 
 	name = json_attr_name(a);
-	a_ = json_attr_find(d, name->str);
+	a_ = __attr_find(dict, name->str, name->str_len);
 	if (a_) {
 #ifdef JDEBUG
 		fprintf(stderr, "json removing entry %s for %s\n",
@@ -517,8 +654,14 @@ void __attr_add(json_entity_t d, json_entity_t a)
 #endif
 		__attr_rem(d, a_);
 	}
-	hent_init(&a->value.attr_->attr_ent, name->str, name->str_len);
-	htbl_ins(d->value.dict_->attr_table, &a->value.attr_->attr_ent);
+	TAILQ_INSERT_TAIL(&dict->attr_list, a, item_entry);
+	dict->attr_count++;
+	if (dict->attr_table) {
+		hent_init(&a->value.attr_->attr_ent, name->str, name->str_len);
+		htbl_ins(dict->attr_table, &a->value.attr_->attr_ent);
+	}
+	if (dict->arena && !(a->flags & JSON_F_ARENA))
+		dict->arena->foreign = 1;
 }
 
 int json_attr_add(json_entity_t d, const char *name, json_entity_t v)
@@ -593,27 +736,64 @@ static void json_attr_free(json_attr_t a)
 
 static void json_dict_free(json_dict_t d)
 {
-	json_attr_t i;
-	hent_t ent;
-	htbl_t t;
+	json_entity_t a;
 	if (!d)
 		return;
 
-	t = d->attr_table;
-	while (!htbl_empty(t)) {
-		ent = htbl_first(t);
-		htbl_del(t, ent);
-		i = container_of(ent, struct json_attr_s, attr_ent);
-		json_attr_free(i);
+	while ((a = TAILQ_FIRST(&d->attr_list))) {
+		TAILQ_REMOVE(&d->attr_list, a, item_entry);
+		json_attr_free(a->value.attr_);
 	}
-	htbl_free(t);
+	if (d->attr_table)
+		htbl_free(d->attr_table);
 	free(d);
 }
 
+/* Free the entities that the application added to arena entity \c e */
+static void __arena_foreign_free(json_entity_t e)
+{
+	json_entity_t i, n;
+
+	switch (e->type) {
+	case JSON_ATTR_VALUE:
+		json_entity_free(e->value.attr_->value);
+		break;
+	case JSON_LIST_VALUE:
+		i = TAILQ_FIRST(&e->value.list_->item_list);
+		for (; i; i = n) {
+			n = TAILQ_NEXT(i, item_entry);
+			json_entity_free(i);
+		}
+		break;
+	case JSON_DICT_VALUE:
+		i = TAILQ_FIRST(&e->value.dict_->attr_list);
+		for (; i; i = n) {
+			n = TAILQ_NEXT(i, item_entry);
+			json_entity_free(i);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
 void json_entity_free(json_entity_t e)
 {
+	json_arena_t arena;
+
 	if (!e)
 		return;
+	if (e->flags & JSON_F_ARENA) {
+		if (!(e->flags & JSON_F_ROOT)) {
+			__arena_foreign_free(e);
+			return;
+		}
+		arena = (json_arena_t)((char *)e - JSON_ARENA_OFF);
+		if (arena->foreign)
+			__arena_foreign_free(e);
+		json_arena_free(arena);
+		return;
+	}
 	switch (e->type) {
 	case JSON_INT_VALUE:
 		free(e);
@@ -825,3 +1005,529 @@ json_entity_t json_dict_build(json_entity_t d, ...)
 	va_end(ap);
 	return obj;
 }
+
+/*
+ * json_parse_buffer_arena()
+ *
+ * The containers that are being parsed are kept on an explicit stack,
+ * \c name is the name of the attribute whose value is expected next.
+ */
+struct json_parse_frame_s {
+	json_entity_t e;
+	json_entity_t name;
+};
+
+struct json_parse_s {
+	const char *p;
+	const char *end;
+	json_arena_t arena;
+	json_entity_t root;
+};
+
+static inline void __skip_ws(struct json_parse_s *ps)
+{
+	while (ps->p < ps->end &&
+	       (*ps->p == ' ' || *ps->p == '\t' ||
+		*ps->p == '\n' || *ps->p == '\r'))
+		ps->p++;
+}
+
+static json_entity_t __arena_entity(struct json_parse_s *ps, size_t sz,
+				    enum json_value_e type)
+{
+	json_entity_t e = json_arena_alloc(ps->arena, sz);
+	if (!e)
+		return NULL;
+	e->type = type;
+	e->flags = JSON_F_ARENA;
+	if (!ps->root) {
+		/* The root is allocated first, right after the arena */
+		e->flags |= JSON_F_ROOT;
+		ps->root = e;
+	}
+	return e;
+}
+
+/*
+ * Strings are kept as they are between the quotes like the lexer of
+ * json_parse_buffer() does, escape sequences are not translated.
+ */
+static int __str_skip(struct json_parse_s *ps)
+{
+	char q = *ps->p++;
+	const char *s;
+
+	while (ps->p < ps->end) {
+		ps->p = memchr(ps->p, q, ps->end - ps->p);
+		if (!ps->p)
+			break;
+		/* The quote is escaped by an odd number of backslashes */
+		for (s = ps->p; q == '"' && s[-1] == '\\'; s--)
+			;
+		ps->p++;
+		if ((ps->p - s) & 1)
+			return 0;
+	}
+	ps->p = ps->end;
+	return EINVAL;
+}
+
+static json_entity_t __arena_str(struct json_parse_s *ps)
+{
+	const char *s = ps->p + 1;
+	json_str_t str;
+	size_t len;
+
+	if (__str_skip(ps))
+		return NULL;
+	len = ps->p - s - 1;
+	str = (json_str_t)__arena_entity(ps, sizeof(*str), JSON_STRING_VALUE);
+	if (!str)
+		return NULL;
+	str->base.value.str_ = str;
+	str->str = json_arena_alloc(ps->arena, len + 1);
+	if (!str->str)
+		return NULL;
+	memcpy(str->str, s, len);
+	str->str[len] = '\0';
+	str->str_len = len;
+	return &str->base;
+}
+
+static int __num_skip(struct json_parse_s *ps, int *is_float_p)
+{
+	int is_float = 0, digits = 0;
+
+	if (ps->p < ps->end && (*ps->p == '-' || *ps->p == '+'))
+		ps->p++;
+	for (; ps->p < ps->end; ps->p++) {
+		if (*ps->p >= '0' && *ps->p <= '9') {
+			digits++;
+		} else if (*ps->p == '.' || *ps->p == 'e' || *ps->p == 'E') {
+			is_float = 1;
+		} else if ((*ps->p == '-' || *ps->p == '+') &&
+			   (ps->p[-1] == 'e' || ps->p[-1] == 'E')) {
+			continue;
+		} else {
+			break;
+		}
+	}
+	*is_float_p = is_float;
+	return digits ? 0 : EINVAL;
+}
+
+static json_entity_t __arena_num(struct json_parse_s *ps)
+{
+	const char *s = ps->p;
+	char buf[64];
+	json_entity_t e;
+	int is_float;
+
+	if (__num_skip(ps, &is_float) || ps->p - s >= sizeof(buf))
+		return NULL;
+	memcpy(buf, s, ps->p - s);
+	buf[ps->p - s] = '\0';
+	e = __arena_entity(ps, sizeof(*e), is_float ?
+				JSON_FLOAT_VALUE : JSON_INT_VALUE);
+	if (!e)
+		return NULL;
+	if (is_float)
+		e->value.double_ = strtod(buf, NULL);
+	else
+		e->value.int_ = strtoll(buf, NULL, 0);
+	return e;
+}
+
+static const struct json_literal_s {
+	const char *s;
+	size_t len;
+	enum json_value_e type;
+	int value;
+} lit[] = {
+	{ "true", 4, JSON_BOOL_VALUE, 1 },
+	{ "false", 5, JSON_BOOL_VALUE, 0 },
+	{ "null", 4, JSON_NULL_VALUE, 0 },
+};
+
+/* Skip a literal, \return its index in lit[] or -1 */
+static int __literal_skip(struct json_parse_s *ps)
+{
+	int i;
+
+	for (i = 0; i < sizeof(lit) / sizeof(lit[0]); i++) {
+		if (ps->end - ps->p >= lit[i].len &&
+		    0 == memcmp(ps->p, lit[i].s, lit[i].len)) {
+			ps->p += lit[i].len;
+			return i;
+		}
+	}
+	return -1;
+}
+
+static json_entity_t __arena_literal(struct json_parse_s *ps)
+{
+	json_entity_t e;
+	int i;
+
+	i = __literal_skip(ps);
+	if (i < 0)
+		return NULL;
+	e = __arena_entity(ps, sizeof(*e), lit[i].type);
+	if (!e)
+		return NULL;
+	if (lit[i].type == JSON_BOOL_VALUE)
+		e->value.bool_ = lit[i].value;
+	else
+		e->value.int_ = 0;
+	return e;
+}
+
+/* Add \c e to the container on top of the stack */
+static int __arena_attach(struct json_parse_s *ps,
+			  struct json_parse_frame_s *top, json_entity_t e)
+{
+	json_attr_t a;
+
+	if (!top)
+		return 0;
+	if (top->e->type == JSON_LIST_VALUE) {
+		json_item_add(top->e, e);
+		return 0;
+	}
+	a = (json_attr_t)__arena_entity(ps, sizeof(*a), JSON_ATTR_VALUE);
+	if (!a)
+		return ENOMEM;
+	a->base.value.attr_ = a;
+	a->name = top->name;
+	a->value = e;
+	__attr_add(top->e, &a->base);
+	return 0;
+}
+
+static int __stack_grow(json_parser_t parser)
+{
+	int depth = parser->stack_depth ? parser->stack_depth * 2 : 32;
+	struct json_parse_frame_s *stack;
+
+	stack = realloc(parser->stack, depth * sizeof(*stack));
+	if (!stack)
+		return ENOMEM;
+	parser->stack = stack;
+	parser->stack_depth = depth;
+	return 0;
+}
+
+int json_parse_buffer_arena(json_parser_t parser, const char *buf,
+			    size_t buf_len, json_entity_t *pentity)
+{
+	struct json_parse_s ps = { .p = buf, .end = buf + buf_len };
+	struct json_parse_frame_s *top = NULL;
+	json_entity_t e;
+	int n = 0, rc = EINVAL;
+
+	*pentity = NULL;
+	/* Most documents fit in the first chunk */
+	ps.arena = json_arena_new(buf_len * 4);
+	if (!ps.arena)
+		return ENOMEM;
+ value:
+	__skip_ws(&ps);
+	if (ps.p >= ps.end)
+		goto err;
+	switch (*ps.p) {
+	case '{':
+	case '[':
+		if (n == parser->stack_depth) {
+			if (__stack_grow(parser)) {
+				rc = ENOMEM;
+				goto err;
+			}
+			top = n ? &parser->stack[n - 1] : NULL;
+		}
+		if (*ps.p++ == '{') {
+			e = __arena_entity(&ps, sizeof(struct json_dict_s),
+					   JSON_DICT_VALUE);
+			if (e)
+				json_dict_init((json_dict_t)e, ps.arena);
+		} else {
+			e = __arena_entity(&ps, sizeof(struct json_list_s),
+					   JSON_LIST_VALUE);
+			if (e) {
+				e->value.list_ = (json_list_t)e;
+				e->value.list_->item_count = 0;
+				TAILQ_INIT(&e->value.list_->item_list);
+				e->value.list_->arena = ps.arena;
+			}
+		}
+		if (!e || __arena_attach(&ps, top, e)) {
+			rc = ENOMEM;
+			goto err;
+		}
+		top = &parser->stack[n++];
+		top->e = e;
+		top->name = NULL;
+		__skip_ws(&ps);
+		if (ps.p < ps.end &&
+		    *ps.p == (e->type == JSON_DICT_VALUE ? '}' : ']')) {
+			ps.p++;
+			goto end;
+		}
+		if (e->type == JSON_DICT_VALUE)
+			goto name;
+		goto value;
+	case '"':
+	case '\'':
+		e = __arena_str(&ps);
+		break;
+	case 't':
+	case 'f':
+	case 'n':
+		e = __arena_literal(&ps);
+		break;
+	default:
+		e = __arena_num(&ps);
+		break;
+	}
+	if (!e)
+		goto err;
+	if (__arena_attach(&ps, top, e)) {
+		rc = ENOMEM;
+		goto err;
+	}
+ next:
+	/* The value is complete, what follows depends on the container */
+	if (!top)
+		goto out;
+	__skip_ws(&ps);
+	if (ps.p >= ps.end)
+		goto err;
+	if (*ps.p == ',') {
+		ps.p++;
+		if (top->e->type == JSON_DICT_VALUE)
+			goto name;
+		goto value;
+	}
+	if (*ps.p != (top->e->type == JSON_DICT_VALUE ? '}' : ']'))
+		goto err;
+	ps.p++;
+ end:
+	n--;
+	top = n ? &parser->stack[n - 1] : NULL;
+	goto next;
+ name:
+	__skip_ws(&ps);
+	if (ps.p >= ps.end || (*ps.p != '"' && *ps.p != '\''))
+		goto err;
+	top->name = __arena_str(&ps);
+	if (!top->name)
+		goto err;
+	__skip_ws(&ps);
+	if (ps.p >= ps.end || *ps.p != ':')
+		goto err;
+	ps.p++;
+	goto value;
+ out:
+	/* Like json_parse_buffer(), the text after the value is ignored */
+	*pentity = ps.root;
+	return 0;
+ err:
+	json_arena_free(ps.arena);
+	return rc;
+}
+
+/*
+ * json_token_xxx()
+ *
+ * The values are located with the cursor of the arena parser, nothing
+ * is allocated.
+ */
+static int __token_scan(struct json_parse_s *ps, json_token_t tok)
+{
+	const char *s;
+	int depth, is_float;
+
+	__skip_ws(ps);
+	if (ps->p >= ps->end)
+		return EINVAL;
+	s = ps->p;
+	switch (*s) {
+	case '{':
+	case '[':
+		/* Skip to the matching bracket */
+		depth = 0;
+		while (ps->p < ps->end) {
+			switch (*ps->p) {
+			case '"':
+			case '\'':
+				if (__str_skip(ps))
+					return EINVAL;
+				continue;
+			case '{':
+			case '[':
+				depth++;
+				break;
+			case '}':
+			case ']':
+				depth--;
+				break;
+			}
+			ps->p++;
+			if (!depth)
+				break;
+		}
+		if (depth)
+			return EINVAL;
+		tok->type = (*s == '{' ? JSON_DICT_VALUE : JSON_LIST_VALUE);
+		tok->str = s;
+		tok->len = ps->p - s;
+		return 0;
+	case '"':
+	case '\'':
+		if (__str_skip(ps))
+			return EINVAL;
+		tok->type = JSON_STRING_VALUE;
+		tok->str = s + 1;
+		tok->len = ps->p - s - 2;
+		return 0;
+	case 't':
+	case 'f':
+	case 'n':
+		depth = __literal_skip(ps);
+		if (depth < 0)
+			return EINVAL;
+		tok->type = lit[depth].type;
+		break;
+	default:
+		if (__num_skip(ps, &is_float))
+			return EINVAL;
+		tok->type = (is_float ? JSON_FLOAT_VALUE : JSON_INT_VALUE);
+		break;
+	}
+	tok->str = s;
+	tok->len = ps->p - s;
+	return 0;
+}
+
+int json_token_parse(const char *buf, size_t len, json_token_t tok)
+{
+	struct json_parse_s ps = { .p = buf, .end = buf + len };
+	return __token_scan(&ps, tok);
+}
+
+int json_token_find(json_token_t dict, int count,
+		    const char * const *names, json_token_t toks)
+{
+	struct json_parse_s ps;
+	struct json_token_s skip;
+	const char *name;
+	size_t len;
+	int i, j, found, last, rc;
+
+	if (dict->type != JSON_DICT_VALUE)
+		return EINVAL;
+	for (i = 0; i < count; i++)
+		toks[i].str = NULL;
+	ps.p = dict->str + 1;
+	ps.end = dict->str + dict->len - 1;
+	__skip_ws(&ps);
+	if (ps.p >= ps.end)
+		return 0;
+	found = 0;
+	last = count - 1;
+	while (found < count) {
+		if (*ps.p != '"' && *ps.p != '\'')
+			return EINVAL;
+		name = ps.p + 1;
+		if (__str_skip(&ps))
+			return EINVAL;
+		len = ps.p - name - 1;
+		__skip_ws(&ps);
+		if (ps.p >= ps.end || *ps.p != ':')
+			return EINVAL;
+		ps.p++;
+		/* Start with the name after the last one found */
+		for (j = 0, i = last; j < count; j++) {
+			i = (i + 1 == count ? 0 : i + 1);
+			if (!toks[i].str && 0 == strncmp(names[i], name, len) &&
+			    names[i][len] == '\0')
+				break;
+		}
+		if (j < count) {
+			rc = __token_scan(&ps, &toks[i]);
+			found++;
+			last = i;
+		} else {
+			rc = __token_scan(&ps, &skip);
+		}
+		if (rc)
+			return rc;
+		__skip_ws(&ps);
+		if (ps.p >= ps.end)
+			break;
+		if (*ps.p != ',')
+			return EINVAL;
+		ps.p++;
+		__skip_ws(&ps);
+	}
+	return 0;
+}
+
+int json_token_item_next(json_token_t list, json_token_t item)
+{
+	struct json_parse_s ps;
+
+	if (list->type != JSON_LIST_VALUE)
+		return EINVAL;
+	ps.end = list->str + list->len - 1;
+	if (!item->str) {
+		ps.p = list->str + 1;
+		__skip_ws(&ps);
+		if (ps.p >= ps.end)
+			return ENOENT;
+		return __token_scan(&ps, item);
+	}
+	ps.p = item->str + item->len;
+	if (item->type == JSON_STRING_VALUE)
+		ps.p++;
+	__skip_ws(&ps);
+	if (ps.p >= ps.end)
+		return ENOENT;
+	if (*ps.p != ',')
+		return EINVAL;
+	ps.p++;
+	return __token_scan(&ps, item);
+}
+
+int64_t json_token_int(json_token_t tok)
+{
+	char buf[64];
+	size_t len = tok->len < sizeof(buf) ? tok->len : sizeof(buf) - 1;
+	uint64_t v = 0;
+	size_t i = (tok->str[0] == '-');
+
+	/* Plain decimals are converted in place */
+	if (len < 19 && i < len && (tok->str[i] != '0' || len == i + 1)) {
+		for (; i < len && tok->str[i] >= '0' && tok->str[i] <= '9'; i++)
+			v = v * 10 + (tok->str[i] - '0');
+		if (i == len)
+			return tok->str[0] == '-' ? -(int64_t)v : (int64_t)v;
+	}
+	memcpy(buf, tok->str, len);
+	buf[len] = '\0';
+	return strtoll(buf, NULL, 0);
+}
+
+double json_token_float(json_token_t tok)
+{
+	char buf[64];
+	size_t len = tok->len < sizeof(buf) ? tok->len : sizeof(buf) - 1;
+
+	memcpy(buf, tok->str, len);
+	buf[len] = '\0';
+	return strtod(buf, NULL);
+}
+
+int json_token_bool(json_token_t tok)
+{
+	return tok->type == JSON_BOOL_VALUE && tok->str[0] == 't';
+}
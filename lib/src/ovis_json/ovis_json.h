@@ -71,8 +71,12 @@ enum json_value_e {
 	JSON_NULL_VALUE
 };
 
+#define JSON_F_ARENA	1	/* allocated from the arena of a parse */
+#define JSON_F_ROOT	2	/* the entity that frees the arena */
+
 struct json_entity_s {
 	enum json_value_e type;
+	int flags;		/* JSON_F_XXX */
 	union {
 		int bool_;
 		int64_t int_;
@@ -91,22 +95,34 @@ struct json_str_s {
 	size_t str_len;
 };
 
+typedef struct json_arena_s *json_arena_t;
+
 struct json_list_s {
 	struct json_entity_s base;
 	int item_count;
 	TAILQ_HEAD(json_item_list, json_entity_s) item_list;
+	json_arena_t arena;	/* NULL if not from json_parse_buffer_arena() */
 };
 
 struct json_attr_s {
-	struct json_entity_s base;
+	struct json_entity_s base;	/* item_entry links the dict attributes */
 	json_entity_t name;
 	json_entity_t value;
 	struct hent attr_ent;
 };
 
+/*
+ * The attributes are kept in insertion order. The name index is only
+ * built when a lookup in a dict of more than JSON_DICT_SCAN_MAX
+ * attributes is made, smaller dicts are scanned.
+ */
+#define JSON_DICT_SCAN_MAX 8
 struct json_dict_s {
 	struct json_entity_s base;
-	htbl_t attr_table;
+	htbl_t attr_table;	/* name index, NULL until needed */
+	int attr_count;
+	TAILQ_HEAD(json_attr_list, json_entity_s) attr_list;
+	json_arena_t arena;	/* NULL if not from json_parse_buffer_arena() */
 };
 
 struct json_loc_s {
@@ -121,6 +137,9 @@ typedef void *yyscan_t;
 typedef struct json_parser_s {
 	yyscan_t scanner;
 	struct yy_buffer_state *buffer_state;
+	/* Nesting stack of json_parse_buffer_arena(), kept for reuse */
+	struct json_parse_frame_s *stack;
+	int stack_depth;
 } *json_parser_t;
 
 typedef struct jbuf_s {
@@ -138,6 +157,95 @@ extern enum json_value_e json_entity_type(json_entity_t e);
 
 extern int json_parse_buffer(json_parser_t p, char *buf, size_t buf_len, json_entity_t *e);
 
+/**
+ * \brief Parse a JSON document into entities allocated from one arena
+ *
+ * This is a single pass, non-recursive alternative to
+ * json_parse_buffer() that accepts the same documents and builds the
+ * same entities. All of the entities of the document are allocated
+ * from an arena that json_entity_free() of the returned entity frees in
+ * one shot. Freeing an entity of the document other than the returned
+ * one only frees what the application has added to it.
+ *
+ * The documents can be modified with the usual functions, e.g.
+ * json_attr_add() and json_item_add().
+ *
+ * \param p	  The parser, it keeps the nesting stack for the next parse
+ * \param buf	  The JSON text, it need not be terminated
+ * \param buf_len The length of \c buf
+ * \param e	  The parsed document
+ *
+ * \return 0 on success, EINVAL if \c buf is not valid JSON or ENOMEM.
+ */
+extern int json_parse_buffer_arena(json_parser_t p, const char *buf,
+				   size_t buf_len, json_entity_t *e);
+
+/*
+ * A value located in a JSON text without building entities. For
+ * strings, \c str is the text between the quotes with the escape
+ * sequences untranslated, for the other types it is the text of the
+ * value, e.g. the whole "{...}" of a dict. A token that was not
+ * found has a NULL \c str.
+ */
+struct json_token_s {
+	enum json_value_e type;
+	const char *str;
+	size_t len;
+};
+typedef struct json_token_s *json_token_t;
+
+/**
+ * \brief Locate the JSON value at the start of a text
+ *
+ * Only the text of the value is scanned. The contents of containers
+ * are not validated until they are searched with json_token_find() or
+ * json_token_item_next(), so extracting a few values from a large
+ * document only costs a scan of the document.
+ *
+ * \param buf	The JSON text, it need not be terminated
+ * \param len	The length of \c buf
+ * \param tok	Receives the value
+ *
+ * \return 0 on success or EINVAL if \c buf does not start with a value.
+ */
+extern int json_token_parse(const char *buf, size_t len, json_token_t tok);
+
+/**
+ * \brief Extract the values of the named attributes of a dict
+ *
+ * The dict is scanned once; the scan stops as soon as all the names
+ * have been found. If a name is repeated in the dict, its first value
+ * is returned. The names are matched fastest when they are given in
+ * the order in which they appear in the dict.
+ *
+ * \param dict	A JSON_DICT_VALUE token
+ * \param count	The number of names
+ * \param names	The attribute names
+ * \param toks	Receives the value of \c names[i] in \c toks[i]; a
+ *		\c str of NULL means the dict has no such attribute
+ *
+ * \return 0 on success or EINVAL if \c dict is not a valid dict.
+ */
+extern int json_token_find(json_token_t dict, int count,
+			   const char * const *names, json_token_t toks);
+
+/**
+ * \brief Get the next item of a list
+ *
+ * \param list	A JSON_LIST_VALUE token
+ * \param item	The current item, the first item is returned if its
+ *		\c str is NULL
+ *
+ * \return 0 on success, ENOENT after the last item or EINVAL if
+ *         \c list is not a valid list.
+ */
+extern int json_token_item_next(json_token_t list, json_token_t item);
+
+/* The value of a scalar token */
+extern int64_t json_token_int(json_token_t tok);
+extern double json_token_float(json_token_t tok);
+extern int json_token_bool(json_token_t tok);
+
 extern json_entity_t json_entity_new(enum json_value_e type, ...);
 
 /**
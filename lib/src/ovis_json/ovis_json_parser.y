@@ -147,6 +147,7 @@ void json_parser_free(json_parser_t parser)
 	if (!parser)
 		return;
 	yylex_destroy(parser->scanner);
+	free(parser->stack);
 	free(parser);
 }
 
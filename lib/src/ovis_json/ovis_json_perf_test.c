@@ -204,6 +204,199 @@ double ldmsd_timeval_diff(struct timeval *start, struct timeval *end)
         return (end->tv_sec-start->tv_sec)*1000000.0 + (end->tv_usec-start->tv_usec);
 }
 
+/* a kokkos-like message with \c n kernels */
+jbuf_t make_kernel_msg(int n)
+{
+	int i;
+	jbuf_t jb = jbuf_new();
+	if (!jb)
+		return NULL;
+	jb = jbuf_append_str(jb, "{\"kokkos-perf-data\":{\"job-id\":%" PRId64
+			     ",\"mpi-rank\":%" PRId64 ",\"hostname\":\"%s\","
+			     "\"kernel-perf-info\":[", dC.jobid, dC.rank, hname);
+	for (i = 0; jb && i < n; i++) {
+		jb = jbuf_append_str(jb, "%s{\"kernel-name\":\"Kokkos::View::"
+				     "initialization [kernel_%d]\",\"kernel-type\":"
+				     "\"PARALLEL_FOR\",\"call-count\":%d,"
+				     "\"total-time\":%f,\"region\":[\"main\","
+				     "\"solve\"]}", i ? "," : "", i, i * 7, i * 0.125);
+	}
+	if (jb)
+		jb = jbuf_append_str(jb, "]}}");
+	return jb;
+}
+
+/* Parse \c buf \c count times with both parsers, returns !0 on error */
+int parse_compare(const char *name, char *buf, size_t len, int count)
+{
+	json_parser_t p = json_parser_new(0);
+	json_entity_t e, a;
+	jbuf_t jb, ja;
+	struct timeval tv1, tv2, tv3;
+	double t1, t2;
+	int i, rc = 1;
+
+	if (!p)
+		return 1;
+	if (json_parse_buffer(p, buf, len, &e) ||
+	    json_parse_buffer_arena(p, buf, len, &a)) {
+		printf("%s: cannot parse %s\n", name, buf);
+		goto out;
+	}
+	jb = json_entity_dump(NULL, e);
+	ja = json_entity_dump(NULL, a);
+	if (!jb || !ja || strcmp(jb->buf, ja->buf)) {
+		printf("%s: the parsers disagree\n", name);
+		goto out;
+	}
+	jbuf_free(jb);
+	jbuf_free(ja);
+	json_entity_free(e);
+	json_entity_free(a);
+
+	gettimeofday(&tv1, NULL);
+	for (i = 0; i < count; i++) {
+		if (json_parse_buffer(p, buf, len, &e))
+			goto out;
+		json_entity_free(e);
+	}
+	gettimeofday(&tv2, NULL);
+	for (i = 0; i < count; i++) {
+		if (json_parse_buffer_arena(p, buf, len, &a))
+			goto out;
+		json_entity_free(a);
+	}
+	gettimeofday(&tv3, NULL);
+	t1 = ldmsd_timeval_diff(&tv1, &tv2);
+	t2 = ldmsd_timeval_diff(&tv2, &tv3);
+	printf("%d %s parse MB/s %g\n", count, name, (double)len * count / t1);
+	printf("%d %s arena parse MB/s %g\n", count, name, (double)len * count / t2);
+	rc = 0;
+ out:
+	json_parser_free(p);
+	return rc;
+}
+
+/* The fields of a darshan message that darshan_stream_store stores */
+static const char *darshan_names[] = {
+	"job_id", "rank", "ProducerName", "file", "record_id", "module",
+	"type", "max_byte", "switches", "flushes", "cnt", "op", "seg"
+};
+#define DARSHAN_NAMES (sizeof(darshan_names) / sizeof(darshan_names[0]))
+static const char *seg_names[] = {
+	"data_set", "pt_sel", "irreg_hslab", "reg_hslab", "ndims", "npoints",
+	"off", "len", "dur", "timestamp"
+};
+#define SEG_NAMES (sizeof(seg_names) / sizeof(seg_names[0]))
+
+/* Sum up the numbers and the string lengths of the fields */
+static double extract_tree(json_parser_t p, const char *buf, size_t len)
+{
+	json_entity_t e, v, seg, item;
+	double sum = 0;
+	int i;
+
+	if (json_parse_buffer_arena(p, buf, len, &e))
+		return -1;
+	for (i = 0; i < DARSHAN_NAMES - 1; i++) {
+		v = json_value_find(e, (char *)darshan_names[i]);
+		if (!v)
+			continue;
+		if (v->type == JSON_STRING_VALUE)
+			sum += v->value.str_->str_len;
+		else
+			sum += v->value.int_;
+	}
+	seg = json_value_find(e, "seg");
+	for (item = json_item_first(seg); item; item = json_item_next(item)) {
+		for (i = 0; i < SEG_NAMES; i++) {
+			v = json_value_find(item, (char *)seg_names[i]);
+			if (!v)
+				continue;
+			if (v->type == JSON_STRING_VALUE)
+				sum += v->value.str_->str_len;
+			else if (v->type == JSON_FLOAT_VALUE)
+				sum += v->value.double_;
+			else
+				sum += v->value.int_;
+		}
+	}
+	json_entity_free(e);
+	return sum;
+}
+
+static double extract_token(const char *buf, size_t len)
+{
+	struct json_token_s e, item;
+	struct json_token_s v[DARSHAN_NAMES], sv[SEG_NAMES];
+	double sum = 0;
+	int i;
+
+	if (json_token_parse(buf, len, &e) ||
+	    json_token_find(&e, DARSHAN_NAMES, darshan_names, v))
+		return -1;
+	for (i = 0; i < DARSHAN_NAMES - 1; i++) {
+		if (!v[i].str)
+			continue;
+		if (v[i].type == JSON_STRING_VALUE)
+			sum += v[i].len;
+		else
+			sum += json_token_int(&v[i]);
+	}
+	item.str = NULL;
+	while (v[i].str && 0 == json_token_item_next(&v[i], &item)) {
+		if (json_token_find(&item, SEG_NAMES, seg_names, sv))
+			return -1;
+		for (i = 0; i < SEG_NAMES; i++) {
+			if (!sv[i].str)
+				continue;
+			if (sv[i].type == JSON_STRING_VALUE)
+				sum += sv[i].len;
+			else if (sv[i].type == JSON_FLOAT_VALUE)
+				sum += json_token_float(&sv[i]);
+			else
+				sum += json_token_int(&sv[i]);
+		}
+		i = DARSHAN_NAMES - 1;
+	}
+	return sum;
+}
+
+/*
+ * Extract the fields of darshan message \c buf \c count times from a
+ * parsed document and from tokens, returns !0 on error
+ */
+int extract_compare(char *buf, size_t len, int count)
+{
+	json_parser_t p = json_parser_new(0);
+	struct timeval tv1, tv2, tv3;
+	double sum;
+	int i, rc = 1;
+
+	if (!p)
+		return 1;
+	sum = extract_tree(p, buf, len);
+	if (sum < 0 || sum != extract_token(buf, len)) {
+		printf("darshan: the extracted fields disagree\n");
+		goto out;
+	}
+	gettimeofday(&tv1, NULL);
+	for (i = 0; i < count; i++)
+		extract_tree(p, buf, len);
+	gettimeofday(&tv2, NULL);
+	for (i = 0; i < count; i++)
+		extract_token(buf, len);
+	gettimeofday(&tv3, NULL);
+	printf("%d darshan extract msgs/s %g\n", count,
+	       count * 1e6 / ldmsd_timeval_diff(&tv1, &tv2));
+	printf("%d darshan token extract msgs/s %g\n", count,
+	       count * 1e6 / ldmsd_timeval_diff(&tv2, &tv3));
+	rc = 0;
+ out:
+	json_parser_free(p);
+	return rc;
+}
+
 int main(int argc, char *argv[])
 {
 	if (argc < 2) {
@@ -259,5 +452,16 @@ int main(int argc, char *argv[])
 	printf("%d sprintf time us %g\n",count, ldmsd_timeval_diff(&tv1, &tv2));
 	printf("%d jbuf elements time us    %g\n",count, ldmsd_timeval_diff(&tv2, &tv3));
 	printf("%d jbuf fmt time us    %g\n",count, ldmsd_timeval_diff(&tv3, &tv4));
+
+	make_string_sprintf(1, buf,
+		record_count, rwo, offset, length, max_byte, rw_switch, flushes, start_time, end_time, tspec_start, tspec_end, total_time, mod_name, data_type);
+	if (parse_compare("darshan", buf, strlen(buf), count))
+		return 1;
+	if (extract_compare(buf, strlen(buf), count))
+		return 1;
+	jb = make_kernel_msg(100);
+	if (!jb || parse_compare("kokkos", jb->buf, jb->cursor, count / 100 + 1))
+		return 1;
+	jbuf_free(jb);
 	return 0;
 }
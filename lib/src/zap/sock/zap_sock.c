@@ -1740,11 +1740,43 @@ static zap_err_t z_sock_listen(zap_ep_t ep, struct sockaddr *sa,
 	return zerr;
 }
 
-static zap_err_t z_sock_send(zap_ep_t ep, char *buf, size_t len)
+/* Copy `len` bytes of the iovec stream starting at `off` into `dst` */
+static void __iov_copy(char *dst, const struct iovec *iov, int iovcnt,
+		       size_t off, size_t len)
+{
+	size_t n;
+	int i;
+	for (i = 0; i < iovcnt && len; i++) {
+		if (off >= iov[i].iov_len) {
+			off -= iov[i].iov_len;
+			continue;
+		}
+		n = min_t(size_t, iov[i].iov_len - off, len);
+		memcpy(dst, (char *)iov[i].iov_base + off, n);
+		dst += n;
+		len -= n;
+		off = 0;
+	}
+}
+
+static zap_err_t z_sock_send_iov(zap_ep_t ep, const struct iovec *iov,
+				 int iovcnt)
 {
 	struct z_sock_ep *sep = (struct z_sock_ep *)ep;
+	struct iovec v[ZAP_SOCK_IOV_MAX];
+	struct sock_msg_sendrecv msg;
+	struct msghdr mh = { .msg_iov = v };
 	struct z_sock_io *io;
+	z_sock_send_wr_t wr;
+	ssize_t wsz = -1;
+	size_t len = 0, skip;
 	zap_err_t zerr;
+	int i;
+
+	for (i = 0; i < iovcnt; i++)
+		len += iov[i].iov_len;
+	z_sock_hdr_init(&msg.hdr, 0, SOCK_MSG_SENDRECV, sizeof(msg) + len, 0);
+	msg.data_len = htonl((uint32_t)len);
 
 	pthread_mutex_lock(&sep->ep.lock);
 
@@ -1762,24 +1794,66 @@ static zap_err_t z_sock_send(zap_ep_t ep, char *buf, size_t len)
 	io->comp_type = ZAP_EVENT_SEND_COMPLETE;
 	io->ctxt = NULL;
 
-	io->wr = __sock_wr_alloc(len, io);
-	if (!io->wr) {
+	if (TAILQ_EMPTY(&sep->sq) && iovcnt < ZAP_SOCK_IOV_MAX) {
+		/*
+		 * Nothing is queued ahead of this message, write the header
+		 * and the application buffers straight from where they are.
+		 */
+		DEBUG_LOG_SEND_MSG(sep, &msg.hdr);
+		v[0].iov_base = &msg;
+		v[0].iov_len = sizeof(msg);
+		memcpy(&v[1], iov, iovcnt * sizeof(*iov));
+		mh.msg_iovlen = iovcnt + 1;
+		wsz = sendmsg(sep->sock, &mh, MSG_NOSIGNAL);
+		if (wsz < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				shutdown(sep->sock, SHUT_RDWR);
+				zerr = ZAP_ERR_TRANSPORT;
+				goto err1;
+			}
+			wsz = 0;
+		}
+		DEBUG_LOG(sep, "ep: %p, wrote %ld bytes\n", sep, wsz);
+		if ((size_t)wsz == sizeof(msg) + len) {
+			/* The io thread delivers the completion */
+			TAILQ_INSERT_TAIL(&sep->io_cq, io, q_link);
+			__enable_epoll_out(sep);
+			pthread_mutex_unlock(&sep->ep.lock);
+			return ZAP_ERR_OK;
+		}
+	}
+
+	/* Copy the (unwritten part of the) message into a work request */
+	wr = io->wr = __sock_wr_alloc(len, io);
+	if (!wr) {
+		if (wsz > 0) {
+			/* the peer has a partial message */
+			shutdown(sep->sock, SHUT_RDWR);
+		}
 		zerr = ZAP_ERR_RESOURCE;
 		goto err1;
 	}
 
-	io->wr->flags = Z_SOCK_WR_COMPLETION | Z_SOCK_WR_SEND;
-	io->wr->data = 0;
-	io->wr->data_len = 0;
-	io->wr->msg_len = sizeof(io->wr->msg.sendrecv) + len;
-	z_sock_hdr_init(&io->wr->msg.sendrecv.hdr, 0, SOCK_MSG_SENDRECV,
-			sizeof(io->wr->msg.sendrecv) + len, 0);
-	io->wr->msg.sendrecv.data_len = htonl((uint32_t)len);
-	memcpy(io->wr->msg.bytes + sizeof(io->wr->msg.sendrecv), buf, len);
+	wr->flags = Z_SOCK_WR_COMPLETION | Z_SOCK_WR_SEND;
+	wr->data = 0;
+	wr->data_len = 0;
+	memcpy(&wr->msg.sendrecv, &msg, sizeof(msg));
+	/* bytes already written are skipped by `off` */
+	wr->off = (wsz > 0) ? wsz : 0;
+	wr->msg_len = sizeof(msg) + len - wr->off;
+	skip = (wr->off > sizeof(msg)) ? wr->off - sizeof(msg) : 0;
+	__iov_copy(wr->msg.bytes + sizeof(msg) + skip, iov, iovcnt,
+		   skip, len - skip);
 
 	TAILQ_INSERT_TAIL(&sep->io_q, io, q_link);
-	/* Post the work request */
-	__wr_post(sep, io->wr);
+	if (wsz < 0) {
+		/* Post the work request */
+		__wr_post(sep, wr);
+	} else {
+		/* The socket is full, let the io thread write the rest */
+		TAILQ_INSERT_TAIL(&sep->sq, wr, link);
+		__enable_epoll_out(sep);
+	}
 	pthread_mutex_unlock(&sep->ep.lock);
 	return ZAP_ERR_OK;
 err1:
@@ -1789,6 +1863,12 @@ err0:
 	return zerr;
 }
 
+static zap_err_t z_sock_send(zap_ep_t ep, char *buf, size_t len)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+	return z_sock_send_iov(ep, &iov, 1);
+}
+
 void z_sock_atfork()
 {
 	/* reset at fork */
@@ -2258,6 +2338,7 @@ zap_err_t zap_transport_get(zap_t *pz, zap_log_fn_t log_fn,
 	z->listen = z_sock_listen;
 	z->close = z_sock_close;
 	z->send = z_sock_send;
+	z->send_iov = z_sock_send_iov;
 	z->read = z_sock_read;
 	z->write = z_sock_write;
 	z->unmap = z_sock_unmap;
@@ -300,6 +300,13 @@ struct z_sock_ep {
 
 #define ZAP_SOCK_EV_SIZE 4096
 
+/**
+ * \brief The maximum number of buffers (message header included) that
+ * z_sock_send_iov() passes to sendmsg() directly. Messages with more
+ * buffers are copied into a send work request.
+ */
+#define ZAP_SOCK_IOV_MAX 64
+
 typedef struct z_sock_io_thread {
 	struct zap_io_thread zap_io_thread;
 	int efd; /* epoll fd */
@@ -0,0 +1,357 @@
+/* -*- c-basic-offset: 8 -*-
+ * Copyright (c) 2026 National Technology & Engineering Solutions
+ * of Sandia, LLC (NTESS). Under the terms of Contract DE-NA0003525 with
+ * NTESS, the U.S. Government retains certain rights in this software.
+ * Copyright (c) 2026 Open Grid Computing, Inc. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the BSD-type
+ * license below:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *      Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *      Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ *      Neither the name of Sandia nor the names of any contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ *      Neither the name of Open Grid Computing nor the names of any
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ *      Modified source versions must be plainly marked as such, and
+ *      must not be misrepresented as being the original software.
+ *
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file zap_test_send_iov.c
+ *
+ * \brief Throughput test of zap_send() versus zap_send_iov().
+ *
+ * The process listens on \c port and connects to itself. The client sends
+ * \c count messages of \c size bytes made of \c segs segments, first by
+ * copying the segments into one buffer and calling zap_send() the way
+ * callers without zap_send_iov() have to, then by passing the segments to
+ * zap_send_iov(). The receiver verifies every message. The message rate and
+ * bandwidth of each round are reported.
+ */
+#include <unistd.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <sys/errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <assert.h>
+#include "zap.h"
+
+struct msg_hdr {
+	uint32_t seq;
+	uint32_t len;
+};
+
+static int count = 100000;
+static int size = 4096;
+static int segs = 4;
+static int max_inflight = 256;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cv = PTHREAD_COND_INITIALIZER;
+static int connected;
+static int recv_count;
+static int recv_errors;
+static int inflight;
+
+static char pattern(uint32_t seq, int seg)
+{
+	return (char)((seq + seg) & 0xff);
+}
+
+static void check_msg(const char *data, size_t len)
+{
+	struct msg_hdr hdr;
+	size_t seg_len = size / segs;
+	size_t i;
+
+	if (len != sizeof(hdr) + size)
+		goto err;
+	memcpy(&hdr, data, sizeof(hdr));
+	if (hdr.len != size)
+		goto err;
+	data += sizeof(hdr);
+	for (i = 0; i < size; i++) {
+		if (data[i] != pattern(hdr.seq, i / seg_len))
+			goto err;
+	}
+	return;
+ err:
+	recv_errors++;
+}
+
+static void server_cb(zap_ep_t ep, zap_event_t ev)
+{
+	switch (ev->type) {
+	case ZAP_EVENT_CONNECT_REQUEST:
+		if (zap_accept(ep, server_cb, NULL, 0))
+			printf("Error: zap_accept failed\n");
+		break;
+	case ZAP_EVENT_RECV_COMPLETE:
+		check_msg((const char *)ev->data, ev->data_len);
+		pthread_mutex_lock(&lock);
+		recv_count++;
+		pthread_cond_broadcast(&cv);
+		pthread_mutex_unlock(&lock);
+		break;
+	case ZAP_EVENT_CONNECTED:
+	case ZAP_EVENT_SEND_COMPLETE:
+		break;
+	case ZAP_EVENT_DISCONNECTED:
+		zap_free(ep);
+		break;
+	default:
+		printf("server: unexpected event %s\n", zap_event_str(ev->type));
+		break;
+	}
+}
+
+static void client_cb(zap_ep_t ep, zap_event_t ev)
+{
+	pthread_mutex_lock(&lock);
+	switch (ev->type) {
+	case ZAP_EVENT_CONNECTED:
+		connected = 1;
+		break;
+	case ZAP_EVENT_CONNECT_ERROR:
+	case ZAP_EVENT_REJECTED:
+	case ZAP_EVENT_DISCONNECTED:
+		connected = -1;
+		break;
+	case ZAP_EVENT_SEND_COMPLETE:
+		inflight--;
+		break;
+	default:
+		printf("client: unexpected event %s\n", zap_event_str(ev->type));
+		break;
+	}
+	pthread_cond_broadcast(&cv);
+	pthread_mutex_unlock(&lock);
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int run(zap_ep_t ep, const char *name, int use_iov)
+{
+	struct iovec *iov;
+	struct msg_hdr hdr;
+	size_t seg_len = size / segs;
+	char *seg_mem, *flat, *p;
+	double t0, t1;
+	zap_err_t zerr = ZAP_ERR_OK;
+	int i, j;
+
+	iov = calloc(segs + 1, sizeof(*iov));
+	seg_mem = malloc(size);
+	flat = malloc(sizeof(hdr) + size);
+	assert(iov && seg_mem && flat);
+
+	pthread_mutex_lock(&lock);
+	recv_count = 0;
+	pthread_mutex_unlock(&lock);
+	hdr.len = size;
+	t0 = now_sec();
+	for (i = 0; i < count; i++) {
+		hdr.seq = i;
+		iov[0].iov_base = &hdr;
+		iov[0].iov_len = sizeof(hdr);
+		for (j = 0; j < segs; j++) {
+			/* the application fills its own buffers */
+			p = seg_mem + j * seg_len;
+			memset(p, pattern(i, j), seg_len);
+			iov[j + 1].iov_base = p;
+			iov[j + 1].iov_len = seg_len;
+		}
+		pthread_mutex_lock(&lock);
+		while (inflight >= max_inflight && connected == 1)
+			pthread_cond_wait(&cv, &lock);
+		inflight++;
+		pthread_mutex_unlock(&lock);
+		if (use_iov) {
+			zerr = zap_send_iov(ep, iov, segs + 1);
+		} else {
+			p = flat;
+			for (j = 0; j <= segs; j++) {
+				memcpy(p, iov[j].iov_base, iov[j].iov_len);
+				p += iov[j].iov_len;
+			}
+			zerr = zap_send(ep, flat, sizeof(hdr) + size);
+		}
+		if (zerr) {
+			printf("%s: send error %s\n", name, zap_err_str(zerr));
+			break;
+		}
+	}
+	pthread_mutex_lock(&lock);
+	while (!zerr && recv_count < count && connected == 1)
+		pthread_cond_wait(&cv, &lock);
+	pthread_mutex_unlock(&lock);
+	t1 = now_sec();
+	if (!zerr)
+		printf("%-10s %12.0f msgs/s %10.1f MB/s\n", name,
+		       count / (t1 - t0),
+		       (double)count * size / (t1 - t0) / 1e6);
+	free(iov);
+	free(seg_mem);
+	free(flat);
+	return zerr || recv_count != count;
+}
+
+static void test_log(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	fflush(stdout);
+}
+
+static zap_mem_info_t test_meminfo(void)
+{
+	return NULL;
+}
+
+#define FMT_ARGS "x:p:c:m:n:"
+static void usage(char *argv[])
+{
+	printf("usage: %s [-x name] [-p port_no] [-c count] [-m bytes] "
+	       "[-n segments]\n"
+	       "    -x name	The transport to use (default: sock).\n"
+	       "    -p port_no	The port number (default: 10888).\n"
+	       "    -c count	The number of messages per round "
+	       "(default: 100000).\n"
+	       "    -m bytes	The message payload size (default: 4096).\n"
+	       "    -n segments	The number of payload segments (default: 4).\n",
+	       argv[0]);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	char *transport = "sock";
+	short port_no = 10888;
+	struct sockaddr_in sin;
+	zap_ep_t listen_ep, ep;
+	zap_err_t zerr;
+	zap_t zap;
+	int rc;
+
+	while (-1 != (rc = getopt(argc, argv, FMT_ARGS))) {
+		switch (rc) {
+		case 'x':
+			transport = optarg;
+			break;
+		case 'p':
+			port_no = atoi(optarg);
+			break;
+		case 'c':
+			count = atoi(optarg);
+			break;
+		case 'm':
+			size = atoi(optarg);
+			break;
+		case 'n':
+			segs = atoi(optarg);
+			break;
+		default:
+			usage(argv);
+			break;
+		}
+	}
+	if (count < 1 || segs < 1 || size < segs || size % segs) {
+		printf("count and segments must be positive and the size "
+		       "a multiple of segments\n");
+		return 1;
+	}
+
+	zap = zap_get(transport, test_log, test_meminfo);
+	if (!zap) {
+		printf("could not load the '%s' transport.\n", transport);
+		return 1;
+	}
+	if (size + sizeof(struct msg_hdr) > zap_max_msg(zap)) {
+		printf("message size exceeds the transport maximum %zu\n",
+		       zap_max_msg(zap));
+		return 1;
+	}
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port_no);
+	listen_ep = zap_new(zap, server_cb);
+	assert(listen_ep);
+	zerr = zap_listen(listen_ep, (struct sockaddr *)&sin, sizeof(sin));
+	if (zerr) {
+		printf("zap_listen failed: %s\n", zap_err_str(zerr));
+		return 1;
+	}
+
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	ep = zap_new(zap, client_cb);
+	assert(ep);
+	zerr = zap_connect(ep, (struct sockaddr *)&sin, sizeof(sin), NULL, 0);
+	if (zerr) {
+		printf("zap_connect failed: %s\n", zap_err_str(zerr));
+		return 1;
+	}
+	pthread_mutex_lock(&lock);
+	while (!connected)
+		pthread_cond_wait(&cv, &lock);
+	pthread_mutex_unlock(&lock);
+	if (connected != 1) {
+		printf("cannot connect\n");
+		return 1;
+	}
+
+	printf("%d messages x %d bytes in %d segments\n", count, size, segs);
+	rc = run(ep, "send", 0);
+	rc |= run(ep, "send_iov", 1);
+	if (recv_errors) {
+		printf("ERROR: %d corrupted messages\n", recv_errors);
+		rc = 1;
+	}
+	zap_close(ep);
+	sleep(1);
+	return rc;
+}
@@ -516,6 +516,46 @@ zap_err_t zap_send(zap_ep_t ep, void *buf, size_t sz)
 	return zerr;
 }
 
+/* Fallback for transports without the send_iov operation */
+static zap_err_t __zap_send_flat(zap_ep_t ep, const struct iovec *iov,
+				 int iovcnt)
+{
+	zap_err_t zerr;
+	size_t len = 0;
+	char *buf, *p;
+	int i;
+
+	if (iovcnt == 1)
+		return ep->z->send(ep, iov[0].iov_base, iov[0].iov_len);
+	for (i = 0; i < iovcnt; i++)
+		len += iov[i].iov_len;
+	buf = malloc(len ? len : 1);
+	if (!buf)
+		return ZAP_ERR_RESOURCE;
+	for (p = buf, i = 0; i < iovcnt; i++) {
+		memcpy(p, iov[i].iov_base, iov[i].iov_len);
+		p += iov[i].iov_len;
+	}
+	zerr = ep->z->send(ep, buf, len);
+	free(buf);
+	return zerr;
+}
+
+zap_err_t zap_send_iov(zap_ep_t ep, const struct iovec *iov, int iovcnt)
+{
+	zap_err_t zerr;
+
+	if (iovcnt < 0 || (iovcnt && !iov))
+		return ZAP_ERR_PARAMETER;
+	ref_get(&ep->ref, "zap_send_iov");
+	if (ep->z->send_iov)
+		zerr = ep->z->send_iov(ep, iov, iovcnt);
+	else
+		zerr = __zap_send_flat(ep, iov, iovcnt);
+	ref_put(&ep->ref, "zap_send_iov");
+	return zerr;
+}
+
 zap_err_t zap_send_mapped(zap_ep_t ep, zap_map_t map, void *buf, size_t len,
 			  void *context)
 {
@@ -81,6 +81,7 @@
 #include <inttypes.h>
 #include <sys/queue.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/ip.h>
 
@@ -581,6 +582,28 @@ zap_err_t zap_close(zap_ep_t ep);
  */
 zap_err_t zap_send(zap_ep_t ep, void *buf, size_t sz);
 
+/**
+ * \brief Send data gathered from several buffers to the peer
+ *
+ * The \c iovcnt buffers described by \c iov are sent, in order, as a single
+ * message. The peer receives one ::ZAP_EVENT_RECV_COMPLETE with the
+ * concatenated data, exactly as if the buffers had been copied into one
+ * buffer and passed to \c zap_send(). As with \c zap_send(), the buffers
+ * may be reused as soon as the function returns.
+ *
+ * Transports that support it hand the buffers to the kernel directly
+ * (e.g. \c sendmsg() in zap_sock) and only copy the portion of the message
+ * that could not be written immediately. Other transports fall back to
+ * flattening the buffers into a temporary buffer and calling \c zap_send().
+ *
+ * \param ep	The endpoint handle
+ * \param iov	The array of buffers to send
+ * \param iovcnt	The number of entries in \c iov
+ * \returns	ZAP_ERR_OK on success, or a zap_err_t value indicating the
+ *		reason for failure.
+ */
+zap_err_t zap_send_iov(zap_ep_t ep, const struct iovec *iov, int iovcnt);
+
 /**
  * \brief Send data to peer using map.
  *
@@ -216,6 +216,13 @@ struct zap {
 	/** Send a message */
 	zap_err_t (*send)(zap_ep_t ep, char *buf, size_t sz);
 
+	/**
+	 * Send a message gathered from \c iovcnt buffers. This is optional;
+	 * when it is NULL, \c zap_send_iov() flattens the buffers and calls
+	 * \c send.
+	 */
+	zap_err_t (*send_iov)(zap_ep_t ep, const struct iovec *iov, int iovcnt);
+
 	/** RDMA write data to a remote buffer */
 	zap_err_t (*write)(zap_ep_t ep,
 			   zap_map_t src_map, char *src,